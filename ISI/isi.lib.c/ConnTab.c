@@ -28,6 +28,156 @@
 IsiConnection * _isiConnectionTable = NULL;     // malloc(ISI_DEFAULT_CONTAB_SIZE * sizeof(IsiConnection));
 unsigned _connectionsTableSize = 0; // ISI_DEFAULT_CONTAB_SIZE;
 
+// Lookup indices over the connection table, so the enrollment message handlers
+// need not scan every entry for each CSMO, CSMI, CSMD or CSMX received.  Each
+// bucket is a bitmap of connection table slots; only pending and in-use entries
+// are indexed.  The CID index hashes the whole CID; the selector index keeps
+// each entry under the 256-selector blocks its first and last selector fall in.
+// A bucket may hold entries that don't match, so callers still check the entry.
+// Both are maintained by IsiSetConnection.
+#define ISI_CID_BUCKETS         64u
+#define ISI_SELECTOR_BUCKETS    64u
+#define ISI_CONNECTION_MAP_SIZE (ISI_MAX_CONNECTION_COUNT / 8u)
+
+typedef LonByte IsiConnectionMap[ISI_CONNECTION_MAP_SIZE];
+
+static IsiConnectionMap cidIndex[ISI_CID_BUCKETS];
+static IsiConnectionMap selectorIndex[ISI_SELECTOR_BUCKETS];
+static IsiConnectionMap selectorWideIndex;  // width 0: in range of every selector
+static LonBool useIndex = TRUE;
+
+static unsigned cidBucket(const IsiCid* pCid)
+{
+    const LonByte* pData = (const LonByte*)pCid;
+    unsigned hash = 0, i;
+
+    for (i = 0; i < (unsigned)sizeof(IsiCid); ++i)
+    {
+        hash = hash * 31u + pData[i];
+    }
+    return hash % ISI_CID_BUCKETS;
+}
+
+static unsigned selectorBucket(unsigned Selector)
+{
+    return (Selector >> 8) % ISI_SELECTOR_BUCKETS;
+}
+
+static void indexConnection(unsigned Index, LonBool Add)
+{
+    const IsiConnection* pConnection = IsiGetConnection(Index);
+    unsigned width = LON_GET_ATTRIBUTE_P(pConnection,ISI_CONN_WIDTH);
+    unsigned selector = LON_GET_UNSIGNED_WORD(pConnection->Header.Selector);
+    LonByte* maps[3];
+    unsigned mapCount = 0, i;
+
+    if ((unsigned)LON_GET_ATTRIBUTE_P(pConnection,ISI_CONN_STATE) < isiConnectionStatePending)
+        return;
+
+    maps[mapCount++] = cidIndex[cidBucket(&pConnection->Header.Cid)];
+    if (width)
+    {
+        maps[mapCount++] = selectorIndex[selectorBucket(selector)];
+        maps[mapCount++] = selectorIndex[selectorBucket((selector + width - 1u) & 0xFFFFu)];
+    }
+    else
+    {
+        maps[mapCount++] = selectorWideIndex;
+    }
+
+    for (i = 0; i < mapCount; ++i)
+    {
+        if (Add)
+            maps[i][Index >> 3] |= (LonByte)(1u << (Index & 7u));
+        else
+            maps[i][Index >> 3] &= (LonByte)~(1u << (Index & 7u));
+    }
+}
+
+static unsigned nextInMap(const LonByte* pMap, unsigned Index)
+{
+    unsigned size = IsiGetConnectionTableSize();
+
+    while (Index < size)
+    {
+        if (!(Index & 7u) && !pMap[Index >> 3])
+        {
+            Index += 8u;
+        }
+        else if (pMap[Index >> 3] & (1u << (Index & 7u)))
+        {
+            return Index;
+        }
+        else
+        {
+            ++Index;
+        }
+    }
+    return size;
+}
+
+void _IsiIndexConnectionTable(void)
+{
+    unsigned i;
+
+    memset(cidIndex, 0, sizeof(cidIndex));
+    memset(selectorIndex, 0, sizeof(selectorIndex));
+    memset(selectorWideIndex, 0, sizeof(selectorWideIndex));
+    for (i = 0; i < IsiGetConnectionTableSize(); ++i)
+    {
+        indexConnection(i, TRUE);
+    }
+}
+
+// With the indices off, the lookups below return every slot, so the handlers
+// scan the whole table as they did before the indices.  Only for checks which
+// compare the two.
+void _IsiUseConnectionIndex(LonBool Use)
+{
+    useIndex = Use;
+}
+
+// Returns the first connection table index at or after Index which is pending or
+// in use and has the given CID, or the connection table size if there is none.
+unsigned _IsiNextConnectionByCid(const IsiCid* pCid, unsigned Index)
+{
+    const LonByte* pMap = cidIndex[cidBucket(pCid)];
+    unsigned size = IsiGetConnectionTableSize();
+
+    if (!useIndex)
+        return Index < size ? Index : size;
+
+    for (Index = nextInMap(pMap, Index); Index < size; Index = nextInMap(pMap, Index + 1u))
+    {
+        if (!memcmp(&IsiGetConnection(Index)->Header.Cid, pCid, sizeof(IsiCid)))
+            break;
+    }
+    return Index;
+}
+
+// Returns the first connection table index at or after Index which is pending or
+// in use and whose selectors might overlap Selector..Selector+Count, or the
+// connection table size if there is none.  Count must be less than 256.  The
+// caller confirms the overlap with _IsiInSelectorRange.
+unsigned _IsiNextConnectionBySelector(LonWord Selector, unsigned Count, unsigned Index)
+{
+    IsiConnectionMap map;
+    unsigned first = LON_GET_UNSIGNED_WORD(Selector);
+    const LonByte* pFirst = selectorIndex[selectorBucket(first)];
+    const LonByte* pLast = selectorIndex[selectorBucket((first + Count) & 0xFFFFu)];
+    unsigned size = IsiGetConnectionTableSize();
+    unsigned i;
+
+    if (!useIndex)
+        return Index < size ? Index : size;
+
+    for (i = 0; i < ISI_CONNECTION_MAP_SIZE; ++i)
+    {
+        map[i] = pFirst[i] | pLast[i] | selectorWideIndex[i];
+    }
+    return nextInMap(map, Index);
+}
+
 unsigned IsiGetConnectionTableSize(void)
 {
 	return _connectionsTableSize;
@@ -57,6 +207,7 @@ void _IsiSetConnectionTableSize(unsigned sz)
 void _IsiInitConnectionTable()
 {
     memset(_isiConnectionTable, 0, IsiGetConnectionTableSize() * sizeof(IsiConnection));    
+    _IsiIndexConnectionTable();
 }
 
 const IsiConnection* IsiGetConnection(unsigned Index) 
@@ -70,7 +221,9 @@ void IsiSetConnection(const IsiConnection* pConnection, unsigned Index)
 #pragma relaxed_casting_on
 #pragma warnings_off
 #endif
+    indexConnection(Index, FALSE);
     memcpy((IsiConnection*)IsiGetConnection(Index), pConnection, (unsigned)sizeof(IsiConnection));
+    indexConnection(Index, TRUE);
 #if 0
 #pragma relaxed_casting_off
 #pragma warnings_on
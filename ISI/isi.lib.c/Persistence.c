@@ -302,6 +302,7 @@ LtPersistenceLossReason deserializeIsiNvdSegConnectionTable(LonByte* pBuffer, in
     if (len >= image_len)
     {
         memcpy((void *)IsiGetConnection(0), (void *)pBuffer ,image_len);
+        _IsiIndexConnectionTable();
         DumpConnectionTable();
     }
     else
@@ -33,7 +33,9 @@ void _IsiReceiveCsmd(const IsiCsmd* pCsmd)
     _IsiAPIDebug("_IsiReceiveCsmd ");
     _IsiAPIDump("0x", (void *)pCsmd, sizeof(IsiCsmd), "\n");
 
-	for (Connection = 0; _IsiNextConnection(Connection, &ConnectionData); ++Connection)
+	for (Connection = _IsiNextConnectionByCid(&pCsmd->Cid, 0);
+	     _IsiNextConnection(Connection, &ConnectionData);
+	     Connection = _IsiNextConnectionByCid(&pCsmd->Cid, Connection + 1u))
     {
 		if (LON_GET_ATTRIBUTE(ConnectionData,ISI_CONN_STATE) >= isiConnectionStateInUse
 		    && !memcmp(&ConnectionData.Header.Cid, &pCsmd->Cid, (unsigned)sizeof(IsiCid)))
@@ -74,7 +74,9 @@ void _IsiReceivePtrCsmo(IsiCsmo* pCsmo, unsigned localHostAssembly, LonBool Auto
 
     // find out if this is a duplicate (re-send) of a CSMO received earlier. Quietly ignore these
     // duplicates, as the connection host keeps sending these for increased reach.
-	for(Connection = 0; Connection < _isiVolatile.ConnectionTableSize; ++Connection)
+	for(Connection = _IsiNextConnectionByCid(&pCsmo->Header.Cid, 0);
+	    Connection < _isiVolatile.ConnectionTableSize;
+	    Connection = _IsiNextConnectionByCid(&pCsmo->Header.Cid, Connection + 1u))
     {
 		pConnection = IsiGetConnection(Connection);
 		if ((unsigned)LON_GET_ATTRIBUTE_P(pConnection,ISI_CONN_STATE) >= minimumDuplicateState
@@ -24,6 +24,15 @@
 
 #include "isi_int.h"
 
+// The next connection table entry the CSMI might affect: one with its CID, or one whose
+// selectors might collide with those it reports. The loop below leaves all others alone.
+static unsigned nextCsmiCandidate(const IsiCsmi* pCsmi, unsigned Connection)
+{
+    unsigned byCid = _IsiNextConnectionByCid(&pCsmi->Header.Cid, Connection);
+    unsigned bySelector = _IsiNextConnectionBySelector(pCsmi->Header.Selector, LON_GET_ATTRIBUTE(pCsmi->Desc.Bf,CsmiCount), Connection);
+
+    return byCid < bySelector ? byCid : bySelector;
+}
 
 void _IsiReceivePtrCsmi(const IsiCsmi* pCsmi)
 {
@@ -35,7 +44,9 @@ void _IsiReceivePtrCsmi(const IsiCsmi* pCsmi)
     _IsiAPIDebug("_IsiReceiveCsmi ");
     _IsiAPIDump("0x", (void *)pCsmi, sizeof(IsiCsmi), "\n");
 
-    for (Connection = 0; _IsiNextConnection(Connection, &ConnectionData); ++Connection)
+    for (Connection = nextCsmiCandidate(pCsmi, 0);
+         _IsiNextConnection(Connection, &ConnectionData);
+         Connection = nextCsmiCandidate(pCsmi, Connection + 1u))
     {
 		if (LON_GET_ATTRIBUTE(ConnectionData,ISI_CONN_STATE) >= isiConnectionStateInUse)
         {
@@ -55,11 +66,11 @@ void _IsiReceivePtrCsmi(const IsiCsmi* pCsmi)
 						// now we must move this connection to a new selector:
 
 						//	1.	find new selector(s) for those currently used by Conflict, using the fixed replacement
-						//		selector algorithm:
+						//		selector algorithm, which adds each byte of the CID (an unsigned is a byte on the Neuron):
 						LON_SET_UNSIGNED_WORD(Replacement, LON_GET_UNSIGNED_WORD(ConnectionData.Header.Selector) + LON_GET_ATTRIBUTE(ConnectionData,ISI_CONN_WIDTH));    //.Width;
 						for (SelectorCorrection = 0; SelectorCorrection < (unsigned)sizeof(IsiCid); ++SelectorCorrection)
                         {
-							Replacement = _IsiAddSelector(Replacement, ((const unsigned*)&ConnectionData.Header.Cid)[SelectorCorrection]);
+							Replacement = _IsiAddSelector(Replacement, ((const LonByte*)&ConnectionData.Header.Cid)[SelectorCorrection]);
 						}
 
 						//	2.	call _IsiReplaceSelectors to execute the selector replacement on local nv and alias tables
@@ -38,7 +38,9 @@ void _IsiReceiveCsmx(const IsiCsmx* pCsmx)
 
 	if (_isiVolatile.State & CONNECTION_STATES)
     {
-        for (Connection = 0; _IsiNextConnection(Connection, &ConnectionData); ++Connection)
+        for (Connection = _IsiNextConnectionByCid(&pCsmx->Cid, 0);
+             _IsiNextConnection(Connection, &ConnectionData);
+             Connection = _IsiNextConnectionByCid(&pCsmx->Cid, Connection + 1u))
         {
             if ((LON_GET_ATTRIBUTE(ConnectionData,ISI_CONN_STATE)  == isiConnectionStatePending)
                 && !memcmp(&ConnectionData.Header.Cid, &pCsmx->Cid, (unsigned)sizeof(IsiCid)))
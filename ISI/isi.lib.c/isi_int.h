@@ -1309,6 +1309,10 @@ extern unsigned IsiGetConnectionTableSize(void);
 extern const IsiConnection* IsiGetConnection(unsigned Index);
 extern void IsiSetConnection(const IsiConnection* pConnection, unsigned Index);
 extern void _IsiInitConnectionTable();
+extern void _IsiIndexConnectionTable(void);
+extern void _IsiUseConnectionIndex(LonBool Use);
+extern unsigned _IsiNextConnectionByCid(const IsiCid* pCid, unsigned Index);
+extern unsigned _IsiNextConnectionBySelector(LonWord Selector, unsigned Count, unsigned Index);
 extern const LonByte* IsiGetPrimaryDid(LonByte* pLength);      // OVERRIDING MIGHT BREAK INTEROPERABILITY!
 extern unsigned IsiGetRepeatCount(void);
 IsiApiError IsiSetDomain(const LonDomain* pDomain, unsigned index);   // forwarder to update_domain
@@ -28,11 +28,84 @@
 
 //============== LOCAL VARIABLES ===========================================
 
+// Shadow copies of the NV, alias and address tables, so the sweeps over
+// these tables don't make a stack API round-trip per entry.  Entries are
+// loaded on first use.  The whole shadow is dropped when the stack's
+// configuration change count moves, except for the single step caused by
+// one of our own writes.
+static LonNvEcsConfig       shadowNv[ISI_MAX_NV_COUNT];
+static LonAliasEcsConfig    shadowAlias[ISI_MAX_ALIAS_COUNT];
+static LonAddress           shadowAddress[ISI_MAX_ADDRESS_TABLE_SIZE];
+static LonByte              shadowNvValid[ISI_MAX_NV_COUNT];
+static LonByte              shadowAliasValid[ISI_MAX_ALIAS_COUNT];
+static LonByte              shadowAddressValid[ISI_MAX_ADDRESS_TABLE_SIZE];
+static unsigned             shadowChangeCount;
+static LonBool              shadowCurrent = FALSE;
+
 
 /*=============================================================================
  *                           SUPPORT FUNCTIONS                                *
  *===========================================================================*/
 
+/***************************************************************************
+ *  Function: shadow_invalidate
+ *
+ *  Parameters: void
+ *
+ *  Operation: Drop every entry of the configuration shadow.
+ ***************************************************************************/
+static void shadow_invalidate(void)
+{
+    memset(shadowNvValid, 0, sizeof(shadowNvValid));
+    memset(shadowAliasValid, 0, sizeof(shadowAliasValid));
+    memset(shadowAddressValid, 0, sizeof(shadowAddressValid));
+    shadowCurrent = FALSE;
+}
+
+/***************************************************************************
+ *  Function: shadow_sync
+ *
+ *  Parameters: void
+ *
+ *  Operation: Drop the shadow if the stack's configuration has changed
+ *  since it was last checked, e.g. through network management.
+ ***************************************************************************/
+static void shadow_sync(void)
+{
+    unsigned changeCount = LonGetConfigChangeCount();
+
+    if (!shadowCurrent || changeCount != shadowChangeCount)
+    {
+        shadow_invalidate();
+        shadowChangeCount = changeCount;
+        shadowCurrent = TRUE;
+    }
+}
+
+/***************************************************************************
+ *  Function: shadow_written
+ *
+ *  Parameters: LonByte* pValid, unsigned before, LonApiError sts
+ *
+ *  Operation: Account for a write through to the stack.  before is the
+ *  change count read just before the write, and sts its result.  The entry
+ *  is reloaded on next use rather than copied, since the stack may
+ *  normalise what it stores.  A successful write stores the network image
+ *  once, so if the count was current before the write and moved by exactly
+ *  one, the rest of the shadow stays current.  Otherwise something else
+ *  changed the configuration too, e.g. network management, or the write
+ *  failed part way, so drop the whole shadow.
+ ***************************************************************************/
+static void shadow_written(LonByte* pValid, unsigned before, LonApiError sts)
+{
+    *pValid = FALSE;
+    if (sts == LonApiNoError && before == shadowChangeCount &&
+        LonGetConfigChangeCount() == before + 1)
+        shadowChangeCount = before + 1;
+    else
+        shadow_invalidate();
+}
+
 /***************************************************************************
  *  Function: access_domain
  *
@@ -164,7 +237,13 @@ void update_nv(const LonNvEcsConfig * nv_entry, unsigned index)
     if (nv_entry && index < _nv_count())
     {
         // nvConfigTable[index] = *nv_entry;
-        IsiApiError sts = LonUpdateNvConfig(index, nv_entry);
+        IsiApiError sts;
+        unsigned before;
+
+        shadow_sync();
+        before = LonGetConfigChangeCount();
+        sts = LonUpdateNvConfig(index, nv_entry);
+        shadow_written(&shadowNvValid[index], before, (LonApiError)sts);
 
         _IsiAPIDebug("update_nv index %u sts %i ", index, sts);
         _IsiAPIDump("data = 0x", (void *)nv_entry, sizeof(LonNvEcsConfig), "\n");
@@ -180,8 +259,22 @@ void update_nv(const LonNvEcsConfig * nv_entry, unsigned index)
  ***************************************************************************/
 const LonNvEcsConfig* IsiGetNv(unsigned Index)
 {
-    memset(&nv_config, 0, sizeof(LonNvEcsConfig));
-    LonQueryNvConfig(Index, &nv_config);
+    if (Index < ISI_MAX_NV_COUNT)
+    {
+        shadow_sync();
+        if (!shadowNvValid[Index])
+        {
+            memset(&shadowNv[Index], 0, sizeof(LonNvEcsConfig));
+            shadowNvValid[Index] = LonQueryNvConfig(Index, &shadowNv[Index]) == (LonApiError)IsiApiNoError;
+        }
+        // Callers get the scratch copy, as before, not the shadow itself.
+        nv_config = shadowNv[Index];
+    }
+    else
+    {
+        memset(&nv_config, 0, sizeof(LonNvEcsConfig));
+        LonQueryNvConfig(Index, &nv_config);
+    }
     return (LonNvEcsConfig* )&nv_config;
 };
 
@@ -259,6 +352,19 @@ const LonAddress*	access_address	(int index)
 {
     LonAddress* pAddress = (LonAddress*)&addrTable;
 
+    if (index >= 0 && index < (int)ISI_MAX_ADDRESS_TABLE_SIZE)
+    {
+        shadow_sync();
+        if (!shadowAddressValid[index])
+        {
+            if (LonQueryAddressConfig(index, &shadowAddress[index]) != (LonApiError)IsiApiNoError)
+                return (LonAddress*)NULL;
+            shadowAddressValid[index] = TRUE;
+        }
+        *pAddress = shadowAddress[index];
+        return pAddress;
+    }
+
     if (LonQueryAddressConfig(index, pAddress) == (LonApiError)IsiApiNoError)
         return pAddress;
     else
@@ -274,8 +380,18 @@ const LonAddress*	access_address	(int index)
  ***************************************************************************/
 IsiApiError update_address(const LonAddress* address, int index)
 {
-    IsiApiError sts = LonUpdateAddressConfig(index, address);
-	if (sts != IsiApiNoError)
+    IsiApiError sts;
+    unsigned before;
+
+    shadow_sync();
+    before = LonGetConfigChangeCount();
+    sts = LonUpdateAddressConfig(index, address);
+    if (index >= 0 && index < (int)ISI_MAX_ADDRESS_TABLE_SIZE)
+        shadow_written(&shadowAddressValid[index], before, (LonApiError)sts);
+    else
+        shadow_invalidate();
+
+    if (sts != IsiApiNoError)
     {
 		_IsiAPIDebug("update_address failed (entry %d)\n", index);
 	}
@@ -304,10 +420,24 @@ void watchdog_update(void)
  ***************************************************************************/
 const LonAliasEcsConfig* IsiGetAlias(unsigned Index)
 {
+    if (Index < ISI_MAX_ALIAS_COUNT)
+    {
+        shadow_sync();
+        if (shadowAliasValid[Index])
+        {
+            alias_config = shadowAlias[Index];
+            return (LonAliasEcsConfig*)&alias_config;
+        }
+    }
     memset(&alias_config, 0, sizeof(LonAliasEcsConfig));
     if (LonQueryAliasConfig(Index, &alias_config) != (LonApiError)IsiApiNoError)
     {
         _IsiAPIDebug("Error - IsiGetAlias(%d)\n", Index); 
+    }
+    else if (Index < ISI_MAX_ALIAS_COUNT)
+    {
+        shadowAlias[Index] = alias_config;
+        shadowAliasValid[Index] = TRUE;
     }
 	return (LonAliasEcsConfig*)&alias_config;
 };
@@ -321,7 +451,17 @@ const LonAliasEcsConfig* IsiGetAlias(unsigned Index)
  ***************************************************************************/
 IsiApiError IsiSetAlias(LonAliasEcsConfig* pAlias, unsigned Index)
 {
-    return LonUpdateAliasConfig(Index, pAlias); 
+    IsiApiError sts;
+    unsigned before;
+
+    shadow_sync();
+    before = LonGetConfigChangeCount();
+    sts = LonUpdateAliasConfig(Index, pAlias); 
+    if (Index < ISI_MAX_ALIAS_COUNT)
+        shadow_written(&shadowAliasValid[Index], before, (LonApiError)sts);
+    else
+        shadow_invalidate();
+    return sts;
 };
 
 IsiApiError update_config_data(const LonConfigData *config_data1)
@@ -435,6 +575,9 @@ IsiApiError retrieve_status(LonStatus* status)
 IsiApiError initializeData(IsiBootType bootType)
 {
     IsiApiError sts = LonQueryConfigData(&config_data);
+
+    // A new stack instance restarts its change count, so start afresh.
+    shadow_invalidate();
    
     if (sts == IsiApiNoError)
         sts = LonQueryReadOnlyData(&read_only_data);
@@ -0,0 +1,158 @@
+/*
+ * DeviceHarness.cpp
+ *
+ * Copyright © 2022 Dialog Semiconductor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in 
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * Description: The IzoT test device shared by the example check and benchmark
+ *  programs.  See DeviceHarness.h.
+ */
+
+#include "DeviceHarness.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#define HARNESS_SNVT	44			// a two byte SNVT
+
+LonApiError HarnessCreateStack(LonStackHandle* phStack, const LonCtxCallbacks* pCallbacks,
+							   const HarnessDevice* pDevice, const LonUniqueId* pUid,
+							   int port, const char* nvdFolder)
+{
+	LonStackInterfaceData interfaceData;
+	LonControlData controlData;
+	LonCtxCallbacks noCallbacks;
+	char szSd[64];
+	char szUri[64];
+	LonApiError sts;
+
+	// The stack keeps a copy of the self-documentation string.
+	snprintf(szSd, sizeof(szSd), "&3.3@4%s", pDevice->szName);
+	memset(&interfaceData, 0, sizeof(interfaceData));
+	interfaceData.Version = LON_STACK_INTERFACE_CURRENT_VERSION;
+	interfaceData.Signature = 0x73AC6400ul | pDevice->model;
+	interfaceData.ProgramId[0] = 0x9F;
+	interfaceData.ProgramId[1] = 0xFF;
+	interfaceData.ProgramId[2] = 0xFF;
+	interfaceData.ProgramId[3] = 0x06;
+	interfaceData.ProgramId[4] = 0x00;
+	interfaceData.ProgramId[5] = 0x0A;
+	interfaceData.ProgramId[6] = 0x04;
+	interfaceData.ProgramId[7] = pDevice->model;
+	interfaceData.StaticNvCount = pDevice->nvCount;
+	interfaceData.NvTblSize = pDevice->nvCount;
+	interfaceData.DomainTblSize = 2;
+	interfaceData.AddrTblSize = pDevice->addressCount;
+	interfaceData.AliasTblSize = pDevice->aliasCount;
+	interfaceData.BindableMsgTagCount = 0;
+	interfaceData.NodeSdString = szSd;
+	interfaceData.AvgDynNvSdLength = 0;
+
+	memset(&controlData, 0, sizeof(controlData));
+	controlData.Version = LON_CONTROL_DATA_CURRENT_VERSION;
+	controlData.ServicePinInterval = 10;
+	controlData.NvdFlushGuardTimeout = 1;
+	controlData.CommParmeters.TransceiverType = FtxlTransceiverType20MHz;
+	controlData.Buffers.ApplicationBuffers.PriorityMsgOutCount = pDevice->priorityOutCount;
+	controlData.Buffers.ApplicationBuffers.NonPriorityMsgOutCount = pDevice->nonPriorityOutCount;
+	controlData.Buffers.ApplicationBuffers.MsgInCount = 5;
+	controlData.Buffers.LinkLayerBuffers.LinkLayerBufferCount = 2;
+	controlData.Buffers.TransceiverBuffers.NetworkBufferInputSize = 66;
+	controlData.Buffers.TransceiverBuffers.NetworkBufferOutputSize = 66;
+	controlData.Buffers.TransceiverBuffers.PriorityNetworkOutCount = 3;
+	controlData.Buffers.TransceiverBuffers.NonPriorityNetworkOutCount = 3;
+	controlData.Buffers.TransceiverBuffers.NetworkInCount = 11;
+	controlData.ReceiveTransCount = 20;
+	controlData.TransmitTransCount = 15;
+	controlData.TransmitTransIdLifetime = 24576;
+
+	snprintf(szUri, sizeof(szUri), "uc://127.0.0.1:%d", port);
+	mkdir(nvdFolder, 0755);
+
+	if (phStack == NULL)
+	{
+		sts = LonSetDeviceUri(szUri);
+		if (sts == LonApiNoError)
+			sts = LonRegisterUniqueId(pUid);
+		if (sts == LonApiNoError)
+			sts = LonSetNvdFsPath(nvdFolder);
+		if (sts == LonApiNoError)
+			sts = LonLidCreateStack(&interfaceData, &controlData);
+	}
+	else
+	{
+		if (pCallbacks == NULL)
+		{
+			memset(&noCallbacks, 0, sizeof(noCallbacks));
+			pCallbacks = &noCallbacks;
+		}
+		sts = LonCtxCreateHandle(phStack, pCallbacks);
+		if (sts == LonApiNoError)
+			sts = LonCtxSetDeviceUri(*phStack, szUri);
+		if (sts == LonApiNoError)
+			sts = LonCtxRegisterUniqueId(*phStack, pUid);
+		if (sts == LonApiNoError)
+			sts = LonCtxSetNvdFsPath(*phStack, nvdFolder);
+		if (sts == LonApiNoError)
+			sts = LonCtxLidCreateStack(*phStack, &interfaceData, &controlData);
+	}
+	return sts;
+}
+
+LonApiError HarnessRegisterNv(LonStackHandle hStack, LonByte* pValue, const char* szName, unsigned flags)
+{
+	LonNvDefinition nvDef;
+
+	memset(&nvDef, 0, sizeof(nvDef));
+	nvDef.Version = LON_NV_DEFINITION_CURRENT_VERSION;
+	nvDef.PValue = pValue;
+	nvDef.DeclaredSize = 2;
+	nvDef.SnvtId = HARNESS_SNVT;
+	nvDef.Flags = flags;
+	nvDef.Name = szName;
+	return hStack == NULL ? LonLidRegisterStaticNv(&nvDef) : LonCtxLidRegisterStaticNv(hStack, &nvDef);
+}
+
+LonApiError HarnessStartStack(LonStackHandle hStack)
+{
+	LonApiError sts = hStack == NULL ? LonLidStartStack() : LonCtxLidStartStack(hStack);
+
+	if (sts == LonApiNoError)
+	{
+		if (hStack == NULL)
+		{
+			LonEventPump();
+		}
+		else
+		{
+			LonCtxEventPump(hStack);
+		}
+	}
+	return sts;
+}
+
+double HarnessNowSecs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec/1e9;
+}
@@ -0,0 +1,75 @@
+/*
+ * DeviceHarness.h
+ *
+ * Copyright © 2022 Dialog Semiconductor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Description: The IzoT test device shared by the example check and benchmark
+ *  programs.
+ *
+ *  Each program describes its device with a HarnessDevice; the interface
+ *  and control data are filled in from it, so the devices differ only in
+ *  what the programs need.  A device runs on the loopback address, either
+ *  as the default stack through the legacy API or on a stack handle of its
+ *  own.
+ */
+
+#ifndef DEVICE_HARNESS_H
+#define DEVICE_HARNESS_H
+
+#include "FtxlApi.h"
+
+typedef struct
+{
+	const char*	szName;				// goes into the self-documentation string
+	LonByte		model;				// last byte of the program ID and signature
+	unsigned	nvCount;			// static NVs; the NV table holds just these
+	unsigned	addressCount;		// address table entries
+	unsigned	aliasCount;
+	unsigned	priorityOutCount;	// application output buffers
+	unsigned	nonPriorityOutCount;
+} HarnessDevice;
+
+//
+// Create the stack of a device.  With phStack NULL it is the default
+// stack, and pCallbacks is ignored; otherwise a new handle with the given
+// callbacks, or none if pCallbacks is NULL, is returned in *phStack.  The
+// NVD folder is created if it doesn't exist.
+//
+LonApiError HarnessCreateStack(LonStackHandle* phStack, const LonCtxCallbacks* pCallbacks,
+							   const HarnessDevice* pDevice, const LonUniqueId* pUid,
+							   int port, const char* nvdFolder);
+
+//
+// Register a two byte static NV.  hStack is NULL for the default stack.
+//
+LonApiError HarnessRegisterNv(LonStackHandle hStack, LonByte* pValue, const char* szName, unsigned flags);
+
+//
+// Start the stack, and let it report the lost persistence of a new NVD
+// folder, which takes the node unconfigured, before the program
+// configures it.
+//
+LonApiError HarnessStartStack(LonStackHandle hStack);
+
+// Monotonic time, in seconds
+double HarnessNowSecs();
+
+#endif // DEVICE_HARNESS_H
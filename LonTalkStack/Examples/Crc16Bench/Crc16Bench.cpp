@@ -0,0 +1,220 @@
+/*
+ * Crc16Bench.cpp
+ *
+ * Copyright © 2022 Dialog Semiconductor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in 
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * Description: LtCRC16 slicing check and benchmark.
+ *
+ *  The program checks LtCRC16Compute against a bit at a time reference of
+ *  the same CRC (polynomial 0x1021, preset 0xFFFF, result inverted) over
+ *  random buffers of every length up to MAX_LEN and every start alignment
+ *  up to 7, so both the eight byte steps and the byte remainder are covered.
+ *  It also checks that LtCRC16Verify accepts what LtCRC16 stores and rejects
+ *  a single bit error.
+ *
+ *  It then times the reference, the byte at a time table loop LtCRC16Compute
+ *  used to be, and LtCRC16Compute itself over packet sized and larger
+ *  buffers, and prints each rate in MB/s.
+ *
+ *  Usage: Crc16Bench [seed]
+ *  Exits non-zero if any CRC differs from the reference.
+ */
+
+#include "LtStackInternal.h"
+#include "LtCUtil.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#define MAX_LEN			600			// longest buffer checked
+#define BENCH_BYTES		(64*1024*1024)
+
+static double nowSecs()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec/1e6;
+}
+
+//
+// The CRC computed one bit at a time, straight from the polynomial.
+//
+static unsigned short crcBitwise(const byte* p, int len)
+{
+	unsigned int crc = 0xFFFF;
+
+	while (len-- > 0)
+	{
+		crc ^= *p++ << 8;
+		for (int i = 0; i < 8; i++)
+		{
+			crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+		}
+		crc &= 0xFFFF;
+	}
+	return (unsigned short)(~crc & 0xFFFF);
+}
+
+//
+// The byte at a time table loop, with the table built from the reference.
+//
+static unsigned short crcTable[256];
+
+static void crcTableInit()
+{
+	for (int b = 0; b < 256; b++)
+	{
+		unsigned int crc = b << 8;
+		for (int i = 0; i < 8; i++)
+		{
+			crc = (crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1);
+		}
+		crcTable[b] = (unsigned short)(crc & 0xFFFF);
+	}
+}
+
+static unsigned short crcBytewise(const byte* p, int len)
+{
+	unsigned int crc = 0xFFFF;
+
+	while (len-- > 0)
+	{
+		crc = ((crc << 8) & 0xFFFF) ^ crcTable[(byte)(crc >> 8) ^ *p++];
+	}
+	return (unsigned short)(~crc & 0xFFFF);
+}
+
+static int nFailures = 0;
+
+static void failed(const char* what, int len, int align, unsigned exp, unsigned got)
+{
+	if (nFailures++ < 10)
+	{
+		printf("FAIL: %s, length %d alignment %d: expected 0x%04X got 0x%04X\n",
+			   what, len, align, exp, got);
+	}
+}
+
+static void checkAll(byte* pBuf)
+{
+	for (int align = 0; align < 8; align++)
+	{
+		for (int len = 0; len <= MAX_LEN; len++)
+		{
+			byte* p = pBuf + align;
+			for (int i = 0; i < len + 2; i++)
+			{
+				p[i] = (byte)rand();
+			}
+
+			unsigned exp = crcBitwise(p, len);
+			unsigned got = LtCRC16Compute(p, len);
+			if (got != exp)
+			{
+				failed("LtCRC16Compute", len, align, exp, got);
+			}
+			got = crcBytewise(p, len);
+			if (got != exp)
+			{
+				failed("byte table", len, align, exp, got);
+			}
+
+			LtCRC16(p, len);
+			got = (p[len] << 8) | p[len + 1];
+			if (got != exp)
+			{
+				failed("LtCRC16", len, align, exp, got);
+			}
+			if (!LtCRC16Verify(p, len))
+			{
+				failed("LtCRC16Verify of a good CRC", len, align, exp, got);
+			}
+			int bit = rand() % ((len + 2) * 8);
+			p[bit / 8] ^= 1 << (bit % 8);
+			if (LtCRC16Verify(p, len))
+			{
+				failed("LtCRC16Verify of a bit error", len, align, exp, got);
+			}
+		}
+	}
+}
+
+typedef unsigned short (*CrcFn)(const byte* p, int len);
+
+static unsigned short crcStack(const byte* p, int len)
+{
+	return LtCRC16Compute(p, len);
+}
+
+static volatile unsigned short crcSink;
+
+static void bench(const char* name, CrcFn fn, const byte* pBuf, int len)
+{
+	int nIter = BENCH_BYTES / len;
+
+	// The bit at a time reference is slow; give it less to do.
+	if (fn == crcBitwise)
+	{
+		nIter /= 8;
+	}
+	double start = nowSecs();
+	for (int i = 0; i < nIter; i++)
+	{
+		crcSink = fn(pBuf, len);
+	}
+	double secs = nowSecs() - start;
+	printf("  %-16s %5d bytes  %8.1f MB/s\n", name, len, (double)nIter * len / secs / 1e6);
+}
+
+int main(int argc, char* argv[])
+{
+	static byte buf[MAX_LEN + 16];
+	static const int benchLens[] = { 16, 64, 256, 1500, 65536 };
+
+	srand(argc > 1 ? atoi(argv[1]) : 1);
+	crcTableInit();
+
+	checkAll(buf);
+	if (nFailures != 0)
+	{
+		printf("FAIL: %d CRCs differ from the reference\n", nFailures);
+		return 1;
+	}
+	printf("All lengths 0 to %d at alignments 0 to 7 match the reference\n", MAX_LEN);
+
+	byte* pBench = (byte*)malloc(65536);
+	for (int i = 0; i < 65536; i++)
+	{
+		pBench[i] = (byte)rand();
+	}
+	for (unsigned i = 0; i < sizeof(benchLens)/sizeof(benchLens[0]); i++)
+	{
+		bench("bit at a time", crcBitwise, pBench, benchLens[i]);
+		bench("byte table", crcBytewise, pBench, benchLens[i]);
+		bench("LtCRC16Compute", crcStack, pBench, benchLens[i]);
+	}
+	free(pBench);
+
+	printf("PASS\n");
+	return 0;
+}
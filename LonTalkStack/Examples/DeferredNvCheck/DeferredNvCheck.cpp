@@ -0,0 +1,338 @@
+/*
+ * DeferredNvCheck.cpp
+ *
+ * Copyright © 2022 Dialog Semiconductor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in 
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * Description: Deferred NV update queue depth and peak check.
+ *
+ *  Part one fills an LtNvMap, the two-level bitmap that records deferred
+ *  propagates and polls, with a burst of pending NVs, and drains it with
+ *  getNextBatch() as LtDeviceStack::doNvUpdates() does.  It checks that
+ *  each pending NV is taken exactly once, in round robin order from the
+ *  first one set, and that getCount() and getPeakCount() give the depth
+ *  and the peak at every step.  Bits are spread over more than one summary
+ *  word, and a second burst is set while the first one drains.
+ *
+ *  Part two runs one IzoT device with one non-priority output buffer and
+ *  NV_COUNT bound output NVs, and propagates them all at once.  The stack
+ *  defers those it has no buffer for, and drains them as buffers are
+ *  released.  The test checks LtDeviceStack::getDeferredNvStats() before
+ *  and after the drain: the peak covers the depth seen after the burst,
+ *  the depth falls to 0, every update completes, and clearing the peak
+ *  resets it to the depth.
+ *
+ *  Usage: DeferredNvCheck [port [nvd-folder]]
+ *  Exits non-zero if a check fails.
+ */
+
+#include "LtStackInternal.h"
+#include "FtxlStack.h"
+#include "FtxlApi.h"
+#include "DeviceHarness.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAP_NV_COUNT	3000		// NVs in the part one bitmap
+#define MAP_BURST		700			// pending NVs set in one burst
+#define MAP_BATCH		16			// NVs taken per getNextBatch()
+#define NV_COUNT		64			// output NVs on the part two device
+#define DEVICE_PORT		28020
+#define NVD_FOLDER		"/tmp/DeferredNvCheck"
+#define DRAIN_TIMEOUT	5000		// milliseconds to wait for the drain
+
+static int nFailures = 0;
+
+static void check(bool bOk, const char* what)
+{
+	if (!bOk)
+	{
+		printf("FAIL: %s\n", what);
+		nFailures++;
+	}
+}
+
+//
+// Part one: the bitmap on its own.
+//
+static boolean pendingBits[MAP_NV_COUNT*2];
+
+// The bit the round robin drain should take after the bit last, with the
+// bitmap holding exactly the bits in pendingBits.
+static int nextPending(int last)
+{
+	for (int i = last + 1; i < MAP_NV_COUNT*2; i++)
+	{
+		if (pendingBits[i])
+			return i;
+	}
+	for (int i = 0; i <= last; i++)
+	{
+		if (pendingBits[i])
+			return i;
+	}
+	return -1;
+}
+
+static int setBurst(LtNvMap& map, int nBits, boolean bPolls, int& first)
+{
+	int nSet = 0;
+
+	for (int i = 0; i < nBits; i++)
+	{
+		int index = rand() % MAP_NV_COUNT;
+		boolean poll = bPolls && (rand() & 1);
+		int bit = index*2 + (poll ? 1 : 0);
+
+		map.set(poll, index);
+		if (!pendingBits[bit])
+		{
+			if (first == -1)
+				first = bit;
+			pendingBits[bit] = TRUE;
+			nSet++;
+		}
+	}
+	return nSet;
+}
+
+static void checkMap()
+{
+	LtNvMap map;
+	int first = -1;
+	int nPending, peak;
+	int nTaken = 0;
+	bool bSecond = false;
+	bool bOrdered = true;
+	int expected;
+
+	map.setSize(MAP_NV_COUNT);
+	srand(1);
+	nPending = setBurst(map, MAP_BURST, TRUE, first);
+	peak = nPending;
+	check(map.getCount() == nPending, "bitmap depth after the burst");
+	check(map.getPeakCount() == nPending, "bitmap peak after the burst");
+
+	// The drain starts at the first bit set and goes round from there.
+	expected = first;
+	while (map.getCount() != 0)
+	{
+		int indices[MAP_BATCH];
+		boolean polls[MAP_BATCH];
+		int n = map.getNextBatch(indices, polls, MAP_BATCH);
+
+		for (int i = 0; i < n; i++)
+		{
+			int bit = indices[i]*2 + (polls[i] ? 1 : 0);
+
+			if (bit != expected)
+			{
+				bOrdered = false;
+			}
+			pendingBits[bit] = FALSE;
+			nPending--;
+			nTaken++;
+			expected = nextPending(bit);
+		}
+		check(map.getCount() == nPending, "bitmap depth while draining");
+
+		// Half way through, set a second burst on both sides of the drain
+		// position.
+		if (!bSecond && nTaken >= peak/2)
+		{
+			int unused = 0;
+
+			bSecond = true;
+			nPending += setBurst(map, MAP_BURST/4, FALSE, unused);
+			expected = nextPending(expected - 1);
+			if (nPending > peak)
+			{
+				peak = nPending;
+			}
+			check(map.getCount() == nPending, "bitmap depth after the second burst");
+		}
+	}
+	check(bOrdered, "bitmap drain order");
+	check(nPending == 0, "bitmap drain left NVs pending");
+	check(map.getPeakCount(TRUE) == peak, "bitmap peak after the drain");
+	check(map.getPeakCount() == 0, "bitmap peak after clearing");
+	printf("bitmap: %d pending NVs drained, peak %d\n", nTaken, peak);
+}
+
+//
+// Part two: deferred updates on a running device.
+//
+static const HarnessDevice device = {
+	"DeferredNvCheck",
+	0x15,						// model
+	NV_COUNT,					// static NVs
+	15,							// address table entries
+	0,							// aliases
+	1, 1						// priority and non-priority output buffers
+};
+
+static LonStackHandle hStack;
+static LonUniqueId uid = { 0x00, 0xD0, 0x71, 0x40, 0x10, 0x03 };
+static LonByte nvValues[NV_COUNT][2];
+static char nvNames[NV_COUNT][16];
+static volatile int nCompleted;
+
+static void myNvUpdateCompleted(void* pUserContext, const unsigned index, const LonBool success)
+{
+	nCompleted++;
+}
+
+static LonApiError createStack(int port, const char* nvdFolder)
+{
+	LonCtxCallbacks callbacks;
+	LonApiError sts;
+
+	memset(&callbacks, 0, sizeof(callbacks));
+	callbacks.nvUpdateCompleted = myNvUpdateCompleted;
+
+	sts = HarnessCreateStack(&hStack, &callbacks, &device, &uid, port, nvdFolder);
+	for (int i = 0; sts == LonApiNoError && i < NV_COUNT; i++)
+	{
+		sprintf(nvNames[i], "nvoValue%d", i);
+		sts = HarnessRegisterNv(hStack, nvValues[i], nvNames[i], LON_NV_IS_OUTPUT | LON_NV_SERVICE_CONFIG);
+	}
+	if (sts == LonApiNoError)
+		sts = HarnessStartStack(hStack);
+	return sts;
+}
+
+//
+// Bind every output NV, unacknowledged, to subnet 2 node 5 and take the
+// device online.
+//
+static LonApiError configureStack()
+{
+	LonDomain domain;
+	LonAddress address;
+	LonApiError sts;
+
+	sts = LonCtxQueryDomainConfig(hStack, 0, &domain);
+	if (sts == LonApiNoError)
+	{
+		domain.Id[0] = 0x5A;
+		LON_SET_ATTRIBUTE(domain, LON_DOMAIN_ID_LENGTH, 1);
+		domain.Subnet = 1;
+		LON_SET_ATTRIBUTE(domain, LON_DOMAIN_NODE, 1);
+		LON_SET_ATTRIBUTE(domain, LON_DOMAIN_INVALID, 0);
+		sts = LonCtxUpdateDomainConfig(hStack, 0, &domain);
+	}
+	if (sts == LonApiNoError)
+	{
+		memset(&address, 0, sizeof(address));
+		address.SubnetNode.Type = LonAddressSubnetNode;
+		LON_SET_ATTRIBUTE(address.SubnetNode, LON_ADDRESS_SN_NODE, 5);
+		address.SubnetNode.TransmitTimer = LonTx16;
+		address.SubnetNode.Subnet = 2;
+		sts = LonCtxUpdateAddressConfig(hStack, 0, &address);
+	}
+	for (int i = 0; sts == LonApiNoError && i < NV_COUNT; i++)
+	{
+		LonNvEcsConfig nvc;
+
+		sts = LonCtxQueryNvConfig(hStack, i, &nvc);
+		if (sts == LonApiNoError)
+		{
+			LON_SET_ATTRIBUTE(nvc, LON_NV_ECS_SELHIGH, 0x10);
+			nvc.SelectorLow = (LonByte)i;
+			LON_SET_ATTRIBUTE(nvc, LON_NV_ECS_SERVICE, LonServiceUnacknowledged);
+			LON_SET_UNSIGNED_WORD(nvc.AddressIndex, 0);
+			sts = LonCtxUpdateNvConfig(hStack, i, &nvc);
+		}
+	}
+	if (sts == LonApiNoError)
+		sts = LonCtxSetNodeMode(hStack, LonChangeState, LonConfigOnLine);
+	if (sts == LonApiNoError)
+		sts = LonCtxSetNodeMode(hStack, LonApplicationOnLine, LonStateInvalid);
+	return sts;
+}
+
+static void checkDevice(int port, const char* nvdFolder)
+{
+	int type = LtMisc::getPriorityType(FALSE);
+	LtDeviceStack* pStack;
+	int depth, peak, burstDepth;
+	int nPropagated = 0;
+	LonApiError sts;
+
+	sts = createStack(port, nvdFolder);
+	if (sts == LonApiNoError)
+	{
+		sts = configureStack();
+	}
+	if (sts != LonApiNoError)
+	{
+		printf("FAIL: stack setup failed with %d\n", sts);
+		nFailures++;
+		return;
+	}
+	pStack = hStack->pStack;
+	pStack->getDeferredNvStats(type, depth, peak, TRUE);
+	check(depth == 0 && peak == 0, "device queue empty before the burst");
+
+	for (int i = 0; i < NV_COUNT; i++)
+	{
+		nvValues[i][1] = (LonByte)i;
+		nPropagated += LonCtxPropagateNv(hStack, i) == LonApiNoError;
+	}
+	pStack->getDeferredNvStats(type, burstDepth, peak);
+	check(nPropagated == NV_COUNT, "propagate failed");
+	check(peak > 0, "no update was deferred");
+	check(peak >= burstDepth && peak < NV_COUNT, "device peak after the burst");
+
+	for (int ms = 0; ms < DRAIN_TIMEOUT && nCompleted < NV_COUNT; ms++)
+	{
+		LonCtxEventPump(hStack);
+		usleep(1000);
+	}
+	pStack->getDeferredNvStats(type, depth, peak, TRUE);
+	printf("device: %d updates, %d deferred after the burst, peak %d, %d completed\n",
+		   NV_COUNT, burstDepth, peak, nCompleted);
+	check(nCompleted == NV_COUNT, "device updates lost");
+	check(depth == 0, "device queue not drained");
+	check(peak >= burstDepth, "device peak after the drain");
+	pStack->getDeferredNvStats(type, depth, peak);
+	check(peak == depth, "device peak after clearing");
+
+	LonCtxFreeHandle(hStack);
+}
+
+int main(int argc, char* argv[])
+{
+	int port = argc > 1 ? atoi(argv[1]) : DEVICE_PORT;
+	const char* nvdFolder = argc > 2 ? argv[2] : NVD_FOLDER;
+
+	checkMap();
+	checkDevice(port, nvdFolder);
+
+	if (nFailures != 0)
+	{
+		return 1;
+	}
+	printf("PASS\n");
+	return 0;
+}
@@ -0,0 +1,375 @@
+/*
+ * EventFdLatency.cpp
+ *
+ * Copyright © 2022 Dialog Semiconductor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in 
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * Description: Event delivery latency, callback plus pump against eventfd.
+ *
+ *  The program runs one IzoT device on the loopback interface with an
+ *  acknowledged output NV bound to a subnet/node address that no device
+ *  answers, with no retries.  Each propagate therefore fails when the
+ *  transmit timer expires, and the stack's own timer thread reports the
+ *  completion event while the application thread waits for it.  The time
+ *  from the LonEventReady callback to the LonNvUpdateCompleted callback is
+ *  measured ITERATIONS times for each way of waiting:
+ *
+ *  - callback: the LonEventReady callback writes to a pipe, the application
+ *    thread polls the pipe and calls LonCtxEventPump().  This is the hop
+ *    an application has to add without the event descriptor.
+ *  - eventfd: the application thread polls the descriptor from
+ *    LonCtxGetEventFd() and calls LonCtxEventPumpEx() until it returns
+ *    FALSE.  The callback only takes the time.
+ *
+ *  The stack signals the descriptor just before it calls LonEventReady, so
+ *  in eventfd mode the application can finish pumping before the callback
+ *  has taken the time.  Such rounds count as zero, and are reported as
+ *  "early".  The callback mode runs first, since the stack only signals the
+ *  descriptor once it has been asked for.
+ *
+ *  Usage: EventFdLatency [iterations [port [nvd-folder]]]
+ *  Prints the minimum, median, 99th percentile and maximum latency of each
+ *  mode, in microseconds.  Exits non-zero if a completion is not delivered.
+ */
+
+#include "FtxlApi.h"
+#include "DeviceHarness.h"
+
+#include <algorithm>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define ITERATIONS		500
+#define WARMUP			20			// iterations not measured
+#define DEVICE_PORT		28000
+#define NVD_FOLDER		"/tmp/EventFdLatency"
+#define NVO_INDEX		0
+#define PUMP_BUDGET		8			// APDUs per LonCtxEventPumpEx() call
+#define POLL_TIMEOUT	2000		// milliseconds to wait for one completion
+#define SIGNAL_TIMEOUT	100000		// microseconds to wait for LonEventReady
+
+static const HarnessDevice device = {
+	"EventFdLatency",
+	0x13,						// model
+	1,							// static NVs
+	15,							// address table entries
+	0,							// aliases
+	1, 5						// priority and non-priority output buffers
+};
+
+typedef enum
+{
+	MODE_CALLBACK,
+	MODE_EVENTFD
+} WaitMode;
+
+static LonStackHandle hStack;
+static LonUniqueId uid = { 0x00, 0xD0, 0x71, 0x40, 0x10, 0x01 };
+static LonByte nvo[2];
+static volatile WaitMode mode = MODE_CALLBACK;
+static int pipeFds[2] = { -1, -1 };
+static volatile double signalTime;		// first LonEventReady of the round
+static volatile int nCompleted;
+static volatile int nSucceeded;
+static double completedTime;
+
+static double nowUsecs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec*1e6 + ts.tv_nsec/1e3;
+}
+
+static void myEventReady(void* pUserContext)
+{
+	if (signalTime == 0)
+	{
+		signalTime = nowUsecs();
+	}
+	if (mode == MODE_CALLBACK)
+	{
+		char c = 1;
+		if (write(pipeFds[1], &c, 1) < 0)
+		{
+			// The pipe is full, so the application thread is awake already.
+		}
+	}
+}
+
+static void myNvUpdateCompleted(void* pUserContext, const unsigned index, const LonBool success)
+{
+	if (index == NVO_INDEX)
+	{
+		completedTime = nowUsecs();
+		nCompleted++;
+		if (success)
+		{
+			nSucceeded++;
+		}
+	}
+}
+
+static LonApiError createStack(int port, const char* nvdFolder)
+{
+	LonCtxCallbacks callbacks;
+	LonApiError sts;
+
+	memset(&callbacks, 0, sizeof(callbacks));
+	callbacks.eventReady = myEventReady;
+	callbacks.nvUpdateCompleted = myNvUpdateCompleted;
+
+	sts = HarnessCreateStack(&hStack, &callbacks, &device, &uid, port, nvdFolder);
+	if (sts == LonApiNoError)
+		sts = HarnessRegisterNv(hStack, nvo, "nvoValue", LON_NV_IS_OUTPUT | LON_NV_ACKD | LON_NV_SERVICE_CONFIG);
+	if (sts == LonApiNoError)
+		sts = HarnessStartStack(hStack);
+	return sts;
+}
+
+//
+// Bind the output NV to subnet 2 node 5, which nobody answers for, with no
+// retries and the shortest transmit timer, and take the device online.
+//
+static LonApiError configureStack()
+{
+	LonDomain domain;
+	LonAddress address;
+	LonNvEcsConfig nvc;
+	LonApiError sts;
+
+	sts = LonCtxQueryDomainConfig(hStack, 0, &domain);
+	if (sts == LonApiNoError)
+	{
+		domain.Id[0] = 0x5A;
+		LON_SET_ATTRIBUTE(domain, LON_DOMAIN_ID_LENGTH, 1);
+		domain.Subnet = 1;
+		LON_SET_ATTRIBUTE(domain, LON_DOMAIN_NODE, 1);
+		LON_SET_ATTRIBUTE(domain, LON_DOMAIN_INVALID, 0);
+		sts = LonCtxUpdateDomainConfig(hStack, 0, &domain);
+	}
+	if (sts == LonApiNoError)
+	{
+		memset(&address, 0, sizeof(address));
+		address.SubnetNode.Type = LonAddressSubnetNode;
+		LON_SET_ATTRIBUTE(address.SubnetNode, LON_ADDRESS_SN_NODE, 5);
+		LON_SET_ATTRIBUTE(address.SubnetNode, LON_ADDRESS_SN_RETRY, 0);
+		address.SubnetNode.TransmitTimer = LonTx16;
+		address.SubnetNode.Subnet = 2;
+		sts = LonCtxUpdateAddressConfig(hStack, 0, &address);
+	}
+	if (sts == LonApiNoError)
+		sts = LonCtxQueryNvConfig(hStack, NVO_INDEX, &nvc);
+	if (sts == LonApiNoError)
+	{
+		LON_SET_ATTRIBUTE(nvc, LON_NV_ECS_SELHIGH, 0x10);
+		nvc.SelectorLow = 0x00;
+		LON_SET_UNSIGNED_WORD(nvc.AddressIndex, 0);
+		sts = LonCtxUpdateNvConfig(hStack, NVO_INDEX, &nvc);
+	}
+	if (sts == LonApiNoError)
+		sts = LonCtxSetNodeMode(hStack, LonChangeState, LonConfigOnLine);
+	if (sts == LonApiNoError)
+		sts = LonCtxSetNodeMode(hStack, LonApplicationOnLine, LonStateInvalid);
+	return sts;
+}
+
+//
+// Wait for the stack to report events the way the mode says, and pump them.
+// Returns false on a timeout.
+//
+static bool waitAndPump(int eventFd)
+{
+	struct pollfd pfd;
+
+	pfd.fd = mode == MODE_CALLBACK ? pipeFds[0] : eventFd;
+	pfd.events = POLLIN;
+	if (poll(&pfd, 1, POLL_TIMEOUT) <= 0)
+	{
+		return false;
+	}
+	if (mode == MODE_CALLBACK)
+	{
+		char buf[64];
+		while (read(pipeFds[0], buf, sizeof(buf)) > 0)
+		{
+		}
+		LonCtxEventPump(hStack);
+	}
+	else
+	{
+		while (LonCtxEventPumpEx(hStack, PUMP_BUDGET))
+		{
+		}
+	}
+	return true;
+}
+
+//
+// Propagate the output NV WARMUP+iterations times and return the latencies
+// of the measured ones in pSamples, and the number of them that completed
+// before the LonEventReady callback in pEarly.  Returns the number of
+// completions lost.
+//
+static int measure(int iterations, int eventFd, double* pSamples, int* pEarly)
+{
+	int nLost = 0;
+
+	for (int i = 0; i < WARMUP + iterations; i++)
+	{
+		int nBefore = nCompleted;
+
+		nvo[0] = (LonByte)(i >> 8);
+		nvo[1] = (LonByte)i;
+		signalTime = 0;
+		if (LonCtxPropagateNv(hStack, NVO_INDEX) != LonApiNoError)
+		{
+			nLost++;
+			continue;
+		}
+		while (nCompleted == nBefore && waitAndPump(eventFd))
+		{
+		}
+		if (nCompleted != nBefore + 1)
+		{
+			nLost++;
+		}
+		else if (i >= WARMUP)
+		{
+			double deadline = nowUsecs() + SIGNAL_TIMEOUT;
+			while (signalTime == 0 && nowUsecs() < deadline)
+			{
+				usleep(10);
+			}
+			if (signalTime == 0)
+			{
+				nLost++;
+			}
+			else if (completedTime <= signalTime)
+			{
+				pSamples[i - WARMUP] = 0;
+				(*pEarly)++;
+			}
+			else
+			{
+				pSamples[i - WARMUP] = completedTime - signalTime;
+			}
+		}
+	}
+	return nLost;
+}
+
+static void report(const char* name, double* pSamples, int n, int nEarly)
+{
+	std::sort(pSamples, pSamples + n);
+	printf("%-10s min %7.1f  median %7.1f  p99 %7.1f  max %8.1f us  early %d\n", name, 
+		   pSamples[0], pSamples[n/2], pSamples[(n*99)/100], pSamples[n-1], nEarly);
+}
+
+int main(int argc, char* argv[])
+{
+	int iterations = argc > 1 ? atoi(argv[1]) : ITERATIONS;
+	int port = argc > 2 ? atoi(argv[2]) : DEVICE_PORT;
+	const char* nvdFolder = argc > 3 ? argv[3] : NVD_FOLDER;
+	double* pCallback = (double*)calloc(iterations > 0 ? iterations : 1, sizeof(double));
+	double* pEventFd = (double*)calloc(iterations > 0 ? iterations : 1, sizeof(double));
+	int eventFd = -1;
+	int nCallbackEarly = 0;
+	int nEventFdEarly = 0;
+	int nFailures = 0;
+	LonApiError sts;
+
+	if (iterations <= 0 || pipe(pipeFds) != 0)
+	{
+		printf("FAIL: bad arguments or no pipe\n");
+		return 1;
+	}
+	fcntl(pipeFds[0], F_SETFL, O_NONBLOCK);
+	fcntl(pipeFds[1], F_SETFL, O_NONBLOCK);
+
+	sts = createStack(port, nvdFolder);
+	if (sts == LonApiNoError)
+	{
+		sts = configureStack();
+	}
+	if (sts != LonApiNoError)
+	{
+		printf("FAIL: stack setup failed with %d\n", sts);
+		nFailures++;
+	}
+
+	if (nFailures == 0)
+	{
+		int nLost;
+
+		mode = MODE_CALLBACK;
+		nLost = measure(iterations, eventFd, pCallback, &nCallbackEarly);
+		if (nLost != 0)
+		{
+			printf("FAIL: callback: %d completions lost\n", nLost);
+			nFailures++;
+		}
+
+		if (LonCtxGetEventFd(hStack, &eventFd) != LonApiNoError)
+		{
+			printf("FAIL: LonCtxGetEventFd\n");
+			nFailures++;
+		}
+		else
+		{
+			mode = MODE_EVENTFD;
+			nLost = measure(iterations, eventFd, pEventFd, &nEventFdEarly);
+			if (nLost != 0)
+			{
+				printf("FAIL: eventfd: %d completions lost\n", nLost);
+				nFailures++;
+			}
+		}
+		if (nSucceeded != 0)
+		{
+			printf("FAIL: %d updates to an absent node succeeded\n", nSucceeded);
+			nFailures++;
+		}
+	}
+
+	if (nFailures == 0)
+	{
+		report("callback", pCallback, iterations, nCallbackEarly);
+		report("eventfd", pEventFd, iterations, nEventFdEarly);
+	}
+
+	if (hStack != NULL)
+	{
+		LonCtxFreeHandle(hStack);
+	}
+	free(pCallback);
+	free(pEventFd);
+
+	if (nFailures != 0)
+	{
+		return 1;
+	}
+	printf("PASS\n");
+	return 0;
+}
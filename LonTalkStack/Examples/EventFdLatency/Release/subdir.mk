@@ -0,0 +1,23 @@
+################################################################################
+# Automatically-generated file. Do not edit!
+################################################################################
+
+# Add inputs and outputs from these tool invocations to the build variables 
+CPP_SRCS += \
+../EventFdLatency.cpp 
+
+OBJS += \
+./EventFdLatency.o 
+
+CPP_DEPS += \
+./EventFdLatency.d 
+
+
+# Each subdirectory must supply rules for building sources it contributes
+%.o: ../%.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: Cross G++ Compiler'
+	arm-linux-gnueabihf-g++ -DIZOT_PLATFORM -DNDEBUG -I../../../Source/LonLinkIzoT/include -I../../../Source/Lre/include -I../../../Source/Shared/include -I../../../Source/ShareIp/include -I../../../Source/Stack/include -I../../../Source/VxLayer/include -I../../../Source/Target/include -I../../../Source/Target/Drivers/Linux/SMIP/include -I../../../Templates -I../../../Source/FtxlApi/include -I../../../Source/Pa/include -I../../Common -O3 -Wall -c -fmessage-length=0 -pthread -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@:%.o=%.d)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
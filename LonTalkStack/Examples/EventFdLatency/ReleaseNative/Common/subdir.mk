@@ -0,0 +1,24 @@
+################################################################################
+# Automatically-generated file. Do not edit!
+################################################################################
+
+# Add inputs and outputs from these tool invocations to the build variables 
+CPP_SRCS += \
+../../Common/DeviceHarness.cpp 
+
+OBJS += \
+./Common/DeviceHarness.o 
+
+CPP_DEPS += \
+./Common/DeviceHarness.d 
+
+
+# Each subdirectory must supply rules for building sources it contributes
+Common/%.o: ../../Common/%.cpp
+	@echo 'Building file: $<'
+	@echo 'Invoking: GCC C++ Compiler'
+	g++ -DIZOT_PLATFORM -DLINUX32_GCC=1 -DNDEBUG -I../../../Source/LonLinkIzoT/include -I../../../Source/Lre/include -I../../../Source/Shared/include -I../../../Source/ShareIp/include -I../../../Source/Stack/include -I../../../Source/VxLayer/include -I../../../Source/Target/include -I../../../Source/Target/Drivers/Linux/SMIP/include -I../../../Templates -I../../../Source/FtxlApi/include -I../../../Source/Pa/include -I../../Common -O3 -Wall -c -fmessage-length=0 -pthread -MMD -MP -MF"$(@:%.o=%.d)" -MT"$(@:%.o=%.d)" -o "$@" "$<"
+	@echo 'Finished building: $<'
+	@echo ' '
+
+
@@ -0,0 +1,319 @@
+/*
+ * GroupMapCheck.cpp
+ *
+ * Copyright © 2022 Dialog Semiconductor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in 
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * Description: Concurrency check and benchmark of the address table group maps.
+ *
+ *  LtAddressConfigurationTable::get(domainIndex, group) and getGroups()
+ *  index the LtGroupMap of a domain without the table lock, while set()
+ *  moves entries in and out of the maps under it and grows the
+ *  LtGroupMapSet, retiring the old one, as new domain indices appear.
+ *  This program runs reader tasks against a writer task that keeps
+ *  rebinding the upper part of the table, over a growing number of
+ *  domains, to normal and output only groups and to nothing.  It uses few
+ *  groups, so entries often share one and the slot moves between them:
+ *
+ *  - the lower entries are never changed, so their groups must always be
+ *  found, with that entry, by get() and by getGroups(), however the
+ *  upper entries move;
+ *  - whatever get() returns must be an entry of the table;
+ *  - after each set(), the groups the entry left and joined must agree
+ *  with a scan of the table for the lowest numbered entry that receives
+ *  on the group;
+ *  - once the writer stops, every get() and getGroups() must agree with
+ *  such a scan.
+ *
+ *  It reports lookups per second with the writer idle and busy, and
+ *  against the same lookups made under the table lock.
+ *
+ *  Usage: GroupMapCheck [seconds [readers]]
+ *  Exits non-zero if any check fails.
+ */
+
+#include "LtStackInternal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+
+#define SECONDS			2
+#define MAX_READERS		8
+#define ENTRIES			15
+#define FIXED			4			// entries 0..FIXED-1 are never changed
+#define MAX_DOMAINS		8
+#define CHURN_GROUPS	8			// the writer uses groups 0..CHURN_GROUPS-1
+#define TASK_PRIORITY	100
+#define TASK_STACK		32768
+
+static int nFailures = 0;
+
+static void check(int bOk, const char* what, long n = 0)
+{
+	if (!bOk && nFailures++ < 20)
+	{
+		printf("FAIL: %s (%ld)\n", what, n);
+	}
+}
+
+static double nowSecs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec/1e9;
+}
+
+static LtAddressConfigurationTable* pTable;
+static volatile int bStop;
+static volatile int bWriterBusy;
+static volatile int bLocked;
+static volatile int nDone;
+static volatile long nWrites;
+static long nLookups[MAX_READERS];
+
+// The fixed entries are in domain 0, groups 1 to FIXED.
+static int fixedGroup(int index)
+{
+	return index + 1;
+}
+
+//
+// The lowest numbered entry that receives on a group, by scanning the
+// table.  Returns -1 if there is none.
+//
+static int scanGroup(int domainIndex, int group)
+{
+	for (int i = 0; i < ENTRIES; i++)
+	{
+		LtAddressConfiguration ac;
+		pTable->get(i, &ac);
+		if (ac.getAddressType() == LT_AT_GROUP && ac.getRestrictions() != LT_GRP_OUTPUT_ONLY &&
+			ac.getDomainIndex() == domainIndex && ac.getGroup() == group)
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+//
+// Check that the group map agrees with a scan of the table for one group.
+// Only meaningful while no set() is in progress.
+//
+static void checkGroup(int domainIndex, int group)
+{
+	int index = scanGroup(domainIndex, group);
+	LtAddressConfiguration* pAc = pTable->get(domainIndex, group);
+	check(index == (pAc == null ? -1 : pAc->getIndex()), "get() disagrees with a scan of the table",
+		  domainIndex*1000 + group);
+}
+
+static void setGroup(int index, int domainIndex, int group, int restrictions)
+{
+	LtAddressConfiguration ac(LT_AT_GROUP, domainIndex, group);
+	ac.setRestrictions(restrictions);
+	ac.setSize(2);
+	check(pTable->set(index, ac) == LT_NO_ERROR, "set() failed", index);
+}
+
+static void setUnbound(int index)
+{
+	LtAddressConfiguration ac;
+	check(pTable->set(index, ac) == LT_NO_ERROR, "set() failed", index);
+}
+
+static int VXLCDECL writerTask(int arg, ...)
+{
+	unsigned int seed = 1;
+	int nDomains = 1;
+
+	while (!bStop)
+	{
+		if (!bWriterBusy)
+		{
+			taskDelay(1);
+			continue;
+		}
+		int index = FIXED + rand_r(&seed) % (ENTRIES - FIXED);
+		int action = rand_r(&seed) % 8;
+		LtAddressConfiguration old;
+		LtAddressConfiguration ac;
+
+		pTable->get(index, &old);
+
+		// A new domain index now and then, to grow the group map set
+		if (nDomains < MAX_DOMAINS && rand_r(&seed) % 4096 == 0)
+		{
+			nDomains++;
+		}
+		if (action == 0)
+		{
+			setUnbound(index);
+		}
+		else
+		{
+			setGroup(index, rand_r(&seed) % nDomains, rand_r(&seed) % CHURN_GROUPS,
+					 action == 1 ? LT_GRP_OUTPUT_ONLY : LT_GRP_NORMAL);
+		}
+
+		// This is the only writer, so the groups the entry left and joined
+		// must be right as soon as set() returns.
+		pTable->get(index, &ac);
+		checkGroup(old.getDomainIndex(), old.getGroup());
+		checkGroup(ac.getDomainIndex(), ac.getGroup());
+		nWrites++;
+	}
+	__sync_fetch_and_add(&nDone, 1);
+	return 0;
+}
+
+static int VXLCDECL readerTask(int reader, ...)
+{
+	unsigned int seed = reader + 100;
+	long n = 0;
+
+	while (!bStop)
+	{
+		int domainIndex = rand_r(&seed) % (MAX_DOMAINS + 1);
+		int group = rand_r(&seed) % LT_GROUPS_PER_DOMAIN;
+		LtAddressConfiguration* pAc;
+
+		if (bLocked)
+		{
+			pTable->lock();
+			pAc = pTable->get(domainIndex, group);
+			pTable->unlock();
+		}
+		else
+		{
+			pAc = pTable->get(domainIndex, group);
+		}
+		if (pAc != null)
+		{
+			int index = pAc->getIndex();
+			check(index >= 0 && index < ENTRIES, "get() returned something not in the table", index);
+		}
+
+		// The fixed entries must always be found
+		int fixed = rand_r(&seed) % FIXED;
+		pAc = pTable->get(0, fixedGroup(fixed));
+		check(pAc != null && pAc->getIndex() == fixed, "a fixed entry was not found", fixed);
+
+		if ((n & 63) == 0)
+		{
+			LtGroups groups;
+			pTable->getGroups(0, groups);
+			for (int i = 0; i < FIXED; i++)
+			{
+				check(groups.get(fixedGroup(i)), "getGroups() missed a fixed entry", i);
+			}
+		}
+		n += 2;
+	}
+	nLookups[reader] = n;
+	__sync_fetch_and_add(&nDone, 1);
+	return 0;
+}
+
+static void checkQuiescent()
+{
+	for (int d = 0; d <= MAX_DOMAINS; d++)
+	{
+		LtGroups groups;
+		pTable->getGroups(d, groups);
+		for (int g = 0; g < LT_GROUPS_PER_DOMAIN; g++)
+		{
+			int index = scanGroup(d, g);
+			checkGroup(d, g);
+			check((index != -1) == (groups.get(g) != 0), "getGroups() disagrees with a scan of the table", d*1000 + g);
+		}
+	}
+}
+
+static void run(const char* name, int bBusy, int bLock, int nReaders, int seconds)
+{
+	double start;
+	double elapsed;
+	long n = 0;
+	long writes = nWrites;
+
+	bWriterBusy = bBusy;
+	bLocked = bLock;
+	bStop = FALSE;
+	nDone = 0;
+	taskSpawn("GroupWriter", TASK_PRIORITY, 0, TASK_STACK, writerTask, 0, 0,0,0,0, 0,0,0,0,0);
+	start = nowSecs();
+	for (int i = 0; i < nReaders; i++)
+	{
+		taskSpawn("GroupReader", TASK_PRIORITY, 0, TASK_STACK, readerTask, i, 0,0,0,0, 0,0,0,0,0);
+	}
+	sleep(seconds);
+	bStop = TRUE;
+	while (nDone < nReaders + 1)
+	{
+		usleep(1000);
+	}
+	elapsed = nowSecs() - start;
+
+	for (int i = 0; i < nReaders; i++)
+	{
+		n += nLookups[i];
+	}
+	printf("%-22s %10.0f lookups/s  %8.0f sets/s\n", name, n/elapsed, (nWrites - writes)/elapsed);
+	checkQuiescent();
+}
+
+int main(int argc, char* argv[])
+{
+	int seconds = argc > 1 ? atoi(argv[1]) : SECONDS;
+	int nReaders = argc > 2 ? atoi(argv[2]) : 2;
+
+	if (seconds < 1 || nReaders < 1 || nReaders > MAX_READERS)
+	{
+		printf("FAIL: bad arguments\n");
+		return 1;
+	}
+
+	pTable = new LtAddressConfigurationTable();
+	pTable->setCount(NULL, ENTRIES);
+	for (int i = 0; i < FIXED; i++)
+	{
+		setGroup(i, 0, fixedGroup(i), LT_GRP_NORMAL);
+	}
+	checkQuiescent();
+
+	printf("%d readers, %d entries, %d fixed\n", nReaders, ENTRIES, FIXED);
+	run("lock-free, idle", FALSE, FALSE, nReaders, seconds);
+	run("lock-free, busy", TRUE, FALSE, nReaders, seconds);
+	run("locked, idle", FALSE, TRUE, nReaders, seconds);
+	run("locked, busy", TRUE, TRUE, nReaders, seconds);
+
+	delete pTable;
+
+	if (nFailures != 0)
+	{
+		printf("FAIL: %d checks failed\n", nFailures);
+		return 1;
+	}
+	printf("PASS\n");
+	return 0;
+}
@@ -0,0 +1,348 @@
+/*
+ * IsiConnTabCheck.cpp
+ *
+ * Copyright © 2022 Dialog Semiconductor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in 
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Description: Randomized check of the ISI connection table lookups.
+ *
+ *  The ISI enrollment handlers find connection table entries with
+ *  _IsiNextConnectionByCid() and _IsiNextConnectionBySelector() instead of
+ *  scanning the whole table.  This program fills a connection table of the
+ *  largest size ISI supports with random entries through IsiSetConnection()
+ *  and checks the lookups against a scan of the table:
+ *
+ *  - Stepping with _IsiNextConnectionByCid() visits exactly the pending and
+ *    in-use entries with the CID, in table order.
+ *  - Stepping with _IsiNextConnectionBySelector() visits only pending and
+ *    in-use entries, and visits each one that _IsiInSelectorRange() finds
+ *    overlapping, the way the CSMI handler tests it.  Entries with a width
+ *    of 0 and ranges that wrap at 0xFFFF are included.
+ *  - A rebuild with _IsiIndexConnectionTable() gives the same lookups as the
+ *    index kept up to date by IsiSetConnection().
+ *
+ *  The CIDs come from a small pool, so that many entries share one.  Most
+ *  selectors are in the ISI range, some are just below 0xFFFF.
+ *
+ *  The program then fills every entry and times a CID lookup and a CSMI
+ *  selector lookup, each against the scan it replaces.
+ *
+ *  Usage: IsiConnTabCheck [iterations [seed]]
+ *  Prints the number of lookups checked and the lookup times, in
+ *  nanoseconds.  Exits non-zero if a lookup differs from the scan.
+ */
+
+#include "isi_int.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define ITERATIONS		200000
+#define SEED			1
+#define TABLE_SIZE		ISI_MAX_CONNECTION_COUNT
+#define CID_POOL		8			// distinct CIDs in use
+#define CHECK_PERIOD	11			// writes between lookup checks
+#define REBUILD_PERIOD	5000		// writes between index rebuilds
+#define MAX_COUNT		3			// largest CSMI selector count checked
+#define TIMED_LOOKUPS	20000
+
+static IsiCid cids[CID_POOL];
+
+static double nowUsecs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec*1e6 + ts.tv_nsec/1e3;
+}
+
+static LonWord randomSelector()
+{
+	LonWord selector;
+
+	LON_SET_UNSIGNED_WORD(selector, (rand() % 8) ? rand() % (ISI_SELECTOR_MASK + 1) : 0xFFF0 + rand() % 16);
+	return selector;
+}
+
+static LonBool isIndexed(const IsiConnection* pConnection)
+{
+	return LON_GET_ATTRIBUTE_P(pConnection, ISI_CONN_STATE) >= isiConnectionStatePending;
+}
+
+static LonBool hasCid(const IsiConnection* pConnection, const IsiCid* pCid)
+{
+	return isIndexed(pConnection) && !memcmp(&pConnection->Header.Cid, pCid, sizeof(IsiCid));
+}
+
+//
+// The CSMI handler's test of whether the entry uses one of the selectors
+// Selector..Selector+Count.
+//
+static LonBool overlaps(const IsiConnection* pConnection, LonWord Selector, unsigned Count)
+{
+	for (unsigned i = 0; i <= Count; i++)
+	{
+		if (_IsiInSelectorRange(pConnection->Header.Selector, LON_GET_ATTRIBUTE_P(pConnection, ISI_CONN_WIDTH) - 1u,
+								_IsiAddSelector(Selector, i)))
+		{
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
+static void randomConnection(IsiConnection* pConnection)
+{
+	memset(pConnection, 0, sizeof(*pConnection));
+	pConnection->Header.Cid = cids[rand() % CID_POOL];
+	pConnection->Header.Selector = randomSelector();
+	pConnection->Host = (LonByte)rand();
+	pConnection->Member = (LonByte)rand();
+	pConnection->Attributes1 = (LonByte)rand();
+	pConnection->Desc.OffsetAuto = (LonByte)rand();
+}
+
+//
+// Step through the CID lookup and compare it with a scan.  Returns the
+// number of differences.
+//
+static int checkCid(const IsiCid* pCid)
+{
+	unsigned size = IsiGetConnectionTableSize();
+	unsigned next = _IsiNextConnectionByCid(pCid, 0);
+	int nBad = 0;
+
+	for (unsigned i = 0; i < size; i++)
+	{
+		if (hasCid(IsiGetConnection(i), pCid))
+		{
+			nBad += next != i;
+			next = _IsiNextConnectionByCid(pCid, i + 1u);
+		}
+	}
+	return nBad + (next != size);
+}
+
+//
+// Step through the selector lookup and check that it visits only indexed
+// entries, and every entry the CSMI handler would find overlapping.
+// Returns the number of differences.
+//
+static int checkSelector(LonWord Selector, unsigned Count)
+{
+	unsigned size = IsiGetConnectionTableSize();
+	LonByte visited[TABLE_SIZE];
+	int nBad = 0;
+
+	memset(visited, 0, sizeof(visited));
+	for (unsigned i = _IsiNextConnectionBySelector(Selector, Count, 0); i < size;
+		 i = _IsiNextConnectionBySelector(Selector, Count, i + 1u))
+	{
+		visited[i] = TRUE;
+		nBad += !isIndexed(IsiGetConnection(i));
+	}
+	for (unsigned i = 0; i < size; i++)
+	{
+		const IsiConnection* pConnection = IsiGetConnection(i);
+
+		if (isIndexed(pConnection) && overlaps(pConnection, Selector, Count) && !visited[i])
+		{
+			nBad++;
+		}
+	}
+	return nBad;
+}
+
+//
+// Record the lookups for every CID in the pool and for a set of selectors,
+// as a list of visited entries.  Used to compare the index kept up to date
+// with a rebuilt one.
+//
+static unsigned recordLookups(unsigned* pVisits, unsigned maxVisits)
+{
+	unsigned size = IsiGetConnectionTableSize();
+	unsigned n = 0;
+
+	for (unsigned c = 0; c < CID_POOL; c++)
+	{
+		for (unsigned i = _IsiNextConnectionByCid(&cids[c], 0); i < size && n < maxVisits;
+			 i = _IsiNextConnectionByCid(&cids[c], i + 1u))
+		{
+			pVisits[n++] = i;
+		}
+	}
+	for (unsigned s = 0; s <= 0xFFFFu; s += 0xFFu)
+	{
+		LonWord selector;
+
+		LON_SET_UNSIGNED_WORD(selector, s);
+		for (unsigned i = _IsiNextConnectionBySelector(selector, s % (MAX_COUNT + 1), 0); i < size && n < maxVisits;
+			 i = _IsiNextConnectionBySelector(selector, s % (MAX_COUNT + 1), i + 1u))
+		{
+			pVisits[n++] = i;
+		}
+	}
+	return n;
+}
+
+static int checkRebuild()
+{
+	static unsigned before[TABLE_SIZE * (CID_POOL + 258)];
+	static unsigned after[TABLE_SIZE * (CID_POOL + 258)];
+	unsigned maxVisits = sizeof(before) / sizeof(before[0]);
+	unsigned nBefore = recordLookups(before, maxVisits);
+	unsigned nAfter;
+
+	_IsiIndexConnectionTable();
+	nAfter = recordLookups(after, maxVisits);
+	return nBefore != nAfter || memcmp(before, after, nBefore * sizeof(unsigned)) != 0;
+}
+
+//
+// Time a CID lookup and a CSMI selector lookup over a full table, each
+// through the index and as the scan the handlers made before it.
+//
+static void timeLookups()
+{
+	unsigned size = IsiGetConnectionTableSize();
+	volatile unsigned sink = 0;
+	double start, indexed, scanned;
+
+	for (unsigned i = 0; i < size; i++)
+	{
+		IsiConnection connection;
+
+		randomConnection(&connection);
+		for (unsigned k = 0; k < sizeof(IsiCid); k++)
+		{
+			((LonByte*)&connection.Header.Cid)[k] = (LonByte)rand();
+		}
+		LON_SET_ATTRIBUTE(connection, ISI_CONN_STATE, isiConnectionStateInUse);
+		LON_SET_ATTRIBUTE(connection, ISI_CONN_WIDTH, 1 + rand() % ISI_WIDTH_PER_CONNTAB);
+		IsiSetConnection(&connection, i);
+	}
+
+	start = nowUsecs();
+	for (unsigned n = 0; n < TIMED_LOOKUPS; n++)
+	{
+		const IsiCid* pCid = &IsiGetConnection(n % size)->Header.Cid;
+		for (unsigned i = _IsiNextConnectionByCid(pCid, 0); i < size; i = _IsiNextConnectionByCid(pCid, i + 1u))
+		{
+			sink += i;
+		}
+	}
+	indexed = (nowUsecs() - start) * 1e3 / TIMED_LOOKUPS;
+	start = nowUsecs();
+	for (unsigned n = 0; n < TIMED_LOOKUPS; n++)
+	{
+		const IsiCid* pCid = &IsiGetConnection(n % size)->Header.Cid;
+		for (unsigned i = 0; i < size; i++)
+		{
+			if (hasCid(IsiGetConnection(i), pCid))
+			{
+				sink += i;
+			}
+		}
+	}
+	scanned = (nowUsecs() - start) * 1e3 / TIMED_LOOKUPS;
+	printf("cid        index %8.0f  scan %8.0f ns  (%.1fx)\n", indexed, scanned, indexed > 0 ? scanned / indexed : 0);
+
+	start = nowUsecs();
+	for (unsigned n = 0; n < TIMED_LOOKUPS; n++)
+	{
+		LonWord selector = IsiGetConnection(n % size)->Header.Selector;
+		for (unsigned i = _IsiNextConnectionBySelector(selector, 0, 0); i < size;
+			 i = _IsiNextConnectionBySelector(selector, 0, i + 1u))
+		{
+			sink += overlaps(IsiGetConnection(i), selector, 0);
+		}
+	}
+	indexed = (nowUsecs() - start) * 1e3 / TIMED_LOOKUPS;
+	start = nowUsecs();
+	for (unsigned n = 0; n < TIMED_LOOKUPS; n++)
+	{
+		LonWord selector = IsiGetConnection(n % size)->Header.Selector;
+		for (unsigned i = 0; i < size; i++)
+		{
+			sink += overlaps(IsiGetConnection(i), selector, 0);
+		}
+	}
+	scanned = (nowUsecs() - start) * 1e3 / TIMED_LOOKUPS;
+	printf("selector   index %8.0f  scan %8.0f ns  (%.1fx)\n", indexed, scanned, indexed > 0 ? scanned / indexed : 0);
+}
+
+int main(int argc, char* argv[])
+{
+	int iterations = argc > 1 ? atoi(argv[1]) : ITERATIONS;
+	unsigned seed = argc > 2 ? (unsigned)atoi(argv[2]) : SEED;
+	int nCidChecks = 0;
+	int nSelectorChecks = 0;
+	int nRebuilds = 0;
+	int nBad = 0;
+
+	if (iterations <= 0)
+	{
+		printf("FAIL: bad arguments\n");
+		return 1;
+	}
+
+	srand(seed);
+	for (unsigned c = 0; c < CID_POOL; c++)
+	{
+		for (unsigned k = 0; k < sizeof(IsiCid); k++)
+		{
+			((LonByte*)&cids[c])[k] = (LonByte)rand();
+		}
+	}
+	_IsiSetConnectionTableSize(TABLE_SIZE);
+
+	for (int n = 1; n <= iterations; n++)
+	{
+		IsiConnection connection;
+
+		randomConnection(&connection);
+		IsiSetConnection(&connection, rand() % TABLE_SIZE);
+		if (n % CHECK_PERIOD == 0)
+		{
+			nBad += checkCid(&cids[rand() % CID_POOL]);
+			nBad += checkSelector(randomSelector(), rand() % (MAX_COUNT + 1));
+			nCidChecks++;
+			nSelectorChecks++;
+		}
+		if (n % REBUILD_PERIOD == 0)
+		{
+			nBad += checkRebuild();
+			nRebuilds++;
+		}
+	}
+	printf("%d writes, %d CID lookups, %d selector lookups, %d rebuilds checked\n",
+		   iterations, nCidChecks, nSelectorChecks, nRebuilds);
+
+	if (nBad != 0)
+	{
+		printf("FAIL: %d lookup results differ from a scan of the table\n", nBad);
+		return 1;
+	}
+
+	timeLookups();
+	printf("PASS\n");
+	return 0;
+}
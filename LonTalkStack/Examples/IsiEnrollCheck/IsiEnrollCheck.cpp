@@ -0,0 +1,441 @@
+/*
+ * IsiEnrollCheck.cpp
+ *
+ * Copyright © 2022 Dialog Semiconductor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in 
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * Description: Check of the ISI enrollment handlers with and without the connection
+ *  table indices.
+ *
+ *  The CSMO, CSMI, CSMD and CSMX handlers step through the connection
+ *  table with _IsiNextConnectionByCid() and _IsiNextConnectionBySelector().
+ *  With _IsiUseConnectionIndex(FALSE) those return every slot, which is the
+ *  scan of the whole table the handlers made before the indices.  This
+ *  program runs an ISI device and feeds it the same random sequence of
+ *  enrollment messages three times from the same starting state: with the
+ *  indices, again with the indices, and with the full scan.  After every
+ *  message it records the connection table, the NV and alias tables, the
+ *  ISI engine state and the user interface events reported.  The second
+ *  run must match the first, which shows the runs are repeatable, and the
+ *  run with the full scan must match them too.
+ *
+ *  The connection table starts with pending and in-use entries over a
+ *  small pool of CIDs and a narrow range of selectors, many of them close
+ *  to the edge of a block of the selector index, so that messages find
+ *  duplicates, share CIDs with several entries and collide with their
+ *  selectors.  The messages use the same CIDs and selectors, and
+ *  some arrive while an enrollment is pending.
+ *
+ *  Usage: IsiEnrollCheck [messages [seed [port [nvd-folder]]]]
+ *  Exits non-zero if the runs differ.
+ */
+
+#include "FtxlApi.h"
+#include "DeviceHarness.h"
+#include "isi_int.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MESSAGES		2000
+#define SEED			1
+#define DEVICE_PORT		28050
+#define NVD_FOLDER		"/tmp/IsiEnrollCheck"
+#define NV_COUNT		64			// NVs, aliases and address table entries
+#define CONNECTIONS		ISI_MAX_CONNECTION_COUNT
+#define USED_CONNECTIONS	160		// entries pending or in use at the start
+#define CID_POOL		48
+#define BASE_SELECTOR	0x0200
+#define SELECTOR_SPAN	0x0300		// selectors are BASE_SELECTOR and up
+#define ASSEMBLIES		16
+
+static const HarnessDevice device = {
+	"IsiEnrollCheck",
+	0x50,						// model
+	NV_COUNT,					// static NVs
+	NV_COUNT,					// address table entries
+	NV_COUNT,					// aliases
+	5, 5						// priority and non-priority output buffers
+};
+
+static LonUniqueId uid = { 0x00, 0xD0, 0x71, 0x40, 0x10, 0x50 };
+static const LonByte did[LON_DOMAIN_ID_MAX_LENGTH] = { 0x50 };
+static LonByte nvValues[NV_COUNT][2];
+static char nvNames[NV_COUNT][16];
+static IsiCid cids[CID_POOL];
+
+// The starting state every run is put back to
+static IsiConnection startConnections[CONNECTIONS];
+static LonNvEcsConfig startNvs[NV_COUNT];
+static LonAliasEcsConfig startAliases[NV_COUNT];
+static LonAddress startAddresses[NV_COUNT];
+static IsiVolatile startVolatile;
+static IsiPersist startPersist;
+
+// What a run records after each message
+static unsigned long uiEvents;
+static unsigned long* pDigests[3];
+
+static unsigned long hash(unsigned long h, const void* pData, unsigned size)
+{
+	const LonByte* p = (const LonByte*)pData;
+
+	for (unsigned i = 0; i < size; i++)
+	{
+		h = (h ^ p[i]) * 1099511628211ul;
+	}
+	return h;
+}
+
+static void updateUserInterface(IsiEvent Event, LonByte Parameter)
+{
+	uiEvents = uiEvents * 31ul + Event * 256ul + Parameter + 1ul;
+}
+
+//
+// Take up the offer of a CSMO for one assembly, chosen from the offer, or
+// for none.
+//
+static unsigned getAssembly(const IsiCsmoData* pCsmoData, LonBool Auto, unsigned Assembly)
+{
+	if (Assembly == ISI_NO_ASSEMBLY && (pCsmoData->Variant & 1))
+	{
+		return pCsmoData->Group % ASSEMBLIES;
+	}
+	return ISI_NO_ASSEMBLY;
+}
+
+static LonApiError createStack(int port, const char* nvdFolder)
+{
+	LonApiError sts = HarnessCreateStack(NULL, NULL, &device, &uid, port, nvdFolder);
+
+	for (unsigned i = 0; sts == LonApiNoError && i < NV_COUNT; i++)
+	{
+		sprintf(nvNames[i], "nvValue%u", i);
+		sts = HarnessRegisterNv(NULL, nvValues[i], nvNames[i], (i & 1) ? LON_NV_IS_OUTPUT : 0);
+	}
+	if (sts == LonApiNoError)
+		sts = HarnessStartStack(NULL);
+	return sts;
+}
+
+//
+// Half the selectors are near the edge of a block of 256, where a range
+// of them is in two blocks of the selector index.
+//
+static LonWord randomSelector(unsigned* pSeed)
+{
+	LonWord selector;
+
+	if (rand_r(pSeed) % 2)
+	{
+		LON_SET_UNSIGNED_WORD(selector, BASE_SELECTOR + rand_r(pSeed) % SELECTOR_SPAN);
+	}
+	else
+	{
+		LON_SET_UNSIGNED_WORD(selector, BASE_SELECTOR + 0x100 * (1 + rand_r(pSeed) % (SELECTOR_SPAN / 0x100)) - 4 + rand_r(pSeed) % 8);
+	}
+	return selector;
+}
+
+static unsigned randomAssembly(unsigned* pSeed)
+{
+	return rand_r(pSeed) % 4 ? rand_r(pSeed) % ASSEMBLIES : ISI_NO_ASSEMBLY;
+}
+
+//
+// Start ISI, then set up the tables every run starts from.
+//
+static IsiApiError setUp(unsigned seed)
+{
+	IsiApiError sts;
+
+	IsiUpdateUserInterfaceRegistrar(updateUserInterface);
+	IsiGetAssemblyRegistrar(getAssembly);
+	sts = IsiStart(0, isiTypeS, isiFlagDisableAddrMgmt, CONNECTIONS, 1, did, 3);
+	if (sts != IsiApiNoError)
+	{
+		return sts;
+	}
+	sleep(1);
+	LonEventPump();
+	for (unsigned c = 0; c < CID_POOL; c++)
+	{
+		for (unsigned k = 0; k < sizeof(IsiCid); k++)
+		{
+			((LonByte*)&cids[c])[k] = (LonByte)rand_r(&seed);
+		}
+	}
+
+	// Bind the NVs and aliases to the selectors the connections use, so
+	// that selector changes reach them.
+	for (unsigned i = 0; i < NV_COUNT; i++)
+	{
+		LonNvEcsConfig nv = *IsiGetNv(i);
+		unsigned selector = BASE_SELECTOR + rand_r(&seed) % SELECTOR_SPAN;
+
+		LON_SET_ATTRIBUTE(nv, LON_NV_ECS_SELHIGH, selector >> 8);
+		nv.SelectorLow = (LonByte)selector;
+		LON_SET_UNSIGNED_WORD(nv.AddressIndex, rand_r(&seed) % 2 ? rand_r(&seed) % NV_COUNT : ISI_NO_ADDRESS);
+		IsiSetNv(&nv, i);
+
+		LonAliasEcsConfig alias;
+		memset(&alias, 0xFF, sizeof(alias));
+		if (i % 3 == 0)
+		{
+			alias.Alias = nv;
+			selector = BASE_SELECTOR + rand_r(&seed) % SELECTOR_SPAN;
+			LON_SET_ATTRIBUTE(alias.Alias, LON_NV_ECS_SELHIGH, selector >> 8);
+			alias.Alias.SelectorLow = (LonByte)selector;
+			LON_SET_UNSIGNED_WORD(alias.Primary, rand_r(&seed) % NV_COUNT);
+		}
+		IsiSetAlias(&alias, i);
+
+		LonAddress address;
+		memset(&address, 0, sizeof(address));
+		if (i % 2 == 0)
+		{
+			LON_SET_ATTRIBUTE(address.Group, LON_ADDRESS_GROUP_TYPE, 1);
+			address.Group.Group = (LonGroupId)(0x80 + i);
+		}
+		update_address(&address, i);
+
+		// Keep what the stack made of them; unused aliases, for one, are
+		// not stored as written.
+		startNvs[i] = *IsiGetNv(i);
+		startAliases[i] = *IsiGetAlias(i);
+		startAddresses[i] = *access_address(i);
+	}
+
+	for (unsigned i = 0; i < CONNECTIONS; i++)
+	{
+		IsiConnection connection;
+
+		memset(&connection, 0, sizeof(connection));
+		if (i < USED_CONNECTIONS)
+		{
+			connection.Header.Cid = cids[rand_r(&seed) % CID_POOL];
+			connection.Header.Selector = randomSelector(&seed);
+			connection.Host = (LonByte)randomAssembly(&seed);
+			connection.Member = (LonByte)randomAssembly(&seed);
+			LON_SET_ATTRIBUTE(connection, ISI_CONN_STATE,
+							  rand_r(&seed) % 4 ? isiConnectionStateInUse : isiConnectionStatePending);
+			LON_SET_ATTRIBUTE(connection, ISI_CONN_WIDTH, 1 + rand_r(&seed) % 4);
+			LON_SET_ATTRIBUTE(connection.Desc.Bf, ConnectionOffset, rand_r(&seed) % 4);
+		}
+		// Spread the used entries over the table
+		startConnections[(i * 97u) % CONNECTIONS] = connection;
+	}
+	startVolatile = _isiVolatile;
+	startPersist = _isiPersist;
+	return sts;
+}
+
+static void restore()
+{
+	for (unsigned i = 0; i < NV_COUNT; i++)
+	{
+		IsiSetNv(&startNvs[i], i);
+		IsiSetAlias(&startAliases[i], i);
+		update_address(&startAddresses[i], i);
+	}
+	for (unsigned i = 0; i < CONNECTIONS; i++)
+	{
+		IsiSetConnection(&startConnections[i], i);
+	}
+	_isiVolatile = startVolatile;
+	_isiPersist = startPersist;
+	uiEvents = 0;
+}
+
+static unsigned long digest()
+{
+	unsigned long h = 14695981039346656037ul;
+
+	for (unsigned i = 0; i < CONNECTIONS; i++)
+	{
+		h = hash(h, IsiGetConnection(i), sizeof(IsiConnection));
+	}
+	for (unsigned i = 0; i < NV_COUNT; i++)
+	{
+		h = hash(h, IsiGetNv(i), sizeof(LonNvEcsConfig));
+		h = hash(h, IsiGetAlias(i), sizeof(LonAliasEcsConfig));
+	}
+	h = hash(h, &_isiVolatile.State, sizeof(_isiVolatile.State));
+	h = hash(h, &_isiVolatile.pendingConnection, sizeof(_isiVolatile.pendingConnection));
+	h = hash(h, &uiEvents, sizeof(uiEvents));
+	return h;
+}
+
+//
+// Feed the device one random enrollment message.  Returns its kind.
+//
+static int receiveMessage(unsigned* pSeed)
+{
+	// CSMDs are kept rare, as each clears every entry with its CID
+	static const int weights[4] = { 16, 16, 1, 7 };
+	int kind = 0;
+
+	for (int pick = rand_r(pSeed) % 40; pick >= weights[kind]; kind++)
+	{
+		pick -= weights[kind];
+	}
+
+	// Some messages arrive during an enrollment, as an invited guest
+	if (rand_r(pSeed) % 3 == 0)
+	{
+		_isiVolatile.State = isiStateInvited;
+	}
+	else if (rand_r(pSeed) % 2)
+	{
+		_isiVolatile.State = isiStateNormal;
+	}
+
+	switch (kind)
+	{
+	case 0:
+	{
+		IsiCsmo csmo;
+		memset(&csmo, 0, sizeof(csmo));
+		csmo.Header.Cid = cids[rand_r(pSeed) % CID_POOL];
+		csmo.Header.Selector = randomSelector(pSeed);
+		csmo.Data.Group = (LonByte)rand_r(pSeed);
+		LON_SET_ATTRIBUTE(csmo.Data, ISI_CSMO_WIDTH, 1 + rand_r(pSeed) % 2);
+		LON_SET_ATTRIBUTE(csmo.Data, ISI_CSMO_DIR, rand_r(pSeed) % 2);
+		csmo.Data.Variant = (LonByte)rand_r(pSeed);
+		csmo.Data.Extended.Member = 1;
+		_IsiReceiveCsmo(rand_r(pSeed) % 4 == 0, rand_r(pSeed) % 2, &csmo);
+		break;
+	}
+	case 1:
+	{
+		IsiCsmi csmi;
+		memset(&csmi, 0, sizeof(csmi));
+		csmi.Header.Cid = cids[rand_r(pSeed) % CID_POOL];
+		csmi.Header.Selector = randomSelector(pSeed);
+		LON_SET_ATTRIBUTE(csmi.Desc.Bf, CsmiOffset, rand_r(pSeed) % 4);
+		LON_SET_ATTRIBUTE(csmi.Desc.Bf, CsmiCount, rand_r(pSeed) % 4);
+		_IsiReceivePtrCsmi(&csmi);
+		break;
+	}
+	case 2:
+	{
+		IsiCsmd csmd;
+		csmd.Cid = cids[rand_r(pSeed) % CID_POOL];
+		csmd.Selector = randomSelector(pSeed);
+		_IsiReceiveCsmd(&csmd);
+		break;
+	}
+	default:
+	{
+		IsiCsmx csmx;
+		csmx.Cid = cids[rand_r(pSeed) % CID_POOL];
+		csmx.Selector = randomSelector(pSeed);
+		_IsiReceiveCsmx(&csmx);
+		break;
+	}
+	}
+	return kind;
+}
+
+static int countUsed()
+{
+	int n = 0;
+
+	for (unsigned i = 0; i < CONNECTIONS; i++)
+	{
+		n += LON_GET_ATTRIBUTE_P(IsiGetConnection(i), ISI_CONN_STATE) != isiConnectionStateUnsed;
+	}
+	return n;
+}
+
+//
+// Returns the mean number of entries pending or in use.
+//
+static double run(int r, LonBool useIndex, int messages, unsigned seed, int* pKinds)
+{
+	long nUsed = 0;
+
+	restore();
+	_IsiUseConnectionIndex(useIndex);
+	for (int n = 0; n < messages; n++)
+	{
+		pKinds[receiveMessage(&seed)]++;
+		pDigests[r][n] = digest();
+		nUsed += countUsed();
+	}
+	_IsiUseConnectionIndex(TRUE);
+	return (double)nUsed / messages;
+}
+
+int main(int argc, char* argv[])
+{
+	int messages = argc > 1 ? atoi(argv[1]) : MESSAGES;
+	unsigned seed = argc > 2 ? (unsigned)atoi(argv[2]) : SEED;
+	int port = argc > 3 ? atoi(argv[3]) : DEVICE_PORT;
+	const char* nvdFolder = argc > 4 ? argv[4] : NVD_FOLDER;
+	static const char* names[3] = { "indexed", "indexed again", "full scan" };
+	int kinds[4] = { 0 };
+	int nFailures = 0;
+
+	if (messages <= 0)
+	{
+		printf("FAIL: bad arguments\n");
+		return 1;
+	}
+	if (createStack(port, nvdFolder) != LonApiNoError || setUp(seed) != IsiApiNoError)
+	{
+		printf("FAIL: device setup failed\n");
+		return 1;
+	}
+
+	for (int r = 0; r < 3; r++)
+	{
+		pDigests[r] = new unsigned long[messages];
+		double used = run(r, r < 2, messages, seed, kinds);
+		printf("%-14s %.0f of %d connection table entries used on average\n", names[r], used, CONNECTIONS);
+	}
+	printf("%d CSMO, %d CSMI, %d CSMD, %d CSMX in each run\n", kinds[0]/3, kinds[1]/3, kinds[2]/3, kinds[3]/3);
+
+	for (int r = 1; r < 3; r++)
+	{
+		for (int n = 0; n < messages; n++)
+		{
+			if (pDigests[r][n] != pDigests[0][n])
+			{
+				printf("FAIL: the %s run differs from the first after message %d\n", names[r], n);
+				nFailures++;
+				break;
+			}
+		}
+	}
+
+	IsiStop();
+	LonLidDestroyStack();
+
+	if (nFailures != 0)
+	{
+		return 1;
+	}
+	printf("PASS\n");
+	return 0;
+}
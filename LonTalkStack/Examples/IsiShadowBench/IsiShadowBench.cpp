@@ -0,0 +1,462 @@
+/*
+ * IsiShadowBench.cpp
+ *
+ * Copyright © 2022 Dialog Semiconductor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in 
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ *
+ * Description: ISI configuration shadow benchmark.
+ *
+ *  The program runs one IzoT device whose NV, alias and address tables are
+ *  all at the ISI limit of 254 entries, and times the ISI engine's table
+ *  sweeps, which read through the configuration shadow in util.c:
+ *
+ *  - scan: IsiGetNv() and IsiGetAlias() over every entry.
+ *  - sweep: _IsiSweepAddressTable(), with every address entry in use by an
+ *    alias, so each entry scans the NV table and part of the alias table.
+ *  - selectors: _IsiGetSelectors(), which checks a new selector against
+ *    every NV and alias.
+ *  - replace: _IsiReplaceSelectors() on a bound NV, as enrollment does.
+ *    This writes the NV through the shadow and scans the alias table.
+ *
+ *  Each is timed against a direct version in this file, which makes the
+ *  same reads with one LonQuery*Config() call per entry.  That is what
+ *  each ISI read cost before the shadow.
+ *
+ *  The program then writes random entries through ISI and directly through
+ *  the stack API, and checks after each batch that every entry read through
+ *  ISI matches the stack's own copy.
+ *
+ *  Usage: IsiShadowBench [repeats [port [nvd-folder]]]
+ *  Prints the mean time of each operation direct and through the shadow,
+ *  in microseconds.  Exits non-zero if a read through ISI differs from the
+ *  stack.
+ */
+
+#include "FtxlApi.h"
+#include "DeviceHarness.h"
+#include "isi_int.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define REPEATS			20
+#define DEVICE_PORT		28010
+#define NVD_FOLDER		"/tmp/IsiShadowBench"
+#define TABLE_SIZE		ISI_MAX_NV_COUNT	// NVs, aliases and addresses
+#define BOUND_NV		0					// NV that replace rebinds
+// _IsiReplaceSelectors() stores the selector bytes in host order, so the
+// replace selectors have equal high and low bytes.
+#define BOUND_SELECTOR	0x0101
+#define SELECTOR_TOGGLE	0x0303
+#define CHECK_WRITES	2000				// random writes for the check
+#define CHECK_BATCH		50					// writes between full compares
+
+static const HarnessDevice device = {
+	"IsiShadowBench",
+	0x14,						// model
+	TABLE_SIZE,					// static NVs
+	TABLE_SIZE,					// address table entries
+	TABLE_SIZE,					// aliases
+	1, 5						// priority and non-priority output buffers
+};
+
+static LonUniqueId uid = { 0x00, 0xD0, 0x71, 0x40, 0x10, 0x02 };
+static LonByte nvValues[TABLE_SIZE][2];
+static char nvNames[TABLE_SIZE][16];
+static LonWord replaceSelector;
+
+static unsigned getSelector(const LonNvEcsConfig* pNv)
+{
+	return (LON_GET_ATTRIBUTE_P(pNv, LON_NV_ECS_SELHIGH) << 8) | pNv->SelectorLow;
+}
+
+static void setSelector(LonNvEcsConfig* pNv, unsigned selector)
+{
+	LON_SET_ATTRIBUTE_P(pNv, LON_NV_ECS_SELHIGH, selector >> 8);
+	pNv->SelectorLow = (LonByte)selector;
+}
+
+static LonApiError createStack(int port, const char* nvdFolder)
+{
+	LonApiError sts = HarnessCreateStack(NULL, NULL, &device, &uid, port, nvdFolder);
+
+	for (unsigned i = 0; sts == LonApiNoError && i < TABLE_SIZE; i++)
+	{
+		sprintf(nvNames[i], "nvoValue%u", i);
+		sts = HarnessRegisterNv(NULL, nvValues[i], nvNames[i], LON_NV_IS_OUTPUT);
+	}
+	if (sts == LonApiNoError)
+		sts = HarnessStartStack(NULL);
+	return sts;
+}
+
+//
+// Fill the tables the way a busy ISI device looks: every address entry is
+// in use by the alias with the same index, the aliases are bound to
+// selectors of their own, and all NVs but BOUND_NV are unbound.
+//
+static LonApiError fillTables()
+{
+	LonApiError sts = LonApiNoError;
+
+	for (unsigned i = 0; sts == LonApiNoError && i < TABLE_SIZE; i++)
+	{
+		LonNvEcsConfig nv;
+		LonAliasEcsConfig alias;
+		LonAddress address;
+
+		sts = LonQueryNvConfig(i, &nv);
+		if (sts == LonApiNoError)
+		{
+			setSelector(&nv, i == BOUND_NV ? BOUND_SELECTOR : 0x3000 + i);
+			LON_SET_UNSIGNED_WORD(nv.AddressIndex, i == BOUND_NV ? 0 : ISI_NO_ADDRESS);
+			sts = LonUpdateNvConfig(i, &nv);
+		}
+		if (sts == LonApiNoError)
+		{
+			memset(&alias, 0, sizeof(alias));
+			setSelector(&alias.Alias, 0x2000 + i);
+			LON_SET_UNSIGNED_WORD(alias.Alias.AddressIndex, i);
+			LON_SET_UNSIGNED_WORD(alias.Primary, i);
+			sts = LonUpdateAliasConfig(i, &alias);
+		}
+		if (sts == LonApiNoError)
+		{
+			memset(&address, 0, sizeof(address));
+			address.Broadcast.Type = LonAddressBroadcast;
+			address.Broadcast.TransmitTimer = LonTx16;
+			sts = LonUpdateAddressConfig(i, &address);
+		}
+	}
+	LON_SET_UNSIGNED_WORD(replaceSelector, BOUND_SELECTOR);
+	return sts;
+}
+
+//
+// The direct operations make the same stack reads as the ISI operation of
+// the same name, one LonQuery*Config() call per entry the way every ISI
+// read went before the shadow.
+//
+static void scanDirect()
+{
+	LonNvEcsConfig nv;
+	LonAliasEcsConfig alias;
+
+	for (unsigned i = 0; i < NvCount; i++)
+	{
+		LonQueryNvConfig(i, &nv);
+	}
+	for (unsigned i = 0; i < AliasCount; i++)
+	{
+		LonQueryAliasConfig(i, &alias);
+	}
+}
+
+static void sweepDirect()
+{
+	unsigned addressCount = _address_table_count();
+
+	for (unsigned index = 0; index < addressCount; index++)
+	{
+		LonAddress address;
+		LonNvEcsConfig nv;
+		LonAliasEcsConfig alias;
+		unsigned i;
+
+		if (LonQueryAddressConfig(index, &address) != LonApiNoError || !address.Broadcast.Type)
+		{
+			continue;
+		}
+		for (i = 0; i < NvCount; i++)
+		{
+			LonQueryNvConfig(i, &nv);
+			if (LON_GET_ATTRIBUTE(nv, LON_NV_ECS_SELHIGH) < 0x30u && 
+				(unsigned)LON_GET_UNSIGNED_WORD(nv.AddressIndex) == index)
+			{
+				break;
+			}
+		}
+		for (i = i < NvCount ? AliasCount : 0; i < AliasCount; i++)
+		{
+			LonQueryAliasConfig(i, &alias);
+			if (LON_GET_UNSIGNED_WORD(alias.Primary) != ISI_ALIAS_UNUSED && 
+				(unsigned)LON_GET_UNSIGNED_WORD(alias.Alias.AddressIndex) == index)
+			{
+				break;
+			}
+		}
+	}
+}
+
+static void selectorsDirect()
+{
+	unsigned selector = rand() % (ISI_SELECTOR_MASK + 1);
+	LonNvEcsConfig nv;
+	LonAliasEcsConfig alias;
+
+	for (unsigned i = 0; i < NvCount; i++)
+	{
+		LonQueryNvConfig(i, &nv);
+		if (getSelector(&nv) == selector)
+		{
+			break;
+		}
+	}
+	for (unsigned i = 0; i < AliasCount; i++)
+	{
+		LonQueryAliasConfig(i, &alias);
+		if (getSelector(&alias.Alias) == selector)
+		{
+			break;
+		}
+	}
+}
+
+static void replaceDirect()
+{
+	unsigned next = LON_GET_UNSIGNED_WORD(replaceSelector) ^ SELECTOR_TOGGLE;
+	LonNvEcsConfig nv;
+	LonAliasEcsConfig alias;
+
+	LonQueryNvConfig(BOUND_NV, &nv);
+	setSelector(&nv, next);
+	LonUpdateNvConfig(BOUND_NV, &nv);
+	for (unsigned i = 0; i < AliasCount; i++)
+	{
+		LonQueryAliasConfig(i, &alias);
+	}
+	LON_SET_UNSIGNED_WORD(replaceSelector, next);
+}
+
+static void scanIsi()
+{
+	for (unsigned i = 0; i < NvCount; i++)
+	{
+		IsiGetNv(i);
+	}
+	for (unsigned i = 0; i < AliasCount; i++)
+	{
+		IsiGetAlias(i);
+	}
+}
+
+static void sweepIsi()
+{
+	_IsiSweepAddressTable();
+}
+
+static void selectorsIsi()
+{
+	_IsiGetSelectors(1);
+}
+
+static void replaceIsi()
+{
+	LonWord next;
+
+	LON_SET_UNSIGNED_WORD(next, LON_GET_UNSIGNED_WORD(replaceSelector) ^ SELECTOR_TOGGLE);
+	_IsiReplaceSelectors(BOUND_NV, replaceSelector, next, 0);
+	replaceSelector = next;
+}
+
+//
+// Return the mean time of one call to pOp over the given number of
+// repeats, after one call that is not timed.
+//
+static double timeOp(void (*pOp)(), int repeats)
+{
+	double start;
+
+	pOp();
+	start = HarnessNowSecs();
+	for (int i = 0; i < repeats; i++)
+	{
+		pOp();
+	}
+	return (HarnessNowSecs() - start) * 1e6 / repeats;
+}
+
+//
+// Compare every NV, alias and address entry read through ISI with the
+// stack's copy.  Returns the number of entries that differ.
+//
+static int compareTables()
+{
+	int nBad = 0;
+
+	for (unsigned i = 0; i < TABLE_SIZE; i++)
+	{
+		LonNvEcsConfig nv;
+		LonAliasEcsConfig alias;
+		LonAddress address;
+		const LonAddress* pAddress;
+
+		memset(&nv, 0, sizeof(nv));
+		LonQueryNvConfig(i, &nv);
+		if (memcmp(IsiGetNv(i), &nv, sizeof(nv)) != 0)
+		{
+			nBad++;
+		}
+		memset(&alias, 0, sizeof(alias));
+		LonQueryAliasConfig(i, &alias);
+		if (memcmp(IsiGetAlias(i), &alias, sizeof(alias)) != 0)
+		{
+			nBad++;
+		}
+		pAddress = access_address(i);
+		if (LonQueryAddressConfig(i, &address) != LonApiNoError)
+		{
+			nBad += pAddress != NULL;
+		}
+		else if (pAddress == NULL || memcmp(pAddress, &address, sizeof(address)) != 0)
+		{
+			nBad++;
+		}
+	}
+	return nBad;
+}
+
+//
+// Write random entries, through ISI and past it, and compare the tables
+// every CHECK_BATCH writes.  Returns the number of differences found.
+//
+static int checkEquivalence()
+{
+	int nBad = 0;
+
+	srand(1);
+	for (int i = 1; i <= CHECK_WRITES; i++)
+	{
+		unsigned index = rand() % TABLE_SIZE;
+		unsigned selector = rand() % 0x3100;
+		LonNvEcsConfig nv;
+		LonAliasEcsConfig alias;
+		LonAddress address;
+
+		switch (rand() % 6)
+		{
+		case 0:
+		case 1:
+			nv = *IsiGetNv(index);
+			setSelector(&nv, selector);
+			LON_SET_UNSIGNED_WORD(nv.AddressIndex, rand() % TABLE_SIZE);
+			if (rand() & 1)
+				IsiSetNv(&nv, index);
+			else
+				LonUpdateNvConfig(index, &nv);
+			break;
+		case 2:
+		case 3:
+			alias = *IsiGetAlias(index);
+			setSelector(&alias.Alias, selector);
+			LON_SET_UNSIGNED_WORD(alias.Primary, (rand() % 4) ? rand() % TABLE_SIZE : ISI_ALIAS_UNUSED);
+			if (rand() & 1)
+				IsiSetAlias(&alias, index);
+			else
+				LonUpdateAliasConfig(index, &alias);
+			break;
+		default:
+			memset(&address, 0, sizeof(address));
+			if (rand() % 4)
+			{
+				address.Broadcast.Type = LonAddressBroadcast;
+				address.Broadcast.TransmitTimer = (LonTransmitTimer)(rand() % 16);
+				address.Broadcast.Subnet = (LonSubnetId)rand();
+			}
+			if (rand() & 1)
+				update_address(&address, index);
+			else
+				LonUpdateAddressConfig(index, &address);
+			break;
+		}
+		if (i % CHECK_BATCH == 0)
+		{
+			nBad += compareTables();
+		}
+	}
+	return nBad;
+}
+
+static void report(const char* name, void (*pDirect)(), void (*pIsi)(), int repeats)
+{
+	double direct = timeOp(pDirect, repeats);
+	double shadowed = timeOp(pIsi, repeats);
+
+	printf("%-10s direct %9.1f  shadow %9.1f us  (%.1fx)\n", name, direct, shadowed, 
+		   shadowed > 0 ? direct / shadowed : 0);
+}
+
+int main(int argc, char* argv[])
+{
+	int repeats = argc > 1 ? atoi(argv[1]) : REPEATS;
+	int port = argc > 2 ? atoi(argv[2]) : DEVICE_PORT;
+	const char* nvdFolder = argc > 3 ? argv[3] : NVD_FOLDER;
+	int nFailures = 0;
+	LonApiError sts;
+
+	if (repeats <= 0)
+	{
+		printf("FAIL: bad arguments\n");
+		return 1;
+	}
+
+	sts = createStack(port, nvdFolder);
+	if (sts == LonApiNoError)
+	{
+		sts = fillTables();
+	}
+	if (sts != LonApiNoError)
+	{
+		printf("FAIL: stack setup failed with %d\n", sts);
+		nFailures++;
+	}
+	else
+	{
+		int nBad;
+
+		printf("%u NVs, %u aliases, %u address entries\n", NvCount, AliasCount, _address_table_count());
+		report("scan", scanDirect, scanIsi, repeats);
+		report("sweep", sweepDirect, sweepIsi, repeats);
+		report("selectors", selectorsDirect, selectorsIsi, repeats);
+		report("replace", replaceDirect, replaceIsi, repeats);
+		if (getSelector(IsiGetNv(BOUND_NV)) != (unsigned)LON_GET_UNSIGNED_WORD(replaceSelector))
+		{
+			printf("FAIL: _IsiReplaceSelectors did not rebind NV %d\n", BOUND_NV);
+			nFailures++;
+		}
+
+		nBad = compareTables() + checkEquivalence();
+		if (nBad != 0)
+		{
+			printf("FAIL: %d entries read through ISI differ from the stack\n", nBad);
+			nFailures++;
+		}
+	}
+
+	LonLidDestroyStack();
+
+	if (nFailures != 0)
+	{
+		return 1;
+	}
+	printf("PASS\n");
+	return 0;
+}
@@ -0,0 +1,453 @@
+/*
+ * IzoTAddrLookupBench.cpp
+ *
+ * Copyright © 2022 Dialog Semiconductor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in 
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * Description: Concurrency check and benchmark of the IzoT address lookups.
+ *
+ *  Every packet sent on an IzoT link looks up its source IP address in the
+ *  IzotUnicastAddresses of the link, to find the socket bound to it, and
+ *  its LS destination in the LS/IP mapping, to find the IP address to send
+ *  to.  Neither takes the link lock: the unicast addresses are found through
+ *  an index published under a sequence count, and the outcome of a
+ *  destination lookup is cached in entries that are read the same way.
+ *  This program runs reader tasks making those lookups against a writer
+ *  task that keeps changing what they look up:
+ *
+ *  - a few hundred unicast addresses are set and bound for good, and must
+ *  always be found at their socket index, bound to their port;
+ *  - the writer sets, binds, unbinds and releases more addresses, each
+ *  always at the same socket index, spreading over more socket indices as
+ *  it goes so the map and its index keep growing.  A lookup must find one
+ *  of them at its own socket index or not at all, with its own port or
+ *  none;
+ *  - a few hundred LS destinations over several domains are mapped for
+ *  good, half to their LS derived addresses and half to arbitrary ones,
+ *  and must always give the same result;
+ *  - the writer switches more destinations between two arbitrary addresses
+ *  and none.  A lookup must give one of those three results exactly,
+ *  never a mixture.
+ *
+ *  It reports lookups per second with the writer idle and busy, and
+ *  against the same lookups made with the link lock held, as they were
+ *  before.
+ *
+ *  Usage: IzoTAddrLookupBench [seconds [readers]]
+ *  Exits non-zero if any check fails.
+ */
+
+#include "LtStackInternal.h"
+#include "LonLinkIzoT.h"
+#include "IzoTDevSocketMaps.h"
+
+extern "C"
+{
+#include "ipv6_ls_to_udp.h"
+}
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#define SECONDS			2
+#define MAX_READERS		8
+#define FIXED_ADDRS		300			// socket indices 1..FIXED_ADDRS are never changed
+#define CHURN_ADDRS		100			// the writer starts on the next CHURN_ADDRS
+#define MAX_ADDRS		1024		// and spreads up to here
+#define NUM_DOMAINS		4
+#define DESTS_PER_DOMAIN	75		// fixed destinations
+#define CHURN_DESTS		40			// per domain, on CHURN_SUBNET
+#define CHURN_SUBNET	200
+#define BASE_PORT		3000
+#define TASK_PRIORITY	100
+#define TASK_STACK		32768
+
+// IPV4 LS/UDP carries at most two bytes of the domain ID, so the third byte
+// of a three byte domain is zero.
+static const byte domainLen[NUM_DOMAINS] = { 0, 1, 1, 3 };
+static const byte domainId[NUM_DOMAINS][3] = { { 0 }, { 0x22 }, { 0x23 }, { 0x33, 0x44, 0 } };
+
+static int nFailures = 0;
+
+static void check(int bOk, const char* what, long n = 0)
+{
+	if (!bOk && nFailures++ < 20)
+	{
+		printf("FAIL: %s (%ld)\n", what, n);
+	}
+}
+
+static double nowSecs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec/1e9;
+}
+
+//
+// A LonLinkIzoT with no device behind it, to look up destinations on.
+//
+class BenchLink : public LonLinkIzoT
+{
+public:
+	void	lock()		{ semTake(m_lock, WAIT_FOREVER); }
+	void	unlock()	{ semGive(m_lock); }
+
+	virtual void sendAnnouncement(const uint8_t *ltV0msg, uint8_t msgLen)	{}
+	virtual LtSts setUnicastAddress(int stackIndex, int domainIndex, int subnetNodeIndex,
+									byte *domainId, int domainLen, byte subnetId, byte nodeId)
+	{	return LTSTS_OK;
+	}
+	virtual void deregisterStack(int stackIndex)	{}
+	virtual LtSts updateGroupMembership(int stackIndex, int domainIndex, LtGroups &groups)
+	{	return LTSTS_OK;
+	}
+	virtual int queryIpAddr(LtDomain &domain, byte subnetId, byte nodeId, byte *ipAddress)
+	{	return 0;
+	}
+	virtual void setLsAddrMappingConfig(int stackIndex, ULONG lsAddrMappingAnnounceFreq,
+										WORD lsAddrMappingAnnounceThrottle, ULONG lsAddrMappingAgeLimit)
+	{
+	}
+
+protected:
+	virtual LtSts driverOpen(const char* pName)			{ return LTSTS_OK; }
+	virtual LtSts driverRead(void *pData, short len)	{ return LTSTS_ERROR; }
+	virtual LtSts driverWrite(void *pData, short len)	{ return LTSTS_OK; }
+};
+
+static SEM_ID unicastLock;
+static IzotUnicastAddresses* pUnicast;
+static BenchLink* pLink;
+static volatile int bStop;
+static volatile int bWriterBusy;
+static volatile int bLocked;
+static volatile int nDone;
+static volatile int nAddrLimit = 1 + FIXED_ADDRS + CHURN_ADDRS;
+static volatile long nWrites;
+static long nLookups[MAX_READERS];
+
+// The unicast address and port used at a socket index
+static void unicastAddr(int socketIndex, byte* ipAddr)
+{
+	ipAddr[0] = 10;
+	ipAddr[1] = 1;
+	ipAddr[2] = socketIndex >> 8;
+	ipAddr[3] = socketIndex & 0xff;
+}
+
+static USHORT unicastPort(int socketIndex)
+{
+	return BASE_PORT + socketIndex;
+}
+
+// The subnet and node of fixed destination i of a domain.  Odd ones use
+// their LS derived address.
+static byte destSubnet(int i)	{ return 1 + i/20; }
+static byte destNode(int i)		{ return 1 + i%20; }
+
+// The arbitrary addresses of a destination.  The alternate one differs in
+// every byte.
+static void arbitraryAddr(int domain, byte subnet, byte node, int alternate, byte* ipAddr)
+{
+	ipAddr[0] = alternate ? 172 : 192;
+	ipAddr[1] = alternate ? 16 + domain : 168 + domain;
+	ipAddr[2] = alternate ? ~subnet : subnet;
+	ipAddr[3] = alternate ? ~node : node;
+}
+
+//
+// Look up a source address the way LonLinkIzoTDev::SelectSourceSocket
+// does.  Returns the socket index and its port.
+//
+static int selectSource(const byte* ipAddr, USHORT& port)
+{
+	if (bLocked)
+	{
+		semTake(unicastLock, WAIT_FOREVER);
+	}
+	int socketIndex = pUnicast->find(ipAddr, IPV4_ADDRESS_LEN);
+	bool isBound = pUnicast->getIsBound(socketIndex, port);
+	if (bLocked)
+	{
+		semGive(unicastLock);
+	}
+	return isBound ? socketIndex : IZOT_NULL_SOCKET_INDEX;
+}
+
+static uint8_t lookupDest(int domain, byte subnet, byte node, byte* destIpAddr, byte* enclosed)
+{
+	if (bLocked)
+	{
+		pLink->lock();
+	}
+	uint8_t n = pLink->getArbitraryDestAddress(domainId[domain], domainLen[domain], subnet, node,
+											   IPV6_LSUDP_NPDU_ADDR_FMT_SUBNET_NODE, destIpAddr, enclosed);
+	if (bLocked)
+	{
+		pLink->unlock();
+	}
+	return n;
+}
+
+static void bindUnicast(int socketIndex)
+{
+	byte ipAddr[IPV4_ADDRESS_LEN];
+	unicastAddr(socketIndex, ipAddr);
+	pUnicast->set(socketIndex, ipAddr, IPV4_ADDRESS_LEN);
+	pUnicast->setIsBound(socketIndex, true, unicastPort(socketIndex));
+}
+
+static void setArbitrary(int domain, byte subnet, byte node, int alternate)
+{
+	byte ipAddr[IPV4_ADDRESS_LEN];
+	arbitraryAddr(domain, subnet, node, alternate, ipAddr);
+	pLink->setArbitraryAddressMapping(ipAddr, domainId[domain], domainLen[domain], subnet, node);
+}
+
+static int VXLCDECL writerTask(int arg, ...)
+{
+	unsigned int seed = 1;
+
+	while (!bStop)
+	{
+		if (!bWriterBusy)
+		{
+			taskDelay(1);
+			continue;
+		}
+
+		// A unicast address
+		int socketIndex = 1 + FIXED_ADDRS + rand_r(&seed) % (nAddrLimit - 1 - FIXED_ADDRS);
+		if (pUnicast->getIpv4Address(socketIndex) == 0)
+		{
+			bindUnicast(socketIndex);
+		}
+		else if (pUnicast->getIsBound(socketIndex))
+		{
+			pUnicast->setIsBound(socketIndex, rand_r(&seed) % 2, unicastPort(socketIndex));
+		}
+		else
+		{
+			pUnicast->release(socketIndex);
+		}
+		if (nAddrLimit < MAX_ADDRS && (nWrites & 63) == 0)
+		{
+			nAddrLimit++;
+		}
+
+		// A destination
+		int domain = rand_r(&seed) % NUM_DOMAINS;
+		byte node = 1 + rand_r(&seed) % CHURN_DESTS;
+		int action = rand_r(&seed) % 3;
+		if (action == 2)
+		{
+			pLink->setArbitraryAddressMapping(NULL, domainId[domain], domainLen[domain], CHURN_SUBNET, node);
+		}
+		else
+		{
+			setArbitrary(domain, CHURN_SUBNET, node, action);
+		}
+		nWrites++;
+	}
+	__sync_fetch_and_add(&nDone, 1);
+	return 0;
+}
+
+static void checkFixedUnicast(int socketIndex)
+{
+	byte ipAddr[IPV4_ADDRESS_LEN];
+	USHORT port;
+	unicastAddr(socketIndex, ipAddr);
+	check(selectSource(ipAddr, port) == socketIndex, "a fixed address was not found", socketIndex);
+	check(port == unicastPort(socketIndex), "a fixed address has the wrong port", socketIndex);
+}
+
+static void checkChurnUnicast(int socketIndex)
+{
+	byte ipAddr[IPV4_ADDRESS_LEN];
+	USHORT port;
+	unicastAddr(socketIndex, ipAddr);
+	int found = selectSource(ipAddr, port);
+	check(found == socketIndex || found == IZOT_NULL_SOCKET_INDEX, "an address was found at another socket index", socketIndex);
+	check(found == IZOT_NULL_SOCKET_INDEX || port == unicastPort(socketIndex), "a bound address has the wrong port", socketIndex);
+}
+
+static void checkFixedDest(int domain, int i)
+{
+	byte destIpAddr[IPV4_ADDRESS_LEN];
+	byte expected[IPV4_ADDRESS_LEN];
+	byte enclosed[2];
+	byte subnet = destSubnet(i);
+	byte node = destNode(i);
+	uint8_t n = lookupDest(domain, subnet, node, destIpAddr, enclosed);
+	if (i & 1)
+	{
+		check(n == 0, "a derived destination was not derived", domain*1000 + i);
+	}
+	else
+	{
+		arbitraryAddr(domain, subnet, node, FALSE, expected);
+		check(n != 0 && memcmp(destIpAddr, expected, IPV4_ADDRESS_LEN) == 0 &&
+			  enclosed[0] == subnet && enclosed[1] == node,
+			  "an arbitrary destination has the wrong address", domain*1000 + i);
+	}
+}
+
+static void checkChurnDest(int domain, byte node)
+{
+	byte destIpAddr[IPV4_ADDRESS_LEN];
+	byte expected[3][IPV4_ADDRESS_LEN];
+	byte enclosed[2];
+	uint8_t n = lookupDest(domain, CHURN_SUBNET, node, destIpAddr, enclosed);
+	arbitraryAddr(domain, CHURN_SUBNET, node, FALSE, expected[0]);
+	arbitraryAddr(domain, CHURN_SUBNET, node, TRUE, expected[1]);
+	ipv6_gen_ls_mc_addr(LT_AF_BROADCAST, CHURN_SUBNET, expected[2]);
+	check(n != 0 && enclosed[0] == CHURN_SUBNET && enclosed[1] == node &&
+		  (memcmp(destIpAddr, expected[0], IPV4_ADDRESS_LEN) == 0 ||
+		   memcmp(destIpAddr, expected[1], IPV4_ADDRESS_LEN) == 0 ||
+		   memcmp(destIpAddr, expected[2], IPV4_ADDRESS_LEN) == 0),
+		  "a changing destination has a mixed up address", domain*1000 + node);
+}
+
+static int VXLCDECL readerTask(int reader, ...)
+{
+	unsigned int seed = reader + 100;
+	long n = 0;
+
+	while (!bStop)
+	{
+		checkFixedUnicast(1 + rand_r(&seed) % FIXED_ADDRS);
+		checkChurnUnicast(1 + FIXED_ADDRS + rand_r(&seed) % (MAX_ADDRS - 1 - FIXED_ADDRS));
+		checkFixedDest(rand_r(&seed) % NUM_DOMAINS, rand_r(&seed) % DESTS_PER_DOMAIN);
+		checkChurnDest(rand_r(&seed) % NUM_DOMAINS, 1 + rand_r(&seed) % CHURN_DESTS);
+		n += 4;
+	}
+	nLookups[reader] = n;
+	__sync_fetch_and_add(&nDone, 1);
+	return 0;
+}
+
+static void checkQuiescent()
+{
+	for (int i = 1; i <= FIXED_ADDRS; i++)
+	{
+		checkFixedUnicast(i);
+	}
+	for (int i = 1 + FIXED_ADDRS; i < MAX_ADDRS; i++)
+	{
+		checkChurnUnicast(i);
+	}
+	for (int d = 0; d < NUM_DOMAINS; d++)
+	{
+		for (int i = 0; i < DESTS_PER_DOMAIN; i++)
+		{
+			checkFixedDest(d, i);
+		}
+	}
+}
+
+static void run(const char* name, int bBusy, int bLock, int nReaders, int seconds)
+{
+	double start;
+	double elapsed;
+	long n = 0;
+	long writes = nWrites;
+
+	bWriterBusy = bBusy;
+	bLocked = bLock;
+	bStop = FALSE;
+	nDone = 0;
+	taskSpawn("AddrWriter", TASK_PRIORITY, 0, TASK_STACK, writerTask, 0, 0,0,0,0, 0,0,0,0,0);
+	start = nowSecs();
+	for (int i = 0; i < nReaders; i++)
+	{
+		taskSpawn("AddrReader", TASK_PRIORITY, 0, TASK_STACK, readerTask, i, 0,0,0,0, 0,0,0,0,0);
+	}
+	sleep(seconds);
+	bStop = TRUE;
+	while (nDone < nReaders + 1)
+	{
+		usleep(1000);
+	}
+	elapsed = nowSecs() - start;
+
+	for (int i = 0; i < nReaders; i++)
+	{
+		n += nLookups[i];
+	}
+	printf("%-22s %10.0f lookups/s  %8.0f updates/s\n", name, n/elapsed, (nWrites - writes)/elapsed);
+	checkQuiescent();
+}
+
+int main(int argc, char* argv[])
+{
+	int seconds = argc > 1 ? atoi(argv[1]) : SECONDS;
+	int nReaders = argc > 2 ? atoi(argv[2]) : 2;
+
+	if (seconds < 1 || nReaders < 1 || nReaders > MAX_READERS)
+	{
+		printf("FAIL: bad arguments\n");
+		return 1;
+	}
+
+	unicastLock = LonLinkIzoTLock::create();
+	pUnicast = new IzotUnicastAddresses(unicastLock);
+	for (int i = 1; i <= FIXED_ADDRS; i++)
+	{
+		bindUnicast(i);
+	}
+
+	pLink = new BenchLink();
+	for (int d = 0; d < NUM_DOMAINS; d++)
+	{
+		for (int i = 0; i < DESTS_PER_DOMAIN; i++)
+		{
+			if (i & 1)
+			{
+				pLink->setDerivedAddressMapping(domainId[d], domainLen[d], destSubnet(i), destNode(i));
+			}
+			else
+			{
+				setArbitrary(d, destSubnet(i), destNode(i), FALSE);
+			}
+		}
+	}
+	checkQuiescent();
+
+	printf("%d readers, %d fixed addresses, %d domains of %d fixed destinations\n",
+		   nReaders, FIXED_ADDRS, NUM_DOMAINS, DESTS_PER_DOMAIN);
+	run("lock-free, idle", FALSE, FALSE, nReaders, seconds);
+	run("lock-free, busy", TRUE, FALSE, nReaders, seconds);
+	run("locked, idle", FALSE, TRUE, nReaders, seconds);
+	run("locked, busy", TRUE, TRUE, nReaders, seconds);
+	printf("%d socket indices in use at the end\n", (int)nAddrLimit);
+
+	if (nFailures != 0)
+	{
+		printf("FAIL: %d checks failed\n", nFailures);
+		return 1;
+	}
+	printf("PASS\n");
+	return 0;
+}
@@ -0,0 +1,349 @@
+/*
+ * LonLinkRxBench.cpp
+ *
+ * Copyright © 2022 Dialog Semiconductor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in 
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * Description: LonLink receive batching benchmark.
+ *
+ *  The program drives LonLink::receiveTask() from a fake layer 2 device
+ *  built on a socketpair, and counts how many received packets reach the
+ *  network layer and how many are counted as missed for want of a client
+ *  receive buffer.
+ *
+ *  The client queues a few receive buffers of each priority, and a separate
+ *  thread gives each buffer back to the link as soon as its packet has been
+ *  delivered, the way the network layer does.  Every eighth packet is
+ *  priority, except in the prio run.  The runs are:
+ *
+ *  paced   bursts no larger than the client's buffer count, each one
+ *          waited for before the next.  No packet may be missed.
+ *  prio    bursts of a full receive batch of priority packets, twice the
+ *          client's priority buffer count.  Each packet is handed over as
+ *          soon as it is read, and takes a normal buffer once the priority
+ *          ones are all with the client, so no packet may be missed.
+ *  burst8  bursts of a full receive batch against fewer buffers.
+ *  single  packets sent as fast as the socket takes them, read from the
+ *          driver one at a time.
+ *  flood   the same, read in batches.
+ *
+ *  Each run prints the packets delivered and missed, the rate packets were
+ *  sent at and the rate they were delivered at, and the flood run its
+ *  delivered rate relative to the single run.
+ *
+ *  Usage: LonLinkRxBench
+ *  Exits non-zero if the paced or prio run missed a packet.
+ */
+
+#include "LtStackInternal.h"
+#include "LonLink.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+
+#define CLIENT_BUFS		4			// receive buffers per priority
+#define PKT_LEN			20			// LPDU length
+#define PACED_PKTS		20000
+#define FLOOD_PKTS		200000
+
+static double nowSecs()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec/1e6;
+}
+
+//
+// A layer 2 device at the far end of a socketpair.  Every datagram
+// written by the test is one uplink SICB.
+//
+class FakeLonLink : public LonLink
+{
+public:
+	FakeLonLink() { m_fd[0] = m_fd[1] = -1; m_nMaxRead = RECEIVE_BATCH_SIZE; }
+
+	int  deviceFd()					{ return m_fd[1]; }
+	void setMaxRead(int nMaxRead)	{ m_nMaxRead = nMaxRead; }
+	virtual boolean isOpen()		{ return m_fd[0] != -1; }
+	virtual LtSts setCommParams(const LtCommParams& commParams)
+	{	return LtLinkBase::setCommParams(commParams);
+	}
+
+protected:
+	int	m_fd[2];
+	int	m_nMaxRead;					// most packets read from the driver at a time
+
+	virtual LtSts driverOpen(const char* pName)
+	{
+		int		size = 4*1024*1024;
+		if (socketpair(AF_UNIX, SOCK_SEQPACKET, 0, m_fd) != 0)
+		{	return LTSTS_OPENFAILURE;
+		}
+		setsockopt(m_fd[0], SOL_SOCKET, SO_RCVBUF, &size, sizeof(size));
+		fcntl(m_fd[0], F_SETFL, O_NONBLOCK);
+		return LTSTS_OK;
+	}
+	virtual void driverClose()
+	{
+		::close(m_fd[0]);
+		::close(m_fd[1]);
+		m_fd[0] = m_fd[1] = -1;
+	}
+	virtual LtSts driverRead(void *pData, short len)
+	{
+		return recv(m_fd[0], pData, len, 0) > 0 ? LTSTS_OK : LTSTS_ERROR;
+	}
+	virtual LtSts driverReadBatch(byte *pData, short len, int nMaxPkts, int &nPkts)
+	{
+		return LonLink::driverReadBatch(pData, len, nMaxPkts < m_nMaxRead ? nMaxPkts : m_nMaxRead, nPkts);
+	}
+	virtual LtSts driverWrite(void *pData, short len)
+	{	return LTSTS_OK;
+	}
+	virtual LtSts driverRegisterEvent()
+	{	return LTSTS_OK;
+	}
+	virtual void driverReceiveEvent()
+	{
+		struct pollfd	pfd;
+		pfd.fd = m_fd[0];
+		pfd.events = POLLIN;
+		poll(&pfd, 1, 20);
+	}
+	virtual void setPhaseMode(void)
+	{
+	}
+};
+
+//
+// The network layer.  Delivered buffers are handed to the requeue task,
+// which gives them back to the link.
+//
+class BenchNetwork : public LtNetwork
+{
+public:
+	BenchNetwork() : m_nReposted(0), m_nHead(0), m_nTail(0), m_bStop(false)
+	{
+		pthread_mutex_init(&m_mutex, NULL);
+		pthread_cond_init(&m_cond, NULL);
+	}
+	virtual void registerLink(LtLink& link)		{ m_pLink = &link; }
+	virtual void packetReceived(void* referenceId, int nLengthReceived, boolean bPriority,
+								int receivedSlot, boolean isValidLtPacket, byte l2PacketType,
+								LtSts sts, byte ssiReg1, byte ssiReg2)
+	{
+		pthread_mutex_lock(&m_mutex);
+		m_ring[m_nTail++ % RING] = (byte*)referenceId;
+		pthread_cond_broadcast(&m_cond);
+		pthread_mutex_unlock(&m_mutex);
+	}
+	virtual void resetRequested()								{}
+	virtual void flushCompleted()								{}
+	virtual void terminateCompleted()							{}
+	virtual void reportTransceiverRegister(int n, int value, LtSts sts)	{}
+	virtual void servicePinDepressed()							{}
+	virtual void servicePinReleased()							{}
+	virtual void packetComplete(void* referenceId, LtSts sts)	{}
+
+	void post(byte* pBuf)
+	{
+		boolean bPriority = pBuf[MAX_LPDU_SIZE];
+		m_pLink->queueReceive(pBuf, bPriority, 0, pBuf, MAX_LPDU_SIZE);
+	}
+	// requeue task body
+	void requeue()
+	{
+		pthread_mutex_lock(&m_mutex);
+		while (true)
+		{
+			while (m_nHead == m_nTail && !m_bStop)
+			{	pthread_cond_wait(&m_cond, &m_mutex);
+			}
+			if (m_nHead == m_nTail)
+			{	break;
+			}
+			byte* pBuf = m_ring[m_nHead++ % RING];
+			pthread_mutex_unlock(&m_mutex);
+			post(pBuf);
+			pthread_mutex_lock(&m_mutex);
+			m_nReposted++;
+			pthread_cond_broadcast(&m_cond);
+		}
+		pthread_mutex_unlock(&m_mutex);
+	}
+	// wait up to ms milliseconds for more buffers to be given back
+	unsigned waitReposted(unsigned nSeen, int ms)
+	{
+		struct timespec	ts;
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_nsec += ms*1000000L;
+		ts.tv_sec += ts.tv_nsec/1000000000L;
+		ts.tv_nsec %= 1000000000L;
+		pthread_mutex_lock(&m_mutex);
+		while (m_nReposted == nSeen &&
+			   pthread_cond_timedwait(&m_cond, &m_mutex, &ts) == 0)
+		{
+		}
+		nSeen = m_nReposted;
+		pthread_mutex_unlock(&m_mutex);
+		return nSeen;
+	}
+	void stop()
+	{
+		pthread_mutex_lock(&m_mutex);
+		m_bStop = true;
+		pthread_cond_broadcast(&m_cond);
+		pthread_mutex_unlock(&m_mutex);
+	}
+
+	enum { RING = 64 };
+	LtLink*				m_pLink;
+	volatile unsigned	m_nReposted;
+	unsigned			m_nHead;
+	unsigned			m_nTail;
+	byte*				m_ring[RING];
+	boolean				m_bStop;
+	pthread_mutex_t		m_mutex;
+	pthread_cond_t		m_cond;
+};
+
+static void* requeueTask(void* arg)
+{
+	((BenchNetwork*)arg)->requeue();
+	return NULL;
+}
+
+static ULONGLONG missedPackets(LtLinkBase& link)
+{
+	LtLinkStatsSnapshot	snap;
+	link.getStatisticsSnapshot(snap);
+	return snap.m_values[LT_LINK_STAT_MISSED_PACKETS];
+}
+
+//
+// Wait until nCount packets since the given base counts have either been
+// delivered and their buffers given back, or been counted as missed.
+//
+static void waitAccounted(FakeLonLink& link, BenchNetwork& net,
+						  unsigned nRepostedBase, ULONGLONG nMissedBase, unsigned nCount)
+{
+	unsigned	nReposted = net.m_nReposted;
+	int			nIdle = 0;
+
+	while (nReposted - nRepostedBase + (missedPackets(link) - nMissedBase) < nCount && nIdle < 100)
+	{
+		unsigned	n = net.waitReposted(nReposted, 10);
+		nIdle = n == nReposted ? nIdle+1 : 0;
+		nReposted = n;
+	}
+}
+
+//
+// Send nPkts uplink packets, every nPriority'th one priority.  With nBurst
+// non-zero, wait for each burst to be delivered before sending the next
+// one.  Returns the rate of packets delivered.
+//
+static double run(const char* title, FakeLonLink& link, BenchNetwork& net, int nPkts, int nBurst,
+				  int nPriority = 8)
+{
+	byte		sicb[2+PKT_LEN];
+	ULONGLONG	nMissed = missedPackets(link);
+	unsigned	nDelivered = net.m_nReposted;
+	double		t0 = nowSecs();
+	int			i;
+
+	memset(sicb, 0, sizeof(sicb));
+	sicb[0] = L2_PKT_TYPE_INCOMING;
+	sicb[1] = PKT_LEN;
+	for (i = 0; i < nPkts; i++)
+	{
+		sicb[2] = (i % nPriority) == 0 ? 0x80 : 0;
+		while (send(link.deviceFd(), sicb, sizeof(sicb), 0) < 0)
+		{	usleep(100);
+		}
+		if (nBurst && (i+1) % nBurst == 0)
+		{	waitAccounted(link, net, nDelivered, nMissed, i+1);
+		}
+	}
+	waitAccounted(link, net, nDelivered, nMissed, nPkts);
+
+	double	secs = nowSecs() - t0;
+	nDelivered = net.m_nReposted - nDelivered;
+	printf("%-6s %7d packets  %7u delivered  %6llu missed  %9.0f packets/s  %9.0f delivered/s\n",
+		   title, nPkts, nDelivered,
+		   (unsigned long long)(missedPackets(link) - nMissed), nPkts/secs, nDelivered/secs);
+	return nDelivered/secs;
+}
+
+int main(int argc, char* argv[])
+{
+	FakeLonLink&	link = *new FakeLonLink();
+	BenchNetwork&	net = *new BenchNetwork();
+	LtCommParams	commParams;
+	pthread_t		tid;
+	static byte		bufs[2*CLIENT_BUFS][MAX_LPDU_SIZE+1];
+	int				i;
+	ULONGLONG		nMissed;
+	double			singleRate;
+	double			floodRate;
+
+	link.registerNetwork(net);
+	link.setQueueDepths(CLIENT_BUFS, 4);
+	if (link.open("fake") != LTSTS_OK)
+	{
+		printf("open failed\n");
+		return 1;
+	}
+	link.setCommParams(commParams);
+	pthread_create(&tid, NULL, requeueTask, &net);
+	for (i = 0; i < 2*CLIENT_BUFS; i++)
+	{
+		bufs[i][MAX_LPDU_SIZE] = i >= CLIENT_BUFS;	// priority flag
+		net.post(bufs[i]);
+	}
+
+	printf("%d receive buffers per priority, batch size up to %d\n", CLIENT_BUFS, 8);
+	nMissed = missedPackets(link);
+	run("paced", link, net, PACED_PKTS, CLIENT_BUFS);
+	boolean bOk = missedPackets(link) == nMissed;
+	run("prio", link, net, PACED_PKTS/4, 2*CLIENT_BUFS, 1);
+	bOk = bOk && missedPackets(link) == nMissed;
+	run("burst8", link, net, PACED_PKTS, 8);
+	link.setMaxRead(1);
+	singleRate = run("single", link, net, FLOOD_PKTS, 0);
+	link.setMaxRead(8);
+	floodRate = run("flood", link, net, FLOOD_PKTS, 0);
+	printf("batched reads: %.2fx the delivered rate of single reads\n", floodRate/singleRate);
+
+	net.stop();
+	pthread_join(tid, NULL);
+	link.close();
+	delete &link;
+	delete &net;
+	printf("%s\n", bOk ? "PASS" : "FAIL - packets missed with free buffers");
+	return bOk ? 0 : 1;
+}
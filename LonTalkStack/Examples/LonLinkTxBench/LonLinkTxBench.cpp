@@ -0,0 +1,335 @@
+/*
+ * LonLinkTxBench.cpp
+ *
+ * Copyright © 2022 Dialog Semiconductor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in 
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * Description: LonLinkIzoT transmit latency under socket backpressure.
+ *
+ *  The program sends packets through LonLink::sendPacket() on a LonLinkIzoT
+ *  whose driver writes to a datagram socketpair with a small SO_SNDBUF.  A
+ *  reader thread at the far end takes one packet every READ_INTERVAL
+ *  microseconds, slower than the sender offers them, so the socket stays
+ *  full and most packets are queued by the link until there is room.
+ *
+ *  Each packet's latency is the time from its first sendPacket() call to
+ *  the return of sendPacket() if it went straight out, or to its
+ *  packetComplete() if it was queued.  Two runs are made:
+ *
+ *  drain   the driver reports the socket that refused a packet, so the
+ *          link's drain task sends queued packets as soon as it is
+ *          writable.
+ *  timer   the driver does not report it, so queued packets are only
+ *          retried once per retransmit period, the way the retransmit
+ *          timer used to send them.
+ *
+ *  Each run prints the packets sent straight out and queued, the median,
+ *  99th percentile and maximum latency, and the packet rate.
+ *
+ *  Usage: LonLinkTxBench [packets]
+ *  Exits non-zero if a packet is not completed, or if the drain run's 99th
+ *  percentile latency is not below the retransmit timer period.
+ */
+
+#include "LtStackInternal.h"
+#include "LonLinkIzoT.h"
+#include "VxSockets.h"
+#include "LtCUtil.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/socket.h>
+
+#define NUM_PKTS		5000
+#define PKT_LEN			40			// LPDU length
+#define SNDBUF_SIZE		4096		// SO_SNDBUF of the link's socket
+#define TX_QUEUE_DEPTH	16			// link transmit queue depth
+#define READ_INTERVAL	50			// microseconds between reads at the far end
+
+static int compareDoubles(const void* a, const void* b)
+{
+	double d = *(const double*)a - *(const double*)b;
+	return d < 0 ? -1 : d > 0 ? 1 : 0;
+}
+
+static double nowUsecs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec*1e6 + ts.tv_nsec/1e3;
+}
+
+//
+// A LonLinkIzoT whose driver writes each packet to one end of a datagram
+// socketpair, refusing it when the send buffer is full, as the IzoT
+// drivers do.  The other end is read by the test.
+//
+class BenchIzoTLink : public LonLinkIzoT
+{
+public:
+	BenchIzoTLink(boolean bReportBlocked) : m_bReportBlocked(bReportBlocked) { m_fd[0] = m_fd[1] = -1; }
+
+	int  deviceFd()					{ return m_fd[1]; }
+	virtual LtSts setCommParams(const LtCommParams& commParams)
+	{	return LonLinkIzoT::setCommParams(commParams);
+	}
+
+	virtual void sendAnnouncement(const uint8_t*, uint8_t)		{}
+	virtual LtSts setUnicastAddress(int stackIndex, int domainIndex, int subnetNodeIndex,
+									byte *domainId, int domainLen, byte subnetId, byte nodeId)
+	{	return LTSTS_OK;
+	}
+	virtual void deregisterStack(int stackIndex)				{}
+	virtual LtSts updateGroupMembership(int stackIndex, int domainIndex, LtGroups &groups)
+	{	return LTSTS_OK;
+	}
+	virtual int queryIpAddr(LtDomain &domain, byte subnetId, byte nodeId, byte *ipAddress)
+	{	return 0;
+	}
+	virtual void setLsAddrMappingConfig(int stackIndex, ULONG lsAddrMappingAnnounceFreq,
+										WORD lsAddrMappingAnnounceThrottle, ULONG lsAddrMappingAgeLimit)
+	{
+	}
+
+protected:
+	boolean	m_bReportBlocked;
+	int		m_fd[2];
+
+	virtual LtSts driverOpen(const char* pName)
+	{
+		int		size = SNDBUF_SIZE;
+		if (socketpair(AF_UNIX, SOCK_DGRAM, 0, m_fd) != 0)
+		{	return LTSTS_OPENFAILURE;
+		}
+		setsockopt(m_fd[0], SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+		fcntl(m_fd[0], F_SETFL, O_NONBLOCK);
+		m_isOpen = true;
+		return LTSTS_OK;
+	}
+	virtual void driverClose()
+	{
+		LonLinkIzoT::driverClose();
+		if (m_fd[0] != -1)
+		{
+			::close(m_fd[0]);
+			::close(m_fd[1]);
+			m_fd[0] = m_fd[1] = -1;
+		}
+	}
+	virtual LtSts driverRead(void *pData, short len)
+	{
+		return recv(m_fd[0], pData, len, 0) > 0 ? LTSTS_OK : LTSTS_ERROR;
+	}
+	virtual LtSts driverWrite(void *pData, short len)
+	{
+		int		nBytes = vxsSendNoWait(m_fd[0], (LPSTR)pData, len);
+		if (nBytes == len)
+		{	return LTSTS_OK;
+		}
+		if (nBytes == 0)
+		{
+			if (m_bReportBlocked)
+			{	m_txBlockedSocket = m_fd[0];
+			}
+			return LTSTS_QUEUEFULL;
+		}
+		return LTSTS_ERROR;
+	}
+	virtual void driverReceiveEvent()
+	{
+		struct pollfd	pfd;
+		pfd.fd = m_fd[0];
+		pfd.events = POLLIN;
+		poll(&pfd, 1, 20);
+	}
+};
+
+//
+// The network layer.  Records the completion time of each queued packet,
+// whose reference ID is its index.
+//
+class BenchNetwork : public LtNetwork
+{
+public:
+	BenchNetwork(double* pDone) : m_pDone(pDone), m_nCompleted(0), m_nFailed(0) {}
+	virtual void registerLink(LtLink& link)		{}
+	virtual void packetReceived(void* referenceId, int nLengthReceived, boolean bPriority,
+								int receivedSlot, boolean isValidLtPacket, byte l2PacketType,
+								LtSts sts, byte ssiReg1, byte ssiReg2)	{}
+	virtual void resetRequested()								{}
+	virtual void flushCompleted()								{}
+	virtual void terminateCompleted()							{}
+	virtual void reportTransceiverRegister(int n, int value, LtSts sts)	{}
+	virtual void servicePinDepressed()							{}
+	virtual void servicePinReleased()							{}
+	virtual void packetComplete(void* referenceId, LtSts sts)
+	{
+		m_pDone[(intptr_t)referenceId] = nowUsecs();
+		if (sts != LTSTS_OK)
+		{	m_nFailed++;
+		}
+		__sync_fetch_and_add(&m_nCompleted, 1);
+	}
+
+	double*			m_pDone;
+	volatile int	m_nCompleted;
+	int				m_nFailed;
+};
+
+static volatile boolean bStopReader;
+
+// far end reader task body: one packet per READ_INTERVAL
+static void* readerTask(void* arg)
+{
+	int		fd = *(int*)arg;
+	byte	buf[MAX_LPDU_SIZE+10];
+
+	while (!bStopReader)
+	{
+		struct pollfd	pfd;
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+		if (poll(&pfd, 1, 20) > 0)
+		{
+			recv(fd, buf, sizeof(buf), MSG_DONTWAIT);
+			usleep(READ_INTERVAL);
+		}
+	}
+	return NULL;
+}
+
+//
+// Send nPkts packets through a new link and print the latencies.  Returns
+// the 99th percentile latency in microseconds, or -1 if a packet was lost.
+//
+static double run(const char* title, boolean bReportBlocked, int nPkts)
+{
+	BenchIzoTLink&	link = *new BenchIzoTLink(bReportBlocked);
+	double*			pStart = new double[nPkts];
+	double*			pDone = new double[nPkts];
+	BenchNetwork&	net = *new BenchNetwork(pDone);
+	LtCommParams	commParams;
+	byte			lpdu[PKT_LEN];
+	int				nQueued = 0;
+	int				nRefused = 0;
+	pthread_t		tid;
+	double			p99 = -1;
+	int				i;
+
+	link.registerNetwork(net);
+	link.setQueueDepths(4, TX_QUEUE_DEPTH);
+	if (link.open("bench") != LTSTS_OK)
+	{
+		printf("%-6s open failed\n", title);
+		return -1;
+	}
+	link.setCommParams(commParams);
+	int fd = link.deviceFd();
+	bStopReader = false;
+	pthread_create(&tid, NULL, readerTask, &fd);
+
+	memset(lpdu, 0, sizeof(lpdu));
+	double	t0 = nowUsecs();
+	for (i = 0; i < nPkts; i++)
+	{
+		LtSts	sts;
+
+		pStart[i] = nowUsecs();
+		pDone[i] = 0;
+		while ((sts = link.sendPacket((void*)(intptr_t)i, -1, 0, lpdu, sizeof(lpdu), false)) == LTSTS_QUEUEFULL)
+		{
+			// The link's queue is full too; wait for it like a network layer
+			nRefused++;
+			usleep(100);
+		}
+		if (sts == LTSTS_OK)
+		{
+			pDone[i] = nowUsecs();
+		}
+		else if (sts == LTSTS_PENDING)
+		{
+			nQueued++;
+		}
+		else
+		{
+			printf("%-6s sendPacket failed with %d\n", title, sts);
+			break;
+		}
+	}
+	double	deadline = nowUsecs() + 5e6;
+	while (net.m_nCompleted < nQueued && nowUsecs() < deadline)
+	{
+		usleep(1000);
+	}
+	double	secs = (nowUsecs() - t0)/1e6;
+
+	bStopReader = true;
+	pthread_join(tid, NULL);
+	link.close();
+
+	if (i == nPkts && net.m_nCompleted == nQueued && net.m_nFailed == 0)
+	{
+		for (i = 0; i < nPkts; i++)
+		{
+			pStart[i] = pDone[i] - pStart[i];
+		}
+		qsort(pStart, nPkts, sizeof(double), compareDoubles);
+		p99 = pStart[(nPkts*99)/100];
+		printf("%-6s %6d direct %6d queued  median %8.1f  p99 %8.1f  max %8.1f us  %7.0f packets/s\n",
+			   title, nPkts - nQueued, nQueued, pStart[nPkts/2], p99, pStart[nPkts-1], nPkts/secs);
+	}
+	else
+	{
+		printf("%-6s %d of %d queued packets completed, %d failed\n",
+			   title, net.m_nCompleted, nQueued, net.m_nFailed);
+	}
+
+	delete &link;
+	delete &net;
+	delete[] pStart;
+	delete[] pDone;
+	return p99;
+}
+
+int main(int argc, char* argv[])
+{
+	int		nPkts = argc > 1 ? atoi(argv[1]) : NUM_PKTS;
+
+	if (nPkts <= 0)
+	{
+		printf("FAIL - bad packet count\n");
+		return 1;
+	}
+	printf("SO_SNDBUF %d, transmit queue %d, far end reads every %d us\n",
+		   SNDBUF_SIZE, TX_QUEUE_DEPTH, READ_INTERVAL);
+	double	p99Drain = run("drain", true, nPkts);
+	double	p99Timer = run("timer", false, nPkts);
+
+	boolean	bOk = p99Drain >= 0 && p99Timer >= 0 &&
+				  p99Drain < ticksToMs(LON_LINK_IZOT_RETRANSMIT_TICKS)*1000;
+	printf("%s\n", bOk ? "PASS" : "FAIL");
+	return bOk ? 0 : 1;
+}
@@ -0,0 +1,338 @@
+/*
+ * LsUdpMapTest.cpp
+ *
+ * Copyright © 2022 Dialog Semiconductor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in 
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * Description: LS/UDP address mapping equivalence test.
+ *
+ *  LonLinkIzoT caches the outcome of getArbitraryDestAddress for each LS
+ *  destination, and throws the cache away whenever the LS/IP mapping
+ *  changes.  This program checks that the cached lookup gives exactly the
+ *  same answers as the uncached one.
+ *
+ *  A test link applies a random stream of mapping updates: arbitrary
+ *  addresses set, changed and removed, derived addresses learned, subnet
+ *  announcements and aging.  After each update a random subnet/node
+ *  addressed LTVX NPDU is converted to LS/UDP with
+ *  ipv6_convert_ltvx_to_ls_udp() twice, once through the cache and once
+ *  through the uncached lookup, and the two outputs must match byte for
+ *  byte, destination address included.  The LS/UDP packet is then
+ *  converted back with ipv6_convert_ls_udp_to_ltvx() and must give the
+ *  original NPDU.
+ *
+ *  Refreshing an arbitrary address that hasn't changed must not count as
+ *  a mapping change, so the test also checks that doing so leaves the
+ *  cache valid.
+ *
+ *  Usage: LsUdpMapTest [iterations] [seed]
+ *  Exits non-zero on the first mismatch.
+ */
+
+#include "LtStackInternal.h"
+#include "LonLinkIzoT.h"
+#include "IzoTLsIpMapping.h"
+
+extern "C"
+{
+#include "ipv6_ls_to_udp.h"
+}
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_DOMAINS		3
+#define NUM_SUBNETS		6			// subnets 1 to NUM_SUBNETS
+#define NUM_NODES		12			// nodes 1 to NUM_NODES
+#define MAX_NPDU		64
+
+// IPV4 LS/UDP carries at most two bytes of the domain ID, so the domains
+// used are the ones that survive the trip.  The third byte of a three byte
+// domain must be zero.
+static const byte domainLen[NUM_DOMAINS] = { 0, 1, 3 };
+static const byte domainId[NUM_DOMAINS][3] = { { 0 }, { 0x22 }, { 0x33, 0x44, 0 } };
+static const byte domainLenCode[NUM_DOMAINS] = { 0, 1, 2 };
+
+//
+// A LonLinkIzoT with no device behind it.  When m_bUncached is set,
+// getArbitraryDestAddress does the lookup the way it was done before the
+// destination cache existed.
+//
+class MapTestLink : public LonLinkIzoT
+{
+public:
+	MapTestLink() : m_bUncached(false) {}
+
+	boolean	m_bUncached;
+
+	ULONG	generation()	{ return m_lsIpMapGeneration; }
+	void	age()			{ agingTimerRoutine(); }
+
+	virtual uint8_t getArbitraryDestAddress(const uint8_t *pDomainId, uint8_t domainLen,
+											uint8_t subnetId, uint8_t nodeId, uint8_t ipv1AddrFmt,
+											uint8_t *pDestIpAddress, uint8_t *pEnclosedDest)
+	{
+		if (!m_bUncached)
+		{
+			return LonLinkIzoT::getArbitraryDestAddress(pDomainId, domainLen, subnetId, nodeId,
+														ipv1AddrFmt, pDestIpAddress, pEnclosedDest);
+		}
+
+		uint8_t useDerivedAddress = false;
+		void *pArbitraryIpAddr = NULL;
+		IzoTLsIpMappingSubnetInfo *p = findLsIpMapSubnetInfo(pDomainId, domainLen, false);
+		if (p != NULL)
+		{
+			if (p->getLsDerivedIpAddr(subnetId, nodeId & 0x7f))
+			{
+				useDerivedAddress = true;
+			}
+			else
+			{
+				pArbitraryIpAddr = p->getArbitraryIpAddr(subnetId, nodeId & 0x7f);
+				if (pArbitraryIpAddr)
+				{
+					memcpy(pDestIpAddress, pArbitraryIpAddr, IPV4_ADDRESS_LEN);
+				}
+			}
+		}
+		if (!useDerivedAddress)
+		{
+			pEnclosedDest[0] = subnetId;
+			pEnclosedDest[1] = nodeId & 0x7f;
+			if (ipv1AddrFmt == IPV6_LSUDP_NPDU_ADDR_FMT_GROUP_RESP)
+			{
+				pEnclosedDest[1] |= 0x80;
+			}
+			if (pArbitraryIpAddr == NULL)
+			{
+				ipv6_gen_ls_mc_addr(LT_AF_BROADCAST, subnetId, pDestIpAddress);
+			}
+		}
+		return !useDerivedAddress;
+	}
+
+	virtual void sendAnnouncement(const uint8_t *ltV0msg, uint8_t msgLen)	{}
+	virtual LtSts setUnicastAddress(int stackIndex, int domainIndex, int subnetNodeIndex,
+									byte *domainId, int domainLen, byte subnetId, byte nodeId)
+	{	return LTSTS_OK;
+	}
+	virtual void deregisterStack(int stackIndex)	{}
+	virtual LtSts updateGroupMembership(int stackIndex, int domainIndex, LtGroups &groups)
+	{	return LTSTS_OK;
+	}
+	virtual int queryIpAddr(LtDomain &domain, byte subnetId, byte nodeId, byte *ipAddress)
+	{	return 0;
+	}
+	virtual void setLsAddrMappingConfig(int stackIndex, ULONG lsAddrMappingAnnounceFreq,
+										WORD lsAddrMappingAnnounceThrottle, ULONG lsAddrMappingAgeLimit)
+	{
+	}
+
+protected:
+	virtual LtSts driverOpen(const char* pName)			{ return LTSTS_OK; }
+	virtual LtSts driverRead(void *pData, short len)	{ return LTSTS_ERROR; }
+	virtual LtSts driverWrite(void *pData, short len)	{ return LTSTS_OK; }
+};
+
+static int pick(int n)
+{
+	return rand() % n;
+}
+
+static void dump(const char* pTitle, const byte* p, int len)
+{
+	printf("  %-8s", pTitle);
+	for (int i = 0; i < len; i++)
+	{
+		printf(" %02x", p[i]);
+	}
+	printf("\n");
+}
+
+// Apply one random update to the LS/IP mapping.
+static void randomUpdate(MapTestLink& link)
+{
+	int		d = pick(NUM_DOMAINS);
+	byte	subnet = 1 + pick(NUM_SUBNETS);
+	byte	node = 1 + pick(NUM_NODES);
+	byte	ipAddr[IPV4_ADDRESS_LEN] = { 10, 0, (byte)(1 + pick(2)), (byte)(1 + pick(4)) };
+	byte	subnets[32];
+
+	switch (pick(10))
+	{
+	case 0: case 1: case 2: case 3:
+		link.setArbitraryAddressMapping(ipAddr, domainId[d], domainLen[d], subnet, node);
+		break;
+	case 4:
+		link.setArbitraryAddressMapping(NULL, domainId[d], domainLen[d], subnet, node);
+		break;
+	case 5: case 6: case 7:
+		link.setDerivedAddressMapping(domainId[d], domainLen[d], subnet, node);
+		break;
+	case 8:
+		memset(subnets, 0, sizeof(subnets));
+		subnets[subnet/8] = 1 << (subnet%8);
+		link.setDerivedSubnetsMapping(domainId[d], domainLen[d], pick(2), subnets);
+		break;
+	default:
+		link.age();
+		break;
+	}
+}
+
+// Build a random subnet/node addressed APDU.  Returns its length.
+static int randomNpdu(byte* pNpdu)
+{
+	int		d = pick(NUM_DOMAINS);
+	boolean	bGroupResp = pick(4) == 0;
+	int		len = 0;
+
+	pNpdu[len++] = pick(2) ? IPV6_LTVX_NPDU_MASK_PRIORITY : 0;
+	pNpdu[len++] = ((pick(2) ? IPV6_LT_VER_ENHANCED : IPV6_LT_VER_LEGACY) << IPV6_LTVX_NPDU_BITPOS_VER) |
+				   (ENCLOSED_PDU_TYPE_APDU << IPV6_LTVX_NPDU_BITPOS_PDUFMT) |
+				   (LT_AF_SUBNET_NODE << IPV6_LTVX_NPDU_BITPOS_ADDRTYPE) |
+				   domainLenCode[d];
+	pNpdu[len++] = 1 + pick(NUM_SUBNETS);
+	pNpdu[len++] = (1 + pick(NUM_NODES)) | (bGroupResp ? 0 : 0x80);
+	pNpdu[len++] = 1 + pick(NUM_SUBNETS);
+	pNpdu[len++] = (1 + pick(NUM_NODES)) | 0x80;
+	if (bGroupResp)
+	{
+		pNpdu[len++] = pick(256);		// group
+		pNpdu[len++] = pick(64);		// member
+	}
+	memcpy(&pNpdu[len], domainId[d], domainLen[d]);
+	len += domainLen[d];
+	int	apduLen = 1 + pick(16);
+	for (int i = 0; i < apduLen; i++)
+	{
+		pNpdu[len++] = pick(256);
+	}
+	// Keep clear of the address mapping announcements, which the receive
+	// side acts on.
+	if (pNpdu[len-apduLen] == IPV6_EXP_MSG_CODE)
+	{
+		pNpdu[len-apduLen]++;
+	}
+	return len;
+}
+
+int main(int argc, char* argv[])
+{
+	int		nIterations = argc > 1 ? atoi(argv[1]) : 200000;
+	int		seed = argc > 2 ? atoi(argv[2]) : 1;
+	int		nArbitrary = 0;
+	int		nDerived = 0;
+	int		nRefreshes = 0;
+
+	MapTestLink&	link = *new MapTestLink();
+	srand(seed);
+
+	for (int n = 0; n < nIterations; n++)
+	{
+		byte		npdu[MAX_NPDU];
+		byte		cached[MAX_NPDU];
+		byte		uncached[MAX_NPDU];
+		byte		back[MAX_NPDU];
+		byte		srcAddr[2][IPV4_ADDRESS_LEN];
+		byte		dstAddr[2][IPV4_ADDRESS_LEN];
+		uint16_t	srcPort, dstPort;
+		uint16_t	len[2], backLen;
+
+		randomUpdate(link);
+
+		int npduLen = randomNpdu(npdu);
+		memcpy(cached, npdu, npduLen);
+		memcpy(uncached, npdu, npduLen);
+		link.m_bUncached = false;
+		len[0] = ipv6_convert_ltvx_to_ls_udp(cached, npduLen, srcAddr[0], &srcPort,
+											 dstAddr[0], &dstPort, &link);
+		link.m_bUncached = true;
+		len[1] = ipv6_convert_ltvx_to_ls_udp(uncached, npduLen, srcAddr[1], &srcPort,
+											 dstAddr[1], &dstPort, &link);
+		link.m_bUncached = false;
+
+		if (len[0] != len[1] || memcmp(cached, uncached, len[0]) != 0 ||
+			memcmp(srcAddr[0], srcAddr[1], IPV4_ADDRESS_LEN) != 0 ||
+			memcmp(dstAddr[0], dstAddr[1], IPV4_ADDRESS_LEN) != 0)
+		{
+			printf("FAIL - cached and uncached LS/UDP differ at iteration %d\n", n);
+			dump("npdu", npdu, npduLen);
+			dump("cached", cached, len[0]);
+			dump("uncached", uncached, len[1]);
+			dump("dest", dstAddr[0], IPV4_ADDRESS_LEN);
+			dump("dest", dstAddr[1], IPV4_ADDRESS_LEN);
+			return 1;
+		}
+		if ((cached[1] & IPV6_LSUDP_NPDU_MASK_ADDRFMT) == IPV6_LSUDP_NPDU_ADDR_FMT_EXP_SUBNET_NODE)
+		{
+			nArbitrary += dstAddr[0][0] == 10;
+		}
+		else
+		{
+			nDerived++;
+		}
+
+		// Send it back the other way.  Sending a packet teaches the far end
+		// the source mapping, so the receive side does that to this link.
+		ipv6_convert_ls_udp_to_ltvx(false, cached, len[0], srcAddr[0], srcPort,
+									dstAddr[0], dstPort, back, &backLen, &link);
+		if (backLen != npduLen || memcmp(back, npdu, npduLen) != 0)
+		{
+			// Only the priority bit of the first byte is carried in an APDU.
+			printf("FAIL - LS/UDP round trip differs at iteration %d\n", n);
+			dump("npdu", npdu, npduLen);
+			dump("ls/udp", cached, len[0]);
+			dump("back", back, backLen);
+			return 1;
+		}
+
+		// Refreshing the arbitrary address a device already has must keep
+		// the cache valid.
+		int	d = pick(NUM_DOMAINS);
+		byte subnet = 1 + pick(NUM_SUBNETS);
+		byte node = 1 + pick(NUM_NODES);
+		byte enclosed[2];
+		byte ipAddr[IPV4_ADDRESS_LEN];
+		link.m_bUncached = true;
+		if (link.getArbitraryDestAddress(domainId[d], domainLen[d], subnet, node,
+										 IPV6_LSUDP_NPDU_ADDR_FMT_SUBNET_NODE, ipAddr, enclosed) &&
+			ipAddr[0] == 10)
+		{
+			ULONG generation = link.generation();
+			link.setArbitraryAddressMapping(ipAddr, domainId[d], domainLen[d], subnet, node);
+			if (link.generation() != generation)
+			{
+				printf("FAIL - refreshing an unchanged arbitrary address invalidated the cache\n");
+				return 1;
+			}
+			nRefreshes++;
+		}
+		link.m_bUncached = false;
+	}
+
+	delete &link;
+	printf("%d iterations: %d to arbitrary addresses, %d to derived addresses, %d refreshes\n",
+		   nIterations, nArbitrary, nDerived, nRefreshes);
+	printf("PASS\n");
+	return 0;
+}
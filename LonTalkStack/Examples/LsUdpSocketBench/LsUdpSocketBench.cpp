@@ -0,0 +1,451 @@
+/*
+ * LsUdpSocketBench.cpp
+ *
+ * Copyright © 2022 Dialog Semiconductor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in 
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * Description: LS/IP socket path benchmark: UDP sockets against raw sockets.
+ *
+ *  LonLinkIzoTDev used to send and receive LS/IP packets on raw IPPROTO_UDP
+ *  sockets.  It built the IP and UDP headers and the IP checksum for every
+ *  packet it sent, and every raw socket received a copy of every UDP
+ *  datagram on the host, whose headers it parsed to throw away those not for
+ *  the LS/IP port.  It now uses UDP sockets bound to the address and port,
+ *  and reads the destination address through IP_PKTINFO.
+ *
+ *  The program sends LS/IP sized packets over the loopback interface both
+ *  ways.  The sender keeps at most WINDOW packets in flight so that none are
+ *  dropped, and sends NOISE datagrams to another port for each packet, as
+ *  other UDP traffic on the host.  Each run prints the packets per second
+ *  and the sender and receiver CPU time per packet.
+ *
+ *  udp   a UDP socket bound to the source address and port sends with
+ *  vxsSendToNoWait(), and one bound to the destination receives with
+ *  vxsRecvFromDest(), as LonLinkIzoTDev does now.
+ *  raw   an IP_HDRINCL raw socket sends headers built as the old driverWrite
+ *  built them, and a raw IPPROTO_UDP socket receives and filters by
+ *  destination address and port, as the old driverRead did.  Needs
+ *  CAP_NET_RAW; skipped without it.
+ *
+ *  Usage: LsUdpSocketBench [packets [noise [port]]]
+ *  Exits non-zero if the UDP run loses or corrupts a packet, or reports the
+ *  wrong source port or destination address.
+ */
+
+#include "LtStackInternal.h"
+#include "VxSockets.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/ip.h>
+#include <netinet/udp.h>
+#include <arpa/inet.h>
+
+#define PACKETS			200000
+#define NOISE			1			// other UDP datagrams per packet
+#define LS_PORT			28541		// stands in for the LS/IP port
+#define SOURCE_PORT		28542
+#define NOISE_PORT		28543
+#define PAYLOAD_LEN		40			// a typical LS/UDP NV update
+#define WINDOW			64			// packets in flight
+#define SOURCE_ADDR		0x7F000002	// 127.0.0.2
+#define DEST_ADDR		0x7F000003	// 127.0.0.3
+#define TIMEOUT			10			// seconds without progress
+
+static int nPackets = PACKETS;
+static int nNoise = NOISE;
+static int lsPort = LS_PORT;
+
+static volatile int nReceived;
+static volatile int nBad;
+static volatile bool bStop;
+
+static double nowSecs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec/1e9;
+}
+
+static double threadCpuSecs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+	return ts.tv_sec + ts.tv_nsec/1e9;
+}
+
+static void fillPayload(unsigned char* p, int seq)
+{
+	memset(p, 0, PAYLOAD_LEN);
+	p[0] = 0x10;
+	memcpy(p + 4, &seq, sizeof(seq));
+	for (int i = 4 + sizeof(seq); i < PAYLOAD_LEN; i++)
+	{
+		p[i] = (unsigned char)(seq + i);
+	}
+}
+
+static bool checkPayload(const unsigned char* p, int len, int seq)
+{
+	unsigned char expected[PAYLOAD_LEN];
+
+	fillPayload(expected, seq);
+	return len == PAYLOAD_LEN && memcmp(p, expected, PAYLOAD_LEN) == 0;
+}
+
+// The IP header checksum, as the old driverWrite computed it.
+static unsigned short checksum(unsigned short* addr, int len)
+{
+	unsigned int sum = 0;
+
+	while (len > 1)
+	{
+		sum += *addr++;
+		len -= 2;
+	}
+	if (len > 0)
+	{
+		sum += *(unsigned char*)addr;
+	}
+	while (sum >> 16)
+	{
+		sum = (sum & 0xFFFF) + (sum >> 16);
+	}
+	return (unsigned short)~sum;
+}
+
+static VXSOCKET udpSocket(ULONG addr, int port)
+{
+	VXSOCKET s = vxsSocket(VXSOCK_DGRAM);
+	VXSOCKADDR sa;
+	int on = 1;
+
+	if (s == INVALID_SOCKET)
+	{
+		return s;
+	}
+	setsockopt(s, IPPROTO_IP, IP_PKTINFO, &on, sizeof(on));
+	setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	sa = vxsAddrValue(addr);
+	vxsSetPort(sa, (unsigned short)port);
+	if (vxsBind(s, sa) != OK)
+	{
+		perror("bind");
+		vxsCloseSocket(s);
+		s = INVALID_SOCKET;
+	}
+	vxsFreeSockaddr(sa);
+	return s;
+}
+
+//
+// The receiving end of a run.
+//
+struct Receiver
+{
+	bool bRaw;
+	int fd;
+	double cpu;
+	int nDiscarded;
+};
+
+static void* udpReceive(Receiver* pRx)
+{
+	VXSOCKADDR source = vxsGetSockaddr();
+	char buf[1500];
+
+	while (!bStop)
+	{
+		ULONG destAddr = 0;
+		int len = vxsRecvFromDest(pRx->fd, buf, sizeof(buf), 0, source, &destAddr);
+
+		if (len <= 0)
+		{
+			continue;
+		}
+		if (!checkPayload((unsigned char*)buf, len, nReceived) ||
+			vxsAddrGetPort(source) != SOURCE_PORT ||
+			vxsAddrGetAddr(source) != SOURCE_ADDR ||
+			destAddr != htonl(DEST_ADDR))
+		{
+			nBad++;
+		}
+		__sync_fetch_and_add(&nReceived, 1);
+	}
+	vxsFreeSockaddr(source);
+	return NULL;
+}
+
+static void* rawReceive(Receiver* pRx)
+{
+	char buf[1500];
+
+	while (!bStop)
+	{
+		int len = recv(pRx->fd, buf, sizeof(buf), 0);
+		struct iphdr* pIpHdr = (struct iphdr*)buf;
+		struct udphdr* pUdpHdr = (struct udphdr*)(buf + sizeof(struct iphdr));
+		unsigned char* pPayload = (unsigned char*)(pUdpHdr + 1);
+
+		if (len < (int)(sizeof(struct iphdr) + sizeof(struct udphdr)))
+		{
+			continue;
+		}
+		if (pIpHdr->protocol != IPPROTO_UDP || pUdpHdr->dest != htons(lsPort) ||
+			pIpHdr->daddr != htonl(DEST_ADDR))
+		{
+			// Somebody else's datagram
+			pRx->nDiscarded++;
+			continue;
+		}
+		if (!checkPayload(pPayload, ntohs(pUdpHdr->len) - sizeof(struct udphdr), nReceived) ||
+			pUdpHdr->source != htons(SOURCE_PORT) || pIpHdr->saddr != htonl(SOURCE_ADDR))
+		{
+			nBad++;
+		}
+		__sync_fetch_and_add(&nReceived, 1);
+	}
+	return NULL;
+}
+
+static void* receiveTask(void* arg)
+{
+	Receiver* pRx = (Receiver*)arg;
+	struct timeval tv = { 0, 100000 };
+	double start;
+
+	setsockopt(pRx->fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	start = threadCpuSecs();
+	if (pRx->bRaw)
+	{
+		rawReceive(pRx);
+	}
+	else
+	{
+		udpReceive(pRx);
+	}
+	pRx->cpu = threadCpuSecs() - start;
+	return NULL;
+}
+
+//
+// Send one packet on the raw socket, building the headers the way the old
+// driverWrite did.
+//
+static bool rawSend(int fd, int seq)
+{
+	unsigned char msgBuffer[sizeof(struct iphdr) + sizeof(struct udphdr) + PAYLOAD_LEN];
+	struct iphdr* pIpHdr = (struct iphdr*)msgBuffer;
+	struct udphdr* pUdpHdr = (struct udphdr*)(msgBuffer + sizeof(struct iphdr));
+	struct sockaddr_in dest;
+	int msglen = sizeof(msgBuffer);
+
+	fillPayload((unsigned char*)(pUdpHdr + 1), seq);
+	memset(pIpHdr, 0, sizeof(*pIpHdr));
+	pIpHdr->ihl = 5;
+	pIpHdr->version = 4;
+	pIpHdr->tot_len = htons(msglen);
+	pIpHdr->ttl = 64;
+	pIpHdr->protocol = IPPROTO_UDP;
+	pIpHdr->saddr = htonl(SOURCE_ADDR);
+	pIpHdr->daddr = htonl(DEST_ADDR);
+	pUdpHdr->source = htons(SOURCE_PORT);
+	pUdpHdr->dest = htons(lsPort);
+	pUdpHdr->len = htons(sizeof(struct udphdr) + PAYLOAD_LEN);
+	pUdpHdr->check = 0;
+	pIpHdr->check = checksum((unsigned short*)msgBuffer, sizeof(struct iphdr));
+
+	memset(&dest, 0, sizeof(dest));
+	dest.sin_family = AF_INET;
+	dest.sin_addr.s_addr = pIpHdr->daddr;
+	return sendto(fd, msgBuffer, msglen, 0, (struct sockaddr*)&dest, sizeof(dest)) == msglen;
+}
+
+//
+// Make one run.  Returns false if it could not be set up.
+//
+static bool run(bool bRaw)
+{
+	Receiver rx;
+	VXSOCKET txUdp = INVALID_SOCKET;
+	int txRaw = -1;
+	VXSOCKET noiseTx, noiseRx;
+	VXSOCKADDR dest, noiseDest;
+	pthread_t thread;
+	double start, elapsed, txCpu, lastProgress;
+	int lastReceived = 0;
+	int nSent = 0;
+	bool bTimedOut = false;
+
+	memset(&rx, 0, sizeof(rx));
+	rx.bRaw = bRaw;
+	if (bRaw)
+	{
+		int on = 1;
+
+		rx.fd = socket(AF_INET, SOCK_RAW, IPPROTO_UDP);
+		txRaw = socket(AF_INET, SOCK_RAW, IPPROTO_UDP);
+		if (rx.fd < 0 || txRaw < 0 || setsockopt(txRaw, IPPROTO_IP, IP_HDRINCL, &on, sizeof(on)) < 0)
+		{
+			printf("raw   skipped: %s\n", strerror(errno));
+			if (rx.fd >= 0)
+				close(rx.fd);
+			if (txRaw >= 0)
+				close(txRaw);
+			return false;
+		}
+	}
+	else
+	{
+		rx.fd = udpSocket(DEST_ADDR, lsPort);
+		txUdp = udpSocket(SOURCE_ADDR, SOURCE_PORT);
+		if (rx.fd == INVALID_SOCKET || txUdp == INVALID_SOCKET)
+		{
+			printf("FAIL: can't open the UDP sockets\n");
+			nBad++;
+			return false;
+		}
+	}
+	// The noise goes to a socket nobody reads; once it is full the kernel
+	// drops it, after every raw socket has had its copy.
+	noiseTx = udpSocket(SOURCE_ADDR, 0);
+	noiseRx = udpSocket(DEST_ADDR, NOISE_PORT);
+	dest = vxsAddrValue(DEST_ADDR);
+	vxsSetPort(dest, (unsigned short)lsPort);
+	noiseDest = vxsAddrValue(DEST_ADDR);
+	vxsSetPort(noiseDest, NOISE_PORT);
+
+	nReceived = 0;
+	bStop = false;
+	pthread_create(&thread, NULL, receiveTask, &rx);
+
+	start = nowSecs();
+	lastProgress = start;
+	txCpu = threadCpuSecs();
+	while (nSent < nPackets && !bTimedOut)
+	{
+		char noise[PAYLOAD_LEN];
+
+		if (nSent - nReceived >= WINDOW)
+		{
+			if (nReceived != lastReceived)
+			{
+				lastReceived = nReceived;
+				lastProgress = nowSecs();
+			}
+			else if (nowSecs() - lastProgress > TIMEOUT)
+			{
+				bTimedOut = true;
+			}
+			sched_yield();
+			continue;
+		}
+		for (int i = 0; i < nNoise; i++)
+		{
+			memset(noise, i, sizeof(noise));
+			vxsSendToNoWait(noiseTx, noise, sizeof(noise), noiseDest);
+		}
+		if (bRaw)
+		{
+			rawSend(txRaw, nSent);
+		}
+		else
+		{
+			unsigned char payload[PAYLOAD_LEN];
+
+			fillPayload(payload, nSent);
+			vxsSendToNoWait(txUdp, (LPSTR)payload, PAYLOAD_LEN, dest);
+		}
+		nSent++;
+	}
+	txCpu = threadCpuSecs() - txCpu;
+	lastProgress = nowSecs();
+	while (nReceived < nSent && nowSecs() - lastProgress < 1)
+	{
+		usleep(1000);
+	}
+	elapsed = nowSecs() - start;
+	bStop = true;
+	pthread_join(thread, NULL);
+
+	printf("%-5s %8d pkts  %8.0f pkts/s  tx %5.2f us/pkt  rx %5.2f us/pkt  discarded %d\n",
+		   bRaw ? "raw" : "udp", nReceived, nReceived/elapsed,
+		   txCpu*1e6/nSent, rx.cpu*1e6/nSent, rx.nDiscarded);
+	if (!bRaw && nReceived != nPackets)
+	{
+		printf("FAIL: udp received %d of %d packets\n", nReceived, nPackets);
+		nBad++;
+	}
+
+	vxsFreeSockaddr(dest);
+	vxsFreeSockaddr(noiseDest);
+	vxsCloseSocket(noiseTx);
+	vxsCloseSocket(noiseRx);
+	if (bRaw)
+	{
+		close(rx.fd);
+		close(txRaw);
+	}
+	else
+	{
+		vxsCloseSocket(rx.fd);
+		vxsCloseSocket(txUdp);
+	}
+	return true;
+}
+
+int main(int argc, char* argv[])
+{
+	nPackets = argc > 1 ? atoi(argv[1]) : PACKETS;
+	nNoise = argc > 2 ? atoi(argv[2]) : NOISE;
+	lsPort = argc > 3 ? atoi(argv[3]) : LS_PORT;
+	if (nPackets <= 0 || nNoise < 0 || lsPort <= 0)
+	{
+		printf("FAIL: bad arguments\n");
+		return 1;
+	}
+	printf("%d packets of %d bytes, %d other datagrams per packet\n", nPackets, PAYLOAD_LEN, nNoise);
+
+	run(false);
+	if (nBad == 0)
+	{
+		int nUdpBad = nBad;
+
+		run(true);
+		// The raw run is only for comparison.
+		nBad = nUdpBad;
+	}
+
+	if (nBad != 0)
+	{
+		printf("FAIL: %d bad packets on the UDP path\n", nBad);
+		return 1;
+	}
+	printf("PASS\n");
+	return 0;
+}
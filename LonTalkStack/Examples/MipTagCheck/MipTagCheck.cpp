@@ -0,0 +1,254 @@
+/*
+ * MipTagCheck.cpp
+ *
+ * Copyright © 2022 Dialog Semiconductor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in 
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * Description: Check of the L5 MIP request tag table.
+ *
+ *  LtMipApp hands each incoming request to the host with a 4 bit SICB tag,
+ *  and matches the host's response to the request by that tag.  The tags
+ *  are kept by an LtMipTagTable, which this program drives directly:
+ *
+ *  - reuse     a tag freed by a response is the next one handed out, and
+ *  every tag in service is handed out before one is reused.
+ *  - expiry    a request older than the expiry limit is dropped, and its
+ *  tag is quarantined: every other free tag is handed out
+ *  before it, and a late response for it finds no request
+ *  and is counted.
+ *  - eviction  with every tag in use, a new request takes the oldest
+ *  one's tag at once, without quarantine.
+ *  - random    a random mix of requests, responses, late responses and
+ *  expiries checked against a simple model of the table.
+ *
+ *  Usage: MipTagCheck [iterations [seed]]
+ *  Exits non-zero if the table differs from what is expected.
+ */
+
+#include "LtMipApp.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ITERATIONS		200000
+#define SEED			1
+#define NUM_TAGS		MAXIMUM_L5MIP_SICB_TAGS
+#define LIMIT			100			// expiry limit, in ticks
+
+static int nFailures = 0;
+
+static void check(boolean bOk, const char* what, int n = 0)
+{
+	if (!bOk && nFailures++ < 20)
+	{
+		printf("FAIL: %s (%d)\n", what, n);
+	}
+}
+
+static void checkReuse()
+{
+	LtMipTagTable table(NUM_TAGS);
+	LtMsgIn* msgs[NUM_TAGS];
+	int tags[NUM_TAGS];
+	boolean seen[NUM_TAGS];
+
+	memset(seen, 0, sizeof(seen));
+	for (int i = 0; i < NUM_TAGS; i++)
+	{
+		msgs[i] = new LtMsgIn();
+		tags[i] = table.allocate(msgs[i], 0);
+		check(tags[i] >= 0 && tags[i] < NUM_TAGS && !seen[tags[i]], "reuse: tag handed out twice", i);
+		seen[tags[i]] = true;
+	}
+	for (int i = 0; i < NUM_TAGS; i += 3)
+	{
+		check(table.release(tags[i]) == msgs[i], "reuse: response matched the wrong request", i);
+		delete msgs[i];
+		msgs[i] = new LtMsgIn();
+		int tag = table.allocate(msgs[i], 0);
+		check(tag == tags[i], "reuse: tag freed by a response not reused first", i);
+	}
+	check(table.getEvictions() == 0 && table.getExpirations() == 0, "reuse: request dropped");
+}
+
+static void checkExpiry()
+{
+	LtMipTagTable table(NUM_TAGS);
+	LtMsgIn* pOld = new LtMsgIn();
+	int oldTag = table.allocate(pOld, 0);
+	int tags[NUM_TAGS];
+
+	table.expire(LIMIT, LIMIT);
+	check(table.getExpirations() == 0, "expiry: request dropped at the limit");
+	table.expire(LIMIT + 1, LIMIT);
+	check(table.getExpirations() == 1, "expiry: request not dropped past the limit");
+
+	// Every other tag is handed out before the quarantined one.
+	for (int i = 0; i < NUM_TAGS - 1; i++)
+	{
+		tags[i] = table.allocate(new LtMsgIn(), LIMIT + 1);
+		check(tags[i] != oldTag, "expiry: quarantined tag reused early", i);
+	}
+	check(table.release(oldTag) == NULL, "expiry: late response matched a request");
+	check(table.getLateResponses() == 1, "expiry: late response not counted");
+
+	// A tag freed by a response still goes ahead of it.
+	LtMsgIn* pMsg = table.release(tags[0]);
+	check(pMsg != NULL, "expiry: response lost");
+	delete pMsg;
+	check(table.allocate(new LtMsgIn(), LIMIT + 1) == tags[0], "expiry: quarantined tag reused ahead of a freed one");
+	check(table.allocate(new LtMsgIn(), LIMIT + 1) == oldTag, "expiry: quarantined tag not reused last");
+	check(table.getEvictions() == 0, "expiry: request evicted with a free tag");
+}
+
+static void checkEviction()
+{
+	LtMipTagTable table(NUM_TAGS);
+	int first = table.allocate(new LtMsgIn(), 0);
+
+	for (int i = 1; i < NUM_TAGS; i++)
+	{
+		table.allocate(new LtMsgIn(), i);
+	}
+	check(table.allocate(new LtMsgIn(), NUM_TAGS) == first, "eviction: oldest request not evicted");
+	check(table.getEvictions() == 1, "eviction: not counted");
+}
+
+//
+// The table hands out tags in request order, so the oldest request is the
+// one made first even when several were made in the same tick.
+//
+static int oldestRequest(LtMsgIn** model, unsigned int* order)
+{
+	int oldest = -1;
+
+	for (int i = 0; i < NUM_TAGS; i++)
+	{
+		if (model[i] != NULL && (oldest < 0 || order[i] < order[oldest]))
+		{
+			oldest = i;
+		}
+	}
+	return oldest;
+}
+
+//
+// The model keeps, for each tag, the request it has or none, and the free
+// tags in the order the table should hand them out.
+//
+static void checkRandom(int iterations)
+{
+	LtMipTagTable table(NUM_TAGS);
+	LtMsgIn* model[NUM_TAGS];
+	ULONG start[NUM_TAGS];
+	unsigned int order[NUM_TAGS];		// requests made before this one
+	unsigned int nRequests = 0;
+	int freeList[NUM_TAGS];
+	int nFree = NUM_TAGS;
+	ULONG now = 0;
+	unsigned int nLate = 0;
+
+	memset(model, 0, sizeof(model));
+	for (int i = 0; i < NUM_TAGS; i++)
+	{
+		freeList[i] = i;
+	}
+	for (int n = 0; n < iterations && nFailures == 0; n++)
+	{
+		int op = rand() % 8;
+		int tag = rand() % NUM_TAGS;
+
+		now += rand() % 8;
+		if (op < 3)
+		{
+			// A new request.  With no free tag the oldest request goes.
+			LtMsgIn* pMsg = new LtMsgIn();
+			if (nFree == 0)
+			{
+				int oldest = oldestRequest(model, order);
+				model[oldest] = NULL;
+				freeList[nFree++] = oldest;
+			}
+			int expected = freeList[0];
+			memmove(&freeList[0], &freeList[1], --nFree * sizeof(int));
+			tag = table.allocate(pMsg, now);
+			check(tag == expected, "random: unexpected tag", n);
+			model[tag] = pMsg;
+			start[tag] = now;
+			order[tag] = nRequests++;
+		}
+		else if (op < 6)
+		{
+			// A response, possibly late.
+			LtMsgIn* pMsg = table.release(tag);
+			check(pMsg == model[tag], "random: response matched the wrong request", n);
+			if (model[tag] != NULL)
+			{
+				delete pMsg;
+				model[tag] = NULL;
+				memmove(&freeList[1], &freeList[0], nFree++ * sizeof(int));
+				freeList[0] = tag;
+			}
+			else
+			{
+				nLate++;
+			}
+		}
+		else
+		{
+			// Expire, oldest first.
+			table.expire(now, LIMIT);
+			for (boolean bMore = true; bMore; )
+			{
+				int oldest = oldestRequest(model, order);
+				bMore = oldest >= 0 && now - start[oldest] > LIMIT;
+				if (bMore)
+				{
+					model[oldest] = NULL;
+					freeList[nFree++] = oldest;
+				}
+			}
+		}
+	}
+	check(table.getLateResponses() == nLate, "random: late responses miscounted");
+	printf("%d operations, %u evictions, %u expirations, %u late responses\n",
+		   iterations, table.getEvictions(), table.getExpirations(), table.getLateResponses());
+}
+
+int main(int argc, char* argv[])
+{
+	int iterations = argc > 1 ? atoi(argv[1]) : ITERATIONS;
+	unsigned seed = argc > 2 ? (unsigned)atoi(argv[2]) : SEED;
+
+	srand(seed);
+	checkReuse();
+	checkExpiry();
+	checkEviction();
+	checkRandom(iterations);
+
+	if (nFailures != 0)
+	{
+		printf("FAIL: %d checks failed\n", nFailures);
+		return 1;
+	}
+	printf("PASS\n");
+	return 0;
+}
@@ -0,0 +1,504 @@
+/*
+ * MultiStack.cpp
+ *
+ * Copyright © 2022 Dialog Semiconductor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in 
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * Description: Many IzoT devices in one process through the LonCtx API.
+ *
+ *  The program creates NUM_STACKS stack handles, each with its own device
+ *  URI on the loopback interface (uc://127.0.0.1 at consecutive ports), its
+ *  own unique ID and NVD folder, and its own callbacks, whose user context
+ *  is the instance.  Each stack registers an input and an output NV, with
+ *  the output turned around to the input, and is then made configured and
+ *  online.  The program then checks, for every instance, that:
+ *
+ *  - the read-only data holds the instance's unique ID;
+ *  - the NV values and domain configuration set through one handle are not
+ *    seen through any other;
+ *  - propagating the output NV completes, and updates the input NV, through
+ *    callbacks that carry that instance's context and no other;
+ *  - the even instances, which supply their own non-volatile data callbacks,
+ *    persist through those, with their own handle and context, while the odd
+ *    ones persist through the default handlers into their NVD folder.
+ *
+ *  The process's thread count and resident memory are printed once all the
+ *  stacks are up.
+ *
+ *  Usage: MultiStack [stacks [base-port [nvd-folder]]]
+ *  Exits non-zero if any check fails.
+ */
+
+#include "FtxlApi.h"
+#include "DeviceHarness.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define NUM_STACKS		100
+#define BASE_PORT		28000
+#define NVD_FOLDER		"/tmp/MultiStack"
+#define NVI_INDEX		0
+#define NVO_INDEX		1
+#define PUMP_TIMEOUT	10.0		// seconds to wait for all the events
+
+static const HarnessDevice device = {
+	"MultiStack",
+	0x12,						// model
+	2,							// static NVs
+	15,							// address table entries
+	0,							// aliases
+	1, 5						// priority and non-priority output buffers
+};
+
+typedef struct
+{
+	int					index;
+	LonStackHandle		hStack;
+	LonUniqueId			uid;
+	LonByte				nvi[2];
+	LonByte				nvo[2];
+	int					nEventReady;
+	int					nCompleted;
+	int					nUpdated;
+	int					nStray;			// events for the wrong NV
+	int					nNvdWrites;
+	int					nNvdStray;		// NVD calls with another instance's handle
+	char				szNvdPath[256];
+} Instance;
+
+static int nFailures = 0;
+
+static void failed(const Instance* p, const char* what)
+{
+	if (nFailures++ < 20)
+	{
+		printf("FAIL: instance %d: %s\n", p->index, what);
+	}
+}
+
+static void myEventReady(void* pUserContext)
+{
+	((Instance*)pUserContext)->nEventReady++;
+}
+
+static void myNvUpdateOccurred(void* pUserContext, const unsigned index, 
+							   const LonReceiveAddress* const pSourceAddress)
+{
+	Instance* p = (Instance*)pUserContext;
+
+	if (index == NVI_INDEX)
+	{
+		p->nUpdated++;
+	}
+	else
+	{
+		p->nStray++;
+	}
+}
+
+static void myNvUpdateCompleted(void* pUserContext, const unsigned index, const LonBool success)
+{
+	Instance* p = (Instance*)pUserContext;
+
+	if (index == NVO_INDEX && success)
+	{
+		p->nCompleted++;
+	}
+	else
+	{
+		p->nStray++;
+	}
+}
+
+//
+// The non-volatile data callbacks of the even instances: one file per
+// segment in the instance's folder, with a name the default handlers don't
+// use.
+//
+static Instance* nvdInstance(void* pUserContext, LonStackHandle hStack)
+{
+	Instance* p = (Instance*)pUserContext;
+
+	if (p->hStack != NULL && hStack != p->hStack)
+	{
+		p->nNvdStray++;
+	}
+	return p;
+}
+
+static void nvdFileName(const Instance* p, const LonNvdSegmentType type, char* szName)
+{
+	sprintf(szName, "%s/ctx-%d.dat", p->szNvdPath, (int)type);
+}
+
+static const LonNvdHandle myNvdOpenForRead(void* pUserContext, LonStackHandle hStack, 
+										   const LonNvdSegmentType type)
+{
+	char szName[300];
+
+	nvdFileName(nvdInstance(pUserContext, hStack), type, szName);
+	return (LonNvdHandle)fopen(szName, "rb");
+}
+
+static const LonNvdHandle myNvdOpenForWrite(void* pUserContext, LonStackHandle hStack, 
+											const LonNvdSegmentType type, const size_t size)
+{
+	char szName[300];
+
+	nvdFileName(nvdInstance(pUserContext, hStack), type, szName);
+	return (LonNvdHandle)fopen(szName, "wb");
+}
+
+static void myNvdClose(void* pUserContext, LonStackHandle hStack, const LonNvdHandle handle)
+{
+	nvdInstance(pUserContext, hStack);
+	fclose((FILE*)handle);
+}
+
+static void myNvdDelete(void* pUserContext, LonStackHandle hStack, const LonNvdSegmentType type)
+{
+	char szName[300];
+
+	nvdFileName(nvdInstance(pUserContext, hStack), type, szName);
+	unlink(szName);
+}
+
+static const LonApiError myNvdRead(void* pUserContext, LonStackHandle hStack, 
+								   const LonNvdHandle handle, const size_t offset,
+								   const size_t size, void * const pBuffer)
+{
+	nvdInstance(pUserContext, hStack);
+	return fseek((FILE*)handle, offset, SEEK_SET) == 0 && fread(pBuffer, size, 1, (FILE*)handle) == 1 ?
+		LonApiNoError : LonApiNvdFailure;
+}
+
+static const LonApiError myNvdWrite(void* pUserContext, LonStackHandle hStack, 
+									const LonNvdHandle handle, const size_t offset,
+									const size_t size, const void * const pData)
+{
+	nvdInstance(pUserContext, hStack)->nNvdWrites++;
+	return fseek((FILE*)handle, offset, SEEK_SET) == 0 && fwrite(pData, size, 1, (FILE*)handle) == 1 ?
+		LonApiNoError : LonApiNvdFailure;
+}
+
+static const LonBool myNvdIsInTransaction(void* pUserContext, LonStackHandle hStack, 
+										  const LonNvdSegmentType type)
+{
+	nvdInstance(pUserContext, hStack);
+	return FALSE;
+}
+
+static const LonApiError myNvdTransaction(void* pUserContext, LonStackHandle hStack, 
+										  const LonNvdSegmentType type)
+{
+	nvdInstance(pUserContext, hStack);
+	return LonApiNoError;
+}
+
+static LonApiError createStack(Instance* p, int port, const char* nvdFolder)
+{
+	LonCtxCallbacks callbacks;
+	LonApiError sts;
+
+	memset(&callbacks, 0, sizeof(callbacks));
+	callbacks.pUserContext = p;
+	callbacks.eventReady = myEventReady;
+	callbacks.nvUpdateOccurred = myNvUpdateOccurred;
+	callbacks.nvUpdateCompleted = myNvUpdateCompleted;
+	if (p->index % 2 == 0)
+	{
+		callbacks.nvdOpenForRead = myNvdOpenForRead;
+		callbacks.nvdOpenForWrite = myNvdOpenForWrite;
+		callbacks.nvdClose = myNvdClose;
+		callbacks.nvdDelete = myNvdDelete;
+		callbacks.nvdRead = myNvdRead;
+		callbacks.nvdWrite = myNvdWrite;
+		callbacks.nvdIsInTransaction = myNvdIsInTransaction;
+		callbacks.nvdEnterTransaction = myNvdTransaction;
+		callbacks.nvdExitTransaction = myNvdTransaction;
+	}
+
+	p->uid[0] = 0x00; p->uid[1] = 0xD0; p->uid[2] = 0x71;
+	p->uid[3] = 0x40; p->uid[4] = (LonByte)(p->index >> 8); p->uid[5] = (LonByte)p->index;
+	sprintf(p->szNvdPath, "%s/%d", nvdFolder, p->index);
+
+	sts = HarnessCreateStack(&p->hStack, &callbacks, &device, &p->uid, port, p->szNvdPath);
+	if (sts == LonApiNoError)
+		sts = HarnessRegisterNv(p->hStack, p->nvi, "nviValue", LON_NV_ACKD | LON_NV_SERVICE_CONFIG);
+	if (sts == LonApiNoError)
+		sts = HarnessRegisterNv(p->hStack, p->nvo, "nvoValue", LON_NV_IS_OUTPUT | LON_NV_UNACKD | LON_NV_SERVICE_CONFIG);
+	if (sts == LonApiNoError)
+		sts = HarnessStartStack(p->hStack);
+	return sts;
+}
+
+//
+// Put the instance on its own subnet/node, turn the output NV around to
+// the input NV through a turnaround address table entry, and take it online.
+//
+static LonApiError configureStack(Instance* p)
+{
+	LonDomain domain;
+	LonAddress address;
+	LonNvEcsConfig nvc;
+	unsigned selector = 0x1000 + p->index;
+	LonApiError sts;
+
+	sts = LonCtxQueryDomainConfig(p->hStack, 0, &domain);
+	if (sts == LonApiNoError)
+	{
+		domain.Id[0] = 0x5A;
+		LON_SET_ATTRIBUTE(domain, LON_DOMAIN_ID_LENGTH, 1);
+		domain.Subnet = 1 + p->index / 100;
+		LON_SET_ATTRIBUTE(domain, LON_DOMAIN_NODE, 1 + p->index % 100);
+		LON_SET_ATTRIBUTE(domain, LON_DOMAIN_INVALID, 0);
+		sts = LonCtxUpdateDomainConfig(p->hStack, 0, &domain);
+	}
+	if (sts == LonApiNoError)
+	{
+		memset(&address, 0, sizeof(address));
+		address.Turnaround.Turnaround = 1;
+		sts = LonCtxUpdateAddressConfig(p->hStack, 0, &address);
+	}
+	for (int index = NVI_INDEX; sts == LonApiNoError && index <= NVO_INDEX; index++)
+	{
+		sts = LonCtxQueryNvConfig(p->hStack, index, &nvc);
+		if (sts == LonApiNoError)
+		{
+			LON_SET_ATTRIBUTE(nvc, LON_NV_ECS_SELHIGH, selector >> 8);
+			nvc.SelectorLow = (LonByte)selector;
+			LON_SET_ATTRIBUTE(nvc, LON_NV_ECS_TURNAROUND, 1);
+			if (index == NVO_INDEX)
+			{
+				LON_SET_UNSIGNED_WORD(nvc.AddressIndex, 0);
+			}
+			sts = LonCtxUpdateNvConfig(p->hStack, index, &nvc);
+		}
+	}
+	if (sts == LonApiNoError)
+		sts = LonCtxSetNodeMode(p->hStack, LonChangeState, LonConfigOnLine);
+	if (sts == LonApiNoError)
+		sts = LonCtxSetNodeMode(p->hStack, LonApplicationOnLine, LonStateInvalid);
+	return sts;
+}
+
+static void checkIsolation(Instance* pInst, int nStacks)
+{
+	for (int i = 0; i < nStacks; i++)
+	{
+		Instance* p = &pInst[i];
+		LonByte value[2] = { (LonByte)(i >> 8), (LonByte)(i * 7) };
+
+		if (LonCtxSetNvValue(p->hStack, NVO_INDEX, value) != LonApiNoError)
+		{
+			failed(p, "LonCtxSetNvValue");
+		}
+	}
+	for (int i = 0; i < nStacks; i++)
+	{
+		Instance* p = &pInst[i];
+		LonReadOnlyData rod;
+		LonDomain domain;
+		volatile LonByte* pValue = (volatile LonByte*)LonCtxGetNvValue(p->hStack, NVO_INDEX);
+
+		if (LonCtxQueryReadOnlyData(p->hStack, &rod) != LonApiNoError ||
+			memcmp(rod.UniqueNodeId, p->uid, sizeof(p->uid)) != 0)
+		{
+			failed(p, "read-only data has another unique ID");
+		}
+		if (pValue != p->nvo || pValue[0] != (LonByte)(i >> 8) || pValue[1] != (LonByte)(i * 7))
+		{
+			failed(p, "output NV value is not the one set through this handle");
+		}
+		if (LonCtxQueryDomainConfig(p->hStack, 0, &domain) != LonApiNoError ||
+			domain.Subnet != 1 + i / 100 ||
+			LON_GET_ATTRIBUTE(domain, LON_DOMAIN_NODE) != 1 + i % 100)
+		{
+			failed(p, "domain configuration is not the one set through this handle");
+		}
+	}
+}
+
+static void checkPropagation(Instance* pInst, int nStacks)
+{
+	for (int i = 0; i < nStacks; i++)
+	{
+		if (LonCtxPropagateNv(pInst[i].hStack, NVO_INDEX) != LonApiNoError)
+		{
+			failed(&pInst[i], "LonCtxPropagateNv");
+		}
+	}
+
+	double deadline = HarnessNowSecs() + PUMP_TIMEOUT;
+	int nDone;
+	do
+	{
+		nDone = 0;
+		for (int i = 0; i < nStacks; i++)
+		{
+			LonCtxEventPump(pInst[i].hStack);
+			if (pInst[i].nCompleted != 0 && pInst[i].nUpdated != 0)
+			{
+				nDone++;
+			}
+		}
+		if (nDone < nStacks)
+		{
+			usleep(1000);
+		}
+	} while (nDone < nStacks && HarnessNowSecs() < deadline);
+
+	for (int i = 0; i < nStacks; i++)
+	{
+		Instance* p = &pInst[i];
+
+		if (p->nCompleted != 1)
+		{
+			failed(p, "output NV update did not complete exactly once");
+		}
+		if (p->nUpdated != 1)
+		{
+			failed(p, "input NV was not updated exactly once");
+		}
+		else if (memcmp(p->nvi, p->nvo, sizeof(p->nvi)) != 0)
+		{
+			failed(p, "input NV did not get this instance's output value");
+		}
+		if (p->nStray != 0)
+		{
+			failed(p, "callback for an NV this instance did not update");
+		}
+		if (p->nEventReady == 0)
+		{
+			failed(p, "no event ready callback");
+		}
+	}
+}
+
+//
+// Flush every stack's persistent data, and check that each even instance
+// wrote its own files through its own callbacks and each odd one wrote
+// files through the default handlers, and none of them anything else.
+//
+static void checkPersistence(Instance* pInst, int nStacks)
+{
+	for (int i = 0; i < nStacks; i++)
+	{
+		Instance* p = &pInst[i];
+		char szName[300];
+		struct stat st;
+
+		if (LonCtxNvdFlushData(p->hStack) != LonApiNoError)
+		{
+			failed(p, "LonCtxNvdFlushData");
+			continue;
+		}
+		nvdFileName(p, LonNvdSegNetworkImage, szName);
+		if (i % 2 == 0)
+		{
+			if (p->nNvdWrites == 0 || stat(szName, &st) != 0)
+			{
+				failed(p, "the network image was not written through the instance's NVD callbacks");
+			}
+		}
+		else if (p->nNvdWrites != 0 || stat(szName, &st) == 0)
+		{
+			failed(p, "NVD callbacks of another instance were used");
+		}
+		if (p->nNvdStray != 0)
+		{
+			failed(p, "NVD callback with another instance's handle");
+		}
+	}
+}
+
+static void printProcessUsage(int nStacks)
+{
+	FILE* f = fopen("/proc/self/status", "r");
+	char line[128];
+
+	if (f != NULL)
+	{
+		while (fgets(line, sizeof(line), f) != NULL)
+		{
+			if (strncmp(line, "Threads:", 8) == 0 || strncmp(line, "VmRSS:", 6) == 0)
+			{
+				printf("%d stacks: %s", nStacks, line);
+			}
+		}
+		fclose(f);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	int nStacks = argc > 1 ? atoi(argv[1]) : NUM_STACKS;
+	int basePort = argc > 2 ? atoi(argv[2]) : BASE_PORT;
+	const char* nvdFolder = argc > 3 ? argv[3] : NVD_FOLDER;
+	Instance* pInst = (Instance*)calloc(nStacks, sizeof(Instance));
+	int nCreated = 0;
+
+	mkdir(nvdFolder, 0755);
+	for (int i = 0; i < nStacks; i++)
+	{
+		pInst[i].index = i;
+		LonApiError sts = createStack(&pInst[i], basePort + i, nvdFolder);
+		if (sts == LonApiNoError)
+		{
+			sts = configureStack(&pInst[i]);
+		}
+		if (sts != LonApiNoError)
+		{
+			printf("FAIL: instance %d: stack setup failed with %d\n", i, sts);
+			nFailures++;
+			break;
+		}
+		nCreated++;
+	}
+	printProcessUsage(nCreated);
+
+	if (nCreated == nStacks)
+	{
+		checkIsolation(pInst, nStacks);
+		checkPropagation(pInst, nStacks);
+		checkPersistence(pInst, nStacks);
+	}
+
+	for (int i = 0; i < nStacks; i++)
+	{
+		if (pInst[i].hStack != NULL)
+		{
+			LonCtxFreeHandle(pInst[i].hStack);
+		}
+	}
+	free(pInst);
+
+	if (nFailures != 0)
+	{
+		printf("FAIL: %d checks failed\n", nFailures);
+		return 1;
+	}
+	printf("PASS\n");
+	return 0;
+}
@@ -0,0 +1,424 @@
+/*
+ * NmLaneReplay.cpp
+ *
+ * Copyright © 2022 Dialog Semiconductor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in 
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * Description: Network management lane test.
+ *
+ *  LtNetworkManager runs network management requests on two lanes, an
+ *  ordered lane for everything that may change the device and a read-only
+ *  lane for queries.  A query only takes the read-only lane when the
+ *  ordered lane has nothing left to run, so it never overtakes a write
+ *  delivered before it.  The lanes only exclude each other while a command
+ *  executes; the store of the network image that a write schedules happens
+ *  after the lock is released.
+ *
+ *  The program creates one IzoT device on the loopback interface and hands
+ *  commands to its LtNetworkManager through deliver(), as layer 6 does.  A
+ *  writer task sends acknowledged address table updates and config
+ *  relative memory writes, and reads each one back with a query it sends
+ *  at once, the way a tool may once the write is acknowledged.  Reader
+ *  tasks send queries that are read-only lane candidates and wait for
+ *  each.  Every read back must run after its write, the configuration
+ *  change count must go up exactly once per write, and the address table
+ *  and location must end up holding the last value written to them.  The
+ *  time from delivery of a query until its lane is done with it is
+ *  reported.
+ *
+ *  Finally a checksum recomputing config relative write is followed by a
+ *  read-only relative write of the program ID without the recompute flag.
+ *  Only config relative writes may defer the checksum, so the network
+ *  image must be stored with a valid one.
+ *
+ *  Usage: NmLaneReplay [writes [readers [port [nvd-folder]]]]
+ *  Exits non-zero if any check fails.
+ */
+
+#include "LtStackInternal.h"
+#include "FtxlStack.h"
+#include "FtxlApi.h"
+#include "DeviceHarness.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define WRITES			20000
+#define READERS			2
+#define MAX_READERS		8
+#define PORT			28510
+#define NVD_FOLDER		"/tmp/NmLaneReplay"
+#define ENTRIES			8			// address table entries written
+#define LOCATION_OFFSET	2			// config relative offset of the location
+#define LOCATION_LENGTH	6
+#define TASK_PRIORITY	100
+#define TASK_STACK		32768
+
+static const HarnessDevice device = {
+	"NmLaneReplay",
+	0x14,						// model
+	0,							// static NVs
+	15,							// address table entries
+	0,							// aliases
+	5, 5						// priority and non-priority output buffers
+};
+
+struct Reader
+{
+	SEM_ID			semDone;
+	int				nReads;
+	double			total;
+	double			worst;
+};
+
+//
+// A command delivered to the network manager.  The lane that runs it
+// deletes it once it is done with it, as it does the messages layer 6
+// delivers, so the destructor tells the task that sent it.  A read back
+// checks that its write ran first.
+//
+class LaneMsg : public LtMsgIn
+{
+public:
+	LaneMsg(SEM_ID semDone, Reader* pReader, unsigned nCountAfterWrite)
+		: m_semDone(semDone), m_pReader(pReader), m_nCountAfterWrite(nCountAfterWrite)
+	{
+		m_start = HarnessNowSecs();
+	}
+	~LaneMsg();
+
+private:
+	SEM_ID			m_semDone;
+	Reader*			m_pReader;
+	unsigned		m_nCountAfterWrite;
+	double			m_start;
+};
+
+static LonStackHandle hStack = NULL;
+static LonUniqueId uid = { 0x00, 0xD0, 0x71, 0x40, 0x10, 0x02 };
+static LtNetworkManager* pNm = NULL;
+static Reader readers[MAX_READERS];
+static byte lastAddress[ENTRIES][5];
+static byte lastLocation[LOCATION_LENGTH];
+static int nWrites;
+static volatile int bWriting = 1;
+static volatile int nTasksDone = 0;
+static int nFailures = 0;
+
+static void check(boolean bOk, const char* what, int n = 0)
+{
+	if (!bOk && __sync_fetch_and_add(&nFailures, 1) < 20)
+	{
+		printf("FAIL: %s (%d)\n", what, n);
+	}
+}
+
+LaneMsg::~LaneMsg()
+{
+	if (m_nCountAfterWrite != 0)
+	{
+		check((int)(LonCtxGetConfigChangeCount(hStack) - m_nCountAfterWrite) >= 0,
+			  "a read back overtook its write", m_nCountAfterWrite);
+	}
+	if (m_pReader != NULL)
+	{
+		double secs = HarnessNowSecs() - m_start;
+
+		m_pReader->nReads++;
+		m_pReader->total += secs;
+		if (secs > m_pReader->worst)
+		{
+			m_pReader->worst = secs;
+		}
+	}
+	if (m_semDone != NULL)
+	{
+		semGive(m_semDone);
+	}
+}
+
+static LonApiError createStack(int port, const char* nvdFolder)
+{
+	LonApiError sts = HarnessCreateStack(&hStack, NULL, &device, &uid, port, nvdFolder);
+
+	if (sts == LonApiNoError)
+		sts = HarnessStartStack(hStack);
+	return sts;
+}
+
+//
+// Hand one command to the network manager, as layer 6 does.  Writes are
+// acknowledged, so nothing waits for them; requests have a response, which
+// goes nowhere as the command didn't come in on a transaction.
+//
+static void deliver(LaneMsg* pMsg, LtServiceType serviceType, int code, const byte* pData, int len)
+{
+	LtApduIn* pApdu = (LtApduIn*) pMsg;
+	LtRefId noTransaction(LT_REF_MSGTAG, 0, 0);
+
+	pApdu->setServiceType(serviceType);
+	pApdu->setRefId(noTransaction);
+	pApdu->setCode(code);
+	for (int i = 0; i < len; i++)
+	{
+		pApdu->setData(i, pData[i]);
+	}
+	pApdu->setLength(len);
+	pNm->deliver(pApdu);
+}
+
+static void sendWrite(int code, const byte* pData, int len)
+{
+	deliver(new LaneMsg(NULL, NULL, 0), LT_ACKD, code, pData, len);
+}
+
+static void sendQuery(SEM_ID semDone, Reader* pReader, unsigned nCountAfterWrite, int code, const byte* pData, int len)
+{
+	deliver(new LaneMsg(semDone, pReader, nCountAfterWrite), LT_REQUEST, code, pData, len);
+	semTake(semDone, WAIT_FOREVER);
+}
+
+//
+// A tool.  Mostly address table updates, with a config relative write of
+// the location now and then, each read back as soon as it is sent.
+//
+static int VXLCDECL writerTask(int arg, ...)
+{
+	SEM_ID semDone = semBCreate(SEM_Q_FIFO, SEM_EMPTY);
+	unsigned nCount = LonCtxGetConfigChangeCount(hStack);
+	int nAddressWrites = 0;
+
+	for (int seq = 0; seq < nWrites; seq++)
+	{
+		byte data[5 + LOCATION_LENGTH];
+		byte readBack[4];
+		int code;
+		int len;
+
+		if (seq % 4 == 3)
+		{
+			code = LT_WRITE_MEMORY;
+			data[0] = LT_CONFIG_RELATIVE;
+			data[1] = 0;
+			data[2] = LOCATION_OFFSET;
+			data[3] = LOCATION_LENGTH;
+			data[4] = 4;				// recompute the checksum
+			for (int i = 0; i < LOCATION_LENGTH; i++)
+			{
+				data[5 + i] = (byte)(seq >> (i % 4 * 8));
+			}
+			len = 5 + LOCATION_LENGTH;
+			memcpy(lastLocation, &data[5], LOCATION_LENGTH);
+			memcpy(readBack, data, 4);
+		}
+		else
+		{
+			// A group entry: size, domain and member, timers, group.
+			int index = nAddressWrites++ % ENTRIES;
+			code = LT_UPDATE_ADDRESS;
+			data[0] = (byte)index;
+			data[1] = 0x80 | (seq & 0x3F);
+			data[2] = (byte)(seq >> 6) & 0x3F;		// domain 0, 6 bit member
+			data[3] = 0x03;
+			data[4] = 0x05;
+			data[5] = (byte)(seq >> 13);
+			len = 6;
+			memcpy(lastAddress[index], &data[1], 5);
+			readBack[0] = (byte)index;
+		}
+		sendWrite(code, data, len);
+		if (code == LT_WRITE_MEMORY)
+		{
+			sendQuery(semDone, NULL, ++nCount, LT_READ_MEMORY, readBack, 4);
+		}
+		else
+		{
+			sendQuery(semDone, NULL, ++nCount, LT_QUERY_ADDRESS, readBack, 1);
+		}
+	}
+	semDelete(semDone);
+	bWriting = 0;
+	__sync_fetch_and_add(&nTasksDone, 1);
+	return 0;
+}
+
+//
+// Another tool, querying the address table, status and config data.
+//
+static int VXLCDECL readerTask(int arg, ...)
+{
+	Reader* pReader = &readers[arg];
+
+	pReader->semDone = semBCreate(SEM_Q_FIFO, SEM_EMPTY);
+	for (int n = 0; bWriting; n++)
+	{
+		byte data[4];
+		int code;
+		int len;
+
+		switch (n % 3)
+		{
+		case 0:
+			code = LT_QUERY_ADDRESS;
+			data[0] = (byte)(n % ENTRIES);
+			len = 1;
+			break;
+		case 1:
+			code = LT_QUERY_STATUS;
+			len = 0;
+			break;
+		default:
+			code = LT_READ_MEMORY;
+			data[0] = LT_CONFIG_RELATIVE;
+			data[1] = 0;
+			data[2] = LOCATION_OFFSET;
+			data[3] = LOCATION_LENGTH;
+			len = 4;
+			break;
+		}
+		check(LtNetworkManager::isReadOnlyRequest(code, data, len, false), "a query is not a read-only lane candidate", code);
+		sendQuery(pReader->semDone, pReader, 0, code, data, len);
+	}
+	semDelete(pReader->semDone);
+	__sync_fetch_and_add(&nTasksDone, 1);
+	return 0;
+}
+
+//
+// A read-only relative write of the program ID, with its own value and
+// without the recompute flag, right after a config relative write that
+// changes the image.  Both are stored together, and the image must get a
+// checksum of what it now holds.
+//
+static void checkReadOnlyWrite()
+{
+	LtPersistence* pPersistence = hStack->pStack->getNetworkImage()->getPersistence();
+	SEM_ID semDone = semBCreate(SEM_Q_FIFO, SEM_EMPTY);
+	byte data[5 + LT_PROGRAM_ID_LENGTH];
+	byte status[1];
+
+	pPersistence->sync();
+
+	data[0] = LT_CONFIG_RELATIVE;
+	data[1] = 0;
+	data[2] = LOCATION_OFFSET;
+	data[3] = LOCATION_LENGTH;
+	data[4] = 4;
+	for (int i = 0; i < LOCATION_LENGTH; i++)
+	{
+		data[5 + i] = lastLocation[i] ^ 0xFF;
+	}
+	sendWrite(LT_WRITE_MEMORY, data, 5 + LOCATION_LENGTH);
+
+	data[0] = LT_READ_ONLY_RELATIVE;
+	data[1] = 0;
+	data[2] = LT_ROD_PROGRAMID_OFFSET;
+	data[3] = LT_PROGRAM_ID_LENGTH;
+	data[4] = 0;
+	hStack->pStack->getReadOnly()->toLonTalk(LT_ROD_PROGRAMID_OFFSET, LT_PROGRAM_ID_LENGTH, &data[5]);
+	sendWrite(LT_WRITE_MEMORY, data, 5 + LT_PROGRAM_ID_LENGTH);
+
+	// On the ordered lane behind the writes.
+	sendQuery(semDone, NULL, 0, LT_QUERY_STATUS, status, 0);
+	semDelete(semDone);
+
+	pPersistence->sync();
+	check(pPersistence->restore() == LT_PERSISTENCE_OK, "the network image was stored with a stale checksum");
+}
+
+static void run(int nReaders)
+{
+	unsigned nCountBefore = LonCtxGetConfigChangeCount(hStack);
+	double start = HarnessNowSecs();
+
+	for (int i = 0; i < nReaders; i++)
+	{
+		taskSpawn("NmRead", TASK_PRIORITY, 0, TASK_STACK, readerTask, i, 0,0,0,0, 0,0,0,0,0);
+	}
+	taskSpawn("NmWrite", TASK_PRIORITY, 0, TASK_STACK, writerTask, 0, 0,0,0,0, 0,0,0,0,0);
+	while (nTasksDone < nReaders + 1)
+	{
+		usleep(1000);
+	}
+	double secs = HarnessNowSecs() - start;
+
+	check(LonCtxGetConfigChangeCount(hStack) - nCountBefore == (unsigned)nWrites,
+		  "the change count did not go up once per write", LonCtxGetConfigChangeCount(hStack) - nCountBefore);
+
+	for (int index = 0; index < ENTRIES && index < nWrites; index++)
+	{
+		LonAddress address;
+
+		check(LonCtxQueryAddressConfig(hStack, index, &address) == LonApiNoError &&
+			  memcmp(&address, lastAddress[index], sizeof(lastAddress[index])) == 0,
+			  "an address table entry does not hold the last write", index);
+	}
+	if (nWrites >= 4)
+	{
+		byte location[LOCATION_LENGTH];
+
+		hStack->pStack->getNetworkImage()->configData.toLonTalk(location, LOCATION_OFFSET, LOCATION_LENGTH);
+		check(memcmp(location, lastLocation, LOCATION_LENGTH) == 0, "the location does not hold the last write");
+	}
+
+	printf("%d writes in %.2f s (%.0f/s)\n", nWrites, secs, nWrites / secs);
+	for (int i = 0; i < nReaders; i++)
+	{
+		Reader* pReader = &readers[i];
+		printf("reader %d: %d queries, mean %.1f us, worst %.1f us\n", i, pReader->nReads,
+			   pReader->nReads ? pReader->total / pReader->nReads * 1e6 : 0.0, pReader->worst * 1e6);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	nWrites = argc > 1 ? atoi(argv[1]) : WRITES;
+	int nReaders = argc > 2 ? atoi(argv[2]) : READERS;
+	int port = argc > 3 ? atoi(argv[3]) : PORT;
+	const char* nvdFolder = argc > 4 ? argv[4] : NVD_FOLDER;
+
+	LonApiError sts = nWrites > 0 && nReaders > 0 && nReaders <= MAX_READERS ?
+		createStack(port, nvdFolder) : LonApiInvalidParameter;
+	if (sts != LonApiNoError)
+	{
+		printf("FAIL: stack setup failed with %d\n", sts);
+		nFailures++;
+	}
+	else
+	{
+		pNm = hStack->pStack->getNetworkManager();
+		run(nReaders);
+		checkReadOnlyWrite();
+	}
+
+	if (hStack != NULL)
+	{
+		LonCtxFreeHandle(hStack);
+	}
+	if (nFailures != 0)
+	{
+		printf("FAIL: %d checks failed\n", nFailures);
+		return 1;
+	}
+	printf("PASS\n");
+	return 0;
+}
@@ -0,0 +1,251 @@
+/*
+ * NmReadBench.cpp
+ *
+ * Copyright © 2022 Dialog Semiconductor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in 
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * Description: Network management read benchmark.
+ *
+ *  Monitoring tools poll the statistics, read-only data and configuration
+ *  of many devices with network management memory reads.  The program
+ *  creates one IzoT device on the loopback interface and measures how
+ *  fast its network manager serves such reads:
+ *
+ *  - process   read memory and query status requests run through
+ *  LtNetworkManager::process(), as the read-only lane does,
+ *  for read-only, config and statistics relative memory;
+ *  - stats     LtNetworkStats::get() of one statistic, toLonTalk() of one
+ *  statistic, and a full snapshot().
+ *
+ *  The link statistics are cached for LT_LINK_STATS_TTL_MS, so none of
+ *  these go to the driver more than a few times a second.  Every read must
+ *  succeed, and get() and toLonTalk() must agree with snapshot() for every
+ *  statistic.
+ *
+ *  Usage: NmReadBench [reads [port [nvd-folder]]]
+ *  Prints the reads per second for each kind, then PASS or FAIL, and exits
+ *  non-zero on failure.
+ */
+
+#include "LtStackInternal.h"
+#include "FtxlStack.h"
+#include "FtxlApi.h"
+#include "DeviceHarness.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define READS			200000
+#define PORT			28520
+#define NVD_FOLDER		"/tmp/NmReadBench"
+#define BUMPS			70000		// enough to pass the 0xffff cap
+
+static const HarnessDevice device = {
+	"NmReadBench",
+	0x15,						// model
+	0,							// static NVs
+	15,							// address table entries
+	0,							// aliases
+	5, 5						// priority and non-priority output buffers
+};
+
+static LonStackHandle hStack = NULL;
+static LonUniqueId uid = { 0x00, 0xD0, 0x71, 0x40, 0x10, 0x03 };
+static LtNetworkManager* pNm = NULL;
+static LtNetworkStats* pStats = NULL;
+static int nFailures = 0;
+
+static void check(boolean bOk, const char* what, int n = 0)
+{
+	if (!bOk && nFailures++ < 20)
+	{
+		printf("FAIL: %s (%d)\n", what, n);
+	}
+}
+
+static LonApiError createStack(int port, const char* nvdFolder)
+{
+	LonApiError sts = HarnessCreateStack(&hStack, NULL, &device, &uid, port, nvdFolder);
+
+	if (sts == LonApiNoError)
+		sts = HarnessStartStack(hStack);
+	return sts;
+}
+
+//
+// Run one unacknowledged command through the network manager, as the
+// read-only lane does.  There is no response to send for it.
+//
+static LtErrorType process(int code, const byte* pData, int len)
+{
+	LtApduIn apdu;
+
+	apdu.setServiceType(LT_UNACKD);
+	apdu.setCode(code);
+	for (int i = 0; i < len; i++)
+	{
+		apdu.setData(i, pData[i]);
+	}
+	apdu.setLength(len);
+	return pNm->process(apdu);
+}
+
+static void report(const char* name, int nReads, double secs)
+{
+	printf("%-14s %8d reads %11.0f reads/s\n", name, nReads, nReads / secs);
+}
+
+static void benchRead(const char* name, int type, int offset, int length, int nReads)
+{
+	byte data[4] = { (byte)type, (byte)(offset >> 8), (byte)offset, (byte)length };
+	int nErrors = 0;
+
+	double start = HarnessNowSecs();
+	for (int n = 0; n < nReads; n++)
+	{
+		if (process(LT_READ_MEMORY, data, sizeof(data)) != LT_NO_ERROR)
+		{
+			nErrors++;
+		}
+	}
+	report(name, nReads, HarnessNowSecs() - start);
+	check(nErrors == 0, "a read memory request failed", type);
+}
+
+static void benchQueryStatus(int nReads)
+{
+	int nErrors = 0;
+
+	double start = HarnessNowSecs();
+	for (int n = 0; n < nReads; n++)
+	{
+		if (process(LT_QUERY_STATUS, NULL, 0) != LT_NO_ERROR)
+		{
+			nErrors++;
+		}
+	}
+	report("query status", nReads, HarnessNowSecs() - start);
+	check(nErrors == 0, "a query status request failed");
+}
+
+static void benchStats(int nReads)
+{
+	ULONGLONG values[LT_NUM_STATS];
+	byte data[2];
+	int sum = 0;
+
+	double start = HarnessNowSecs();
+	for (int n = 0; n < nReads; n++)
+	{
+		sum += pStats->get(n % LT_NUM_STATS);
+	}
+	report("get", nReads, HarnessNowSecs() - start);
+
+	start = HarnessNowSecs();
+	for (int n = 0; n < nReads; n++)
+	{
+		pStats->toLonTalk(data, n % LT_NUM_STATS * 2, 2);
+		sum += data[1];
+	}
+	report("toLonTalk", nReads, HarnessNowSecs() - start);
+
+	start = HarnessNowSecs();
+	for (int n = 0; n < nReads; n++)
+	{
+		pStats->snapshot(values);
+		sum += (int)values[n % LT_NUM_STATS];
+	}
+	report("snapshot", nReads, HarnessNowSecs() - start);
+	if (sum == -1)
+	{
+		printf("\n");
+	}
+}
+
+//
+// get() and toLonTalk() must give the capped snapshot() value of each
+// statistic.  Nothing else runs on the device, so the counts hold still.
+//
+static void checkStats()
+{
+	ULONGLONG values[LT_NUM_STATS];
+	byte all[LT_NUM_STATS * 2];
+
+	for (int n = 0; n < BUMPS; n++)
+	{
+		pStats->bump(LT_RETRIES);
+		if (n % 7 == 0)
+		{
+			pStats->bump(LT_LATE_ACKS);
+		}
+	}
+	pStats->snapshot(values);
+	check(values[LT_RETRIES] >= BUMPS, "the retry count is short");
+	check(pStats->toLonTalk(all, 0, sizeof(all)) == LT_NO_ERROR, "toLonTalk of all statistics failed");
+	for (int i = 0; i < LT_NUM_STATS; i++)
+	{
+		int capped = (int)(values[i] > 0xffff ? 0xffff : values[i]);
+		byte one[2];
+
+		check(pStats->get(i) == capped, "get() disagrees with snapshot()", i);
+		check(pStats->toLonTalk(one, i * 2, 2) == LT_NO_ERROR && (one[0] << 8 | one[1]) == capped,
+			  "toLonTalk() of one statistic disagrees with snapshot()", i);
+		check((all[i * 2] << 8 | all[i * 2 + 1]) == capped, "toLonTalk() of all statistics disagrees with snapshot()", i);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	int nReads = argc > 1 ? atoi(argv[1]) : READS;
+	int port = argc > 2 ? atoi(argv[2]) : PORT;
+	const char* nvdFolder = argc > 3 ? argv[3] : NVD_FOLDER;
+
+	LonApiError sts = nReads > 0 ? createStack(port, nvdFolder) : LonApiInvalidParameter;
+	if (sts != LonApiNoError)
+	{
+		printf("FAIL: stack setup failed with %d\n", sts);
+		nFailures++;
+	}
+	else
+	{
+		pNm = hStack->pStack->getNetworkManager();
+		pStats = hStack->pStack->getNetworkStats();
+		checkStats();
+		benchRead("read-only", LT_READ_ONLY_RELATIVE, 0, 8, nReads);
+		benchRead("config", LT_CONFIG_RELATIVE, 0, 16, nReads);
+		benchRead("stats", LT_STATS_RELATIVE, 0, LT_NUM_STATS * 2, nReads);
+		benchRead("stats one", LT_STATS_RELATIVE, LT_RETRIES * 2, 2, nReads);
+		benchQueryStatus(nReads);
+		benchStats(nReads);
+	}
+
+	if (hStack != NULL)
+	{
+		LonCtxFreeHandle(hStack);
+	}
+	if (nFailures != 0)
+	{
+		printf("FAIL: %d checks failed\n", nFailures);
+		return 1;
+	}
+	printf("PASS\n");
+	return 0;
+}
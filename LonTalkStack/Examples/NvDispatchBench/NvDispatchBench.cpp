@@ -0,0 +1,461 @@
+/*
+ * NvDispatchBench.cpp
+ *
+ * Copyright © 2022 Dialog Semiconductor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in 
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * Description: NV dispatch plan equivalence check and benchmark.
+ *
+ *  LtLayer6::incomingNetworkVariable() takes the targets of an incoming NV
+ *  message from the dispatch plan of its selector and direction, which
+ *  LtNetworkVariableConfigurationTable::getDispatchPlan() builds with the
+ *  selector search and keeps until the NV, alias or address tables change.
+ *  This program creates one IzoT device with NV_COUNT static NVs, half of
+ *  them outputs, and ALIAS_COUNT aliases.  They are bound over
+ *  NUM_SELECTORS selectors, so most selectors have several NVs and aliases,
+ *  with a mix of selection modes, authentication and address table
+ *  entries, some of which are unbound.
+ *
+ *  - For every selector, in both directions, the plan must list the same
+ *  targets, in the same order, as the selector search, with the
+ *  incarnation of the primary and the address a by-source selection would
+ *  have compared against.
+ *  - After rounds of changes to NV and alias selectors, address table
+ *  entries and incarnations, the plans must still agree.  The first
+ *  rounds change one table at a time, so each kind of change must
+ *  invalidate the plans on its own.
+ *
+ *  It then reports the time to find the targets of an update on a random
+ *  selector both ways: through the plan, and through the selector search
+ *  copying each configuration as incomingNetworkVariable() did before.
+ *
+ *  Usage: NvDispatchBench [lookups [port [nvd-folder]]]
+ *  Exits non-zero if a check fails.
+ */
+
+#include "LtStackInternal.h"
+#include "FtxlStack.h"
+#include "FtxlApi.h"
+#include "DeviceHarness.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NV_COUNT		2000		// static NVs; the odd ones are outputs
+#define ALIAS_COUNT		1000
+#define ADDR_COUNT		64			// address table entries
+#define NUM_SELECTORS	500			// bound selectors are BASE_SELECTOR and up
+#define BASE_SELECTOR	0x100
+#define CHANGE_ROUNDS	8
+#define CHANGES			200			// per round
+#define LOOKUPS			200000
+#define DEVICE_PORT		28030
+#define NVD_FOLDER		"/tmp/NvDispatchBench"
+
+static int nFailures = 0;
+
+static void check(bool bOk, const char* what, long n = 0)
+{
+	if (!bOk && nFailures++ < 20)
+	{
+		printf("FAIL: %s (%ld)\n", what, n);
+	}
+}
+
+static const HarnessDevice device = {
+	"NvDispatchBench",
+	0x31,						// model
+	NV_COUNT,					// static NVs
+	ADDR_COUNT,					// address table entries
+	ALIAS_COUNT,				// aliases
+	5, 5						// priority and non-priority output buffers
+};
+
+static LonStackHandle hStack;
+static LonUniqueId uid = { 0x00, 0xD0, 0x71, 0x40, 0x10, 0x31 };
+static LonByte nvValues[NV_COUNT][2];
+static char nvNames[NV_COUNT][16];
+static unsigned int seed = 1;
+
+static int pick(int n)
+{
+	return rand_r(&seed) % n;
+}
+
+static LonApiError createStack(int port, const char* nvdFolder)
+{
+	LonApiError sts = HarnessCreateStack(&hStack, NULL, &device, &uid, port, nvdFolder);
+
+	for (int i = 0; sts == LonApiNoError && i < NV_COUNT; i++)
+	{
+		sprintf(nvNames[i], "nvValue%d", i);
+		sts = HarnessRegisterNv(hStack, nvValues[i], nvNames[i],
+								((i & 1) ? LON_NV_IS_OUTPUT : 0) | LON_NV_SERVICE_CONFIG | LON_NV_AUTH_CONFIG);
+	}
+	if (sts == LonApiNoError)
+		sts = HarnessStartStack(hStack);
+	return sts;
+}
+
+//
+// Address table entry i: groups on even entries, subnet/node on odd ones,
+// and the last few unbound.
+//
+static LonApiError setAddress(int i, int variant)
+{
+	LonAddress address;
+
+	memset(&address, 0, sizeof(address));
+	if (i >= ADDR_COUNT - 4)
+	{
+		// Leave it unbound
+	}
+	else if (i & 1)
+	{
+		address.SubnetNode.Type = LonAddressSubnetNode;
+		LON_SET_ATTRIBUTE(address.SubnetNode, LON_ADDRESS_SN_NODE, 1 + (i + variant) % 120);
+		address.SubnetNode.TransmitTimer = LonTx16;
+		address.SubnetNode.Subnet = 1 + variant % 3;
+	}
+	else
+	{
+		LON_SET_ATTRIBUTE(address.Group, LON_ADDRESS_GROUP_TYPE, 1);
+		LON_SET_ATTRIBUTE(address.Group, LON_ADDRESS_GROUP_SIZE, 0);
+		LON_SET_ATTRIBUTE(address.Group, LON_ADDRESS_GROUP_DOMAIN, variant & 1);
+		address.Group.Group = (LonGroupId)(i + variant);
+	}
+	return LonCtxUpdateAddressConfig(hStack, i, &address);
+}
+
+//
+// Fill in the binding of an NV or alias: the selector, authentication,
+// selection modes and address table index, keeping the direction.
+//
+static void setBinding(LonNvEcsConfig& nvc, int selector, int flavor)
+{
+	LON_SET_ATTRIBUTE(nvc, LON_NV_ECS_SELHIGH, selector >> 8);
+	nvc.SelectorLow = (LonByte)selector;
+	LON_SET_ATTRIBUTE(nvc, LON_NV_ECS_AUTHENTICATION, flavor % 7 == 0);
+	LON_SET_ATTRIBUTE(nvc, LON_NV_ECS_SERVICE, LonServiceUnacknowledged);
+	LON_SET_ATTRIBUTE(nvc, LON_NV_ECS_UPDATE_SELECTION, flavor % 3);
+	LON_SET_ATTRIBUTE(nvc, LON_NV_ECS_REQUEST_SELECTION, (flavor/3) % 3);
+	LON_SET_ATTRIBUTE(nvc, LON_NV_ECS_RESP_SELECTION, (flavor/9) % 3);
+	LON_SET_UNSIGNED_WORD(nvc.AddressIndex, flavor % 11 == 0 ? 0xffff : flavor % ADDR_COUNT);
+}
+
+static LonApiError bindNv(int i, int selector, int flavor)
+{
+	LonNvEcsConfig nvc;
+	LonApiError sts = LonCtxQueryNvConfig(hStack, i, &nvc);
+	if (sts == LonApiNoError)
+	{
+		setBinding(nvc, selector, flavor);
+		sts = LonCtxUpdateNvConfig(hStack, i, &nvc);
+	}
+	return sts;
+}
+
+static LonApiError bindAlias(int i, int primary, int selector, int flavor)
+{
+	LonAliasEcsConfig alias;
+	LonNvEcsConfig nvc;
+	LonApiError sts = LonCtxQueryNvConfig(hStack, primary, &nvc);
+	if (sts == LonApiNoError)
+	{
+		// An alias has the direction of its primary.
+		alias.Alias = nvc;
+		setBinding(alias.Alias, selector, flavor);
+		LON_SET_UNSIGNED_WORD(alias.Primary, primary);
+		sts = LonCtxUpdateAliasConfig(hStack, i, &alias);
+	}
+	return sts;
+}
+
+static LonApiError configureStack()
+{
+	LonApiError sts = LonApiNoError;
+
+	for (int i = 0; sts == LonApiNoError && i < ADDR_COUNT; i++)
+	{
+		sts = setAddress(i, 0);
+	}
+	for (int i = 0; sts == LonApiNoError && i < NV_COUNT; i++)
+	{
+		sts = bindNv(i, BASE_SELECTOR + i % NUM_SELECTORS, i);
+	}
+	for (int i = 0; sts == LonApiNoError && i < ALIAS_COUNT; i++)
+	{
+		sts = bindAlias(i, (i*7) % NV_COUNT, BASE_SELECTOR + (i*3) % NUM_SELECTORS, i + 1);
+	}
+	return sts;
+}
+
+//
+// One target of an update, found the way incomingNetworkVariable() did
+// before dispatch plans.
+//
+typedef struct
+{
+	int		primary;
+	int		incarnation;
+	int		selection[3];
+	boolean	authenticated;
+	boolean	output;
+	int		addressType;
+	int		domainIndex;
+	int		subnet;
+	int		destId;
+} Target;
+
+static int searchTargets(LtDeviceStack* pStack, int selector, boolean bOutput, Target* pTargets, int max)
+{
+	LtNetworkVariableConfigurationTable& nvTable = pStack->getNetworkImage()->nvTable;
+	int index = -1;
+	int count = 0;
+
+	while (count < max)
+	{
+		LtNetworkVariableConfiguration nvc;
+		if (nvTable.get(index, selector, bOutput, nvc) != LT_NO_ERROR)
+		{
+			break;
+		}
+		Target* pTarget = &pTargets[count++];
+		pTarget->primary = nvc.getPrimary();
+		if (nvc.isAlias())
+		{
+			LtNetworkVariableConfiguration primaryNvc;
+			nvTable.get(nvc.getPrimary(), &primaryNvc);
+			pTarget->incarnation = primaryNvc.getIncarnationNumber();
+		}
+		else
+		{
+			pTarget->incarnation = nvc.getIncarnationNumber();
+		}
+		pTarget->selection[NV_DISPATCH_UPDATE] = nvc.getNvUpdateSelection();
+		pTarget->selection[NV_DISPATCH_REQUEST] = nvc.getNvRequestSelection();
+		pTarget->selection[NV_DISPATCH_RESPONSE] = nvc.getNvResponseSelection();
+		pTarget->authenticated = nvc.getAuthenticated();
+		pTarget->output = nvc.getOutput();
+
+		LtAddressConfiguration ac;
+		LtAddressConfiguration* pAc = null;
+		int addressIndex = nvc.getAddressTableIndex();
+		if (addressIndex == -1)
+		{
+			pAc = nvc.getAddress();
+		}
+		if (pAc == null && pStack->getAddressConfiguration(addressIndex, &ac) == LT_NO_ERROR)
+		{
+			pAc = &ac;
+		}
+		pTarget->addressType = pAc != null ? pAc->getAddressType() : LT_AT_UNBOUND;
+		pTarget->domainIndex = pAc != null ? pAc->getDomainIndex() : 0;
+		pTarget->subnet = pAc != null ? pAc->getSubnet() : 0;
+		pTarget->destId = pAc != null ? pAc->getDestId() : 0;
+	}
+	return count;
+}
+
+static int checkPlans(LtDeviceStack* pStack)
+{
+	LtNetworkVariableConfigurationTable& nvTable = pStack->getNetworkImage()->nvTable;
+	Target targets[64];
+	int nTargets = 0;
+
+	nvTable.lock();
+	// A few selectors past the bound ones, which must have no targets
+	for (int selector = BASE_SELECTOR; selector < BASE_SELECTOR + NUM_SELECTORS + 4; selector++)
+	{
+		for (int dir = 0; dir < 2; dir++)
+		{
+			long n = selector*2 + dir;
+			int count = searchTargets(pStack, selector, dir, targets, 64);
+			LtNvDispatchPlan* pPlan = nvTable.getDispatchPlan(selector, dir);
+			check(pPlan != NULL, "no plan", n);
+			if (pPlan == NULL)
+			{
+				continue;
+			}
+			check(pPlan->count == count, "plan has a different number of targets", n);
+			for (int i = 0; i < count && i < pPlan->count; i++)
+			{
+				LtNvDispatchTarget* p = &pPlan->pTargets[i];
+				Target* t = &targets[i];
+				check(p->primary == t->primary && p->incarnation == t->incarnation,
+					  "plan target has a different primary or incarnation", n);
+				check(memcmp(p->selection, t->selection, sizeof(t->selection)) == 0 &&
+					  p->authenticated == t->authenticated && p->output == t->output,
+					  "plan target has different attributes", n);
+				check(p->addressType == t->addressType, "plan target has a different address type", n);
+				if (p->addressType != LT_AT_UNBOUND)
+				{
+					check(p->domainIndex == t->domainIndex && p->subnet == t->subnet && p->destId == t->destId,
+						  "plan target has a different address", n);
+				}
+			}
+			nTargets += count;
+		}
+	}
+	nvTable.unlock();
+	return nTargets;
+}
+
+//
+// Rounds 0 to 3 make one kind of change; later rounds mix them.
+//
+static void changeTables(LtDeviceStack* pStack, int round)
+{
+	LonApiError sts = LonApiNoError;
+
+	for (int i = 0; i < CHANGES && sts == LonApiNoError; i++)
+	{
+		switch (round < 4 ? round : pick(4))
+		{
+		case 0:
+			sts = bindNv(pick(NV_COUNT), BASE_SELECTOR + pick(NUM_SELECTORS), pick(1000));
+			break;
+		case 1:
+			sts = bindAlias(pick(ALIAS_COUNT), pick(NV_COUNT), BASE_SELECTOR + pick(NUM_SELECTORS), pick(1000));
+			break;
+		case 2:
+			sts = setAddress(pick(ADDR_COUNT), round*CHANGES + i);
+			break;
+		default:
+			pStack->getNetworkImage()->nvTable.incrementIncarnation(pick(NV_COUNT));
+			break;
+		}
+	}
+	check(sts == LonApiNoError, "changing the tables failed", sts);
+}
+
+//
+// Find the targets of updates on random selectors, and count the ones a
+// by-source selection would take from an arbitrary source.
+//
+static double timePlans(LtDeviceStack* pStack, int nLookups, long& nTaken)
+{
+	LtNetworkVariableConfigurationTable& nvTable = pStack->getNetworkImage()->nvTable;
+	unsigned int lookupSeed = 7;
+	double start = HarnessNowSecs();
+
+	nTaken = 0;
+	for (int i = 0; i < nLookups; i++)
+	{
+		int selector = BASE_SELECTOR + rand_r(&lookupSeed) % NUM_SELECTORS;
+		nvTable.lock();
+		LtNvDispatchPlan* pPlan = nvTable.getDispatchPlan(selector, FALSE);
+		for (int j = 0; pPlan != NULL && j < pPlan->count; j++)
+		{
+			LtNvDispatchTarget* pTarget = &pPlan->pTargets[j];
+			if (pTarget->selection[NV_DISPATCH_UPDATE] == LT_SELECTION_UNCONDITIONAL ||
+				(pTarget->selection[NV_DISPATCH_UPDATE] == LT_SELECTION_BYSOURCE &&
+				 pTarget->addressType == LT_AT_GROUP && pTarget->destId == 2))
+			{
+				nTaken += pTarget->primary + pTarget->incarnation;
+			}
+		}
+		nvTable.unlock();
+	}
+	return HarnessNowSecs() - start;
+}
+
+static double timeSearch(LtDeviceStack* pStack, int nLookups, long& nTaken)
+{
+	LtNetworkVariableConfigurationTable& nvTable = pStack->getNetworkImage()->nvTable;
+	unsigned int lookupSeed = 7;
+	Target targets[64];
+	double start = HarnessNowSecs();
+
+	nTaken = 0;
+	for (int i = 0; i < nLookups; i++)
+	{
+		int selector = BASE_SELECTOR + rand_r(&lookupSeed) % NUM_SELECTORS;
+		nvTable.lock();
+		int count = searchTargets(pStack, selector, FALSE, targets, 64);
+		for (int j = 0; j < count; j++)
+		{
+			Target* pTarget = &targets[j];
+			if (pTarget->selection[NV_DISPATCH_UPDATE] == LT_SELECTION_UNCONDITIONAL ||
+				(pTarget->selection[NV_DISPATCH_UPDATE] == LT_SELECTION_BYSOURCE &&
+				 pTarget->addressType == LT_AT_GROUP && pTarget->destId == 2))
+			{
+				nTaken += pTarget->primary + pTarget->incarnation;
+			}
+		}
+		nvTable.unlock();
+	}
+	return HarnessNowSecs() - start;
+}
+
+int main(int argc, char* argv[])
+{
+	int nLookups = argc > 1 ? atoi(argv[1]) : LOOKUPS;
+	int port = argc > 2 ? atoi(argv[2]) : DEVICE_PORT;
+	const char* nvdFolder = argc > 3 ? argv[3] : NVD_FOLDER;
+	LtDeviceStack* pStack;
+	LonApiError sts;
+	long nPlanTaken, nSearchTaken;
+
+	if (nLookups < 1)
+	{
+		printf("FAIL: bad arguments\n");
+		return 1;
+	}
+	sts = createStack(port, nvdFolder);
+	if (sts == LonApiNoError)
+	{
+		sts = configureStack();
+	}
+	if (sts != LonApiNoError)
+	{
+		printf("FAIL: stack setup failed with %d\n", sts);
+		return 1;
+	}
+	pStack = hStack->pStack;
+
+	int nTargets = checkPlans(pStack);
+	printf("%d NVs, %d aliases, %d selectors: %d targets\n", NV_COUNT, ALIAS_COUNT, NUM_SELECTORS, nTargets);
+	check(nTargets >= NV_COUNT, "too few targets were bound", nTargets);
+	for (int round = 0; round < CHANGE_ROUNDS; round++)
+	{
+		changeTables(pStack, round);
+		checkPlans(pStack);
+	}
+
+	// Build every plan before timing them.
+	checkPlans(pStack);
+	double tPlan = timePlans(pStack, nLookups, nPlanTaken);
+	double tSearch = timeSearch(pStack, nLookups, nSearchTaken);
+	check(nPlanTaken == nSearchTaken, "the plans took different targets to the search");
+	printf("plan   %8.0f ns/update\n", tPlan*1e9/nLookups);
+	printf("search %8.0f ns/update\n", tSearch*1e9/nLookups);
+
+	LonCtxFreeHandle(hStack);
+
+	if (nFailures != 0)
+	{
+		printf("FAIL: %d checks failed\n", nFailures);
+		return 1;
+	}
+	printf("PASS\n");
+	return 0;
+}
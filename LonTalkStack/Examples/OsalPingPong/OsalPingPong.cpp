@@ -0,0 +1,344 @@
+/*
+ * OsalPingPong.cpp
+ *
+ * Copyright © 2022 Dialog Semiconductor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in 
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * Description: Ping-pong benchmark for the POSIX OSAL binary semaphores and events.
+ *
+ *  OSAL binary semaphores and events are built on an OsalCv, which is a
+ *  futex where the platform has one and a mutex plus condition variable
+ *  elsewhere.  This program first checks the semantics every OsalCv must
+ *  keep:
+ *
+ *  - a poll (0 ticks) of a clear semaphore times out at once
+ *  - releases do not count: two releases satisfy one wait
+ *  - a timed wait on a clear semaphore times out after about that long
+ *  - a wait forever is woken by a release from another task
+ *
+ *  then passes a token back and forth between two tasks, first through a
+ *  pair of OSAL binary semaphores, then through a pair of OSAL events, and
+ *  last through a pair of binary semaphores made of a mutex and condition
+ *  variable the way the OsalCv is where there is no futex.  Every handoff
+ *  must arrive; a lost wakeup shows up as a timeout.  It reports handoffs
+ *  per second for each.
+ *
+ *  Build the stack with -DOSAL_USE_FUTEX=0 to run the same checks against
+ *  the condition variable OsalCv.
+ *
+ *  Usage: OsalPingPong [round trips]
+ *  Exits non-zero if any check fails.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "Osal.h"
+
+#define ROUND_TRIPS		200000
+#define HANDOFF_TICKS	2000		// a handoff this late was lost
+#define TIMED_TICKS		100
+
+static int nFailures = 0;
+
+static void check(int bOk, const char* what, long n = 0)
+{
+	if (!bOk && nFailures++ < 20)
+	{
+		printf("FAIL: %s (%ld)\n", what, n);
+	}
+}
+
+static double nowSecs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec/1e9;
+}
+
+//
+// A binary semaphore made of a mutex and condition variable, as the OsalCv
+// is where there is no futex.
+//
+struct CondSem
+{
+	pthread_mutex_t	mutex;
+	pthread_cond_t	cv;
+	int				state;
+};
+
+static void condSemInit(CondSem* pSem)
+{
+	pthread_mutex_init(&pSem->mutex, NULL);
+	pthread_cond_init(&pSem->cv, NULL);
+	pSem->state = 0;
+}
+
+static void condSemDestroy(CondSem* pSem)
+{
+	pthread_cond_destroy(&pSem->cv);
+	pthread_mutex_destroy(&pSem->mutex);
+}
+
+static OsalStatus condSemWait(CondSem* pSem, unsigned int ticks)
+{
+	struct timespec absTime;
+	int err = 0;
+
+	clock_gettime(CLOCK_REALTIME, &absTime);
+	absTime.tv_sec += ticks/1000;
+	absTime.tv_nsec += (ticks%1000)*1000000L;
+	if (absTime.tv_nsec >= 1000000000L)
+	{
+		absTime.tv_sec++;
+		absTime.tv_nsec -= 1000000000L;
+	}
+	pthread_mutex_lock(&pSem->mutex);
+	while (pSem->state == 0 && err == 0)
+	{
+		err = pthread_cond_timedwait(&pSem->cv, &pSem->mutex, &absTime);
+	}
+	if (pSem->state != 0)
+	{
+		pSem->state = 0;
+		err = 0;
+	}
+	pthread_mutex_unlock(&pSem->mutex);
+	return err == 0 ? OSALSTS_SUCCESS : OSALSTS_TIMEOUT;
+}
+
+static void condSemRelease(CondSem* pSem)
+{
+	pthread_mutex_lock(&pSem->mutex);
+	pSem->state = 1;
+	pthread_cond_signal(&pSem->cv);
+	pthread_mutex_unlock(&pSem->mutex);
+}
+
+//
+// The objects under test.
+//
+enum Kind { KIND_SEM, KIND_EVENT, KIND_COND };
+
+static const char* kindName[] = { "OSAL binary semaphore", "OSAL event", "mutex+condvar" };
+
+struct Sync
+{
+	Kind		kind;
+	OsalHandle	handle;
+	CondSem		cond;
+};
+
+static void syncCreate(Sync* pSync, Kind kind)
+{
+	pSync->kind = kind;
+	pSync->handle = NULL;
+	if (kind == KIND_SEM)
+	{
+		check(OsalCreateBinarySemaphore(&pSync->handle, OSAL_SEM_CLEAR) == OSALSTS_SUCCESS, "a semaphore was not created");
+	}
+	else if (kind == KIND_EVENT)
+	{
+		check(OsalCreateEvent(&pSync->handle) == OSALSTS_SUCCESS, "an event was not created");
+	}
+	else
+	{
+		condSemInit(&pSync->cond);
+	}
+}
+
+static void syncDelete(Sync* pSync)
+{
+	if (pSync->kind == KIND_SEM)
+	{
+		OsalDeleteBinarySemaphore(&pSync->handle);
+	}
+	else if (pSync->kind == KIND_EVENT)
+	{
+		OsalDeleteEvent(&pSync->handle);
+	}
+	else
+	{
+		condSemDestroy(&pSync->cond);
+	}
+}
+
+static OsalStatus syncWait(Sync* pSync, unsigned int ticks)
+{
+	if (pSync->kind == KIND_SEM)
+	{
+		return OsalWaitForBinarySemaphore(pSync->handle, ticks);
+	}
+	if (pSync->kind == KIND_EVENT)
+	{
+		return OsalWaitForEvent(pSync->handle, ticks);
+	}
+	return condSemWait(&pSync->cond, ticks);
+}
+
+static void syncRelease(Sync* pSync)
+{
+	if (pSync->kind == KIND_SEM)
+	{
+		OsalReleaseBinarySemaphore(pSync->handle);
+	}
+	else if (pSync->kind == KIND_EVENT)
+	{
+		OsalSetEvent(pSync->handle);
+	}
+	else
+	{
+		condSemRelease(&pSync->cond);
+	}
+}
+
+//
+// Semantic checks.
+//
+static Sync* pWakeSync;
+
+static void* releaseLater(void*)
+{
+	struct timespec ts = { 0, 20000000 };	// 20 ms
+
+	nanosleep(&ts, NULL);
+	syncRelease(pWakeSync);
+	return NULL;
+}
+
+static void checkSemantics(Kind kind)
+{
+	Sync sync;
+	pthread_t thread;
+	double start;
+	double elapsed;
+
+	syncCreate(&sync, kind);
+
+	start = nowSecs();
+	check(syncWait(&sync, 0) == OSALSTS_TIMEOUT, "a poll of a clear object did not time out", kind);
+	check(nowSecs() - start < 0.01, "a poll of a clear object waited", kind);
+
+	syncRelease(&sync);
+	syncRelease(&sync);
+	check(syncWait(&sync, 0) == OSALSTS_SUCCESS, "a poll of a set object failed", kind);
+	check(syncWait(&sync, 0) == OSALSTS_TIMEOUT, "two releases satisfied two waits", kind);
+
+	start = nowSecs();
+	check(syncWait(&sync, TIMED_TICKS) == OSALSTS_TIMEOUT, "a timed wait did not time out", kind);
+	elapsed = nowSecs() - start;
+	check(elapsed >= TIMED_TICKS/1000.0 - 0.001, "a timed wait timed out early", (long)(elapsed*1e6));
+	check(elapsed < TIMED_TICKS/1000.0 + 0.5, "a timed wait timed out late", (long)(elapsed*1e6));
+
+	pWakeSync = &sync;
+	pthread_create(&thread, NULL, releaseLater, NULL);
+	check(syncWait(&sync, OSAL_WAIT_FOREVER) == OSALSTS_SUCCESS, "a wait forever was not woken", kind);
+	pthread_join(thread, NULL);
+
+	syncDelete(&sync);
+}
+
+//
+// Ping-pong.
+//
+struct PingPong
+{
+	Sync	ping;
+	Sync	pong;
+	int		nRoundTrips;
+	int		nLost;
+};
+
+static void* pongTask(void* arg)
+{
+	PingPong* p = (PingPong*)arg;
+
+	for (int i = 0; i < p->nRoundTrips; i++)
+	{
+		if (syncWait(&p->ping, HANDOFF_TICKS) != OSALSTS_SUCCESS)
+		{
+			__sync_fetch_and_add(&p->nLost, 1);
+		}
+		syncRelease(&p->pong);
+	}
+	return NULL;
+}
+
+static void runPingPong(Kind kind, int nRoundTrips)
+{
+	PingPong pp;
+	pthread_t thread;
+	double start;
+	double elapsed;
+
+	syncCreate(&pp.ping, kind);
+	syncCreate(&pp.pong, kind);
+	pp.nRoundTrips = nRoundTrips;
+	pp.nLost = 0;
+
+	pthread_create(&thread, NULL, pongTask, &pp);
+	start = nowSecs();
+	for (int i = 0; i < nRoundTrips; i++)
+	{
+		syncRelease(&pp.ping);
+		if (syncWait(&pp.pong, HANDOFF_TICKS) != OSALSTS_SUCCESS)
+		{
+			__sync_fetch_and_add(&pp.nLost, 1);
+		}
+	}
+	elapsed = nowSecs() - start;
+	pthread_join(thread, NULL);
+
+	check(pp.nLost == 0, "handoffs were lost", pp.nLost);
+	printf("%-22s %9.0f handoffs/s  %6.2f us per round trip\n", kindName[kind],
+		   2*nRoundTrips/elapsed, elapsed/nRoundTrips*1e6);
+
+	syncDelete(&pp.ping);
+	syncDelete(&pp.pong);
+}
+
+int main(int argc, char* argv[])
+{
+	int nRoundTrips = argc > 1 ? atoi(argv[1]) : ROUND_TRIPS;
+
+	if (nRoundTrips < 1)
+	{
+		printf("FAIL: bad arguments\n");
+		return 1;
+	}
+	checkSemantics(KIND_SEM);
+	checkSemantics(KIND_EVENT);
+	checkSemantics(KIND_COND);
+
+	printf("%d round trips\n", nRoundTrips);
+	runPingPong(KIND_SEM, nRoundTrips);
+	runPingPong(KIND_EVENT, nRoundTrips);
+	runPingPong(KIND_COND, nRoundTrips);
+
+	if (nFailures != 0)
+	{
+		printf("FAIL: %d checks failed\n", nFailures);
+		return 1;
+	}
+	printf("PASS\n");
+	return 0;
+}
@@ -0,0 +1,325 @@
+/*
+ * PaRingCheck.cpp
+ *
+ * Copyright © 2022 Dialog Semiconductor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in 
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * Description: Check of the protocol analyzer capture ring.
+ *
+ *  LonLink copies every packet it sends or receives into an
+ *  LtPaCaptureRing while an analyzer is registered, and a separate task
+ *  drains the ring into the analyzer.  This program drives the ring
+ *  directly:
+ *
+ *  - wrap      frames are put and drained in bursts of every size up to
+ *  the ring's, starting just short of the wrap of the ring's
+ *  unsigned positions.  Each frame must come out once, in
+ *  order, with the CRC appended where the SICB had none.
+ *  - overflow  a full ring drops and counts further frames without
+ *  disturbing the ones in it, and takes frames again once
+ *  drained.  This is checked on both sides of the wrap.
+ *  - threads   several threads put numbered frames while one drains,
+ *  sleeping on a semaphore whenever the ring is empty, the way
+ *  the link's drain task does.  Every frame captured must be
+ *  drained exactly once and in order per thread, and the
+ *  drainer must never sleep with a frame waiting.
+ *
+ *  Usage: PaRingCheck [threads [frames per thread]]
+ *  Exits non-zero if any check fails.
+ */
+
+#include "LtStackInternal.h"
+#include "LtPaCaptureRing.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <time.h>
+#include <errno.h>
+
+#define THREADS			4
+#define FRAMES			200000
+#define MAX_THREADS		32
+#define WRAP_START		(0xFFFFFFFFu - 1000)
+#define FRAME_LEN		8			// SICB length byte; the frame is 2 bytes more
+#define SLEEP_TIMEOUT	1000		// ms the drainer may sleep with frames waiting
+
+static int nFailures = 0;
+
+static void check(boolean bOk, const char* what, unsigned int n = 0)
+{
+	if (!bOk && __sync_fetch_and_add(&nFailures, 1) < 20)
+	{
+		printf("FAIL: %s (%u)\n", what, n);
+	}
+}
+
+static void makeFrame(byte* pSicb, int thread, unsigned int seq)
+{
+	memset(pSicb, 0, FRAME_LEN + 2);
+	pSicb[0] = 0x1A;
+	pSicb[1] = FRAME_LEN;
+	pSicb[2] = (byte)thread;
+	memcpy(&pSicb[3], &seq, sizeof(seq));
+}
+
+//
+// Single-threaded checks.  The sink checks that frames come out in the
+// order they went in.
+//
+static unsigned int nNextOut;
+static boolean bCrcExpected;
+
+static void orderSink(char* pData, int len)
+{
+	unsigned int seq;
+	byte* p = (byte*)pData;
+
+	memcpy(&seq, &p[3], sizeof(seq));
+	check(seq == nNextOut, "wrap: frame out of order", seq);
+	if (bCrcExpected)
+	{
+		check(len == FRAME_LEN + 4 && p[1] == FRAME_LEN + 2 && p[len - 2] == 0 && p[len - 1] == 0,
+			  "wrap: CRC not appended", seq);
+	}
+	else
+	{
+		check(len == FRAME_LEN + 2, "wrap: frame length changed", seq);
+	}
+	nNextOut++;
+}
+
+static void checkWrap()
+{
+	LtPaCaptureRing ring(WRAP_START);
+	unsigned int nIn = 0;
+	byte sicb[FRAME_LEN + 4];
+
+	nNextOut = 0;
+	for (int round = 0; round < 20; round++)
+	{
+		for (int burst = 1; burst <= LT_PA_RING_SLOTS; burst++)
+		{
+			bCrcExpected = burst % 2 == 0;
+			for (int i = 0; i < burst; i++)
+			{
+				makeFrame(sicb, 0, nIn++);
+				check(ring.put(sicb, !bCrcExpected), "wrap: frame dropped with room in the ring", nIn);
+			}
+			check(ring.drain(orderSink, burst + 1) == burst, "wrap: drained the wrong number", burst);
+		}
+	}
+	check(nNextOut == nIn, "wrap: frames lost", nNextOut);
+	check(ring.getCount(LT_PA_STAT_CAPTURED) == nIn && ring.getCount(LT_PA_STAT_DELIVERED) == nIn &&
+		  ring.getCount(LT_PA_STAT_DROPPED) == 0, "wrap: counts wrong");
+}
+
+static void checkOverflow(unsigned int nStart)
+{
+	LtPaCaptureRing ring(nStart);
+	byte sicb[FRAME_LEN + 4];
+	unsigned int nIn = 0;
+
+	nNextOut = 0;
+	bCrcExpected = false;
+	for (int round = 0; round < 4; round++)
+	{
+		for (int i = 0; i < LT_PA_RING_SLOTS; i++)
+		{
+			makeFrame(sicb, 0, nIn++);
+			check(ring.put(sicb, true), "overflow: frame dropped before the ring was full", nIn);
+		}
+		for (int i = 0; i < 10; i++)
+		{
+			makeFrame(sicb, 0, 0xDEAD);
+			check(!ring.put(sicb, true), "overflow: frame taken by a full ring", i);
+		}
+		check(!ring.setIdle(), "overflow: full ring went idle");
+		check(ring.drain(orderSink, LT_PA_RING_SLOTS * 2) == LT_PA_RING_SLOTS, "overflow: frames lost", round);
+		check(ring.setIdle(), "overflow: empty ring did not go idle");
+		makeFrame(sicb, 0, nIn++);
+		check(ring.put(sicb, true) && ring.takeIdle() && !ring.takeIdle(), "overflow: put did not wake the drainer once");
+		check(ring.drain(orderSink, 1) == 1, "overflow: frame after the wake lost");
+	}
+	check(ring.getCount(LT_PA_STAT_DROPPED) == 40, "overflow: drops not counted");
+	check(nNextOut == nIn, "overflow: frames lost", nNextOut);
+}
+
+//
+// Multi-threaded check.
+//
+struct Producer
+{
+	pthread_t		tid;
+	int				index;
+	unsigned int	nFrames;
+	unsigned int	nCaptured;
+	unsigned int	nWakes;
+};
+
+static LtPaCaptureRing* pRing;
+static sem_t semWake;
+static unsigned int nNext[MAX_THREADS];
+static unsigned int nDrained[MAX_THREADS];
+static volatile int nFinished = 0;
+
+static void threadSink(char* pData, int len)
+{
+	byte* p = (byte*)pData;
+	unsigned int seq;
+	int thread = p[2];
+
+	memcpy(&seq, &p[3], sizeof(seq));
+	check(thread < MAX_THREADS && seq >= nNext[thread], "threads: frame out of order", seq);
+	if (thread < MAX_THREADS)
+	{
+		nNext[thread] = seq + 1;
+		nDrained[thread]++;
+	}
+}
+
+static void* producerTask(void* pArg)
+{
+	Producer* pProducer = (Producer*)pArg;
+	byte sicb[FRAME_LEN + 4];
+
+	for (unsigned int seq = 0; seq < pProducer->nFrames; seq++)
+	{
+		makeFrame(sicb, pProducer->index, seq);
+		if (pRing->put(sicb, true))
+		{
+			pProducer->nCaptured++;
+			if (pRing->takeIdle())
+			{
+				pProducer->nWakes++;
+				sem_post(&semWake);
+			}
+		}
+		// Pause now and then, so the drainer often finds the ring empty.
+		if (seq % 64 == 0)
+		{
+			sched_yield();
+		}
+	}
+	__sync_fetch_and_add(&nFinished, 1);
+	sem_post(&semWake);
+	return NULL;
+}
+
+//
+// The drainer's sleep.  Returns false if nobody woke it within the timeout.
+//
+static boolean sleepUntilWoken()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += SLEEP_TIMEOUT / 1000;
+	while (sem_timedwait(&semWake, &ts) != 0)
+	{
+		if (errno != EINTR)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+static void checkThreads(int nThreads, unsigned int nFrames)
+{
+	Producer producers[MAX_THREADS];
+	unsigned int nSleeps = 0;
+	unsigned int nCaptured = 0;
+	unsigned int nWakes = 0;
+	unsigned int nDrainedAll = 0;
+
+	pRing = new LtPaCaptureRing(WRAP_START);
+	sem_init(&semWake, 0, 0);
+	memset(producers, 0, sizeof(producers));
+	for (int i = 0; i < nThreads; i++)
+	{
+		producers[i].index = i;
+		producers[i].nFrames = nFrames;
+		pthread_create(&producers[i].tid, NULL, producerTask, &producers[i]);
+	}
+
+	// Drain until every producer has finished.
+	while (nFinished < nThreads)
+	{
+		if (pRing->drain(threadSink, LT_PA_RING_SLOTS/2) == 0 && pRing->setIdle())
+		{
+			nSleeps++;
+			if (!sleepUntilWoken())
+			{
+				// Nobody woke us, which is only right if nothing was put.
+				check(nFinished == nThreads || pRing->drain(threadSink, 1) == 0,
+					  "threads: drainer slept with a frame waiting");
+			}
+		}
+	}
+	while (pRing->drain(threadSink, LT_PA_RING_SLOTS) != 0)
+	{
+	}
+
+	for (int i = 0; i < nThreads; i++)
+	{
+		pthread_join(producers[i].tid, NULL);
+		check(nDrained[i] == producers[i].nCaptured, "threads: captured frames not drained once", i);
+		nCaptured += producers[i].nCaptured;
+		nWakes += producers[i].nWakes;
+		nDrainedAll += nDrained[i];
+	}
+	check(pRing->getCount(LT_PA_STAT_CAPTURED) == nCaptured &&
+		  pRing->getCount(LT_PA_STAT_DELIVERED) == nDrainedAll &&
+		  pRing->getCount(LT_PA_STAT_DROPPED) == (ULONGLONG)nThreads * nFrames - nCaptured,
+		  "threads: counts wrong");
+	printf("%d threads, %u frames: %u captured, %llu dropped, %u sleeps, %u wakes\n",
+		   nThreads, nThreads * nFrames, nCaptured, pRing->getCount(LT_PA_STAT_DROPPED), nSleeps, nWakes);
+	sem_destroy(&semWake);
+	delete pRing;
+}
+
+int main(int argc, char* argv[])
+{
+	int nThreads = argc > 1 ? atoi(argv[1]) : THREADS;
+	int nFrames = argc > 2 ? atoi(argv[2]) : FRAMES;
+
+	if (nThreads < 1 || nThreads > MAX_THREADS || nFrames < 1)
+	{
+		printf("FAIL: bad arguments\n");
+		return 1;
+	}
+	checkWrap();
+	checkOverflow(WRAP_START);
+	checkOverflow(0xFFFFFFFFu - LT_PA_RING_SLOTS/2);
+	checkOverflow(0);
+	checkThreads(nThreads, (unsigned int)nFrames);
+
+	if (nFailures != 0)
+	{
+		printf("FAIL: %d checks failed\n", nFailures);
+		return 1;
+	}
+	printf("PASS\n");
+	return 0;
+}
@@ -0,0 +1,332 @@
+/*
+ * PropagateBench.cpp
+ *
+ * Copyright © 2022 Dialog Semiconductor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in 
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * Description: Loopback NV propagation throughput benchmark.
+ *
+ *  The program creates one IzoT device on the loopback interface with two
+ *  synchronous output NVs, one normal and one priority, each turned around
+ *  to an input NV.  It then propagates them as fast as the stack takes them,
+ *  in three ways:
+ *
+ *  - single    LonCtxPropagateNv() for the normal output NV;
+ *  - batch     LonCtxPropagateNvs() with both output NVs, so the normal
+ *  and priority messages come from their own LtMsgOut free
+ *  lists;
+ *  - priority  LonCtxPropagateNv() for the priority output NV.
+ *
+ *  When the stack is out of buffers it returns LonApiTxBufIsFull, and the
+ *  program pumps events until one is free.  Every propagation must complete
+ *  successfully and update its input NV exactly once, with the last value
+ *  sent.
+ *
+ *  Usage: PropagateBench [updates [port [nvd-folder]]]
+ *  Prints the updates per second for each run, then PASS or FAIL, and
+ *  exits non-zero on failure.
+ */
+
+#include "FtxlApi.h"
+#include "DeviceHarness.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define UPDATES			20000
+#define PORT			28500
+#define NVD_FOLDER		"/tmp/PropagateBench"
+#define NVI_INDEX		0
+#define NVO_INDEX		1
+#define NVI_PRI_INDEX	2
+#define NVO_PRI_INDEX	3
+#define NUM_NVS			4
+#define PUMP_TIMEOUT	10.0		// seconds to wait for the last events
+
+static const HarnessDevice device = {
+	"PropagateBench",
+	0x13,						// model
+	NUM_NVS,					// static NVs
+	15,							// address table entries
+	0,							// aliases
+	5, 5						// priority and non-priority output buffers
+};
+
+static LonStackHandle hStack = NULL;
+static LonUniqueId uid = { 0x00, 0xD0, 0x71, 0x40, 0x10, 0x01 };
+static LonByte nvValues[NUM_NVS][2];
+static int nCompleted[NUM_NVS];
+static int nUpdated[NUM_NVS];
+static int nFailed = 0;				// completions that failed, or stray events
+static int nFailures = 0;
+
+static void failed(const char* what)
+{
+	if (nFailures++ < 20)
+	{
+		printf("FAIL: %s\n", what);
+	}
+}
+
+static void myNvUpdateOccurred(void* pUserContext, const unsigned index, 
+							   const LonReceiveAddress* const pSourceAddress)
+{
+	if (index == NVI_INDEX || index == NVI_PRI_INDEX)
+	{
+		nUpdated[index]++;
+	}
+	else
+	{
+		nFailed++;
+	}
+}
+
+static void myNvUpdateCompleted(void* pUserContext, const unsigned index, const LonBool success)
+{
+	if ((index == NVO_INDEX || index == NVO_PRI_INDEX) && success)
+	{
+		nCompleted[index]++;
+	}
+	else
+	{
+		nFailed++;
+	}
+}
+
+static LonApiError registerNv(int index, const char* name, unsigned flags)
+{
+	return HarnessRegisterNv(hStack, nvValues[index], name, flags | LON_NV_SERVICE_CONFIG | LON_NV_PRIORITY_CONFIG);
+}
+
+static LonApiError createStack(int port, const char* nvdFolder)
+{
+	LonCtxCallbacks callbacks;
+	LonApiError sts;
+
+	memset(&callbacks, 0, sizeof(callbacks));
+	callbacks.nvUpdateOccurred = myNvUpdateOccurred;
+	callbacks.nvUpdateCompleted = myNvUpdateCompleted;
+
+	sts = HarnessCreateStack(&hStack, &callbacks, &device, &uid, port, nvdFolder);
+	if (sts == LonApiNoError)
+		sts = registerNv(NVI_INDEX, "nviValue", LON_NV_SYNC);
+	if (sts == LonApiNoError)
+		sts = registerNv(NVO_INDEX, "nvoValue", LON_NV_IS_OUTPUT | LON_NV_SYNC | LON_NV_UNACKD);
+	if (sts == LonApiNoError)
+		sts = registerNv(NVI_PRI_INDEX, "nviPriValue", LON_NV_SYNC);
+	if (sts == LonApiNoError)
+		sts = registerNv(NVO_PRI_INDEX, "nvoPriValue", LON_NV_IS_OUTPUT | LON_NV_SYNC | LON_NV_UNACKD | LON_NV_PRIORITY);
+	if (sts == LonApiNoError)
+		sts = HarnessStartStack(hStack);
+	return sts;
+}
+
+//
+// Turn each output NV around to its input NV through a turnaround address
+// table entry, and take the device online.
+//
+static LonApiError configureStack()
+{
+	LonDomain domain;
+	LonAddress address;
+	LonNvEcsConfig nvc;
+	LonApiError sts;
+
+	sts = LonCtxQueryDomainConfig(hStack, 0, &domain);
+	if (sts == LonApiNoError)
+	{
+		domain.Id[0] = 0x5B;
+		LON_SET_ATTRIBUTE(domain, LON_DOMAIN_ID_LENGTH, 1);
+		domain.Subnet = 1;
+		LON_SET_ATTRIBUTE(domain, LON_DOMAIN_NODE, 1);
+		LON_SET_ATTRIBUTE(domain, LON_DOMAIN_INVALID, 0);
+		sts = LonCtxUpdateDomainConfig(hStack, 0, &domain);
+	}
+	if (sts == LonApiNoError)
+	{
+		memset(&address, 0, sizeof(address));
+		address.Turnaround.Turnaround = 1;
+		sts = LonCtxUpdateAddressConfig(hStack, 0, &address);
+	}
+	for (int index = 0; sts == LonApiNoError && index < NUM_NVS; index++)
+	{
+		unsigned selector = index < NVI_PRI_INDEX ? 0x1000 : 0x1001;
+
+		sts = LonCtxQueryNvConfig(hStack, index, &nvc);
+		if (sts == LonApiNoError)
+		{
+			LON_SET_ATTRIBUTE(nvc, LON_NV_ECS_SELHIGH, selector >> 8);
+			nvc.SelectorLow = (LonByte)selector;
+			LON_SET_ATTRIBUTE(nvc, LON_NV_ECS_TURNAROUND, 1);
+			LON_SET_ATTRIBUTE(nvc, LON_NV_ECS_PRIORITY, index == NVO_PRI_INDEX);
+			if (index == NVO_INDEX || index == NVO_PRI_INDEX)
+			{
+				LON_SET_UNSIGNED_WORD(nvc.AddressIndex, 0);
+			}
+			sts = LonCtxUpdateNvConfig(hStack, index, &nvc);
+		}
+	}
+	if (sts == LonApiNoError)
+		sts = LonCtxSetNodeMode(hStack, LonChangeState, LonConfigOnLine);
+	if (sts == LonApiNoError)
+		sts = LonCtxSetNodeMode(hStack, LonApplicationOnLine, LonStateInvalid);
+	return sts;
+}
+
+static void setValue(int index, int n)
+{
+	LonByte value[2] = { (LonByte)(n >> 8), (LonByte)n };
+
+	LonCtxSetNvValue(hStack, index, value);
+}
+
+//
+// Pump events until the expected number of updates have completed and
+// arrived, or the timeout passes.
+//
+static void waitFor(const int* pCompleted, const int* pUpdated)
+{
+	double deadline = HarnessNowSecs() + PUMP_TIMEOUT;
+
+	while ((nCompleted[NVO_INDEX] < pCompleted[NVO_INDEX] || nCompleted[NVO_PRI_INDEX] < pCompleted[NVO_PRI_INDEX] ||
+			nUpdated[NVI_INDEX] < pUpdated[NVI_INDEX] || nUpdated[NVI_PRI_INDEX] < pUpdated[NVI_PRI_INDEX]) &&
+		   HarnessNowSecs() < deadline)
+	{
+		if (!LonCtxEventPumpEx(hStack, 0))
+		{
+			usleep(100);
+		}
+	}
+}
+
+static void run(const char* name, const unsigned* pIndices, unsigned count, int nUpdates)
+{
+	int expectCompleted[NUM_NVS];
+	int expectUpdated[NUM_NVS];
+	int nFull = 0;
+
+	memcpy(expectCompleted, nCompleted, sizeof(nCompleted));
+	memcpy(expectUpdated, nUpdated, sizeof(nUpdated));
+
+	double start = HarnessNowSecs();
+	for (int n = 1; n <= nUpdates; n++)
+	{
+		unsigned nDone = 0;
+
+		for (unsigned i = 0; i < count; i++)
+		{
+			setValue(pIndices[i], n);
+		}
+		while (nDone < count)
+		{
+			unsigned nPropagated = 0;
+			LonApiError sts = count == 1 ?
+				LonCtxPropagateNv(hStack, pIndices[0]) :
+				LonCtxPropagateNvs(hStack, pIndices + nDone, count - nDone, &nPropagated);
+
+			if (count == 1 && sts == LonApiNoError)
+			{
+				nPropagated = 1;
+			}
+			nDone += nPropagated;
+			if (sts == LonApiTxBufIsFull)
+			{
+				nFull++;
+				LonCtxEventPumpEx(hStack, 0);
+			}
+			else if (sts != LonApiNoError)
+			{
+				failed("propagate returned an error");
+				return;
+			}
+		}
+		for (unsigned i = 0; i < count; i++)
+		{
+			expectCompleted[pIndices[i]]++;
+			expectUpdated[pIndices[i] - 1]++;
+		}
+	}
+	waitFor(expectCompleted, expectUpdated);
+	double secs = HarnessNowSecs() - start;
+
+	printf("%-9s %8d updates %9.0f updates/s  (%d retries out of buffers)\n",
+		   name, nUpdates * count, nUpdates * count / secs, nFull);
+	for (unsigned i = 0; i < count; i++)
+	{
+		int index = pIndices[i];
+		if (nCompleted[index] != expectCompleted[index])
+		{
+			failed("an output NV update did not complete exactly once");
+		}
+		if (nUpdated[index - 1] != expectUpdated[index - 1])
+		{
+			failed("an input NV was not updated exactly once");
+		}
+		else if (memcmp(nvValues[index - 1], nvValues[index], sizeof(nvValues[index])) != 0)
+		{
+			failed("an input NV did not get the last value sent");
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	int nUpdates = argc > 1 ? atoi(argv[1]) : UPDATES;
+	int port = argc > 2 ? atoi(argv[2]) : PORT;
+	const char* nvdFolder = argc > 3 ? argv[3] : NVD_FOLDER;
+	static const unsigned normal[] = { NVO_INDEX };
+	static const unsigned both[] = { NVO_INDEX, NVO_PRI_INDEX };
+	static const unsigned priority[] = { NVO_PRI_INDEX };
+
+	LonApiError sts = createStack(port, nvdFolder);
+	if (sts == LonApiNoError)
+	{
+		sts = configureStack();
+	}
+	if (sts != LonApiNoError || nUpdates <= 0)
+	{
+		printf("FAIL: stack setup failed with %d\n", sts);
+		nFailures++;
+	}
+	else
+	{
+		run("single", normal, 1, nUpdates);
+		run("batch", both, 2, nUpdates / 2);
+		run("priority", priority, 1, nUpdates);
+		if (nFailed != 0)
+		{
+			failed("an update failed or arrived for the wrong NV");
+		}
+	}
+
+	if (hStack != NULL)
+	{
+		LonCtxFreeHandle(hStack);
+	}
+	if (nFailures != 0)
+	{
+		printf("FAIL: %d checks failed\n", nFailures);
+		return 1;
+	}
+	printf("PASS\n");
+	return 0;
+}
@@ -0,0 +1,494 @@
+/*
+ * ReceivePostBench.cpp
+ *
+ * Copyright © 2022 Dialog Semiconductor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in 
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * Description: Check and benchmark of batched receive buffer posting.
+ *
+ *  Clients of a link hand it their receive buffers with
+ *  LtLink::queueReceiveBatch(), which LtLinkBase implements by queueing
+ *  the whole batch under one acquisition of the link lock, instead of
+ *  queueReceive() once per buffer with a second call to the other
+ *  priority queue when the first is full.  This program checks, on a
+ *  LtLinkBase with no device behind it, that a batch is queued exactly as
+ *  the same buffers would be one at a time:
+ *
+ *  - buffers go to their own priority queue while it has room, then to the
+ *  other queue, whose priority the entry reports, unless told not to;
+ *  - the batch stops at the first buffer neither queue has room for, and
+ *  nothing is queued on an inactive link;
+ *  - every buffer posted is received exactly once, in the order posted
+ *  within each queue.
+ *
+ *  It then cycles NUM_BUFFERS buffers through the link, posting them one
+ *  at a time and in batches of POST_BATCH, first from a single task that
+ *  posts and then receives them, then with a receive task taking buffers
+ *  off the link while a client task posts them back as they are freed.
+ *  The figures cover the link queues only, not the packet allocators or
+ *  the drivers around them.
+ *
+ *  Usage: ReceivePostBench [seconds]
+ *  Exits non-zero if a check fails.
+ */
+
+#include "LtStackInternal.h"
+#include "LtLinkBase.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#define SECONDS			2
+#define NUM_BUFFERS		64
+#define QUEUE_DEPTH		48			// per priority queue; no spills in the runs
+#define POST_BATCH		16			// as LtIpPortClient and LtIpBase post them
+#define PRIORITY_EVERY	8			// one buffer in PRIORITY_EVERY is a priority buffer
+#define BUFFER_SIZE		256
+#define TASK_PRIORITY	100
+#define TASK_STACK		32768
+
+static int nFailures = 0;
+
+static void check(bool bOk, const char* what, long n = 0)
+{
+	if (!bOk && nFailures++ < 20)
+	{
+		printf("FAIL: %s (%ld)\n", what, n);
+	}
+}
+
+static double nowSecs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec/1e9;
+}
+
+typedef struct
+{
+	int		id;
+	boolean	bPriority;
+	int		nReceived;
+	byte	data[BUFFER_SIZE];
+} Buffer;
+
+static Buffer buffers[NUM_BUFFERS];
+
+//
+// A LtLinkBase with no device behind it.  receive() stands in for the
+// receive task of a driver, taking the next buffer to fill.
+//
+class BenchLink : public LtLinkBase
+{
+public:
+	void activate(boolean bActive, int nDepth)
+	{
+		m_bActive = bActive;
+		m_bLinkOpen = true;
+		m_nReceiveQueueDepth = nDepth;
+	}
+
+	Buffer* receive()
+	{
+		LtQue*		pItem;
+		LLPktQue*	pPkt;
+		Buffer*		pBuf = NULL;
+
+		lock();
+		if (m_qReceiveP.removeHead(&pItem) || m_qReceive.removeHead(&pItem))
+		{
+			pPkt = (LLPktQue*)pItem;
+			pBuf = (Buffer*)pPkt->m_refId;
+			check(pPkt->m_pData == pBuf->data && pPkt->m_nDataLength == BUFFER_SIZE &&
+				  pPkt->m_bPriority == pBuf->bPriority, "a buffer was queued with the wrong details", pBuf->id);
+			freeLLPkt(pPkt);
+		}
+		unlock();
+		return pBuf;
+	}
+
+	int queued(boolean bPriority)
+	{
+		return bPriority ? m_qReceiveP.getCount() : m_qReceive.getCount();
+	}
+};
+
+static BenchLink* pLink;
+
+static void describe(Buffer* pBuf, LtReceivePost& post)
+{
+	post.referenceId = pBuf;
+	post.bPriority = pBuf->bPriority;
+	post.flags = 0;
+	post.pData = pBuf->data;
+	post.nMaxLength = BUFFER_SIZE;
+}
+
+//
+// Post one buffer as clients did before batches: its own queue, then the
+// other one.
+//
+static boolean postOne(Buffer* pBuf)
+{
+	if (pLink->queueReceive(pBuf, pBuf->bPriority, 0, pBuf->data, BUFFER_SIZE) == LTSTS_PENDING)
+	{
+		return true;
+	}
+	pBuf->bPriority = !pBuf->bPriority;
+	if (pLink->queueReceive(pBuf, pBuf->bPriority, 0, pBuf->data, BUFFER_SIZE) == LTSTS_PENDING)
+	{
+		return true;
+	}
+	pBuf->bPriority = !pBuf->bPriority;
+	return false;
+}
+
+static int postBatch(Buffer** ppBufs, int nBufs, boolean bTryOther = true)
+{
+	LtReceivePost posts[NUM_BUFFERS];
+	int nQueued;
+
+	for (int i = 0; i < nBufs; i++)
+	{
+		describe(ppBufs[i], posts[i]);
+	}
+	nQueued = pLink->queueReceiveBatch(posts, nBufs, bTryOther);
+	for (int i = 0; i < nQueued; i++)
+	{
+		ppBufs[i]->bPriority = posts[i].bPriority;
+	}
+	return nQueued;
+}
+
+static void resetBuffers()
+{
+	for (int i = 0; i < NUM_BUFFERS; i++)
+	{
+		buffers[i].id = i;
+		buffers[i].bPriority = (i % PRIORITY_EVERY) == 0;
+		buffers[i].nReceived = 0;
+	}
+}
+
+//
+// Receive everything queued, in the order the receive task would, and
+// record the order.
+//
+static int receiveAll(Buffer** ppOrder)
+{
+	Buffer* pBuf;
+	int n = 0;
+
+	while ((pBuf = pLink->receive()) != NULL)
+	{
+		pBuf->nReceived++;
+		ppOrder[n++] = pBuf;
+	}
+	return n;
+}
+
+//
+// Post the same buffers one at a time and as a batch, on a link with
+// nDepth room per queue, and compare where they went.
+//
+static void checkBatch(int nBufs, int nDepth, int firstPriority, boolean bTryOther)
+{
+	Buffer* pBufs[NUM_BUFFERS];
+	Buffer* pOrder[NUM_BUFFERS];
+	boolean singlePriority[NUM_BUFFERS];
+	Buffer* singleOrder[NUM_BUFFERS];
+	int nSingle = 0;
+	int nSingleReceived;
+	long n = nBufs*10000 + nDepth*100 + firstPriority*10 + bTryOther;
+
+	pLink->activate(true, nDepth);
+	resetBuffers();
+	for (int i = 0; i < nBufs; i++)
+	{
+		pBufs[i] = &buffers[i];
+		pBufs[i]->bPriority = i >= firstPriority;
+	}
+	while (nSingle < nBufs && (bTryOther ? postOne(pBufs[nSingle]) :
+			pLink->queueReceive(pBufs[nSingle], pBufs[nSingle]->bPriority, 0, pBufs[nSingle]->data, BUFFER_SIZE) == LTSTS_PENDING))
+	{
+		singlePriority[nSingle] = pBufs[nSingle]->bPriority;
+		nSingle++;
+	}
+	nSingleReceived = receiveAll(singleOrder);
+	check(nSingleReceived == nSingle, "buffers posted one at a time were lost", n);
+
+	for (int i = 0; i < nBufs; i++)
+	{
+		pBufs[i]->bPriority = i >= firstPriority;
+	}
+	int nBatch = postBatch(pBufs, nBufs, bTryOther);
+	check(nBatch == nSingle, "a batch queued a different number of buffers", n);
+	for (int i = 0; i < nBatch && i < nSingle; i++)
+	{
+		check(pBufs[i]->bPriority == singlePriority[i], "a batch put a buffer on a different queue", n);
+	}
+	check(pLink->queued(false) <= nDepth && pLink->queued(true) <= nDepth, "a batch overfilled a queue", n);
+	int nReceived = receiveAll(pOrder);
+	check(nReceived == nBatch, "buffers posted in a batch were lost", n);
+	check(nReceived == nSingleReceived &&
+		  memcmp(pOrder, singleOrder, nReceived*sizeof(pOrder[0])) == 0,
+		  "a batch was received in a different order", n);
+	for (int i = 0; i < nBufs; i++)
+	{
+		check(buffers[i].nReceived == 2*(i < nSingle), "a buffer was received the wrong number of times", n);
+	}
+}
+
+static void checkBatches()
+{
+	Buffer* pBufs[NUM_BUFFERS];
+
+	for (int nBufs = 1; nBufs <= 24; nBufs++)
+	{
+		for (int nDepth = 1; nDepth <= 12; nDepth += 5)
+		{
+			for (int firstPriority = 0; firstPriority <= nBufs; firstPriority += 3)
+			{
+				checkBatch(nBufs, nDepth, firstPriority, true);
+				checkBatch(nBufs, nDepth, firstPriority, false);
+			}
+		}
+	}
+
+	// An inactive link takes nothing.
+	pLink->activate(false, QUEUE_DEPTH);
+	resetBuffers();
+	for (int i = 0; i < POST_BATCH; i++)
+	{
+		pBufs[i] = &buffers[i];
+	}
+	check(postBatch(pBufs, POST_BATCH) == 0, "an inactive link took buffers");
+	check(pLink->receive() == NULL, "an inactive link queued buffers");
+}
+
+//
+// Post the free buffers, one at a time or in batches.
+//
+static int post(Buffer** ppFree, int nFree, boolean bBatch)
+{
+	int nPosted = 0;
+
+	if (bBatch)
+	{
+		while (nPosted < nFree)
+		{
+			int nBatch = nFree - nPosted < POST_BATCH ? nFree - nPosted : POST_BATCH;
+			int nQueued = postBatch(&ppFree[nPosted], nBatch);
+			nPosted += nQueued;
+			if (nQueued < nBatch)
+			{
+				break;
+			}
+		}
+	}
+	else
+	{
+		while (nPosted < nFree && postOne(ppFree[nPosted]))
+		{
+			nPosted++;
+		}
+	}
+	return nPosted;
+}
+
+static void fill(Buffer* pBuf, long n)
+{
+	memcpy(pBuf->data, &n, sizeof(n));
+	pBuf->nReceived++;
+}
+
+static void checkAllReceived(long nExpected, const char* name)
+{
+	long n = 0;
+
+	for (int i = 0; i < NUM_BUFFERS; i++)
+	{
+		n += buffers[i].nReceived;
+	}
+	check(n == nExpected, name, n - nExpected);
+}
+
+static void runSingleTask(const char* name, boolean bBatch, int seconds)
+{
+	Buffer* pFree[NUM_BUFFERS];
+	Buffer* pBuf;
+	long n = 0;
+	double start;
+	double elapsed;
+
+	pLink->activate(true, QUEUE_DEPTH);
+	resetBuffers();
+	start = nowSecs();
+	do
+	{
+		for (int i = 0; i < 1000; i++)
+		{
+			for (int j = 0; j < NUM_BUFFERS; j++)
+			{
+				pFree[j] = &buffers[j];
+			}
+			check(post(pFree, NUM_BUFFERS, bBatch) == NUM_BUFFERS, "the link refused a buffer", n);
+			while ((pBuf = pLink->receive()) != NULL)
+			{
+				fill(pBuf, n++);
+			}
+		}
+		elapsed = nowSecs() - start;
+	} while (elapsed < seconds);
+	checkAllReceived(n, "a buffer was lost or received twice");
+	printf("%-26s %10.0f buffers/s\n", name, n/elapsed);
+}
+
+//
+// The receive task takes buffers off the link and frees them to the
+// client task, which posts them back.
+//
+static SEM_ID freeLock;
+static Buffer* pFreed[NUM_BUFFERS];
+static volatile int nFreed;
+static volatile int bStop;
+static volatile int nDone;
+static volatile long nReceivedByTask;
+
+static int VXLCDECL receiveTask(int a1, ...)
+{
+	Buffer* pBuf;
+	long n = 0;
+
+	while (!bStop)
+	{
+		pBuf = pLink->receive();
+		if (pBuf == NULL)
+		{
+			taskDelay(0);
+			continue;
+		}
+		fill(pBuf, n++);
+		semTake(freeLock, WAIT_FOREVER);
+		pFreed[nFreed++] = pBuf;
+		semGive(freeLock);
+	}
+	nReceivedByTask = n;
+	__sync_fetch_and_add(&nDone, 1);
+	return 0;
+}
+
+static int VXLCDECL clientTask(int bBatch, ...)
+{
+	Buffer* pFree[NUM_BUFFERS];
+	int nFree = 0;
+	int nPosted;
+
+	while (!bStop)
+	{
+		semTake(freeLock, WAIT_FOREVER);
+		memcpy(&pFree[nFree], pFreed, nFreed*sizeof(pFreed[0]));
+		nFree += nFreed;
+		nFreed = 0;
+		semGive(freeLock);
+		if (nFree == 0)
+		{
+			taskDelay(0);
+			continue;
+		}
+		nPosted = post(pFree, nFree, bBatch);
+		check(nPosted == nFree, "the link refused a buffer", nFree - nPosted);
+		nFree -= nPosted;
+		memmove(pFree, &pFree[nPosted], nFree*sizeof(pFree[0]));
+	}
+	// Give back what was not posted
+	semTake(freeLock, WAIT_FOREVER);
+	memcpy(&pFreed[nFreed], pFree, nFree*sizeof(pFree[0]));
+	nFreed += nFree;
+	semGive(freeLock);
+	__sync_fetch_and_add(&nDone, 1);
+	return 0;
+}
+
+static void runTasks(const char* name, boolean bBatch, int seconds)
+{
+	Buffer* pOrder[NUM_BUFFERS];
+	double start;
+	double elapsed;
+
+	pLink->activate(true, QUEUE_DEPTH);
+	resetBuffers();
+	nFreed = 0;
+	for (int i = 0; i < NUM_BUFFERS; i++)
+	{
+		pFreed[nFreed++] = &buffers[i];
+	}
+	bStop = FALSE;
+	nDone = 0;
+	start = nowSecs();
+	taskSpawn("RcvTask", TASK_PRIORITY, 0, TASK_STACK, receiveTask, 0, 0,0,0,0, 0,0,0,0,0);
+	taskSpawn("RcvClient", TASK_PRIORITY, 0, TASK_STACK, clientTask, bBatch, 0,0,0,0, 0,0,0,0,0);
+	sleep(seconds);
+	bStop = TRUE;
+	while (nDone < 2)
+	{
+		usleep(1000);
+	}
+	elapsed = nowSecs() - start;
+
+	// Every buffer is either still on the link or freed.
+	int nLeft = receiveAll(pOrder);
+	check(nLeft + nFreed == NUM_BUFFERS, "buffers went missing", nLeft + nFreed);
+	checkAllReceived(nReceivedByTask + nLeft, "a buffer was lost or received twice");
+	printf("%-26s %10.0f buffers/s\n", name, nReceivedByTask/elapsed);
+}
+
+int main(int argc, char* argv[])
+{
+	int seconds = argc > 1 ? atoi(argv[1]) : SECONDS;
+
+	if (seconds < 1)
+	{
+		printf("FAIL: bad arguments\n");
+		return 1;
+	}
+
+	pLink = new BenchLink();
+	freeLock = semMCreate(SEM_Q_PRIORITY | SEM_INVERSION_SAFE);
+
+	checkBatches();
+
+	printf("%d buffers, batches of %d\n", NUM_BUFFERS, POST_BATCH);
+	runSingleTask("one task, one at a time", false, seconds);
+	runSingleTask("one task, batched", true, seconds);
+	runTasks("receive task, one at a time", false, seconds);
+	runTasks("receive task, batched", true, seconds);
+
+	if (nFailures != 0)
+	{
+		printf("FAIL: %d checks failed\n", nFailures);
+		return 1;
+	}
+	printf("PASS\n");
+	return 0;
+}
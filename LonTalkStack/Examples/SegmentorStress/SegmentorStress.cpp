@@ -0,0 +1,418 @@
+/*
+ * SegmentorStress.cpp
+ *
+ * Copyright © 2022 Dialog Semiconductor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in 
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * Description: Stress test of the IP segmentor.
+ *
+ *  LtIpSegmentor reassembles segmented channel membership and routing
+ *  responses.  Outstanding requests are kept in a hash on peer address,
+ *  port and request id and on a heap ordered on their next timeout, and
+ *  payloads are reassembled into a pooled buffer.  This program simulates
+ *  thousands of peers, each sending one segmented response to the same
+ *  segmentor, all interleaved:
+ *
+ *  - each peer sends segment zero first and the rest in a random order,
+ *  with some segments sent twice;
+ *  - some peers lose one segment.  doTimeout() must ask each of those
+ *  peers, and only them, for the missing segment at once, again only
+ *  after the retransmit time, and not once its arrival completes the
+ *  response;
+ *  - every response must be delivered exactly once, byte for byte, with
+ *  its source address and port, while the test holds on to more
+ *  reassembled payloads than the pool has buffers;
+ *  - once the quiet time has passed, doTimeout() must drop every request.
+ *
+ *  It reports segments and payload bytes reassembled per second.
+ *
+ *  Usage: SegmentorStress [peers [rounds]]
+ *  Exits non-zero if any check fails.
+ */
+
+#include <vxWorks.h>
+#include <tickLib.h>
+#include <LtRouter.h>
+#include <LtMD5.h>
+#include <IpLink.h>
+#include <vxlTarget.h>
+#include <LtIpPackets.h>
+#include <Segment.h>
+#include <LtCUtil.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define PEERS			2000
+#define ROUNDS			3
+#define MAX_SEGS		12			// segments in the largest response
+#define DUP_PERCENT		10			// segments sent twice
+#define LOSS_PERCENT	5			// peers that lose one segment
+#define HOLD			300			// reassembled payloads held, more than the pool has
+#define PEER_IP_BASE	0x0A000001	// 10.0.0.1
+#define PEER_PORT		1629
+
+static int nFailures = 0;
+
+static void check(int bOk, const char* what, long n = 0)
+{
+	if (!bOk && nFailures++ < 20)
+	{
+		printf("FAIL: %s (%ld)\n", what, n);
+	}
+}
+
+static double nowSecs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec/1e9;
+}
+
+struct Peer
+{
+	ULONG		ipAddr;
+	word		port;
+	word		reqId;
+	byte*		pPayload;
+	int			nSize;
+	int			nSegs;
+	int			nLost;				// the lost segment, or -1
+	int			nNext;				// next segment of order[] to send
+	int			nDelivered;
+	int			nAsked;				// retransmit requests for the lost segment
+	int			order[MAX_SEGS*2];	// segments in the order they are sent
+	int			nOrder;
+	LtPktInfo*	pSegs[MAX_SEGS];	// built segments, copied for each send
+	int			nSegSize[MAX_SEGS];
+};
+
+static Peer* pPeers;
+static int nPeers;
+
+static Peer* findPeer(ULONG ipAddr, word port)
+{
+	int i = (int)(ipAddr - PEER_IP_BASE);
+	if (i < 0 || i >= nPeers || pPeers[i].port != port)
+	{
+		return NULL;
+	}
+	return &pPeers[i];
+}
+
+//
+// A link that takes the retransmit requests the segmentor sends.
+//
+class StubLink : public CIpLink
+{
+public:
+	int		m_nSent;
+
+	StubLink() { m_nSent = 0; }
+	virtual LtSts sendPacketTo(void* refId, ULONG ipAddr, word port, byte* pData, int nLen)
+	{
+		LtIpPktHeader hdr;
+		Peer* pPeer = findPeer(ipAddr, port);
+
+		// The request fields follow the header: date time (4), reason (1),
+		// request id (2) and segment id (1).  LtIpRequest::parse() sizes
+		// them with sizeof(ULONG), so they are read here directly.
+		m_nSent++;
+		hdr.parse(pData, false);
+		byte* p = hdr.pRemaining + 5;
+		int reqId = (p[0] << 8) | p[1];
+		int segmentId = p[2];
+
+		check(pPeer != NULL, "a request went to an unknown peer", (long)ipAddr);
+		if (pPeer != NULL)
+		{
+			check(hdr.packetType == PKTTYPE_REQCHNMEMBERS, "a request has the wrong type", hdr.packetType);
+			check(reqId == pPeer->reqId, "a request has the wrong request id", reqId);
+			check(pPeer->nLost != -1 && segmentId == pPeer->nLost, "a request asked for the wrong segment", segmentId);
+			pPeer->nAsked++;
+		}
+		((LtPktInfo*)refId)->release();
+		return LTSTS_OK;
+	}
+};
+
+// A segmentor whose timer is driven by the test alone.
+class StressSegmentor : public LtIpSegmentor
+{
+public:
+	virtual void startTimer(int msTimeout) {}
+	boolean timeout(ULONG nTickNow) { return doTimeout(nTickNow); }
+};
+
+static LtPktInfo* newPacket(byte* pData, int nLen)
+{
+	LtPktInfo* pPkt = new LtPktInfo();
+	pPkt->init(true);
+	pPkt->setBlock((byte*)malloc(nLen));
+	memcpy(pPkt->getBlock(), pData, nLen);
+	pPkt->setMessageData(pPkt->getBlock(), nLen, pPkt);
+	return pPkt;
+}
+
+//
+// Build a peer's response and its segments, as an outbound LtIpSegReq
+// would send them.
+//
+static void buildPeer(Peer* pPeer, int index, unsigned int* pSeed)
+{
+	LtIpPktHeader hdr;
+	LtIpSegReq segReq;
+	LtIpSegment seg;
+	byte buf[UDP_MAX_PKT_LEN + 10];
+
+	pPeer->ipAddr = PEER_IP_BASE + index;
+	pPeer->port = PEER_PORT + index % 7;
+	pPeer->reqId = (word)rand_r(pSeed);
+	pPeer->nSize = LtIpSegment::MAX_PAYLOAD + rand_r(pSeed) % (LtIpSegment::MAX_PAYLOAD*(MAX_SEGS - 1));
+	pPeer->pPayload = (byte*)malloc(pPeer->nSize);
+	for (int i = 0; i < pPeer->nSize; i++)
+	{
+		pPeer->pPayload[i] = (byte)rand_r(pSeed);
+	}
+	hdr.packetSize = pPeer->nSize;
+	hdr.packetType = PKTTYPE_CHNMEMBERS;
+	hdr.build(pPeer->pPayload);
+
+	check(segReq.buildSegments(pPeer->pPayload, pPeer->nSize, pPeer->reqId), "buildSegments failed", index);
+	pPeer->nSegs = segReq.getNumSegments();
+	for (int i = 0; i < pPeer->nSegs; i++)
+	{
+		segReq.getSegment(i, seg);
+		seg.build(buf);
+		pPeer->nSegSize[i] = seg.packetSize;
+		pPeer->pSegs[i] = newPacket(buf, seg.packetSize);
+	}
+
+	// Segment zero first, then the rest shuffled, some twice
+	pPeer->nOrder = 0;
+	for (int i = 1; i < pPeer->nSegs; i++)
+	{
+		pPeer->order[pPeer->nOrder++] = i;
+		if ((int)(rand_r(pSeed) % 100) < DUP_PERCENT)
+		{
+			pPeer->order[pPeer->nOrder++] = i;
+		}
+	}
+	for (int i = pPeer->nOrder - 1; i > 0; i--)
+	{
+		int j = rand_r(pSeed) % (i + 1);
+		int t = pPeer->order[i];
+		pPeer->order[i] = pPeer->order[j];
+		pPeer->order[j] = t;
+	}
+	memmove(&pPeer->order[1], &pPeer->order[0], pPeer->nOrder*sizeof(int));
+	pPeer->order[0] = 0;
+	pPeer->nOrder++;
+
+	pPeer->nLost = -1;
+	if ((int)(rand_r(pSeed) % 100) < LOSS_PERCENT)
+	{
+		pPeer->nLost = 1 + rand_r(pSeed) % (pPeer->nSegs - 1);
+	}
+	pPeer->nNext = 0;
+	pPeer->nDelivered = 0;
+	pPeer->nAsked = 0;
+}
+
+static void freePeer(Peer* pPeer)
+{
+	for (int i = 0; i < pPeer->nSegs; i++)
+	{
+		pPeer->pSegs[i]->release();
+	}
+	free(pPeer->pPayload);
+}
+
+static LtPktInfo* held[HOLD];
+static int nHeld;
+static long nSegsSent;
+static long nBytes;
+
+static void deliver(StressSegmentor* pSeg, Peer* pPeer, int nSeg)
+{
+	LtPktInfo* pPkt = newPacket(pPeer->pSegs[nSeg]->getBlock(), pPeer->nSegSize[nSeg]);
+	LtPktInfo* pRtn = NULL;
+
+	nSegsSent++;
+	pSeg->receivedPacket(pPkt, &pRtn, pPeer->ipAddr, pPeer->port);
+	if (pRtn != NULL)
+	{
+		check(pRtn->getIpSrcAddr() == pPeer->ipAddr && pRtn->getIpSrcPort() == pPeer->port,
+			  "a response came from the wrong peer", (long)(pPeer - pPeers));
+		check(pRtn->getDataSize() == pPeer->nSize &&
+			  memcmp(pRtn->getDataPtr(), pPeer->pPayload, pPeer->nSize) == 0,
+			  "a response was reassembled wrong", (long)(pPeer - pPeers));
+		pPeer->nDelivered++;
+		nBytes += pPeer->nSize;
+
+		// Hold on to it for a while, as a slow link client would
+		if (nHeld == HOLD)
+		{
+			held[0]->release();
+			memmove(&held[0], &held[1], (HOLD - 1)*sizeof(LtPktInfo*));
+			nHeld--;
+		}
+		held[nHeld++] = pRtn;
+	}
+}
+
+static void releaseHeld()
+{
+	while (nHeld > 0)
+	{
+		held[--nHeld]->release();
+	}
+}
+
+static double runRound(int round, unsigned int* pSeed)
+{
+	// The segmentor hands its timer task its address as an int, as the
+	// 32 bit targets allow, so it must not be on the stack.
+	StressSegmentor* pSeg = new StressSegmentor();
+	StubLink* pLink = new StubLink();
+	int* active = new int[nPeers];
+	int nActive = nPeers;
+	int nLossy = 0;
+	ULONG tickNow;
+	double start;
+	double elapsed;
+
+	pSeg->setActive(true);
+	pSeg->setLink(pLink);
+	for (int i = 0; i < nPeers; i++)
+	{
+		buildPeer(&pPeers[i], i, pSeed);
+		active[i] = i;
+		nLossy += pPeers[i].nLost != -1;
+	}
+
+	// All the peers at once
+	start = nowSecs();
+	while (nActive > 0)
+	{
+		int a = rand_r(pSeed) % nActive;
+		Peer* pPeer = &pPeers[active[a]];
+		int nSeg = pPeer->order[pPeer->nNext++];
+
+		if (nSeg != pPeer->nLost)
+		{
+			deliver(pSeg, pPeer, nSeg);
+		}
+		if (pPeer->nNext == pPeer->nOrder)
+		{
+			active[a] = active[--nActive];
+		}
+	}
+	elapsed = nowSecs() - start;
+
+	check(pSeg->getRequestCount() == nPeers, "the segmentor lost track of a request", pSeg->getRequestCount());
+	for (int i = 0; i < nPeers; i++)
+	{
+		check(pPeers[i].nDelivered == (pPeers[i].nLost == -1 ? 1 : 0), "a response was not delivered once", i);
+	}
+
+	// The first timer pass asks the peers that lost a segment for it, as
+	// they have not been asked for anything yet.  The next pass asks no one,
+	// and the one after the retransmit time asks them again.
+	tickNow = tickGet();
+	pSeg->timeout(tickNow);
+	check(pLink->m_nSent == nLossy, "the first pass sent the wrong number of requests", pLink->m_nSent);
+	pSeg->timeout(tickNow);
+	check(pLink->m_nSent == nLossy, "requests were sent again before the retransmit time", pLink->m_nSent);
+	tickNow += msToTicksX(LtIpSegReq::TIMEOUT_RETRANS) + 2;
+	pSeg->timeout(tickNow);
+	check(pLink->m_nSent == 2*nLossy, "requests were not sent again after the retransmit time", pLink->m_nSent);
+
+	// The lost segments complete the responses
+	for (int i = 0; i < nPeers; i++)
+	{
+		Peer* pPeer = &pPeers[i];
+		if (pPeer->nLost != -1)
+		{
+			check(pPeer->nAsked == 2, "a peer was not asked for its lost segment", i);
+			deliver(pSeg, pPeer, pPeer->nLost);
+			check(pPeer->nDelivered == 1, "a retransmitted segment did not complete a response", i);
+		}
+	}
+	tickNow += msToTicksX(LtIpSegReq::TIMEOUT_RETRANS) + 2;
+	pSeg->timeout(tickNow);
+	check(pLink->m_nSent == 2*nLossy, "requests were sent for complete responses", pLink->m_nSent);
+
+	// Late duplicates are not delivered again
+	for (int i = 0; i < nPeers; i += 7)
+	{
+		deliver(pSeg, &pPeers[i], pPeers[i].nSegs - 1);
+		check(pPeers[i].nDelivered == 1, "a duplicate segment delivered a response again", i);
+	}
+
+	// Everything times out once quiet
+	tickNow += msToTicksX(LtIpSegReq::TIMEOUT_BUSY) + 2;
+	check(!pSeg->timeout(tickNow), "doTimeout() still has requests", pSeg->getRequestCount());
+	check(pSeg->getRequestCount() == 0, "requests did not time out", pSeg->getRequestCount());
+
+	printf("round %d: %d peers, %d lost a segment, %d retransmit requests\n", round, nPeers, nLossy, pLink->m_nSent);
+
+	// The segmentor goes first; held payloads must outlive it
+	delete pSeg;
+	delete pLink;
+	for (int i = 0; i < nPeers; i++)
+	{
+		freePeer(&pPeers[i]);
+	}
+	delete[] active;
+	return elapsed;
+}
+
+int main(int argc, char* argv[])
+{
+	int rounds = argc > 2 ? atoi(argv[2]) : ROUNDS;
+	unsigned int seed = 1;
+	double elapsed = 0;
+
+	nPeers = argc > 1 ? atoi(argv[1]) : PEERS;
+	if (nPeers < 1 || rounds < 1)
+	{
+		printf("FAIL: bad arguments\n");
+		return 1;
+	}
+	pPeers = new Peer[nPeers];
+	for (int r = 0; r < rounds; r++)
+	{
+		elapsed += runRound(r, &seed);
+		releaseHeld();
+	}
+	printf("%.0f segments/s, %.1f MB/s reassembled\n", nSegsSent/elapsed, nBytes/elapsed/1e6);
+	delete[] pPeers;
+
+	if (nFailures != 0)
+	{
+		printf("FAIL: %d checks failed\n", nFailures);
+		return 1;
+	}
+	printf("PASS\n");
+	return 0;
+}
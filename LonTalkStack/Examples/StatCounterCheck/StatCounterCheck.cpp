@@ -0,0 +1,263 @@
+/*
+ * StatCounterCheck.cpp
+ *
+ * Copyright © 2022 Dialog Semiconductor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in 
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * Description: Check of the 64 bit per-thread statistics counters.
+ *
+ *  LtStatCounters keeps one row of counters per thread, so a bump is a
+ *  plain add, and adds the rows up when read.  LtLinkStatsShadow keeps a
+ *  link's statistics in one and fills in the int fields of LtLinkStats
+ *  from it.  This program checks:
+ *
+ *  - threads   many threads bump the same counters at once, more of them
+ *  than there are rows, so some share the last row.  Every
+ *  bump must be counted.
+ *  - reuse     thousands of short lived threads bump a counter one after
+ *  another, handing their rows on as they exit.  Every bump
+ *  must be counted.
+ *  - base      set() and clear() change what get() reports but not the
+ *  total, and bumps after them still count.
+ *  - link      the int fields of the link statistics cap at 0x7FFFFFFF
+ *  rather than wrapping negative, the snapshot has the full
+ *  counts, and clearing the shadow statistics leaves the
+ *  others alone.
+ *
+ *  It also reports how fast the threads bump with rows of their own.
+ *
+ *  Usage: StatCounterCheck [threads [bumps per thread]]
+ *  Exits non-zero if any check fails.
+ */
+
+#include "LtStackInternal.h"
+#include "LtStatCounters.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#define THREADS			8
+#define BUMPS			10000000
+#define CROWD			(LT_STAT_MAX_THREADS + 16)
+#define CROWD_BUMPS		100000
+#define SHORT_THREADS	5000
+#define COUNTERS		5
+
+static int nFailures = 0;
+
+static void check(boolean bOk, const char* what, ULONGLONG n = 0)
+{
+	if (!bOk && nFailures++ < 20)
+	{
+		printf("FAIL: %s (%llu)\n", what, n);
+	}
+}
+
+static double nowSecs()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec/1e6;
+}
+
+struct Bumper
+{
+	pthread_t			tid;
+	LtStatCounters*		pCounters;
+	pthread_barrier_t*	pBarrier;
+	int					nBumps;
+};
+
+static void* bumpTask(void* pArg)
+{
+	Bumper* pBumper = (Bumper*)pArg;
+
+	if (pBumper->pBarrier != NULL)
+	{
+		// Wait for the others, so that all are alive and hold rows at once.
+		pthread_barrier_wait(pBumper->pBarrier);
+	}
+	for (int n = 0; n < pBumper->nBumps; n++)
+	{
+		pBumper->pCounters->bump(n % COUNTERS);
+	}
+	pBumper->pCounters->add(COUNTERS - 1, 3);
+	if (pBumper->pBarrier != NULL)
+	{
+		pthread_barrier_wait(pBumper->pBarrier);
+	}
+	return NULL;
+}
+
+//
+// Run nThreads bumpers at once and check the totals.  Returns the time.
+//
+static double runBumpers(LtStatCounters& counters, int nThreads, int nBumps)
+{
+	Bumper* pBumpers = new Bumper[nThreads];
+	pthread_barrier_t barrier;
+	ULONGLONG before[COUNTERS];
+
+	for (int i = 0; i < COUNTERS; i++)
+	{
+		before[i] = counters.get(i);
+	}
+	pthread_barrier_init(&barrier, NULL, nThreads);
+	double start = nowSecs();
+	for (int i = 0; i < nThreads; i++)
+	{
+		pBumpers[i].pCounters = &counters;
+		pBumpers[i].pBarrier = &barrier;
+		pBumpers[i].nBumps = nBumps;
+		pthread_create(&pBumpers[i].tid, NULL, bumpTask, &pBumpers[i]);
+	}
+	for (int i = 0; i < nThreads; i++)
+	{
+		pthread_join(pBumpers[i].tid, NULL);
+	}
+	double secs = nowSecs() - start;
+	pthread_barrier_destroy(&barrier);
+
+	for (int i = 0; i < COUNTERS; i++)
+	{
+		ULONGLONG expected = (ULONGLONG)nThreads * (nBumps / COUNTERS + (i < nBumps % COUNTERS ? 1 : 0));
+		if (i == COUNTERS - 1)
+		{
+			expected += (ULONGLONG)nThreads * 3;
+		}
+		check(counters.get(i) - before[i] == expected, "threads: bumps lost", i);
+	}
+	delete[] pBumpers;
+	return secs;
+}
+
+static void checkThreads(int nThreads, int nBumps)
+{
+	LtStatCounters counters(COUNTERS);
+
+	double secs = runBumpers(counters, 1, nBumps);
+	printf("1 thread: %.0f M bumps/s\n", nBumps / secs / 1e6);
+	secs = runBumpers(counters, nThreads, nBumps);
+	printf("%d threads: %.0f M bumps/s\n", nThreads, (double)nThreads * nBumps / secs / 1e6);
+	runBumpers(counters, CROWD, CROWD_BUMPS);
+}
+
+static void checkReuse()
+{
+	LtStatCounters counters(COUNTERS);
+	Bumper bumper;
+
+	bumper.pCounters = &counters;
+	bumper.pBarrier = NULL;
+	bumper.nBumps = 1;
+	for (int i = 0; i < SHORT_THREADS; i++)
+	{
+		pthread_create(&bumper.tid, NULL, bumpTask, &bumper);
+		pthread_join(bumper.tid, NULL);
+	}
+	check(counters.get(0) == SHORT_THREADS, "reuse: bumps lost", counters.get(0));
+	check(counters.get(COUNTERS - 1) == SHORT_THREADS * 3, "reuse: adds lost", counters.get(COUNTERS - 1));
+}
+
+static void checkBase()
+{
+	LtStatCounters counters(COUNTERS);
+
+	for (int i = 0; i < 10; i++)
+	{
+		counters.bump(1);
+	}
+	counters.set(1, 1000);
+	check(counters.get(1) == 1000 && counters.getTotal(1) == 10, "base: set", counters.get(1));
+	counters.bump(1);
+	check(counters.get(1) == 1001 && counters.getTotal(1) == 11, "base: bump after set", counters.get(1));
+	counters.clear();
+	check(counters.get(1) == 0 && counters.getTotal(1) == 11, "base: clear", counters.get(1));
+	counters.add(1, 5);
+	check(counters.get(1) == 5 && counters.get(0) == 0, "base: add after clear", counters.get(1));
+}
+
+static void checkLink()
+{
+	LtLinkStatsShadow stats;
+	LtLinkStatsSnapshot snap;
+	ULONGLONG big = 0;
+
+	// Take one count past the top of an int, and one short of it.
+	while (big <= 0x80000000ull)
+	{
+		stats.add(LT_LINK_STAT_RECEIVED_PACKETS, 0x40000000);
+		big += 0x40000000;
+	}
+	stats.add(LT_LINK_STAT_TRANSMISSION_ERRORS, 0x7FFFFFFE);
+	stats.bump(LT_LINK_STAT_COLLISIONS);
+	stats.update();
+	check(stats.m_nReceivedPackets == 0x7FFFFFFF, "link: count past an int did not cap", (unsigned)stats.m_nReceivedPackets);
+	check(stats.m_nTransmissionErrors == 0x7FFFFFFE && stats.m_nTransmissionErrorsShadow == 0x7FFFFFFE,
+		  "link: count short of the cap changed", (unsigned)stats.m_nTransmissionErrors);
+	check(stats.m_nCollisions == 1 && stats.m_nCollisionsShadow == 1, "link: collision not counted");
+	stats.snapshot(snap);
+	check(snap.m_values[LT_LINK_STAT_RECEIVED_PACKETS] == big && snap.m_shadow[LT_LINK_STAT_RECEIVED_PACKETS] == big,
+		  "link: snapshot is not full width", snap.m_values[LT_LINK_STAT_RECEIVED_PACKETS]);
+
+	// Clearing the shadow statistics leaves the others alone.
+	stats.clearShadowStats();
+	stats.bump(LT_LINK_STAT_COLLISIONS);
+	stats.update();
+	stats.snapshot(snap);
+	check(stats.m_nCollisions == 2 && stats.m_nCollisionsShadow == 1 &&
+		  snap.m_values[LT_LINK_STAT_COLLISIONS] == 2 && snap.m_shadow[LT_LINK_STAT_COLLISIONS] == 1,
+		  "link: shadow clear", snap.m_shadow[LT_LINK_STAT_COLLISIONS]);
+	check(snap.m_values[LT_LINK_STAT_RECEIVED_PACKETS] == big, "link: shadow clear lost a count");
+
+	// Clearing the counters clears both.
+	stats.clearCounters();
+	stats.update();
+	stats.snapshot(snap);
+	check(stats.m_nReceivedPackets == 0 && snap.m_values[LT_LINK_STAT_RECEIVED_PACKETS] == 0,
+		  "link: clear", snap.m_values[LT_LINK_STAT_RECEIVED_PACKETS]);
+}
+
+int main(int argc, char* argv[])
+{
+	int nThreads = argc > 1 ? atoi(argv[1]) : THREADS;
+	int nBumps = argc > 2 ? atoi(argv[2]) : BUMPS;
+
+	if (nThreads < 1 || nBumps < 1)
+	{
+		printf("FAIL: bad arguments\n");
+		return 1;
+	}
+	checkBase();
+	checkLink();
+	checkReuse();
+	checkThreads(nThreads, nBumps);
+
+	if (nFailures != 0)
+	{
+		printf("FAIL: %d checks failed\n", nFailures);
+		return 1;
+	}
+	printf("PASS\n");
+	return 0;
+}
@@ -0,0 +1,292 @@
+/*
+ * TaskLatencyCheck.cpp
+ *
+ * Copyright © 2022 Dialog Semiconductor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in 
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * Description: Task stack and wakeup latency check for the POSIX OSAL.
+ *
+ *  The POSIX OSAL applies the stack size, priority and CPU affinity tasks
+ *  are spawned with.  This program checks:
+ *
+ *  - stack     a task that asks for a VxWorks sized stack gets the
+ *  minimum, 128 KB unless set otherwise, and a task that asks
+ *  for more gets what it asked for.  Either can use a good
+ *  part of its stack.  A larger minimum set through
+ *  OsalSetTaskMinStackSize() is honored.
+ *  - latency   a task at the highest priority sleeps 1 ms at a time while
+ *  tasks at the lowest priority keep every CPU busy.  This is
+ *  run with the default scheduling policy, with nice values
+ *  and, where the process may use it, with SCHED_FIFO.  The
+ *  policy each task ends up with must be the one requested or,
+ *  if the process may not use it, the default.
+ *
+ *  It reports how late the sleeping task wakes under each policy.
+ *
+ *  Usage: TaskLatencyCheck [seconds per policy [load tasks]]
+ *  Exits non-zero if any check fails.
+ */
+
+#include "VxWorks.h"
+#include "taskLib.h"
+#include "Osal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+
+#define SECONDS			2
+#define MAX_LOADS		64
+#define SLEEP_NS		1000000		// 1 ms
+#define MAX_SAMPLES		20000
+#define STACK_ASKED		4096		// a VxWorks sized stack
+#define STACK_LARGE		(512*1024)	// more than the minimum
+#define DEFAULT_MIN		(128*1024)	// the OSAL's own minimum
+#define LARGE_MIN		(1024*1024)
+
+static int nFailures = 0;
+
+static void check(int bOk, const char* what, long n = 0)
+{
+	if (!bOk && nFailures++ < 20)
+	{
+		printf("FAIL: %s (%ld)\n", what, n);
+	}
+}
+
+static double nowSecs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec/1e9;
+}
+
+static volatile int nDone;
+
+static void getSchedInfo(OsalTaskSchedInfo* pInfo)
+{
+	memset(pInfo, 0, sizeof(*pInfo));
+	OsalGetTaskSchedInfo((OsalHandle)vxlGetThreadHandle(taskIdSelf()), pInfo);
+}
+
+//
+// Stack check.
+//
+static OsalTaskSchedInfo stackInfo;
+static volatile int stackSum;
+
+static int VXLCDECL stackTask(int nBytes, ...)
+{
+	volatile char* p = (volatile char*)alloca(nBytes);
+
+	getSchedInfo(&stackInfo);
+	for (int i = 0; i < nBytes; i += 256)
+	{
+		p[i] = (char)i;
+	}
+	stackSum = p[nBytes - 256];
+	__sync_fetch_and_add(&nDone, 1);
+	return 0;
+}
+
+static void runStackTask(int stackSize, int nBytes)
+{
+	nDone = 0;
+	taskSpawn("StackTask", 100, 0, stackSize, stackTask, nBytes, 0,0,0,0, 0,0,0,0,0);
+	while (nDone == 0)
+	{
+		usleep(1000);
+	}
+}
+
+static void checkStack()
+{
+	// The environment may set a minimum of its own.
+	if (getenv("OSAL_TASK_STACK_MIN") == NULL)
+	{
+		runStackTask(STACK_ASKED, DEFAULT_MIN / 2);
+		check(stackInfo.stackSize == DEFAULT_MIN, "a small stack was not raised to the minimum", stackInfo.stackSize);
+		printf("stack: asked for %d, got %d\n", STACK_ASKED, stackInfo.stackSize);
+	}
+
+	runStackTask(STACK_LARGE, STACK_LARGE / 2);
+	check(stackInfo.stackSize == STACK_LARGE, "a stack larger than the minimum was not applied", stackInfo.stackSize);
+	printf("stack: asked for %d, got %d\n", STACK_LARGE, stackInfo.stackSize);
+
+	// A larger minimum is honored, for tasks that need more than they ask for.
+	OsalSetTaskMinStackSize(LARGE_MIN);
+	runStackTask(STACK_ASKED, LARGE_MIN / 2);
+	check(stackInfo.stackSize == LARGE_MIN, "the stack minimum was not applied", stackInfo.stackSize);
+	OsalSetTaskMinStackSize(DEFAULT_MIN);
+}
+
+//
+// Latency check.
+//
+struct TaskInfo
+{
+	OsalTaskSchedInfo	sched;
+	int					nSamples;
+	double				late[MAX_SAMPLES];
+};
+
+static TaskInfo sleeper;
+static TaskInfo loads[MAX_LOADS];
+static volatile double startAt;
+static volatile double stopAt;
+
+//
+// Sleep until the run starts, so that under SCHED_FIFO the load doesn't
+// starve this thread before it has spawned every task.
+//
+static void waitForStart()
+{
+	double secs = startAt - nowSecs();
+
+	if (secs > 0)
+	{
+		usleep((useconds_t)(secs * 1e6));
+	}
+}
+
+static int VXLCDECL loadTask(int index, ...)
+{
+	volatile unsigned int n = 0;
+
+	getSchedInfo(&loads[index].sched);
+	waitForStart();
+	while (nowSecs() < stopAt)
+	{
+		for (int i = 0; i < 100000; i++)
+		{
+			n++;
+		}
+	}
+	__sync_fetch_and_add(&nDone, 1);
+	return 0;
+}
+
+static int VXLCDECL sleepTask(int arg, ...)
+{
+	struct timespec ts = { 0, SLEEP_NS };
+
+	getSchedInfo(&sleeper.sched);
+	sleeper.nSamples = 0;
+	waitForStart();
+	while (nowSecs() < stopAt && sleeper.nSamples < MAX_SAMPLES)
+	{
+		double start = nowSecs();
+		nanosleep(&ts, NULL);
+		sleeper.late[sleeper.nSamples++] = nowSecs() - start - SLEEP_NS/1e9;
+	}
+	__sync_fetch_and_add(&nDone, 1);
+	return 0;
+}
+
+static int compareLate(const void* p1, const void* p2)
+{
+	double d = *(const double*)p1 - *(const double*)p2;
+	return d < 0 ? -1 : d > 0 ? 1 : 0;
+}
+
+//
+// The policy a task must end up with: the one requested, or the default
+// if the process may not use it.
+//
+static void checkPolicy(const OsalTaskSchedInfo& info, OsalSchedPolicy policy, int value, int priority)
+{
+	check(info.priority == priority, "a task has the wrong priority", info.priority);
+	if (info.policy == policy)
+	{
+		check(policy == OSAL_SCHED_DEFAULT || info.schedValue == value, "a task has the wrong scheduling value", info.schedValue);
+	}
+	else
+	{
+		check(info.policy == OSAL_SCHED_DEFAULT, "a task has the wrong policy", info.policy);
+	}
+}
+
+static void runLatency(const char* name, OsalSchedPolicy policy, int highest, int lowest, int nLoads, int seconds)
+{
+	if (OsalSetTaskSchedPolicy(policy, highest, lowest) != OSALSTS_SUCCESS)
+	{
+		check(0, "the scheduling policy was refused", policy);
+		return;
+	}
+
+	nDone = 0;
+	startAt = nowSecs() + 0.2;
+	stopAt = startAt + seconds;
+	taskSpawn("SleepTask", 0, 0, 0, sleepTask, 0, 0,0,0,0, 0,0,0,0,0);
+	for (int i = 0; i < nLoads; i++)
+	{
+		taskSpawn("LoadTask", 255, 0, 0, loadTask, i, 0,0,0,0, 0,0,0,0,0);
+	}
+
+	// Under SCHED_FIFO the load may starve this thread until it stops.
+	while (nDone < nLoads + 1)
+	{
+		usleep(10000);
+	}
+
+	checkPolicy(sleeper.sched, policy, highest, 0);
+	for (int i = 0; i < nLoads; i++)
+	{
+		checkPolicy(loads[i].sched, policy, lowest, 255);
+	}
+	check(sleeper.nSamples > 0, "the sleeping task never woke");
+	if (sleeper.nSamples > 0)
+	{
+		int n = sleeper.nSamples;
+		qsort(sleeper.late, n, sizeof(double), compareLate);
+		printf("%-8s %s  %5d wakeups late by: median %7.1f us, 99%% %8.1f us, worst %8.1f us\n",
+			   name, sleeper.sched.policy == policy ? "applied" : "refused", n,
+			   sleeper.late[n / 2] * 1e6, sleeper.late[n * 99 / 100] * 1e6, sleeper.late[n - 1] * 1e6);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	int seconds = argc > 1 ? atoi(argv[1]) : SECONDS;
+	int nLoads = argc > 2 ? atoi(argv[2]) : (int)sysconf(_SC_NPROCESSORS_ONLN) * 2;
+
+	if (seconds < 1 || nLoads < 1 || nLoads > MAX_LOADS)
+	{
+		printf("FAIL: bad arguments\n");
+		return 1;
+	}
+	checkStack();
+	printf("%d load tasks\n", nLoads);
+	runLatency("default", OSAL_SCHED_DEFAULT, 0, 0, nLoads, seconds);
+	runLatency("nice", OSAL_SCHED_NICE, 0, 19, nLoads, seconds);
+	runLatency("fifo", OSAL_SCHED_FIFO, 50, 1, nLoads, seconds);
+	OsalSetTaskSchedPolicy(OSAL_SCHED_DEFAULT, 0, 0);
+
+	if (nFailures != 0)
+	{
+		printf("FAIL: %d checks failed\n", nFailures);
+		return 1;
+	}
+	printf("PASS\n");
+	return 0;
+}
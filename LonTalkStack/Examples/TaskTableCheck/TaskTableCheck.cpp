@@ -0,0 +1,257 @@
+/*
+ * TaskTableCheck.cpp
+ *
+ * Copyright © 2022 Dialog Semiconductor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in 
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * Description: Check of the VxLayer task table.
+ *
+ *  VxLayer keeps task blocks on a free list and indexes busy tasks by name.
+ *  This program spawns tasks in rounds, many more in all than the table
+ *  has ids, with several tasks sharing each name.  Each task waits until
+ *  it is told to exit.  In each round:
+ *
+ *  - every task must be busy, and taskNameToId() of each name must give the
+ *  first task spawned with that name that has not exited;
+ *  - the tasks are let go in the order they were spawned, and as each name
+ *  loses its first task, the lookup must move on to the next one;
+ *  - once all have exited, no name may be found.
+ *
+ *  It reports how fast tasks are spawned and looked up.
+ *
+ *  Usage: TaskTableCheck [rounds [tasks per round [names]]]
+ *  Exits non-zero if any check fails.
+ */
+
+#include "VxWorks.h"
+#include "taskLib.h"
+#include "tickLib.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <semaphore.h>
+#include <sys/time.h>
+
+#define ROUNDS			24
+#define TASKS			500
+#define NAMES			100
+#define MAX_TASKS		2000
+#define LOOKUPS			200000
+#define TASK_PRIORITY	100
+#define TASK_STACK		16384
+#define EXIT_TIMEOUT	10.0		// seconds to wait for a task to exit
+
+struct Task
+{
+	int			tid;
+	sem_t		semGo;
+	volatile int bStarted;
+};
+
+static Task tasks[MAX_TASKS];
+static int nFailures = 0;
+
+static void check(int bOk, const char* what, int n = 0)
+{
+	if (!bOk && nFailures++ < 20)
+	{
+		printf("FAIL: %s (%d)\n", what, n);
+	}
+}
+
+static double nowSecs()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec/1e6;
+}
+
+static void makeName(char* name, int round, int index, int nNames)
+{
+	sprintf(name, "TtCheck%d.%d", round, index % nNames);
+}
+
+static int VXLCDECL waitTask(int arg, ...)
+{
+	Task* pTask = &tasks[arg];
+
+	pTask->bStarted = 1;
+	while (sem_wait(&pTask->semGo) != 0)
+	{
+	}
+	return 0;
+}
+
+//
+// Wait for a task to exit.  Its block is not reused meanwhile, since
+// nothing else is being spawned.
+//
+static int waitForExit(int tid)
+{
+	double deadline = nowSecs() + EXIT_TIMEOUT;
+
+	while (taskIdVerify(tid) == OK)
+	{
+		if (nowSecs() > deadline)
+		{
+			return 0;
+		}
+		usleep(100);
+	}
+	return 1;
+}
+
+//
+// The first task not yet let go that has the name of task "index".
+//
+static int firstWithName(int index, int nFirstLive, int nNames)
+{
+	int first = nFirstLive;
+
+	while (first % nNames != index % nNames)
+	{
+		first++;
+	}
+	return first;
+}
+
+static void checkLookups(int round, int nFirstLive, int nTasks, int nNames)
+{
+	char name[64];
+
+	for (int i = 0; i < nNames && i < nTasks; i++)
+	{
+		makeName(name, round, i, nNames);
+		int first = firstWithName(i, nFirstLive, nNames);
+		int tid = taskNameToId(name);
+		if (first < nTasks)
+		{
+			check(tid == tasks[first].tid, "the lookup did not give the first task with the name", first);
+		}
+		else
+		{
+			check(tid == ERROR, "the lookup found a task that has exited", i);
+		}
+	}
+}
+
+static double nSpawnSecs = 0;
+static int nSpawned = 0;
+
+static void runRound(int round, int nTasks, int nNames)
+{
+	char name[64];
+
+	double start = nowSecs();
+	for (int i = 0; i < nTasks; i++)
+	{
+		makeName(name, round, i, nNames);
+		sem_init(&tasks[i].semGo, 0, 0);
+		tasks[i].bStarted = 0;
+		tasks[i].tid = taskSpawn(name, TASK_PRIORITY, 0, TASK_STACK, waitTask, i, 0,0,0,0, 0,0,0,0,0);
+		check(tasks[i].tid != ERROR && tasks[i].tid != 0, "spawn failed", nSpawned + i);
+	}
+	nSpawnSecs += nowSecs() - start;
+	nSpawned += nTasks;
+
+	for (int i = 0; i < nTasks; i++)
+	{
+		check(taskIdVerify(tasks[i].tid) == OK, "a spawned task is not busy", i);
+	}
+	checkLookups(round, 0, nTasks, nNames);
+
+	// Let the tasks go in the order they were spawned, checking the
+	// lookups each time a name loses its first task.
+	for (int i = 0; i < nTasks; i++)
+	{
+		sem_post(&tasks[i].semGo);
+		check(waitForExit(tasks[i].tid), "a task did not exit", i);
+		if (i % 7 == 0 || i >= nTasks - nNames)
+		{
+			checkLookups(round, i + 1, nTasks, nNames);
+		}
+	}
+	for (int i = 0; i < nTasks; i++)
+	{
+		sem_destroy(&tasks[i].semGo);
+	}
+}
+
+//
+// Time lookups against a full table.
+//
+static void timeLookups(int nTasks, int nNames)
+{
+	char names[NAMES][64];
+	int nFound = 0;
+
+	for (int i = 0; i < nTasks; i++)
+	{
+		makeName(names[i % NAMES], -1, i, nNames);
+		sem_init(&tasks[i].semGo, 0, 0);
+		tasks[i].tid = taskSpawn(names[i % NAMES], TASK_PRIORITY, 0, TASK_STACK, waitTask, i, 0,0,0,0, 0,0,0,0,0);
+	}
+	double start = nowSecs();
+	for (int n = 0; n < LOOKUPS; n++)
+	{
+		if (taskNameToId(names[n % nNames % NAMES]) != ERROR)
+		{
+			nFound++;
+		}
+	}
+	double secs = nowSecs() - start;
+	check(nFound == LOOKUPS, "a lookup in the full table failed", nFound);
+	for (int i = 0; i < nTasks; i++)
+	{
+		sem_post(&tasks[i].semGo);
+		waitForExit(tasks[i].tid);
+		sem_destroy(&tasks[i].semGo);
+	}
+	printf("%d lookups among %d tasks: %.0f lookups/s\n", LOOKUPS, nTasks, LOOKUPS / secs);
+}
+
+int main(int argc, char* argv[])
+{
+	int nRounds = argc > 1 ? atoi(argv[1]) : ROUNDS;
+	int nTasks = argc > 2 ? atoi(argv[2]) : TASKS;
+	int nNames = argc > 3 ? atoi(argv[3]) : NAMES;
+
+	if (nRounds < 1 || nTasks < 1 || nTasks > MAX_TASKS || nNames < 1 || nNames > NAMES)
+	{
+		printf("FAIL: bad arguments\n");
+		return 1;
+	}
+	for (int round = 0; round < nRounds && nFailures == 0; round++)
+	{
+		runRound(round, nTasks, nNames);
+	}
+	printf("%d tasks spawned in %d rounds: %.0f spawns/s\n", nSpawned, nRounds, nSpawned / nSpawnSecs);
+	timeLookups(nTasks, nNames);
+
+	if (nFailures != 0)
+	{
+		printf("FAIL: %d checks failed\n", nFailures);
+		return 1;
+	}
+	printf("PASS\n");
+	return 0;
+}
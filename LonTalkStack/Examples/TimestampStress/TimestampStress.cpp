@@ -0,0 +1,167 @@
+/*
+ * TimestampStress.cpp
+ *
+ * Copyright © 2022 Dialog Semiconductor
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in 
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is furnished to do
+ * so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ * 
+ * Description: LtIpPktHeader::getTimestamp() monotonicity stress test.
+ *
+ *  Several threads call getTimestamp() in a tight loop, the way the
+ *  receive, send, aggregation and segmentation tasks do.  Each result is
+ *  checked against the latest timestamp any thread had returned before the
+ *  call started.  No timestamp may be less than that.
+ *
+ *  Each round first clears the clock base, as if getTimestamp() had never
+ *  been called, and releases all threads at once.  Only one thread reads
+ *  the clock.  The first timestamp every other thread gets must still be
+ *  the wall clock time, not an offset from an empty base.
+ *
+ *  Usage: TimestampStress [threads] [rounds] [ms per round]
+ *  Exits non-zero on the first timestamp out of order.
+ */
+
+#include "LtStackInternal.h"
+#include "LtIpPackets.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sys/time.h>
+
+#define MAX_THREADS		32
+
+static volatile ULONG	latest;			// latest timestamp returned to any thread
+static volatile int		nFailures;
+static volatile boolean	bStop;
+static pthread_barrier_t	start;
+
+struct StressThread
+{
+	pthread_t	tid;
+	ULONGLONG	nCalls;
+};
+
+static ULONG wallClockMs()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return (ULONG)((ULONGLONG)tv.tv_sec*1000 + tv.tv_usec/1000);
+}
+
+static void failed(const char* pWhat, ULONG nWant, ULONG nGot)
+{
+	if (__sync_fetch_and_add(&nFailures, 1) < 10)
+	{
+		printf("FAIL - %s: expected at least %lu, got %lu\n", pWhat,
+			   (unsigned long)nWant, (unsigned long)nGot);
+	}
+}
+
+static void* stressTask(void* pArg)
+{
+	StressThread*	pThread = (StressThread*)pArg;
+
+	while (true)
+	{
+		pthread_barrier_wait(&start);
+		if (bStop)
+		{
+			break;
+		}
+
+		ULONG	nWall = wallClockMs();
+		ULONG	nFirst = LtIpPktHeader::getTimestamp(false);
+		// Allow for the wall clock being read a little earlier by another
+		// thread, and for the tick rounding.
+		if ((LONG)(nFirst - nWall) < -100)
+		{
+			failed("first timestamp after a clock reset", nWall, nFirst);
+		}
+
+		while (!bStop)
+		{
+			ULONG	nBefore = latest;
+			ULONG	nMs = LtIpPktHeader::getTimestamp(false);
+			if ((LONG)(nMs - nBefore) < 0)
+			{
+				failed("timestamp went backwards", nBefore, nMs);
+			}
+			// Publish it as the latest, unless another thread got further.
+			ULONG	nLatest;
+			do
+			{
+				nLatest = latest;
+			} while ((LONG)(nMs - nLatest) > 0 &&
+					 !__sync_bool_compare_and_swap(&latest, nLatest, nMs));
+			pThread->nCalls++;
+		}
+		pthread_barrier_wait(&start);
+	}
+	return NULL;
+}
+
+int main(int argc, char* argv[])
+{
+	int		nThreads = argc > 1 ? atoi(argv[1]) : 8;
+	int		nRounds = argc > 2 ? atoi(argv[2]) : 20;
+	int		nRoundMs = argc > 3 ? atoi(argv[3]) : 500;
+	StressThread	threads[MAX_THREADS];
+	ULONGLONG		nCalls = 0;
+
+	if (nThreads < 1 || nThreads > MAX_THREADS)
+	{
+		printf("threads must be 1 to %d\n", MAX_THREADS);
+		return 2;
+	}
+	pthread_barrier_init(&start, NULL, nThreads + 1);
+	for (int i = 0; i < nThreads; i++)
+	{
+		threads[i].nCalls = 0;
+		pthread_create(&threads[i].tid, NULL, stressTask, &threads[i]);
+	}
+
+	for (int round = 0; round < nRounds; round++)
+	{
+		// Back to no clock base at all.  All threads are parked.
+		LtIpPktHeader::clkSeq = 0;
+		LtIpPktHeader::tClkTime = 0;
+		LtIpPktHeader::nLastTick = 0;
+		LtIpPktHeader::clkHighMs = 0;
+		latest = 0;
+
+		pthread_barrier_wait(&start);
+		taskDelay(msToTicks(nRoundMs));
+		bStop = true;
+		pthread_barrier_wait(&start);
+		bStop = false;
+	}
+	bStop = true;
+	pthread_barrier_wait(&start);
+	for (int i = 0; i < nThreads; i++)
+	{
+		pthread_join(threads[i].tid, NULL);
+		nCalls += threads[i].nCalls;
+	}
+
+	printf("%d threads, %d rounds: %llu timestamps, %d out of order\n",
+		   nThreads, nRounds, nCalls, nFailures);
+	printf("%s\n", nFailures == 0 ? "PASS" : "FAIL");
+	return nFailures == 0 ? 0 : 1;
+}
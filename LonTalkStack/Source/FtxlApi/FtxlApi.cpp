@@ -53,15 +53,12 @@
  *                           Data Declarations                                *
  *===========================================================================*/
 
-FtxlStack *pMyStack = NULL;
+// The stack used by the handle-less API.  Additional stacks are created
+// with LonCtxCreateHandle.
+static LonStackContext theDefaultStack;
 
-LtLogicalChannel *pChannel = NULL;
-boolean stackStarted = false;
 boolean printTimeStamp = true;
 FILE *fpTracefile = NULL;
-#if PRODUCT_IS(IZOT)
-LtUri myDeviceUri;
-#endif
 
 
 /*=============================================================================
@@ -93,33 +90,33 @@ void APIDebug(const char * fmt, ...)
     }
 }
 
-inline LonApiError checkCreated()
+inline LonApiError checkCreated(LonStackHandle hStack)
 {
-	return pMyStack == NULL ? LonApiNotInitialized : LonApiNoError;
+	return hStack == NULL || hStack->pStack == NULL ? LonApiNotInitialized : LonApiNoError;
 }
 
-inline LonApiError checkStarting()
+inline LonApiError checkStarting(LonStackHandle hStack)
 {
-	if (pMyStack == NULL)
+	if (hStack == NULL || hStack->pStack == NULL)
         return LonApiNotInitialized;
-    else if (stackStarted)
+    else if (hStack->stackStarted)
         return LonApiNotAllowed;
     else
         return LonApiNoError;
 }
 
-inline LonApiError checkInit() 
+inline LonApiError checkInit(LonStackHandle hStack) 
 {	
-	return pMyStack == NULL || !stackStarted ? LonApiNotInitialized : LonApiNoError;
+	return hStack == NULL || hStack->pStack == NULL || !hStack->stackStarted ? LonApiNotInitialized : LonApiNoError;
 }
 
-void deleteStack()
+void deleteStack(LonStackHandle hStack)
 {
-    delete pMyStack;
-	pMyStack = NULL;
-    delete pChannel;
-    pChannel = NULL;
-	stackStarted = false;
+    delete hStack->pStack;
+	hStack->pStack = NULL;
+    delete hStack->pChannel;
+    hStack->pChannel = NULL;
+	hStack->stackStarted = false;
 }
 
 inline static LonApiError LonSts(LtErrorType ltSts)
@@ -128,12 +125,12 @@ inline static LonApiError LonSts(LtErrorType ltSts)
     return sts;
 }
 
-static LonApiError checkInitOnline(void)
+static LonApiError checkInitOnline(LonStackHandle hStack)
 {
-	LonApiError sts = checkInit();
+	LonApiError sts = checkInit(hStack);
 	if (LON_SUCCESS(sts))
 	{
-        if (!pMyStack->isConfiguredAndOnline())
+        if (!hStack->pStack->isConfiguredAndOnline())
         {
             sts = LonApiOffline;
         }
@@ -141,6 +138,89 @@ static LonApiError checkInitOnline(void)
     return sts;
 }
 
+/*=============================================================================
+ *                            HANDLE FUNCTIONS                                *
+ *===========================================================================*/
+
+/*
+ * Function: LonCtxCreateHandle
+ * Allocates a stack handle for use with the LonCtx* functions.
+ *
+ * Parameters:
+ * phStack - pointer to receive the new handle
+ * pCallbacks - optional per-stack callbacks (may be NULL)
+ *
+ * Returns:
+ * <LonApiError>.
+ *
+ * Each handle owns its own channel and stack object, so several devices
+ * can be hosted in one process.  The handle is then passed to
+ * LonCtxLidCreateStack and the rest of the LonCtx* functions, which
+ * otherwise behave like their handle-less counterparts.  Callbacks that are
+ * not supplied in pCallbacks fall back to the global callback vectors.
+ */
+FTXL_EXTERNAL_FN const LonApiError LonCtxCreateHandle(LonStackHandle* phStack,
+                                                      const LonCtxCallbacks* const pCallbacks)
+{
+    LonApiError sts = LonApiNoError;
+
+    if (phStack == NULL)
+    {
+        sts = LonApiInitializationFailure;
+    }
+    else
+    {
+        *phStack = new LonStackContext;
+        if (pCallbacks != NULL)
+        {
+            (*phStack)->callbacks = *pCallbacks;
+        }
+    }
+    APIDebug("LonCtxCreateHandle = %d\n", sts);
+    return sts;
+}
+
+/*
+ * Function: GetStackCallbacks
+ * Gets the callbacks of a handle, for the NVD callback dispatchers, which
+ * don't see <LonStackContext>.
+ */
+const LonCtxCallbacks* GetStackCallbacks(LonStackHandle hStack)
+{
+    return hStack != NULL ? &hStack->callbacks : NULL;
+}
+
+/*
+ * Function: LonCtxFreeHandle
+ * Destroys the stack owned by a handle, if any, and frees the handle.
+ *
+ * Parameters:
+ * hStack - handle obtained from <LonCtxCreateHandle>
+ *
+ * Returns:
+ * <LonApiError>.
+ */
+FTXL_EXTERNAL_FN const LonApiError LonCtxFreeHandle(LonStackHandle hStack)
+{
+    LonApiError sts = LonApiNoError;
+
+    if (hStack == NULL || hStack == &theDefaultStack)
+    {
+        sts = LonApiNotAllowed;
+    }
+    else
+    {
+        LonCtxLidDestroyStack(hStack);
+        if (hStack->nvdMutex != NULL)
+        {
+            semDelete(hStack->nvdMutex);
+        }
+        delete hStack;
+    }
+    APIDebug("LonCtxFreeHandle = %d\n", sts);
+    return sts;
+}
+
 /*=============================================================================
  *                              LID FUNCTIONS                                 *
  *===========================================================================*/
@@ -179,8 +259,9 @@ static LonApiError checkInitOnline(void)
  *
  */
 FTXL_EXTERNAL_FN const LonApiError 
-    LonLidCreateStack(const LonStackInterfaceData* const pInterface,
-                      const LonControlData       * const pControlData)
+    LonCtxLidCreateStack(LonStackHandle hStack,
+                         const LonStackInterfaceData* const pInterface,
+                         const LonControlData       * const pControlData)
 {
     LonApiError sts = LonApiNoError;
     char szFsPath[MAX_PATH];
@@ -223,7 +304,11 @@ FTXL_EXTERNAL_FN const LonApiError
     APIDebug("TransmitTransCount: %d\n", pControlData->TransmitTransCount);    
     APIDebug("TransmitTransIdLifetime: %d\n", pControlData->TransmitTransIdLifetime);    
 
-    if (pChannel != NULL)
+    if (hStack == NULL)
+    {
+        sts = LonApiNotInitialized;
+    }
+    else if (hStack->pChannel != NULL)
     {
         sts = LonApiNotAllowed;
     }
@@ -232,7 +317,7 @@ FTXL_EXTERNAL_FN const LonApiError
         vxlReportEvent("createStack called\n");
 		LontalkStackUriScheme chnlType;
 #if PRODUCT_IS(IZOT)
-		chnlType = myDeviceUri.getScheme();
+		chnlType = hStack->deviceUri.getScheme();
 #elif FEATURE_INCLUDED(IP852)
 		chnlType = IPUnicast;
 #else 
@@ -247,9 +332,9 @@ FTXL_EXTERNAL_FN const LonApiError
 			int ipPort;
 			int mcastAddress = 0;
 #if PRODUCT_IS(IZOT) 
-			ipAddress       = myDeviceUri.getIPAddress();
-			ipPort          = myDeviceUri.getPort();
-			mcastAddress    = myDeviceUri.getMulticastIPAddress();
+			ipAddress       = hStack->deviceUri.getIPAddress();
+			ipPort          = hStack->deviceUri.getPort();
+			mcastAddress    = hStack->deviceUri.getMulticastIPAddress();
 #else
 			// Needs to support the LTS that compatible with LID example
 			// The LonGetMyIpAddress is implemented in the user's app
@@ -259,11 +344,11 @@ FTXL_EXTERNAL_FN const LonApiError
 			//if (ipAddress == 0)
 			//    sts = LonApiNoIpAddress;
 			//else
-			pChannel = new LtIpLogicalChannel(0, ipAddress, ipPort, null, null, mcastAddress);
-			if ((ipAddress == 0) && (pChannel != NULL))
+			hStack->pChannel = new LtIpLogicalChannel(0, ipAddress, ipPort, null, null, mcastAddress);
+			if ((ipAddress == 0) && (hStack->pChannel != NULL))
 			{
 				// Trace the local IP address 
-				APIDebug("Local IP Address: %d \n", ((LtIpLogicalChannel *)pChannel)->getLocalIpAddress());
+				APIDebug("Local IP Address: %d \n", ((LtIpLogicalChannel *)hStack->pChannel)->getLocalIpAddress());
 			}
 		}
 #endif
@@ -274,7 +359,7 @@ FTXL_EXTERNAL_FN const LonApiError
 			const char *niName;
 
 #if PRODUCT_IS(IZOT) 
-			niName = myDeviceUri.getNiName();
+			niName = hStack->deviceUri.getNiName();
 #else
 			// Needs to support the LTS that compatible with LID example
 			// The LonGetMyIpAddress is implemented in the user's app
@@ -291,12 +376,12 @@ FTXL_EXTERNAL_FN const LonApiError
 				{
 #if PRODUCT_IS(IZOT) 
 					char szIpIfName[256];
-                    const char *ipIfName = myDeviceUri.getIPInterfaceName();
-                    int port = myDeviceUri.getPort();
+                    const char *ipIfName = hStack->deviceUri.getIPInterfaceName();
+                    int port = hStack->deviceUri.getPort();
 
                     // Get the IP management option from device URI. 
                     // The default is to enable the option to set the IP Address (LONLINK_IZOT_MGMNT_OPTION_SET_IP_ADDR)
-					int ipManagementOptions = myDeviceUri.getIPManagementOption();
+					int ipManagementOptions = hStack->deviceUri.getIPManagementOption();
 					if (ipIfName != NULL)
 					{
 						strcpy(szIpIfName, ipIfName);
@@ -316,10 +401,10 @@ FTXL_EXTERNAL_FN const LonApiError
 #ifndef WIN32
 					if (!strncmp(szIpIfName, "lon", 3))
 					    // Using a raw socket to connect to LT channel
-					    pChannel = new LtLtLogicalChannel(szIpIfName, ipManagementOptions);
+					    hStack->pChannel = new LtLtLogicalChannel(szIpIfName, ipManagementOptions);
 					else
 #endif
-					    pChannel = new LtLtLogicalChannel(niName, (ipIfName != NULL) ? szIpIfName : NULL,
+					    hStack->pChannel = new LtLtLogicalChannel(niName, (ipIfName != NULL) ? szIpIfName : NULL,
 					                                ipManagementOptions);
 #else
                     // Device type is not supported in this product
@@ -336,7 +421,7 @@ FTXL_EXTERNAL_FN const LonApiError
 					int numChannelPackets = 2*receiveQueueDepth;
 					int transmitQueueDepth = pControlData->Buffers.ApplicationBuffers.NonPriorityMsgOutCount +
                                  pControlData->Buffers.ApplicationBuffers.PriorityMsgOutCount;
-					pChannel = new LtLtLogicalChannel(niName, numChannelPackets, 
+					hStack->pChannel = new LtLtLogicalChannel(niName, numChannelPackets, 
                                         receiveQueueDepth, transmitQueueDepth);
 				}
 			}
@@ -345,10 +430,10 @@ FTXL_EXTERNAL_FN const LonApiError
         if (sts == LonApiNoError)
         {
             vxlReportEvent("Channel created\n");
-            sts = LonSts(pChannel->getStartError());
+            sts = LonSts(hStack->pChannel->getStartError());
     #if FEATURE_INCLUDED(LONLINK)
             if (chnlType > IPMulticast)  // IP852 Multicast/Unicast channel doesn't use LonLink
-            	if (sts == LonApiNoError && !((LtLtLogicalChannel *)pChannel)->getLonLink()->isOpen())
+            	if (sts == LonApiNoError && !((LtLtLogicalChannel *)hStack->pChannel)->getLonLink()->isOpen())
             	{
             		sts = LonApiInitializationFailure;
             	}
@@ -361,7 +446,20 @@ FTXL_EXTERNAL_FN const LonApiError
 #if FEATURE_INCLUDED(IP852) || !FEATURE_INCLUDED(LONLINK)
             // If the app has registered a valid uniqueID, LTS will use the app's specified uniqueID.
             // Otherwise it uses the uniqueID saved in NVD folder or generates a random one if no unique Id
-            sts = LonGetUniqueId(&uid);
+            if (hStack == &theDefaultStack)
+            {
+                sts = LonGetUniqueId(&uid);
+            }
+            else
+            {
+                // Additional stacks don't share the persistent unique ID; use
+                // the one registered for this handle, or a random one.
+                if (!hStack->uniqueId.isSet())
+                {
+                    LtPlatform::generateUniqueId(&hStack->uniqueId);
+                }
+                memcpy(uid, hStack->uniqueId.getData(), sizeof(LonUniqueId));
+            }
 #else
             // Since the IzoT API only supports one stack, use the unique ID 
             // of the underlying interface - layer 2 mips don't use their
@@ -369,18 +467,32 @@ FTXL_EXTERNAL_FN const LonApiError
             // one interface, you will need to obtain and register a unique ID
             // for each stack.
             LtUniqueId deviceId;
-            ((LtLtLogicalChannel *)pChannel)->getLonLink()->getUniqueId(deviceId);
+            ((LtLtLogicalChannel *)hStack->pChannel)->getLonLink()->getUniqueId(deviceId);
             memcpy(uid, deviceId.getData(), sizeof(LonUniqueId));
 #endif
-            sts = LonRegisterUniqueId((LonUniqueId *)&uid);   
+            if (hStack == &theDefaultStack)
+            {
+                sts = LonRegisterUniqueId((LonUniqueId *)&uid);   
+            }
+            else
+            {
+                hStack->uniqueId.set((const byte *)uid);
+            }
         }
 
         if (sts == LonApiNoError)
         {
-            pMyStack = new FtxlStack(pChannel, pControlData);
+            hStack->pStack = new FtxlStack(hStack->pChannel, pControlData, hStack);
             vxlReportEvent("Stack created\n");
-            LonGetNvdFsPath(szFsPath, sizeof(szFsPath));
-            sts = pMyStack->createStack(pInterface, pControlData, (const char *)&szFsPath);
+            if (hStack->szNvdFsPath[0] != '\0')
+            {
+                strcpy(szFsPath, hStack->szNvdFsPath);
+            }
+            else
+            {
+                LonGetNvdFsPath(szFsPath, sizeof(szFsPath));
+            }
+            sts = hStack->pStack->createStack(pInterface, pControlData, (const char *)&szFsPath);
         }
         else
         {
@@ -389,13 +501,20 @@ FTXL_EXTERNAL_FN const LonApiError
 
         if (!LON_SUCCESS(sts))
         {
-            deleteStack();
+            deleteStack(hStack);
         }
     }
     APIDebug("End LonLidCreateStack = %d\n", sts);
     return sts;
 }
 
+FTXL_EXTERNAL_FN const LonApiError 
+    LonLidCreateStack(const LonStackInterfaceData* const pInterface,
+                      const LonControlData       * const pControlData)
+{
+    return LonCtxLidCreateStack(&theDefaultStack, pInterface, pControlData);
+}
+
 
 #if PRODUCT_IS(IZOT)
 #if FEATURE_INCLUDED(IP852)
@@ -413,10 +532,10 @@ FTXL_EXTERNAL_FN void LonGetMyIpAddress(int *pAddress, int *pPort)
 {
     *pAddress = 0;
     *pPort = 0;
-    if (pChannel != NULL)
+    if (theDefaultStack.pChannel != NULL)
     {
-        *pAddress = ((LtIpLogicalChannel *)pChannel)->getIpAddress();
-        *pPort = ((LtIpLogicalChannel *)pChannel)->getIpPort();
+        *pAddress = ((LtIpLogicalChannel *)theDefaultStack.pChannel)->getIpAddress();
+        *pPort = ((LtIpLogicalChannel *)theDefaultStack.pChannel)->getIpPort();
         APIDebug("LonGetMyIpAddress = %d - %d\n", *pAddress, *pPort);
     }
     else
@@ -436,7 +555,7 @@ FTXL_EXTERNAL_FN void LonGetMyIpAddress(int *pAddress, int *pPort)
  */
 FTXL_EXTERNAL_FN const char *LonGetMyNetworkInterface(void)
 {
-    return pChannel->getName();
+    return theDefaultStack.pChannel->getName();
 }
 #endif
 #endif
@@ -496,11 +615,11 @@ FTXL_EXTERNAL_FN const LonApiError LonGenerateUniqueId(LonUniqueId* pDeviceID)
  *  and before <LonLidStartStack>.
  *
  */
-const LonApiError LonLidRegisterStaticNv(const LonNvDefinition* const pNvDef)
+const LonApiError LonCtxLidRegisterStaticNv(LonStackHandle hStack, const LonNvDefinition* const pNvDef)
 {
     APIDebug("Start LonLidRegisterStaticNv\n");
 
-    LonApiError sts = checkStarting();
+    LonApiError sts = checkStarting(hStack);
 
     if (sts == LonApiNoError)
     {
@@ -556,12 +675,17 @@ const LonApiError LonLidRegisterStaticNv(const LonNvDefinition* const pNvDef)
                                   pNvDef->MeanRate == LON_NV_RATE_UNKNOWN ? NO_RATE_ESTIMATE : pNvDef->MeanRate,
                                   pNvDef->MaxRate == LON_NV_RATE_UNKNOWN ? NO_RATE_ESTIMATE : pNvDef->MaxRate);
 
-        sts = LonSts(pMyStack->registerNetworkVariable(pNv));
+        sts = LonSts(hStack->pStack->registerNetworkVariable(pNv));
     }
     APIDebug("End LonLidRegisterStaticNv = %d\n", sts);
     return sts;
 }
 
+const LonApiError LonLidRegisterStaticNv(const LonNvDefinition* const pNvDef)
+{
+    return LonCtxLidRegisterStaticNv(&theDefaultStack, pNvDef);
+}
+
 /*
  * Function: LonLidRegisterMemoryWindow
  * Register memory addresses to be mapped to LID managed memory.
@@ -585,19 +709,25 @@ const LonApiError LonLidRegisterStaticNv(const LonNvDefinition* const pNvDef)
  * and 0xffff. 
  *
  */
-const LonApiError LonLidRegisterMemoryWindow(const unsigned int windowAddress, 
+const LonApiError LonCtxLidRegisterMemoryWindow(LonStackHandle hStack, const unsigned int windowAddress, 
 									         const unsigned int windowSize)
 {
     APIDebug("Start LonLidRegisterMemoryWindow\n");
-	LonApiError sts = checkStarting();
+	LonApiError sts = checkStarting(hStack);
 	if (LON_SUCCESS(sts))
 	{
-		pMyStack->registerMemory(windowAddress, windowSize);
+		hStack->pStack->registerMemory(windowAddress, windowSize);
 	}
     APIDebug("End LonLidRegisterMemoryWindow = %d\n", sts);
 	return sts;
 }
 
+const LonApiError LonLidRegisterMemoryWindow(const unsigned int windowAddress, 
+									         const unsigned int windowSize)
+{
+    return LonCtxLidRegisterMemoryWindow(&theDefaultStack, windowAddress, windowSize);
+}
+
 /*
  * Function: LonLidStartStack
  * Completes the initialization of the stack.  
@@ -610,18 +740,18 @@ const LonApiError LonLidRegisterMemoryWindow(const unsigned int windowAddress,
  * LonLidRegisterMemoryWindow() after calling this function.  
  *
  */
-const LonApiError LonLidStartStack(void)
+const LonApiError LonCtxLidStartStack(LonStackHandle hStack)
 {
     APIDebug("Start LonLidStartStack\n");
-    LonApiError sts = checkStarting();;
+    LonApiError sts = checkStarting(hStack);;
 	if (sts == LonApiNoError)
 	{
 		vxlReportEvent("startStack called\n");
-		sts = pMyStack->startStack();
+		sts = hStack->pStack->startStack();
         if (LON_SUCCESS(sts))
         {
 		    vxlReportEvent("stack initialized successfully\n");
-            stackStarted = true;
+            hStack->stackStarted = true;
         }
         else
         {
@@ -632,6 +762,11 @@ const LonApiError LonLidStartStack(void)
     return sts;
 }
 
+const LonApiError LonLidStartStack(void)
+{
+    return LonCtxLidStartStack(&theDefaultStack);
+}
+
 /*
  * Function: LonLidDestroyStack 
  * Stops the IzoT stack and frees all allocated memory that is owned by it. 
@@ -644,21 +779,33 @@ const LonApiError LonLidStartStack(void)
  * lit to indicate that the device is applicationless.
  *
  */
-void LonLidDestroyStack(void)
+void LonCtxLidDestroyStack(LonStackHandle hStack)
 {
     APIDebug("Start LonLidDestroyStack\n");
-	LonApiError sts = checkCreated();
+	LonApiError sts = checkCreated(hStack);
 	if (LON_SUCCESS(sts))
 	{
-		pMyStack->stopApp();
-		stackStarted = false;
+		hStack->pStack->stopApp();
+		hStack->stackStarted = false;
 	}
+    if (hStack != NULL)
+    {
 #if PRODUCT_IS(IZOT)
-	// Deregister all callbackGet functions 
-	LonDeregisterAllCallbacks();
+        // Deregister all callbackGet functions.  These belong to the
+        // handle-less API, so only the default stack owns them.
+        if (hStack == &theDefaultStack)
+        {
+            LonDeregisterAllCallbacks();
+        }
 #endif
-    deleteStack();
+        deleteStack(hStack);
+    }
     APIDebug("End LonLidDestroyStack = %d\n", sts);
+}
+
+void LonLidDestroyStack(void)
+{
+    LonCtxLidDestroyStack(&theDefaultStack);
     
     if (fpTracefile != NULL)
     {
@@ -684,13 +831,88 @@ void LonLidDestroyStack(void)
  *
  * This function must be called at least ###TBD supply required minimum frequency###.
  */
+FTXL_EXTERNAL_FN void LonCtxEventPump(LonStackHandle hStack)
+{
+	LonApiError sts = checkInit(hStack);
+	if (LON_SUCCESS(sts))
+	{
+		hStack->pStack->eventPump();
+	}
+}
+
 FTXL_EXTERNAL_FN void LonEventPump()
 {
-	LonApiError sts = checkInit();
+    LonCtxEventPump(&theDefaultStack);
+}
+
+/*
+ * Function: LonEventPumpEx
+ * Process IzoT events, with a limit on the number of incoming messages.
+ *
+ * Parameters:
+ * maxEvents - the maximum number of incoming messages and network variable 
+ *   updates to process in this call, or 0 for no limit
+ *
+ * Returns:
+ * TRUE if incoming events remain to be processed.
+ *
+ * Works like <LonEventPump>, but returns after maxEvents incoming messages so 
+ * that one busy stack cannot starve the rest of an event loop.  Call it again
+ * while it returns TRUE.
+ */
+FTXL_EXTERNAL_FN const LonBool LonCtxEventPumpEx(LonStackHandle hStack, const unsigned maxEvents)
+{
+    LonBool more = FALSE;
+	LonApiError sts = checkInit(hStack);
 	if (LON_SUCCESS(sts))
 	{
-		pMyStack->eventPump();
+		more = hStack->pStack->eventPump((int)maxEvents) ? TRUE : FALSE;
 	}
+    return more;
+}
+
+FTXL_EXTERNAL_FN const LonBool LonEventPumpEx(const unsigned maxEvents)
+{
+    return LonCtxEventPumpEx(&theDefaultStack, maxEvents);
+}
+
+/*
+ * Function: LonGetEventFd
+ * Gets a file descriptor that becomes readable when IzoT events are pending.
+ *
+ * Parameters:
+ * pFd - pointer to receive the descriptor
+ *
+ * Returns:
+ * <LonApiError>.  LonApiNotAllowed on platforms without eventfd support.
+ *
+ * The descriptor is an alternative to the <LonEventReady> callback for 
+ * applications that wait in poll, epoll or similar.  When it is readable, 
+ * call <LonEventPump> or <LonEventPumpEx>; they consume the wakeup.  The 
+ * descriptor is owned by the stack and is closed by <LonLidDestroyStack>.
+ * <LonEventReady> is still called.
+ */
+FTXL_EXTERNAL_FN const LonApiError LonCtxGetEventFd(LonStackHandle hStack, int* const pFd)
+{
+	LonApiError sts = checkCreated(hStack);
+	if (LON_SUCCESS(sts))
+	{
+        if (pFd == NULL)
+        {
+            sts = LonApiInvalidParameter;
+        }
+        else if ((*pFd = hStack->pStack->getEventFd()) < 0)
+        {
+            sts = LonApiNotAllowed;
+        }
+	}
+    APIDebug("LonGetEventFd = %d\n", sts);
+    return sts;
+}
+
+FTXL_EXTERNAL_FN const LonApiError LonGetEventFd(int* const pFd)
+{
+    return LonCtxGetEventFd(&theDefaultStack, pFd);
 }
 
 /*
@@ -733,19 +955,24 @@ FTXL_EXTERNAL_FN const LonApiError LonGetVersion(unsigned* const pMajorVersion,
  *  Use this function to propagate a service pin message to the network. 
  *  The function will fail if the device is not yet fully initialized.
  */
-const LonApiError LonSendServicePin(void)
+const LonApiError LonCtxSendServicePin(LonStackHandle hStack)
 {
     APIDebug("Start LonSendServicePin\n");
-	LonApiError sts = checkInit();
+	LonApiError sts = checkInit(hStack);
 	if (LON_SUCCESS(sts))
 	{
 		vxlReportEvent("Send service Pin Message\n");
-		pMyStack->sendServicePinMessage();
+		hStack->pStack->sendServicePinMessage();
 	}
     APIDebug("End LonSendServicePin = %d\n", sts);
     return sts;
 }
 
+const LonApiError LonSendServicePin(void)
+{
+    return LonCtxSendServicePin(&theDefaultStack);
+}
+
 /*=============================================================================
  *                          Network Variables                                *
  *===========================================================================*/
@@ -774,14 +1001,14 @@ const LonApiError LonSendServicePin(void)
  * LonPollNv operates on bound input network variables that have been declared 
  * with the Neuron C *polled* attribute, only. 
  */
-const LonApiError LonPollNv(const unsigned index)
+const LonApiError LonCtxPollNv(LonStackHandle hStack, const unsigned index)
 {
     APIDebug("Start LonPollNv(Index = %d)\n", index);
-	LonApiError sts = checkInitOnline();
+	LonApiError sts = checkInitOnline(hStack);
 	if (LON_SUCCESS(sts))
 	{
         int arrayIndex;
-        LtNetworkVariable *pNv = pMyStack->getNetworkVariable(index, arrayIndex);
+        LtNetworkVariable *pNv = hStack->pStack->getNetworkVariable(index, arrayIndex);
         if (pNv == NULL)
         {
             sts = LonApiNvIndexInvalid;
@@ -794,7 +1021,7 @@ const LonApiError LonPollNv(const unsigned index)
         {
             sts = LonApiNvPollNotPolledNv;
         }
-        else if (!pMyStack->poll(index))
+        else if (!hStack->pStack->poll(index))
         {
             sts = LonApiTxBufIsFull;
         }
@@ -803,6 +1030,11 @@ const LonApiError LonPollNv(const unsigned index)
     return sts;
 }
 
+const LonApiError LonPollNv(const unsigned index)
+{
+    return LonCtxPollNv(&theDefaultStack, index);
+}
+
 /*
  *  Function: LonPropagateNv
  *  Propagates the value of a bound output network variable to the network.
@@ -841,14 +1073,14 @@ const LonApiError LonPollNv(const unsigned index)
  *      network variable will be propagated at a later time, when one becomes 
  *      available.
  */
-const LonApiError LonPropagateNv(const unsigned index)
+const LonApiError LonCtxPropagateNv(LonStackHandle hStack, const unsigned index)
 {
     APIDebug("Start LonPropagateNv(Index = %d)\n", index);
-	LonApiError sts = checkInitOnline();
+	LonApiError sts = checkInitOnline(hStack);
 	if (LON_SUCCESS(sts))
 	{
         int arrayIndex;
-        LtNetworkVariable *pNv = pMyStack->getNetworkVariable(index, arrayIndex);
+        LtNetworkVariable *pNv = hStack->pStack->getNetworkVariable(index, arrayIndex);
         if (pNv == NULL)
         {
             sts = LonApiNvIndexInvalid;
@@ -861,7 +1093,7 @@ const LonApiError LonPropagateNv(const unsigned index)
         {
             sts = LonApiNvPropagatePolledNv;
         }
-        else if (!pMyStack->propagate(index))
+        else if (!hStack->pStack->propagate(index))
         {
             sts = LonApiTxBufIsFull;
         }
@@ -870,6 +1102,81 @@ const LonApiError LonPropagateNv(const unsigned index)
     return sts;
 }
 
+const LonApiError LonPropagateNv(const unsigned index)
+{
+    return LonCtxPropagateNv(&theDefaultStack, index);
+}
+
+/*
+ *  Function: LonPropagateNvs
+ *  Propagates the values of a list of bound output network variables.
+ *
+ *  Parameters:
+ *  pIndices - the indices of the network variables
+ *  count - the number of indices
+ *  pPropagated - receives the number propagated, may be NULL
+ *
+ *  Returns:
+ *  <LonApiError>.
+ *
+ *  Remarks:
+ *  Equivalent to calling <LonPropagateNv> for each index in turn, but 
+ *  without the per call overhead.  All the indices are checked before any 
+ *  are propagated, so an invalid index means none are sent.  If the stack 
+ *  runs out of buffers for a *sync* network variable, the remaining ones are 
+ *  not propagated, *LonApiTxBufIsFull* is returned and *pPropagated tells 
+ *  how many were.
+ */
+const LonApiError LonCtxPropagateNvs(LonStackHandle hStack, const unsigned* const pIndices,
+                                     const unsigned count, unsigned* const pPropagated)
+{
+    APIDebug("Start LonPropagateNvs(Count = %d)\n", count);
+	LonApiError sts = checkInitOnline(hStack);
+	unsigned nPropagated = 0;
+
+	if (LON_SUCCESS(sts) && pIndices == NULL && count != 0)
+	{
+		sts = LonApiInvalidParameter;
+	}
+	for (unsigned i = 0; LON_SUCCESS(sts) && i < count; i++)
+	{
+        int arrayIndex;
+        LtNetworkVariable *pNv = hStack->pStack->getNetworkVariable(pIndices[i], arrayIndex);
+        if (pNv == NULL)
+        {
+            sts = LonApiNvIndexInvalid;
+        }
+        else if (!pNv->getIsOutput())
+        {
+            sts = LonApiNvPropagateInputNv;
+        }
+        else if ((pNv->getFlags() & NV_SD_POLLED))
+        {
+            sts = LonApiNvPropagatePolledNv;
+        }
+	}
+	if (LON_SUCCESS(sts) && count != 0)
+	{
+		nPropagated = hStack->pStack->propagate((const int*)pIndices, (int)count);
+		if (nPropagated < count)
+		{
+			sts = LonApiTxBufIsFull;
+		}
+	}
+	if (pPropagated != NULL)
+	{
+		*pPropagated = nPropagated;
+	}
+    APIDebug("End LonPropagateNvs = %d, %d propagated\n", sts, nPropagated);
+    return sts;
+}
+
+const LonApiError LonPropagateNvs(const unsigned* const pIndices, const unsigned count,
+                                  unsigned* const pPropagated)
+{
+    return LonCtxPropagateNvs(&theDefaultStack, pIndices, count, pPropagated);
+}
+
 /*
  *  Function: LonGetDeclaredNvSize
  *  Gets the declared size of a network variable.
@@ -885,15 +1192,15 @@ const LonApiError LonPropagateNv(const unsigned index)
  *  Note that this function *may* be called from the LonGetCurrentNvSize() 
  *  callback.
  */
-const unsigned LonGetDeclaredNvSize(const unsigned index)
+const unsigned LonCtxGetDeclaredNvSize(LonStackHandle hStack, const unsigned index)
 {
     APIDebug("Start LonGetDeclaredNvSize(Index = %d)\n", index);
     int size = 0;
-    LonApiError sts = checkInit();
+    LonApiError sts = checkInit(hStack);
     if (LON_SUCCESS(sts))
     {
         int arrayIndex;
-        LtNetworkVariable *pNv = pMyStack->getNetworkVariable(index, arrayIndex);
+        LtNetworkVariable *pNv = hStack->pStack->getNetworkVariable(index, arrayIndex);
         if (pNv != NULL)
         {
             size = pNv->getLength();
@@ -903,6 +1210,11 @@ const unsigned LonGetDeclaredNvSize(const unsigned index)
     return size;
 }
 
+const unsigned LonGetDeclaredNvSize(const unsigned index)
+{
+    return LonCtxGetDeclaredNvSize(&theDefaultStack, index);
+}
+
 /*
  *  Function: LonGetNvValue
  *  Returns a pointer to the network variable value.
@@ -917,18 +1229,18 @@ const unsigned LonGetDeclaredNvSize(const unsigned index)
  *  You can use this function to obtain a pointer to either a static or
  *  dynamic network variable value.
  */
-volatile void* const LonGetNvValue(const unsigned index)
+volatile void* const LonCtxGetNvValue(LonStackHandle hStack, const unsigned index)
  {
     volatile void* p = NULL;
     // Can't check for stack started, because LonInit calls this during
     // deserialize.
     APIDebug("Start LonGetNvValue(Index = %d)\n", index);
-	LonApiError sts = checkCreated();
+	LonApiError sts = checkCreated(hStack);
 
 	if (LON_SUCCESS(sts))
 	{
         int arrayIndex;
-        LtNetworkVariable *pNv = pMyStack->getNetworkVariable(index, arrayIndex);
+        LtNetworkVariable *pNv = hStack->pStack->getNetworkVariable(index, arrayIndex);
         if (pNv != NULL)
         {
             p = pNv->getNvDataPtr(arrayIndex);
@@ -938,6 +1250,11 @@ volatile void* const LonGetNvValue(const unsigned index)
     return p;
  }
 
+volatile void* const LonGetNvValue(const unsigned index)
+{
+    return LonCtxGetNvValue(&theDefaultStack, index);
+}
+
 /*
  *  Function: LonSetNvValue
  *  Set a new the network variable value in packed, big-endian.
@@ -954,18 +1271,18 @@ volatile void* const LonGetNvValue(const unsigned index)
  *  This makes it easier for the Python application to pass data to stack which expects
  *  big endian packed byte arrays.
  */
-const LonApiError LonSetNvValue(const unsigned index, void* const pValue)
+const LonApiError LonCtxSetNvValue(LonStackHandle hStack, const unsigned index, void* const pValue)
 {
     byte *p;
 
     APIDebug("Start LonSetNvValue(Index = %d)\n", index);
-	LonApiError sts = checkCreated();
+	LonApiError sts = checkCreated(hStack);
     
 	if (LON_SUCCESS(sts))
 	{
         int arrayIndex;
         int nLength;
-        LtNetworkVariable *pNv = pMyStack->getNetworkVariable(index, arrayIndex);
+        LtNetworkVariable *pNv = hStack->pStack->getNetworkVariable(index, arrayIndex);
         if (pNv != NULL)
         {
             printTimeStamp = false;
@@ -994,6 +1311,11 @@ const LonApiError LonSetNvValue(const unsigned index, void* const pValue)
     return sts;
  }
 
+const LonApiError LonSetNvValue(const unsigned index, void* const pValue)
+{
+    return LonCtxSetNvValue(&theDefaultStack, index, pValue);
+}
+
 /*
  *  Function: LonQueryNvType
  *  Queries type information about a network variable.
@@ -1013,27 +1335,32 @@ const LonApiError LonSetNvValue(const unsigned index, void* const pValue)
  *  The application must call LonFreeNvTypeData to free these strings
  *  when it is done with them.
  */
-const LonApiError LonQueryNvType(const unsigned index, LonNvDefinition* const pNvDef)
+const LonApiError LonCtxQueryNvType(LonStackHandle hStack, const unsigned index, LonNvDefinition* const pNvDef)
 {
     APIDebug("Start LonQueryNvType(%d)\n", index);
-	LonApiError sts = checkInit();
+	LonApiError sts = checkInit(hStack);
 	if (LON_SUCCESS(sts))
 	{
         int arrayIndex;
-        LtNetworkVariable *pNv = pMyStack->getNetworkVariable(index, arrayIndex);
+        LtNetworkVariable *pNv = hStack->pStack->getNetworkVariable(index, arrayIndex);
         if (pNv == NULL)
         {
             sts = LonApiNvIndexInvalid;
         }
         else
         {
-            sts = pMyStack->queryNvType(pNv, arrayIndex, pNvDef);
+            sts = hStack->pStack->queryNvType(pNv, arrayIndex, pNvDef);
         }        
     }
     APIDebug("End LonQueryNvType = %d\n", sts);
     return sts;
 }
 
+const LonApiError LonQueryNvType(const unsigned index, LonNvDefinition* const pNvDef)
+{
+    return LonCtxQueryNvType(&theDefaultStack, index, pNvDef);
+}
+
 /*
  *  Function: LonFreeNvTypeData
  *  Frees internal buffers allocated by LonQueryNvType.
@@ -1080,19 +1407,19 @@ const LonApiError LonFreeNvTypeData(LonNvDefinition* const pNvDef)
  *  is to be sent after returning from that routine.  A response code should be 
  *  in the 0x00..0x2f range.
  */
-const LonApiError LonSendResponse(const LonCorrelator correlator, 
-                                  const LonByte code, 
-                                  const LonByte* const pData, 
-                                  const unsigned length)
+const LonApiError LonCtxSendResponse(LonStackHandle hStack, const LonCorrelator correlator, 
+                                     const LonByte code, 
+                                     const LonByte* const pData, 
+                                     const unsigned length)
 {
     APIDebug("Start LonSendResponse\n");
-	LonApiError sts = checkInit();
+	LonApiError sts = checkInit(hStack);
 	if (LON_SUCCESS(sts))
 	{
         LtMsgIn *pRequest = (LtMsgIn *)correlator;
         if (pRequest != NULL)
         {
-            LtRespOut* pResp = pMyStack->respAlloc(pRequest);
+            LtRespOut* pResp = hStack->pStack->respAlloc(pRequest);
             if (pResp != null)
             {
                 pResp->setCode(code);
@@ -1103,14 +1430,14 @@ const LonApiError LonSendResponse(const LonCorrelator correlator,
                 }
                 else
                 {
-	                pMyStack->send(pResp);
+	                hStack->pStack->send(pResp);
                 }
             }
             else
             {
                 sts = LonApiTxBufIsFull;
             }
-            pMyStack->release(pRequest);
+            hStack->pStack->release(pRequest);
         }
         else
         {
@@ -1121,6 +1448,14 @@ const LonApiError LonSendResponse(const LonCorrelator correlator,
     return sts;
 }
 
+const LonApiError LonSendResponse(const LonCorrelator correlator, 
+                                  const LonByte code, 
+                                  const LonByte* const pData, 
+                                  const unsigned length)
+{
+    return LonCtxSendResponse(&theDefaultStack, correlator, code, pData, length);
+}
+
 /*
  *  Function: LonReleaseCorrelator
  *  Release a request correlator without sending response.
@@ -1136,15 +1471,15 @@ const LonApiError LonSendResponse(const LonCorrelator correlator,
  *  send a response to every message with a service type of request, or release
  *  the correlator, but not both.  
  */
-const LonApiError LonReleaseCorrelator(const LonCorrelator correlator)
+const LonApiError LonCtxReleaseCorrelator(LonStackHandle hStack, const LonCorrelator correlator)
 {
-	LonApiError sts = checkInit();
+	LonApiError sts = checkInit(hStack);
 	if (LON_SUCCESS(sts))
 	{
         LtMsgIn *pRequest = (LtMsgIn *)correlator;
         if (pRequest != NULL)
         {
-            pMyStack->release(pRequest);
+            hStack->pStack->release(pRequest);
         }
         else
         {
@@ -1154,6 +1489,11 @@ const LonApiError LonReleaseCorrelator(const LonCorrelator correlator)
     return sts;
 }
 
+const LonApiError LonReleaseCorrelator(const LonCorrelator correlator)
+{
+    return LonCtxReleaseCorrelator(&theDefaultStack, correlator);
+}
+
 /*
  *  Function: LonSendMsg
  *  Send an explicit (non-NV) message.
@@ -1188,21 +1528,21 @@ const LonApiError LonReleaseCorrelator(const LonCorrelator correlator)
  *  If the message is a request, <LonResponseArrived> event handlers are 
  *  called when corresponding responses arrive.
  */
-const LonApiError LonSendMsg(const unsigned tag, const LonBool priority, 
-                             const LonServiceType st, 
-                             const LonBool authenticated,
-                             const LonSendAddress* const pDestAddr, 
-                             const LonByte code, 
-                             const LonByte* const pData, const unsigned length)
-{
-	LonApiError sts = checkInitOnline();
+const LonApiError LonCtxSendMsg(LonStackHandle hStack, const unsigned tag, const LonBool priority, 
+                                const LonServiceType st, 
+                                const LonBool authenticated,
+                                const LonSendAddress* const pDestAddr, 
+                                const LonByte code, 
+                                const LonByte* const pData, const unsigned length)
+{
+	LonApiError sts = checkInitOnline(hStack);
     LtMsgOut *pMsgOut = NULL;
     boolean explicitAddress = false; 
 
     if (LON_SUCCESS(sts))
 	{
-        pMsgOut = priority ? pMyStack->msgAllocPriority() :
-                                       pMyStack->msgAlloc();
+        pMsgOut = priority ? hStack->pStack->msgAllocPriority() :
+                                       hStack->pStack->msgAlloc();
         if (pMsgOut == NULL)
         {
             sts = LonApiTxBufIsFull;
@@ -1210,7 +1550,7 @@ const LonApiError LonSendMsg(const unsigned tag, const LonBool priority,
     }
 	if (LON_SUCCESS(sts))
     {
-        explicitAddress = (tag >= (unsigned)pMyStack->getMessageTagCount());
+        explicitAddress = (tag >= (unsigned)hStack->pStack->getMessageTagCount());
         pMsgOut->setServiceType((LtServiceType)st);
         pMsgOut->setAuthenticated(authenticated);
         if (explicitAddress)
@@ -1305,7 +1645,7 @@ const LonApiError LonSendMsg(const unsigned tag, const LonBool priority,
         else
         {
             pMsgOut->setTag(*pMsgTag);
-            pMyStack->send(pMsgOut);
+            hStack->pStack->send(pMsgOut);
         }
     }
 
@@ -1313,13 +1653,23 @@ const LonApiError LonSendMsg(const unsigned tag, const LonBool priority,
     {
         if (pMsgOut != NULL)
         {
-            pMyStack->cancel(pMsgOut);
+            hStack->pStack->cancel(pMsgOut);
         }
         APIDebug("LonSendMsg = %d\n", sts);
     }
     return (sts);
 }
 
+const LonApiError LonSendMsg(const unsigned tag, const LonBool priority, 
+                             const LonServiceType st, 
+                             const LonBool authenticated,
+                             const LonSendAddress* const pDestAddr, 
+                             const LonByte code, 
+                             const LonByte* const pData, const unsigned length)
+{
+    return LonCtxSendMsg(&theDefaultStack, tag, priority, st, authenticated, pDestAddr, code, pData, length);
+}
+
 /*
  * ******************************************************************************
  * SECTION: EXTENDED API FUNCTIONS
@@ -1344,14 +1694,14 @@ const LonApiError LonSendMsg(const unsigned tag, const LonBool priority,
  *  Call this function to request a copy of a local domain table record. 
  *  The information is returned via the <LonDomain> structure provided.
  */
-const LonApiError LonQueryDomainConfig(const unsigned index,
-                                       LonDomain* const pDomain)
+const LonApiError LonCtxQueryDomainConfig(LonStackHandle hStack, const unsigned index,
+                                          LonDomain* const pDomain)
 {
-	LonApiError sts = checkInit();
+	LonApiError sts = checkInit(hStack);
 	if (LON_SUCCESS(sts))
 	{
         LtDomainConfiguration dc;
-        sts = LonSts(pMyStack->getDomainConfiguration(index, &dc));
+        sts = LonSts(hStack->pStack->getDomainConfiguration(index, &dc));
         if (LON_SUCCESS(sts))
         {
             dc.toLonTalk((byte *)pDomain, LT_CLASSIC_DOMAIN_STYLE);
@@ -1363,6 +1713,12 @@ const LonApiError LonQueryDomainConfig(const unsigned index,
     return sts;
 }
 
+const LonApiError LonQueryDomainConfig(const unsigned index,
+                                       LonDomain* const pDomain)
+{
+    return LonCtxQueryDomainConfig(&theDefaultStack, index, pDomain);
+}
+
 /*
  *  Function: LonQueryNvConfig
  *  Request copy of NV configuration data.
@@ -1378,19 +1734,25 @@ const LonApiError LonQueryDomainConfig(const unsigned index,
  *  The configuration will be stored in the <LonNvEcsConfig> structure
  *  provided.
  */
-const LonApiError LonQueryNvConfig(const unsigned index,
-                                   LonNvEcsConfig* const pNvConfig)
+const LonApiError LonCtxQueryNvConfig(LonStackHandle hStack, const unsigned index,
+                                      LonNvEcsConfig* const pNvConfig)
 {
-	LonApiError sts = checkInit();
+	LonApiError sts = checkInit(hStack);
 	if (LON_SUCCESS(sts))
 	{
-        sts = pMyStack->queryNvConfig(index, pNvConfig);
+        sts = hStack->pStack->queryNvConfig(index, pNvConfig);
     }
     else
         APIDebug("LonQueryNvConfig = %d\n", sts);
     return sts;
 }
 
+const LonApiError LonQueryNvConfig(const unsigned index,
+                                   LonNvEcsConfig* const pNvConfig)
+{
+    return LonCtxQueryNvConfig(&theDefaultStack, index, pNvConfig);
+}
+
 /*
  *  Function: LonQueryAliasConfig
  *  Request copy of alias configuration data.
@@ -1406,19 +1768,25 @@ const LonApiError LonQueryNvConfig(const unsigned index,
  *  The configuration will be stored in the <LonAliasEcsConfig> structure
  *  provided. 
  */
-const LonApiError LonQueryAliasConfig(const unsigned index,
-                                      LonAliasEcsConfig* const pAlias)
+const LonApiError LonCtxQueryAliasConfig(LonStackHandle hStack, const unsigned index,
+                                         LonAliasEcsConfig* const pAlias)
 {
-	LonApiError sts = checkInit();
+	LonApiError sts = checkInit(hStack);
 	if (LON_SUCCESS(sts))
 	{
-        sts = pMyStack->queryAliasConfig(index, pAlias);
+        sts = hStack->pStack->queryAliasConfig(index, pAlias);
 	}
     else
         APIDebug("LonQueryAliasConfig = %d\n", sts);
     return sts;
 }
 
+const LonApiError LonQueryAliasConfig(const unsigned index,
+                                      LonAliasEcsConfig* const pAlias)
+{
+    return LonCtxQueryAliasConfig(&theDefaultStack, index, pAlias);
+}
+
 /*
  *  Function: LonNvIsBound
  *  Determine whether or not a network variable is bound.
@@ -1436,20 +1804,20 @@ const LonApiError LonQueryAliasConfig(const unsigned index,
  *  network variable is equal to (0x3fff - nvIndex).  A network variable
  *  or alias has an address if the address index is anything other than 0xffff.
  */
-const LonApiError LonNvIsBound(const unsigned index, LonBool* const pIsBound)
+const LonApiError LonCtxNvIsBound(LonStackHandle hStack, const unsigned index, LonBool* const pIsBound)
 {
-	LonApiError sts = checkInit();
+	LonApiError sts = checkInit(hStack);
     if (LON_SUCCESS(sts))
 	{
         int arrayIndex;
-        LtNetworkVariable *pNv = pMyStack->getNetworkVariable(index, arrayIndex);
+        LtNetworkVariable *pNv = hStack->pStack->getNetworkVariable(index, arrayIndex);
         if (pNv == NULL)
         {
             sts = LonApiNvIndexInvalid;
         }
         else
         {
-            *pIsBound = pMyStack->isBound(pNv, arrayIndex, ISBOUND_ANY);
+            *pIsBound = hStack->pStack->isBound(pNv, arrayIndex, ISBOUND_ANY);
         }
     }
     else
@@ -1457,6 +1825,11 @@ const LonApiError LonNvIsBound(const unsigned index, LonBool* const pIsBound)
     return sts;
 }
 
+const LonApiError LonNvIsBound(const unsigned index, LonBool* const pIsBound)
+{
+    return LonCtxNvIsBound(&theDefaultStack, index, pIsBound);
+}
+
 /*
  *  Function: LonQueryAddressConfig
  *  Request copy of address table configuration data.
@@ -1472,19 +1845,25 @@ const LonApiError LonNvIsBound(const unsigned index, LonBool* const pIsBound)
  *  The configuration will be stored in the <LonAddress> structure
  *  provided. 
  */
-const LonApiError LonQueryAddressConfig(const unsigned index,
-                                        LonAddress* const pAddress)
+const LonApiError LonCtxQueryAddressConfig(LonStackHandle hStack, const unsigned index,
+                                           LonAddress* const pAddress)
 {
-	LonApiError sts = checkInit();
+	LonApiError sts = checkInit(hStack);
     if (LON_SUCCESS(sts))
 	{
-        sts = pMyStack->queryAddressConfig(index, pAddress);
+        sts = hStack->pStack->queryAddressConfig(index, pAddress);
     }
     else
         APIDebug("LonQueryAddressConfig = %d\n", sts);
     return sts;
 }
 
+const LonApiError LonQueryAddressConfig(const unsigned index,
+                                        LonAddress* const pAddress)
+{
+    return LonCtxQueryAddressConfig(&theDefaultStack, index, pAddress);
+}
+
 /*
  *  Function: LonMtIsBound
  *  Determine whether or not a message tag is bound.
@@ -1500,19 +1879,19 @@ const LonApiError LonQueryAddressConfig(const unsigned index,
  *  A message tag is bound if the associated address type is anything other
  *  than lonAddressUnassigned.
  */
-const LonApiError LonMtIsBound(const unsigned tag, LonBool* const pIsBound)
+const LonApiError LonCtxMtIsBound(LonStackHandle hStack, const unsigned tag, LonBool* const pIsBound)
 {
-	LonApiError sts = checkInit();
+	LonApiError sts = checkInit(hStack);
     if (LON_SUCCESS(sts))
 	{
-        if (tag >= (unsigned)pMyStack->getMessageTagCount())
+        if (tag >= (unsigned)hStack->pStack->getMessageTagCount())
         {
             sts = LonApiMsgInvalidMsgTag;
         }
         else
         {
             LonAddress address;
-            sts = pMyStack->queryAddressConfig(tag, &address);
+            sts = hStack->pStack->queryAddressConfig(tag, &address);
             if (LON_SUCCESS(sts))
 	        {
                 *pIsBound = (address.SubnetNode.Type != LonAddressUnassigned);
@@ -1524,6 +1903,11 @@ const LonApiError LonMtIsBound(const unsigned tag, LonBool* const pIsBound)
     return sts;
 }
 
+const LonApiError LonMtIsBound(const unsigned tag, LonBool* const pIsBound)
+{
+    return LonCtxMtIsBound(&theDefaultStack, tag, pIsBound);
+}
+
 
 /*
  *  Function: LonQueryConfigData
@@ -1539,12 +1923,12 @@ const LonApiError LonMtIsBound(const unsigned tag, LonBool* const pIsBound)
  *  The configuration will be stored in the <LonConfigData> structure
  *  provided. 
  */
-const LonApiError LonQueryConfigData(LonConfigData* const pConfig)
+const LonApiError LonCtxQueryConfigData(LonStackHandle hStack, LonConfigData* const pConfig)
 {
-	LonApiError sts = checkInit();
+	LonApiError sts = checkInit(hStack);
 	if (LON_SUCCESS(sts))
 	{
-		sts = LonSts(pMyStack->getConfigurationData((byte *)pConfig, 0, 
+		sts = LonSts(hStack->pStack->getConfigurationData((byte *)pConfig, 0, 
 													sizeof(LonConfigData)));
     }
     else
@@ -1552,6 +1936,11 @@ const LonApiError LonQueryConfigData(LonConfigData* const pConfig)
     return sts;
 }
 
+const LonApiError LonQueryConfigData(LonConfigData* const pConfig)
+{
+    return LonCtxQueryConfigData(&theDefaultStack, pConfig);
+}
+
 /*
  *  Function: LonQueryStatus
  *  Request local status and statistics.
@@ -1565,14 +1954,14 @@ const LonApiError LonQueryConfigData(LonConfigData* const pConfig)
  *  Call this function to obtain the local status and statistics of the IzoT 
  *  device. The status will be stored in the <LonStatus> structure provided. 
  */
-const LonApiError LonQueryStatus(LonStatus* const pStatus)
+const LonApiError LonCtxQueryStatus(LonStackHandle hStack, LonStatus* const pStatus)
 {
     APIDebug("Start LonQueryStatus\n");
-	LonApiError sts = checkInit();
+	LonApiError sts = checkInit(hStack);
 	if (LON_SUCCESS(sts))
 	{
         LtStatus status;
-        sts = LonSts(pMyStack->retrieveStatus(status));
+        sts = LonSts(hStack->pStack->retrieveStatus(status));
         if (LON_SUCCESS(sts))
         {
 			LON_SET_UNSIGNED_WORD(pStatus->TransmitErrors, status.transmissionErrors);
@@ -1591,6 +1980,11 @@ const LonApiError LonQueryStatus(LonStatus* const pStatus)
     return sts;
 }
 
+const LonApiError LonQueryStatus(LonStatus* const pStatus)
+{
+    return LonCtxQueryStatus(&theDefaultStack, pStatus);
+}
+
 /*
  *  Function: LonQueryTransceiverStatus
  *  Request local transceiver status information.
@@ -1611,17 +2005,17 @@ const LonApiError LonQueryStatus(LonStatus* const pStatus)
  *  special purpose mode transceiver, this function always returns 
  *  LonApiInvalidParameter.
  */
-const LonApiError LonQueryTransceiverStatus(
-    LonTransceiverParameters* const pTransceiverParameters)
+const LonApiError LonCtxQueryTransceiverStatus(LonStackHandle hStack, 
+       LonTransceiverParameters* const pTransceiverParameters)
 {
     APIDebug("Start LonQueryTransceiverStatus\n");
-	LonApiError sts = checkInit();
+	LonApiError sts = checkInit(hStack);
 	if (LON_SUCCESS(sts))
 	{
         byte data[LT_NUM_REGS];
-        if (pMyStack->isSpecialPurpose()) 
+        if (hStack->pStack->isSpecialPurpose()) 
 	    {
-            sts = LonSts(pMyStack->fetchXcvrReg(data, 0));
+            sts = LonSts(hStack->pStack->fetchXcvrReg(data, 0));
         } 
 	    else 
 	    {
@@ -1637,6 +2031,12 @@ const LonApiError LonQueryTransceiverStatus(
     return sts;
 }
 
+const LonApiError LonQueryTransceiverStatus(
+    LonTransceiverParameters* const pTransceiverParameters)
+{
+    return LonCtxQueryTransceiverStatus(&theDefaultStack, pTransceiverParameters);
+}
+
 /*
  *  Function: LonQueryReadOnlyData
  *  Request copy of local read-only data.
@@ -1651,18 +2051,23 @@ const LonApiError LonQueryTransceiverStatus(
  *  The read-only data will be stored in the <LonReadOnlyData> structure
  *  provided. 
  */
-const LonApiError LonQueryReadOnlyData(LonReadOnlyData* const pReadOnlyData)
+const LonApiError LonCtxQueryReadOnlyData(LonStackHandle hStack, LonReadOnlyData* const pReadOnlyData)
 {
     APIDebug("Start LonQueryReadOnlyData\n");
-	LonApiError sts = checkInit();
+	LonApiError sts = checkInit(hStack);
 	if (LON_SUCCESS(sts))
 	{
-        sts = LonSts(pMyStack->getReadOnlyData((byte *)pReadOnlyData));
+        sts = LonSts(hStack->pStack->getReadOnlyData((byte *)pReadOnlyData));
     }
     APIDebug("End LonQueryReadOnlyData = %d\n", sts);
     return sts;
 }
 
+const LonApiError LonQueryReadOnlyData(LonReadOnlyData* const pReadOnlyData)
+{
+    return LonCtxQueryReadOnlyData(&theDefaultStack, pReadOnlyData);
+}
+
 /*
  *  Function: LonSetNodeMode
  *  Sets the device's mode and/or state.
@@ -1687,31 +2092,31 @@ const LonApiError LonQueryReadOnlyData(LonReadOnlyData* const pReadOnlyData)
  *  You can also use the shorthand functions <LonGoOnline>, <LonGoOffline>, 
  *  <LonGoConfigured>, and <LonGoUnconfigured>.
  */
-const LonApiError LonSetNodeMode(const LonNodeMode mode, 
+const LonApiError LonCtxSetNodeMode(LonStackHandle hStack, const LonNodeMode mode, 
 								 const LonNodeState state)
 {
     APIDebug("Start LonSetNodeMode\n");
-	LonApiError sts = checkInit();
+	LonApiError sts = checkInit(hStack);
 	if (LON_SUCCESS(sts))
 	{
-        boolean wasOffline = pMyStack->getOffline();
+        boolean wasOffline = hStack->pStack->getOffline();
 		switch(mode)
 		{
 		case LonApplicationOffLine:
-		    pMyStack->setOffline(true);
+		    hStack->pStack->setOffline(true);
             if (!wasOffline)
                 LonOffline();
 			break;
 		case LonApplicationOnLine:
-			pMyStack->setOffline(false);
+			hStack->pStack->setOffline(false);
             if (wasOffline)
                 LonOnline();
 			break;
 		case LonApplicationReset:
-			pMyStack->initiateReset();
+			hStack->pStack->initiateReset();
 			break;
 		case LonChangeState:
-			sts = LonSts(pMyStack->changeState(state));
+			sts = LonSts(hStack->pStack->changeState(state));
 			break;
 		default:
 			sts = LonApiInvalidParameter;
@@ -1721,6 +2126,12 @@ const LonApiError LonSetNodeMode(const LonNodeMode mode,
     return sts;
 }
 
+const LonApiError LonSetNodeMode(const LonNodeMode mode, 
+								 const LonNodeState state)
+{
+    return LonCtxSetNodeMode(&theDefaultStack, mode, state);
+}
+
 /* 
  *  Function: LonUpdateAddressConfig
  *  Updates an address table record on the IzoT device.
@@ -1735,18 +2146,24 @@ const LonApiError LonSetNodeMode(const LonNodeMode mode,
  *  Remarks:
  *  Use this function to write a record to the local address table.
  */
-const LonApiError LonUpdateAddressConfig(const unsigned index,
+const LonApiError LonCtxUpdateAddressConfig(LonStackHandle hStack, const unsigned index,
 										 const LonAddress* const pAddress)
 {
-	LonApiError sts = checkInit();
+	LonApiError sts = checkInit(hStack);
 	if (LON_SUCCESS(sts))
 	{
-        sts = pMyStack->updateAddressConfig(index, pAddress);
+        sts = hStack->pStack->updateAddressConfig(index, pAddress);
     }
     APIDebug("LonUpdateAddressConfig = %d\n", sts);
     return sts;
 }
 
+const LonApiError LonUpdateAddressConfig(const unsigned index,
+										 const LonAddress* const pAddress)
+{
+    return LonCtxUpdateAddressConfig(&theDefaultStack, index, pAddress);
+}
+
 /* 
  *  Function: LonUpdateAliasConfig
  *  Updates an alias table record on the IzoT device.
@@ -1761,17 +2178,22 @@ const LonApiError LonUpdateAddressConfig(const unsigned index,
  *  This function writes a record in the local alias table.
  *  This function is part of the optional network management update API (LON_NM_UPDATE_API).
  */
-const LonApiError LonUpdateAliasConfig(const unsigned index, const LonAliasEcsConfig* const pAlias)
+const LonApiError LonCtxUpdateAliasConfig(LonStackHandle hStack, const unsigned index, const LonAliasEcsConfig* const pAlias)
 {
-	LonApiError sts = checkInit();
+	LonApiError sts = checkInit(hStack);
 	if (LON_SUCCESS(sts))
 	{
-        sts = pMyStack->updateAliasConfig(index, pAlias);
+        sts = hStack->pStack->updateAliasConfig(index, pAlias);
     }
     APIDebug("LonUpdateAliasConfig = %d\n", sts);
     return sts;
 }
 
+const LonApiError LonUpdateAliasConfig(const unsigned index, const LonAliasEcsConfig* const pAlias)
+{
+    return LonCtxUpdateAliasConfig(&theDefaultStack, index, pAlias);
+}
+
 /* 
  *  Function: LonUpdateConfigData
  *  Updates the configuration data on the IzoT device.
@@ -1786,17 +2208,22 @@ const LonApiError LonUpdateAliasConfig(const unsigned index, const LonAliasEcsCo
  *  Call this function to update the device's configuration data based on the 
  *  configuration stored in the <LonConfigData> structure.
  */
-const LonApiError LonUpdateConfigData(const LonConfigData* const pConfig)
+const LonApiError LonCtxUpdateConfigData(LonStackHandle hStack, const LonConfigData* const pConfig)
 {
-	LonApiError sts = checkInit();
+	LonApiError sts = checkInit(hStack);
 	if (LON_SUCCESS(sts))
 	{
-        sts = pMyStack->updateConfigData(pConfig);
+        sts = hStack->pStack->updateConfigData(pConfig);
     }
     APIDebug("LonUpdateConfigData = %d\n", sts);
     return sts;
 }
 
+const LonApiError LonUpdateConfigData(const LonConfigData* const pConfig)
+{
+    return LonCtxUpdateConfigData(&theDefaultStack, pConfig);
+}
+
 /*
  *  Function: LonUpdateNvConfig
  *  Updates a network variable configuration table record on the IzoT device.
@@ -1812,18 +2239,24 @@ const LonApiError LonUpdateConfigData(const LonConfigData* const pConfig)
  *  This function can be used to update one record of the network variable
  *  configuration table.
  */
-const LonApiError LonUpdateNvConfig(const unsigned index,
+const LonApiError LonCtxUpdateNvConfig(LonStackHandle hStack, const unsigned index,
 									const LonNvEcsConfig* const pNvConfig)
 {
-	LonApiError sts = checkInit();
+	LonApiError sts = checkInit(hStack);
 	if (LON_SUCCESS(sts))
 	{
-        sts = pMyStack->updateNvConfig(index, pNvConfig);
+        sts = hStack->pStack->updateNvConfig(index, pNvConfig);
     }
     APIDebug("LonUpdateNvConfig = %d\n", sts);
     return sts;
 }
 
+const LonApiError LonUpdateNvConfig(const unsigned index,
+									const LonNvEcsConfig* const pNvConfig)
+{
+    return LonCtxUpdateNvConfig(&theDefaultStack, index, pNvConfig);
+}
+
 /* 
  *  Function:   LonUpdateDomainConfig
  *  Updates a domain table record on the IzoT device.
@@ -1838,17 +2271,17 @@ const LonApiError LonUpdateNvConfig(const unsigned index,
  *  Remarks:
  *  This function can be used to update one record of the domain table.
  */
-const LonApiError LonUpdateDomainConfig(const unsigned index,
+const LonApiError LonCtxUpdateDomainConfig(LonStackHandle hStack, const unsigned index,
 										const LonDomain* const pDomain)
 {
-	LonApiError sts = checkInit();
+	LonApiError sts = checkInit(hStack);
 	if (LON_SUCCESS(sts))
 	{
         LtDomainConfiguration dc;
 		int len;
 
 #if PRODUCT_IS(IZOT)
-		LontalkStackUriScheme chnlType = myDeviceUri.getScheme();
+		LontalkStackUriScheme chnlType = hStack->deviceUri.getScheme();
         LonDomain domain;
         memcpy(&domain, pDomain, sizeof(LonDomain)); 
 
@@ -1876,12 +2309,18 @@ const LonApiError LonUpdateDomainConfig(const unsigned index,
             dc.getDomain().getData(2), dc.getDomain().getData(3), dc.getDomain().getData(4),
             dc.getDomain().getData(5));
 
-        sts = LonSts(pMyStack->updateDomainConfiguration(index, &dc, true, false));
+        sts = LonSts(hStack->pStack->updateDomainConfiguration(index, &dc, true, false));
 	}
     APIDebug("LonUpdateDomainConfig(index = %d) = %d\n", index, sts);
     return sts;
 }
 
+const LonApiError LonUpdateDomainConfig(const unsigned index,
+										const LonDomain* const pDomain)
+{
+    return LonCtxUpdateDomainConfig(&theDefaultStack, index, pDomain);
+}
+
 /* 
  *  Function: LonClearStatus
  *  Clears the statistics 
@@ -1893,17 +2332,22 @@ const LonApiError LonUpdateDomainConfig(const unsigned index,
  *  This function can be used to clear the IzoT device status and statistics 
  *  records.
  */
-const LonApiError LonClearStatus(void)
+const LonApiError LonCtxClearStatus(LonStackHandle hStack)
 {
-	LonApiError sts = checkInit();
+	LonApiError sts = checkInit(hStack);
 	if (LON_SUCCESS(sts))
 	{
-        sts = LonSts(pMyStack->clearStatus());
+        sts = LonSts(hStack->pStack->clearStatus());
     }
     APIDebug("LonClearStatus = %d\n", sts);
     return sts;
 }
 
+const LonApiError LonClearStatus(void)
+{
+    return LonCtxClearStatus(&theDefaultStack);
+}
+
 /*
  *  Function: LonNvdAppSegmentHasBeenUpdated
  *  Informs the IzoT stack that the application data segment has been updated.  
@@ -1917,17 +2361,22 @@ const LonApiError LonClearStatus(void)
  *  guardBand timeout has expired.  
  *    This function is part of the non-volatile data API.
  */
-FTXL_EXTERNAL_FN const LonApiError LonNvdAppSegmentHasBeenUpdated(void)
+FTXL_EXTERNAL_FN const LonApiError LonCtxNvdAppSegmentHasBeenUpdated(LonStackHandle hStack)
 {
-	LonApiError sts = checkInit();
+	LonApiError sts = checkInit(hStack);
 	if (LON_SUCCESS(sts))
 	{
-		sts = pMyStack->applSegmentHasBeenUpdated();
+		sts = hStack->pStack->applSegmentHasBeenUpdated();
 	}
     APIDebug("LonNvdAppSegmentHasBeenUpdated = %d\n", sts);
 	return sts;
 }
 
+FTXL_EXTERNAL_FN const LonApiError LonNvdAppSegmentHasBeenUpdated(void)
+{
+    return LonCtxNvdAppSegmentHasBeenUpdated(&theDefaultStack);
+}
+
 /*
  *  Function: LonNvdFlushData
  *  Flush all non-volatile data out to persistent storage.  
@@ -1940,17 +2389,22 @@ FTXL_EXTERNAL_FN const LonApiError LonNvdAppSegmentHasBeenUpdated(void)
  *  non-volatile data writes have been completed.  The application might do 
  *  this, for example, in response to a <LonNvdStarvation> event.
  */
-FTXL_EXTERNAL_FN const LonApiError LonNvdFlushData(void)
+FTXL_EXTERNAL_FN const LonApiError LonCtxNvdFlushData(LonStackHandle hStack)
 {
-	LonApiError sts = checkInit();
+	LonApiError sts = checkInit(hStack);
 	if (LON_SUCCESS(sts))
 	{
-		sts = pMyStack->flushNvd();
+		sts = hStack->pStack->flushNvd();
 	}
     APIDebug("LonNvdFlushData = %d\n", sts);
 	return sts;
 }
 
+FTXL_EXTERNAL_FN const LonApiError LonNvdFlushData(void)
+{
+    return LonCtxNvdFlushData(&theDefaultStack);
+}
+
 /*
  *  Function: LonNvdGetMaxSize
  *  Gets the number of bytes required to store persistence data
@@ -1967,9 +2421,9 @@ FTXL_EXTERNAL_FN const LonApiError LonNvdFlushData(void)
 FTXL_EXTERNAL_FN const int LonNvdGetMaxSize(LonNvdSegmentType segmentType)
 {
 	int size = 0;
-	if (LON_SUCCESS(checkCreated()))
+	if (LON_SUCCESS(checkCreated(&theDefaultStack)))
 	{
-        size = pMyStack->nvdGetMaxSize(segmentType);
+        size = theDefaultStack.pStack->nvdGetMaxSize(segmentType);
     }
     APIDebug("LonNvdGetMaxSize = %d, size = %d\n", LonApiNoError, size);
 	return size;
@@ -2010,6 +2464,40 @@ FTXL_EXTERNAL_FN const LonApiError LonRegisterUniqueId(const LonUniqueId* const
     return sts;
 }
 
+/*
+ *  Function: LonCtxRegisterUniqueId
+ *  Registers the unique ID (Neuron ID) of the stack owned by a handle.
+ *
+ *  Remarks:
+ *  Must be called before <LonCtxLidCreateStack>.  A stack created from a 
+ *  handle other than the default one gets a random unique ID if none is
+ *  registered.  The ID is kept with the handle, not in the NVD folder.
+ */
+FTXL_EXTERNAL_FN const LonApiError LonCtxRegisterUniqueId(LonStackHandle hStack, const LonUniqueId* const pId)
+{
+    LonApiError sts = LonApiNoError;
+
+    if (hStack == NULL)
+    {
+        sts = LonApiNotInitialized;
+    }
+    else if (hStack == &theDefaultStack)
+    {
+        sts = LonRegisterUniqueId(pId);
+    }
+    else if (LON_SUCCESS(checkCreated(hStack)))
+    {
+        // This API must be called before the stack is created
+        sts = LonApiNotAllowed;
+    }
+    else if (pId != NULL)
+    {
+        hStack->uniqueId.set((const byte *)pId);
+    }
+    APIDebug("LonCtxRegisterUniqueId = %d\n", sts);
+    return sts;
+}
+
 /*
  *  Function: LonGetUniqueId
  *  Gets the register unique ID (Neuron ID).
@@ -2144,7 +2632,7 @@ FTXL_EXTERNAL_FN const LonApiError LonGetNvdFsPath(char* pFsPath, int maxLength)
  */
 FTXL_EXTERNAL_FN const LonApiError LonSetNvdFsPath(const char* pFsPath)
 {
-    LonApiError sts = checkCreated();
+    LonApiError sts = checkCreated(&theDefaultStack);
     if (LON_SUCCESS(sts))
     {
         // This API must be called before the stack is created
@@ -2159,6 +2647,37 @@ FTXL_EXTERNAL_FN const LonApiError LonSetNvdFsPath(const char* pFsPath)
     return sts;
 }
 
+/*
+ *  Function: LonCtxSetNvdFsPath
+ *  Sets the non-volatile data folder of the stack owned by a handle.  This API
+ *  must be called before <LonCtxLidCreateStack>.  Stacks without a folder of 
+ *  their own use the one returned by <LonGetNvdFsPath>.
+ */
+FTXL_EXTERNAL_FN const LonApiError LonCtxSetNvdFsPath(LonStackHandle hStack, const char* pFsPath)
+{
+    LonApiError sts = checkCreated(hStack);
+    if (hStack == NULL)
+    {
+        sts = LonApiNotInitialized;
+    }
+    else if (LON_SUCCESS(sts))
+    {
+        // This API must be called before the stack is created
+        sts = LonApiNotAllowed;
+    }
+    else if (pFsPath == NULL || strlen(pFsPath) >= sizeof(hStack->szNvdFsPath))
+    {
+        sts = LonApiInitializationFailure;
+    }
+    else
+    {
+        strcpy(hStack->szNvdFsPath, pFsPath);
+        sts = LonApiNoError;
+    }
+    APIDebug("LonCtxSetNvdFsPath = %d NVDPath = %s\n", sts, (pFsPath != NULL) ? pFsPath : "NULL");
+    return sts;
+}
+
 /*
  *  Function: LonResetPersistence
  *  Remove the persistence data files. This API must be called before the create stack <LonLidCreateStack>
@@ -2172,7 +2691,7 @@ FTXL_EXTERNAL_FN const LonApiError LonSetNvdFsPath(const char* pFsPath)
  */
 FTXL_EXTERNAL_FN const LonApiError LonResetPersistence(PersistenceResetType resetType)
 {
-    LonApiError sts = checkCreated();
+    LonApiError sts = checkCreated(&theDefaultStack);
 #if !PERSISTENCE_TYPE_IS(FTXL)
     sts = LonApiNotAllowed;
 #endif
@@ -2247,7 +2766,7 @@ FTXL_EXTERNAL_FN const LonApiError LonGetDeviceUri(char* pDeviceURI, int maxLeng
 
     if (LON_SUCCESS(sts))
     {
-        myDeviceUri.getData(pDeviceURI, maxLength);
+        theDefaultStack.deviceUri.getData(pDeviceURI, maxLength);
         APIDebug("LonGetDeviceUri = %s\n", pDeviceURI);
     }
     else
@@ -2304,20 +2823,24 @@ FTXL_EXTERNAL_FN const LonApiError LonGetDeviceUri(char* pDeviceURI, int maxLeng
  *  <LonApiError>.
  *
  */
-FTXL_EXTERNAL_FN const LonApiError LonSetDeviceUri(const char* pDeviceURI)
+FTXL_EXTERNAL_FN const LonApiError LonCtxSetDeviceUri(LonStackHandle hStack, const char* pDeviceURI)
 {
-    LonApiError sts = checkCreated();
-    if (LON_SUCCESS(sts))
+    LonApiError sts = checkCreated(hStack);
+    if (hStack == NULL)
+    {
+        sts = LonApiNotInitialized;
+    }
+    else if (LON_SUCCESS(sts))
     {
         // This API must be called before the stack is created
         sts = LonApiNotAllowed;
     }
     else
     {
-        if (myDeviceUri.setData(pDeviceURI))
+        if (hStack->deviceUri.setData(pDeviceURI))
         {
             char szURI[MAX_URI_LEN];
-            myDeviceUri.getData(szURI, MAX_URI_LEN);
+            hStack->deviceUri.getData(szURI, MAX_URI_LEN);
             sts = LonApiNoError;
             APIDebug("Device URI = \"%s\"\n", szURI);
         }
@@ -2328,6 +2851,11 @@ FTXL_EXTERNAL_FN const LonApiError LonSetDeviceUri(const char* pDeviceURI)
     return sts;
 }
 
+FTXL_EXTERNAL_FN const LonApiError LonSetDeviceUri(const char* pDeviceURI)
+{
+    return LonCtxSetDeviceUri(&theDefaultStack, pDeviceURI);
+}
+
 #endif
 
 /*
@@ -2376,10 +2904,10 @@ FTXL_EXTERNAL_FN void LonSetTracefile(const char* pFilename, LonBool append)
 FTXL_EXTERNAL_FN unsigned LonGetAppSignature()
 {
     unsigned signature = 0; 
-    LonApiError sts = checkCreated();
+    LonApiError sts = checkCreated(&theDefaultStack);
 
     if (LON_SUCCESS(sts))
-        signature = pMyStack->getAppSignature();
+        signature = theDefaultStack.pStack->getAppSignature();
 
     APIDebug("LonGetAppSignature = %d Signature = 0x%x\n", sts, signature);
     return signature;
@@ -2396,10 +2924,10 @@ FTXL_EXTERNAL_FN unsigned LonGetAppSignature()
 FTXL_EXTERNAL_FN unsigned LonGetAliasCount()
 {
     unsigned aliasCount = 0; 
-    LonApiError sts = checkCreated();
+    LonApiError sts = checkCreated(&theDefaultStack);
 
     if (LON_SUCCESS(sts))
-        aliasCount = pMyStack->getAliasCount();
+        aliasCount = theDefaultStack.pStack->getAliasCount();
 
     APIDebug("LonGetAliasCount = %d Count = %d\n", sts, aliasCount);
     return aliasCount;
@@ -2416,15 +2944,37 @@ FTXL_EXTERNAL_FN unsigned LonGetAliasCount()
 FTXL_EXTERNAL_FN unsigned LonGetAddressTableCount()
 {
     unsigned addrTableCount = 0; 
-    LonApiError sts = checkCreated();
+    LonApiError sts = checkCreated(&theDefaultStack);
 
     if (LON_SUCCESS(sts))
-        addrTableCount = pMyStack->getAddressTableCount();
+        addrTableCount = theDefaultStack.pStack->getAddressTableCount();
 
     APIDebug("LonGetAddrTableCount = %d Count = %d\n", sts, addrTableCount);
     return addrTableCount;
 }
 
+/*
+ *  Function: LonGetConfigChangeCount
+ *  Gets the configuration change count
+ *  
+ *  Returns:     
+ *  A count which advances whenever the network image is stored or restored.
+ */
+FTXL_EXTERNAL_FN unsigned LonCtxGetConfigChangeCount(LonStackHandle hStack)
+{
+    unsigned changeCount = 0; 
+
+    if (LON_SUCCESS(checkCreated(hStack)))
+        changeCount = (unsigned)hStack->pStack->getNetworkImage()->getChangeCount();
+
+    return changeCount;
+}
+
+FTXL_EXTERNAL_FN unsigned LonGetConfigChangeCount()
+{
+    return LonCtxGetConfigChangeCount(&theDefaultStack);
+}
+
 /*
  *  Function: LonGetStaticNVCount
  *  Gets the size of the address table
@@ -2436,10 +2986,10 @@ FTXL_EXTERNAL_FN unsigned LonGetAddressTableCount()
 FTXL_EXTERNAL_FN unsigned LonGetStaticNVCount()
 {
     unsigned staticNVCount = 0; 
-    LonApiError sts = checkCreated();
+    LonApiError sts = checkCreated(&theDefaultStack);
 
     if (LON_SUCCESS(sts))
-        staticNVCount = pMyStack->getStaticNetworkVariableCount();
+        staticNVCount = theDefaultStack.pStack->getStaticNetworkVariableCount();
 
     APIDebug("LonGetStaticNVCount = %d Count = %d\n", sts, staticNVCount);
     return staticNVCount;
@@ -2458,7 +3008,7 @@ FTXL_EXTERNAL_FN unsigned LonGetStaticNVCount()
  */
 FTXL_EXTERNAL_FN const LonApiError LonIsFirstRun(LonBool* const pIsFirstRun)
 {
-	LonApiError sts = checkCreated();
+	LonApiError sts = checkCreated(&theDefaultStack);
 	*pIsFirstRun = true;
     if (LON_SUCCESS(sts))
 	{		
@@ -2484,11 +3034,11 @@ FTXL_EXTERNAL_FN const LonApiError LonIsFirstRun(LonBool* const pIsFirstRun)
 FTXL_EXTERNAL_FN const int LonGetSIDataLength()
 {
     int dataLength = 0;
-    LonApiError sts = checkCreated();
+    LonApiError sts = checkCreated(&theDefaultStack);
 
     if (LON_SUCCESS(sts))
     {
-       dataLength =  pMyStack->getSiDataLength();
+       dataLength =  theDefaultStack.pStack->getSiDataLength();
        APIDebug("End LonGetSIDataLength - Length = %d\n", dataLength);
     }
     else
@@ -2516,18 +3066,18 @@ FTXL_EXTERNAL_FN const int LonGetSIDataLength()
 FTXL_EXTERNAL_FN const LonApiError LonGetSIData(LonByte* pSIData, const int dataLen)
 {
     APIDebug("Start LonGetSIData\n");
-    LonApiError sts = checkCreated();
+    LonApiError sts = checkCreated(&theDefaultStack);
 
     if (LON_SUCCESS(sts))
     {
-        if ((pSIData == NULL) || (dataLen < pMyStack->getSiDataLength()))
+        if ((pSIData == NULL) || (dataLen < theDefaultStack.pStack->getSiDataLength()))
         {
             sts = LonApiNotAllowed; // Buffer is too small
         }
         else
         {
             int SIDataLen;
-            byte *pData = pMyStack->getSiData(&SIDataLen);
+            byte *pData = theDefaultStack.pStack->getSiData(&SIDataLen);
 
             if (SIDataLen == 0)
                 sts = LonApiNotAllowed;     // Value out of range
@@ -2578,11 +3128,11 @@ FTXL_EXTERNAL_FN const LonApiError LonGetDidFromLocalAddress(LonByte* pDomId, un
 {
     LonApiError sts = LonApiNoIpAddress;
 
-    if (pChannel != NULL)
+    if (theDefaultStack.pChannel != NULL)
     {
 		LontalkStackUriScheme chnlType;
 #if PRODUCT_IS(IZOT)
-		chnlType = myDeviceUri.getScheme();
+		chnlType = theDefaultStack.deviceUri.getScheme();
 #elif FEATURE_INCLUDED(IP852)
 		chnlType = IPUnicast;
 #else
@@ -2599,7 +3149,7 @@ FTXL_EXTERNAL_FN const LonApiError LonGetDidFromLocalAddress(LonByte* pDomId, un
 			// This will be used for ISI to determine the default domain and subnet/node Id
 			memset(&domain, 0, sizeof(LtDomain));
 			memset(currentIzoTIpAddr, 0, sizeof(currentIzoTIpAddr));
-			currentIzoTIpAddrLen = ((LtLtLogicalChannel *)pChannel)->queryIpAddr(domain, 0, 0,
+			currentIzoTIpAddrLen = ((LtLtLogicalChannel *)theDefaultStack.pChannel)->queryIpAddr(domain, 0, 0,
     			(LonByte *)&currentIzoTIpAddr);
 			if (currentIzoTIpAddrLen > 0)
 			{
@@ -2646,10 +3196,10 @@ FTXL_EXTERNAL_FN const LonApiError LonGetDidFromLocalAddress(LonByte* pDomId, un
 const unsigned GetDefaultCurrentNvSize(const unsigned index)
 {
     int size = 0;
-    LonApiError sts = checkCreated();
+    LonApiError sts = checkCreated(&theDefaultStack);
     if (LON_SUCCESS(sts))
     {
-        size = pMyStack->getCurrentNvSize(index);
+        size = theDefaultStack.pStack->getCurrentNvSize(index);
     }
     APIDebug("GetDefaultCurrentNvSize(Index %d) = %d Size = %d\n", index, sts, size);
     return size;
@@ -2674,10 +3224,10 @@ const unsigned GetDefaultApplicationSegmentSize()
 {
     unsigned nonVolatileNvData = 0;
 
-    LonApiError sts = checkCreated();
+    LonApiError sts = checkCreated(&theDefaultStack);
     if (LON_SUCCESS(sts))
     {
-        nonVolatileNvData = pMyStack->getDefaultApplicationSegmentSize();
+        nonVolatileNvData = theDefaultStack.pStack->getDefaultApplicationSegmentSize();
     }
     APIDebug("GetDefaultApplicationSegmentSize = %d Size = %d\n", sts, nonVolatileNvData);
     return nonVolatileNvData;
@@ -2690,10 +3240,10 @@ const unsigned GetDefaultApplicationSegmentSize()
  */
 const LonApiError DefaultSerializeSegment(LonBool toNvMemory, void* const pData, const size_t size)
 {
-    LonApiError sts = checkCreated();
+    LonApiError sts = checkCreated(&theDefaultStack);
     if (LON_SUCCESS(sts))
     {
-        pMyStack->defaultSerializeSegment(toNvMemory, pData, size);
+        theDefaultStack.pStack->defaultSerializeSegment(toNvMemory, pData, size);
     }
     APIDebug("DefaultSerializeSegment = %d\n", sts);
     return sts;
@@ -89,7 +89,7 @@ extern int CreateDirectoryTree	(const char* szPath);
  */
 
     /* Construct the full path name of an NVD file  */
-static void GetNvdDataFilePath(LonNvdSegmentType type, LonBool tx, char *buf, int bufSize);
+static void GetNvdDataFilePath(const char *pNvdFsPath, LonNvdSegmentType type, LonBool tx, char *buf, int bufSize);
 
      /* Translate a segment type to a name for NVD tracing. */
 static const char *GetNvdName(LonNvdSegmentType type);
@@ -108,11 +108,15 @@ static const char *GetNvdName(LonNvdSegmentType type);
  *  Construct the full path name of an NVD file based on the given path, <LonNvdSegmentType> 
  *  and whether it is a data file or transaction file.  
  */
-static void GetNvdDataFilePath(LonNvdSegmentType type, LonBool tx, char *buf, int bufSize)
+static void GetNvdDataFilePath(const char *pNvdFsPath, LonNvdSegmentType type, LonBool tx, char *buf, int bufSize)
 {
     char nvdFsPath[MAX_PATH];
 
-    LonGetNvdFsPath(nvdFsPath, sizeof(nvdFsPath));
+    // Prefer the folder of the stack whose data this is, if it has one.
+    if (pNvdFsPath != NULL && strlen(pNvdFsPath) < sizeof(nvdFsPath) - 1)
+        strcpy(nvdFsPath, pNvdFsPath);
+    else
+        LonGetNvdFsPath(nvdFsPath, sizeof(nvdFsPath));
     if (nvdFsPath[strlen(nvdFsPath)-1] != DIR_SEPARATOR_CHAR)
         strcat(nvdFsPath, DIR_SEPARATOR_STRING);
 
@@ -191,7 +195,7 @@ static const char *GetNvdName(LonNvdSegmentType type)
  *  application can invalidate a handle when <LonNvdClose> is called for that 
  *  handle.  
  */
-const LonNvdHandle DefaultNvdOpenForRead(const LonNvdSegmentType type)
+const LonNvdHandle DefaultNvdOpenForRead(const char* pNvdFsPath, const LonNvdSegmentType type)
 {
     FILE *fp;
     char path[MAX_PATH];
@@ -199,7 +203,7 @@ const LonNvdHandle DefaultNvdOpenForRead(const LonNvdSegmentType type)
     APIDebug("Start DefaultNvdOpenForRead(%s)\n", GetNvdName(type));
     
     /* Get the data file's full path name */
-    GetNvdDataFilePath(type, FALSE, path, sizeof(path));
+    GetNvdDataFilePath(pNvdFsPath, type, FALSE, path, sizeof(path));
 
     /* Open for read access. */
     fp = fopen(path, "rb");
@@ -229,7 +233,7 @@ const LonNvdHandle DefaultNvdOpenForRead(const LonNvdSegmentType type)
  *
  *  An error value is returned if the data cannot be written.
  */
-const LonNvdHandle DefaultNvdOpenForWrite(const LonNvdSegmentType type, const size_t size)
+const LonNvdHandle DefaultNvdOpenForWrite(const char* pNvdFsPath, const LonNvdSegmentType type, const size_t size)
 {
     FILE *fp;
     char path[MAX_PATH];
@@ -237,7 +241,7 @@ const LonNvdHandle DefaultNvdOpenForWrite(const LonNvdSegmentType type, const si
     APIDebug("Start DefaultNvdOpenForWrite(%s, %d)\n",  GetNvdName(type), size);
 
     /* Get the data file's full path name */
-    GetNvdDataFilePath(type, FALSE, path, sizeof(path));
+    GetNvdDataFilePath(pNvdFsPath, type, FALSE, path, sizeof(path));
 
     /* Open for write access. */
     fp = fopen(path, "wb");
@@ -288,17 +292,17 @@ void DefaultNvdClose(const LonNvdHandle handle)
  *  Note that this function can be called even if the segment does not exist.  
  *  It is not necessary for this function to actually destroy the data or free it.
  */ 
-void DefaultNvdDelete(const LonNvdSegmentType type)
+void DefaultNvdDelete(const char* pNvdFsPath, const LonNvdSegmentType type)
 {
     char path[MAX_PATH];
 
     APIDebug("DefaultNvdDelete(%s)\n", GetNvdName(type));
 
     /* Get the data file's full path name (.DAT) */
-    GetNvdDataFilePath(type, FALSE, path, sizeof(path));
+    GetNvdDataFilePath(pNvdFsPath, type, FALSE, path, sizeof(path));
     LtIpDeleteFile(path);
     /* Get the tx file's full path name (.TX) */
-    GetNvdDataFilePath(type, TRUE, path, sizeof(path));
+    GetNvdDataFilePath(pNvdFsPath, type, TRUE, path, sizeof(path));
     LtIpDeleteFile(path);
 }
 
@@ -416,7 +420,7 @@ const LonApiError DefaultNvdWrite (const LonNvdHandle handle,
  *  TRUE, the IzoT Device Stack API will discard the segment, otherwise, the IzoT 
  *  LonTalk API will attempt to read the persistent data. 
  */
-const LonBool DefaultNvdIsInTransaction(const LonNvdSegmentType type)
+const LonBool DefaultNvdIsInTransaction(const char* pNvdFsPath, const LonNvdSegmentType type)
 {
     /* inTransaction is set to TRUE.  Any error reading the transaction record 
      * will be interpreted as being in a transaction - that is, the data 
@@ -429,7 +433,7 @@ const LonBool DefaultNvdIsInTransaction(const LonNvdSegmentType type)
     APIDebug("Start DefaultNvdIsInTransaction(%s)\n",  GetNvdName(type));
 
     /* Get the transaction file's full path name */
-    GetNvdDataFilePath(type, TRUE, path, sizeof(path));
+    GetNvdDataFilePath(pNvdFsPath, type, TRUE, path, sizeof(path));
 
     /* Open the file for read access. */
     fp = fopen(path, "rb");
@@ -465,7 +469,7 @@ const LonBool DefaultNvdIsInTransaction(const LonNvdSegmentType type)
  *  the non-persistent image, and schedules writes to update the non-volatile 
  *  storage at a later time.  
  */
-const LonApiError DefaultNvdEnterTransaction(const LonNvdSegmentType type)
+const LonApiError DefaultNvdEnterTransaction(const char* pNvdFsPath, const LonNvdSegmentType type)
 {
     LonApiError sts = LonApiNvdFileError;
     char path[MAX_PATH];
@@ -474,7 +478,7 @@ const LonApiError DefaultNvdEnterTransaction(const LonNvdSegmentType type)
     APIDebug("Start DefaultNvdEnterTransaction(%s)\n", GetNvdName(type));
 
     /* Get the transaction file's full path name */
-    GetNvdDataFilePath(type, TRUE, path, sizeof(path));
+    GetNvdDataFilePath(pNvdFsPath, type, TRUE, path, sizeof(path));
 
     /* Open the file for write access. */
     fp = fopen(path, "wb");
@@ -506,7 +510,7 @@ const LonApiError DefaultNvdEnterTransaction(const LonNvdSegmentType type)
  *  This function is called by the IzoT Device Stack API after <LonNvdWrite> has 
  *  returned success and there are no further updates required.   
  */
-const LonApiError DefaultNvdExitTransaction(const LonNvdSegmentType type)
+const LonApiError DefaultNvdExitTransaction(const char* pNvdFsPath, const LonNvdSegmentType type)
 {
     LonApiError sts = LonApiNvdFileError;
     char path[MAX_PATH];
@@ -515,7 +519,7 @@ const LonApiError DefaultNvdExitTransaction(const LonNvdSegmentType type)
     APIDebug("Start DefaultNvdExitTransaction(%s)\n",  GetNvdName(type));
 
     /* Get the transaction file's full path name */
-    GetNvdDataFilePath(type, TRUE, path, sizeof(path));
+    GetNvdDataFilePath(pNvdFsPath, type, TRUE, path, sizeof(path));
 
     /* Open the file for write access. */
     fp = fopen(path, "wb");
@@ -21,9 +21,14 @@
 #include "FtxlStack.h"
 #include "vxlTarget.h" // For vxlSetReportEvent
 #include "tickLib.h"
+#if defined(linux)
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
 
 FtxlStack::FtxlStack(LtLogicalChannel* pChannel, 
-                     const LonControlData * const pControlData) :
+                     const LonControlData * const pControlData,
+                     LonStackContext* pContext) :
     LtAppNodeStack(pChannel, pControlData->ReceiveTransCount, pControlData->TransmitTransCount,
         pControlData->Buffers.ApplicationBuffers.NonPriorityMsgOutCount, 
         pControlData->Buffers.ApplicationBuffers.PriorityMsgOutCount),
@@ -45,6 +50,17 @@ FtxlStack::FtxlStack(LtLogicalChannel* pChannel,
     m_avgDynNvSdLength = 0;
 
     m_siData = NULL;
+
+    m_pContext = pContext;
+    m_eventFd = -1;
+#if !FEATURE_INCLUDED(MULTI_APP)
+    if (pContext != NULL && pContext->uniqueId.isSet())
+    {
+        // The unique ID is read when the application is registered, so
+        // it must be in place before createStack().
+        getPlatform()->setNodeUniqueId(pContext->uniqueId);
+    }
+#endif
 }
 
 FtxlStack::~FtxlStack()
@@ -57,6 +73,12 @@ FtxlStack::~FtxlStack()
     if (m_siData != NULL)
         delete[] m_siData;
     stopApp();
+#if defined(linux)
+    if (m_eventFd >= 0)
+    {
+        close(m_eventFd);
+    }
+#endif
 }
 
 const byte FtxlStack::m_commTabTable[NUM_FTXL_XCVR_TYPES][FTXL_NUM_COMM_BYTES] =
@@ -103,6 +125,20 @@ LonApiError FtxlStack::createStack(const LonStackInterfaceData* const pInterface
         m_nvdSegApplicationData.setNvdFsPath(pNvdFsPath);
         getPersistence()->setNvdFsPath(pNvdFsPath);
         getNetworkImage()->getPersistence()->setNvdFsPath(pNvdFsPath);
+#if PERSISTENCE_TYPE_IS(FTXL)
+        // Make the NVD callbacks for this stack through its handle, one
+        // sequence at a time, independently of any other stack.
+        if (m_pContext != NULL)
+        {
+            if (m_pContext->nvdMutex == NULL)
+            {
+                m_pContext->nvdMutex = semMCreate(SEM_Q_PRIORITY | SEM_INVERSION_SAFE);
+            }
+            m_nvdSegApplicationData.setNvdStack(m_pContext, m_pContext->nvdMutex);
+            getPersistence()->setNvdStack(m_pContext, m_pContext->nvdMutex);
+            getNetworkImage()->getPersistence()->setNvdStack(m_pContext, m_pContext->nvdMutex);
+        }
+#endif
         ltSts = registerApplication(0, this, 
                                     pInterface->DomainTblSize,
                                     pInterface->AddrTblSize,
@@ -308,10 +344,20 @@ void FtxlStack::stopApp()
     }
 }
 
-void FtxlStack::eventPump()
+boolean FtxlStack::eventPump(int nMaxApdus)
 {
+    boolean bMore = false;
 	if (m_isOpen)
 	{
+#if defined(linux)
+        if (m_eventFd >= 0)
+        {
+            // Consume the wakeup first, so that events posted while we run
+            // make the descriptor readable again.
+            eventfd_t count;
+            eventfd_read(m_eventFd, &count);
+        }
+#endif
         if (m_bNvdStarvedOut)
         {
             ULONG msec;
@@ -319,7 +365,7 @@ void FtxlStack::eventPump()
             msec = ticksToMs(tickGet() - m_expectedNvdStart);
             LonNvdStarvation((msec+500)/1000);
         }
-		processApplicationEvents();
+		bMore = processApplicationEvents(nMaxApdus);
         if (m_bServicePinHeld)
         {
             m_bServicePinHeld = false;
@@ -333,7 +379,30 @@ void FtxlStack::eventPump()
 #endif
             m_nPrevServiceLedState = m_nServiceLedState;
         }
+#if defined(linux)
+        if (bMore && m_eventFd >= 0)
+        {
+            // Out of budget; leave the descriptor readable for the rest.
+            eventfd_write(m_eventFd, 1);
+        }
+#endif
 	}
+    return bMore;
+}
+
+int FtxlStack::getEventFd(void)
+{
+#if defined(linux)
+    if (m_eventFd < 0)
+    {
+        // Start out readable, so events posted before the descriptor was
+        // requested are not missed.
+        m_eventFd = eventfd(1, EFD_NONBLOCK | EFD_CLOEXEC);
+    }
+    return m_eventFd;
+#else
+    return -1;
+#endif
 }
 
 LonApiError FtxlStack::storNetworkImage(void)
@@ -751,12 +820,12 @@ void FtxlStack::nvUpdateOccurs(LtNetworkVariable* pNv, int arrayIndex,
     GetRecieveAddress(receiveAddress, *address);
     if (isConfiguredAndOnline())
     {
-        LonNvUpdateOccurred(pNv->getNvIndex() + arrayIndex, &receiveAddress);
+        nvUpdateOccurred(pNv->getNvIndex() + arrayIndex, &receiveAddress);
     }
     if (pNv->getFlags() & NV_SD_CONFIG_CLASS)
     {
         /* Signal that the application non-volatile data has been changed */
-        LonNvdAppSegmentHasBeenUpdated();
+        applSegmentHasBeenUpdated();
     }
 }
 
@@ -775,7 +844,7 @@ void FtxlStack::nvUpdateOccurs(LtNetworkVariable* pNv, int arrayIndex,
  */
 void FtxlStack::nvUpdateCompletes(LtNetworkVariable* pNv, int arrayIndex, boolean success)
 {
-    LonNvUpdateCompleted(pNv->getNvIndex() + arrayIndex, success);
+    nvUpdateCompleted(pNv->getNvIndex() + arrayIndex, success);
 }
 
 /**
@@ -1017,7 +1086,7 @@ void FtxlStack::servicePinPushed()
 int FtxlStack::servicePinHeldTimeout(int pFtxlStack)
 {
     ((FtxlStack *)pFtxlStack)->m_bServicePinHeld = true;
-    LonEventReady();
+    ((FtxlStack *)pFtxlStack)->eventReady();
     return 0;
 }
 
@@ -1041,7 +1110,7 @@ void FtxlStack::servicePinHasBeenReleased()
      */
 void FtxlStack::applicationEventIsPending(void)
 {
-    LonEventReady();
+    eventReady();
 }
 
 /**
@@ -1071,7 +1140,7 @@ boolean FtxlStack::writeMemory(int address, byte* data, int length)
     if (LonMemoryWrite(address, length, data) == LonApiNoError)
     {
         /* Signal that the application non-volatile data has been changed */
-        LonNvdAppSegmentHasBeenUpdated();
+        applSegmentHasBeenUpdated();
         success = true;
     }
     else
@@ -1087,7 +1156,49 @@ boolean FtxlStack::writeMemory(int address, byte* data, int length)
 void FtxlStack::setServiceLedStatus(LtServicePinState state)
 {
     m_nServiceLedState = state;
-    LonEventReady();    
+    eventReady();    
+}
+
+void FtxlStack::eventReady(void)
+{
+#if defined(linux)
+    if (m_eventFd >= 0)
+    {
+        eventfd_write(m_eventFd, 1);
+    }
+#endif
+    if (m_pContext != NULL && m_pContext->callbacks.eventReady != NULL)
+    {
+        m_pContext->callbacks.eventReady(m_pContext->callbacks.pUserContext);
+    }
+    else
+    {
+        LonEventReady();
+    }
+}
+
+void FtxlStack::nvUpdateOccurred(const unsigned index, const LonReceiveAddress* const pSourceAddress)
+{
+    if (m_pContext != NULL && m_pContext->callbacks.nvUpdateOccurred != NULL)
+    {
+        m_pContext->callbacks.nvUpdateOccurred(m_pContext->callbacks.pUserContext, index, pSourceAddress);
+    }
+    else
+    {
+        LonNvUpdateOccurred(index, pSourceAddress);
+    }
+}
+
+void FtxlStack::nvUpdateCompleted(const unsigned index, const LonBool success)
+{
+    if (m_pContext != NULL && m_pContext->callbacks.nvUpdateCompleted != NULL)
+    {
+        m_pContext->callbacks.nvUpdateCompleted(m_pContext->callbacks.pUserContext, index, success);
+    }
+    else
+    {
+        LonNvUpdateCompleted(index, success);
+    }
 }
 
 /*
@@ -1195,11 +1306,11 @@ void FtxlStack::defaultSerializeSegment(boolean toNvMemory, void* const pData, c
         {
             if (toNvMemory)
             {
-                (void)memcpy(pNvd+offset, (void* const)LonGetNvValue(index), pNv->getCurLength() * pNv->getElementCount());
+                (void)memcpy(pNvd+offset, (void* const)pNv->getNvDataPtr(arrayIndex), pNv->getCurLength() * pNv->getElementCount());
             }
             else
             {
-                (void)memcpy((void* const)LonGetNvValue(index), pNvd+offset, pNv->getCurLength() * pNv->getElementCount());
+                (void)memcpy((void* const)pNv->getNvDataPtr(arrayIndex), pNvd+offset, pNv->getCurLength() * pNv->getElementCount());
             }
             offset += (pNv->getCurLength() * pNv->getElementCount());
         }
@@ -1234,7 +1345,7 @@ void FtxlStack::notifyNvdComplete(void)
 int FtxlStack::nvdStarvationTimeout(int pFtxlStack)
 {
     ((FtxlStack *)pFtxlStack)->m_bNvdStarvedOut = true;
-    LonEventReady();
+    ((FtxlStack *)pFtxlStack)->eventReady();
     return 0;
 }
 
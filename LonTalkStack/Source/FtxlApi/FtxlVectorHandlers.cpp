@@ -47,11 +47,11 @@ LonCallbackVectors theLonCallbackVectors;
 #endif
 
 #ifdef USE_DEFAULT_IMPLEMENTATION
-FTXL_EXTERNAL_FN const LonNvdHandle DefaultNvdOpenForRead(const LonNvdSegmentType type);
-FTXL_EXTERNAL_FN const LonNvdHandle DefaultNvdOpenForWrite(const LonNvdSegmentType type, 
+FTXL_EXTERNAL_FN const LonNvdHandle DefaultNvdOpenForRead(const char* pNvdFsPath, const LonNvdSegmentType type);
+FTXL_EXTERNAL_FN const LonNvdHandle DefaultNvdOpenForWrite(const char* pNvdFsPath, const LonNvdSegmentType type, 
                                       const size_t size);
 FTXL_EXTERNAL_FN void DefaultNvdClose(const LonNvdHandle handle);
-FTXL_EXTERNAL_FN void DefaultNvdDelete(const LonNvdSegmentType type);
+FTXL_EXTERNAL_FN void DefaultNvdDelete(const char* pNvdFsPath, const LonNvdSegmentType type);
 FTXL_EXTERNAL_FN const LonApiError DefaultNvdRead(const LonNvdHandle handle, 
 					         const size_t offset, 
 					         const size_t size, 
@@ -60,9 +60,9 @@ FTXL_EXTERNAL_FN const LonApiError DefaultNvdWrite (const LonNvdHandle handle,
                                const size_t offset, 
                                const size_t size, 
                                const void* const pData); 
-FTXL_EXTERNAL_FN const LonBool DefaultNvdIsInTransaction(const LonNvdSegmentType type);
-FTXL_EXTERNAL_FN const LonApiError DefaultNvdEnterTransaction(const LonNvdSegmentType type);
-FTXL_EXTERNAL_FN const LonApiError DefaultNvdExitTransaction(const LonNvdSegmentType type);
+FTXL_EXTERNAL_FN const LonBool DefaultNvdIsInTransaction(const char* pNvdFsPath, const LonNvdSegmentType type);
+FTXL_EXTERNAL_FN const LonApiError DefaultNvdEnterTransaction(const char* pNvdFsPath, const LonNvdSegmentType type);
+FTXL_EXTERNAL_FN const LonApiError DefaultNvdExitTransaction(const char* pNvdFsPath, const LonNvdSegmentType type);
 #endif
 
 /*
@@ -1031,9 +1031,24 @@ LonMemoryWriteRegistrar(LonMemoryWriteFunction handler)
  *  application can invalidate a handle when <LonNvdClose> is called for that 
  *  handle.  
  */
-const LonNvdHandle LonNvdOpenForRead(const LonNvdSegmentType type)
+const LonNvdHandle NvdOpenForRead(LonStackHandle hStack, const char* pNvdFsPath, const LonNvdSegmentType type)
 {
-    if (theLonCallbackVectors.nvdOpenForRead)
+    const LonCtxCallbacks* pCallbacks = GetStackCallbacks(hStack);
+
+    if (pCallbacks != NULL && pCallbacks->nvdOpenForRead != NULL)
+    {
+        try
+        {
+            CALLBACK_EXEC("LonNvdOpenForRead");
+            return pCallbacks->nvdOpenForRead(pCallbacks->pUserContext, hStack, type);
+        }
+        catch (...)
+        {
+            CALLBACK_EXCEPTION("LonNvdOpenForRead");
+            return 0;
+        }
+    }
+    else if (theLonCallbackVectors.nvdOpenForRead)
     {
         try
         {
@@ -1051,7 +1066,7 @@ const LonNvdHandle LonNvdOpenForRead(const LonNvdSegmentType type)
 #ifdef USE_DEFAULT_IMPLEMENTATION
         // Execute default implementation 
         CALLBACK_NOT_REGISTERED_DEF("LonNvdOpenForRead");
-        return DefaultNvdOpenForRead(type);
+        return DefaultNvdOpenForRead(pNvdFsPath, type);
 #else
     
         CALLBACK_NOT_REGISTERED("LonNvdOpenForRead");
@@ -1060,6 +1075,11 @@ const LonNvdHandle LonNvdOpenForRead(const LonNvdSegmentType type)
     }
 }
 
+const LonNvdHandle LonNvdOpenForRead(const LonNvdSegmentType type)
+{
+    return NvdOpenForRead(NULL, NULL, type);
+}
+
 FTXL_EXTERNAL_FN const LonApiError
 LonNvdOpenForReadRegistrar(LonNvdOpenForReadFunction handler)
 {
@@ -1088,10 +1108,25 @@ LonNvdOpenForReadRegistrar(LonNvdOpenForReadFunction handler)
  *
  *  An error value is returned if the data cannot be written.
  */
-const LonNvdHandle LonNvdOpenForWrite(const LonNvdSegmentType type, 
+const LonNvdHandle NvdOpenForWrite(LonStackHandle hStack, const char* pNvdFsPath, const LonNvdSegmentType type, 
                                       const size_t size)
 {
-    if (theLonCallbackVectors.nvdOpenForWrite)
+    const LonCtxCallbacks* pCallbacks = GetStackCallbacks(hStack);
+
+    if (pCallbacks != NULL && pCallbacks->nvdOpenForWrite != NULL)
+    {
+        try
+        {
+            CALLBACK_EXEC("LonNvdOpenForWrite");
+            return pCallbacks->nvdOpenForWrite(pCallbacks->pUserContext, hStack, type, size);
+        }
+        catch (...)
+        {
+            CALLBACK_EXCEPTION("LonNvdOpenForWrite");
+            return 0;
+        }
+    }
+    else if (theLonCallbackVectors.nvdOpenForWrite)
     {
         try
         {
@@ -1109,7 +1144,7 @@ const LonNvdHandle LonNvdOpenForWrite(const LonNvdSegmentType type,
 #ifdef USE_DEFAULT_IMPLEMENTATION
         // Execute default implementation 
         CALLBACK_NOT_REGISTERED_DEF("LonNvdOpenForWrite");
-        return DefaultNvdOpenForWrite(type, size);
+        return DefaultNvdOpenForWrite(pNvdFsPath, type, size);
 #else
         CALLBACK_NOT_REGISTERED("LonNvdOpenForWrite");
         return 0;
@@ -1117,6 +1152,12 @@ const LonNvdHandle LonNvdOpenForWrite(const LonNvdSegmentType type,
     }
 }
 
+const LonNvdHandle LonNvdOpenForWrite(const LonNvdSegmentType type, 
+                                      const size_t size)
+{
+    return NvdOpenForWrite(NULL, NULL, type, size);
+}
+
 FTXL_EXTERNAL_FN const LonApiError
 LonNvdOpenForWriteRegistrar(LonNvdOpenForWriteFunction handler)
 {
@@ -1138,9 +1179,23 @@ LonNvdOpenForWriteRegistrar(LonNvdOpenForWriteFunction handler)
  *  This function closes the non-volatile memory segment associated with this 
  *  handle and invalidates the handle. 
  */
-void LonNvdClose(const LonNvdHandle handle)
+void NvdClose(LonStackHandle hStack, const LonNvdHandle handle)
 {
-    if (theLonCallbackVectors.nvdClose)
+    const LonCtxCallbacks* pCallbacks = GetStackCallbacks(hStack);
+
+    if (pCallbacks != NULL && pCallbacks->nvdClose != NULL)
+    {
+        try
+        {
+            CALLBACK_EXEC("LonNvdClose");
+            pCallbacks->nvdClose(pCallbacks->pUserContext, hStack, handle);
+        }
+        catch (...)
+        {
+            CALLBACK_EXCEPTION("LonNvdClose");
+        }
+    }
+    else if (theLonCallbackVectors.nvdClose)
     {
         try
         {
@@ -1164,6 +1219,11 @@ void LonNvdClose(const LonNvdHandle handle)
     }
 }
 
+void LonNvdClose(const LonNvdHandle handle)
+{
+    NvdClose(NULL, handle);
+}
+
 FTXL_EXTERNAL_FN const LonApiError
 LonNvdCloseRegistrar(LonNvdCloseFunction handler)
 {
@@ -1188,9 +1248,23 @@ LonNvdCloseRegistrar(LonNvdCloseFunction handler)
  *  Note that this function can be called even if the segment does not exist.  
  *  It is not necessary for this function to actually destroy the data or free it.
  */
-void LonNvdDelete(const LonNvdSegmentType type)
+void NvdDelete(LonStackHandle hStack, const char* pNvdFsPath, const LonNvdSegmentType type)
 {
-    if (theLonCallbackVectors.nvdDelete)
+    const LonCtxCallbacks* pCallbacks = GetStackCallbacks(hStack);
+
+    if (pCallbacks != NULL && pCallbacks->nvdDelete != NULL)
+    {
+        try
+        {
+            CALLBACK_EXEC("LonNvdDelete");
+            pCallbacks->nvdDelete(pCallbacks->pUserContext, hStack, type);
+        }
+        catch (...)
+        {
+            CALLBACK_EXCEPTION("LonNvdDelete");
+        }
+    }
+    else if (theLonCallbackVectors.nvdDelete)
     {
         try
         {
@@ -1207,13 +1281,18 @@ void LonNvdDelete(const LonNvdSegmentType type)
 #ifdef USE_DEFAULT_IMPLEMENTATION
         // Execute default implementation 
         CALLBACK_NOT_REGISTERED_DEF("LonNvdDelete");
-        DefaultNvdDelete(type);
+        DefaultNvdDelete(pNvdFsPath, type);
 #else
         CALLBACK_NOT_REGISTERED("LonNvdDelete");
 #endif
     }
 }
 
+void LonNvdDelete(const LonNvdSegmentType type)
+{
+    NvdDelete(NULL, NULL, type);
+}
+
 FTXL_EXTERNAL_FN const LonApiError
 LonNvdDeleteRegistrar(LonNvdDeleteFunction handler)
 {
@@ -1242,12 +1321,27 @@ LonNvdDeleteRegistrar(LonNvdDeleteFunction handler)
  *  the segment. The offset in each subsequent call will be incremented by
  *  the size of the previous call.
  */
-const LonApiError LonNvdRead(const LonNvdHandle handle, 
+const LonApiError NvdRead(LonStackHandle hStack, const LonNvdHandle handle, 
 					         const size_t offset, 
 					         const size_t size, 
-					         void * const pBuffer) 
+					         void * const pBuffer)
 {
-    if (theLonCallbackVectors.nvdRead)
+    const LonCtxCallbacks* pCallbacks = GetStackCallbacks(hStack);
+
+    if (pCallbacks != NULL && pCallbacks->nvdRead != NULL)
+    {
+        try
+        {
+            CALLBACK_EXEC("LonNvdRead");
+            return pCallbacks->nvdRead(pCallbacks->pUserContext, hStack, handle, offset, size, pBuffer );
+        }
+        catch (...)
+        {
+            CALLBACK_EXCEPTION("LonNvdRead");
+            return LonApiCallbackExceptionError; 
+        }
+    }
+    else if (theLonCallbackVectors.nvdRead)
     {
         try
         {
@@ -1273,6 +1367,14 @@ const LonApiError LonNvdRead(const LonNvdHandle handle,
     }
 }
 
+const LonApiError LonNvdRead(const LonNvdHandle handle, 
+					         const size_t offset, 
+					         const size_t size, 
+					         void * const pBuffer)
+{
+    return NvdRead(NULL, handle, offset, size, pBuffer);
+}
+
 FTXL_EXTERNAL_FN const LonApiError
 LonNvdReadRegistrar(LonNvdReadFunction handler)
 {
@@ -1302,12 +1404,27 @@ LonNvdReadRegistrar(LonNvdReadFunction handler)
  *  the segment. The offset in each subsequent call will be incremented by
  *  the size of the previous call.
  */
-const LonApiError LonNvdWrite (const LonNvdHandle handle, 
+const LonApiError NvdWrite(LonStackHandle hStack, const LonNvdHandle handle, 
                                const size_t offset, 
                                const size_t size, 
-                               const void* const pData) 
+                               const void* const pData)
 {
-    if (theLonCallbackVectors.nvdWrite)
+    const LonCtxCallbacks* pCallbacks = GetStackCallbacks(hStack);
+
+    if (pCallbacks != NULL && pCallbacks->nvdWrite != NULL)
+    {
+        try
+        {
+            CALLBACK_EXEC("LonNvdWrite");
+            return pCallbacks->nvdWrite(pCallbacks->pUserContext, hStack, handle, offset, size, pData );
+        }
+        catch (...)
+        {
+            CALLBACK_EXCEPTION("LonNvdWrite");
+            return LonApiCallbackExceptionError; 
+        }
+    }
+    else if (theLonCallbackVectors.nvdWrite)
     {
         try
         {
@@ -1333,6 +1450,14 @@ const LonApiError LonNvdWrite (const LonNvdHandle handle,
     }
 }
 
+const LonApiError LonNvdWrite(const LonNvdHandle handle, 
+                               const size_t offset, 
+                               const size_t size, 
+                               const void* const pData)
+{
+    return NvdWrite(NULL, handle, offset, size, pData);
+}
+
 FTXL_EXTERNAL_FN const LonApiError
 LonNvdWriteRegistrar(LonNvdWriteFunction handler)
 {
@@ -1357,9 +1482,24 @@ LonNvdWriteRegistrar(LonNvdWriteFunction handler)
  *  TRUE, the IzoT Device Stack API will discard the segment, otherwise, the IzoT 
  *  Device Stack API will attempt to read the persistent data. 
  */
-const LonBool LonNvdIsInTransaction(const LonNvdSegmentType type)
+const LonBool NvdIsInTransaction(LonStackHandle hStack, const char* pNvdFsPath, const LonNvdSegmentType type)
 {
-    if (theLonCallbackVectors.nvdIsInTransaction)
+    const LonCtxCallbacks* pCallbacks = GetStackCallbacks(hStack);
+
+    if (pCallbacks != NULL && pCallbacks->nvdIsInTransaction != NULL)
+    {
+        try
+        {
+            CALLBACK_EXEC("LonNvdIsInTransaction");
+            return pCallbacks->nvdIsInTransaction(pCallbacks->pUserContext, hStack, type);
+        }
+        catch (...)
+        {
+            CALLBACK_EXCEPTION("LonNvdIsInTransaction");
+            return false;
+        }
+    }
+    else if (theLonCallbackVectors.nvdIsInTransaction)
     {
         try
         {
@@ -1377,7 +1517,7 @@ const LonBool LonNvdIsInTransaction(const LonNvdSegmentType type)
 #ifdef USE_DEFAULT_IMPLEMENTATION
         // Execute default implementation 
         CALLBACK_NOT_REGISTERED_DEF("LonNvdIsInTransaction");
-        return DefaultNvdIsInTransaction(type);
+        return DefaultNvdIsInTransaction(pNvdFsPath, type);
 #else
         CALLBACK_NOT_REGISTERED("LonNvdIsInTransaction");
         return LonApiCallbackNotRegistered;
@@ -1385,6 +1525,11 @@ const LonBool LonNvdIsInTransaction(const LonNvdSegmentType type)
     }
 }
 
+const LonBool LonNvdIsInTransaction(const LonNvdSegmentType type)
+{
+    return NvdIsInTransaction(NULL, NULL, type);
+}
+
 FTXL_EXTERNAL_FN const LonApiError
 LonNvdIsInTransactionRegistrar(LonNvdIsInTransactionFunction handler)
 {
@@ -1407,9 +1552,24 @@ LonNvdIsInTransactionRegistrar(LonNvdIsInTransactionFunction handler)
  *  the non-persistent image, and schedules writes to update the non-volatile 
  *  storage at a later time.  
  */
-const LonApiError LonNvdEnterTransaction(const LonNvdSegmentType type)
+const LonApiError NvdEnterTransaction(LonStackHandle hStack, const char* pNvdFsPath, const LonNvdSegmentType type)
 {
-    if (theLonCallbackVectors.nvdEnterTransaction)
+    const LonCtxCallbacks* pCallbacks = GetStackCallbacks(hStack);
+
+    if (pCallbacks != NULL && pCallbacks->nvdEnterTransaction != NULL)
+    {
+        try
+        {
+            CALLBACK_EXEC("LonNvdEnterTransaction");
+            return pCallbacks->nvdEnterTransaction(pCallbacks->pUserContext, hStack, type);
+        }
+        catch (...)
+        {
+            CALLBACK_EXCEPTION("LonNvdEnterTransaction");
+            return LonApiCallbackExceptionError; 
+        }
+    }
+    else if (theLonCallbackVectors.nvdEnterTransaction)
     {
         try
         {
@@ -1427,7 +1587,7 @@ const LonApiError LonNvdEnterTransaction(const LonNvdSegmentType type)
 #ifdef USE_DEFAULT_IMPLEMENTATION
         // Execute default implementation 
         CALLBACK_NOT_REGISTERED_DEF("LonNvdEnterTransaction");
-        return DefaultNvdEnterTransaction(type); 
+        return DefaultNvdEnterTransaction(pNvdFsPath, type); 
 #else
         CALLBACK_NOT_REGISTERED("LonNvdEnterTransaction");
         return LonApiCallbackNotRegistered;
@@ -1435,6 +1595,11 @@ const LonApiError LonNvdEnterTransaction(const LonNvdSegmentType type)
     }
 }
 
+const LonApiError LonNvdEnterTransaction(const LonNvdSegmentType type)
+{
+    return NvdEnterTransaction(NULL, NULL, type);
+}
+
 FTXL_EXTERNAL_FN const LonApiError
 LonNvdEnterTransactionRegistrar(LonNvdEnterTransactionFunction handler)
 {
@@ -1455,9 +1620,24 @@ LonNvdEnterTransactionRegistrar(LonNvdEnterTransactionFunction handler)
  *  This function is called by the IzoT Device Stack API after <LonNvdWrite> has 
  *  returned success and there are no further updates required.   
  */
-const LonApiError LonNvdExitTransaction(const LonNvdSegmentType type)
+const LonApiError NvdExitTransaction(LonStackHandle hStack, const char* pNvdFsPath, const LonNvdSegmentType type)
 {
-    if (theLonCallbackVectors.nvdExitTransaction)
+    const LonCtxCallbacks* pCallbacks = GetStackCallbacks(hStack);
+
+    if (pCallbacks != NULL && pCallbacks->nvdExitTransaction != NULL)
+    {
+        try
+        {
+            CALLBACK_EXEC("LonNvdExitTransaction");
+            return pCallbacks->nvdExitTransaction(pCallbacks->pUserContext, hStack, type);
+        }
+        catch (...)
+        {
+            CALLBACK_EXCEPTION("LonNvdExitTransaction");
+            return LonApiCallbackExceptionError; 
+        }
+    }
+    else if (theLonCallbackVectors.nvdExitTransaction)
     {
         try
         {
@@ -1475,7 +1655,7 @@ const LonApiError LonNvdExitTransaction(const LonNvdSegmentType type)
 #ifdef USE_DEFAULT_IMPLEMENTATION
         // Execute default implementation 
         CALLBACK_NOT_REGISTERED_DEF("LonNvdExitTransaction");
-        return DefaultNvdExitTransaction(type); 
+        return DefaultNvdExitTransaction(pNvdFsPath, type); 
 #else
         CALLBACK_NOT_REGISTERED("LonNvdExitTransaction");
         return LonApiCallbackNotRegistered;
@@ -1483,6 +1663,11 @@ const LonApiError LonNvdExitTransaction(const LonNvdSegmentType type)
     }
 }
 
+const LonApiError LonNvdExitTransaction(const LonNvdSegmentType type)
+{
+    return NvdExitTransaction(NULL, NULL, type);
+}
+
 FTXL_EXTERNAL_FN const LonApiError
 LonNvdExitTransactionRegistrar(LonNvdExitTransactionFunction handler)
 {
@@ -59,6 +59,26 @@ const unsigned GetDefaultCurrentNvSize(const unsigned index);
 const unsigned GetDefaultApplicationSegmentSize();
 const LonApiError DefaultSerializeSegment(LonBool toNvMemory, void* const pData, const size_t size);
 
+// The callbacks given when the handle was created, or NULL for no handle.
+const LonCtxCallbacks* GetStackCallbacks(LonStackHandle hStack);
+
+// The NVD callbacks of a stack.  Each calls the stack's handle callback if it
+// has one, else the registered callback, else the default handler, which
+// keeps the data in pNvdFsPath (NULL: the LonGetNvdFsPath folder).  hStack is
+// NULL for the default stack.
+const LonNvdHandle NvdOpenForRead(LonStackHandle hStack, const char* pNvdFsPath, const LonNvdSegmentType type);
+const LonNvdHandle NvdOpenForWrite(LonStackHandle hStack, const char* pNvdFsPath, const LonNvdSegmentType type,
+                                   const size_t size);
+void NvdClose(LonStackHandle hStack, const LonNvdHandle handle);
+void NvdDelete(LonStackHandle hStack, const char* pNvdFsPath, const LonNvdSegmentType type);
+const LonApiError NvdRead(LonStackHandle hStack, const LonNvdHandle handle, const size_t offset,
+                          const size_t size, void* const pBuffer);
+const LonApiError NvdWrite(LonStackHandle hStack, const LonNvdHandle handle, const size_t offset,
+                           const size_t size, const void* const pData);
+const LonBool NvdIsInTransaction(LonStackHandle hStack, const char* pNvdFsPath, const LonNvdSegmentType type);
+const LonApiError NvdEnterTransaction(LonStackHandle hStack, const char* pNvdFsPath, const LonNvdSegmentType type);
+const LonApiError NvdExitTransaction(LonStackHandle hStack, const char* pNvdFsPath, const LonNvdSegmentType type);
+
 #ifdef  __cplusplus
 }
 #endif
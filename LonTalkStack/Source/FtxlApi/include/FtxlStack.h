@@ -24,6 +24,9 @@
 #include "LtStackInternal.h"
 #include "LtStart.h"
 #include "FtxlApiInternal.h"
+#if PRODUCT_IS(IZOT)
+#include "LtUri.h"
+#endif
 
 #define NVD_SEG_VER_APPL_DATA      0 
 
@@ -41,6 +44,7 @@ public:
 
 #if PERSISTENCE_TYPE_IS(FTXL)
     void setAppSignature(unsigned appSignature) { m_persistence.setAppSignature(appSignature); }
+    void setNvdStack(LonStackHandle hStack, SEM_ID nvdMutex) { m_persistence.setNvdStack(hStack, nvdMutex); }
 #endif
 
     void setPeristenceGaurdBand(int flushGuardTimeout) { m_persistence.setHoldTime(flushGuardTimeout); }
@@ -61,7 +65,8 @@ class  FtxlStack : public LtAppNodeStack, public LtApplication
 {
 public:
     FtxlStack(LtLogicalChannel* pChannel, 
-              const LonControlData * const pControlData);
+              const LonControlData * const pControlData,
+              LonStackContext* pContext = NULL);
     virtual ~FtxlStack();
 
     LonApiError createStack(const LonStackInterfaceData* const pInterface,
@@ -72,7 +77,11 @@ public:
 
     void stopApp();
 
-    void eventPump(void);
+    // Returns true if incoming events remain after nMaxApdus (0 for no limit).
+    boolean eventPump(int nMaxApdus = 0);
+
+    // Descriptor signalled whenever eventReady() is, or -1 if not supported.
+    int getEventFd(void);
 
 	LonApiError applSegmentHasBeenUpdated(void);
     LonApiError flushNvd(void);
@@ -331,6 +340,12 @@ public:
 
 private:
     static int servicePinHeldTimeout(int pFtxlStack);
+
+    // Deliver callbacks to the owning handle, or to the global callbacks
+    // if it has none.
+    void eventReady(void);
+    void nvUpdateOccurred(const unsigned index, const LonReceiveAddress* const pSourceAddress);
+    void nvUpdateCompleted(const unsigned index, const LonBool success);
     static int nvdStarvationTimeout(int pFtxlStack);
 
     LonApiError storNetworkImage(void);
@@ -355,5 +370,33 @@ private:
     LtServicePinState   m_nPrevServiceLedState;
 
     byte *m_siData;     // SI data array
+
+    LonStackContext *m_pContext;    // Owning handle, NULL if none
+    int     m_eventFd;                  // eventfd created by getEventFd(), -1 if none
+};
+
+// State behind a LonStackHandle.  The handle-less API uses a default instance.
+struct LonStackContext
+{
+    LonStackContext()
+    {
+        pStack = NULL;
+        pChannel = NULL;
+        stackStarted = false;
+        memset(&callbacks, 0, sizeof(callbacks));
+        szNvdFsPath[0] = '\0';
+        nvdMutex = NULL;
+    }
+
+    FtxlStack           *pStack;
+    LtLogicalChannel    *pChannel;
+    boolean             stackStarted;
+    LonCtxCallbacks     callbacks;
+#if PRODUCT_IS(IZOT)
+    LtUri               deviceUri;
+#endif
+    LtUniqueId          uniqueId;                   // Not set: use the process-wide ID
+    char                szNvdFsPath[MAX_PATH];      // Empty: use LonGetNvdFsPath
+    SEM_ID              nvdMutex;                   // Held across each NVD callback sequence
 };
 #endif
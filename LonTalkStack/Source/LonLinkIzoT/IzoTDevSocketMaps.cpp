@@ -78,6 +78,7 @@ void IzotUnicastAddress::close(void)
     m_useCount = 0;
     m_ipAddrLen = 0;
     m_isBound = false;
+    m_port = 0;
     memset(m_ipAddress, 0, sizeof(m_ipAddress));
     memset(m_szIpAddress, 0, sizeof(m_szIpAddress));
 }
@@ -171,24 +172,75 @@ IzotUnicastAddresses::IzotUnicastAddresses(SEM_ID lock, int count, int reallocSi
     m_numEntries = count;
     m_map = new IzotUnicastAddress[count];
     m_reallocSize = reallocSize;
+    m_pIndex = NULL;
+    m_pSpare = NULL;
+    m_indexSeq = 0;
+    m_pRetired = NULL;
+    m_lastFound = IZOT_NULL_SOCKET_INDEX;
+    m_generation = 0;
+    rebuildIndex();
 }
 
 IzotUnicastAddresses::~IzotUnicastAddresses(void)
 {
     delete[] m_map;
+    retireIndex(m_pIndex);
+    retireIndex(m_pSpare);
+    while (m_pRetired != NULL)
+    {
+        Index *pIndex = m_pRetired;
+        m_pRetired = pIndex->pNextRetired;
+        delete[] pIndex->heads;
+        delete[] pIndex->entries;
+        delete pIndex;
+    }
 }
 
 // Return the socket index corresponding to the specified ipAddress
-// or IZOT_NULL_SOCKET_INDEX.
+// or IZOT_NULL_SOCKET_INDEX.  Doesn't take the lock.
 int IzotUnicastAddresses::find(const byte *ipAddress, int ipAddrLen)
 {
-    LonLinkIzoTLock lock(m_lock);
+    ULONG seq;
+    int socketIndex;
+    do
+    {
+        seq = m_indexSeq;
+        LON_LINK_IZOT_BARRIER();
+        socketIndex = lookup(m_pIndex, ipAddress, ipAddrLen);
+        LON_LINK_IZOT_BARRIER();
+    } while (seq != m_indexSeq);
+
+    if (socketIndex != IZOT_NULL_SOCKET_INDEX)
+    {
+        m_lastFound = socketIndex;
+    }
+    return socketIndex;
+}
+
+// Look up ipAddress in pIndex, starting with the last one found.  The
+// index may be being rebuilt underneath, in which case the caller retries,
+// so this only has to stay within the index.
+int IzotUnicastAddresses::lookup(Index *pIndex, const byte *ipAddress, int ipAddrLen)
+{
+    // Consecutive packets usually use the same address, so try the last
+    // one found before hashing.
+    int i = m_lastFound;
+    if (i >= 0 && i < pIndex->size && pIndex->entries[i].ipAddrLen == ipAddrLen &&
+        memcmp(pIndex->entries[i].ipAddress, ipAddress, ipAddrLen) == 0)
+    {
+        return i;
+    }
 
-    int i; 
-    // Scan the map for a match
-    for (i = 0; i < m_numEntries; i++)
+    // Scan the bucket for a match.  Rebuilding a spare that a reader is
+    // still using can link a bucket into a loop, so stop after visiting
+    // every entry.
+    int visited = 0;
+    for (i = pIndex->heads[hashIpAddress(ipAddress, ipAddrLen, pIndex->size)]; 
+         i != IZOT_NULL_SOCKET_INDEX && visited < pIndex->size; 
+         i = pIndex->entries[i].next, visited++)
     {
-        if (m_map[i].match(ipAddress, ipAddrLen))
+        if (pIndex->entries[i].ipAddrLen == ipAddrLen &&
+            memcmp(pIndex->entries[i].ipAddress, ipAddress, ipAddrLen) == 0)
         {
             // Got it
             return i;
@@ -197,6 +249,121 @@ int IzotUnicastAddresses::find(const byte *ipAddress, int ipAddrLen)
     return IZOT_NULL_SOCKET_INDEX;
 }
 
+// Copy the index entry for socketIndex without the lock.  Return false if
+// socketIndex isn't in the index.
+bool IzotUnicastAddresses::readIndexEntry(int socketIndex, IndexEntry &entry)
+{
+    ULONG seq;
+    bool found;
+    do
+    {
+        seq = m_indexSeq;
+        LON_LINK_IZOT_BARRIER();
+        Index *pIndex = m_pIndex;
+        found = socketIndex >= 0 && socketIndex < pIndex->size;
+        if (found)
+        {
+            entry = pIndex->entries[socketIndex];
+        }
+        LON_LINK_IZOT_BARRIER();
+    } while (seq != m_indexSeq);
+    return found;
+}
+
+// Keep an index that is no longer used until the map is destroyed.
+void IzotUnicastAddresses::retireIndex(Index *pIndex)
+{
+    if (pIndex != NULL)
+    {
+        pIndex->pNextRetired = m_pRetired;
+        m_pRetired = pIndex;
+    }
+}
+
+// Hash an IP address into the range 0..size-1
+int IzotUnicastAddresses::hashIpAddress(const byte *ipAddress, int ipAddrLen, int size)
+{
+    unsigned int hash = 0;
+    for (int i = 0; i < ipAddrLen; i++)
+    {
+        hash = hash*31 + ipAddress[i];
+    }
+    return (int)(hash & (size-1));
+}
+
+// Rebuild the hash index after the set of addresses in use, or their
+// binding, changes.  This only happens as addresses are bound and released,
+// so it is not worth maintaining the index incrementally.
+void IzotUnicastAddresses::rebuildIndex(void)
+{
+    int size = 8;
+    while (size < m_numEntries)
+    {
+        size <<= 1;
+    }
+
+    Index *pIndex = m_pSpare;
+    if (pIndex != NULL && pIndex->size != size)
+    {
+        // The map has outgrown the spare.  The sizes double, so the
+        // retired indices take less memory than the current ones.
+        retireIndex(pIndex);
+        pIndex = NULL;
+    }
+    if (pIndex == NULL)
+    {
+        pIndex = new Index;
+        pIndex->size = size;
+        pIndex->heads = new int[size];
+        pIndex->entries = new IndexEntry[size];
+        pIndex->pNextRetired = NULL;
+    }
+    else
+    {
+        // A reader may still be using the spare from before the last
+        // rebuild.
+        m_indexSeq++;
+        LON_LINK_IZOT_BARRIER();
+    }
+
+    for (int i = 0; i < size; i++)
+    {
+        pIndex->heads[i] = IZOT_NULL_SOCKET_INDEX;
+    }
+    // Insert in reverse so each bucket lists the lowest socket index first,
+    // which is the one the old linear scan would have found.
+    for (int i = size-1; i >= 0; i--)
+    {
+        IndexEntry *pEntry = &pIndex->entries[i];
+        memset(pEntry, 0, sizeof(*pEntry));
+        pEntry->next = IZOT_NULL_SOCKET_INDEX;
+        if (i < m_numEntries)
+        {
+            pEntry->isBound = m_map[i].getIsBound();
+            pEntry->port = m_map[i].getPort();
+            if (m_map[i].getUseCount())
+            {
+                pEntry->ipAddrLen = m_map[i].getIpAddrLen();
+                memcpy(pEntry->ipAddress, m_map[i].getIpAddress(), pEntry->ipAddrLen);
+                int bucket = hashIpAddress(pEntry->ipAddress, pEntry->ipAddrLen, size);
+                pEntry->next = pIndex->heads[bucket];
+                pIndex->heads[bucket] = i;
+            }
+        }
+    }
+
+    // Publish the new index.  The old one is the spare for next time.
+    LON_LINK_IZOT_BARRIER();
+    m_pSpare = m_pIndex;
+    m_pIndex = pIndex;
+    m_lastFound = IZOT_NULL_SOCKET_INDEX;
+
+    if (++m_generation == 0)
+    {
+        m_generation = 1;
+    }
+}
+
 IzotUnicastAddress *IzotUnicastAddresses::get(int socketIndex)
 {
     LonLinkIzoTLock lock(m_lock);
@@ -233,6 +400,7 @@ void IzotUnicastAddresses::set(int index, const byte *ipAddress, int ipAddrLen)
     
     // At this point index must be in range.
     m_map[index].set(ipAddress, ipAddrLen);
+    rebuildIndex();
 }
 
 void IzotUnicastAddresses::set(int socketIndex, VXSOCKADDR psad)
@@ -251,11 +419,32 @@ int IzotUnicastAddresses::remove(const byte *ipAddress, int ipAddrLen)
     int index = find(ipAddress, ipAddrLen);
     if (index != IZOT_NULL_SOCKET_INDEX)
     {
-        m_map[index].decrement();
+        if (m_map[index].decrement() == 0)
+        {
+            rebuildIndex();
+        }
     }
     return index;
 }
 
+// Decrement the use count of the address at socketIndex and return the
+// new count.
+int IzotUnicastAddresses::release(int socketIndex)
+{
+    LonLinkIzoTLock lock(m_lock);
+
+    int useCount = 0;
+    if (validSocketIndex(socketIndex))
+    {
+        useCount = m_map[socketIndex].decrement();
+        if (useCount == 0)
+        {
+            rebuildIndex();
+        }
+    }
+    return useCount;
+}
+
 void IzotUnicastAddresses::close(void)
 {
     LonLinkIzoTLock lock(m_lock);
@@ -264,18 +453,25 @@ void IzotUnicastAddresses::close(void)
     {
         m_map[i].close();
     }
+    rebuildIndex();
 }
 
 bool IzotUnicastAddresses::getIsBound(int socketIndex)
 {
-    LonLinkIzoTLock lock(m_lock);
+    IndexEntry entry;
+    return readIndexEntry(socketIndex, entry) && entry.isBound;
+}
 
-    bool isBound = false;
-    if (validSocketIndex(socketIndex))
+bool IzotUnicastAddresses::getIsBound(int socketIndex, USHORT &port)
+{
+    IndexEntry entry;
+    port = 0;
+    if (readIndexEntry(socketIndex, entry))
     {
-        isBound = m_map[socketIndex].getIsBound();
+        port = entry.port;
+        return entry.isBound;
     }
-    return isBound;
+    return false;
 }
 
 bool IzotUnicastAddresses::getRebind(int socketIndex)
@@ -290,14 +486,32 @@ bool IzotUnicastAddresses::getRebind(int socketIndex)
     return rebind;
 }
 
-void IzotUnicastAddresses::setIsBound(int socketIndex, bool isBound)
+void IzotUnicastAddresses::setIsBound(int socketIndex, bool isBound, USHORT port)
 {
     LonLinkIzoTLock lock(m_lock);
 
-    if (validSocketIndex(socketIndex))
+    if (!isBound)
+    {
+        port = 0;
+    }
+    if (validSocketIndex(socketIndex) && 
+        (m_map[socketIndex].getIsBound() != isBound || m_map[socketIndex].getPort() != port))
     {
         m_map[socketIndex].setIsBound(isBound);
+        m_map[socketIndex].setPort(port);
+        rebuildIndex();
+    }
+}
+
+USHORT IzotUnicastAddresses::getPort(int socketIndex)
+{
+    IndexEntry entry;
+    USHORT port = 0;
+    if (readIndexEntry(socketIndex, entry))
+    {
+        port = entry.port;
     }
+    return port;
 }
 
 // Get the IP address in network byte order at socketIndex
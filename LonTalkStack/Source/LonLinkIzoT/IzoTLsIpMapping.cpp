@@ -282,6 +282,7 @@ void IzoTLsIpMappingNodeInfo::agingTimerExpired(void)
 IzoTLsIpMappingSubnetInfo::IzoTLsIpMappingSubnetInfo(LtDomain domainId)
 {
     m_pNext = NULL;
+    m_pNextInBucket = NULL;
     m_domainId.set(domainId);
     memset(m_subnets, 0, sizeof(m_subnets));
 }
@@ -75,12 +75,21 @@ LonLinkIzoT::LonLinkIzoT(int numSockets, int socketResize) : m_lock(LonLinkIzoTL
 {
     m_isOpen = false;
     m_wdTimer = NULL;
+    m_txBlockedSocket = INVALID_SOCKET;
+    m_txDrainSem = semBCreate(SEM_Q_FIFO, SEM_EMPTY);
+    m_tidTxDrain = ERROR;
+    m_bExitTxDrain = false;
     m_agingTimer = wdCreate();
     assert( m_agingTimer != NULL );
     m_agingTimerEnabled = false;
     m_bufferConfiguration.setNetworkInputBuffers(255, 2);
     m_bufferConfiguration.setNetworkOutputBuffers(255, 2, 2);  
     m_pLsIpMapHead = NULL;
+    m_pLsIpMapLast = NULL;
+    memset(m_lsIpMapIndex, 0, sizeof(m_lsIpMapIndex));
+    memset(m_destAddrCtx, 0, sizeof(m_destAddrCtx));
+    memset((void *)m_destAddrCtxSeq, 0, sizeof(m_destAddrCtxSeq));
+    m_lsIpMapGeneration = 1;
     m_agingInterval = LON_LINK_IZOT_DEFUALT_AGING_INTERVAL;  // REMINDER:  This should be configurable.
     startAgingTimer();
 }
@@ -88,6 +97,7 @@ LonLinkIzoT::LonLinkIzoT(int numSockets, int socketResize) : m_lock(LonLinkIzoTL
 LonLinkIzoT::~LonLinkIzoT()
 {
 	stopReceiveTask();
+    stopTxDrainTask();
 
     driverClose();
     wdCancel( m_agingTimer );
@@ -112,6 +122,7 @@ LonLinkIzoT::~LonLinkIzoT()
     // Delete the sockets. Need to do this explicity rather than relying on the destructor
     // because it has to be done before deleting the lock
     m_sockets.closeAllAndDelete();
+    semDelete(m_txDrainSem);
     semDelete(m_lock);
 }
 
@@ -169,14 +180,29 @@ static int lonLinkIzoTTimer( int a1 )
 // transmitTimerRoutine
 //
 // Try repeatedly to transmit something if we get a transmit full condition.
+// Only used if the drain task could not be started.  This runs with the
+// timer list locked while sendPacket starts the timer with the link locked,
+// which is why the drain task does this job whenever it can.
 //
 void	LonLinkIzoT::transmitTimerRoutine()
+{
+	lock();
+	m_bDelayedRetransmitPending = false;
+	retransmitQueued();
+	unlock();
+}
+
+//
+// retransmitQueued
+//
+// Send queued packets until the queue is empty or the driver is full again.
+//
+int		LonLinkIzoT::retransmitQueued()
 {
 	LLPktQue*	pPkt;
 	LtQue*		pItem;
 	LtSts		sts = LTSTS_OK;
-
-	lock();
+	int			nCompleted = 0;
 
 	while ( m_qTransmit.removeHead( &pItem ) )
 	{
@@ -194,26 +220,141 @@ void	LonLinkIzoT::transmitTimerRoutine()
 			unlock();
 			m_pNet->packetComplete( pPkt->m_refId, sts );
 			lock();
+			nCompleted++;
 		}
 
 		freeLLPkt(pPkt);
 	}
 
+	// Whoever emptied the queue, sendPacket can go straight to the driver
+	// again.  A timer left running just finds nothing to do.
 	m_bDelayedRetransmitPending = false;
 
-	if ( sts == LTSTS_QUEUEFULL || !m_qTransmit.isEmpty() )
-	{	startDelayedRetransmit();
+	if ( (sts == LTSTS_QUEUEFULL || !m_qTransmit.isEmpty()) && m_tidTxDrain == ERROR )
+	{	startRetransmitTimer();
 	}
+	return nCompleted;
+}
 
-	unlock();
+//
+// lonLinkIzoTTxDrain
+//
+// C entry point for txDrainTask
+//
+static int lonLinkIzoTTxDrain( int a1, ... )
+{
+	LonLinkIzoT*	pLink = (LonLinkIzoT*) a1;
+	pLink->txDrainTask();
+	return 0;
+}
+
+//
+// txDrainTask
+//
+// Wait for queued packets, then for the socket that refused them to have
+// room, and send them.  A poll is bounded by the retransmit period, and the
+// queue is retried when it times out, so this also does the retransmit
+// timer's job for drivers that can't report writability.  If a socket
+// reports room but the driver still refuses the packet, we wait out a
+// retransmit period rather than spin.
+//
+void	LonLinkIzoT::txDrainTask()
+{
+	while ( !m_bExitTxDrain )
+	{
+		semTake( m_txDrainSem, WAIT_FOREVER );
+
+		while ( !m_bExitTxDrain && isOpen() )
+		{
+			struct timeval	timeout;
+			VXSOCKET		blockedSocket;
+			boolean			bEmpty;
+			int				nReady;
+			int				nCompleted;
+
+			lock();
+			bEmpty = m_qTransmit.isEmpty();
+			blockedSocket = m_txBlockedSocket;
+			unlock();
+			if ( bEmpty )
+			{	break;
+			}
+
+			timeout.tv_sec = 0;
+			timeout.tv_usec = ticksToMs(LON_LINK_IZOT_RETRANSMIT_TICKS)*1000;
+			if ( blockedSocket != INVALID_SOCKET )
+			{
+				nReady = vxsSelectAnyWrite( &blockedSocket, 1, &timeout );
+			}
+			else
+			{
+				LonLinkIzoTSocketsRef *pSocketRef = m_sockets.getSocketRef();
+				nReady = vxsSelectAnyWrite( pSocketRef->getSockets(), pSocketRef->getNumEntries(), &timeout );
+				pSocketRef->release();
+			}
+
+			if ( nReady < 0 )
+			{	// Nothing to wait on
+				taskDelay( LON_LINK_IZOT_RETRANSMIT_TICKS );
+			}
+
+			lock();
+			m_txBlockedSocket = INVALID_SOCKET;
+			nCompleted = retransmitQueued();
+			unlock();
+			if ( nReady > 0 && nCompleted == 0 )
+			{
+				taskDelay( LON_LINK_IZOT_RETRANSMIT_TICKS );
+			}
+		}
+	}
+	m_tidTxDrain = ERROR;
+}
+
+//
+// stopTxDrainTask
+//
+void	LonLinkIzoT::stopTxDrainTask()
+{
+	if ( m_tidTxDrain != ERROR )
+	{
+		m_bExitTxDrain = true;
+		semGive( m_txDrainSem );
+		while ( m_tidTxDrain != ERROR )
+		{
+			taskDelay( msToTicks(50) );
+		}
+	}
 }
 
 //
 // startDelayedRetransmit
 //
-// Start the timer to try again on a transmit
+// A packet has been queued.  Wake the drain task, starting it the first
+// time.  Fall back on the timer if it can't be started.
 //
 void	LonLinkIzoT::startDelayedRetransmit()
+{
+	if ( m_tidTxDrain == ERROR && !m_bExitTxDrain )
+	{
+		m_tidTxDrain = taskSpawn( "izotTxDrain", getRcvTaskPriority(), 0,
+								getRcvTaskStackSize(), lonLinkIzoTTxDrain, (int)this,
+								0,0,0,0,0,0,0,0,0);
+	}
+	if ( m_tidTxDrain != ERROR )
+	{	semGive( m_txDrainSem );
+	}
+	else
+	{	startRetransmitTimer();
+	}
+}
+
+//
+// startRetransmitTimer
+//
+// Start the timer to try again on a transmit
+//
+void	LonLinkIzoT::startRetransmitTimer()
 {
 	STATUS	vxSts;
 	if ( ! m_bDelayedRetransmitPending )
@@ -223,7 +364,7 @@ void	LonLinkIzoT::startDelayedRetransmit()
 			m_wdTimer = wdCreate();
 			assert( m_wdTimer != NULL );
 		}
-		vxSts = wdStart( m_wdTimer, 20, lonLinkIzoTTimer, (int)this );
+		vxSts = wdStart( m_wdTimer, LON_LINK_IZOT_RETRANSMIT_TICKS, lonLinkIzoTTimer, (int)this );
 		m_bDelayedRetransmitPending = true;
 	}
 }
@@ -299,7 +440,21 @@ IzoTLsIpMappingSubnetInfo *LonLinkIzoT::findLsIpMapSubnetInfo(const uint8_t *pDo
     }
 
     LtDomain domain(id, domainIdLen);
-    for (p = m_pLsIpMapHead; p != NULL; p = p->getNext())
+
+    // Nearly all traffic is on one domain, so check the last one found first.
+    if (m_pLsIpMapLast != NULL && domain == m_pLsIpMapLast->GetDomain())
+    {
+        return m_pLsIpMapLast;
+    }
+
+    unsigned int hash = domainIdLen;
+    for (int i = 0; i < domainIdLen; i++)
+    {
+        hash = hash*31 + id[i];
+    }
+    IzoTLsIpMappingSubnetInfo **ppBucket = &m_lsIpMapIndex[hash & (LON_LINK_IZOT_LS_IP_MAP_BUCKETS-1)];
+
+    for (p = *ppBucket; p != NULL; p = p->getNextInBucket())
     {
         if (domain == p->GetDomain())
         {
@@ -312,10 +467,63 @@ IzoTLsIpMappingSubnetInfo *LonLinkIzoT::findLsIpMapSubnetInfo(const uint8_t *pDo
         p = new IzoTLsIpMappingSubnetInfo(domain);
         p->link(m_pLsIpMapHead);
         m_pLsIpMapHead = p;
+        p->setNextInBucket(*ppBucket);
+        *ppBucket = p;
+    }
+    if (p != NULL)
+    {
+        m_pLsIpMapLast = p;
     }
     return p;
 }
 
+// Invalidate all cached destination address lookups.  Call with the lock
+// held whenever the LS/IP mapping changes.
+void LonLinkIzoT::lsIpMapChanged(void)
+{
+    if (++m_lsIpMapGeneration == 0)
+    {
+        // 0 marks an unused entry, so skip it.  Entries from the previous
+        // time around might match again, so clear them.
+        DestAddrCtx unused;
+        memset(&unused, 0, sizeof(unused));
+        for (int i = 0; i < LON_LINK_IZOT_DEST_CTX_CACHE_SIZE; i++)
+        {
+            writeDestAddrCtx(i, unused);
+        }
+        m_lsIpMapGeneration = 1;
+    }
+}
+
+// Copy the DestAddrCtx at index to ctx, without the lock.  Return false if
+// it doesn't hold the outcome for the destination.
+bool LonLinkIzoT::readDestAddrCtx(int index, DestAddrCtx &ctx, const uint8_t *pDomainId, 
+                                  uint8_t domainLen, uint8_t subnetId, uint8_t nodeId)
+{
+    ULONG seq;
+    do
+    {
+        seq = m_destAddrCtxSeq[index];
+        LON_LINK_IZOT_BARRIER();
+        ctx = m_destAddrCtx[index];
+        LON_LINK_IZOT_BARRIER();
+    } while ((seq & 1) || seq != m_destAddrCtxSeq[index]);
+
+    return ctx.generation == m_lsIpMapGeneration && ctx.subnetId == subnetId &&
+           ctx.nodeId == nodeId && ctx.domainLen == domainLen &&
+           memcmp(ctx.domainId, pDomainId, domainLen) == 0;
+}
+
+// Replace the DestAddrCtx at index.  Call with the lock held.
+void LonLinkIzoT::writeDestAddrCtx(int index, const DestAddrCtx &ctx)
+{
+    m_destAddrCtxSeq[index]++;
+    LON_LINK_IZOT_BARRIER();
+    m_destAddrCtx[index] = ctx;
+    LON_LINK_IZOT_BARRIER();
+    m_destAddrCtxSeq[index]++;
+}
+
 ///////////////////////////////////////////////////////////////////////////
 // Arbitrary IP Address Aging
 ///////////////////////////////////////////////////////////////////////////
@@ -334,6 +542,7 @@ void	LonLinkIzoT::agingTimerRoutine(void)
         {
             p->agingTimerExpired();
         }
+        lsIpMapChanged();
         startAgingTimer();
     }
 }
@@ -409,28 +618,64 @@ uint8_t LonLinkIzoT::getArbitraryDestAddress(const uint8_t *pDomainId, uint8_t d
 {
     uint8_t useDerivedAddress = false;
     void *pArbitraryIpAddr = null;
+    DestAddrCtx ctx;
 
-    LonLinkIzoTLock lock(m_lock);
-
-    // Find the map for this domain.  If it doesn't exist, we don't know anything
-    // about the destination.
-    IzoTLsIpMappingSubnetInfo *p = findLsIpMapSubnetInfo(pDomainId, domainLen, false);
-    if (p != NULL)
+    // See if we've already looked up this destination since the mapping
+    // last changed.  A hit doesn't need the lock.
+    uint8_t node = nodeId & 0x7f;
+    unsigned int hash = subnetId*31 + node;
+    for (int i = 0; i < domainLen && i < LT_DOMAIN_LENGTH; i++)
     {
-        if (p->getLsDerivedIpAddr(subnetId, nodeId & 0x7f))
+        hash = hash*31 + pDomainId[i];
+    }
+    int ctxIndex = hash & (LON_LINK_IZOT_DEST_CTX_CACHE_SIZE-1);
+    if (!readDestAddrCtx(ctxIndex, ctx, pDomainId, domainLen, subnetId, node))
+    {
+        LonLinkIzoTLock lock(m_lock);
+
+        memset(&ctx, 0, sizeof(ctx));
+        if (domainLen <= LT_DOMAIN_LENGTH)
         {
-            useDerivedAddress = true;
+            ctx.generation = m_lsIpMapGeneration;
+            ctx.domainLen = domainLen;
+            memcpy(ctx.domainId, pDomainId, domainLen);
+            ctx.subnetId = subnetId;
+            ctx.nodeId = node;
         }
-        else
+
+        // Find the map for this domain.  If it doesn't exist, we don't know anything
+        // about the destination.
+        IzoTLsIpMappingSubnetInfo *p = findLsIpMapSubnetInfo(pDomainId, domainLen, false);
+        if (p != NULL)
         {
-            pArbitraryIpAddr = p->getArbitraryIpAddr(subnetId, nodeId & 0x7f);
-            if (pArbitraryIpAddr)
+            if (p->getLsDerivedIpAddr(subnetId, node))
+            {
+                ctx.useDerived = true;
+            }
+            else
             {
-                // REMINDER IPV6 support...
-                // Copy the arbitrary address as the actual destination IP address
-               memcpy(pDestIpAddress, pArbitraryIpAddr, IPV4_ADDRESS_LEN);
+                pArbitraryIpAddr = p->getArbitraryIpAddr(subnetId, node);
+                if (pArbitraryIpAddr)
+                {
+                    // REMINDER IPV6 support...
+                    ctx.hasArbitrary = true;
+                    memcpy(ctx.arbitraryIpAddr, pArbitraryIpAddr, IPV4_ADDRESS_LEN);
+                }
             }
         }
+        writeDestAddrCtx(ctxIndex, ctx);
+    }
+
+    if (ctx.useDerived)
+    {
+        useDerivedAddress = true;
+    }
+    else if (ctx.hasArbitrary)
+    {
+        // REMINDER IPV6 support...
+        // Copy the arbitrary address as the actual destination IP address
+        pArbitraryIpAddr = ctx.arbitraryIpAddr;
+        memcpy(pDestIpAddress, pArbitraryIpAddr, IPV4_ADDRESS_LEN);
     }
 
     if (!useDerivedAddress)
@@ -484,7 +729,27 @@ void LonLinkIzoT::setArbitraryAddressMapping(const uint8_t *pArbitraryIpAddr,
     IzoTLsIpMappingSubnetInfo *p = findLsIpMapSubnetInfo(pDomainId, domainLen, true);
     if (p != NULL)
     {
+        // This is called for every packet received from a device using an
+        // arbitrary address, mostly just to refresh its age.  Only count it
+        // as a change if the address is new, different, removed, or replaces
+        // a derived mapping.
+        const void *pOldIpAddr = p->getArbitraryIpAddr(subnetId, nodeId);
+        boolean changed;
+        if (pArbitraryIpAddr == NULL)
+        {
+            changed = pOldIpAddr != NULL;
+        }
+        else
+        {
+            changed = pOldIpAddr == NULL ||
+                      memcmp(pOldIpAddr, pArbitraryIpAddr, IPV4_ADDRESS_LEN) != 0 ||
+                      p->getLsDerivedIpAddr(subnetId, nodeId);
+        }
         p->setArbitraryIpAddr(subnetId, nodeId, pArbitraryIpAddr);
+        if (changed)
+        {
+            lsIpMapChanged();
+        }
     }
 }
 
@@ -507,9 +772,13 @@ void LonLinkIzoT::setDerivedAddressMapping(const uint8_t *pDomainId, uint8_t dom
 {
     LonLinkIzoTLock lock(m_lock);
     IzoTLsIpMappingSubnetInfo *p = findLsIpMapSubnetInfo(pDomainId, domainLen, true);
-    if (p != NULL)
+
+    // This is called for every packet received from a device using its
+    // derived address, so only count it as a change the first time.
+    if (p != NULL && !p->getLsDerivedIpAddr(subnetId, nodeId))
     {
         p->setLsDerivedIpAddr(subnetId, nodeId, true);
+        lsIpMapChanged();
     }
 }
 
@@ -536,6 +805,7 @@ void LonLinkIzoT::setDerivedSubnetsMapping(const uint8_t *pDomainId, uint8_t dom
     if (p != NULL)
     {
         p->setLsDerivedIpSubnets(set, pSubnets);
+        lsIpMapChanged();
     }
 }
 
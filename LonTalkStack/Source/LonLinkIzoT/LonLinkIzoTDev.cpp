@@ -65,32 +65,6 @@ extern "C"
 #include "ipv6_ls_to_udp.h"
 }
 
-#ifndef WIN32
-static uint16_t
-checksum (uint16_t *addr, int len)
-{
-	int nleft = len;
-	int sum = 0;
-	uint16_t *w = addr;
-	uint16_t answer = 0;
-
-	while (nleft > 1) {
-		sum += *w++;
-		nleft -= sizeof (uint16_t);
-	}
-
-	if (nleft == 1) {
-		*(uint8_t *) (&answer) = *(uint8_t *) w;
-		sum += answer;
-	}
-
-	sum = (sum >> 16) + (sum & 0xFFFF);
-	sum += (sum >> 16);
-	answer = ~sum;
-	return (answer);
-}
-#endif
-
 LonLinkIzoTDev* LonLinkIzoTDev::m_instance = NULL;
 LonLinkIzoTDev* LonLinkIzoTDev::getInstance()
 {
@@ -122,6 +96,13 @@ LonLinkIzoTDev::LonLinkIzoTDev(const char* szIzoTName, const char *szIpIfName, i
 {
     m_isOpen = false;
     m_lastSocketRead = 0;
+    memset(m_sourceAddrCtx, 0, sizeof(m_sourceAddrCtx));
+#ifndef WIN32
+    for (int i = 0; i < LON_LINK_IZOT_DEV_RX_BATCH_SIZE; i++)
+    {
+        m_rxBatchAddr[i] = vxsGetSockaddr();
+    }
+#endif
 
     m_rebindTimeout = LON_LINK_IZOT_DEV_REBIND_TIMEOUT_MIN;
     m_szIzoTName = NULL;
@@ -163,7 +144,6 @@ LonLinkIzoTDev::LonLinkIzoTDev(const char* szIzoTName, const char *szIpIfName, i
     IzoTDeleteUnicastReg(szIzoTName);
 #endif
 
-    m_ProtocolAnalyserFn = NULL;
     m_instance = this;
 }
 
@@ -178,22 +158,27 @@ LonLinkIzoTDev::~LonLinkIzoTDev()
     delete[] m_szIzoTName;
     delete[] m_szIpIfName;
 
-    m_ProtocolAnalyserFn = NULL;
+#ifndef WIN32
+    for (int i = 0; i < LON_LINK_IZOT_DEV_RX_BATCH_SIZE; i++)
+    {
+        vxsFreeSockaddr(m_rxBatchAddr[i]);
+    }
+#endif
 }
 
+// Open a UDP socket for LS/IP.  On Linux the kernel demultiplexes by the
+// bound address and port and reports each datagram's destination address
+// through IP_PKTINFO, so there are no IP or UDP headers to parse or build.
 int opensocket(void) {
 #ifdef WIN32
     return vxsSocket(VXSOCK_DGRAM);
 #else 
-    int sockfd = socket(AF_INET, SOCK_RAW, IPPROTO_UDP);
-    if (sockfd < 0) {
-        perror("raw socket");
+    int sockfd = vxsSocket(VXSOCK_DGRAM);
+    if (sockfd == INVALID_SOCKET) {
+        perror("udp socket");
+        return sockfd;
     }
     int on = 1;
-    if (setsockopt(sockfd, IPPROTO_IP, IP_HDRINCL, &on, sizeof(on)) < 0) {
-        perror("ip hdr incl");
-    }
-
 	if (setsockopt(sockfd, IPPROTO_IP, IP_PKTINFO, &on, sizeof(on)) < 0) {
 		perror("pkt info");
 	}
@@ -232,7 +217,7 @@ LtSts LonLinkIzoTDev::driverOpen(const char* pName)
 
             if (updateLsSubnetMembership() == LTSTS_OK)
             {
-                m_unicastAddresses.setIsBound(socketIndex, true);
+                setSocketBound(socketIndex, true);
                 sts = LTSTS_OK;
             }
             vxsFreeSockaddr(inAddrAny);
@@ -271,7 +256,7 @@ LtSts LonLinkIzoTDev::driverOpen(const char* pName)
             	m_unicastAddresses.set(socketIndex, localAddr);
             	if (updateLsSubnetMembership() == LTSTS_OK)
             	{
-            		m_unicastAddresses.setIsBound(socketIndex, true);
+            		setSocketBound(socketIndex, true);
             		char szIpAddress[100];
             		vxsMakeDottedAddr(szIpAddress, vxsAddrGetAddr(localAddr));
             		vxlReportEvent("DriverOpen Bind socketIndex=%d to '%s'\n", socketIndex, szIpAddress);
@@ -317,185 +302,199 @@ LtSts LonLinkIzoTDev::driverRead(void *pData, short len)
         // An LS/IP UDP message has arrived on the socket indexed by socketIndex.
         // Now we need to process it.
 
-#ifndef WIN32
-        char            msgBuffer[MAX_ETH_PACKET];
-        struct iphdr	*pIpHdr = (struct iphdr*)msgBuffer;
-        struct udphdr	*pUdpHdr = (struct udphdr*)(msgBuffer + sizeof(struct iphdr));
-        uint8_t 		*udpPayload = (uint8_t*)(msgBuffer + sizeof(struct iphdr) + sizeof(struct udphdr));
-#else
-        char            udpPayload[MAX_UDP_PACKET];
-#endif
+        char            msgBuffer[MAX_UDP_PACKET];
         VXSOCKADDR      sourceAddr;   // Source address of last read
-        int             udpPayloadLen;
+        ULONG           destAddr;     // Destination address of last read, 0 if unknown
+        int             msgLen;
 
         // allocate a buffer for the source address
         sourceAddr = vxsGetSockaddr();  
 
+        // Read the message and the source and destination addresses.
+        msgLen = vxsRecvFromDest(socket, msgBuffer, sizeof(msgBuffer), 0, sourceAddr, &destAddr);
+
+        sts = convertReceivedPacket(socketIndex, socket, msgBuffer, msgLen, sourceAddr, destAddr, pData, len);
+        vxsFreeSockaddr(sourceAddr);
+    }
+	return(sts);
+}
+
 #ifndef WIN32
-        // Read the message and the source address.  Too bad we can't get the dest address.
-        vxsRecvFrom(socket, msgBuffer, sizeof(msgBuffer), 0, sourceAddr);
+// Read as many LS/IP UDP packets as are waiting on the next socket, up to
+// nMaxPkts, with a single system call and convert each of them to LTVx.
+LtSts LonLinkIzoTDev::driverReadBatch(byte *pData, short len, int nMaxPkts, int &nPkts)
+{
+    int socketIndex = IZOT_NULL_SOCKET_INDEX;
 
-		if (pIpHdr->protocol != IPPROTO_UDP || (pUdpHdr->dest != htons(IPV6_LS_UDP_PORT)))
-            return LTSTS_ERROR;
-#else
-        udpPayloadLen = vxsRecvFrom(socket, udpPayload, sizeof(udpPayload), 0, sourceAddr);
-#endif
+    nPkts = 0;
 
-        // DEBUG
-#ifdef WIN32
-        uint8_t destAddress[IZOT_MAX_IP_ADDR_SIZE];
-#else
-        char src[50];
-        char revcStr[50], destStr[50];
-        udpPayloadLen = ntohs(pUdpHdr->len) - sizeof(struct udphdr);
-        ULONG destAddress, recvDestAddress = pIpHdr->daddr;
-        //ULONG sourceAddress = pIpHdr->saddr;
+    // Figure out which socket to read next.  Sockets with data are read round-robin
+	VXSOCKET socket = SelectSocketToRead(&socketIndex);
+
+    if ((socket != INVALID_SOCKET) && (socketIndex != IZOT_NULL_SOCKET_INDEX))
+    {
+        if (nMaxPkts > LON_LINK_IZOT_DEV_RX_BATCH_SIZE)
+        {
+            nMaxPkts = LON_LINK_IZOT_DEV_RX_BATCH_SIZE;
+        }
+        int nMsgs = vxsRecvFromMulti(socket, m_rxBatchBuf[0], MAX_UDP_PACKET, nMaxPkts,
+                                     m_rxBatchLen, m_rxBatchAddr, m_rxBatchDest);
+        for (int i = 0; i < nMsgs; i++)
+        {
+            // Packets that fail conversion are dropped, just as driverRead does
+            if (convertReceivedPacket(socketIndex, socket, m_rxBatchBuf[i], m_rxBatchLen[i], 
+                                      m_rxBatchAddr[i], m_rxBatchDest[i], pData + nPkts*len, len) == LTSTS_OK)
+            {
+                nPkts++;
+            }
+        }
+    }
+    // Nothing to read.  LonLink expects LTSTS_ERROR for that.
+	return nPkts ? LTSTS_OK : LTSTS_ERROR;
+}
 #endif
 
-        LonLinkIzoTLock lock(m_lock);   // LOCK
+// Convert a LS/IP UDP payload read from the socket indexed by socketIndex
+// to LTVx.  recvDestAddress is the destination address of the datagram in
+// network order, or 0 if the platform can't report it.
+LtSts LonLinkIzoTDev::convertReceivedPacket(int socketIndex, VXSOCKET socket, char *msgBuffer, int msgLen, 
+                                            VXSOCKADDR sourceAddr, ULONG recvDestAddress, void *pData, short len)
+{
+	LtSts	sts = LTSTS_ERROR;
+    uint8_t *udpPayload = (uint8_t *)msgBuffer;
+    int     udpPayloadLen = msgLen;
+    uint8_t destAddress[IZOT_MAX_IP_ADDR_SIZE];
 
-        // REMINDER: Need to addresses for IPV6
+    LonLinkIzoTLock lock(m_lock);   // LOCK
 
-#ifdef WIN32
-        // ipv6_convert_ls_udp_to_ltvx needs the destination address for subnet/node or broadcast
-        // addressing (but not neuron ID or group addressing).
-        // Unfortunately we can't get the dest address from sockets.  So we
-        // just assume it was addressed using the unicast address bound to this socket. 
-        m_unicastAddresses.getIpAddress(socketIndex, destAddress, sizeof(destAddress));
-#else
-        m_unicastAddresses.getIpAddress(socketIndex, (uint8_t*)&destAddress, sizeof(destAddress));
+    // REMINDER: Need to addresses for IPV6
+
+    // ipv6_convert_ls_udp_to_ltvx needs the destination address for subnet/node or broadcast
+    // addressing (but not neuron ID or group addressing).  The socket is bound to its
+    // unicast address, so the kernel has already done the unicast demultiplexing.
+    m_unicastAddresses.getIpAddress(socketIndex, destAddress, sizeof(destAddress));
+
+    if (m_ipManagementOptions & LONLINK_IZOT_MGMNT_OPTION_TRACE_MSGS)
+    {
+        char src[50];
+        char revcStr[50];
 
-        // Get the source IP address as a string, for debugging purposes
         vxsMakeDottedAddr(src, vxsAddrGetAddr(sourceAddr));
         vxsMakeDottedAddr(revcStr, ntohl(recvDestAddress));
-        vxsMakeDottedAddr(destStr, ntohl(destAddress));
-
-        vxlReportEvent("vxsRecvFrom sockets(%d)=%d source= %s dest=%s rec=%s dest2=%s udpPayloadLen=%d\n",
+        vxlReportEvent("vxsRecvFrom sockets(%d)=%d source= %s dest=%s rec=%s udpPayloadLen=%d\n",
                 socketIndex, socket, src, m_unicastAddresses.getSzIpAddress(socketIndex),
-                revcStr, destStr, udpPayloadLen);
-#endif
-        if (udpPayloadLen && udpPayloadLen != SOCKET_ERROR && udpPayloadLen < MAX_UDP_PACKET)
+                revcStr, udpPayloadLen);
+    }
+    if (udpPayloadLen > 0 && udpPayloadLen < MAX_UDP_PACKET)
+    {
+        if (recvDestAddress != 0)
         {
-#ifndef WIN32
-            if (((((byte *)&recvDestAddress)[0]) & 0xF0) == 0xE0)
+            if ((((byte *)&recvDestAddress)[0] & 0xF0) == 0xE0)
             {
                 // multicast message.
                 if (socketIndex != LON_LINK_IZOT_DEV_MC_SOCKET_INDEX)
                 {
-                    sts = LTSTS_ERROR;
-                    vxsFreeSockaddr(sourceAddr);
                     vxlReportEvent("LonLinkIzoTDev::driverRead multicast msg in unicast socket\n");
-                    return(sts);
-                 }
+                    return(LTSTS_ERROR);
+                }
             }
             else
             {
-                // unicast message
+                // unicast message.  The multicast socket is bound to INADDR_ANY, so
+                // it also gets unicasts to local addresses that no socket is bound to.
                 if (socketIndex == LON_LINK_IZOT_DEV_MC_SOCKET_INDEX)
                 {
-                    sts = LTSTS_ERROR;
-                    vxsFreeSockaddr(sourceAddr);
                     vxlReportEvent("LonLinkIzoTDev::driverRead unicast msg in multicast socket\n");
-                    return(sts);
+                    return(LTSTS_ERROR);
                 }
-                if (destAddress != recvDestAddress)
+                if (memcmp(destAddress, &recvDestAddress, IPV4_ADDRESS_LEN) != 0)
                 {
-                    sts = LTSTS_ERROR;
-                    vxsFreeSockaddr(sourceAddr);
                     vxlReportEvent("LonLinkIzoTDev::driverRead Unicast Address Mismatch\n");
-                    return(sts);
+                    return(LTSTS_ERROR);
                 }
             }
-#endif
-            // Now we need to  fixup the address if necessary, based on addressing mode
-            switch (udpPayload[1] & IPV6_LSUDP_NPDU_MASK_ADDRFMT)
-            {
-                case IPV6_LSUDP_NPDU_ADDR_FMT_DOMAIN_BROADCAST:
-                case IPV6_LSUDP_NPDU_ADDR_FMT_BROADCAST_NEURON_ID:
-                case IPV6_LSUDP_NPDU_ADDR_FMT_SUBNET_BROADCAST:
-#ifdef WIN32
-                    ipv6_gen_ls_mc_addr(IPV6_LS_MC_ADDR_TYPE_BROADCAST, 0, destAddress);
-#else
-                    ipv6_gen_ls_mc_addr(IPV6_LS_MC_ADDR_TYPE_BROADCAST, 0, (uint8_t*)&destAddress);
-#endif
-                    break;
+        }
+        // Now we need to  fixup the address if necessary, based on addressing mode
+        switch (udpPayload[1] & IPV6_LSUDP_NPDU_MASK_ADDRFMT)
+        {
+            case IPV6_LSUDP_NPDU_ADDR_FMT_DOMAIN_BROADCAST:
+            case IPV6_LSUDP_NPDU_ADDR_FMT_BROADCAST_NEURON_ID:
+            case IPV6_LSUDP_NPDU_ADDR_FMT_SUBNET_BROADCAST:
+                ipv6_gen_ls_mc_addr(IPV6_LS_MC_ADDR_TYPE_BROADCAST, 0, destAddress);
+                break;
 
-                case  IPV6_LSUDP_NPDU_ADDR_FMT_GROUP:
-#ifdef WIN32
-                    ipv6_gen_ls_mc_addr(IPV6_LS_MC_ADDR_TYPE_GROUP, 0, destAddress);
-#else
-                    ipv6_gen_ls_mc_addr(IPV6_LS_MC_ADDR_TYPE_GROUP, 0, (uint8_t*)&destAddress);
-#endif
-                    break;
+            case  IPV6_LSUDP_NPDU_ADDR_FMT_GROUP:
+                ipv6_gen_ls_mc_addr(IPV6_LS_MC_ADDR_TYPE_GROUP, 0, destAddress);
+                break;
 
-            }                    
+        }                    
 
-            // Get the source address in network order.
-            ULONG sourceAddress = htonl(vxsAddrGetAddr(sourceAddr));
+        // Get the source address in network order.
+        ULONG sourceAddress = htonl(vxsAddrGetAddr(sourceAddr));
 
-            uint8_t ltVxNpdu[MAX_UDP_PACKET+30];  // Assumes that the LVT0 packet at most 30 bytes bigger than the UDP packet.
-            uint16_t ltVxLen;
-            memset(ltVxNpdu, 0xaa, sizeof(ltVxNpdu));
+        uint8_t ltVxNpdu[MAX_UDP_PACKET+30];  // Assumes that the LVT0 packet at most 30 bytes bigger than the UDP packet.
+        uint16_t ltVxLen;
+        memset(ltVxNpdu, 0xaa, sizeof(ltVxNpdu));
 
-            // convert the LS/IP UDP packet to LTV0 or LTV2
-            ipv6_convert_ls_udp_to_ltvx(0, (uint8_t *)udpPayload, udpPayloadLen,
-#ifdef WIN32
-                                        (uint8_t *)&sourceAddress, vxsAddrGetPort(sourceAddr),
-                                        (uint8_t *)&destAddress, gLsUdpPort,
-#else
-                                        (uint8_t *)&sourceAddress, htons(pUdpHdr->source),
-                                        (uint8_t *)&destAddress, htons(pUdpHdr->dest),
-#endif
-                                        ltVxNpdu, &ltVxLen, static_cast<LonLinkIzoT*>(this));
+        // convert the LS/IP UDP packet to LTV0 or LTV2
+        ipv6_convert_ls_udp_to_ltvx(0, (uint8_t *)udpPayload, udpPayloadLen,
+                                    (uint8_t *)&sourceAddress, vxsAddrGetPort(sourceAddr),
+                                    destAddress, gLsUdpPort,
+                                    ltVxNpdu, &ltVxLen, static_cast<LonLinkIzoT*>(this));
 
-            uint8_t *pPacketBuf = (uint8_t *)pData; 
-            // Make sure packet buf has room for 2 byte SICB header plus 2 byte CRC
-            if (len < ltVxLen+4)
+        uint8_t *pPacketBuf = (uint8_t *)pData; 
+        // Make sure packet buf has room for 2 byte SICB header plus 2 byte CRC
+        if (len < ltVxLen+4)
+        {
+            // packet too big.  
+        	vxlReportEvent("LonLinkIzoTDev::driverRead ERROR: LS/UDP packet is too big to fit in ltvx buffer, LtVx len = %d, buffer = %d\n", ltVxLen+4, len);
+            sts = LTSTS_ERROR;
+        }
+        else if (ltVxLen == 0)
+        {
+        	vxlReportEvent("LonLinkIzoTDev::driverRead ERROR: invalid LS/UDP packet, source\n");
+        	dumpData("LS/UDP packet", (uint8_t *)udpPayload, udpPayloadLen);
+        }
+        else
+        {
+            // Leave room for the CRC.  A trusted link's clients don't check it and
+            // LtIpPortClient has the LRE generate it for any client that needs it,
+            // so it is only calculated here for an untrusted link, or when the
+            // protocol analyzer or the trace below sees the frame as it is.
+            int dataOffset = 2;
+            boolean bTrace = (m_ipManagementOptions & LONLINK_IZOT_MGMNT_OPTION_TRACE_MSGS) != 0;
+            if (!isCrcTrusted() || m_bPaTap || bTrace)
             {
-                // packet too big.  
-            	vxlReportEvent("LonLinkIzoTDev::driverRead ERROR: LS/UDP packet is too big to fit in ltvx buffer, LtVx len = %d, buffer = %d\n", ltVxLen+4, len);
-                sts = LTSTS_ERROR;
+                LtCRC16(ltVxNpdu, ltVxLen);
             }
-            else if (ltVxLen == 0)
+            ltVxLen += 2;   // Adjust len to include CRC
+
+            // Set the SICB header
+            pPacketBuf[0] = L2_PKT_TYPE_INCOMING;
+            if (ltVxLen >= L2_PKT_LEN_EXTENDED)
             {
-            	vxlReportEvent("LonLinkIzoTDev::driverRead ERROR: invalid LS/UDP packet, source\n");
-            	dumpData("LS/UDP packet", (uint8_t *)udpPayload, udpPayloadLen);
+                pPacketBuf[1] = L2_PKT_LEN_EXTENDED;
+                memcpy(&pPacketBuf[2], &ltVxLen, 2);
+                dataOffset += 2;
             }
             else
             {
-                // Calculate the CRC
-                int dataOffset = 2;
-                LtCRC16(ltVxNpdu, ltVxLen);
-                ltVxLen += 2;   // Adjust len to include CRC
-
-                // Set the SICB header
-                pPacketBuf[0] = L2_PKT_TYPE_INCOMING;
-                if (ltVxLen >= L2_PKT_LEN_EXTENDED)
-                {
-                    pPacketBuf[1] = L2_PKT_LEN_EXTENDED;
-                    memcpy(&pPacketBuf[2], &ltVxLen, 2);
-                    dataOffset += 2;
-                }
-                else
-                {
-                    pPacketBuf[1] = (uint8_t)ltVxLen;
-                }
+                pPacketBuf[1] = (uint8_t)ltVxLen;
+            }
 
-                // Set the pdu
-                memcpy(pPacketBuf+dataOffset, ltVxNpdu, ltVxLen);
-                //if (m_ipManagementOptions & LONLINK_IZOT_MGMNT_OPTION_TRACE_MSGS)
-                {
-                    dumpData("LonLinkIzoTDev::driverRead received UDP packet, SICB:", pPacketBuf, ltVxLen+dataOffset);
-                }
-                sts = LTSTS_OK;
+            // Set the pdu
+            memcpy(pPacketBuf+dataOffset, ltVxNpdu, ltVxLen);
+            if (bTrace)
+            {
+                dumpData("LonLinkIzoTDev::driverRead received UDP packet, SICB:", pPacketBuf, ltVxLen+dataOffset);
             }
+            sts = LTSTS_OK;
         }
-        else
-        {
-            // Nothing to read.  LonLink expects LTSTS_ERROR for that.
-            sts = LTSTS_ERROR;
-        }
-        vxsFreeSockaddr(sourceAddr);
+    }
+    else
+    {
+        // Nothing to read.  LonLink expects LTSTS_ERROR for that.
+        sts = LTSTS_ERROR;
     }
 	return(sts);
 }
@@ -523,15 +522,7 @@ LtSts LonLinkIzoTDev::driverWrite(void *pData, short len)
         {
             uint8_t sourceAddr[IPV4_ADDRESS_LEN];
             uint8_t destAddr[IPV4_ADDRESS_LEN];
-#ifndef WIN32
-            uint8_t msgBuffer[MAX_ETH_PACKET];
-			memset(msgBuffer, 0, MAX_ETH_PACKET);
-            struct iphdr *pIpHdr = (struct iphdr *)msgBuffer;
-            struct udphdr *pUdpHdr = (struct udphdr *)(msgBuffer + sizeof(struct iphdr));
-            uint8_t *lsUdpPayload = msgBuffer + sizeof(struct iphdr) + sizeof(struct udphdr);
-#else
             uint8_t lsUdpPayload[MAX_LPDU_SIZE+50]; // Assumes that udp payload is no more than 50 bytes bigger than NPDU
-#endif
             uint16_t destPort;            
             uint16_t sourcePort;            
             memcpy(lsUdpPayload, pNpdu, len);
@@ -554,8 +545,8 @@ LtSts LonLinkIzoTDev::driverWrite(void *pData, short len)
 
                 // Find the socket to use to send the message.  Note that ipv6_convert_ltvx_to_ls_udp should
                 // find the appropriate source IP address, which might be LS derived or might be arbitrary,
-                // but in any case should be bound.
-                socketIndex = SelectSourceSocket(sourceAddr);
+                // but in any case should be bound, and to the source port it asks for.
+                socketIndex = SelectSourceSocket(sourceAddr, sourcePort);
 
                 if (socketIndex != IZOT_NULL_SOCKET_INDEX)
                 {
@@ -584,49 +575,27 @@ LtSts LonLinkIzoTDev::driverWrite(void *pData, short len)
                         }
                         else
                         {
-                            char src[50];
-                            ULONG ipSenderAddr;
-                            USHORT ipSenderPort;
-
-                            vxsGetSockAddressAndPort(m_sockets.getSocket(socketIndex),
-                                                     		&ipSenderAddr, &ipSenderPort);
-                            vxsMakeDottedAddr(src, ntohl(ipSenderAddr));
-                            vxlReportEvent("vxsSendTo socket[%d]=%d from %s to %s\n",
+                            vxlReportEvent("vxsSendTo socket[%d]=%d from %s:%d to %s\n",
                                 socketIndex, m_sockets.getSocket(socketIndex), 
-                                src, dst);
+                                m_unicastAddresses.getSzIpAddress(socketIndex), sourcePort, dst);
                         }
 
-#ifndef WIN32
-                        int msglen = sizeof(struct iphdr) + sizeof(struct udphdr) + npduLen;
-
-                        pIpHdr->ihl = 5;
-                        pIpHdr->version = 4;
-                        pIpHdr->tot_len = htons(msglen);
-                        pIpHdr->id = 0;
-                        pIpHdr->ttl = 64; // hops
-                        pIpHdr->protocol = 17; // UDP
-                        pIpHdr->saddr = 0;
-                        pIpHdr->daddr = *((uint32_t*)destAddr);
-                        pIpHdr->check = 0;
-
-                        pUdpHdr->source = htons(sourcePort);
-                        pUdpHdr->dest = htons(destPort);
-                        pUdpHdr->len = htons(sizeof(struct udphdr) + npduLen);
-                        pUdpHdr->check = 0;
-
-                        pIpHdr->check = checksum((uint16_t*)msgBuffer, 20);
-#endif
-                        // Finally, send the LS/IP UDP packet
-#ifdef WIN32
-		                int nBytes = vxsSendTo( m_sockets.getSocket(socketIndex), (LPSTR)lsUdpPayload, npduLen, 0, vxsDest );
-#else
-		                int nBytes = vxsSendTo( m_sockets.getSocket(socketIndex), (LPSTR)msgBuffer, msglen, 0, vxsDest);
-#endif
+                        // Finally, send the LS/IP UDP packet.  The socket is bound to the source
+                        // address and LS/IP port, so the kernel builds the IP and UDP headers.
+                        // If its send buffer is full, have LonLink queue the packet until the
+                        // socket is writable rather than block the caller.
+                        VXSOCKET sendSocket = m_sockets.getSocket(socketIndex);
+		                int nBytes = vxsSendToNoWait( sendSocket, (LPSTR)lsUdpPayload, npduLen, vxsDest );
 		                vxsFreeSockaddr( vxsDest );
 		                if ( nBytes == npduLen )
 		                {
                             sts = LTSTS_OK;
 		                }
+                        else if ( nBytes == 0 )
+                        {
+                            m_txBlockedSocket = sendSocket;
+                            sts = LTSTS_QUEUEFULL;
+                        }
                     }
                     else
                     {
@@ -635,6 +604,7 @@ LtSts LonLinkIzoTDev::driverWrite(void *pData, short len)
                 }
                 else
                 {
+                    vxlReportEvent("LonLinkIzoTDev::driverWrite failed to find socket for source port %d\n", sourcePort);
                     dumpData("LonLinkIzoTDev::driverWrite failed to find socket for source address: ",  sourceAddr, sizeof(sourceAddr));
                 }
             }
@@ -843,7 +813,7 @@ LtSts LonLinkIzoTDev::bindUnicastAddress(int socketIndex, bool rebind)
             }
 
             // Set the isBound flag based on success or failure.
-            m_unicastAddresses.setIsBound(socketIndex, sts == LTSTS_OK);
+            setSocketBound(socketIndex, sts == LTSTS_OK);
             
             sts = LTSTS_OK;  // Ignore binding errors.  We can always fall back on an arbitrary address.
         }
@@ -892,7 +862,7 @@ void LonLinkIzoTDev::releaseUnicastAddress(int socketIndex)
     if (pUnicastAddress != NULL)
     {
         // It exists, so decrement the use count
-        if (pUnicastAddress->decrement() == 0)
+        if (m_unicastAddresses.release(socketIndex) == 0)
         {
             // Its zero, so close the socket and recompute the subnet membership
             m_sockets.closeSocket(socketIndex);
@@ -938,10 +908,10 @@ VXSOCKET LonLinkIzoTDev::SelectSocketToRead(int *socketIndex)
     return INVALID_SOCKET;
 }
 
-// Return the socketIndex corresponding to the specified pSourceAddress.
-// Return INVALID_SOCKET if there is no socket successfully bound to that
-// address.
-int LonLinkIzoTDev::SelectSourceSocket(const uint8_t *pSourceAddress)
+// Return the socketIndex corresponding to the specified pSourceAddress
+// and sourcePort.  Return INVALID_SOCKET if there is no socket successfully
+// bound to that address and port.
+int LonLinkIzoTDev::SelectSourceSocket(const uint8_t *pSourceAddress, uint16_t sourcePort)
 {
     // Find the socket
     int socketIndex = m_unicastAddresses.find(pSourceAddress, IPV4_ADDRESS_LEN);
@@ -954,8 +924,9 @@ int LonLinkIzoTDev::SelectSourceSocket(const uint8_t *pSourceAddress)
      	socketIndex = LON_LINK_IZOT_DEV_FIRST_SEND_SOCKET_INDEX;
     }
 #endif
-    // Make sure it's bound
-    if (!m_unicastAddresses.getIsBound(socketIndex))
+    // Make sure it's bound, and to the right port.
+    USHORT port;
+    if (!m_unicastAddresses.getIsBound(socketIndex, port) || port != sourcePort)
     {
         // Since its not bound its no good to us.
         socketIndex = IZOT_NULL_SOCKET_INDEX;
@@ -963,6 +934,23 @@ int LonLinkIzoTDev::SelectSourceSocket(const uint8_t *pSourceAddress)
     return socketIndex;
 }
 
+// Record whether the socket at socketIndex is bound to its unicast address.
+// The port is read back from the socket so that SelectSourceSocket checks 
+// the port actually bound.
+void LonLinkIzoTDev::setSocketBound(int socketIndex, bool isBound)
+{
+    ULONG ipAddr;
+    USHORT port = 0;
+
+    if (isBound && 
+        vxsGetSockAddressAndPort(m_sockets.getSocket(socketIndex), &ipAddr, &port) != OK)
+    {
+        vxlReportEvent("LonLinkIzoTDev::setSocketBound can't get the port of socketIndex=%d\n", socketIndex);
+        isBound = false;
+    }
+    m_unicastAddresses.setIsBound(socketIndex, isBound, port);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Multicast Membership
 ///////////////////////////////////////////////////////////////////////////////
@@ -1533,17 +1521,110 @@ uint8_t LonLinkIzoTDev::getArbitrarySourceAddress(uint8_t *pSourceIpAddress,
                                                   uint8_t *pEnclosedSource)
 {
     uint8_t enclosedSourceLen = 0;
+
+    // A device normally sends from its LS derived address, bound to its
+    // own socket.  That needs nothing enclosed, and is checked without
+    // the lock.
+    if (isDerivedSourceDomain(pDomainId, domainIdLen) &&
+        SelectSourceSocket(pSourceIpAddress, gLsUdpPort) != IZOT_NULL_SOCKET_INDEX)
+    {
+        return enclosedSourceLen;
+    }
+
     LonLinkIzoTLock lock(m_lock);
 
-    int socketIndex = IZOT_NULL_SOCKET_INDEX;
+    int socketIndex;
+    unsigned int hash = domainIdLen;
+    for (int i = 0; i < IPV4_ADDRESS_LEN; i++)
+    {
+        hash = hash*31 + pSourceIpAddress[i];
+    }
+    for (int i = 0; i < domainIdLen && i < LT_DOMAIN_LENGTH; i++)
+    {
+        hash = hash*31 + pDomainId[i];
+    }
+    SourceAddrCtx *pCtx = &m_sourceAddrCtx[hash & (LON_LINK_IZOT_DEV_SOURCE_CTX_CACHE_SIZE-1)];
+    if (pCtx->generation == m_unicastAddresses.getGeneration() && 
+        pCtx->domainLen == domainIdLen &&
+        memcmp(pCtx->sourceIpAddr, pSourceIpAddress, IPV4_ADDRESS_LEN) == 0 &&
+        memcmp(pCtx->domainId, pDomainId, domainIdLen) == 0)
+    {
+        // Same choice as last time
+        socketIndex = pCtx->socketIndex;
+        enclosedSourceLen = pCtx->enclosedSourceLen;
+    }
+    else
+    {
+        socketIndex = selectArbitrarySourceSocket(pSourceIpAddress, pDomainId, domainIdLen, enclosedSourceLen);
+        pCtx->generation = 0;
+        if (domainIdLen <= LT_DOMAIN_LENGTH)
+        {
+            pCtx->generation = m_unicastAddresses.getGeneration();
+            memcpy(pCtx->sourceIpAddr, pSourceIpAddress, IPV4_ADDRESS_LEN);
+            pCtx->domainLen = domainIdLen;
+            memcpy(pCtx->domainId, pDomainId, domainIdLen);
+            pCtx->socketIndex = socketIndex;
+            pCtx->enclosedSourceLen = enclosedSourceLen;
+        }
+    }
+
+    if (enclosedSourceLen > (IPV6_LSUDP_NPDU_OFF_ARB_SOURCE_NODE+1))
+    {
+        // Need to include the domain plus the source subnet/node
+        int encodedDomainLen = 0;
+        switch (domainIdLen)
+        {
+        case 1: encodedDomainLen = 1; break;
+        case 3: encodedDomainLen = 2; break;
+        case 6: encodedDomainLen = 3; break;
+        }
+        pEnclosedSource[IPV6_LSUDP_NPDU_OFF_ARB_SOURCE_DMLEN] = encodedDomainLen;
+        memcpy(&pEnclosedSource[IPV6_LSUDP_NPDU_OFF_ARB_SOURCE_DM], pDomainId, domainIdLen);
+    }
+
+    if (enclosedSourceLen != 0)
+    {
+        // Using an arbitrary address. Include the source subnet/node
+        pEnclosedSource[IPV6_LSUDP_NPDU_OFF_ARB_SOURCE_SUBNET] = pSourceIpAddress[IPV6_LSIP_UCADDR_OFF_SUBNET];
+        pEnclosedSource[IPV6_LSUDP_NPDU_OFF_ARB_SOURCE_NODE] = pSourceIpAddress[IPV6_LSIP_UCADDR_OFF_NODE] & 0x7f;
+        if (enclosedSourceLen > (IPV6_LSUDP_NPDU_OFF_ARB_SOURCE_NODE+1))
+        {
+            // Domain is included, so set the flag
+            pEnclosedSource[IPV6_LSUDP_NPDU_OFF_ARB_SOURCE_DMFLAG] |= IPV6_LSUDP_NPDU_MASK_ARB_SOURCE_DMFLG;
+        }
+
+        // Copy the arbitrary source IP address
+        memcpy(pSourceIpAddress, m_unicastAddresses.getIpAddress(socketIndex), IPV4_ADDRESS_LEN);
+    }
+
+    return enclosedSourceLen;
+}
+
+// Return true if the LS derived IP addresses of the domain can be used as
+// source addresses.
+bool LonLinkIzoTDev::isDerivedSourceDomain(const uint8_t *pDomainId, int domainIdLen)
+{
 #if UIP_CONF_IPV6
-    if (domainIdLen == 6)
+    return domainIdLen == 6;
 #else
-    if (domainIdLen <= 1 || (domainIdLen == 3 && pDomainId[2] == 0))
+    return domainIdLen <= 1 || (domainIdLen == 3 && pDomainId[2] == 0);
 #endif
+}
+
+// Choose the socket to send from when the LS derived source address
+// pSourceIpAddress is wanted.  This implementation uses arbitrary IP
+// addresses unless pSourceIpAddress is currently bound to a socket.
+int LonLinkIzoTDev::selectArbitrarySourceSocket(const uint8_t *pSourceIpAddress, 
+                                                const uint8_t *pDomainId, int domainIdLen,
+                                                uint8_t &enclosedSourceLen)
+{
+    int socketIndex = IZOT_NULL_SOCKET_INDEX;
+
+    enclosedSourceLen = 0;
+    if (isDerivedSourceDomain(pDomainId, domainIdLen))
     {
         // See if we have a bound socket for this source IP address.
-        socketIndex = SelectSourceSocket(pSourceIpAddress);
+        socketIndex = SelectSourceSocket(pSourceIpAddress, gLsUdpPort);
 
         if (socketIndex == IZOT_NULL_SOCKET_INDEX)
         {
@@ -1579,34 +1660,9 @@ uint8_t LonLinkIzoTDev::getArbitrarySourceAddress(uint8_t *pSourceIpAddress,
         {
             // Need to include the domain plus the source subnet/node
             enclosedSourceLen = IPV6_LSUDP_NPDU_OFF_ARB_SOURCE_DM + domainIdLen;
-            int encodedDomainLen = 0;
-            switch (domainIdLen)
-            {
-            case 1: encodedDomainLen = 1; break;
-            case 3: encodedDomainLen = 2; break;
-            case 6: encodedDomainLen = 3; break;
-            }
-            pEnclosedSource[IPV6_LSUDP_NPDU_OFF_ARB_SOURCE_DMLEN] = encodedDomainLen;
-            memcpy(&pEnclosedSource[IPV6_LSUDP_NPDU_OFF_ARB_SOURCE_DM], pDomainId, domainIdLen);
         }
     }
-
-    if (enclosedSourceLen != 0)
-    {
-        // Using an arbitrary address. Include the source subnet/node
-        pEnclosedSource[IPV6_LSUDP_NPDU_OFF_ARB_SOURCE_SUBNET] = pSourceIpAddress[IPV6_LSIP_UCADDR_OFF_SUBNET];
-        pEnclosedSource[IPV6_LSUDP_NPDU_OFF_ARB_SOURCE_NODE] = pSourceIpAddress[IPV6_LSIP_UCADDR_OFF_NODE] & 0x7f;
-        if (enclosedSourceLen > (IPV6_LSUDP_NPDU_OFF_ARB_SOURCE_NODE+1))
-        {
-            // Domain is included, so set the flag
-            pEnclosedSource[IPV6_LSUDP_NPDU_OFF_ARB_SOURCE_DMFLAG] |= IPV6_LSUDP_NPDU_MASK_ARB_SOURCE_DMFLG;
-        }
-
-        // Copy the arbitrary source IP address
-        memcpy(pSourceIpAddress, m_unicastAddresses.getIpAddress(socketIndex), IPV4_ADDRESS_LEN);
-    }
-
-    return enclosedSourceLen;
+    return socketIndex;
 }
 
  /******************************************************************************
@@ -1626,7 +1682,7 @@ uint8_t LonLinkIzoTDev::getArbitrarySourceAddress(uint8_t *pSourceIpAddress,
 *****************************************************************************/
 bool LonLinkIzoTDev::isUnicastAddressSupported(const uint8_t *ipAddress)
 {
-    return SelectSourceSocket(ipAddress) != IZOT_NULL_SOCKET_INDEX;
+    return SelectSourceSocket(ipAddress, gLsUdpPort) != IZOT_NULL_SOCKET_INDEX;
 }
 
  /******************************************************************************
@@ -1653,7 +1709,7 @@ int LonLinkIzoTDev::queryIpAddr(LtDomain &domain, byte subnetId, byte nodeId, by
     byte domainId[LT_DOMAIN_LENGTH];
     domain.getData(domainId);
     ipv6_gen_ls_subnet_node_addr(domainId, domain.getLength(), subnetId, nodeId, ipAddress);
-    if (SelectSourceSocket(ipAddress) == IZOT_NULL_SOCKET_INDEX)
+    if (SelectSourceSocket(ipAddress, gLsUdpPort) == IZOT_NULL_SOCKET_INDEX)
     {
         // No socket found.  Just pick one. 
         int socketIndex;
@@ -1670,68 +1726,6 @@ int LonLinkIzoTDev::queryIpAddr(LtDomain &domain, byte subnetId, byte nodeId, by
     return IPV4_ADDRESS_LEN;
 }
 
-void
-LonLinkIzoTDev::sendToProtocolAnalyser(byte *pData, bool crcIncluded)
-{
-	if  (m_ProtocolAnalyserFn)
-	{
-		short len =  pData[1];
-		if (!crcIncluded)
-		{
-			// Add two crc bytes because the Protocol Analyser expects it
-			// Zero out the CRC bytes
-			pData[len+2] = 0x00;
-			pData[len+3] = 0x00;
-			// Increment length field inside SICB
-			pData[1] = len + 2;
-			// Increment length of buffer sent to LSPA.mod
-			len += 2;
-		}
-		(*m_ProtocolAnalyserFn)((char*)pData, len + 2);
-		if (!crcIncluded)
-		{
-			// Decrement length field inside SICB back to original
-			pData[1] = len - 2;
-		}
-	}
-}
-
- /******************************************************************************
-   Method:  registerProtocolAnalyzerCallback
-
-   Summary:
-        This routine is used by the application to register the callback routine
-        to hook protocol analyzer data sink.
-
-   Parameters:
-        fn:     The callback routine, passing the data packet and the length
-
-   Return:   None
-
-*****************************************************************************/
-void LonLinkIzoTDev::registerProtocolAnalyzerCallback(void (*fn)(char*, int))
-{
-	m_ProtocolAnalyserFn = fn;
-}
-
- /******************************************************************************
-  	Method:  unregisterProtocolAnalyzerCallback
-
-    Summary:
-        This routine is used by the application to un-register the callback routine
-        to hook protocol analyzer data sink.
-
-    Parameters:
-        None
-
-    Return:   None
-
- *****************************************************************************/
-void LonLinkIzoTDev::unregisterProtocolAnalyzerCallback()
-{
-	m_ProtocolAnalyserFn = NULL;
-}
-
 ///////////////////////////////////////////////////////////////////////////////
 // Debugging 
 ///////////////////////////////////////////////////////////////////////////////
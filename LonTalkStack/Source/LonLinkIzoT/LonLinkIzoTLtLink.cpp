@@ -50,14 +50,11 @@ LonLinkIzoTLtLink* LonLinkIzoTLtLink::getInstance()
 
 LonLinkIzoTLtLink::LonLinkIzoTLtLink(): LonLinkIzoT(1)
 {
-	_paFn = NULL;
-
 	m_instance = this;
 }
 
 LonLinkIzoTLtLink::~LonLinkIzoTLtLink()
 {
-	_paFn = NULL;
 }
 
 //int sockfd;
@@ -129,13 +126,19 @@ LtSts LonLinkIzoTLtLink::driverWrite(void *pData, short len) {
 	LtSts	sts = LTSTS_ERROR;
 	char *pPacket = (char *)pData;
 	// LtL2Sicb *msg = (LtL2Sicb*)pPacket;
-	int nBytes = write( sockfd, (char*)pPacket, len);
+	int nBytes = vxsSendNoWait( sockfd, (char*)pPacket, len);
 	//int nBytes = write( sockfd, (char*)msg->data, msg->len);
 	//int nBytes = vxsSend( sockfd, (char*)msg->data, msg->len, 0);
 	if ( nBytes == len )
 	{
 		sts = LTSTS_OK;
 	}
+	else if ( nBytes == 0 )
+	{
+		// No room in the socket; LonLink queues it until there is
+		m_txBlockedSocket = sockfd;
+		sts = LTSTS_QUEUEFULL;
+	}
 	dumpData("driverWrite", (uint8_t *)pPacket, nBytes);
 	return(sts);
 }
@@ -174,41 +177,6 @@ void LonLinkIzoTLtLink::setLsAddrMappingConfig(int stackIndex,
                                 ULONG lsAddrMappingAgeLimit) {
 }
 
-void LonLinkIzoTLtLink::sendToProtocolAnalyser(byte *pData, bool crcIncluded)
-{
-	if  (_paFn)
-	{
-		short len =  pData[1];
-		if (!crcIncluded)
-		{
-			// Add two crc bytes because the Protocol Analyser expects it
-			// Zero out the CRC bytes
-			pData[len+2] = 0x00;
-			pData[len+3] = 0x00;
-			// Increment length field inside SICB
-			pData[1] = len + 2;
-			// Increment length of buffer sent to LSPA.mod
-			len += 2;
-		}
-		(*_paFn)((char*)pData, len + 2);
-		if (!crcIncluded)
-		{
-			// Decrement length field inside SICB back to original
-			pData[1] = len - 2;
-		}
-	}
-}
-
-void LonLinkIzoTLtLink::registerProtocolAnalyzerCallback(void (*fn)(char*, int))
-{
-	_paFn = fn;
-}
-
-void LonLinkIzoTLtLink::unregisterProtocolAnalyzerCallback()
-{
-	_paFn = NULL;
-}
-
 ///////////////////////////////////////////////////////////////////////////////
 // Debugging
 ///////////////////////////////////////////////////////////////////////////////
@@ -71,12 +71,10 @@ LonLinkIzoTRNIEthLink::LonLinkIzoTRNIEthLink(int ipManagementOptions): LonLinkIz
     m_ipManagementOptions = ipManagementOptions;
     m_lastMsgSize = 0;
     memset(m_lastMsg, 0, sizeof(m_lastMsg));
-    _paFn = NULL;
 }
 
 LonLinkIzoTRNIEthLink::~LonLinkIzoTRNIEthLink()
 {
-    _paFn = NULL;
 }
 
 LtSts LonLinkIzoTRNIEthLink::driverOpen(const char* pName)
@@ -354,12 +352,18 @@ LtSts LonLinkIzoTRNIEthLink::driverWrite(void *pData, short len)
 	                vxsFreeSockaddr(vxsSrc);
 	            }
 	            // Finally, send the LS/IP UDP packet
-	            int nBytes = vxsSendTo( m_sendSocket, (LPSTR)msgBuffer, msglen, 0, vxsDest );
+	            int nBytes = vxsSendToNoWait( m_sendSocket, (LPSTR)msgBuffer, msglen, vxsDest );
 	            vxsFreeSockaddr( vxsDest );
 	            if ( nBytes == msglen )
 	            {
 	                sts = LTSTS_OK;
 	            }
+	            else if ( nBytes == 0 )
+	            {
+	                // No room in the socket; LonLink queues it until there is
+	                m_txBlockedSocket = m_sendSocket;
+	                sts = LTSTS_QUEUEFULL;
+	            }
 	        }
 	        else
 	        {
@@ -415,41 +419,6 @@ void LonLinkIzoTRNIEthLink::setLsAddrMappingConfig(int stackIndex,
 {
 }
 
-void LonLinkIzoTRNIEthLink::sendToProtocolAnalyser(byte *pData, bool crcIncluded)
-{
-    if  (_paFn)
-    {
-        short len =  pData[1];
-        if (!crcIncluded)
-        {
-            // Add two crc bytes because the Protocol Analyzer expects it
-            // Zero out the CRC bytes
-            pData[len+2] = 0x00;
-            pData[len+3] = 0x00;
-            // Increment length field inside SICB
-            pData[1] = len + 2;
-            // Increment length of buffer sent to LSPA.mod
-            len += 2;
-        }
-        (*_paFn)((char*)pData, len + 2);
-        if (!crcIncluded)
-        {
-            // Decrement length field inside SICB back to original
-            pData[1] = len - 2;
-        }
-    }
-}
-
-void LonLinkIzoTRNIEthLink::registerProtocolAnalyzerCallback(void (*fn)(char*, int))
-{
-    _paFn = fn;
-}
-
-void LonLinkIzoTRNIEthLink::unregisterProtocolAnalyzerCallback()
-{
-    _paFn = NULL;
-}
-
 ///////////////////////////////////////////////////////////////////////////////
 // Debugging
 ///////////////////////////////////////////////////////////////////////////////
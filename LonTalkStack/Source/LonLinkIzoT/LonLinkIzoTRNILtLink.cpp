@@ -62,7 +62,6 @@ LonLinkIzoTRNILtLink* LonLinkIzoTRNILtLink::getInstance()
 
 LonLinkIzoTRNILtLink::LonLinkIzoTRNILtLink(): LonLinkIzoT(1)
 {
-	_paFn = NULL;
 	m_lonSocket = -1;
 	m_sendSocket = -1;
 
@@ -72,7 +71,6 @@ LonLinkIzoTRNILtLink::LonLinkIzoTRNILtLink(): LonLinkIzoT(1)
 
 LonLinkIzoTRNILtLink::~LonLinkIzoTRNILtLink()
 {
-	_paFn = NULL;
 }
 
 LtSts LonLinkIzoTRNILtLink::driverOpen(const char* pName)
@@ -245,10 +243,16 @@ LtSts LonLinkIzoTRNILtLink::driverWrite(void *pData, short len)
 {
 	LtSts	sts = LTSTS_ERROR;
 	char *pPacket = (char *)pData;
-    int nBytes = write( m_sendSocket, (char*)pPacket, len);
+    int nBytes = vxsSendNoWait( m_sendSocket, (char*)pPacket, len);
 
     if ( nBytes == len )
         sts = LTSTS_OK;
+    else if ( nBytes == 0 )
+    {
+        // No room in the socket; LonLink queues it until there is
+        m_txBlockedSocket = m_sendSocket;
+        sts = LTSTS_QUEUEFULL;
+    }
 
     if (sts == LTSTS_OK)
          dumpData("driverWrite", (uint8_t *)pPacket, nBytes);
@@ -295,41 +299,6 @@ void LonLinkIzoTRNILtLink::setLsAddrMappingConfig(int stackIndex,
 {
 }
 
-void LonLinkIzoTRNILtLink::sendToProtocolAnalyser(byte *pData, bool crcIncluded)
-{
-	if  (_paFn)
-	{
-		short len =  pData[1];
-		if (!crcIncluded)
-		{
-			// Add two crc bytes because the Protocol Analyzer expects it
-			// Zero out the CRC bytes
-			pData[len+2] = 0x00;
-			pData[len+3] = 0x00;
-			// Increment length field inside SICB
-			pData[1] = len + 2;
-			// Increment length of buffer sent to LSPA.mod
-			len += 2;
-		}
-		(*_paFn)((char*)pData, len + 2);
-		if (!crcIncluded)
-		{
-			// Decrement length field inside SICB back to original
-			pData[1] = len - 2;
-		}
-	}
-}
-
-void LonLinkIzoTRNILtLink::registerProtocolAnalyzerCallback(void (*fn)(char*, int))
-{
-	_paFn = fn;
-}
-
-void LonLinkIzoTRNILtLink::unregisterProtocolAnalyzerCallback()
-{
-	_paFn = NULL;
-}
-
 ///////////////////////////////////////////////////////////////////////////////
 // Debugging
 ///////////////////////////////////////////////////////////////////////////////
@@ -94,12 +94,16 @@ public:
     // currently bound.
     bool getRebind() { return m_useCount !=0 && !m_isBound; }
     void setIsBound(bool isBound) { m_isBound = isBound; }
+    // Get or set the local port, in host order, that the socket is bound to.
+    USHORT getPort() { return m_port; }
+    void setPort(USHORT port) { m_port = port; }
 
     // Get the IP address in dotted format
     const char* getSzIpAddress(void) { return m_szIpAddress; }
 
     // Get the IP address in network byte order
     const byte *getIpAddress(void)   { return m_ipAddress; }
+    int getIpAddrLen(void)           { return m_ipAddrLen; }
 
     // Copy the ip address in network byte order to a buffer. Return true if successful
     bool getIpAddress(void *pAddr, int bufferSize);
@@ -109,6 +113,7 @@ public:
 
 private:
     bool m_isBound;     // IP address is currently bound to a socket
+    USHORT m_port;      // Local port in host order while bound, else 0
     int m_useCount;     // Number of devices using this address.
     int m_ipAddrLen;    // length of address.
     byte m_ipAddress[IZOT_MAX_IP_ADDR_SIZE];        // IP address in network order
@@ -149,7 +154,7 @@ public:
     ~IzotUnicastAddresses(void);
 
     // Return the socket index corresponding to the specified ipAddress
-    // or IZOT_NULL_SOCKET_INDEX.
+    // or IZOT_NULL_SOCKET_INDEX.  Doesn't take the lock.
     int find(const byte *ipAddress, int ipAddrLen);
 
     // Set the IP address in network byte order for the specified socket index.  
@@ -165,20 +170,31 @@ public:
     // Remove the ipAddress from the map.
     int remove(const byte *ipAddress, int ipAddrLen);
 
+    // Decrement the use count of the address at socketIndex and return the
+    // new count.
+    int release(int socketIndex);
+
     // Close the map
     void close(void);
 
     // Return true if the address at socketIndex is properly bound to the 
-    // socket at socketIndex
+    // socket at socketIndex.  Doesn't take the lock.
     bool getIsBound(int socketIndex);
+    // The same, also returning the port it is bound to, or 0, as read at
+    // the same time.  Doesn't take the lock.
+    bool getIsBound(int socketIndex, USHORT &port);
 
     // Return true if the address at socketIndex is in use but is NOT
     // properly bound to the socket at socketIndex
     bool getRebind(int socketIndex);
 
     // Indicate wheter the address at socketIndex is properly bound to 
-    // the socket at socketIndex
-    void setIsBound(int socketIndex, bool isBound);
+    // the socket at socketIndex, and the local port it is bound to
+    void setIsBound(int socketIndex, bool isBound, USHORT port = 0);
+
+    // Return the local port, in host order, that the address at socketIndex
+    // is bound to, or 0 if it is not bound.  Doesn't take the lock.
+    USHORT getPort(int socketIndex);
 
 
     // Get the IP address in network byte order at socketIndex
@@ -200,12 +216,66 @@ public:
     // Return true if the socketIndex falls within the map.
     bool validSocketIndex(int socketIndex);
 
+    // Return a count that changes whenever an address is added, removed,
+    // bound or unbound.  Never 0.
+    ULONG getGeneration(void) { return m_generation; }
+
 private:
+    // One entry of the index.  Holds copies of the address and binding of
+    // a map entry, so that lookups never touch m_map, which set may
+    // reallocate.
+    struct IndexEntry
+    {
+        int     next;       // Next socket index in the bucket
+        int     ipAddrLen;  // 0 if the map entry isn't in use
+        bool    isBound;
+        USHORT  port;
+        byte    ipAddress[IZOT_MAX_IP_ADDR_SIZE];
+    };
+
+    // Hash index of the addresses in use.  heads holds the first socket
+    // index in each bucket and the entries chain the socket indices of a
+    // bucket together, both terminated by IZOT_NULL_SOCKET_INDEX.  There is
+    // one entry per bucket, and size is a power of 2 no smaller than the
+    // map.
+    struct Index
+    {
+        int         size;
+        int        *heads;
+        IndexEntry *entries;
+        Index      *pNextRetired;
+    };
+
+    // Rebuild the hash index after the set of addresses in use changes.
+    void rebuildIndex(void);
+    // Hash an IP address into the range 0..size-1
+    static int hashIpAddress(const byte *ipAddress, int ipAddrLen, int size);
+    // Look up ipAddress in pIndex, starting with the last one found.
+    int lookup(Index *pIndex, const byte *ipAddress, int ipAddrLen);
+    // Copy the index entry for socketIndex without the lock.  Return false
+    // if socketIndex isn't in the index.
+    bool readIndexEntry(int socketIndex, IndexEntry &entry);
+    // Keep an index that is no longer used until the map is destroyed.
+    void retireIndex(Index *pIndex);
+
     int                 m_numEntries;   // Number of elements in the array map
     int                 m_reallocSize;  // Number of elmenets to increase the array by
     IzotUnicastAddress *m_map;          // The map
     SEM_ID              m_lock;         // The lock to protect everything.
 
+    // The index used by find, getIsBound and getPort, which don't take the
+    // lock.  A rebuild fills in m_pSpare and then swaps it with m_pIndex,
+    // so readers never wait for one.  It bumps m_indexSeq before it starts
+    // on the spare, which a reader that started earlier may be reading, and
+    // readers retry if m_indexSeq changed under them.
+    Index * volatile    m_pIndex;
+    Index              *m_pSpare;
+    volatile ULONG      m_indexSeq;
+    // Indices that became too small for the map.  A reader may still be
+    // using one, so they are kept until the map is destroyed.
+    Index              *m_pRetired;
+    volatile int        m_lastFound;    // Result of a recent successful find
+    volatile ULONG      m_generation;   // See getGeneration
 };
 
 // 
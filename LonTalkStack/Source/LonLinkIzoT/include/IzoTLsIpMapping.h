@@ -182,6 +182,10 @@ public:
     void link(IzoTLsIpMappingSubnetInfo *pNext);
         // Unlink this object from pPrev
     void unlink(IzoTLsIpMappingSubnetInfo *pPrev);
+        // Get or set the next IzoTLsIpMappingSubnetInfo in the same domain
+        // index bucket.
+    IzoTLsIpMappingSubnetInfo *getNextInBucket(void) { return m_pNextInBucket; }
+    void setNextInBucket(IzoTLsIpMappingSubnetInfo *p) { m_pNextInBucket = p; }
 private:
         // The LS domain ID
     LtDomain m_domainId;
@@ -190,4 +194,6 @@ private:
     IzoTLsIpMappingNodeInfo *m_subnets[IZOT_MAX_SUBNET_ID+1];  
         // Link to the next domain
     IzoTLsIpMappingSubnetInfo *m_pNext;
+        // Link to the next domain in the same domain index bucket
+    IzoTLsIpMappingSubnetInfo *m_pNextInBucket;
 };
@@ -48,6 +48,10 @@
 
 #define LON_LINK_IZOT_DEFUALT_AGING_INTERVAL (5*60*1000) // 5 minutes
 
+#define LON_LINK_IZOT_LS_IP_MAP_BUCKETS 16  // Buckets in the LS/IP mapping domain index (power of 2)
+#define LON_LINK_IZOT_DEST_CTX_CACHE_SIZE 256 // Entries in the destination address cache (power of 2)
+#define LON_LINK_IZOT_RETRANSMIT_TICKS 20   // Retry period for queued transmits
+
 ///////////////////////////////////////////////////////////////////////////////
 // 
 //  Class:   LonLinkIzoTLock
@@ -89,6 +93,16 @@ private:
     SEM_ID m_lock;
 };
 
+// Orders the accesses of the sequence counts that let senders look up
+// addresses without taking the link lock.  A writer holds the lock and
+// makes the count odd while it updates; a reader retries if the count was
+// odd or changed while it read.
+#ifdef WIN32
+#define LON_LINK_IZOT_BARRIER()     MemoryBarrier()
+#else
+#define LON_LINK_IZOT_BARRIER()     __sync_synchronize()
+#endif
+
 ///////////////////////////////////////////////////////////////////////////////
 // 
 //  Class:   LonLinkIzoTSocketsRef
@@ -230,6 +244,9 @@ public:
 	// Retransmit timer routines
 	void transmitTimerRoutine();
 
+    // Drain the transmit queue as soon as the blocked socket has room again
+	void txDrainTask();
+
     // Process aging timeout, to handle arbitrary IP address aging
 	void agingTimerRoutine(void);
 
@@ -381,6 +398,11 @@ public:
     *****************************************************************************/
     virtual bool isUnicastAddressSupported(const uint8_t *ipAddress) { return true; }
 
+    // The IzoT links build each received frame from an IP or L2 packet, so
+    // there is no CRC for the client to verify, and they need not compute one.
+    // Links that pass frames through from the wire must override this.
+    virtual boolean isCrcTrusted() { return true; }
+
     virtual LtSts setUnicastAddress(int stackIndex, int domainIndex, int subnetNodeIndex,
                             byte *domainId, int domainLen, byte subnetId, byte nodeId) = 0;
     virtual void deregisterStack(int stackIndex) = 0;
@@ -411,6 +433,12 @@ protected:
 	virtual LtSts driverRegisterEvent();
 	virtual void driverReceiveEvent();
 	virtual void startDelayedRetransmit();
+
+    // Retry the transmit queue.  Called with the link locked; returns the
+    // number of packets that were completed.
+    int retransmitQueued();
+    void startRetransmitTimer();
+    void stopTxDrainTask();
 	
     // Need to override these to fake out the rest of the system - because
     // there is no neuron.
@@ -423,6 +451,17 @@ protected:
 
 	WDOG_ID				m_wdTimer;			// timer for transmits
 
+        // When a driverWrite returns LTSTS_QUEUEFULL because a socket's send
+        // buffer is full, the derived class records that socket here and the
+        // drain task waits for it to become writable.  INVALID_SOCKET means
+        // wait for any of m_sockets.  The drain task also retries every
+        // retransmit period, for drivers that can't report writability; the
+        // retransmit timer is used only if the task can't be started.
+    VXSOCKET            m_txBlockedSocket;
+    SEM_ID              m_txDrainSem;       // given when packets are queued
+    int                 m_tidTxDrain;       // drain task, started on first use
+    volatile boolean    m_bExitTxDrain;
+
 
    ///////////////////////////////////////////////////////////////////////////
     // Locking
@@ -462,6 +501,44 @@ protected:
         // arbitrary IP address.
     class IzoTLsIpMappingSubnetInfo *m_pLsIpMapHead;
 
+        // Hash index of the same objects by domain, chained through
+        // getNextInBucket, and the one most recently found.  Entries are
+        // only freed when the link is destroyed, so these never dangle.
+    class IzoTLsIpMappingSubnetInfo *m_lsIpMapIndex[LON_LINK_IZOT_LS_IP_MAP_BUCKETS];
+    class IzoTLsIpMappingSubnetInfo *m_pLsIpMapLast;
+
+        // The outcome of getArbitraryDestAddress for one LS destination, so
+        // that steady traffic to the same device doesn't repeat the mapping
+        // lookups.  An entry is only valid while its generation matches
+        // m_lsIpMapGeneration.  Entries are written with the lock held and
+        // m_destAddrCtxSeq of the entry odd, so that a hit can be read
+        // without the lock.
+    struct DestAddrCtx
+    {
+        ULONG   generation;     // 0 if the entry is unused
+        byte    domainLen;
+        byte    domainId[LT_DOMAIN_LENGTH];
+        byte    subnetId;
+        byte    nodeId;
+        bool    useDerived;     // Destination is known to use its LS derived address
+        bool    hasArbitrary;   // Destination has a known arbitrary address
+        byte    arbitraryIpAddr[4]; // REMINDER: IPV6 support
+    };
+    DestAddrCtx m_destAddrCtx[LON_LINK_IZOT_DEST_CTX_CACHE_SIZE];
+    volatile ULONG m_destAddrCtxSeq[LON_LINK_IZOT_DEST_CTX_CACHE_SIZE];
+
+        // Copy the DestAddrCtx at index to ctx, without the lock.  Return
+        // false if it doesn't hold the outcome for the destination.
+    bool readDestAddrCtx(int index, DestAddrCtx &ctx, const uint8_t *pDomainId, 
+                         uint8_t domainLen, uint8_t subnetId, uint8_t nodeId);
+        // Replace the DestAddrCtx at index.  Call with the lock held.
+    void writeDestAddrCtx(int index, const DestAddrCtx &ctx);
+
+        // Bumped whenever the LS/IP mapping changes, invalidating every
+        // DestAddrCtx at once.
+    volatile ULONG m_lsIpMapGeneration;
+    void lsIpMapChanged(void);
+
     ///////////////////////////////////////////////////////////////////////////
     // Arbitrary IP Address Aging
     ///////////////////////////////////////////////////////////////////////////
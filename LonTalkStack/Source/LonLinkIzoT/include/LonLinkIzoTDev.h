@@ -58,6 +58,12 @@
 // Time between consecutive announcements 
 #define LON_LINK_IZOT_DEV_ANNOUNCEMENT_THROTTLE 500   
 
+// Most packets driverReadBatch reads from a socket with one system call
+#define LON_LINK_IZOT_DEV_RX_BATCH_SIZE 8
+
+// Entries in the source address cache (power of 2)
+#define LON_LINK_IZOT_DEV_SOURCE_CTX_CACHE_SIZE 16
+
 ///////////////////////////////////////////////////////////////////////////////
 // 
 //  Class:   LonLinkIzoTDev
@@ -275,40 +281,6 @@ public:
     *****************************************************************************/
     int queryIpAddr(LtDomain &domain, byte subnetId, byte nodeId, byte *ipAddress);
 
-    ///////////////////////////////////////////////////////////////////////////
-    // Protocol Analyzer support routines
-    ///////////////////////////////////////////////////////////////////////////
-
-    /******************************************************************************
-  	  Method:  registerProtocolAnalyzerCallback
-
-      Summary:
-        This routine is used by the application to register the callback routine
-        to hook protocol analyzer data sink.
-
-      Parameters:
-        fn:     The callback routine, passing the data packet and the length
-
-      Return:   None
-
-    *****************************************************************************/
-    void registerProtocolAnalyzerCallback(void (*fn)(char*, int));
-
-    /******************************************************************************
-  	  Method:  unregisterProtocolAnalyzerCallback
-
-      Summary:
-        This routine is used by the application to un-register the callback routine
-        to hook protocol analyzer data sink.
-
-      Parameters:
-        None
-
-      Return:   None
-
-    *****************************************************************************/
-   	void unregisterProtocolAnalyzerCallback();
-
    	static LonLinkIzoTDev* getInstance();
 protected:
 
@@ -320,8 +292,14 @@ protected:
 	virtual LtSts driverOpen(const char* pName);
 	virtual void driverClose();
 	virtual LtSts driverRead(void *pData, short len);
+#ifndef WIN32
+	virtual LtSts driverReadBatch(byte *pData, short len, int nMaxPkts, int &nPkts);
+#endif
 	virtual LtSts driverWrite(void *pData, short len);
-	virtual void sendToProtocolAnalyser(byte* pData, bool crcIncluded = true);
+
+    // Convert a LS/IP UDP payload read from the socket to an LTVx SICB in pData
+    LtSts convertReceivedPacket(int socketIndex, VXSOCKET socket, char *msgBuffer, int msgLen, 
+                                VXSOCKADDR sourceAddr, ULONG recvDestAddress, void *pData, short len);
 
     ///////////////////////////////////////////////////////////////////////////////
     // General Interface variables
@@ -342,14 +320,44 @@ protected:
     // Release the unicast address at the associated socketIndex
     void releaseUnicastAddress(int socketIndex);
 
+    // Record whether the socket at socketIndex is bound to its unicast
+    // address, along with the local port it is bound to.
+    void setSocketBound(int socketIndex, bool isBound);
+
     // Find the next socket to read, and return the socket and the
     // socket index.  If no socket has any available data, return INVALID_SOCKET 
     VXSOCKET SelectSocketToRead(int *socketIndex);
 
-    // Return the socketIndex corresponding to the specified pSourceAddress.
-    // Return INVALID_SOCKET if there is no socket successfully bound to that
-    // address.
-    int SelectSourceSocket(const uint8_t *pSourceAddress);
+    // Return the socketIndex corresponding to the specified pSourceAddress
+    // and sourcePort.  Return INVALID_SOCKET if there is no socket 
+    // successfully bound to that address and port.
+    int SelectSourceSocket(const uint8_t *pSourceAddress, uint16_t sourcePort);
+
+    // Return true if the LS derived IP addresses of the domain can be used
+    // as source addresses.
+    static bool isDerivedSourceDomain(const uint8_t *pDomainId, int domainIdLen);
+
+    // Choose the socket to send from when the LS derived source address
+    // pSourceIpAddress is wanted.  enclosedSourceLen is set to the length of
+    // the source address information that must then be enclosed in the PDU.
+    int selectArbitrarySourceSocket(const uint8_t *pSourceIpAddress, 
+                                    const uint8_t *pDomainId, int domainIdLen,
+                                    uint8_t &enclosedSourceLen);
+
+    // The outcome of selectArbitrarySourceSocket for one source address, so
+    // that sends from a device without a bound socket of its own don't
+    // repeat the socket search.  An entry is only valid while generation
+    // matches the generation of m_unicastAddresses.
+    struct SourceAddrCtx
+    {
+        ULONG   generation;     // 0 if the entry is unused
+        byte    sourceIpAddr[IZOT_MAX_IP_ADDR_SIZE];
+        byte    domainLen;
+        byte    domainId[LT_DOMAIN_LENGTH];
+        int     socketIndex;
+        uint8_t enclosedSourceLen;
+    };
+    SourceAddrCtx m_sourceAddrCtx[LON_LINK_IZOT_DEV_SOURCE_CTX_CACHE_SIZE];
 
      // Collection of unicast addresses, indexed by socket index.  The first
     // is the "any" IP address.  Others are added as necessary derived from
@@ -365,6 +373,14 @@ protected:
     // in round robin fashon
     int m_lastSocketRead;
 
+#ifndef WIN32
+    // UDP payloads, lengths, source and destination addresses filled in by driverReadBatch
+    char m_rxBatchBuf[LON_LINK_IZOT_DEV_RX_BATCH_SIZE][MAX_UDP_PACKET];
+    int m_rxBatchLen[LON_LINK_IZOT_DEV_RX_BATCH_SIZE];
+    VXSOCKADDR m_rxBatchAddr[LON_LINK_IZOT_DEV_RX_BATCH_SIZE];
+    ULONG m_rxBatchDest[LON_LINK_IZOT_DEV_RX_BATCH_SIZE];
+#endif
+
     ///////////////////////////////////////////////////////////////////////////////
     // Multicast Membership
     ///////////////////////////////////////////////////////////////////////////////
@@ -430,9 +446,6 @@ protected:
     int                 m_announceTimerEnabled; // True if announcements are enabled
     int                 m_announceIndex;        // Index of the next (potential) announcement
     
-    // Protocol Analyzer callback routine
-    void (*m_ProtocolAnalyserFn)(char*, int);
-
     bool                m_isRNI;            // True if use for RNI on Ethernet
     static LonLinkIzoTDev *m_instance;
 
@@ -57,10 +57,8 @@ public:
                                 ULONG lsAddrMappingAnnounceFreq,
                                 WORD lsAddrMappingAnnounceThrottle,
                                 ULONG lsAddrMappingAgeLimit);
-    // Support for L2 protocol analyzer
-	void registerProtocolAnalyzerCallback(void (*fn)(char*, int));
-	void unregisterProtocolAnalyzerCallback();
-	void sendToProtocolAnalyser(byte *pData, bool crcIncluded);
+    // Frames arrive from the kernel driver with the CRC sent on the wire
+    virtual boolean isCrcTrusted() { return false; }
 
   	static LonLinkIzoTLtLink* getInstance();
 protected:
@@ -75,9 +73,6 @@ private:
 	int sockfd;
 	char m_name[IFNAMSIZ];
 
-	// protocol Analyzer callback routine
-	void (*_paFn)(char*, int);
-
 	static LonLinkIzoTLtLink *m_instance;
 };
 
@@ -50,10 +50,6 @@ public:
                                     WORD lsAddrMappingAnnounceThrottle,
                                     ULONG lsAddrMappingAgeLimit);
 
-   	// Support for L2 protocol analyzer
-    void registerProtocolAnalyzerCallback(void (*fn)(char*, int));
-    void unregisterProtocolAnalyzerCallback();
-    void sendToProtocolAnalyser(byte *pData, bool crcIncluded);
     static LonLinkIzoTRNIEthLink* getInstance();
 protected:
     virtual LtSts driverOpen(const char* pName);
@@ -74,9 +70,6 @@ private:
     uint8_t m_lastMsg[MAX_ETH_PACKET];
     uint8_t m_lastMsgSize;
 
-    // protocol Analyzer callback routine
-    void (*_paFn)(char*, int);
-
     static LonLinkIzoTRNIEthLink *m_instance;
 };
 
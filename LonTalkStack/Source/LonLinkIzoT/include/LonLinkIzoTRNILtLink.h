@@ -51,10 +51,6 @@ public:
 	                                ULONG lsAddrMappingAnnounceFreq,
 	                                WORD lsAddrMappingAnnounceThrottle,
 	                                ULONG lsAddrMappingAgeLimit);
-    // Support for L2 protocol analyzer
-	void registerProtocolAnalyzerCallback(void (*fn)(char*, int));
-	void unregisterProtocolAnalyzerCallback();
-	void sendToProtocolAnalyser(byte *pData, bool crcIncluded);
 
   	static LonLinkIzoTRNILtLink* getInstance();
 protected:
@@ -74,9 +70,6 @@ private:
 	int m_sendSocket;
 	char m_name[IFNAMSIZ];
 
-	// protocol Analyzer callback routine
-	void (*_paFn)(char*, int);
-
 	static LonLinkIzoTRNILtLink *m_instance;
 };
 
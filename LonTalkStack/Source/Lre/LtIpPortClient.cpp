@@ -272,6 +272,10 @@
 #include <LtMip.h>
 
 #define CP_NODE_PRI 7
+
+// Receive buffers handed to the link per lock acquisition
+#define LT_IPPC_RECEIVE_BATCH	16
+
 ////////////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////////////
 /************************************************************************************
@@ -701,16 +705,14 @@ void LtIpPortClient::packetReceived(void* referenceId,
 		{
 			// EPR 23157.  The neuron has a bug in which the first byte of the packet is sometimes 
 			// dropped AFTER calculating CRC.  So recalculate CRC and drop the message if it doesn't
-			// match. 
-			int crchi = pData[nLengthReceived-2];
-			int crclo = pData[nLengthReceived-1];
-			LtCRC16(pData, nLengthReceived-2);
-			sbcrchi = pData[nLengthReceived-2];
-			sbcrclo = pData[nLengthReceived-1];
-			if (sts == LTSTS_OK &&
-				(pData[nLengthReceived-2] != crchi ||
-				 pData[nLengthReceived-1] != crclo))
+			// match.  Links that generate the CRC themselves can't have this problem.
+			if (sts == LTSTS_OK && !m_pLink->isCrcTrusted() &&
+				!LtCRC16Verify(pData, nLengthReceived-2))
 			{
+				// The trace shows the CRC the packet should have had.
+				unsigned short crc = LtCRC16Compute(pData, nLengthReceived-2);
+				sbcrchi = crc >> 8;
+				sbcrclo = crc & 0xFF;
 				// LED funcs obsolete
 				//LEDON;
 				vxlReportEvent("Packet received with invalid CRC!!!!!\n");
@@ -719,12 +721,17 @@ void LtIpPortClient::packetReceived(void* referenceId,
 				l2PacketType = L2_PKT_TYPE_CRC;
 				//LEDOFF;
 			}
-			pData[nLengthReceived-2] = crchi;
-			pData[nLengthReceived-1] = crclo;
 		}
 	}
 	pPkt->setIncomingSicbData(isValidPacket, l2PacketType);
 
+	// A trusted link need not fill in the CRC, so have the LRE generate it
+	// if the packet is routed to a client that needs a valid one.
+	if (m_pLink->isCrcTrusted())
+	{
+		pPkt->setCrcFixup(true);
+	}
+
 	if (tracePkt)
 	{
 		char *buf = new NOTHROW char[nLengthReceived*3 + 100];
@@ -808,35 +815,52 @@ void LtIpPortClient::packetComplete(void* referenceId, LtSts sts )
 //
 void	LtIpPortClient::queueReceives()
 {
+	LtReceivePost	posts[LT_IPPC_RECEIVE_BATCH];
 	LtPktInfo*		pPkt = NULL;
+	int				nPosts;
+	int				nQueued;
+	boolean			bMore = true;
 
 	m_bQueueReceivesNeeded = false;
 
 	lock();
 
-	while ( m_bLreClientActive )
+	// Fill the driver a batch at a time so the link lock is taken once per
+	// batch rather than once per buffer.
+	while ( m_bLreClientActive && bMore )
 	{
-		pPkt = m_pAlloc->allocPacket();
-		if ( pPkt == NULL )
-		{	
-			// The allocator emptied before we could complete!?!  One way this
-			// could happen is if a packet arrived before we completed this 
-			// process and that packet forced lots of deep copies or 
-			// clones, exhausting the allocator.  It would be nice if we
-			// could queue receives prior to starting up the input stream
-			// but the current driver doesn't allow this.  Another attempt
-			// to queue receives will be made later when a master is returned
-			m_bQueueReceivesNeeded = true;
-			break;
+		for ( nPosts = 0; nPosts < LT_IPPC_RECEIVE_BATCH; nPosts++ )
+		{
+			pPkt = m_pAlloc->allocPacket();
+			if ( pPkt == NULL )
+			{	
+				// The allocator emptied before we could complete!?!  One way this
+				// could happen is if a packet arrived before we completed this 
+				// process and that packet forced lots of deep copies or 
+				// clones, exhausting the allocator.  It would be nice if we
+				// could queue receives prior to starting up the input stream
+				// but the current driver doesn't allow this.  Another attempt
+				// to queue receives will be made later when a master is returned
+				m_bQueueReceivesNeeded = true;
+				bMore = false;
+				break;
+			}
+			pPkt->setPriority(false);
+			prepareReceive(pPkt, posts[nPosts]);
 		}
-		pPkt->setPriority(false);
-		if (!masterRelease(pPkt))
+
+		nQueued = (nPosts == 0 || m_bResetting) ? 0 :
+					m_pLink->queueReceiveBatch(posts, nPosts);
+
+		// Driver is full.  Give back whatever it didn't take.
+		for ( ; nQueued < nPosts; nQueued++ )
 		{
+			pPkt = (LtPktInfo*) posts[nQueued].referenceId;
 			#ifdef ENABLE_CRUMBS
 			pPkt->setCrumb( "LtIpPc - queueReceives: released" );
 			#endif // ENABLE_CRUMBS
 			pPkt->release();
-			break;
+			bMore = false;
 		}
 	}
 
@@ -1287,16 +1311,14 @@ boolean LtIpPortClient::getRoute(int& index, LtRoutingMap *pRoute)
 
 int		gnPktStamp = 0;
 
-boolean LtIpPortClient::masterRelease(LtMsgRef* pMsg)
+//
+// prepareReceive
+//
+// Reset a master packet for reuse as a receive buffer and describe it
+// for LtLink::queueReceiveBatch.
+//
+void LtIpPortClient::prepareReceive(LtPktInfo* pPkt, LtReceivePost& post)
 {
-	if (m_bResetting) return false;
-	if (pMsg == null) return true;
-	boolean result = true;
-	LtPktInfo* pPkt = (LtPktInfo*) pMsg;
-	LtSts sts;
-
-	boolean bPriority = pPkt->getPriority();
-
 	// Need to make sure we put the reference back.
 	pPkt->setMessageData(pPkt->getBlock(), pPkt->getBlockSize(), pPkt);
 	pPkt->initPacket();
@@ -1306,25 +1328,31 @@ boolean LtIpPortClient::masterRelease(LtMsgRef* pMsg)
 	pPkt->setTimestamp( gnPktStamp );
 	gnPktStamp++;
 	#endif // ENABLE_CRUMBS
-	sts = m_pLink->queueReceive( pPkt, bPriority, pPkt->getFlags(), pPkt->getBlock(),
-			  					 pPkt->getBlockSize() );
 
-	if (sts != LTSTS_PENDING)
+	post.referenceId	= pPkt;
+	post.bPriority		= pPkt->getPriority();
+	post.flags			= pPkt->getFlags();
+	post.pData			= pPkt->getBlock();
+	post.nMaxLength		= pPkt->getBlockSize();
+}
+
+boolean LtIpPortClient::masterRelease(LtMsgRef* pMsg)
+{
+	if (m_bResetting) return false;
+	if (pMsg == null) return true;
+	boolean result = true;
+	LtPktInfo* pPkt = (LtPktInfo*) pMsg;
+	LtReceivePost post;
+
+	prepareReceive(pPkt, post);
+
+	// If the expected queue is full the link tries the other.
+	if (m_pLink->queueReceiveBatch(&post, 1) != 1)
 	{
-		// Expected queue is full.  Try the other.
-		bPriority = !bPriority;
-		#ifdef ENABLE_CRUMBS
-		pPkt->setCrumb( "Queued to driver - other queue" );
-		#endif // ENABLE_CRUMBS
-		sts = m_pLink->queueReceive( pPkt, bPriority, pPkt->getFlags(), pPkt->getBlock(),
-				  					 pPkt->getBlockSize() );
-		if (sts != LTSTS_PENDING)
-		{
-			// Driver is full.  This can occur if a reset occurs while
-			// buffers are outstanding.  It also can occur while doing
-			// receive queue stuffing (queueReceives).
-			result = false;
-		}
+		// Driver is full.  This can occur if a reset occurs while
+		// buffers are outstanding.  It also can occur while doing
+		// receive queue stuffing (queueReceives).
+		result = false;
 	}
 
 	if (m_bQueueReceivesNeeded)
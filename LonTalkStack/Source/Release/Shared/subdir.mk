@@ -13,11 +13,13 @@ CPP_SRCS += \
 ../Shared/LtLinkBase.cpp \
 ../Shared/LtNetwork.cpp \
 ../Shared/LtNvRam.cpp \
+../Shared/LtPaCaptureRing.cpp \
 ../Shared/LtPersistence.cpp \
 ../Shared/LtPktAllocator.cpp \
 ../Shared/LtPktAllocatorOne.cpp \
 ../Shared/LtPktInfo.cpp \
 ../Shared/LtProgramId.cpp \
+../Shared/LtStatCounters.cpp \
 ../Shared/LtTaskOwner.cpp \
 ../Shared/LtUniqueId.cpp \
 ../Shared/LtUri.cpp \
@@ -39,11 +41,13 @@ OBJS += \
 ./Shared/LtLinkBase.o \
 ./Shared/LtNetwork.o \
 ./Shared/LtNvRam.o \
+./Shared/LtPaCaptureRing.o \
 ./Shared/LtPersistence.o \
 ./Shared/LtPktAllocator.o \
 ./Shared/LtPktAllocatorOne.o \
 ./Shared/LtPktInfo.o \
 ./Shared/LtProgramId.o \
+./Shared/LtStatCounters.o \
 ./Shared/LtTaskOwner.o \
 ./Shared/LtUniqueId.o \
 ./Shared/LtUri.o \
@@ -65,11 +69,13 @@ CPP_DEPS += \
 ./Shared/LtLinkBase.d \
 ./Shared/LtNetwork.d \
 ./Shared/LtNvRam.d \
+./Shared/LtPaCaptureRing.d \
 ./Shared/LtPersistence.d \
 ./Shared/LtPktAllocator.d \
 ./Shared/LtPktAllocatorOne.d \
 ./Shared/LtPktInfo.d \
 ./Shared/LtProgramId.d \
+./Shared/LtStatCounters.d \
 ./Shared/LtTaskOwner.d \
 ./Shared/LtUniqueId.d \
 ./Shared/LtUri.d \
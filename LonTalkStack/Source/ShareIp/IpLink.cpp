@@ -671,7 +671,7 @@ LtSts CIpLink::sendPacketTo( void* refId, ULONG ipAddr, word port, byte* pData,
 
 	if ( m_pNet )
 	{
-		m_linkStats.m_nTransmittedPackets++;
+		m_linkStats.bump(LT_LINK_STAT_TRANSMITTED_PACKETS);
 		m_pNet->packetComplete( refId, sts );
 	}
 
@@ -716,7 +716,7 @@ LtSts CIpLink::sendPacket(void* referenceId,
 		}
 		else
 		{	sts = LTSTS_ERROR;
-			m_linkStats.m_nTransmissionErrors++;
+			m_linkStats.bump(LT_LINK_STAT_TRANSMISSION_ERRORS);
 			dumpPacket("IpLink - sendPacket ERROR", pNewData, nNewSize,
                  m_ipSrcAddr, vxsAddrGetAddr(m_ipDstSockAddr));
 		}
@@ -724,7 +724,7 @@ LtSts CIpLink::sendPacket(void* referenceId,
 
 	if ( m_pNet )
 	{
-		m_linkStats.m_nTransmittedPackets++;
+		m_linkStats.bump(LT_LINK_STAT_TRANSMITTED_PACKETS);
 		m_pNet->packetComplete( referenceId, sts );
 	}
 	// immediate data return
@@ -777,6 +777,22 @@ int		CIpLink::receiveNoNet( ULONG* pipSrc, ULONG* pipSrcPort, byte* pData, int n
 }
 
 
+//
+//	queueReceiveBatch
+//
+//	Slave links hand the whole batch to the master link.  Otherwise each
+//	buffer goes through queueReceive so its duplicate checks still apply.
+//
+int CIpLink::queueReceiveBatch( LtReceivePost* pPosts, int nPosts,
+								boolean bTryOther )
+{
+	if (m_pMasterLink != NULL)
+	{
+		return m_pMasterLink->queueReceiveBatch(pPosts, nPosts, bTryOther);
+	}
+	return LtLink::queueReceiveBatch(pPosts, nPosts, bTryOther);
+}
+
 //
 //	queueReceive
 //
@@ -932,11 +948,11 @@ void CIpLink::receivePacket( byte* data, int nPktSize, VXSOCKADDR rcvSockAddr, U
 		{	break;	// not open
 		}
 		// set the priority bit in the packet.
-		m_linkStats.m_nReceivedPackets++;
+		m_linkStats.bump(LT_LINK_STAT_RECEIVED_PACKETS);
 		// Figure out priority setting for packet
 		bPrior = false;
 		if ( bPrior )
-		{	m_linkStats.m_nReceivedPriorityPackets++;
+		{	m_linkStats.bump(LT_LINK_STAT_RECEIVED_PRIORITY_PACKETS);
 		}
 		//if ( bPrior?!m_qReceiveP.isEmpty() : !m_qReceive.isEmpty() )
 		do
@@ -974,7 +990,7 @@ void CIpLink::receivePacket( byte* data, int nPktSize, VXSOCKADDR rcvSockAddr, U
 				// so count a missed packet and then put the receive
 				// buffer back on the head of the queue to be used again.
 				sts = LTSTS_OVERRUN;
-				m_linkStats.m_nMissedPackets++;
+				m_linkStats.bump(LT_LINK_STAT_MISSED_PACKETS);
 
 				// Give buffer back to the master link
 				if (m_pMasterLink == NULL)
@@ -1020,7 +1036,7 @@ void CIpLink::receivePacket( byte* data, int nPktSize, VXSOCKADDR rcvSockAddr, U
 		} while (false);
 		if ( !bGotOne )
 		{	// we didn't have a buffer for this packet
-			m_linkStats.m_nMissedPackets++;
+			m_linkStats.bump(LT_LINK_STAT_MISSED_PACKETS);
 		}
 	} while(false);
 	//unlock();
@@ -127,6 +127,7 @@
 //////////////////////////////////////////////////////////////////////
 
 #define LINKBUFS 40
+#define RECEIVE_BATCH 16	// receive buffers posted per link lock
 
 void LtIpBase::construct(LtIpBase* pMasterLtIpBase)
 {
@@ -351,31 +352,43 @@ boolean	LtIpBase::masterRelease( LtMsgRef* pMsg )
 void LtIpBase::queueReceives( boolean bPriority )
 {
 
+	LtReceivePost	posts[RECEIVE_BATCH];
 	LtPktInfo*		pPkt = NULL;
+	int				nPosts;
+	int				nQueued;
+	boolean			bMore = true;
 	// DJDFIX remove bogus counters
 	int				nRcvsQd =  0; // bPriority? m_nRecvsQdP : m_nRecvsQd;
 
-	while ( m_bActive
+	while ( m_bActive && bMore
 		//	&& nRcvsQd < m_nReceiveQueueDepth // DJDFIX
 		  )
 	{
-		pPkt = m_pAlloc->allocPacket();
-		if ( pPkt == NULL )
-		{	break;		// woops, the allocator is empty
+		// Hand the link a batch per lock acquisition
+		for ( nPosts = 0; nPosts < RECEIVE_BATCH; nPosts++ )
+		{
+			pPkt = m_pAlloc->allocPacket();
+			if ( pPkt == NULL )
+			{	bMore = false;		// woops, the allocator is empty
+				break;
+			}
+			pPkt->setMessageData(pPkt->getBlock(), pPkt->getBlockSize(), pPkt);
+			pPkt->setCrumb( "LtIpBase::queueReceives" );
+			posts[nPosts].referenceId	= pPkt;
+			posts[nPosts].bPriority		= bPriority;
+			posts[nPosts].flags			= pPkt->getFlags();
+			posts[nPosts].pData			= pPkt->getBlock();
+			posts[nPosts].nMaxLength	= pPkt->getBlockSize();
 		}
-		pPkt->setMessageData(pPkt->getBlock(), pPkt->getBlockSize(), pPkt);
-		LtSts	sts;
-		pPkt->setCrumb( "LtIpBase::queueReceives" );
-		sts = m_pLink->queueReceive( pPkt, bPriority, pPkt->getFlags(), pPkt->getBlock(),
-							pPkt->getBlockSize() );
-		if ( sts != LTSTS_PENDING )
+		nQueued = nPosts ? m_pLink->queueReceiveBatch( posts, nPosts, false ) : 0;
+		nRcvsQd += nQueued;
+		for ( ; nQueued < nPosts; nQueued++ )
 		{
+			pPkt = (LtPktInfo*)posts[nQueued].referenceId;
 			pPkt->setCrumb( "LtIpBase::queueReceives released" );
 			pPkt->release();
-			break;
+			bMore = false;
 		}
-		//vxlReportEvent("LtIpBase::queueReceives - queue 0x%08x\n", pPkt );
-		nRcvsQd++;
 	}
 #if 0 // DJDFIX remove bogus counters
 	if ( bPriority )
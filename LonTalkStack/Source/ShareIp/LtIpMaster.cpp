@@ -1429,27 +1429,21 @@ void LtIpMaster::packetReceived(	boolean bPriority,
 					vxlReportEvent("Master::packetReceived - last segment arrived %d\n", seg.segmentId );
 				}
 				// we have a segment packet arriving.
-				// pPkt is always gone if return true.
-				if ( m_segIn.receivedPacket( pPkt, &pPktDone, pPkt->getIpSrcAddr(), pPkt->getIpSrcPort() ) )
+				// pPkt is always gone if return true, so hang on to the source.
+				// The segmentor stamps it on the completed packet.
+				ULONG		ipAddr = pPkt->getIpSrcAddr();
+				word		ipPort = pPkt->getIpSrcPort();
+				if ( m_segIn.receivedPacket( pPkt, &pPktDone, ipAddr, ipPort ) )
 				{
-					if ( pPktDone )
-					{
 #ifdef TESTSEGS // segmentTest
-					ULONG		ipAddr = pPkt->getIpSrcAddr();
-					word		ipPort = pPkt->getIpSrcPort();
 					LtIpAddressStr	ias;
+					if ( pPktDone )
+					{
 					vxlReportEvent( "Master::packetReceived - segmented packet complt %d bytes from %s: %d\n",
 									pPktDone->getDataSize(), ias.getString( ipAddr ), ipPort );
-#endif // segment test
-						pPktDone->setIpSrcAddr( pPkt->getIpSrcAddr() );
-						pPktDone->setIpSrcPort( pPkt->getIpSrcPort() );
 					}
-#ifdef TESTSEGS // segmentTest
 					else
 					{
-					ULONG		ipAddr = pPkt->getIpSrcAddr();
-					word		ipPort = pPkt->getIpSrcPort();
-					LtIpAddressStr	ias;
 					vxlReportEvent( "Master::packetReceived - segmented packet reqId %4d seg %2d from %s: %d\n",
 									seg.requestId, seg.segmentId, ias.getString( ipAddr ), ipPort );
 					}
@@ -181,6 +181,7 @@
  */
 #include <VxWorks.h>
 #include <tickLib.h>
+#include <taskLib.h>
 #include <sysLib.h>
 #include <string.h>
 #include <stdio.h>
@@ -272,23 +273,50 @@ static	void dateTimeToStr( ULONG dateTime, LPSTR pstr, int nMaxLen )
 //
 int			LtIpPktHeader::clkRate = 0;
 ULONGLONG	LtIpPktHeader::msPerSec = 1000;
-boolean		LtIpPktHeader::bGotClock = false;
-ULONG		LtIpPktHeader::nLastTick;
-ULONGLONG	LtIpPktHeader::tClkTime;
-struct timespec LtIpPktHeader::tTimeSpec;
+volatile ULONG		LtIpPktHeader::clkSeq = 0;
+volatile ULONG		LtIpPktHeader::clkHighMs = 0;
+volatile LONG		LtIpPktHeader::clkRefreshing = 0;
+volatile boolean	LtIpPktHeader::bGotClock = false;
+volatile ULONG		LtIpPktHeader::nLastTick;
+volatile ULONGLONG	LtIpPktHeader::tClkTime;
+
+#ifdef WIN32
+#define CLK_BARRIER()		MemoryBarrier()
+#define CLK_TRY_OWN(p)		(InterlockedCompareExchange((p), 1, 0) == 0)
+#define CLK_CAS(p, o, n)	(InterlockedCompareExchange((volatile LONG*)(p), (LONG)(n), (LONG)(o)) == (LONG)(o))
+#else
+#define CLK_BARRIER()		__sync_synchronize()
+#define CLK_TRY_OWN(p)		__sync_bool_compare_and_swap((p), 0, 1)
+#define CLK_CAS(p, o, n)	__sync_bool_compare_and_swap((p), (o), (n))
+#endif
 
 //
 //
 // getTimestamp
 //
 // return the milliseconds of absolute time. Allow for wrap around
-// and to make this faster, just get the full time every 1000 ticks.
-// During the 1000 ticks, correct the time by adjusting for the tick count.
+// and to make this faster, just get the full time every MAX_CLOCK_TICKS ticks.
+// In between, correct the time by adjusting for the tick count.
+//
+// This is called from the receive, send, aggregation and segmentation
+// threads at once.  Readers take a snapshot of the clock base without
+// locking and retry if it changed underneath them.  The first thread to
+// find the base out of date refreshes it; the others use the old base
+// meanwhile, or wait for it if there is no base yet.
+//
+// Timestamps are monotonic across threads, not just within one: a thread
+// whose snapshot is older than another's returns the latest timestamp
+// handed out instead of stepping back.  As with the base refresh, only
+// steps of less than MAX_CLOCK_DRIFT_MS are hidden.
 //
 ULONG	LtIpPktHeader::getTimestamp(boolean bSyncCheck)
 {
+	ULONG		nSeq;
 	ULONG		nTickDiff;
 	ULONG		nTickNow;
+	ULONG		nBaseTick;
+	ULONGLONG	tBase;
+	boolean		bSynched;
 	ULONGLONG	ms;
 	ULONG		nMs;
 
@@ -296,28 +324,47 @@ ULONG	LtIpPktHeader::getTimestamp(boolean bSyncCheck)
 	{
 		clkRate = sysClkRateGet();
 	}
-	nTickNow = tickGet();
-	nTickDiff = nTickNow - nLastTick;
-	// if we don't have the clock value yet, or
-	// the tick value is greater then 1000 ticks, then
-	// get the clock value again.
-	if ( nTickDiff > MAX_CLOCK_TICKS )
+	while ( true )
 	{
-		OsalClockGetTime( CLOCK_REALTIME, &tTimeSpec );
-		nLastTick = tickGet();
-		nTickDiff = 0;
-		tClkTime = ( tTimeSpec.tv_sec );
-		tClkTime *= 1000;
-		tClkTime += ( tTimeSpec.tv_nsec / 1000000 );
-		// If we're not synchronized yet, assume the retrieved value is bogus.
-		bGotClock = iLonSntpTimeSynched();
+		do
+		{
+			nSeq = clkSeq;
+			CLK_BARRIER();
+			nBaseTick = nLastTick;
+			tBase = tClkTime;
+			bSynched = bGotClock;
+			CLK_BARRIER();
+		} while ( (nSeq & 1) || nSeq != clkSeq );
+		// Read the tick after the base, so it is never behind it.
+		nTickNow = tickGet();
+		nTickDiff = nTickNow - nBaseTick;
+		// if we don't have the clock value yet, or
+		// the tick value is greater than MAX_CLOCK_TICKS, then
+		// get the clock value again.
+		if ( nSeq != 0 && nTickDiff <= MAX_CLOCK_TICKS )
+		{
+			break;
+		}
+		if ( CLK_TRY_OWN(&clkRefreshing) )
+		{
+			refreshClock(nSeq, nBaseTick, tBase, nTickNow, bSynched);
+			nTickDiff = 0;
+			break;
+		}
+		if ( nSeq != 0 )
+		{
+			// Someone else is refreshing it; the old base will do.
+			break;
+		}
+		// There's no base at all until the first refresh is published.
+		taskDelay(0);
 	}
-	if ( !bSyncCheck || bGotClock )
+	if ( !bSyncCheck || bSynched )
 	{
 		// compute the milliseconds adjustment based on the tick difference
 		// and add in the base milliseconds time
 		ms = (nTickDiff*msPerSec)/clkRate;
-		ms += tClkTime;
+		ms += tBase;
 	}
 	else
 	{	// if we don't have synch, then use zero for timestamp
@@ -330,9 +377,70 @@ ULONG	LtIpPktHeader::getTimestamp(boolean bSyncCheck)
 	#ifdef WIN32
 	#pragma warning( default:4244 )
 	#endif
+	if ( ms != 0 )
+	{
+		// Don't return less than another thread already has.
+		ULONG	nHigh;
+		do
+		{
+			nHigh = clkHighMs;
+			LONG nBehind = (LONG)(nHigh - nMs);
+			if ( nBehind > 0 && nBehind < MAX_CLOCK_DRIFT_MS )
+			{
+				nMs = nHigh;
+				break;
+			}
+		} while ( nHigh != nMs && !CLK_CAS(&clkHighMs, nHigh, nMs) );
+	}
 	return nMs;
 }
 
+//
+// refreshClock
+//
+// Read the wall clock and publish it as the new base for getTimestamp().
+// Called only by the thread that set clkRefreshing, which this clears.
+// nSeq, nBaseTick and tBase are the caller's snapshot of the old base; on
+// return tBase, nTickNow and bSynched describe the new one.
+//
+void	LtIpPktHeader::refreshClock(ULONG nSeq, ULONG nBaseTick, ULONGLONG& tBase,
+									ULONG& nTickNow, boolean& bSynched)
+{
+	struct timespec	tTimeSpec;
+	ULONGLONG		tNow;
+	ULONG			nNewSeq = clkSeq;
+
+	OsalClockGetTime( CLOCK_REALTIME, &tTimeSpec );
+	nTickNow = tickGet();
+	tNow = ( tTimeSpec.tv_sec );
+	tNow *= 1000;
+	tNow += ( tTimeSpec.tv_nsec / 1000000 );
+	if ( nSeq != 0 )
+	{
+		// Don't let drift between the tick count and the wall clock
+		// step the timestamp backwards.
+		ULONGLONG tTicks = tBase + ((nTickNow - nBaseTick)*msPerSec)/clkRate;
+		if ( tNow < tTicks && tTicks - tNow < MAX_CLOCK_DRIFT_MS )
+		{
+			tNow = tTicks;
+		}
+	}
+	// If we're not synchronized yet, assume the retrieved value is bogus.
+	bSynched = iLonSntpTimeSynched();
+
+	clkSeq = nNewSeq + 1;
+	CLK_BARRIER();
+	nLastTick = nTickNow;
+	tClkTime = tNow;
+	bGotClock = bSynched;
+	CLK_BARRIER();
+	clkSeq = nNewSeq + 2;
+	CLK_BARRIER();
+	clkRefreshing = 0;
+
+	tBase = tNow;
+}
+
 #if 0 // obsolete
 
 //
@@ -1192,18 +1192,11 @@ void LtLreIpClient::packetReceived(	boolean bPriority,
 					}
 					else
 					{
-						byte crchi = pLtData[nLtPayloadLen-2];
-						byte crclo = pLtData[nLtPayloadLen-1];
-						LtCRC16(pLtData, nLtPayloadLen-2);
-						if ((pLtData[nLtPayloadLen-2] != crchi) ||
-							(pLtData[nLtPayloadLen-1] != crclo))
+						if (!LtCRC16Verify(pLtData, nLtPayloadLen-2))
 						{
 							vxlReportEvent("LT packet received on IP channel with invalid CRC!!!!!\n");
 							isValidPacket = FALSE;
 							l2PacketType = L2_PKT_TYPE_CRC;
-							// restore the data back to the (bad) original. No need to if they match.
-							pLtData[nLtPayloadLen-2] = crchi;
-							pLtData[nLtPayloadLen-1] = crclo;
 						}
 					}
 					pPkt2->setIncomingSicbData(isValidPacket, l2PacketType);
@@ -1485,29 +1478,24 @@ boolean LtLreIpClient::freeMessage(LtPktInfo* pPkt)
 {
 	boolean result = true;
 	lock();
-	LtSts sts;
-
-	boolean bPriority = pPkt->getPriority();
+	LtReceivePost post;
 
 	pPkt->setMessageNoRef(pPkt->getBlock(), pPkt->getBlockSize());
 	pPkt->initPacket();
 
-	sts = m_pLink->queueReceive( pPkt, bPriority, pPkt->getFlags(), pPkt->getBlock(),
-			  					 pPkt->getBlockSize() );
+	post.referenceId	= pPkt;
+	post.bPriority		= pPkt->getPriority();
+	post.flags			= pPkt->getFlags();
+	post.pData			= pPkt->getBlock();
+	post.nMaxLength		= pPkt->getBlockSize();
 
-	if (sts != LTSTS_PENDING)
+	// If the expected queue is full the link tries the other, both under
+	// one acquisition of its lock.
+	if (m_pLink->queueReceiveBatch(&post, 1) != 1)
 	{
-		// Expected queue is full.  Try the other.
-		bPriority = !bPriority;
-		sts = m_pLink->queueReceive( pPkt, bPriority, pPkt->getFlags(), pPkt->getBlock(),
-				  					 pPkt->getBlockSize() );
-
-		if (sts != LTSTS_PENDING)
-		{
-			// Driver is full.  This can occur if a reset occurs while
-			// buffers are outstanding.
-			result = false;
-		}
+		// Driver is full.  This can occur if a reset occurs while
+		// buffers are outstanding.
+		result = false;
 	}
 
 	unlock();
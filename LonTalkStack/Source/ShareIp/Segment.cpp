@@ -238,6 +238,108 @@ void LtIpSegment::dump( )
 //
 
 
+//
+// getNextForPeer
+//
+// Return the next request of a peer, whatever its request id.
+// All the requests of a peer hash to the same bucket, so only that
+// bucket is walked.
+//
+LtIpSegReq* LtIpSegReqTable::getNextForPeer( ULONG ipAddr, word ipPort, LtHashTablePos& pos )
+{
+	LtIpSegReqKey	key( ipAddr, ipPort, 0 );
+	LtHashRecord*	pRec;
+
+	if ( pos.getIndex() >= m_nSize )
+	{	return NULL;	// walk already ended
+	}
+	if ( pos.getIndex() == -1 )
+	{	// first one, start at the head of the bucket
+		pos.setIndex( getIndex( &key ) );
+		pRec = m_pRecords[pos.getIndex()];
+	}
+	else if ( pos.getRec() == NULL )
+	{	// the head of the bucket was removed, start over there
+		pRec = m_pRecords[pos.getIndex()];
+	}
+	else
+	{	pRec = pos.getRec()->getNext();
+	}
+	while ( pRec != NULL && !((LtIpSegReqKey*)pRec->getKey())->matchPeer( ipAddr, ipPort ) )
+	{
+		pRec = pRec->getNext();
+	}
+	pos.setRec( pRec );
+	if ( pRec == NULL )
+	{	pos.setIndex( m_nSize );
+		return NULL;
+	}
+	return (LtIpSegReq*)pRec->getValue();
+}
+
+//
+// removePeerAt
+//
+// remove the request last returned by getNextForPeer. The key is deleted
+// by the table, the request is not.
+//
+void LtIpSegReqTable::removePeerAt( LtHashTablePos& pos )
+{
+	LtHashRecord*	pRec = pos.getRec();
+
+	pos.setRec( pRec->getPrev() );
+	remove( pRec );
+}
+
+//
+// LtIpReasmAllocator
+//
+// The pool of reassembly buffers. Reassembled packets are handed to the
+// link's clients, which may still hold some when the segmentor goes away.
+// So the segmentor orphans the pool instead of deleting it, and the pool
+// deletes itself when the last of its packets comes back.
+//
+#ifdef WIN32
+#define REASM_SET(p)		InterlockedExchange((p), 1)
+#define REASM_CLAIM(p)		(InterlockedCompareExchange((p), 1, 0) == 0)
+#else
+#define REASM_SET(p)		__sync_lock_test_and_set((p), 1)
+#define REASM_CLAIM(p)		__sync_bool_compare_and_swap((p), 0, 1)
+#endif
+
+class LtIpReasmAllocator : public LtPktAllocator
+{
+public:
+	LtIpReasmAllocator()
+	{	m_nOrphaned	= 0;
+		m_nDeleting	= 0;
+	}
+	// The owner is done with the pool. Deletes it now if all the packets
+	// are back, else the last packet release does.
+	void	orphan()
+	{	REASM_SET( &m_nOrphaned );
+		deleteIfIdle();
+	}
+	virtual boolean	returnMaster( LtMsgRef* pMsgRef )
+	{	boolean	bOk = LtPktAllocator::returnMaster( pMsgRef );
+		// a master that is still referenced cannot have been the last one
+		if ( m_nOrphaned && pMsgRef == NULL )
+		{	deleteIfIdle();
+		}
+		return bOk;
+	}
+protected:
+	volatile LONG	m_nOrphaned;
+	volatile LONG	m_nDeleting;
+	// release() does not touch the allocator after returnMaster,
+	// so it may go away from in there.
+	void	deleteIfIdle()
+	{	if ( allItemsReturned() && REASM_CLAIM( &m_nDeleting ) )
+		{	delete this;
+		}
+	}
+};
+
 LtIpSegmentor::LtIpSegmentor()
 {
 	m_pLink				= NULL;
@@ -246,6 +348,10 @@ LtIpSegmentor::LtIpSegmentor()
 	m_pSentPkt			= NULL;
 	m_bActive			= false;
 	m_bUseExtHdrs		= false;
+	m_nMaxTimers		= INITIAL_TIMERS;
+	m_ppTimers			= new LtIpSegReq*[m_nMaxTimers];
+	m_nTimers			= 0;
+	m_pReasmAlloc		= NULL;
 }
 
 
@@ -264,6 +370,14 @@ LtIpSegmentor::~LtIpSegmentor()
 #ifdef TESTSEGS
 	vxlReportEvent("~LtIpSegmentor - purge complete %d\n", tickGet() );
 #endif // TESTSEGS
+	delete[] m_ppTimers;
+	m_ppTimers = NULL;
+	// reassembled packets may still be out with the link clients
+	if ( m_pReasmAlloc )
+	{
+		m_pReasmAlloc->orphan();
+		m_pReasmAlloc = NULL;
+	}
 }
 
 //
@@ -273,27 +387,27 @@ LtIpSegmentor::~LtIpSegmentor()
 //
 void	LtIpSegmentor::purgeAllRequests( )
 {
-	LtVectorPos		pos;
 	LtIpSegReq*		pReq;
 
 	lock();
 #ifdef TESTSEGS
 	LtIpAddressStr	ias;
-	int				nCount = m_vReqs.getCount();
+	int				nCount = m_nTimers;
 	vxlReportEvent("LtIpSegmentor::purgeAllRequests - reqs total %d\n",	nCount );
 #endif // TESTSEGS
 	// remove and delete all the request elements, if there are any
-	while ( m_vReqs.getElement( pos, &pReq ) )
+	// take them from the end of the heap so nothing needs to be re-sorted
+	while ( m_nTimers )
 	{
+		pReq = m_ppTimers[m_nTimers-1];
 #ifdef TESTSEGS
 		vxlReportEvent("LtIpSegmentor::purgeAllRequests - purge request 0x%08x reqId %d %s %d\n",
 			pReq, pReq->getRequestId(), ias.getString( pReq->getIpAddr()), tickGet() );
 #endif // TESTSEGS
-		m_vReqs.removeElement( pos );
-		delete pReq;
+		deleteRequest( pReq );
 	}
 #ifdef TESTSEGS
-	nCount = m_vReqs.getCount();
+	nCount = m_nTimers;
 	vxlReportEvent("LtIpSegmentor::purgeAllRequests - reqs left %d\n", nCount );
 #endif // TESTSEGS
 	unlock();
@@ -310,37 +424,86 @@ void	LtIpSegmentor::purgeAllRequests( )
 //
 void	LtIpSegmentor::purgeRequests( int nPktType, ULONG ipAddr, word port )
 {
-	LtVectorPos		pos;
+	LtHashTablePos	pos;
 	LtIpSegReq*		pReq;
+	int				i;
 
 	lock();
 #ifdef TESTSEGS
 	LtIpAddressStr	ias;
-	int				nCount = m_vReqs.getCount();
+	int				nCount = m_nTimers;
 	vxlReportEvent("LtIpSegmentor::purgeRequests - reqs total %d purge type %d %s (%d) %d\n",
 					nCount, nPktType, ias.getString( ipAddr), port, tickGet() );
 #endif // TESTSEGS
 	// remove and delete all the matching request elements, if there are any
-	while ( m_vReqs.getElement( pos, &pReq ) )
+	if ( ipAddr != 0 )
 	{
-		if ( pReq->matchTypeIp( nPktType, ipAddr, port ) )
+		// only the requests of this peer need to be looked at
+		while ( NULL != ( pReq = m_hReqs.getNextForPeer( ipAddr, port, pos ) ) )
 		{
+			if ( pReq->matchTypeIp( nPktType, ipAddr, port ) )
+			{
 #ifdef TESTSEGS
-			vxlReportEvent("LtIpSegmentor::purgeRequests - purge request 0x%08x reqId %d %s %d\n",
-				pReq, pReq->getRequestId(), ias.getString( pReq->getIpAddr()), tickGet() );
+				vxlReportEvent("LtIpSegmentor::purgeRequests - purge request 0x%08x reqId %d %s %d\n",
+					pReq, pReq->getRequestId(), ias.getString( pReq->getIpAddr()), tickGet() );
 #endif // TESTSEGS
-
-			m_vReqs.removeElement( pos );
-			delete pReq;
+				m_hReqs.removePeerAt( pos );
+				removeTimer( pReq );
+				delete pReq;
+			}
+		}
+	}
+	else
+	{
+		// compact the survivors to the front of the heap, then rebuild it
+		int		nKeep = 0;
+		for ( i = 0; i < m_nTimers; i++ )
+		{
+			pReq = m_ppTimers[i];
+			if ( pReq->matchTypeIp( nPktType, ipAddr, port ) )
+			{
+#ifdef TESTSEGS
+				vxlReportEvent("LtIpSegmentor::purgeRequests - purge request 0x%08x reqId %d %s %d\n",
+					pReq, pReq->getRequestId(), ias.getString( pReq->getIpAddr()), tickGet() );
+#endif // TESTSEGS
+				LtIpSegReqKey	key( pReq->getIpAddr(), pReq->getPort(), pReq->getRequestId() );
+				if ( m_hReqs.get( &key ) == pReq )
+				{	m_hReqs.removeKey( &key );
+				}
+				delete pReq;
+			}
+			else
+			{	setTimerAt( nKeep++, pReq );
+			}
+		}
+		m_nTimers = nKeep;
+		for ( i = m_nTimers/2 - 1; i >= 0; i-- )
+		{	siftTimerDown( i );
 		}
 	}
 #ifdef TESTSEGS
-	nCount = m_vReqs.getCount();
+	nCount = m_nTimers;
 	vxlReportEvent("LtIpSegmentor::purgeRequests - reqs left %d\n", nCount );
 #endif // TESTSEGS
 	unlock();
 }
 
+//
+// deleteRequest
+//
+// remove a request from the table and the timer heap and delete it
+// call with lock
+//
+void	LtIpSegmentor::deleteRequest( LtIpSegReq* pReq )
+{
+	LtIpSegReqKey	key( pReq->getIpAddr(), pReq->getPort(), pReq->getRequestId() );
+
+	removeTimer( pReq );
+	if ( m_hReqs.get( &key ) == pReq )
+	{	m_hReqs.removeKey( &key );
+	}
+	delete pReq;
+}
 
 
 //
@@ -354,7 +517,7 @@ LtIpSegReq*	LtIpSegmentor::newRequest( LtIpRequest& reqPkt, ULONG ipAddress, wor
 	if ( !isActive() )
 	{	return NULL;
 	}
-	LtIpSegReq*		pReq = new LtIpSegReq();
+	LtIpSegReq*		pReq;
 	//STATUS			sts;
 #ifdef TESTSEGS
 	if ( reqPkt.packetType == 0 )
@@ -363,12 +526,20 @@ LtIpSegReq*	LtIpSegmentor::newRequest( LtIpRequest& reqPkt, ULONG ipAddress, wor
 	}
 #endif // TESTSEGS
 
+	// a request id can only be in use once per peer.
+	// A new request with the same id supersedes the old one.
+	pReq = findRequestId( ipAddress, port, reqPkt.requestId );
+	if ( pReq )
+	{	deleteRequest( pReq );
+	}
+	pReq = new LtIpSegReq();
 	pReq->setRequest( reqPkt );
 	pReq->setIpAddrPort( ipAddress, port );
 	pReq->setExtHdrData(m_ipAddrLocal, m_natIpAddr, m_ipPortLocal, m_bUseExtHdrs);
-	m_vReqs.addElement( pReq );
+	m_hReqs.set( new LtIpSegReqKey( ipAddress, port, reqPkt.requestId ), pReq );
+	addTimer( pReq );
 	// if we just added our first request, then start the timer
-	if ( m_vReqs.getCount() == 1 )
+	if ( m_nTimers == 1 )
 	{
 		startTimer( TIMEOUT_TIMERMS );
 	}
@@ -386,7 +557,6 @@ boolean	LtIpSegmentor::buildSegments( LtIpRequest& reqPkt, byte* pData, int nDat
 {
 	boolean			bOk = false;
 	boolean			bDone = false;
-	LtVectorPos		pos;
 	LtIpSegReq*		pReq;
 	boolean			bSendAll = 0 != (reqPkt.reason & REQUEST_ALL);
 	int				nSize = nDataSize;
@@ -399,28 +569,25 @@ boolean	LtIpSegmentor::buildSegments( LtIpRequest& reqPkt, byte* pData, int nDat
 	do
 	{
 		// If we have this request, then satisfy it from the existing request
-		while ( m_vReqs.getElement( pos, &pReq ) )
+		pReq = findRequestId( ipAddr, port, reqPkt.requestId );
+		if ( pReq )
 		{
-			if ( pReq->match( ipAddr, port, reqPkt.requestId ) )
-			{
 #if 0 // always rebuild a segReq if we have a match with request id
-				if ( ! pReq->matchType( reqPkt.packetType ) )
-				{
-					// caller is playing games with us. Reuse of a request id
-					// with another packet type.
-					purgeRequests( pReq->getType(), ipAddr, port );
-					// so create another request with this data.
-					break;
-				}
-				bOk = sendSegment( pReq, reqPkt.segmentId, bSendAll );
-				bDone = true;
-#else
-				// it might be new data this time, so rebuild the segments
+			if ( ! pReq->matchType( reqPkt.packetType ) )
+			{
+				// caller is playing games with us. Reuse of a request id
+				// with another packet type.
 				purgeRequests( pReq->getType(), ipAddr, port );
 				// so create another request with this data.
-#endif // always rebuild
 				break;
 			}
+			bOk = sendSegment( pReq, reqPkt.segmentId, bSendAll );
+			bDone = true;
+#else
+			// it might be new data this time, so rebuild the segments
+			purgeRequests( pReq->getType(), ipAddr, port );
+			// so create another request with this data.
+#endif // always rebuild
 		}
 		// we are done, so exit and unlock on way out
 		if ( bDone )
@@ -460,6 +627,7 @@ boolean	LtIpSegmentor::buildSegments( LtIpRequest& reqPkt, byte* pData, int nDat
 			// but it will later on.
 			bOk = true;
 		}
+		reschedule( pReq );
 	} while ( false ); // error control
 	unlock();
 	return bOk;
@@ -475,7 +643,6 @@ boolean	LtIpSegmentor::buildSegments( LtIpRequest& reqPkt, byte* pData, int nDat
 boolean	LtIpSegmentor::segmentRequest( LtIpRequest& reqPkt, ULONG ipAddress, word port )
 {
 	boolean			bOk = false;
-	LtVectorPos		pos;
 	LtIpSegReq*		pReq;
 	LtIpSegment		seg;
 	lock();
@@ -484,22 +651,19 @@ boolean	LtIpSegmentor::segmentRequest( LtIpRequest& reqPkt, ULONG ipAddress, wor
 		if ( ipAddress == 0 || port == 0 )
 		{	break;
 		}
-		while ( m_vReqs.getElement( pos, &pReq ) )
+		pReq = findRequestId( ipAddress, port, reqPkt.requestId );
+		if ( pReq )
 		{
-			if ( pReq->match( ipAddress, port, reqPkt.requestId ) )
+			// make sure that the request type matches original request
+			// else, invalid reuse of request id for a different packet type
+			if ( pReq->matchType( reqPkt.packetType ) )
+			{	bOk = true;
+			}
+			else
 			{
-				// make sure that the request type matches original request
-				// else, invalid reuse of request id for a different packet type
-				if ( pReq->matchType( reqPkt.packetType ) )
-				{	bOk = true;
-				}
-				else
-				{
-					LtIpAddressStr	ias;
-					vxlReportUrgent("Segment - invalid type / reqId match from %s : %d\n",
-							ias.getString( ipAddress ), port );
-				}
-				break;
+				LtIpAddressStr	ias;
+				vxlReportUrgent("Segment - invalid type / reqId match from %s : %d\n",
+						ias.getString( ipAddress ), port );
 			}
 		}
 		if ( !bOk ) break;
@@ -509,6 +673,7 @@ boolean	LtIpSegmentor::segmentRequest( LtIpRequest& reqPkt, ULONG ipAddress, wor
 		{	pReq->dropBall();
 		}
 		bOk = sendSegment( pReq, reqPkt.segmentId, reqPkt.reason | REQUEST_ALL );
+		reschedule( pReq );
 	} while (false );
 	unlock();
 	return bOk;
@@ -522,7 +687,6 @@ boolean	LtIpSegmentor::segmentRequest( LtIpRequest& reqPkt, ULONG ipAddress, wor
 boolean	LtIpSegmentor::dumpSegments( word requestId )
 {
 	boolean			bOk = false;
-	LtVectorPos		pos;
 	LtIpSegReq*		pReq;
 	LtIpSegment		seg;
 	int				nSegs;
@@ -531,8 +695,9 @@ boolean	LtIpSegmentor::dumpSegments( word requestId )
 	lock();
 	do
 	{
-		while ( m_vReqs.getElement( pos, &pReq ) )
+		for ( i = 0; i < m_nTimers; i++ )
 		{
+			pReq = m_ppTimers[i];
 			if ( pReq->getRequestId() == requestId )
 			{	bOk = true;
 				break;
@@ -558,14 +723,15 @@ boolean	LtIpSegmentor::dumpSegments( word requestId )
 //
 void	LtIpSegmentor::dump( boolean bSegments )
 {
-	LtVectorPos		pos;
 	LtIpSegReq*		pReq;
+	int				i;
 
 	lock();
 	vxlReportEvent("LtIpSegmentor::dump - requests %d\n",
-		m_vReqs.getCount() );
-	while ( m_vReqs.getElement( pos, &pReq ) )
+		m_nTimers );
+	for ( i = 0; i < m_nTimers; i++ )
 	{
+		pReq = m_ppTimers[i];
 		vxlReportEvent("                      reqId %d segments %d complete %d\n",
 			pReq->getRequestId(), pReq->getNumSegments(), pReq->isComplete() );
 		if ( bSegments )
@@ -698,21 +864,62 @@ boolean	LtIpSegmentor::sendPacket( byte* pData, int nLen, ULONG ipAddr, word por
 //
 LtIpSegReq* LtIpSegmentor::findRequest( int nPktType, ULONG ipAddress, word port )
 {
-	boolean			bOk = false;
-	LtVectorPos		pos;
-	LtIpSegReq*		pReq;
+	LtHashTablePos	pos;
+	LtIpSegReq*		pReq = NULL;
+	int				i;
 
 	// prelock required
 	//lock();
-	while ( m_vReqs.getElement( pos, &pReq ) )
+	if ( ipAddress != 0 )
 	{
-		if ( pReq->matchTypeIp( nPktType, ipAddress, port ) )
-		{	bOk = true;
-			break;
+		while ( NULL != ( pReq = m_hReqs.getNextForPeer( ipAddress, port, pos ) ) )
+		{
+			if ( pReq->matchTypeIp( nPktType, ipAddress, port ) )
+			{	break;
+			}
+		}
+	}
+	else
+	{
+		for ( i = 0; i < m_nTimers; i++ )
+		{
+			if ( m_ppTimers[i]->matchTypeIp( nPktType, ipAddress, port ) )
+			{	pReq = m_ppTimers[i];
+				break;
+			}
 		}
 	}
 	//unlock();
-	if ( !bOk ) pReq = NULL;
+	return pReq;
+}
+
+//
+// findRequestId
+//
+// find a request by peer and request id.
+// An ipAddress of zero matches any peer.
+// call with lock
+//
+LtIpSegReq* LtIpSegmentor::findRequestId( ULONG ipAddress, word port, word reqId )
+{
+	LtIpSegReq*		pReq = NULL;
+	int				i;
+
+	if ( ipAddress != 0 )
+	{
+		LtIpSegReqKey	key( ipAddress, port, reqId );
+		pReq = m_hReqs.get( &key );
+	}
+	else
+	{
+		for ( i = 0; i < m_nTimers; i++ )
+		{
+			if ( m_ppTimers[i]->match( ipAddress, port, reqId ) )
+			{	pReq = m_ppTimers[i];
+				break;
+			}
+		}
+	}
 	return pReq;
 }
 
@@ -726,18 +933,31 @@ LtIpSegReq* LtIpSegmentor::findRequest( int nPktType, ULONG ipAddress, word port
 boolean	LtIpSegmentor::hasPendingRequest( int nPktType, ULONG ipAddr, word port )
 {
 	boolean	bFound = false;
-	LtVectorPos		pos;
+	LtHashTablePos	pos;
 	LtIpSegReq*		pReq;
+	int				i;
 
 	lock();
-	while ( m_vReqs.getElement( pos, &pReq ) )
+	if ( ipAddr != 0 )
 	{
-		if ( pReq->matchTypeIp( nPktType, ipAddr, port ) )
+		while ( NULL != ( pReq = m_hReqs.getNextForPeer( ipAddr, port, pos ) ) )
 		{
 			// found a request matching the type, IP & port
-			if (! pReq->isPayloadDelivered())
+			// that is still active and not delivered
+			if ( pReq->matchTypeIp( nPktType, ipAddr, port ) && !pReq->isPayloadDelivered() )
+			{
+				bFound = true;
+				break;
+			}
+		}
+	}
+	else
+	{
+		for ( i = 0; i < m_nTimers; i++ )
+		{
+			pReq = m_ppTimers[i];
+			if ( pReq->matchTypeIp( nPktType, ipAddr, port ) && !pReq->isPayloadDelivered() )
 			{
-				// this request is still active and not delivered
 				bFound = true;
 				break;
 			}
@@ -747,6 +967,145 @@ boolean	LtIpSegmentor::hasPendingRequest( int nPktType, ULONG ipAddr, word port
 	return bFound;
 }
 
+//
+// addTimer
+//
+// put a new request in the timer heap
+// call with lock
+//
+void	LtIpSegmentor::addTimer( LtIpSegReq* pReq )
+{
+	if ( m_nTimers == m_nMaxTimers )
+	{
+		LtIpSegReq**	ppTimers = new LtIpSegReq*[ m_nMaxTimers*2 ];
+		memcpy( ppTimers, m_ppTimers, m_nTimers*sizeof(LtIpSegReq*) );
+		delete[] m_ppTimers;
+		m_ppTimers = ppTimers;
+		m_nMaxTimers *= 2;
+	}
+	pReq->setTickDue( pReq->getDueTick() );
+	setTimerAt( m_nTimers, pReq );
+	siftTimerUp( m_nTimers++ );
+}
+
+//
+// removeTimer
+//
+// take a request out of the timer heap
+// call with lock
+//
+void	LtIpSegmentor::removeTimer( LtIpSegReq* pReq )
+{
+	int		nIdx = pReq->getTimerIdx();
+
+	if ( nIdx < 0 )
+	{	return;
+	}
+	pReq->setTimerIdx( -1 );
+	m_nTimers--;
+	if ( nIdx != m_nTimers )
+	{
+		// move the last one into the hole and put it where it belongs
+		pReq = m_ppTimers[m_nTimers];
+		setTimerAt( nIdx, pReq );
+		siftTimerUp( nIdx );
+		siftTimerDown( pReq->getTimerIdx() );
+	}
+}
+
+//
+// reschedule
+//
+// the request changed state, so its next timer event may have moved.
+// call with lock
+//
+void	LtIpSegmentor::reschedule( LtIpSegReq* pReq )
+{
+	if ( pReq->getTimerIdx() >= 0 )
+	{
+		pReq->setTickDue( pReq->getDueTick() );
+		siftTimerUp( pReq->getTimerIdx() );
+		siftTimerDown( pReq->getTimerIdx() );
+	}
+}
+
+void	LtIpSegmentor::siftTimerUp( int nIdx )
+{
+	LtIpSegReq*		pReq = m_ppTimers[nIdx];
+	int				nParent;
+
+	while ( nIdx > 0 )
+	{
+		nParent = (nIdx-1)/2;
+		if ( !isDueBefore( pReq, m_ppTimers[nParent] ) )
+		{	break;
+		}
+		setTimerAt( nIdx, m_ppTimers[nParent] );
+		nIdx = nParent;
+	}
+	setTimerAt( nIdx, pReq );
+}
+
+void	LtIpSegmentor::siftTimerDown( int nIdx )
+{
+	LtIpSegReq*		pReq = m_ppTimers[nIdx];
+	int				nChild;
+
+	while ( true )
+	{
+		nChild = 2*nIdx + 1;
+		if ( nChild >= m_nTimers )
+		{	break;
+		}
+		if ( nChild+1 < m_nTimers && isDueBefore( m_ppTimers[nChild+1], m_ppTimers[nChild] ) )
+		{	nChild++;
+		}
+		if ( !isDueBefore( m_ppTimers[nChild], pReq ) )
+		{	break;
+		}
+		setTimerAt( nIdx, m_ppTimers[nChild] );
+		nIdx = nChild;
+	}
+	setTimerAt( nIdx, pReq );
+}
+
+//
+// allocReassemblyPacket
+//
+// get a packet with a buffer big enough for a whole reassembled payload.
+// The pool is created on first use, since only the inbound segmentor needs it.
+// When the pool is used up the buffer comes from the heap, as it did
+// before there was a pool. Such a packet frees itself on release.
+// call with lock
+//
+LtPktInfo*	LtIpSegmentor::allocReassemblyPacket( int nSize )
+{
+	LtPktInfo*	pPkt = NULL;
+	byte*		p;
+
+	if ( nSize <= LtIpSegReq::MAX_TOTAL_SEG_PAYLOAD )
+	{
+		if ( m_pReasmAlloc == NULL )
+		{
+			m_pReasmAlloc = new LtIpReasmAllocator();
+			m_pReasmAlloc->init( LtIpSegReq::MAX_TOTAL_SEG_PAYLOAD, REASM_BUFS, REASM_NEXT_BUFS, REASM_MAX_BUFS );
+			m_pReasmAlloc->initMsgRefs( REASM_BUFS, REASM_NEXT_BUFS, REASM_MAX_BUFS );
+		}
+		pPkt = m_pReasmAlloc->allocPacket();
+	}
+	if ( pPkt == NULL && nSize > 0 )
+	{
+		p = (byte*)malloc( nSize );
+		if ( p )
+		{
+			pPkt = new LtPktInfo();
+			pPkt->init(true);
+			pPkt->setBlock( p );
+		}
+	}
+	return pPkt;
+}
+
 
 //
 // newInboundRequest
@@ -824,6 +1183,7 @@ boolean	LtIpSegmentor::receivedPacket( LtPktInfo* pPkt, LtPktInfo** ppPktRtn,
 	byte*			p;
 	int				nSize;
 	LtIpSegReq*		pReq;
+	LtIpSegReq*		pOldReq;
 	LtPktInfo*		pPkt2;
 	boolean			bDone = false;
 	boolean			bFound = false;
@@ -873,34 +1233,33 @@ boolean	LtIpSegmentor::receivedPacket( LtPktInfo* pPkt, LtPktInfo** ppPktRtn,
 			}
 		}
 
-		// remove and delete all the request elements, if there are any
 		bOk = false;	// default is create a new request and enter the packet
-		LtVectorPos		pos;
-		while ( m_vReqs.getElement( pos, &pReq ) )
-		{
-			if ( pReq->match( ipAddr, port, seg.requestId ) )
-			{	// we found a matching request, default to toss it out
-				// then check with request.
-				bOk = pReq->segmentArrived( pPkt, seg );
-				if ( bOk )
-				{	bRelease = false;
-					bDone = true;
-				}
-				bFound = true; // we found a request, so don't create a new one
-				break;
+		pReq = findRequestId( ipAddr, port, seg.requestId );
+		if ( pReq )
+		{	// we found a matching request, default to toss it out
+			// then check with request.
+			bOk = pReq->segmentArrived( pPkt, seg );
+			if ( bOk )
+			{	bRelease = false;
+				bDone = true;
 			}
-			else if ( seg.segmentId == 0 )	// IKP05202003: removing any old pending reqs
+			bFound = true; // we found a request, so don't create a new one
+			reschedule( pReq );
+		}
+		if ( seg.segmentId == 0 )	// IKP05202003: removing any old pending reqs
+		{
+			// only do this checking if we receive a new segment
+			LtHashTablePos	pos;
+			while ( NULL != ( pOldReq = m_hReqs.getNextForPeer( ipAddr, port, pos ) ) )
 			{
-				// only do this checking if we receive a new segment
-				if (pReq->matchTypeIp(nReqType, ipAddr, port))
+				// found a request matching the type, IP & port
+				if ( pOldReq != pReq && pOldReq->matchTypeIp( nReqType, ipAddr, port ) &&
+					 !pOldReq->isPayloadDelivered() )
 				{
-					// found a request matching the type, IP & port
-					if (! pReq->isPayloadDelivered())
-					{
-						// remove from the list, since we are creating a new request for it.
-						m_vReqs.removeElement( pos );
-						delete pReq;
-					}
+					// remove from the list, since we are creating a new request for it.
+					m_hReqs.removePeerAt( pos );
+					removeTimer( pOldReq );
+					delete pOldReq;
 				}
 			}
 		}
@@ -922,10 +1281,10 @@ boolean	LtIpSegmentor::receivedPacket( LtPktInfo* pPkt, LtPktInfo** ppPktRtn,
 				pReq, reqPkt.requestId, reqPkt.packetType, ias.getString( ipAddr ), port );
 #endif // TESTSEGS
 			bOk = pReq->segmentArrived( pPkt, seg );
+			reschedule( pReq );
 			if ( bOk )
 			{	bRelease = false;
 				bDone = true;
-				break;
 			}
 		}
 
@@ -935,17 +1294,30 @@ boolean	LtIpSegmentor::receivedPacket( LtPktInfo* pPkt, LtPktInfo** ppPktRtn,
 		{
 			if ( pReq->isComplete() )
 			{
-				p = pReq->getPayload();
-				nSize = pReq->getPayloadSize();
-				pReq->takePayload();
-				pPkt2 = new LtPktInfo();
-				pPkt2->init(true);
-				pPkt2->setBlock( p );
-				pPkt2->setMessageData( p, nSize, pPkt2 );
-				// we do not authenticate payloads
-				pPkt2->setIgnoreAuthentication( true );
-				*ppPktRtn = pPkt2;
+				// assemble straight into a pooled buffer. This gives the
+				// segment packets back to the link, including this one.
+				pPkt2 = allocReassemblyPacket( pReq->getPayloadSize() );
+				if ( pPkt2 )
+				{
+					p = pPkt2->getBlock();
+					nSize = pReq->assemblePayload( p );
+					pPkt2->setMessageData( p, nSize, pPkt2 );
+					pPkt2->setIpSrcAddr( ipAddr );
+					pPkt2->setIpSrcPort( port );
+					// we do not authenticate payloads
+					pPkt2->setIgnoreAuthentication( true );
+					*ppPktRtn = pPkt2;
+					pReq->takePayload();
+				}
+				else
+				{
+					// keep the segments, the request stays unsatisfied
+					// and times out like any other incomplete one.
+					vxlReportUrgent("LtIpSegmentor::receivedPacket - no buffer for %d byte payload\n",
+									pReq->getPayloadSize() );
+				}
 				// do not delete the request, but it is marked as having been satisfied
+				reschedule( pReq );
 			}
 		}
 
@@ -967,15 +1339,17 @@ boolean	LtIpSegmentor::receivedPacket( LtPktInfo* pPkt, LtPktInfo** ppPktRtn,
 // Discard stale requests
 // called by timer task with the ticks.
 // return when complete. Loop is in base class.
+// Only the requests that are due are looked at, the heap keeps the
+// one with the earliest due tick on top.
 //
 boolean LtIpSegmentor::doTimeout( ULONG nTickNow )
 {
-	LtVectorPos		pos;
 	LtIpSegReq*		pReq;
 	LtIpSegment		segPkt;
 	LtIpRequest		reqPkt;
 	byte			segBuf[ UDP_MAX_PKT_LEN + 10 ];
 	boolean			bOk;
+	ULONG			tickDue;
 #ifdef TESTSEGS
 	LtIpAddressStr ias;
 #endif // TESTSEGS
@@ -983,7 +1357,7 @@ boolean LtIpSegmentor::doTimeout( ULONG nTickNow )
 	if ( !isActive() )
 	{
 #ifdef TESTSEGS
-		int	nCount = m_vReqs.getCount();
+		int	nCount = m_nTimers;
 		if ( nCount )
 		{
 			vxlReportEvent("LtIpSegmentor::doTimeout - %d reqs left inactive %d\n",
@@ -1004,16 +1378,17 @@ boolean LtIpSegmentor::doTimeout( ULONG nTickNow )
 	}
 
 	lock();
-	while ( m_vReqs.getElement( pos, &pReq ) )
+	while ( m_nTimers && (LONG)( m_ppTimers[0]->getTickDue() - nTickNow ) <= 0 )
 	{
+		pReq = m_ppTimers[0];
 		if ( pReq->isTimedOut( nTickNow ) )
 		{
 #ifdef TESTSEGS
 			vxlReportEvent("Segments::doTimeout - request timed out - 0x%08x reqId %d %s\n",
 						pReq, pReq->getRequestId(), ias.getString( pReq->getIpAddr()) );
 #endif // TESTSEGS
-			m_vReqs.removeElement( pos );
-			delete pReq;
+			deleteRequest( pReq );
+			continue;
 		}
 		else if ( pReq->isOutbound() )
 		{
@@ -1057,8 +1432,15 @@ boolean LtIpSegmentor::doTimeout( ULONG nTickNow )
 				}
 			}
 		}
+		// look at this request again when it is next due, but not in this pass
+		tickDue = pReq->getDueTick();
+		if ( (LONG)( tickDue - nTickNow ) <= 0 )
+		{	tickDue = nTickNow + 1;
+		}
+		pReq->setTickDue( tickDue );
+		siftTimerDown( 0 );
 	}
-	boolean bActive =  0 != m_vReqs.getCount();
+	boolean bActive =  0 != m_nTimers;
 	unlock();
 	return bActive;
 }
@@ -1093,6 +1475,8 @@ LtIpSegReq::LtIpSegReq() : m_qSegs(true)
 	m_nPayloadSize		= 0;			// size of assembled payload
 	m_bWeOwnPayload		= false;		// if we own it, then we can free it
 	m_bUseExtHdrs		= false;		// use extended packet headers
+	m_nTimerIdx			= -1;			// not in a timer heap yet
+	m_tickDue			= 0;
 }
 
 //
@@ -1220,7 +1604,8 @@ boolean		LtIpSegReq::segmentArrived( LtPktInfo* pPkt, LtIpSegment& segPkt )
 // checkComplete
 //
 // Scan the segments and see if we have them all.
-// then assemble a complete payload as a contiguous memory block
+// The segments are not copied here. The segmentor assembles the payload
+// into a buffer of its own with assemblePayload once it takes it.
 //
 boolean	LtIpSegReq::checkComplete()
 {
@@ -1228,6 +1613,7 @@ boolean	LtIpSegReq::checkComplete()
 	boolean			bOk = false;
 	boolean			bBad = false;
 	LtIpPktHeader	pkt;
+	int				nTotal;
 
 	do
 	{
@@ -1249,7 +1635,7 @@ boolean	LtIpSegReq::checkComplete()
 
 	while ( bOk )
 	{
-		// we have all the segments now, so assemble the payload
+		// we have all the segments now, so size the payload
 		// First parse the first payload so that we have the size of the
 		// whole payload packet
 		freePayload();
@@ -1260,25 +1646,20 @@ boolean	LtIpSegReq::checkComplete()
 			m_nPayloadSize = 0;
 			break;
 		}
-		m_bWeOwnPayload = true;
-		m_pPayload = (byte*)malloc( m_nPayloadSize );
-		byte*	p = m_pPayload;
-		byte*	pend = p + m_nPayloadSize;
+		nTotal = 0;
 		for ( i=0; i< m_nSegments; i++ )
 		{
-			// watch for invalid payload packet and other errors
-			// that cause too much packet data
-			if ( ( p+m_aSegs[i].payloadSize ) > pend )
-			{	bOk = false;
-				// serious error
-				// maybe somebody trying to hack us or crash us
-				// so cause a restart from begining.
-				// Transfer will eventually timeout.
-				zapSegs();
-				break;
-			}
-			memcpy( p, m_aSegs[i].payload, m_aSegs[i].payloadSize );
-			p += m_aSegs[i].payloadSize;
+			nTotal += m_aSegs[i].payloadSize;
+		}
+		// watch for invalid payload packet and other errors
+		// that cause too much packet data
+		if ( nTotal > m_nPayloadSize )
+		{	bOk = false;
+			// serious error
+			// maybe somebody trying to hack us or crash us
+			// so cause a restart from begining.
+			// Transfer will eventually timeout.
+			zapSegs();
 		}
 		break;	// while is an error exit loop. So exit here.
 	}
@@ -1286,6 +1667,28 @@ boolean	LtIpSegReq::checkComplete()
 	return bOk;
 }
 
+//
+// assemblePayload
+//
+// copy the segments of a complete request into pBuf, which must hold
+// getPayloadSize() bytes. From here on only the segment headers are needed
+// to reject duplicates, so the segment packets are released.
+//
+int		LtIpSegReq::assemblePayload( byte* pBuf )
+{
+	int		i;
+	byte*	p = pBuf;
+
+	for ( i=0; i< m_nSegments; i++ )
+	{
+		memcpy( p, m_aSegs[i].payload, m_aSegs[i].payloadSize );
+		p += m_aSegs[i].payloadSize;
+		m_aSegs[i].payload = NULL;
+	}
+	emptyQueue();
+	return m_nPayloadSize;
+}
+
 
 //
 // isTimedOut
@@ -1302,6 +1705,34 @@ boolean		LtIpSegReq::isTimedOut( ULONG nTicksNow )
 	return bOut;
 }
 
+//
+// getDueTick
+//
+// The earliest tick at which isTimedOut, getOutboundSegment or
+// getInboundRequest can have something for us.
+//
+ULONG		LtIpSegReq::getDueTick()
+{
+	ULONG		tickDue = m_tickLast + (ULONG)msToTicksX( TIMEOUT_QUIET ) + 1;
+	ULONG		tickBusy = m_tickStarted + (ULONG)msToTicksX( TIMEOUT_BUSY ) + 1;
+	ULONG		tickRetrans;
+
+	if ( (LONG)( tickBusy - tickDue ) < 0 )
+	{	tickDue = tickBusy;
+	}
+	// outbound requests retransmit while we have the ball,
+	// inbound ones until they are complete.
+	if ( m_bOutbound ? m_bHasBall : !m_bComplete )
+	{
+		tickRetrans = m_tickSent + 1 +
+			( m_bOutbound ? (ULONG)TIMEOUT_RETRANS : (ULONG)msToTicksX( TIMEOUT_RETRANS ) );
+		if ( (LONG)( tickRetrans - tickDue ) < 0 )
+		{	tickDue = tickRetrans;
+		}
+	}
+	return tickDue;
+}
+
 //
 // buildSegments
 //
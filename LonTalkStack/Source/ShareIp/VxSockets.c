@@ -66,6 +66,10 @@
  *
  */
 
+#if defined(linux) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE		// for recvmmsg
+#endif
+
 #include	<vxWorks.h>
 #include	<stdio.h>
 #include	<stdlib.h>
@@ -85,6 +89,7 @@
 #include 	<ifaddrs.h>
 #include    <netpacket/packet.h>
 #include    <net/ethernet.h>
+#include    <poll.h>
 #else
 #include    <socket.h>
 #include	<netinet\in.h>
@@ -105,6 +110,12 @@
 // Local data definitions
 //
 
+// Most datagrams vxsRecvFromMulti will take in one call
+#define VXS_RECV_MULTI_MAX		16
+
+// Sockets vxsSelectAnyWrite can poll without allocating
+#define VXS_POLL_LOCAL_MAX		16
+
 
 //////////////////////////////////////////////////////////////////////////
 // Local data structures
@@ -472,6 +483,44 @@ int			vxsSend( VXSOCKET sock, LPSTR buf, int bufLen, int flags )
 	return send( sock, buf, bufLen, flags );
 }
 
+#ifdef linux
+// True if the last send failed only because the socket had no buffer space
+static boolean sendBufferFull( void )
+{
+	return errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS;
+}
+#endif
+
+// Send a UDP frame without blocking
+int			vxsSendToNoWait( VXSOCKET sock, LPSTR buf, int bufLen, VXSOCKADDR psad )
+{
+#ifdef linux
+	int		nBytes = vxsSendTo( sock, buf, bufLen, MSG_DONTWAIT, psad );
+
+	if ( nBytes < 0 && sendBufferFull() )
+	{	nBytes = 0;
+	}
+	return nBytes;
+#else
+	return vxsSendTo( sock, buf, bufLen, 0, psad );
+#endif
+}
+
+// Send on a connected or raw socket without blocking
+int			vxsSendNoWait( VXSOCKET sock, LPSTR buf, int bufLen )
+{
+#ifdef linux
+	int		nBytes = send( sock, buf, bufLen, MSG_DONTWAIT );
+
+	if ( nBytes < 0 && sendBufferFull() )
+	{	nBytes = 0;
+	}
+	return nBytes;
+#else
+	return vxsSend( sock, buf, bufLen, 0 );
+#endif
+}
+
 // Receive a datagram
 int			vxsRecvFrom( VXSOCKET sock, char* buf, int bufLen, int flags, VXSOCKADDR psad )
 {
@@ -484,6 +533,104 @@ int			vxsRecvFrom( VXSOCKET sock, char* buf, int bufLen, int flags, VXSOCKADDR p
 	return recvfrom( sock, buf, bufLen, flags, &psad->U.sad, &addrLen );
 }
 
+#ifdef linux
+// Pull the header destination address out of the IP_PKTINFO control data
+static ULONG pktInfoDestAddr( struct msghdr* pMsg )
+{
+	struct cmsghdr*	pCmsg;
+
+	for ( pCmsg = CMSG_FIRSTHDR(pMsg); pCmsg != NULL; pCmsg = CMSG_NXTHDR(pMsg, pCmsg) )
+	{
+		if ( pCmsg->cmsg_level == IPPROTO_IP && pCmsg->cmsg_type == IP_PKTINFO )
+		{	return ((struct in_pktinfo*)CMSG_DATA(pCmsg))->ipi_addr.s_addr;
+		}
+	}
+	return 0;
+}
+#endif
+
+// Receive a datagram along with its destination address
+int			vxsRecvFromDest( VXSOCKET sock, char* buf, int bufLen, int flags, VXSOCKADDR psad, ULONG* pDestAddr )
+{
+#ifdef linux
+	struct msghdr	msg;
+	struct iovec	iov;
+	char			control[CMSG_SPACE(sizeof(struct in_pktinfo))];
+	int				nBytes;
+
+	memset( &msg, 0, sizeof(msg) );
+	iov.iov_base = buf;
+	iov.iov_len = bufLen;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_name = &psad->U.sad;
+	msg.msg_namelen = sizeof(psad->U.sad);
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+	nBytes = recvmsg( sock, &msg, flags );
+	*pDestAddr = (nBytes < 0) ? 0 : pktInfoDestAddr( &msg );
+	return nBytes;
+#else
+	*pDestAddr = 0;
+	return vxsRecvFrom( sock, buf, bufLen, flags, psad );
+#endif
+}
+
+// Receive a batch of datagrams
+int			vxsRecvFromMulti( VXSOCKET sock, char* buf, int bufLen, int nMax, int* pLens, VXSOCKADDR* psad, ULONG* pDestAddrs )
+{
+#ifdef linux
+	struct mmsghdr	msgs[VXS_RECV_MULTI_MAX];
+	struct iovec	iovs[VXS_RECV_MULTI_MAX];
+	char			control[VXS_RECV_MULTI_MAX][CMSG_SPACE(sizeof(struct in_pktinfo))];
+	int				i;
+	int				nMsgs;
+
+	if ( nMax > VXS_RECV_MULTI_MAX )
+	{	nMax = VXS_RECV_MULTI_MAX;
+	}
+	memset( msgs, 0, nMax*sizeof(msgs[0]) );
+	for ( i = 0; i < nMax; i++ )
+	{
+		iovs[i].iov_base = buf + i*bufLen;
+		iovs[i].iov_len = bufLen;
+		msgs[i].msg_hdr.msg_iov = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		msgs[i].msg_hdr.msg_name = &psad[i]->U.sad;
+		msgs[i].msg_hdr.msg_namelen = sizeof(psad[i]->U.sad);
+		if ( pDestAddrs != NULL )
+		{	msgs[i].msg_hdr.msg_control = control[i];
+			msgs[i].msg_hdr.msg_controllen = sizeof(control[i]);
+		}
+	}
+	nMsgs = recvmmsg( sock, msgs, nMax, MSG_DONTWAIT, NULL );
+	if ( nMsgs < 0 )
+	{
+		// Nothing waiting is not an error as far as the caller is concerned
+		return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : ERROR;
+	}
+	for ( i = 0; i < nMsgs; i++ )
+	{	pLens[i] = msgs[i].msg_len;
+		if ( pDestAddrs != NULL )
+		{	pDestAddrs[i] = pktInfoDestAddr( &msgs[i].msg_hdr );
+		}
+	}
+	return nMsgs;
+#else
+	// No batch receive available, so take the one datagram the caller selected
+	int		nBytes = vxsRecvFrom( sock, buf, bufLen, 0, psad[0] );
+
+	if ( nBytes == ERROR )
+	{	return ERROR;
+	}
+	pLens[0] = nBytes;
+	if ( pDestAddrs != NULL )
+	{	pDestAddrs[0] = 0;
+	}
+	return 1;
+#endif
+}
+
 // Receive from stream
 int			vxsRecv( VXSOCKET sock, char* buf, int bufLen, int flags )
 {
@@ -544,6 +691,77 @@ int         vxsSelectAnyRead( VXSOCKET *sockets, int numSockets, struct timeval
     return result;
 }
 
+// Wait for any of several sockets to have room to send
+int         vxsSelectAnyWrite( VXSOCKET *sockets, int numSockets, struct timeval *timeout)
+{
+#ifdef linux
+    struct pollfd   localFds[VXS_POLL_LOCAL_MAX];
+    struct pollfd*  pFds = localFds;
+    int             numSet = 0;
+    int             result = -1;
+    int             msTimeout = -1;
+    int             i;
+
+    if (numSockets > VXS_POLL_LOCAL_MAX)
+    {
+        pFds = (struct pollfd*)malloc(numSockets*sizeof(struct pollfd));
+        if (pFds == NULL)
+        {
+            return -1;
+        }
+    }
+    for (i = 0; i < numSockets; i++)
+    {
+        if (sockets[i] != INVALID_SOCKET)
+        {
+            pFds[numSet].fd = sockets[i];
+            pFds[numSet].events = POLLOUT;
+            pFds[numSet].revents = 0;
+            numSet++;
+        }
+    }
+    if (timeout != NULL)
+    {
+        msTimeout = timeout->tv_sec*1000 + (timeout->tv_usec + 999)/1000;
+    }
+    if (numSet)
+    {
+        result = poll(pFds, numSet, msTimeout);
+    }
+    if (pFds != localFds)
+    {
+        free(pFds);
+    }
+    return result;
+#else
+    int i;
+    int numSet = 0;
+	int         result = -1;
+    fd_set      writeFds;
+    VXSOCKET    fdMax = -1;
+
+    FD_ZERO (&writeFds);
+    for (i = 0; i < numSockets; i++)
+    {
+    	VXSOCKET sock = *sockets++;
+
+    	if (sock != INVALID_SOCKET)
+    	{
+    		FD_SET (sock, &writeFds);
+     		numSet++;
+            if (sock > fdMax)
+            	fdMax = sock;
+    	}
+    }
+    if (numSet)
+    {
+        result = select(fdMax+1, NULL, &writeFds, NULL, timeout);
+    }
+
+    return result;
+#endif
+}
+
 // returns errno type value, 0 on success
 int GetInterfaceInfo(int sockfd, char *name, int *outMtu, int *outMetric)
 {
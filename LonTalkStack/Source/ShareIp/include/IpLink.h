@@ -279,6 +279,8 @@ public:
 						byte flags,
 						byte* pData,
 						int nMaxLength);
+	int queueReceiveBatch(LtReceivePost* pPosts, int nPosts,
+						  boolean bTryOther = true);
 	void reset();
 
 	void setNoHeader( BOOL bNoHeader )
@@ -142,6 +142,9 @@
 #include <assert.h>
 
 #define MAX_CLOCK_TICKS 120
+// Largest backwards step of the wall clock, in ms, that getTimestamp() hides
+// to stay monotonic.  Larger steps are clock changes and are followed.
+#define MAX_CLOCK_DRIFT_MS 1000
 
 enum
 {
@@ -242,10 +245,16 @@ struct LtIpPktHeader
 {
 	static	int			 clkRate;
 	static	ULONGLONG	 msPerSec;
-	static	boolean		 bGotClock;
-	static	ULONG		 nLastTick;
-	static  ULONGLONG	 tClkTime;
-	static  struct timespec  tTimeSpec;
+	// Clock base for getTimestamp(), shared by all threads.  Published under
+	// clkSeq, which is odd while the base is being updated.  Only the thread
+	// that sets clkRefreshing updates it.  clkHighMs is the latest
+	// timestamp handed out by any thread.
+	static	volatile ULONG		clkSeq;
+	static	volatile ULONG		clkHighMs;
+	static	volatile LONG		clkRefreshing;
+	static	volatile boolean	bGotClock;
+	static	volatile ULONG		nLastTick;
+	static  volatile ULONGLONG	tClkTime;
 
 	enum
 	{	
@@ -287,6 +296,8 @@ struct LtIpPktHeader
 	LtIpPktHeader();
 	virtual ~LtIpPktHeader();
 	static ULONG	getTimestamp(boolean bSyncCheck=true);
+	static void		refreshClock(ULONG nSeq, ULONG nBaseTick, ULONGLONG& tBase,
+								 ULONG& nTickNow, boolean& bSynched);
 	static ULONG	getDateTime();
 	static ULONG	getTd1970();	// time delta from 1900 to 1970
 	// Size functions
@@ -102,6 +102,7 @@
 #include <SegSupport.h>
 #endif // SEGSUPPORTX
 #include <LtMD5.h>
+#include <LtHashTable.h>
 
 extern "C" ULONG tickGet();
 
@@ -232,6 +233,8 @@ protected:
 	ULONG		m_ipAddrLocal;			// Data for extended headers
 	ULONG		m_natIpAddr;			//   same
 	word		m_ipPortLocal;			//	 same
+	int			m_nTimerIdx;			// slot in the segmentor's timer heap, -1 if none
+	ULONG		m_tickDue;				// tick of the next timer event for this request
 
 
 	void		freePayload();			// free the payload if we own it
@@ -315,6 +318,21 @@ public:
 		m_tickSent = tickGet();	// tick count for starting process
 	}
 	boolean		isTimedOut( ULONG nTicksNow );
+	// earliest tick at which doTimeout has anything to do with this request,
+	// either time it out or retransmit.
+	ULONG		getDueTick();
+	int			getTimerIdx()
+	{	return m_nTimerIdx;
+	}
+	void		setTimerIdx( int nIdx )
+	{	m_nTimerIdx = nIdx;
+	}
+	ULONG		getTickDue()
+	{	return m_tickDue;
+	}
+	void		setTickDue( ULONG tickDue )
+	{	m_tickDue = tickDue;
+	}
 	boolean		isComplete()
 	{	return m_bComplete;
 	}
@@ -332,6 +350,9 @@ public:
 		m_nPayloadSize = 0;
 		m_bPayloadDelivered = true;
 	}
+	// copy the completed inbound segments into a caller supplied buffer
+	// of at least getPayloadSize() bytes. Releases the segment packets.
+	int			assemblePayload( byte* pBuf );
 	// IKP05202003: added support for checking of any pending requests
 	boolean		isPayloadDelivered()
 	{
@@ -414,8 +435,58 @@ public:
 class LtIpSegReq;
 class LtPktInfo;
 class CIpLink;
-//typedef LtTypedVVector<LtIpSegReq> LtSegReqV;
-typedef LtTypedVector<LtIpSegReq> LtSegReqV;
+class LtIpReasmAllocator;
+
+//
+// LtIpSegReqKey class - Hash key class
+//
+// Requests are identified by the peer address, port and request id.
+// Only the peer address and port are used for the hash code, so all the
+// requests of one peer fall in the same bucket. This lets the segmentor
+// look at all the requests of a peer without scanning the whole table.
+//
+class LtIpSegReqKey : public LtHashKey
+{
+public:
+	ULONG		ipAddrValue;
+	word		ipPortValue;
+	word		reqIdValue;
+
+	LtIpSegReqKey( ULONG ipAddr, word ipPort, word reqId )
+	{	ipAddrValue = ipAddr;
+		ipPortValue	= ipPort;
+		reqIdValue	= reqId;
+	}
+	int		hashCode()
+	{	return (int)( ipAddrValue ^ ( ((ULONG)ipPortValue) << 16 ) ^ ipPortValue );
+	}
+	boolean	matchPeer( ULONG ipAddr, word ipPort )
+	{	return ipAddrValue == ipAddr && ipPortValue == ipPort;
+	}
+	boolean operator ==( LtHashKey& key )
+	{	return ((LtIpSegReqKey&)key).matchPeer( ipAddrValue, ipPortValue ) &&
+				reqIdValue == ((LtIpSegReqKey&)key).reqIdValue;
+	}
+};
+
+//
+// LtIpSegReqTable Hash table class
+//
+class LtIpSegReqTable : public LtTypedHashTable< LtIpSegReqKey, LtIpSegReq >
+{
+public:
+	enum { DEFAULT_SIZE = 509 };
+	LtIpSegReqTable(int size = DEFAULT_SIZE) : LtTypedHashTable<LtIpSegReqKey, LtIpSegReq>(size) {}
+	// Return the next request of a peer, any request id.
+	// Start with a reset position. A NULL return ends the walk.
+	LtIpSegReq* getNextForPeer( ULONG ipAddr, word ipPort, LtHashTablePos& pos );
+	// remove the request returned by the last getNextForPeer, the walk
+	// may be continued afterwards.
+	void		removePeerAt( LtHashTablePos& pos );
+	int			getCount()
+	{	return m_nCount;
+	}
+};
 
 class LtIpSegmentor : public LtIpSegBase
 {
@@ -424,7 +495,11 @@ protected:
 	LtPktAllocator*	m_pAlloc;				// allocator to get buffers for sending
 											// cannot use for receiving since packets may be large
 	word			m_nNextReqId;			// The next request Id to use for sending
-	LtSegReqV		m_vReqs;				// vector of outstanding requests
+	LtIpSegReqTable	m_hReqs;				// outstanding requests by peer and request id
+	LtIpSegReq**	m_ppTimers;				// outstanding requests as a heap on due tick
+	int				m_nTimers;				// requests in the heap
+	int				m_nMaxTimers;			// allocated heap slots
+	LtIpReasmAllocator*	m_pReasmAlloc;		// pre-sized buffers for reassembled payloads
 	LtPktInfo*		m_pSentPkt;				// testing - the packet we built to send if no link
 	LtMD5			m_md5;					// seat of the secret...
 	boolean			m_bActive;				// Must be active to do anything
@@ -436,6 +511,10 @@ protected:
 public:
 	enum {
 		TIMEOUT_TIMERMS	= (1*1000),		// timer tick rate in milliseconds
+		INITIAL_TIMERS	= 64,			// initial timer heap size
+		REASM_BUFS		= 4,			// initial reassembly buffers
+		REASM_NEXT_BUFS	= 4,			// reassembly buffer allocation increment
+		REASM_MAX_BUFS	= 256,			// max reassembly buffers
 	};
 	LtIpSegmentor();
 	virtual ~LtIpSegmentor();
@@ -508,7 +587,7 @@ public:
 
 	int		getRequestCount()
 	{
-		return m_vReqs.getCount();
+		return m_nTimers;
 	}
 
 	// **** INBOUND SEGMENTS
@@ -540,6 +619,27 @@ protected:
 	LtIpSegReq*	newRequest( LtIpRequest& reqPkt, ULONG ipAddress, word port );
 	// find a request in our list that matches everything
 	LtIpSegReq* findRequest( int reqType, ULONG ipAddress, word port );
+	// find a request by peer and request id
+	LtIpSegReq* findRequestId( ULONG ipAddress, word port, word reqId );
+	// remove a request from the table and the timer heap and delete it
+	void		deleteRequest( LtIpSegReq* pReq );
+
+	// timer heap maintenance. All require the lock.
+	void		addTimer( LtIpSegReq* pReq );
+	void		removeTimer( LtIpSegReq* pReq );
+	void		reschedule( LtIpSegReq* pReq );
+	void		siftTimerUp( int nIdx );
+	void		siftTimerDown( int nIdx );
+	void		setTimerAt( int nIdx, LtIpSegReq* pReq )
+	{	m_ppTimers[nIdx] = pReq;
+		pReq->setTimerIdx( nIdx );
+	}
+	static boolean	isDueBefore( LtIpSegReq* pA, LtIpSegReq* pB )
+	{	return (LONG)( pA->getTickDue() - pB->getTickDue() ) < 0;
+	}
+
+	// get a pooled packet for a reassembled payload
+	LtPktInfo*	allocReassemblyPacket( int nSize );
 
 	boolean	sendSegment( LtIpSegReq* pReq, int nSeg, boolean bRemaining =false );
 	boolean	sendPacket( byte* pData, int nLen, ULONG ipAddr, word port );
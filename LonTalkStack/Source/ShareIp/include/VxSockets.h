@@ -212,9 +212,28 @@ VXLAYER_API int			vxsSendTo( VXSOCKET s, LPSTR buf, int bufLen, int flags, VXSOC
 // Send on a stream
 int			vxsSend( VXSOCKET s, LPSTR buf, int bufLen, int flags );
 
+// Send without blocking.  These return the number of bytes sent, 0 if the
+// socket had no buffer space for the frame, or ERROR.  After a 0 the caller
+// can use vxsSelectAnyWrite to learn when to try again.  Where non-blocking
+// sends are not supported these block as vxsSendTo and vxsSend do.
+VXLAYER_API int			vxsSendToNoWait( VXSOCKET s, LPSTR buf, int bufLen, VXSOCKADDR sa );
+VXLAYER_API int			vxsSendNoWait( VXSOCKET s, LPSTR buf, int bufLen );
+
 // Receive a datagram
 VXLAYER_API int			vxsRecvFrom( VXSOCKET s, char* buf, int bufLen, int flags, VXSOCKADDR psa );
 
+// Receive a datagram and the destination address from its IP header, in
+// network order.  The socket must have IP_PKTINFO enabled; *pDestAddr is 0
+// where the destination is not available.
+VXLAYER_API int			vxsRecvFromDest( VXSOCKET s, char* buf, int bufLen, int flags, VXSOCKADDR psa, ULONG* pDestAddr );
+
+// Receive up to nMax datagrams with a single call.  Datagram i is placed at
+// buf + i*bufLen, its length in pLens[i] and its source in psa[i].  If
+// pDestAddrs is not NULL, pDestAddrs[i] gets the destination address as for
+// vxsRecvFromDest.  Returns the number of datagrams received, 0 if none were
+// waiting, or ERROR.
+VXLAYER_API int			vxsRecvFromMulti( VXSOCKET s, char* buf, int bufLen, int nMax, int* pLens, VXSOCKADDR* psa, ULONG* pDestAddrs );
+
 // Receive from TCP
 int			vxsRecv( VXSOCKET s, char* buf, int bufLen, int flags );
 
@@ -227,6 +246,10 @@ VXLAYER_API int         vxsSelectRead( VXSOCKET s, struct timeval *timeout);
 
 VXLAYER_API int vxsSelectAnyRead( VXSOCKET *sockets, int numSockets, struct timeval *timeout);
 
+// Wait for any of several sockets to have room to send.  Returns the number
+// of sockets that are ready (or have failed), 0 on timeout, or ERROR.
+VXLAYER_API int vxsSelectAnyWrite( VXSOCKET *sockets, int numSockets, struct timeval *timeout);
+
 VXLAYER_API void vxsGetSelfIpAddr( char* szStr );
 
 // Join the multicast group
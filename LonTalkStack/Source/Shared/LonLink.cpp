@@ -243,6 +243,7 @@
 #include <LtMip.h>
 #include <LtNetworkManagerLit.h>
 #include <time.h>
+#include <tickLib.h>
 #include "LtCUtil.h"
 
 // Define this to activate test code in this file and in LonLink.h
@@ -417,11 +418,134 @@ LonLink::LonLink()
 	m_localRespLen = 0;
 
     m_buffersInSync = 0;
+
+	m_bPaTap = false;
+	m_paFn = NULL;
+	m_pPaRing = NULL;
+	m_tidPaDrain = ERROR;
+	m_bExitPaDrain = false;
+	m_semPaDrain = semMCreate( SEM_Q_PRIORITY | SEM_INVERSION_SAFE );
+	m_semPaWake = semBCreate( SEM_Q_FIFO, SEM_EMPTY );
 }
 
 LonLink::~LonLink()
 {
+	stopPaDrainTask();
+	delete m_pPaRing;
+	semDelete( m_semPaWake );
+	semDelete( m_semPaDrain );
+}
 
+//
+// lonLinkPaDrain
+//
+// C entry point for paDrainTask
+//
+static int lonLinkPaDrain( int a1, ... )
+{
+	LonLink*	pLink = (LonLink*) a1;
+	pLink->paDrainTask();
+	return 0;
+}
+
+//
+// paDrainTask
+//
+// Pass captured packets to the protocol analyzer.  When the ring is empty
+// we mark it idle and sleep; the first packet captured after that wakes us,
+// so the link signals once per burst rather than once per packet.  While no
+// callback is registered we sleep until one is.
+//
+// The callback is read and called with m_semPaDrain held, so once
+// unregisterProtocolAnalyzerCallback() returns the old one is never called
+// again.
+//
+void	LonLink::paDrainTask()
+{
+	while ( !m_bExitPaDrain )
+	{
+		int		nDrained = 0;
+
+		semTake( m_semPaDrain, WAIT_FOREVER );
+		LtPaSink	fn = m_paFn;
+		// Stop as soon as an unregister is waiting for us.
+		while ( fn != NULL && m_bPaTap && nDrained < LT_PA_RING_SLOTS/2 &&
+				m_pPaRing->drain( fn, 1 ) != 0 )
+		{
+			nDrained++;
+		}
+		semGive( m_semPaDrain );
+
+		if ( fn == NULL || (nDrained == 0 && m_pPaRing->setIdle()) )
+		{
+			semTake( m_semPaWake, WAIT_FOREVER );
+		}
+	}
+	m_tidPaDrain = ERROR;
+}
+
+void	LonLink::stopPaDrainTask()
+{
+	if ( m_tidPaDrain != ERROR )
+	{
+		m_bExitPaDrain = true;
+		semGive( m_semPaWake );
+		while ( m_tidPaDrain != ERROR )
+		{
+			taskDelay( msToTicks(50) );
+		}
+	}
+}
+
+//
+// registerProtocolAnalyzerCallback
+//
+// The ring and the drain task are kept once created, so a packet being
+// captured as the analyzer is unregistered never sees the ring go away.
+//
+void	LonLink::registerProtocolAnalyzerCallback(void (*fn)(char*, int))
+{
+	lock();
+	if ( m_pPaRing == NULL )
+	{
+		m_pPaRing = new LtPaCaptureRing();
+	}
+	if ( m_tidPaDrain == ERROR )
+	{
+		m_bExitPaDrain = false;
+		m_tidPaDrain = taskSpawn( "lonLinkPa", getRcvTaskPriority(), 0,
+								getRcvTaskStackSize(), lonLinkPaDrain, (int)this,
+								0,0,0,0,0,0,0,0,0);
+	}
+	semTake( m_semPaDrain, WAIT_FOREVER );
+	m_paFn = fn;
+	m_bPaTap = fn != NULL && m_tidPaDrain != ERROR;
+	semGive( m_semPaDrain );
+	unlock();
+	semGive( m_semPaWake );
+}
+
+//
+// unregisterProtocolAnalyzerCallback
+//
+// Frames still in the ring were captured for this callback, so they are
+// thrown away rather than passed to the next one registered.
+//
+void	LonLink::unregisterProtocolAnalyzerCallback()
+{
+	m_bPaTap = false;
+	semTake( m_semPaDrain, WAIT_FOREVER );
+	m_paFn = NULL;
+	if ( m_pPaRing != NULL )
+	{
+		m_pPaRing->flush();
+	}
+	semGive( m_semPaDrain );
+}
+
+ULONGLONG	LonLink::getProtocolAnalyzerCount(LtPaStatIndex index)
+{
+	return m_pPaRing != NULL ? m_pPaRing->getCount(index) : 0;
 }
 //
 // open
@@ -560,8 +684,7 @@ LtSts		LonLink::tryTransmit( void* refId, byte flags, byte* pData, int nDataLeng
 			sts = driverWrite(pSicb, nLen+dataOffset);
 			if ((sts != LTSTS_OK) && (sts != LTSTS_QUEUEFULL))
 			{
-				m_linkStats.m_nTransmissionErrors++;
-				m_linkStats.m_nTransmissionErrorsShadow++;
+				m_linkStats.bump(LT_LINK_STAT_TRANSMISSION_ERRORS);
 			}
 		}
 		else
@@ -574,16 +697,13 @@ LtSts		LonLink::tryTransmit( void* refId, byte flags, byte* pData, int nDataLeng
 			// Don't increment statistic if not actually sent
 			if (!dontTransmit)
 			{
-				m_linkStats.m_nTransmittedPackets++;
+				m_linkStats.bump(LT_LINK_STAT_TRANSMITTED_PACKETS);
 			}
-			// Note: Contents of buf will be modified after this call
-			// This shouldn't be a problem as buf is a local copy of pData
 			sendToProtocolAnalyser((byte*)pSicb, false); // no CRC
 		}
 	}
 
-	if ((sts != LTSTS_QUEUEFULL) && !dontTransmit)
-
+	if ((sts != LTSTS_QUEUEFULL) && !dontTransmit && dumpActive())
 	{
 		dumpPacket("LonLink - tryTransmit", pData, nLen );
 	}
@@ -643,10 +763,24 @@ LtSts LonLink::sendPacket(void* referenceId,
 // If it's a receive data, then get the data out and send
 // it along to the client, if the user has a packet buffer
 // queued, else toss it out and wait some more.
+// Packets are read from the driver in batches of up to
+// RECEIVE_BATCH_SIZE, and the packets of a batch are handed to the
+// network layer together once the whole batch has been parsed.
+// A batch is no bigger than the number of normal receive buffers the
+// client has queued.  A priority packet is handed over as soon as it has
+// a buffer, together with the packets before it, so that the batch never
+// holds on to priority buffers.  If the client has no priority buffer
+// queued it takes a normal one, and only if there is neither is it missed.
 //
 void LonLink::receiveTask()
 {
-	byte		data[MAX_LPDU_SIZE+10];
+	byte*		pBatch = new byte[RECEIVE_BATCH_SIZE*RECEIVE_SLOT_SIZE];
+	LonLinkRxDelivery deliveries[RECEIVE_BATCH_SIZE];
+	int			nDeliveries = 0;
+	int			nBatch = 0;
+	int			nNext = 0;
+	int			nMaxBatch;
+	byte*		data;
 	byte*		pData;
 	int			nSize;
     int         packetLength;
@@ -661,6 +795,7 @@ void LonLink::receiveTask()
 	boolean		validPacket;
 	int			ssiReg1 = 0;
 	int			ssiReg2 = 0;
+	boolean		bPriorBuf;
 
 	semGive(_semWaitForRcvTask);
 
@@ -675,6 +810,7 @@ void LonLink::receiveTask()
 		{	break;
 		}
 		lock();
+		nBatch = nNext = 0;
 		while (true)
 		{
 			nSlot = 0;
@@ -689,25 +825,38 @@ void LonLink::receiveTask()
 				bProcessPkt = false;
 				validPacket = false;
 				bPrior = false;
-				sts = driverRead(data, sizeof(data));
-
-				if (sts != LTSTS_INVALIDSTATE)
+				if (nNext == nBatch)
 				{
-					// Some packet has been received uplink.
-					// After reading it, send one queued up packet downlink.
-					// This is only implemented on the iLON's
-					startImmediateRetransmit();
-				}
-				if (sts != LTSTS_OK)
-				{
-					// Nothing available - wait for next signal
-					if (receivedCount == 0)
+					// The last batch has been parsed.  Hand its packets to the
+					// network layer before reading the next one.
+					deliverReceived(deliveries, nDeliveries);
+					nDeliveries = 0;
+					nNext = 0;
+					// Most packets are not priority, so size the batch from
+					// the normal buffers.  Always read at least one so the
+					// driver keeps being drained.
+					nMaxBatch = max(1, min(m_qReceive.getCount(), (int)RECEIVE_BATCH_SIZE));
+					sts = driverReadBatch(pBatch, RECEIVE_SLOT_SIZE, nMaxBatch, nBatch);
+
+					if (sts != LTSTS_INVALIDSTATE)
+					{
+						// Some packet has been received uplink.
+						// After reading it, send one queued up packet downlink.
+						// This is only implemented on the iLON's
+						startImmediateRetransmit();
+					}
+					if (nBatch == 0)
 					{
-						// After receiving a packet and then receiving a packet, we clear the one and only one bit.
-						clearOneAndOnlyOne();
+						// Nothing available - wait for next signal
+						if (receivedCount == 0)
+						{
+							// After receiving a packet and then receiving a packet, we clear the one and only one bit.
+							clearOneAndOnlyOne();
+						}
+						break;
 					}
-					break;
 				}
+				data = pBatch + (nNext++)*RECEIVE_SLOT_SIZE;
 
                 packetLength = data[1];
                 if (packetLength == L2_PKT_LEN_EXTENDED)
@@ -784,8 +933,7 @@ void LonLink::receiveTask()
 					4 : preamble too short
 					5 : packet too short
 					*/
-					m_linkStats.m_nTransmissionErrors++;	
-					m_linkStats.m_nTransmissionErrorsShadow++;
+					m_linkStats.bump(LT_LINK_STAT_TRANSMISSION_ERRORS);
 					bProcessPkt = true;
 				}
 				else
@@ -807,7 +955,7 @@ void LonLink::receiveTask()
 				// check the priority bit from the packet.
 				// MSB of first byte of the packet.
 				bPrior = (0 != (data[dataOffset] & 0x80));
-				m_linkStats.m_nReceivedPackets++;
+				m_linkStats.bump(LT_LINK_STAT_RECEIVED_PACKETS);
 			}
 
 			receivedCount++;
@@ -816,13 +964,16 @@ void LonLink::receiveTask()
 			sendToProtocolAnalyser(data, true);	// has CRC
 
 			if ( bPrior )
-			{	m_linkStats.m_nReceivedPriorityPackets++;
+			{	m_linkStats.bump(LT_LINK_STAT_RECEIVED_PRIORITY_PACKETS);
 			}
 
-			if ( bPrior?!m_qReceiveP.isEmpty() : !m_qReceive.isEmpty() )
+			// A priority packet takes a normal buffer rather than be missed
+			// while the client has all the priority ones.
+			bPriorBuf = bPrior && !m_qReceiveP.isEmpty();
+			if ( bPriorBuf || !m_qReceive.isEmpty() )
 			{
 				sts = LTSTS_OK;
-				if ( bPrior )
+				if ( bPriorBuf )
 				{	m_qReceiveP.removeHead( &pItem );
 				}
 				else
@@ -838,9 +989,8 @@ void LonLink::receiveTask()
 					// so count a missed packet and then put the receive
 					// buffer back on the head of the queue to be used again.
 					sts = LTSTS_OVERRUN;
-					m_linkStats.m_nMissedPackets++;
-					m_linkStats.m_nMissedPacketsShadow++;
-					if ( bPrior )
+					m_linkStats.bump(LT_LINK_STAT_MISSED_PACKETS);
+					if ( bPriorBuf )
 					{	m_qReceiveP.insertHead( pItem );
 					}
 					else
@@ -850,12 +1000,28 @@ void LonLink::receiveTask()
 				else if ( pPkt && m_pNet )
 				{
 					memcpy( pData, &data[dataOffset], nSize );
-					dumpPacket("LonLink - receiveTask", pData, nSize );
-					unlock();
-					// no difference now between PA and normal mode
-					m_pNet->packetReceived( pPkt->m_refId, nSize, pPkt->m_bPriority, nSlot, 
-											validPacket, data[0], sts, ssiReg1, ssiReg2 );
-					lock();
+					if ( dumpActive() )
+					{
+						dumpPacket("LonLink - receiveTask", pData, nSize );
+					}
+					LonLinkRxDelivery& delivery = deliveries[nDeliveries++];
+					delivery.pPkt = pPkt;
+					delivery.bPriority = bPrior;
+					delivery.nSize = nSize;
+					delivery.nSlot = nSlot;
+					delivery.validPacket = validPacket;
+					delivery.ltType = data[0];
+					delivery.sts = sts;
+					delivery.ssiReg1 = ssiReg1;
+					delivery.ssiReg2 = ssiReg2;
+					if ( bPrior )
+					{	// Don't keep the client waiting for it, or for the buffer
+						deliverReceived(deliveries, nDeliveries);
+						nDeliveries = 0;
+					}
+				}
+				else if ( pPkt )
+				{	// No network layer to hand it to
 					freeLLPkt(pPkt);
 				}
 				pPkt = NULL;
@@ -863,8 +1029,7 @@ void LonLink::receiveTask()
 			}
 			else
 			{	// we didn't have a buffer for this packet
-				m_linkStats.m_nMissedPackets++;
-				m_linkStats.m_nMissedPacketsShadow++;
+				m_linkStats.bump(LT_LINK_STAT_MISSED_PACKETS);
 			}
 			/* 
 			 * NOTE:  We should probably break from this while loop
@@ -876,11 +1041,69 @@ void LonLink::receiveTask()
 			 * //break;
 			 */
 		}
+		// Don't hold on to client buffers if we stopped mid-batch
+		deliverReceived(deliveries, nDeliveries);
+		nDeliveries = 0;
 	}
+	delete[] pBatch;
 	// Report that we have exited
 	m_tidReceive = ERROR;
 }
 
+//
+// deliverReceived
+//
+// Hand a batch of received packets to the network layer.  Called with the
+// lock held; it is released while the network layer runs.
+//
+void LonLink::deliverReceived(LonLinkRxDelivery* pDeliveries, int nDeliveries)
+{
+	LtNetwork*	pNet = m_pNet;
+	int			i;
+
+	if (nDeliveries == 0)
+	{	return;
+	}
+	// Without a network layer the packets are dropped, but the buffers
+	// still go back to the free list.
+	if (pNet != NULL)
+	{
+		unlock();
+		for (i = 0; i < nDeliveries; i++)
+		{
+			LonLinkRxDelivery& d = pDeliveries[i];
+			// no difference now between PA and normal mode
+			pNet->packetReceived( d.pPkt->m_refId, d.nSize, d.bPriority, d.nSlot,
+								  d.validPacket, d.ltType, d.sts, d.ssiReg1, d.ssiReg2 );
+		}
+		lock();
+	}
+	for (i = 0; i < nDeliveries; i++)
+	{	freeLLPkt(pDeliveries[i].pPkt);
+	}
+}
+
+//
+// driverReadBatch
+//
+// Default batch read for drivers that can only read one packet at a time.
+//
+LtSts LonLink::driverReadBatch(byte *pData, short len, int nMaxPkts, int &nPkts)
+{
+	LtSts	sts = LTSTS_ERROR;
+
+	nPkts = 0;
+	while (nPkts < nMaxPkts)
+	{
+		sts = driverRead(pData + nPkts*len, len);
+		if (sts != LTSTS_OK)
+		{	break;
+		}
+		nPkts++;
+	}
+	return nPkts ? LTSTS_OK : sts;
+}
+
 //
 // reset
 //
@@ -1268,7 +1491,8 @@ void LonLink::setPerfectXcvrReg(byte* pData, int len, bool bAlternatePath)
 //
 void LonLink::clearOneAndOnlyOne()
 {
-	if (m_bClearOneAndOnlyOne && m_lastRxCount != m_linkStats.m_nReceivedPackets)
+	ULONGLONG nRxCount = m_linkStats.get(LT_LINK_STAT_RECEIVED_PACKETS);
+	if (m_bClearOneAndOnlyOne && m_lastRxCount != nRxCount)
 	{
 		byte buf[50];
 		memset(buf, 0, sizeof(buf));
@@ -1305,7 +1529,7 @@ void LonLink::clearOneAndOnlyOne()
 		pSicb->len = pSicb->dlen + sizeof(LtSicb) - sizeof(pSicb->data) - 2;
 		driverWrite(buf, pSicb->len+2);
 
-		m_lastRxCount = m_linkStats.m_nReceivedPackets;
+		m_lastRxCount = nRxCount;
 	}
 }
 
@@ -399,12 +399,6 @@ void	LonLinkWin::startDelayedRetransmit()
 	}
 }
 
-void LonLinkWin::sendToProtocolAnalyser(byte *pData, bool crcIncluded)
-{
-	// This needs an implementation because it is pure virtual in LonLink
-	// Add hook here if packet needs to be send to a protocol analyser data sink
-}
-
 void LonLinkWin::registerLdvHandle(int ldvHandle)
 {
     m_hPreOpenedLDV = ldvHandle;
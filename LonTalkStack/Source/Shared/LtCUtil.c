@@ -119,6 +119,43 @@ unsigned short crctable[UCHAR_MAX+1] = {
     /* 250..255 */ 0x4E55,0x5E74,0x2E93,0x3EB2,0x0ED1,0x1EF0
 };
 
+/*
+ * Slicing-by-8 tables.  crcSlice[k][b] is the CRC contribution of byte b
+ * followed by k zero bytes, so crcSlice[0] is crctable.  They are derived
+ * from crctable on first use.  Building them twice is harmless since both
+ * builds write the same values.  The barrier after the build keeps the flag
+ * from being seen before the tables are, and the one after seeing the flag
+ * keeps the table reads from being done before the flag read.
+ */
+#ifdef WIN32
+#define CRC_BARRIER()	MemoryBarrier()
+#else
+#define CRC_BARRIER()	__sync_synchronize()
+#endif
+
+static unsigned short crcSlice[8][UCHAR_MAX+1];
+static volatile int crcSliceReady = 0;
+
+static void crcSliceInit(void)
+{
+	int i, k;
+
+	for (i = 0; i <= UCHAR_MAX; i++)
+	{
+		crcSlice[0][i] = crctable[i];
+	}
+	for (k = 1; k < 8; k++)
+	{
+		for (i = 0; i <= UCHAR_MAX; i++)
+		{
+			unsigned int r = crcSlice[k-1][i];
+			crcSlice[k][i] = (unsigned short)((r << CHAR_BIT) ^ crctable[r >> (16 - CHAR_BIT)]);
+		}
+	}
+	CRC_BARRIER();
+	crcSliceReady = 1;
+}
+
 
 /*******************************************************************************
 Function:  cUtilInit()
@@ -193,18 +230,64 @@ Purpose:   To compute the 16 bit CRC for a given buffer.
 Comments:  None.
 *******************************************************************************/
 void LtCRC16(byte bufInOut[], int sizeIn)
+{
+	unsigned int crc = LtCRC16Compute(bufInOut, sizeIn);
+
+	bufInOut[sizeIn]     = (crc >> 8);
+	bufInOut[sizeIn + 1] = (crc & 0x00FF);
+}
+
+/*******************************************************************************
+Function:  LtCRC16Compute
+Returns:   16 bit CRC computed.
+Purpose:   To compute the same CRC as LtCRC16 without storing it.
+
+Comments:  Eight bytes are folded in per step using the slicing tables, and
+           any remainder a byte at a time as before.
+*******************************************************************************/
+unsigned short LtCRC16Compute(const byte bufIn[], int sizeIn)
 {
 	unsigned int crc = USHRT_MAX;
-	int i;
-	byte* p = bufInOut;
+	const byte* p = bufIn;
 
-	for (i = 0; i < sizeIn; i++)
+	if (!crcSliceReady)
 	{
-	   crc = (crc << CHAR_BIT) ^ crctable[(byte)(crc >> (16 - CHAR_BIT)) ^ *p++];
+		crcSliceInit();
 	}
-	crc = ~crc & USHRT_MAX;
+	else
+	{
+		CRC_BARRIER();
+	}
+	while (sizeIn >= 8)
+	{
+		crc = crcSlice[7][p[0] ^ (crc >> CHAR_BIT)] ^
+			  crcSlice[6][p[1] ^ (crc & UCHAR_MAX)] ^
+			  crcSlice[5][p[2]] ^
+			  crcSlice[4][p[3]] ^
+			  crcSlice[3][p[4]] ^
+			  crcSlice[2][p[5]] ^
+			  crcSlice[1][p[6]] ^
+			  crcSlice[0][p[7]];
+		p += 8;
+		sizeIn -= 8;
+	}
+	while (sizeIn-- > 0)
+	{
+	   crc = ((crc << CHAR_BIT) & USHRT_MAX) ^ crctable[(byte)(crc >> (16 - CHAR_BIT)) ^ *p++];
+	}
+	return (unsigned short)(~crc & USHRT_MAX);
+}
 
-	bufInOut[sizeIn]     = (crc >> 8);
-	bufInOut[sizeIn + 1] = (crc & 0x00FF);
+/*******************************************************************************
+Function:  LtCRC16Verify
+Returns:   TRUE if the two bytes following the data hold its CRC.
+Purpose:   To check a received CRC without touching the buffer.
+*******************************************************************************/
+boolean LtCRC16Verify(const byte bufIn[], int sizeIn)
+{
+	unsigned int crc = LtCRC16Compute(bufIn, sizeIn);
+
+	return bufIn[sizeIn] == (byte)(crc >> 8) &&
+		   bufIn[sizeIn + 1] == (byte)(crc & 0x00FF);
 }
 
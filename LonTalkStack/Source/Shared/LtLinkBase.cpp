@@ -368,7 +368,7 @@ LtSts LtLinkBase::sendPacket(void* referenceId,
 {
 	if ( m_pNet )
 	{
-		m_linkStats.m_nTransmittedPackets++;
+		m_linkStats.bump(LT_LINK_STAT_TRANSMITTED_PACKETS);
 		m_pNet->packetComplete( referenceId, LTSTS_OK );
 	}
 	return LTSTS_OK;
@@ -464,19 +464,25 @@ LtSts LtLinkBase::getTransceiverRegister(int n)
 }
 
 // Reports statistics from the driver/LON-C.
-// These statistics are 16 bits and cap at 0xFFFF.
+// The int fields cap at 0x7FFFFFFF; getStatisticsSnapshot has the full counts.
 void LtLinkBase::getStatistics(LtLinkStats& stats)
 {
+	m_linkStats.update();
 	stats = m_linkStats;
 }
 void LtLinkBase::getStatistics(LtLinkStats *&pStats)
 {
+	m_linkStats.update();
 	pStats = &m_linkStats;
 }
+void LtLinkBase::getStatisticsSnapshot(LtLinkStatsSnapshot& snap)
+{
+	m_linkStats.snapshot(snap);
+}
 // 0 the statistics.
 void LtLinkBase::clearStatistics()
 {
-	m_linkStats.clearStats();
+	m_linkStats.clearCounters();
 }
 
 // Determines the state of the service pin.  "state" values are
@@ -826,8 +832,53 @@ LtSts LtLinkBase::queueReceive( void* referenceId,
 
 }
 
+//
+// queueReceiveBatch
+//
+// Queue a run of receive packet buffers under one acquisition of the link
+// lock.  Same checks as queueReceive, applied per buffer.
+//
+int LtLinkBase::queueReceiveBatch( LtReceivePost* pPosts, int nPosts,
+								   boolean bTryOther )
+{
+	int			n = 0;
+	LLPktQue*	pPkt;
+
+	lock();
+	if ( m_bActive && isOpen() )
+	{
+		for ( ; n < nPosts; n++ )
+		{
+			LtReceivePost&	post = pPosts[n];
+
+			if ( m_nReceiveQueueDepth <= (post.bPriority ? m_qReceiveP.getCount() : m_qReceive.getCount()) )
+			{
+				if ( !bTryOther ||
+					 m_nReceiveQueueDepth <= (post.bPriority ? m_qReceive.getCount() : m_qReceiveP.getCount()) )
+				{	break;
+				}
+				post.bPriority = !post.bPriority;
+			}
+			pPkt = getLLPkt();
+			pPkt->m_refId			= post.referenceId;
+			pPkt->m_pktFlags		= post.flags;
+			pPkt->m_bPriority		= post.bPriority;
+			pPkt->m_pData			= post.pData;
+			pPkt->m_nDataLength		= post.nMaxLength;
+			if ( post.bPriority )
+			{	m_qReceiveP.insertTail( pPkt );
+			}
+			else
+			{	m_qReceive.insertTail( pPkt );
+			}
+		}
+	}
+	unlock();
+	return n;
+}
+
 // control of dumping packets
-static boolean		gbDumpEnable = false;
+boolean				LtLinkBase::s_bDumpEnable = false;
 static boolean		gbDumpHeadersOnly = false;
 
 boolean	LtLinkBase::dumpEnable( boolean bEnable )
@@ -839,8 +890,8 @@ boolean	LtLinkBase::dumpEnable( boolean bEnable )
 
 boolean	LtLinkBase::dumpEnableGlobal( boolean bEnable )
 {
-	boolean bOld = gbDumpEnable;
-	gbDumpEnable = bEnable;
+	boolean bOld = s_bDumpEnable;
+	s_bDumpEnable = bEnable;
 	return bOld;
 }
 
@@ -869,7 +920,7 @@ void	LtLinkBase::dumpLtPacket( LPCSTR tag, byte* pData, int nLen )
 {
 #if FEATURE_INCLUDED(IP852)
 	LtIpPktHeader	Pkt;
-	if ( m_bDumpEnable || gbDumpEnable )
+	if ( dumpActive() )
 	{
 		vxlReportEvent("LtLinkBase::dumpPacket - %s\n", tag);
 		Pkt.dumpLtPacket( tag, pData, nLen );
@@ -887,7 +938,7 @@ void	LtLinkBase::dumpLtPacket( LPCSTR tag, byte* pData, int nLen )
 void	LtLinkBase::dumpPacket( LPCSTR tag, byte* pData, int nLen )
 {
 #if FEATURE_INCLUDED(IP852)
-	if ( m_bDumpEnable || gbDumpEnable )
+	if ( dumpActive() )
 	{
 		LtIpPktHeader	Pkt;
 		vxlReportEvent("LtLinkBase::dumpPacket - %s\n", tag);
@@ -0,0 +1,181 @@
+//
+// LtPaCaptureRing.cpp
+//
+// Copyright © 2022 Dialog Semiconductor
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in 
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "LtStackInternal.h"
+#include "LtPaCaptureRing.h"
+
+#ifdef WIN32
+#define PA_CAS(p, o, n)			(InterlockedCompareExchange((volatile LONG*)(p), (LONG)(n), (LONG)(o)) == (LONG)(o))
+#define PA_BARRIER()			MemoryBarrier()
+#else
+#define PA_CAS(p, o, n)			__sync_bool_compare_and_swap((p), (o), (n))
+#define PA_BARRIER()			__sync_synchronize()
+#endif
+
+#define PA_SLOT_MASK			(LT_PA_RING_SLOTS - 1)
+
+LtPaCaptureRing::LtPaCaptureRing(unsigned int nStart) : m_counters(LT_PA_NUM_STATS)
+{
+	for (unsigned int i = 0; i < LT_PA_RING_SLOTS; i++)
+	{
+		unsigned int pos = nStart + i;
+		m_slots[pos & PA_SLOT_MASK].m_nSeq = pos;
+		m_slots[pos & PA_SLOT_MASK].m_nLen = 0;
+	}
+	m_nHead = nStart;
+	m_nTail = nStart;
+	m_nIdle = 0;
+}
+
+//
+// put
+//
+// Producers claim a position by advancing m_nHead, fill the slot and then
+// publish it by bumping its sequence.  A slot whose sequence lags the
+// position is still waiting to be drained, meaning the ring is full.
+//
+boolean LtPaCaptureRing::put(const byte* pSicb, boolean bCrcIncluded)
+{
+	int len = pSicb[1] + 2;
+	unsigned int pos = m_nHead;
+	Slot* pSlot;
+
+	for (;;)
+	{
+		pSlot = &m_slots[pos & PA_SLOT_MASK];
+		int diff = (int)(pSlot->m_nSeq - pos);
+		if (diff == 0)
+		{
+			if (PA_CAS(&m_nHead, pos, pos + 1))
+			{
+				break;
+			}
+			pos = m_nHead;
+		}
+		else if (diff < 0)
+		{
+			m_counters.bump(LT_PA_STAT_DROPPED);
+			return false;
+		}
+		else
+		{
+			pos = m_nHead;
+		}
+	}
+
+	memcpy(pSlot->m_data, pSicb, len);
+	if (!bCrcIncluded)
+	{
+		pSlot->m_data[len] = 0;
+		pSlot->m_data[len + 1] = 0;
+		pSlot->m_data[1] = (byte)(pSicb[1] + 2);
+		len += 2;
+	}
+	pSlot->m_nLen = len;
+	PA_BARRIER();
+	pSlot->m_nSeq = pos + 1;
+	m_counters.bump(LT_PA_STAT_CAPTURED);
+	return true;
+}
+
+int LtPaCaptureRing::drain(LtPaSink fn, int nMax)
+{
+	int n = 0;
+
+	while (n < nMax)
+	{
+		Slot* pSlot = &m_slots[m_nTail & PA_SLOT_MASK];
+		if ((int)(pSlot->m_nSeq - (m_nTail + 1)) < 0)
+		{
+			// Empty, or the next frame is still being copied in.
+			break;
+		}
+		PA_BARRIER();
+		fn((char*)pSlot->m_data, pSlot->m_nLen);
+		PA_BARRIER();
+		pSlot->m_nSeq = m_nTail + LT_PA_RING_SLOTS;
+		m_nTail++;
+		n++;
+	}
+	if (n != 0)
+	{
+		m_counters.add(LT_PA_STAT_DELIVERED, n);
+	}
+	return n;
+}
+
+boolean LtPaCaptureRing::isEmpty()
+{
+	return (int)(m_slots[m_nTail & PA_SLOT_MASK].m_nSeq - (m_nTail + 1)) < 0;
+}
+
+//
+// setIdle / takeIdle
+//
+// The drainer marks the ring idle and then looks again; a producer
+// publishes its frame and then looks at the mark.  With a barrier between
+// each one's write and read, at least one of them sees the other, so a
+// frame is never left in the ring with the drainer asleep.
+//
+boolean LtPaCaptureRing::setIdle()
+{
+	m_nIdle = 1;
+	PA_BARRIER();
+	if (isEmpty())
+	{
+		return true;
+	}
+	// A frame arrived.  If its producer also saw the mark it will wake the
+	// drainer once more than needed, which is harmless.
+	PA_CAS(&m_nIdle, 1, 0);
+	return false;
+}
+
+boolean LtPaCaptureRing::takeIdle()
+{
+	PA_BARRIER();
+	return m_nIdle != 0 && PA_CAS(&m_nIdle, 1, 0);
+}
+
+int LtPaCaptureRing::flush()
+{
+	int n = 0;
+
+	for (;;)
+	{
+		Slot* pSlot = &m_slots[m_nTail & PA_SLOT_MASK];
+		if ((int)(pSlot->m_nSeq - (m_nTail + 1)) < 0)
+		{
+			break;
+		}
+		PA_BARRIER();
+		pSlot->m_nSeq = m_nTail + LT_PA_RING_SLOTS;
+		m_nTail++;
+		n++;
+	}
+	if (n != 0)
+	{
+		m_counters.add(LT_PA_STAT_DROPPED, n);
+	}
+	return n;
+}
@@ -55,7 +55,10 @@ boolean               LtPersistence::m_bShutdown = FALSE;
 int                   LtPersistence::m_tid = ERROR;
 SEM_ID                LtPersistence::m_semPending = NULL;
 SEM_ID                LtPersistence::m_taskMutex = NULL;
-LtPersistence*        LtPersistence::m_pPersitenceList[LonNvdSegNumSegmentTypes] = {NULL};
+LtPersistence*        LtPersistence::m_pPersistenceList = NULL;
+LtPersistence*        LtPersistence::m_pStoring = NULL;
+boolean               LtPersistence::m_bListChanged = FALSE;
+SEM_ID                LtPersistence::m_defaultNvdMutex = NULL;
 boolean               LtPersistence::m_bResetFlag = FALSE;
 #endif
 
@@ -150,21 +153,37 @@ int	VXLCDECL LtPersistence::storeTask( int obj, ... )
 {
 	while (!m_bShutdown)
 	{
-        int i;
         ULONG waitTime = (ULONG)WAIT_FOREVER;
 
-        for (i = 0; i < LonNvdSegNumSegmentTypes; i++)
+        semTake(m_taskMutex, WAIT_FOREVER);
+        m_bListChanged = false;
+        LtPersistence* pPersistence = m_pPersistenceList;
+        while (pPersistence != NULL)
         {
-            if (m_pPersitenceList[i] != NULL)
+            ULONG timeLeft;
+
+            // Store without the mutex; the destructor waits for m_pStoring.
+            m_pStoring = pPersistence;
+            semGive(m_taskMutex);
+            timeLeft = pPersistence->store();
+            semTake(m_taskMutex, WAIT_FOREVER);
+            m_pStoring = NULL;
+            if (timeLeft < waitTime)
+            {
+                waitTime = timeLeft;
+            }
+            if (m_bListChanged)
+            {
+                // The next one may be gone.  Storing is harmless to repeat.
+                m_bListChanged = false;
+                pPersistence = m_pPersistenceList;
+            }
+            else
             {
-                ULONG timeLeft;
-                timeLeft = m_pPersitenceList[i]->store();
-                if (timeLeft < waitTime)
-                {
-                    waitTime = timeLeft;
-                }
+                pPersistence = pPersistence->m_pNextPersistence;
             }
         }
+        semGive(m_taskMutex);
         if (m_pPersistenceMonitor != NULL && waitTime == (ULONG)WAIT_FOREVER)
         {   
             // Nothing to do.  Mark it as finished...
@@ -184,20 +203,41 @@ void LtPersistence::setPending(boolean bPending)
 {
 	if (m_bCommitFailureNotifyMode)
 	{
+        nvdBegin();
         if (bPending)
         {
-            LonNvdEnterTransaction(m_type);
+            NvdEnterTransaction(m_hNvdStack, nvdFsPath(), m_type);
         }
         else
         {
-            LonNvdExitTransaction(m_type);
+            NvdExitTransaction(m_hNvdStack, nvdFsPath(), m_type);
         }
+        nvdEnd();
 	}
 }
 
 boolean LtPersistence::getPending()
 {
-    return LonNvdIsInTransaction(m_type);
+    nvdBegin();
+    boolean bPending = NvdIsInTransaction(m_hNvdStack, nvdFsPath(), m_type);
+    nvdEnd();
+    return bPending;
+}
+
+void LtPersistence::nvdBegin()
+{
+    semTake(m_nvdMutex, WAIT_FOREVER);
+}
+
+void LtPersistence::nvdEnd()
+{
+    semGive(m_nvdMutex);
+}
+
+void LtPersistence::setNvdStack(LonStackHandle hStack, SEM_ID nvdMutex)
+{
+    m_hNvdStack = hStack;
+    m_nvdMutex = nvdMutex != NULL ? nvdMutex : m_defaultNvdMutex;
 }
 
 #else
@@ -237,6 +277,13 @@ LtPersistence::LtPersistence(unsigned short nCurrentVersion)
     {
         m_taskMutex = semMCreate(SEM_Q_PRIORITY | SEM_INVERSION_SAFE);
     }
+    if (m_defaultNvdMutex == NULL)
+    {
+        m_defaultNvdMutex = semMCreate(SEM_Q_PRIORITY | SEM_INVERSION_SAFE);
+    }
+    m_hNvdStack = NULL;
+    m_nvdMutex = m_defaultNvdMutex;
+    m_pNextPersistence = NULL;
 #else
 	m_semPending = semBCreate(SEM_Q_FIFO, SEM_EMPTY);
 #endif
@@ -277,15 +324,25 @@ LtPersistence::~LtPersistence()
 #if PERSISTENCE_TYPE_IS(FTXL)
     if (m_type < LonNvdSegNumSegmentTypes)
     {
-        boolean lastOne = true;
+        boolean lastOne;
         semTake(m_taskMutex, WAIT_FOREVER);
-        m_pPersitenceList[m_type] = NULL;
-        int i;
-
-        for (i = 0; i < LonNvdSegNumSegmentTypes && lastOne; i++)
+        LtPersistence** ppPersistence = &m_pPersistenceList;
+        while (*ppPersistence != NULL && *ppPersistence != this)
+        {
+            ppPersistence = &(*ppPersistence)->m_pNextPersistence;
+        }
+        if (*ppPersistence != NULL)
+        {
+            *ppPersistence = m_pNextPersistence;
+            m_bListChanged = true;
+        }
+        while (m_pStoring == this)
         {
-            lastOne = (m_pPersitenceList[i] == NULL);
+            semGive(m_taskMutex);
+            taskDelay(1);
+            semTake(m_taskMutex, WAIT_FOREVER);
         }
+        lastOne = (m_pPersistenceList == NULL);
 
         if (lastOne)
         {
@@ -523,16 +580,18 @@ void LtPersistence::write(byte* pImage, LtPersistenceHeader* pHdr)
 	// other platforms, assume FFS writes are synchronous.
 
 #if PERSISTENCE_TYPE_IS(FTXL)
-    LonNvdHandle f = LonNvdOpenForWrite(m_type, sizeof(*pHdr)+pHdr->length);
+    nvdBegin();
+    LonNvdHandle f = NvdOpenForWrite(m_hNvdStack, nvdFsPath(), m_type, sizeof(*pHdr)+pHdr->length);
     if (f != NULL)
     {
-        if (LonNvdWrite(f, 0, sizeof(*pHdr), pHdr) != 0 ||
-            LonNvdWrite(f, sizeof(*pHdr), pHdr->length, pImage) != 0)
+        if (NvdWrite(m_hNvdStack, f, 0, sizeof(*pHdr), pHdr) != 0 ||
+            NvdWrite(m_hNvdStack, f, sizeof(*pHdr), pHdr->length, pImage) != 0)
         {
 			failure = true;
         }
-        LonNvdClose(f);
+        NvdClose(m_hNvdStack, f);
     }
+    nvdEnd();
 
 #elif  defined(WIN32)
 	HANDLE f = CreateFile(m_szImage, GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS,
@@ -587,7 +646,8 @@ LtPersistenceLossReason LtPersistence::read(byte* &pImage, int& imageLength, int
 	LtPersistenceHeader hdr(0);
 
 #if PERSISTENCE_TYPE_IS(FTXL)
-    LonNvdHandle f = LonNvdOpenForRead(m_type);
+    nvdBegin();
+    LonNvdHandle f = NvdOpenForRead(m_hNvdStack, nvdFsPath(), m_type);
 #else
     FILE* f = fopen(m_szImage, "r+b");
 	if (f == NULL)
@@ -603,7 +663,7 @@ LtPersistenceLossReason LtPersistence::read(byte* &pImage, int& imageLength, int
 	if (f != NULL) 
 	{
 #if PERSISTENCE_TYPE_IS(FTXL)
-        if (LonNvdRead(f, 0, sizeof(hdr), &hdr) != 0)
+        if (NvdRead(m_hNvdStack, f, 0, sizeof(hdr), &hdr) != 0)
 #else
         if (fread(&hdr, sizeof(hdr), 1, f) != 1) 
 #endif
@@ -631,7 +691,7 @@ LtPersistenceLossReason LtPersistence::read(byte* &pImage, int& imageLength, int
 			pImage = (byte *) malloc(imageLength);
 			if (pImage == null ||
 #if PERSISTENCE_TYPE_IS(FTXL)
-                LonNvdRead(f, sizeof(hdr), imageLength, pImage) != 0 ||
+                NvdRead(m_hNvdStack, f, sizeof(hdr), imageLength, pImage) != 0 ||
 #else
                 fread(pImage, imageLength, 1, f) != 1 ||
 #endif
@@ -643,7 +703,7 @@ LtPersistenceLossReason LtPersistence::read(byte* &pImage, int& imageLength, int
 			}
 		}
 #if PERSISTENCE_TYPE_IS(FTXL)
-        LonNvdClose(f);
+        NvdClose(m_hNvdStack, f);
 #else
 		fclose(f);
 #endif
@@ -652,6 +712,9 @@ LtPersistenceLossReason LtPersistence::read(byte* &pImage, int& imageLength, int
 	{
 		reason = LT_NO_PERSISTENCE;
 	}
+#if PERSISTENCE_TYPE_IS(FTXL)
+    nvdEnd();
+#endif
 
 	return reason;
 }
@@ -659,12 +722,18 @@ LtPersistenceLossReason LtPersistence::read(byte* &pImage, int& imageLength, int
 #if PERSISTENCE_TYPE_IS(FTXL)
 void LtPersistence::setType(LonNvdSegmentType type)
 {
-    m_type = type;
+    semTake(m_taskMutex, WAIT_FOREVER);
     if (type < LonNvdSegNumSegmentTypes)
     {
-        m_pPersitenceList[type] = this;
+        if (m_type >= LonNvdSegNumSegmentTypes)
+        {
+            m_pNextPersistence = m_pPersistenceList;
+            m_pPersistenceList = this;
+        }
         m_bShutdown = false;
     }
+    m_type = type;
+    semGive(m_taskMutex);
 }
 
 boolean LtPersistence::isCommitComplete()
@@ -857,7 +926,9 @@ void LtPersistence::setCommitFailureNotifyMode(boolean bMode)
 void LtPersistence::resetPersistence()
 {
 #if PERSISTENCE_TYPE_IS(FTXL)
-    LonNvdDelete(m_type);
+    nvdBegin();
+    NvdDelete(m_hNvdStack, nvdFsPath(), m_type);
+    nvdEnd();
 #else
     LtIpDeleteFile(m_szImage);
 #endif
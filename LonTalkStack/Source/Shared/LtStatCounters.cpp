@@ -0,0 +1,239 @@
+//
+// LtStatCounters.cpp
+//
+// Copyright © 2022 Dialog Semiconductor
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in 
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include "LtStackInternal.h"
+
+#ifdef WIN32
+#define STAT_TLS					__declspec(thread)
+#define STAT_NEXT_SLOT()			InterlockedIncrement(&s_nStatSlots)
+#define STAT_SHARED_ADD(p, n)		InterlockedExchangeAdd64((volatile LONGLONG*)(p), (n))
+#define STAT_BARRIER()				MemoryBarrier()
+#else
+#define STAT_TLS					__thread
+#define STAT_NEXT_SLOT()			__sync_add_and_fetch(&s_nStatSlots, 1)
+#define STAT_SHARED_ADD(p, n)		__sync_fetch_and_add((p), (ULONGLONG)(n))
+#define STAT_BARRIER()				__sync_synchronize()
+#include <pthread.h>
+#endif
+
+// Slots handed out so far, and this thread's slot plus one (0 until the
+// thread first bumps a counter).  A slot is the same for every set.
+static volatile LONG		s_nStatSlots = 0;
+static STAT_TLS int			s_nStatSlot = 0;
+
+#ifndef WIN32
+// Slots given back by threads that have exited, for new threads to reuse.
+// A thread's key value is its slot plus one, so that the key's destructor
+// runs when the thread exits.
+static pthread_mutex_t		s_statSlotLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t		s_statSlotOnce = PTHREAD_ONCE_INIT;
+static pthread_key_t		s_statSlotKey;
+static int					s_freeStatSlots[LT_STAT_MAX_THREADS];
+static int					s_nFreeStatSlots = 0;
+
+static void statSlotRelease(void* pSlot)
+{
+	pthread_mutex_lock(&s_statSlotLock);
+	s_freeStatSlots[s_nFreeStatSlots++] = (int)(intptr_t)pSlot - 1;
+	pthread_mutex_unlock(&s_statSlotLock);
+	// Anything this thread counts from here on goes in the shared row.
+	s_nStatSlot = LT_STAT_MAX_THREADS + 1;
+}
+
+static void statSlotKeyCreate()
+{
+	pthread_key_create(&s_statSlotKey, statSlotRelease);
+}
+#endif
+
+//
+// statAllocSlot
+//
+// Give the calling thread a slot.  Where the OS lets us know a thread has
+// exited, its slot goes to the next new thread, which carries on counting
+// in the same rows.  So the counts are kept, and only threads running at
+// the same time need slots of their own.
+//
+static int statAllocSlot()
+{
+	int slot;
+
+#ifdef WIN32
+	slot = STAT_NEXT_SLOT() - 1;
+#else
+	pthread_once(&s_statSlotOnce, statSlotKeyCreate);
+	pthread_mutex_lock(&s_statSlotLock);
+	if (s_nFreeStatSlots != 0)
+	{
+		slot = s_freeStatSlots[--s_nFreeStatSlots];
+	}
+	else
+	{
+		slot = s_nStatSlots < LT_STAT_MAX_THREADS ? s_nStatSlots++ : LT_STAT_MAX_THREADS;
+	}
+	pthread_mutex_unlock(&s_statSlotLock);
+	if (slot < LT_STAT_MAX_THREADS)
+	{
+		pthread_setspecific(s_statSlotKey, (void*)(intptr_t)(slot + 1));
+	}
+#endif
+	if (slot > LT_STAT_MAX_THREADS)
+	{
+		slot = LT_STAT_MAX_THREADS;
+	}
+	return slot;
+}
+
+LtStatCounters::LtStatCounters(int nCounters)
+{
+	m_nCounters = nCounters;
+	for (int i = 0; i <= LT_STAT_MAX_THREADS; i++)
+	{
+		m_pRows[i] = NULL;
+		m_pRowBlocks[i] = NULL;
+	}
+	m_pBase = new ULONGLONG[nCounters];
+	memset(m_pBase, 0, nCounters*sizeof(ULONGLONG));
+}
+
+LtStatCounters::~LtStatCounters()
+{
+	for (int i = 0; i <= LT_STAT_MAX_THREADS; i++)
+	{
+		delete[] m_pRowBlocks[i];
+	}
+	delete[] m_pBase;
+}
+
+//
+// allocRow
+//
+// Allocate a zeroed row that starts on a cache line and fills whole lines,
+// so that no other allocation shares a line with it.  pBlock gets the
+// allocation to delete.
+//
+ULONGLONG* LtStatCounters::allocRow(byte*& pBlock)
+{
+	size_t size = (m_nCounters*sizeof(ULONGLONG) + LT_STAT_LINE_SIZE - 1) & ~(size_t)(LT_STAT_LINE_SIZE - 1);
+
+	pBlock = new byte[size + LT_STAT_LINE_SIZE - 1];
+	ULONGLONG* pRow = (ULONGLONG*)(((size_t)pBlock + LT_STAT_LINE_SIZE - 1) & ~(size_t)(LT_STAT_LINE_SIZE - 1));
+	memset(pRow, 0, size);
+	return pRow;
+}
+
+//
+// getRow
+//
+// Return this thread's row, creating it if this is the first bump from the
+// thread.  Only the owning thread stores a row, except for the shared one.
+//
+ULONGLONG* LtStatCounters::getRow()
+{
+	int slot = s_nStatSlot - 1;
+
+	if (slot < 0)
+	{
+		slot = statAllocSlot();
+		s_nStatSlot = slot + 1;
+	}
+
+	ULONGLONG* pRow = m_pRows[slot];
+	if (pRow == NULL)
+	{
+		byte* pBlock;
+		pRow = allocRow(pBlock);
+		STAT_BARRIER();
+		if (slot < LT_STAT_MAX_THREADS)
+		{
+			m_pRowBlocks[slot] = pBlock;
+			m_pRows[slot] = pRow;
+		}
+		else
+		{
+			// The shared row may be raced for
+#ifdef WIN32
+			if (InterlockedCompareExchangePointer((PVOID volatile*)&m_pRows[slot], pRow, NULL) != NULL)
+#else
+			if (!__sync_bool_compare_and_swap(&m_pRows[slot], (ULONGLONG*)NULL, pRow))
+#endif
+			{
+				delete[] pBlock;
+				pRow = m_pRows[slot];
+			}
+			else
+			{
+				m_pRowBlocks[slot] = pBlock;
+			}
+		}
+	}
+	return pRow;
+}
+
+void LtStatCounters::add(int index, int n)
+{
+	ULONGLONG* pRow = getRow();
+
+	if (s_nStatSlot <= LT_STAT_MAX_THREADS)
+	{
+		pRow[index] += n;
+	}
+	else
+	{
+		STAT_SHARED_ADD(&pRow[index], n);
+	}
+}
+
+ULONGLONG LtStatCounters::getTotal(int index)
+{
+	ULONGLONG total = 0;
+
+	for (int i = 0; i <= LT_STAT_MAX_THREADS; i++)
+	{
+		ULONGLONG* pRow = m_pRows[i];
+		if (pRow != NULL)
+		{
+			total += pRow[index];
+		}
+	}
+	return total;
+}
+
+ULONGLONG LtStatCounters::get(int index)
+{
+	return getTotal(index) - m_pBase[index];
+}
+
+void LtStatCounters::set(int index, ULONGLONG value)
+{
+	m_pBase[index] = getTotal(index) - value;
+}
+
+void LtStatCounters::clear()
+{
+	for (int i = 0; i < m_nCounters; i++)
+	{
+		m_pBase[i] = getTotal(i);
+	}
+}
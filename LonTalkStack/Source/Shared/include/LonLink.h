@@ -154,6 +154,7 @@
 #include "LtVxWorks.h"
 #include "VxClass.h"
 #include "LonTalk.h"
+#include "LtPaCaptureRing.h"
 
 /////////////////////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////////////////////
@@ -200,6 +201,16 @@ public:
 
 	static  void  setPerfectXcvrReg(byte* pData, int len, bool bAlternatePath);
 
+	// Protocol analyzer tap.  While a callback is registered, packets sent
+	// and received are copied into a capture ring and a separate task passes
+	// them to fn.  If fn can't keep up, packets are dropped and counted
+	// rather than holding up the link.  Once unregister returns, fn is not
+	// called again and packets it hadn't been passed are dropped.
+	void registerProtocolAnalyzerCallback(void (*fn)(char*, int));
+	void unregisterProtocolAnalyzerCallback();
+	ULONGLONG getProtocolAnalyzerCount(LtPaStatIndex index);
+	void paDrainTask();
+
 #ifdef WIN32
     virtual void registerLdvHandle(int ldvHandle) 
     {
@@ -215,15 +226,62 @@ protected:
 
 	boolean			m_bDelayedRetransmitPending;		// transmit timer running
 
+	// Number of packets receiveTask reads from the driver at a time, and
+	// the size of each slot in its read buffer
+	enum
+	{
+		RECEIVE_BATCH_SIZE = 8,
+		RECEIVE_SLOT_SIZE = MAX_LPDU_SIZE+10
+	};
+
+	// A received packet copied to a client buffer and waiting to be handed
+	// to the network layer.  receiveTask hands off all the packets of a batch
+	// with a single release of the link lock.
+	struct LonLinkRxDelivery
+	{
+		LLPktQue*	pPkt;
+		boolean		bPriority;		// of the packet; the buffer may be a normal one
+		int			nSize;
+		int			nSlot;
+		boolean		validPacket;
+		byte		ltType;
+		LtSts		sts;
+		int			ssiReg1;
+		int			ssiReg2;
+	};
+	void	deliverReceived(LonLinkRxDelivery* pDeliveries, int nDeliveries);
+
 	// Platform-specific driver functions
 	virtual LtSts driverOpen(const char* pName) = 0;
 	virtual void driverClose() = 0;
 	virtual LtSts driverRead(void *pData, short len) = 0;
+	// Read up to nMaxPkts packets into consecutive len byte slots of pData.
+	// nPkts is set to the number read.  Returns LTSTS_OK if any were read,
+	// else the status of the failed driverRead.  The default just calls
+	// driverRead repeatedly; drivers that can fetch several packets from the
+	// OS in one call should override it.
+	virtual LtSts driverReadBatch(byte *pData, short len, int nMaxPkts, int &nPkts);
 	virtual LtSts driverWrite(void *pData, short len) = 0;
 	virtual LtSts driverRegisterEvent() = 0;
 	virtual void driverReceiveEvent() = 0;
 	virtual void setPhaseMode(void);
-	virtual void sendToProtocolAnalyser(byte* pData, bool crcIncluded = true) {}
+	// Costs a single test when no analyzer is registered.
+	void sendToProtocolAnalyser(byte* pData, bool crcIncluded = true)
+	{
+		if (m_bPaTap && m_pPaRing->put(pData, crcIncluded) && m_pPaRing->takeIdle())
+		{
+			semGive(m_semPaWake);
+		}
+	}
+
+	volatile boolean	m_bPaTap;
+	LtPaSink			m_paFn;				// Guarded by m_semPaDrain
+	LtPaCaptureRing*	m_pPaRing;			// Created on first registration
+	int					m_tidPaDrain;
+	volatile boolean	m_bExitPaDrain;
+	SEM_ID				m_semPaDrain;		// Held while draining the ring
+	SEM_ID				m_semPaWake;		// Given on registration and when the ring goes non-empty
+	void stopPaDrainTask();
 
 	VxcSignal m_semLocalResponse;
 	VxcLock   m_lockLocal;
@@ -236,7 +294,7 @@ protected:
     bool   m_buffersInSync;
 	int	   m_frequency;
 	byte   m_lastXcvrReg[LT_NUM_REGS];
-	int    m_lastRxCount;
+	ULONGLONG m_lastRxCount;
 	bool   m_bClearOneAndOnlyOne;
 
     LtSts readBuffers();
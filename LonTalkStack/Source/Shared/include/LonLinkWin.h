@@ -79,7 +79,6 @@ static LonLinkWin *_instance;
 	virtual LtSts driverWrite(void *pData, short len);
 	virtual LtSts driverRegisterEvent();
 	virtual void driverReceiveEvent();
-	virtual void sendToProtocolAnalyser(byte* pData, bool crcIncluded = true);
 
 	// Retransmit timer routines (Win32 specific)
 	void transmitTimerRoutine();
@@ -94,6 +94,20 @@ Comments:  None.
 *******************************************************************************/
 void LtCRC16(byte bufInOut[], int sizeIn);
 
+/*******************************************************************************
+Function:  LtCRC16Compute
+Returns:   16 bit CRC computed.
+Purpose:   To compute the CRC LtCRC16 would store, leaving the buffer alone.
+*******************************************************************************/
+unsigned short LtCRC16Compute(const byte bufIn[], int sizeIn);
+
+/*******************************************************************************
+Function:  LtCRC16Verify
+Returns:   TRUE if the CRC in the two bytes following the data is correct.
+Purpose:   To check a received CRC without rewriting the buffer.
+*******************************************************************************/
+boolean LtCRC16Verify(const byte bufIn[], int sizeIn);
+
 #ifdef  __cplusplus
 }
 #endif
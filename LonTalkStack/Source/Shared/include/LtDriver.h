@@ -177,11 +177,13 @@
 //////////////////////////////////////////////////////////////////////////////////
 // Helper types, classes
 //
+#include <string.h>
 #include <VxlTypes.h>
 #include <LtUniqueId.h>
 #include <LtCommParams.h>
 #include "LtProgramId.h"
 #include "LtReadOnlyData.h"
+#include "LtStatCounters.h"
 
 #ifndef _FTXL_TYPES_H
 #undef LtServicePinState
@@ -285,19 +287,98 @@ public:
 	boolean m_shadowed;	// indicates whether this object is really the next one (avoid RTTI)
 };
 
+// Indices of the counters behind LtLinkStats, in the same order as its fields
+enum LtLinkStatIndex
+{
+	LT_LINK_STAT_TRANSMISSION_ERRORS,
+	LT_LINK_STAT_MISSED_PACKETS,
+	LT_LINK_STAT_COLLISIONS,
+	LT_LINK_STAT_BACKLOG_OVERFLOWS,
+	LT_LINK_STAT_TRANSMITTED_PACKETS,
+	LT_LINK_STAT_RECEIVED_PACKETS,
+	LT_LINK_STAT_RECEIVED_PRIORITY_PACKETS,
+	LT_LINK_STAT_BACKOFFS,
+	LT_LINK_NUM_STATS
+};
+
+// Full width link statistics for monitoring.  m_values is indexed by
+// LtLinkStatIndex.  m_shadow holds the counts since the shadow statistics
+// were last cleared, and equals m_values if the link does not shadow them.
+class LtLinkStatsSnapshot
+{
+public:
+	ULONGLONG	m_values[LT_LINK_NUM_STATS];
+	ULONGLONG	m_shadow[LT_LINK_NUM_STATS];
+};
+
 // This is to allow the internal devices to get these values from the driver
-// and clear them without clearing the driver's values
+// and clear them without clearing the driver's values.
+// Links keep the counts in m_counters, bumped per thread; the int fields
+// are only brought up to date by update(), and cap at 0x7FFFFFFF rather
+// than wrapping negative.
 class LtLinkStatsShadow	: public LtLinkStats
 {
 public:
-	LtLinkStatsShadow() { m_shadowed = true; }
+	LtLinkStatsShadow() : m_counters(LT_LINK_NUM_STATS)
+	{
+		m_shadowed = true;
+		clearStats();
+		clearShadowStats();
+	}
 
 	int m_nTransmissionErrorsShadow;
 	int m_nMissedPacketsShadow;
 	int m_nBacklogOverflowsShadow;	// Is not actually used anywhere; exists for completeness.
 	int m_nCollisionsShadow;
 
-	void clearShadowStats() { m_nTransmissionErrorsShadow = m_nMissedPacketsShadow = m_nBacklogOverflowsShadow = m_nCollisionsShadow = 0; }
+	void bump(int index)		{ m_counters.bump(index); }
+	void add(int index, int n)	{ m_counters.add(index, n); }
+	ULONGLONG get(int index)	{ return m_counters.get(index); }
+
+	void update()
+	{
+		int* pFields[LT_LINK_NUM_STATS] = { &m_nTransmissionErrors, &m_nMissedPackets, &m_nCollisions,
+			&m_nBacklogOverflows, &m_nTransmittedPackets, &m_nReceivedPackets, &m_nReceivedPriorityPackets, &m_nBackoffs };
+		for (int i = 0; i < LT_LINK_NUM_STATS; i++)
+		{
+			*pFields[i] = toField(m_counters.get(i));
+		}
+		m_nTransmissionErrorsShadow = toField(getShadow(LT_LINK_STAT_TRANSMISSION_ERRORS));
+		m_nMissedPacketsShadow = toField(getShadow(LT_LINK_STAT_MISSED_PACKETS));
+		m_nBacklogOverflowsShadow = toField(getShadow(LT_LINK_STAT_BACKLOG_OVERFLOWS));
+		m_nCollisionsShadow = toField(getShadow(LT_LINK_STAT_COLLISIONS));
+	}
+
+	void snapshot(LtLinkStatsSnapshot& snap)
+	{
+		for (int i = 0; i < LT_LINK_NUM_STATS; i++)
+		{
+			snap.m_values[i] = m_counters.get(i);
+			snap.m_shadow[i] = m_shadowed ? getShadow(i) : snap.m_values[i];
+		}
+	}
+
+	void clearCounters()
+	{
+		m_counters.clear();
+		clearStats();
+	}
+
+	void clearShadowStats()
+	{
+		for (int i = 0; i < LT_LINK_NUM_STATS; i++)
+		{
+			m_shadowBase[i] = m_counters.getTotal(i);
+		}
+		m_nTransmissionErrorsShadow = m_nMissedPacketsShadow = m_nBacklogOverflowsShadow = m_nCollisionsShadow = 0;
+	}
+
+private:
+	ULONGLONG getShadow(int index)	{ return m_counters.getTotal(index) - m_shadowBase[index]; }
+	static int toField(ULONGLONG n)	{ return n > 0x7FFFFFFF ? 0x7FFFFFFF : (int)n; }
+
+	LtStatCounters	m_counters;
+	ULONGLONG		m_shadowBase[LT_LINK_NUM_STATS];	// totals when the shadow was cleared
 };
 
 #define LPDU_OVERHEAD  14	// Bytes needs for private driver storage
@@ -306,6 +387,17 @@ public:
 // Forward reference
 class LtNetwork;
 
+// One receive buffer for LtLink::queueReceiveBatch.  The arguments are
+// those of queueReceive; bPriority is updated to the queue actually used.
+struct LtReceivePost
+{
+	void*	referenceId;
+	boolean	bPriority;
+	byte	flags;
+	byte*	pData;
+	int		nMaxLength;
+};
+
 //////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////
 //
@@ -377,6 +469,34 @@ public:
 						byte* pData,
 						int nMaxLength) = 0;
 
+	// Queue a batch of receive buffers, in order, as queueReceive does.
+	// If the requested queue is full and bTryOther is set, the buffer goes
+	// on the other queue.  Stops at the first buffer that can't be queued
+	// and returns the number queued; the caller still owns the rest.
+	// Links with a single lock override this to take it once per batch.
+	virtual int queueReceiveBatch(LtReceivePost* pPosts, int nPosts,
+								  boolean bTryOther = true)
+	{
+		int n;
+		for (n = 0; n < nPosts; n++)
+		{
+			LtReceivePost& post = pPosts[n];
+			LtSts sts = queueReceive(post.referenceId, post.bPriority,
+									 post.flags, post.pData, post.nMaxLength);
+			if (sts != LTSTS_PENDING && bTryOther)
+			{
+				post.bPriority = !post.bPriority;
+				sts = queueReceive(post.referenceId, post.bPriority,
+								   post.flags, post.pData, post.nMaxLength);
+			}
+			if (sts != LTSTS_PENDING)
+			{
+				break;
+			}
+		}
+		return n;
+	}
+
 	// This function resets the driver and the comm port.  Any buffered
 	// outgoing messages or messages in progress are not sent.  Any incoming
 	// messages in process are lost.   All statistics are reset.  Following this
@@ -461,9 +581,32 @@ public:
 	virtual LtSts getTransceiverRegister(int n) = 0;
 
 	// Reports statistics from the driver/LON-C.
-	// These statistics are 16 bits and cap at 0xFFFF.
+	// The int fields of LtLinkStats cap at 0x7FFFFFFF; the LonTalk view of
+	// the statistics caps them at 0xFFFF.
 	virtual void getStatistics(LtLinkStats& stats) = 0;
 	virtual void getStatistics(LtLinkStats *&pStats) = 0;
+
+	// Reports the same statistics without a cap, for monitoring.
+	// Links that keep wider counters override this; the default widens
+	// what getStatistics reports.
+	virtual void getStatisticsSnapshot(LtLinkStatsSnapshot& snap)
+	{
+		LtLinkStats* pStats;
+		getStatistics(pStats);
+		memset(&snap, 0, sizeof(snap));
+		if (pStats != NULL)
+		{
+			snap.m_values[LT_LINK_STAT_TRANSMISSION_ERRORS] = (unsigned)pStats->m_nTransmissionErrors;
+			snap.m_values[LT_LINK_STAT_MISSED_PACKETS] = (unsigned)pStats->m_nMissedPackets;
+			snap.m_values[LT_LINK_STAT_COLLISIONS] = (unsigned)pStats->m_nCollisions;
+			snap.m_values[LT_LINK_STAT_BACKLOG_OVERFLOWS] = (unsigned)pStats->m_nBacklogOverflows;
+			snap.m_values[LT_LINK_STAT_TRANSMITTED_PACKETS] = (unsigned)pStats->m_nTransmittedPackets;
+			snap.m_values[LT_LINK_STAT_RECEIVED_PACKETS] = (unsigned)pStats->m_nReceivedPackets;
+			snap.m_values[LT_LINK_STAT_RECEIVED_PRIORITY_PACKETS] = (unsigned)pStats->m_nReceivedPriorityPackets;
+			snap.m_values[LT_LINK_STAT_BACKOFFS] = (unsigned)pStats->m_nBackoffs;
+		}
+		memcpy(snap.m_shadow, snap.m_values, sizeof(snap.m_shadow));
+	}
 	// 0 the statistics.
 	virtual void clearStatistics() = 0;
 
@@ -492,6 +635,14 @@ public:
 	virtual void setLoopbackMode(boolean on) = 0;
 	virtual boolean getLoopbackMode() = 0;
 
+	// Returns true if every received packet was built locally by the driver
+	// (for example when converting an IP frame) rather than received from the
+	// wire, so that clients need not verify its CRC.  Such a driver may leave
+	// the CRC bytes unset; the client has it generated when it is needed.  It
+	// must still fill them in while the link's protocol analyzer tap or its
+	// own trace would show the frame.
+	virtual boolean isCrcTrusted() { return false; }
+
 	// Performs a self test of the comm port and returns a result.
 	// May take a few seconds to 
 	// return in failure case.  Self test will disrupt normal packet activity
@@ -319,6 +319,9 @@ public:
 	virtual void getStatistics(LtLinkStats *&pStats)
 	{	getLink()->getStatistics( pStats );
 	}
+	virtual void getStatisticsSnapshot(LtLinkStatsSnapshot& snap)
+	{	getLink()->getStatisticsSnapshot( snap );
+	}
 	// Pass through
 	virtual void clearStatistics()
 	{	getLink()->clearStatistics();
@@ -495,6 +498,7 @@ public:
 
 	// IO related members
 	void	queueReceives();
+	void	prepareReceive(LtPktInfo* pPkt, LtReceivePost& post);
 
 	void	resetAndSetCommParams(boolean bRequeue=true);
 
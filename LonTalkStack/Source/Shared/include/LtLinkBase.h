@@ -212,6 +212,8 @@ public:
 						byte flags,
 						byte* pData,
 						int nMaxLength);
+	virtual int queueReceiveBatch(LtReceivePost* pPosts, int nPosts,
+								  boolean bTryOther = true);
 	virtual void reset();
 	virtual int getStandardTransceiverId();
 	virtual boolean getUniqueId(LtUniqueId& uniqueId);
@@ -222,6 +224,7 @@ public:
 	virtual LtSts getTransceiverRegister(int n);
 	virtual void getStatistics(LtLinkStats& stats);
 	virtual void getStatistics(LtLinkStats *&pStats);
+	virtual void getStatisticsSnapshot(LtLinkStatsSnapshot& snap);
 	virtual void clearStatistics();
 	virtual void setServicePinState(LtServicePinState state);
 	virtual void setProtocolAnalyzerMode(boolean on);
@@ -242,6 +245,8 @@ public:
 	virtual boolean	dumpEnable( boolean bEnable );
 	virtual boolean	dumpHeadersOnly( boolean bEnable );
 	virtual void	dumpPacket( LPCSTR tag, byte* pData, int nLen );
+	// Lets per packet paths skip building dumpPacket arguments.
+	boolean			dumpActive() { return m_bDumpEnable || s_bDumpEnable; }
 	virtual void	dumpLtPacket( LPCSTR tag, byte* pData, int nLen );
 
 	virtual LtServicePinState getServicePinState()
@@ -325,6 +330,7 @@ protected:
 	int					m_nTransmitSlot;
 	boolean				m_bDumpEnable;
 	boolean				m_bDumpHeadersOnly;
+	static boolean		s_bDumpEnable;		// dumpEnableGlobal()
 	boolean				m_bExitReceiveTask;
 };
 
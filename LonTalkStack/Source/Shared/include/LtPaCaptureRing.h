@@ -0,0 +1,109 @@
+#ifndef LT_PACAPTURERING_H
+#define LT_PACAPTURERING_H
+//
+// LtPaCaptureRing.h
+//
+// Copyright © 2022 Dialog Semiconductor
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in 
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <VxlTypes.h>
+#include "LtStatCounters.h"
+
+// Capture slots in the ring; must be a power of two
+#define LT_PA_RING_SLOTS		64
+
+// Largest frame handed to the analyzer: the SICB header, up to 255 bytes
+// of packet (the SICB length is one byte) and the CRC.
+#define LT_PA_FRAME_MAX			(2 + 255 + 2)
+
+typedef enum
+{
+	LT_PA_STAT_CAPTURED,		// Frames copied into the ring
+	LT_PA_STAT_DROPPED,			// Frames lost because the ring was full
+	LT_PA_STAT_DELIVERED,		// Frames passed to the sink
+
+	LT_PA_NUM_STATS
+} LtPaStatIndex;
+
+typedef void (*LtPaSink)(char* pData, int len);
+
+//
+// LtPaCaptureRing
+//
+// A bounded ring of captured frames for the protocol analyzer.  Any number
+// of threads may put() frames without taking a lock; one thread drains
+// them into the analyzer's sink.  When the sink falls behind the ring fills
+// and further frames are counted as dropped, so capturing never holds up
+// the thread sending or receiving the packet.
+//
+// A drainer that finds the ring empty marks it idle before it sleeps, and
+// the first put() after that tells its caller to wake the drainer.
+//
+class LtPaCaptureRing
+{
+public:
+	// The positions start at nStart, so a test can run the ring across the
+	// wrap of its unsigned positions.
+	LtPaCaptureRing(unsigned int nStart = 0);
+
+	// Copy a SICB into the ring.  If the SICB has no CRC a zero one is
+	// appended, since the analyzer expects it.  Returns false if dropped.
+	boolean		put(const byte* pSicb, boolean bCrcIncluded);
+
+	// Pass up to nMax frames to fn.  Only one thread may drain.  Returns the
+	// number passed.
+	int			drain(LtPaSink fn, int nMax);
+
+	// Throw away every frame waiting in the ring, counting them as dropped.
+	// Only the thread allowed to drain may flush.  Returns the number.
+	int			flush();
+
+	// Called by the drainer when drain() found nothing.  Returns true if the
+	// ring is still empty and now idle, in which case the drainer may sleep
+	// until woken; false if a frame arrived meanwhile.
+	boolean		setIdle();
+
+	// Called after a successful put().  Returns true, once, if the ring was
+	// idle, meaning the caller must wake the drainer.
+	boolean		takeIdle();
+
+	ULONGLONG	getCount(LtPaStatIndex index) { return m_counters.get(index); }
+	void		clearCounts() { m_counters.clear(); }
+
+private:
+	struct Slot
+	{
+		// Equals the claiming position when the slot is free and that
+		// position plus one once the frame is in it.
+		volatile unsigned int	m_nSeq;
+		int						m_nLen;
+		byte					m_data[LT_PA_FRAME_MAX];
+	};
+
+	boolean		isEmpty();
+
+	Slot					m_slots[LT_PA_RING_SLOTS];
+	volatile unsigned int	m_nHead;		// Next position for put()
+	unsigned int			m_nTail;		// Next position for drain()
+	volatile unsigned int	m_nIdle;		// Non-zero while the drainer sleeps
+	LtStatCounters			m_counters;
+};
+
+#endif
@@ -148,7 +148,22 @@ private:
     static SEM_ID           m_taskMutex;
     static boolean          m_bResetFlag;
 
-    static LtPersistence    *m_pPersitenceList[LonNvdSegNumSegmentTypes];
+    // Every persistence object with a segment type, of every stack, for the
+    // store task.  m_pStoring is the one it is storing with m_taskMutex free,
+    // and m_bListChanged says one was taken off the list meanwhile.
+    static LtPersistence    *m_pPersistenceList;
+    static LtPersistence    *m_pStoring;
+    static boolean          m_bListChanged;
+    LtPersistence           *m_pNextPersistence;
+
+    // The stack whose NVD callbacks this object makes (NULL for the default
+    // stack), and the lock of that stack held across each callback sequence.
+    static SEM_ID           m_defaultNvdMutex;
+    LonStackHandle          m_hNvdStack;
+    SEM_ID                  m_nvdMutex;
+    void                    nvdBegin();
+    void                    nvdEnd();
+    const char*             nvdFsPath() { return m_szNvdFsPath[0] != 0 ? m_szNvdFsPath : NULL; }
 
     ULONG                   m_lastUpdate;
     LonNvdSegmentType       m_type;
@@ -216,6 +231,7 @@ public:
     static void registerPersistenceMonitor(LtPersistenceMonitor *pMonitor) { m_pPersistenceMonitor = pMonitor; }
     void setNvdFsPath(const char *pNvdFsPath);
     const char* getNvdFsPath() { return m_szNvdFsPath; }
+    void setNvdStack(LonStackHandle hStack, SEM_ID nvdMutex);
     void writeUniqueID(LtUniqueId &uid);
     LtPersistenceLossReason readUniqueID(LtUniqueId* pId);
     static boolean getResetFlag() {return m_bResetFlag; }
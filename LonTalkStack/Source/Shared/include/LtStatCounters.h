@@ -0,0 +1,85 @@
+#ifndef LT_STATCOUNTERS_H
+#define LT_STATCOUNTERS_H
+//
+// LtStatCounters.h
+//
+// Copyright © 2022 Dialog Semiconductor
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy of
+// this software and associated documentation files (the "Software"), to deal in 
+// the Software without restriction, including without limitation the rights to
+// use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies
+// of the Software, and to permit persons to whom the Software is furnished to do
+// so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+
+#include <VxlTypes.h>
+
+// Rows are padded to a whole number of cache lines of this size and start
+// on a line, so no two threads' rows share one.
+#define LT_STAT_LINE_SIZE		64
+
+// Threads that get a row of their own in each LtStatCounters.  Any further
+// threads share one row, updated with atomic adds.  On POSIX targets this
+// counts only threads running at the same time.
+#define LT_STAT_MAX_THREADS		64
+
+//
+// LtStatCounters
+//
+// A set of 64 bit event counters that several threads may bump at once.
+// Each thread counts into its own row, allocated the first time it bumps
+// this set, so a bump is a plain add with no locked instruction and no
+// cache line shared with other threads (see LT_STAT_LINE_SIZE).  Reads add the rows up.  Rows of
+// threads that have exited are kept, so their counts are not lost, and on
+// POSIX targets they are handed on to the next new thread.
+//
+// Clearing or setting a counter records a base to subtract, rather than
+// writing into rows other threads own.  On 32 bit targets a read racing a
+// bump can see a row half updated across a carry out of the low word; these
+// are statistics, so we accept that.
+//
+class LtStatCounters
+{
+public:
+	LtStatCounters(int nCounters);
+	~LtStatCounters();
+
+	void		bump(int index)		{ add(index, 1); }
+	void		add(int index, int n);
+
+	// Count since the last clear or set
+	ULONGLONG	get(int index);
+	// Count since the set was created; never cleared
+	ULONGLONG	getTotal(int index);
+	void		set(int index, ULONGLONG value);
+	void		clear();
+
+	int			getCount()			{ return m_nCounters; }
+
+private:
+	ULONGLONG*	getRow();
+	ULONGLONG*	allocRow(byte*& pBlock);
+
+	int						m_nCounters;
+	ULONGLONG* volatile		m_pRows[LT_STAT_MAX_THREADS + 1];	// last is shared
+	byte*					m_pRowBlocks[LT_STAT_MAX_THREADS + 1];	// allocations holding m_pRows
+	ULONGLONG*				m_pBase;
+
+	// Rows are owned; don't copy them
+	LtStatCounters(const LtStatCounters&);
+	LtStatCounters& operator=(const LtStatCounters&);
+};
+
+#endif
@@ -27,10 +27,125 @@
 
 #include "LtStackInternal.h"
 
+// Orders the writes that fill in a group map (or entry) before the write
+// that makes it visible to lock-free readers.
+#ifdef WIN32
+#define GROUP_MAP_BARRIER()		MemoryBarrier()
+#else
+#define GROUP_MAP_BARRIER()		__sync_synchronize()
+#endif
+
+LtGroupMapSet::LtGroupMapSet(int nDomains, LtGroupMapSet* pRetired)
+{
+	m_nDomains = nDomains;
+	m_ppMap = new LtGroupMap* volatile[nDomains];
+	for (int i = 0; i < nDomains; i++)
+	{
+		m_ppMap[i] = pRetired != null && i < pRetired->m_nDomains ? pRetired->m_ppMap[i] : null;
+	}
+	m_pRetired = pRetired;
+}
+
 //
 // Private Member Functions
 //
 
+boolean LtAddressConfigurationTable::isGroupInput(LtAddressConfiguration* pAc)
+{
+	return pAc != null &&
+		   pAc->getAddressType() == LT_AT_GROUP &&
+		   pAc->getRestrictions() != LT_GRP_OUTPUT_ONLY &&
+		   pAc->getGroup() >= 0 && pAc->getGroup() < LT_GROUPS_PER_DOMAIN &&
+		   pAc->getDomainIndex() >= 0;
+}
+
+//
+// Returns the map for a domain, or null if no group has been seen in it.
+// Safe without the table lock.
+//
+LtGroupMap* LtAddressConfigurationTable::getGroupMap(int domainIndex)
+{
+	LtGroupMapSet* pSet = m_pGroupMaps;
+	if (pSet == null || domainIndex < 0 || domainIndex >= pSet->m_nDomains)
+	{
+		return null;
+	}
+	return pSet->m_ppMap[domainIndex];
+}
+
+//
+// Returns the map for a domain, creating it (and growing the set) as needed.
+// Called with the table lock held.
+//
+LtGroupMap* LtAddressConfigurationTable::makeGroupMap(int domainIndex)
+{
+	LtGroupMapSet* pSet = m_pGroupMaps;
+	if (pSet == null || domainIndex >= pSet->m_nDomains)
+	{
+		pSet = new LtGroupMapSet(domainIndex + 1, pSet);
+		GROUP_MAP_BARRIER();
+		m_pGroupMaps = pSet;
+	}
+	LtGroupMap* pMap = pSet->m_ppMap[domainIndex];
+	if (pMap == null)
+	{
+		pMap = new LtGroupMap;
+		GROUP_MAP_BARRIER();
+		pSet->m_ppMap[domainIndex] = pMap;
+	}
+	return pMap;
+}
+
+//
+// Enter an entry in the group map if it is now the lowest numbered entry 
+// which can receive on its group.  Note that if a node is in a group 
+// multiple times, we use the first one.  The rules for how to behave if 
+// the group attributes are mixed is not clear.  Called with the table lock 
+// held.
+//
+void LtAddressConfigurationTable::addGroupMember(LtAddressConfiguration* pAc)
+{
+	if (isGroupInput(pAc))
+	{
+		LtGroupMap* pMap = makeGroupMap(pAc->getDomainIndex());
+		LtAddressConfiguration* pCur = pMap->m_pGroup[pAc->getGroup()];
+		if (pCur == null || pCur->getIndex() > pAc->getIndex())
+		{
+			GROUP_MAP_BARRIER();
+			pMap->m_pGroup[pAc->getGroup()] = pAc;
+		}
+	}
+}
+
+//
+// Remove an entry, which is about to change, from the group map.  If it was
+// the one in the map, the next lowest numbered entry for the group takes its
+// place.  Called with the table lock held.
+//
+void LtAddressConfigurationTable::removeGroupMember(LtAddressConfiguration* pAc)
+{
+	if (isGroupInput(pAc))
+	{
+		LtGroupMap* pMap = getGroupMap(pAc->getDomainIndex());
+		int group = pAc->getGroup();
+		if (pMap != null && pMap->m_pGroup[group] == pAc)
+		{
+			LtAddressConfiguration* pNext = null;
+			for (int i = 0; i < m_count && pNext == null; i++)
+			{
+				LtAddressConfiguration* pChk = m_addr[i];
+				if (pChk != pAc && isGroupInput(pChk) &&
+					pChk->getDomainIndex() == pAc->getDomainIndex() &&
+					pChk->getGroup() == group)
+				{
+					pNext = pChk;
+				}
+			}
+			pMap->m_pGroup[group] = pNext;
+		}
+	}
+}
+
 
 //
 // Protected Member Functions
@@ -46,7 +161,9 @@ LtAddressConfigurationTable::LtAddressConfigurationTable()
 {
 	m_lastMatchingIndex = 0;
 	m_addr = null;
+	m_pGroupMaps = null;
 	m_count = 0;
+	m_nChangeCount = 0;
 }
 
 LtAddressConfigurationTable::~LtAddressConfigurationTable()
@@ -56,7 +173,21 @@ LtAddressConfigurationTable::~LtAddressConfigurationTable()
         delete m_addr[i];
     }
     delete m_addr;
-	m_domainGroups.clear(true);
+
+	LtGroupMapSet* pSet = m_pGroupMaps;
+	if (pSet != null)
+	{
+		for (int i = 0; i < pSet->m_nDomains; i++)
+		{
+			delete pSet->m_ppMap[i];
+		}
+	}
+	while (pSet != null)
+	{
+		LtGroupMapSet* pRetired = pSet->m_pRetired;
+		delete pSet;
+		pSet = pRetired;
+	}
 }
 
 void LtAddressConfigurationTable::setCount(LtDeviceStack* pStack, int count) 
@@ -71,6 +202,16 @@ void LtAddressConfigurationTable::setCount(LtDeviceStack* pStack, int count)
     }
 	m_count = count;
 
+	// No entries, so no group members
+	LtGroupMapSet* pSet = m_pGroupMaps;
+	for (int d = 0; pSet != null && d < pSet->m_nDomains; d++)
+	{
+		if (pSet->m_ppMap[d] != null)
+		{
+			memset((void*)pSet->m_ppMap[d]->m_pGroup, 0, sizeof(pSet->m_ppMap[d]->m_pGroup));
+		}
+	}
+
 	unlock();
 }
 
@@ -126,10 +267,13 @@ LtErrorType LtAddressConfigurationTable::set(int index, LtAddressConfiguration&
 		}
 		if (pAc != NULL)
 		{
+			removeGroupMember(pAc);
 			*pAc = ac;
+			GROUP_MAP_BARRIER();
 			m_addr[index] = pAc;
+			addGroupMember(pAc);
 		}
-		m_bRebuildMap = true;
+		m_nChangeCount++;
 	}
 
 	unlock();
@@ -142,81 +286,30 @@ LtErrorType LtAddressConfigurationTable::set(int index, LtAddressConfiguration&
 //
 void LtAddressConfigurationTable::getGroups(int domainIndex, LtGroups &gp)
 {
-	lock();
-
-	rebuildMap();
-
-	LtGroupAddresses* pGa = m_domainGroups.elementAt(domainIndex);
+	LtGroupMap* pMap = getGroupMap(domainIndex);
 
-	if (pGa != null)
+	if (pMap != null)
 	{
-		int size = pGa->size();
-		for (int i=0; i<size; i++)
+		for (int i=0; i<LT_GROUPS_PER_DOMAIN; i++)
 		{
-			LtAddressConfiguration* pAc = pGa->elementAt(i);
+			LtAddressConfiguration* pAc = pMap->m_pGroup[i];
 			if (pAc && pAc->getRestrictions() != LT_GRP_OUTPUT_ONLY)
 			{
 				gp.set(i);
 			}
 		}
 	}
-	unlock();
 }
 
 LtAddressConfiguration* LtAddressConfigurationTable::get(int domainIndex, int group)
 {
-	LtAddressConfiguration* pAc = null;
-
-	lock();
-
-	rebuildMap();
-
-	LtGroupAddresses* pGa = m_domainGroups.elementAt(domainIndex);
-
-	if (pGa != null)
-	{
-		pAc = pGa->elementAt(group);
-	}
-	
-	unlock();
+	LtGroupMap* pMap = getGroupMap(domainIndex);
 
-	return pAc;
-}
-
-void LtAddressConfigurationTable::rebuildMap()
-{
-	if (m_bRebuildMap)
+	if (pMap == null || group < 0 || group >= LT_GROUPS_PER_DOMAIN)
 	{
-		m_bRebuildMap = false;
-		m_domainGroups.clear(true);
-		for (int i = 0; i < m_count; i++) 
-		{
-			LtAddressConfiguration* pAc;
-
-			if (get(i, &pAc) == LT_NO_ERROR)
-			{
-				if (pAc != NULL &&
-                    pAc->getAddressType() == LT_AT_GROUP &&
-					pAc->getRestrictions() != LT_GRP_OUTPUT_ONLY)
-				{
-					int dmn = pAc->getDomainIndex();
-					LtGroupAddresses* pGroups = m_domainGroups.elementAt(dmn);
-					if (pGroups == null)
-					{
-						pGroups = new LtGroupAddresses();
-						m_domainGroups.addElementAt(dmn, pGroups);
-					}
-					if (pGroups->elementAt(pAc->getGroup()) == null)
-					{
-						// Note that if a node is in a group multiple times,
-						// we use the first one.  The rules for how to behave
-						// if the group attributes are mixed is not clear.
-						pGroups->addElementAt(pAc->getGroup(), pAc);
-					}
-				}
-			}
-		} 
+		return null;
 	}
+	return pMap->m_pGroup[group];
 }
 
 // For better performance, would be better if we did fixup of all 
@@ -26,6 +26,7 @@
 //
 
 #include "LtStackInternal.h"
+#include "Osal.h"
 
 //
 // Private Member Functions
@@ -527,6 +528,139 @@ void LtMsgOut::package(LtBlob *pBlob)
     LtApduOut::package(pBlob);
 }
 
+//
+// LtMsgOut free lists, one per priority so that priority messages are not
+// held up behind normal ones.  Each pooled block starts with a header that
+// records the list it came from; the message follows it.  Freed messages are
+// linked through their first word.  The lists are guarded by OSAL critical
+// sections, which are only held to push or pop one entry.
+//
+#define MSG_OUT_POOL_MAX	64
+
+union LtMsgOutHeader
+{
+	int		nPool;
+	double	align;
+};
+
+class LtMsgOutPool
+{
+public:
+	LtMsgOutPool()
+	{
+		m_pFree = null;
+		m_nFree = 0;
+		OsalCreateCriticalSection(&m_lock);
+	}
+	void* alloc()
+	{
+		OsalEnterCriticalSection(m_lock);
+		void* p = m_pFree;
+		if (p != null)
+		{
+			m_pFree = *(void**)p;
+			m_nFree--;
+		}
+		OsalLeaveCriticalSection(m_lock);
+		return p;
+	}
+	boolean free(void* p)
+	{
+		boolean bPooled = false;
+		OsalEnterCriticalSection(m_lock);
+		if (m_nFree < MSG_OUT_POOL_MAX)
+		{
+			*(void**)p = m_pFree;
+			m_pFree = p;
+			m_nFree++;
+			bPooled = true;
+		}
+		OsalLeaveCriticalSection(m_lock);
+		return bPooled;
+	}
+
+private:
+	OsalHandle	m_lock;
+	void*		m_pFree;
+	int			m_nFree;
+};
+
+static LtMsgOutPool s_msgOutPools[2];
+
+void* LtMsgOut::allocFromPool(std::size_t size, boolean bPriority)
+{
+	// A derived class would have a different size; it uses the heap.
+	if (size != sizeof(LtMsgOut))
+	{
+		return ::operator new(size, std::nothrow);
+	}
+	int nPool = bPriority ? 1 : 0;
+	LtMsgOutHeader* pHeader = (LtMsgOutHeader*)s_msgOutPools[nPool].alloc();
+	if (pHeader == null)
+	{
+		pHeader = (LtMsgOutHeader*)::operator new(sizeof(LtMsgOutHeader) + size, std::nothrow);
+		if (pHeader == null)
+		{
+			return null;
+		}
+	}
+	pHeader->nPool = nPool;
+	return pHeader + 1;
+}
+
+void LtMsgOut::freeToPool(void* p, std::size_t size)
+{
+	if (p != null && size == sizeof(LtMsgOut))
+	{
+		LtMsgOutHeader* pHeader = (LtMsgOutHeader*)p - 1;
+		if (!s_msgOutPools[pHeader->nPool].free(pHeader))
+		{
+			::operator delete(pHeader);
+		}
+	}
+	else
+	{
+		::operator delete(p);
+	}
+}
+
+void* LtMsgOut::operator new(std::size_t size)
+{
+	void* p = allocFromPool(size, false);
+	if (p == null)
+	{
+		throw std::bad_alloc();
+	}
+	return p;
+}
+
+void* LtMsgOut::operator new(std::size_t size, const std::nothrow_t&) throw()
+{
+	return allocFromPool(size, false);
+}
+
+void* LtMsgOut::operator new(std::size_t size, boolean bPriority) throw()
+{
+	return allocFromPool(size, bPriority);
+}
+
+void LtMsgOut::operator delete(void* p, std::size_t size)
+{
+	freeToPool(p, size);
+}
+
+void LtMsgOut::operator delete(void* p, const std::nothrow_t&) throw()
+{
+	// Only called if a constructor throws during a nothrow new.
+	freeToPool(p, sizeof(LtMsgOut));
+}
+
+void LtMsgOut::operator delete(void* p, boolean bPriority) throw()
+{
+	// Only called if a constructor throws during a priority new.
+	freeToPool(p, sizeof(LtMsgOut));
+}
+
 void LtRefId::package(LtBlob *pBlob) 
 {
     pBlob->PACKAGE_VALUE(m_nType);
@@ -28,26 +28,54 @@
 #include "LtRouter.h"
 #include "LtBitMap.h"
 
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
 #define OP_SET 1
 #define OP_CLEAR 2
 
+// Index of the lowest set bit.  v must not be 0.
+static inline int ctz32(unsigned int v)
+{
+#if defined(__GNUC__)
+	return __builtin_ctz(v);
+#elif defined(_MSC_VER)
+	unsigned long n;
+	_BitScanForward(&n, v);
+	return (int)n;
+#else
+	int n = 0;
+	while ((v & 1) == 0) {
+		n++;
+		v >>= 1;
+	}
+	return n;
+#endif
+}
+
 LtBitMap::~LtBitMap()
 {
 	semDelete(m_sem);
-	delete bits;
+	delete[] bits;
+	delete[] summary;
 }
 
 boolean LtBitMap::op(int op, int i) {
     int offset = i / 32;
-    int mask = 1 << (i % 32);
-    int cur = bits[offset];
+    unsigned int mask = 1u << (i % 32);
+    unsigned int cur = bits[offset];
     boolean val = (cur & mask) == mask;
     switch (op) {
         case OP_SET:
             // Set
             if (!val) {
                 bits[offset] = cur | mask;
+				summary[offset / 32] |= 1u << (offset % 32);
                 count++;
+				if (count > peakCount) {
+					peakCount = count;
+				}
                 if (curPos == -1) {
                     curPos = i;
                 }
@@ -57,6 +85,9 @@ boolean LtBitMap::op(int op, int i) {
             // Clear
             if (val) {
                 bits[offset] = cur & ~mask;
+				if (bits[offset] == 0) {
+					summary[offset / 32] &= ~(1u << (offset % 32));
+				}
                 count--;
             }
             break;
@@ -79,15 +110,20 @@ boolean LtBitMap::opSafe(int oper, int i) {
 LtBitMap::LtBitMap() {
 	m_sem = semMCreate( SEM_Q_PRIORITY | SEM_INVERSION_SAFE );
 	bits = null;
+	summary = null;
     curPos = -1;
     count = 0;
+	peakCount = 0;
 }
 
 void LtBitMap::setSize(int cnt) {
 	bitsLength = (cnt - 1) / 32 + 1;
+	summaryLength = (bitsLength - 1) / 32 + 1;
     if (cnt != 0) {
-        bits = new int[bitsLength];
-		memset(bits, 0, bitsLength*sizeof(int));		
+        bits = new unsigned int[bitsLength];
+		memset(bits, 0, bitsLength*sizeof(bits[0]));		
+		summary = new unsigned int[summaryLength];
+		memset(summary, 0, summaryLength*sizeof(summary[0]));
     }
 }
 
@@ -103,37 +139,83 @@ boolean LtBitMap::get(int i) {
     return opSafe(3, i);
 }
 
+// Find the first non-zero word at or after word index from, or -1.
+int LtBitMap::findWord(int from) {
+	if (from < bitsLength) {
+		int index = from / 32;
+		unsigned int val = summary[index] & (~0u << (from % 32));
+		while (val == 0) {
+			if (++index == summaryLength) {
+				return -1;
+			}
+			val = summary[index];
+		}
+		return index * 32 + ctz32(val);
+	}
+	return -1;
+}
+
+// Find the first set bit at or after pos, wrapping at the end.  At least
+// one bit must be set.
+int LtBitMap::findNext(int pos) {
+	int index = pos / 32;
+	unsigned int val = bits[index] & (~0u << (pos % 32));
+	if (val == 0) {
+		index = findWord(index + 1);
+		if (index == -1) {
+			index = findWord(0);
+		}
+		val = bits[index];
+	}
+	return index * 32 + ctz32(val);
+}
+
+// Take the bit at curPos and move curPos on to the next set bit.  Must be
+// locked and count must not be 0.
+int LtBitMap::takeNext() {
+	int rtn = curPos;
+	op(OP_CLEAR, rtn);
+	curPos = (count == 0) ? -1 : findNext(rtn);
+	return rtn;
+}
+
 int LtBitMap::getNext() {
     int rtn = -1;
 
 	semTake(m_sem, WAIT_FOREVER);
 
     if (count != 0) {
-        rtn = curPos;
-		op(OP_CLEAR, rtn);
-        // Find next position
-        if (count == 0) {
-            curPos = -1;
-        } else {
-            int index = curPos / 32;
-			int offset = curPos % 32;
-            while ((bits[index] >> offset) == 0) {
-                if (++index == bitsLength) {
-                    index = 0;
-                }
-				offset = 0;
-				curPos = index * 32;
-            }
-            // Found next int with bits set.
-            int val = bits[index] >> offset;
-            while ((val & 1) == 0) {
-                curPos++;
-                val >>= 1;
-            }
-        }
+		rtn = takeNext();
     }
 
 	semGive(m_sem);
 
     return rtn;
 }
+
+int LtBitMap::getNextBatch(int* pVals, int nMax) {
+	int n = 0;
+
+	semTake(m_sem, WAIT_FOREVER);
+
+	while (n < nMax && count != 0) {
+		pVals[n++] = takeNext();
+	}
+
+	semGive(m_sem);
+
+	return n;
+}
+
+int LtBitMap::getPeakCount(boolean bClear) {
+	semTake(m_sem, WAIT_FOREVER);
+
+	int peak = peakCount;
+	if (bClear) {
+		peakCount = count;
+	}
+
+	semGive(m_sem);
+
+	return peak;
+}
@@ -149,16 +149,20 @@ NdNetworkVariable* LtDeviceStack::nvAdded(NdNetworkVariable* pNv)
 		delete pNewNv;
 		pNewNv = pNewerNv;
 	}
+	// Unbound NVs are dispatched using their definition's defaults
+	getNetworkImage()->nvTable.planChange();
 	return (NdNetworkVariable*) pNewNv;
 }
 
 void LtDeviceStack::nvChanged(NdNetworkVariable* pNv, NvChangeType type)
 {
+	getNetworkImage()->nvTable.planChange();
 	lonApp->nvChanged((LtNetworkVariable*) pNv, type);
 }
 
 void LtDeviceStack::nvDeleted(NdNetworkVariable* pNv)
 {
+	getNetworkImage()->nvTable.planChange();
 	// App will delete the object.
 	lonApp->nvDeleted((LtNetworkVariable*) pNv);
 }
@@ -767,7 +771,7 @@ LtMsgOut* LtDeviceStack::msgAllocGen(boolean pri, boolean bForce)
 	LtMsgOut* p = NULL;
     if (adjustBufLimit(pri, true, bForce))
     {
-		p = new NOTHROW LtMsgOut(pri);
+		p = new (pri) LtMsgOut(pri);
 		vxlMemoryCheck(p);
     }
 	return p;
@@ -778,7 +782,7 @@ LtMsgOut* LtDeviceStack::msgAlloc(boolean pri, LtBlob *pBlob)
 	LtMsgOut* p = NULL;
     if (adjustBufLimit(pri, true))
     {
-		p = new NOTHROW LtMsgOut(*pBlob);
+		p = new (pri) LtMsgOut(*pBlob);
 		vxlMemoryCheck(p);
     }
 	return p;
@@ -1045,7 +1049,7 @@ LtErrorType LtDeviceStack::registerApplication(int index, LtApplication* lonApp,
 			{
 				LtUniqueId uid;
 				
-				getPlatform()->getUniqueId(&uid);
+				getPlatform()->getNodeUniqueId(&uid);
 				pClient = new LtUniqueIdClient(this, getChannel(), &uid);
 			}
 			setMainClient(pClient);
@@ -1467,7 +1471,7 @@ void LtDeviceStack::setDirectCallbackMode(boolean value)
     m_bDirectCallbackMode = value;
 }
 
-void LtDeviceStack::processApplicationEvents() 
+boolean LtDeviceStack::processApplicationEvents(int nMaxApdus) 
 {
 	if (m_nPersistenceLost != LT_PERSISTENCE_OK)
 	{
@@ -1508,8 +1512,11 @@ void LtDeviceStack::processApplicationEvents()
     }
 
 	LtApduIn* pApdu;
-    while (!m_bMessageLock && msgQReceive(m_queApdus, (char*) &pApdu, sizeof(pApdu), NO_WAIT) == sizeof(pApdu))
+	int nApdus = 0;
+    while (!m_bMessageLock && (nMaxApdus <= 0 || nApdus < nMaxApdus) &&
+		   msgQReceive(m_queApdus, (char*) &pApdu, sizeof(pApdu), NO_WAIT) == sizeof(pApdu))
 	{
+		nApdus++;
 		LtErrorType err = processApdu(pApdu);
 		if (err != LT_NO_ERROR)
 		{
@@ -1531,6 +1538,7 @@ void LtDeviceStack::processApplicationEvents()
 		}
 	}
 #endif
+	return !m_bMessageLock && incomingActivity();
 }
 
 void LtDeviceStack::release(LtApduOut* pMsg)
@@ -1554,36 +1562,53 @@ void LtDeviceStack::release(LtRespIn* pMsg)
 	delete pMsg;
 }
 
+int LtDeviceStack::getFreeMsgCount(int type)
+{
+    semTake(m_sem, WAIT_FOREVER);
+	int nFree = maxMsg[type] - msgCount[type];
+    semGive(m_sem);
+	return nFree > 0 ? nFree : 0;
+}
+
 void LtDeviceStack::doNvUpdates(int type) 
 {
-    int index;
-	boolean poll;
-	boolean bKeepTrying = true;
+    int indices[NV_UPDATE_BATCH_SIZE];
+	boolean polls[NV_UPDATE_BATCH_SIZE];
+	// Each deferred NV is tried at most once per call.  One that still can't get a
+	// buffer is marked for later update again by propagatePoll.
+	int nPending = nvUpdates[type].getCount();
+	int nFree;
 
-	// Keep trying as long as we encounter bogus NV indices (perhaps left over from an NV deregister).
-	while (bKeepTrying)
+	// Propagate as many deferred NVs as there are free buffers for.  Bogus NV indices
+	// (perhaps left over from an NV deregister) don't use a buffer.
+	while (nPending > 0 && (nFree = getFreeMsgCount(type)) > 0)
 	{
-		index = nvUpdates[type].getNext(poll);
-		if (index != -1) 
+		int n = nvUpdates[type].getNextBatch(indices, polls, 
+											 min(min(nFree, nPending), NV_UPDATE_BATCH_SIZE));
+		if (n == 0)
+		{
+			break;
+		}
+		nPending -= n;
+		for (int i = 0; i < n; i++)
 		{
 			int arrayIndex;
-			LtNetworkVariable* pNv = getNetworkVariable(index, arrayIndex);
+			LtNetworkVariable* pNv = getNetworkVariable(indices[i], arrayIndex);
 
 			if (pNv != null)
 			{
-				bKeepTrying = false;
-				// Don't try again if this fails since we may not have a buffer and we 
-				// don't want to lose updates due to buffer shortage.
-				propagatePoll(poll, pNv, arrayIndex);
+				propagatePoll(polls[i], pNv, arrayIndex);
 			}
 		}
-		else
-		{
-			bKeepTrying = false;
-		}
 	}
 }
 
+void LtDeviceStack::getDeferredNvStats(int type, int &depth, int &peak, boolean bClearPeak)
+{
+	depth = nvUpdates[type].getCount();
+	peak = nvUpdates[type].getPeakCount(bClearPeak);
+}
+
 boolean LtDeviceStack::propagatePoll(boolean poll, int nvIndex)
 {
 	boolean bSuccess = false;
@@ -1603,7 +1628,6 @@ boolean LtDeviceStack::propagatePoll(boolean poll, LtNetworkVariable* pNv, int a
     boolean success = true;
     LtApduOut* pApdu;
 	LtNetworkVariableConfiguration* pNvc;
-    byte data[MAX_NV_LENGTH];
     int len = 0;
 	boolean bPriority = FALSE;
 
@@ -1644,9 +1668,8 @@ boolean LtDeviceStack::propagatePoll(boolean poll, LtNetworkVariable* pNv, int a
     {
 		if (!poll)
 		{
-			len = sizeof(data);
-			pNv->getNvData(data, len, arrayIndex);
-            len = pNv->getCurLength();
+			// The value is copied straight from the NV into the APDU below.
+            len = min(pNv->getCurLength(), pNv->getLength());
 			success = true;
 		} 
 
@@ -1671,7 +1694,7 @@ boolean LtDeviceStack::propagatePoll(boolean poll, LtNetworkVariable* pNv, int a
 				} 
 				else 
 				{
-					if (pApdu->setNvData(data, len) != LT_NO_ERROR)
+					if (pApdu->setNvData(pNv->getNvDataPtr(arrayIndex), len) != LT_NO_ERROR)
 					{
 						// Leave success as true in this case, no point in trying again.
 						release(pMsg);
@@ -1710,6 +1733,27 @@ boolean LtDeviceStack::poll(int nvIndex)
 	return propagatePoll(true, nvIndex);
 }
 
+//
+// Propagate a list of NVs.  Returns the number propagated, stopping at the
+// first one that can't be (for lack of buffers, since only sync NVs can't
+// be deferred, or an invalid index).
+//
+int LtDeviceStack::propagate(const int* pNvIndices, int nCount)
+{
+	int i;
+	for (i = 0; i < nCount; i++)
+	{
+		int arrayIndex;
+		LtNetworkVariable* pNv = getNetworkVariable(pNvIndices[i], arrayIndex);
+
+		if (pNv == null || !propagatePoll(false, pNv, arrayIndex))
+		{
+			break;
+		}
+	}
+	return i;
+}
+
 boolean LtDeviceStack::propagate(LtNetworkVariable* pNv, int arrayIndex, LtMsgOverride* pOverride)
 {
     return propagatePoll(false, pNv, arrayIndex, pOverride);
@@ -2190,7 +2234,7 @@ LtDomainConfiguration* LtDeviceStack::allocDomainConfiguration(int index)
     LtSubnetNodeClient* pClient;
 	LtUniqueId uid;
 
-	getPlatform()->getUniqueId(&uid);
+	getPlatform()->getNodeUniqueId(&uid);
 	if (isNodeStack())
 	{
 		pClient = new LtSubnetNodeClient(this, getChannel(), &uid);
@@ -2055,10 +2055,7 @@ LtErrorType LtLayer4::changeState(int newState, boolean bClearKeys)
 LtErrorType LtLayer4::getReadOnlyData(byte* readOnlyData)
 {
 	int len = getStack()->getReadOnly()->getLength();
-    byte* data;
-	getStack()->getReadOnly()->toLonTalk(0, len, &data);
-    memcpy(readOnlyData, data, len);
-	delete data;
+	getStack()->getReadOnly()->toLonTalk(0, len, readOnlyData);
     return LT_NO_ERROR;
 }
 
@@ -56,51 +56,32 @@ LtErrorType LtLayer6::privateNvFetchResponse(LtApduIn* pApdu, boolean &valid)
 	return err;
 }
 
-boolean LtLayer6::sourceAddressMatch(LtNetworkVariableConfiguration* pNvc, LtApduIn* pApdu)
+boolean LtLayer6::sourceAddressMatch(LtNvDispatchTarget* pTarget, LtApduIn* pApdu)
 {
-	int addressIndex = pNvc->getAddressTableIndex();
-	LtAddressConfiguration ac;
-	LtAddressConfiguration* pAc = null;
 	boolean bMatch = false;
 
-	if (addressIndex == -1)
+	switch (pTarget->addressType)
 	{
-		// Private NVs have address stored inside it.
-		pAc = pNvc->getAddress();				
-	}
-	
-	if (pAc == null)
-	{
-		if (getStack()->getAddressConfiguration(addressIndex, &ac) == LT_NO_ERROR)
-		{
-			pAc = &ac;
-		}
-	}
-	if (pAc != null)
-	{
-		switch (pAc->getAddressType())
-		{
-			case LT_AT_TURNAROUND_ONLY:
-				bMatch = pApdu->getAddressFormat() == LT_AF_TURNAROUND;
-				break;
-			case LT_AT_SUBNET_NODE:
-				bMatch = pAc->getDestId() == pApdu->getDomainConfiguration().getNode() &&
-						 pAc->getSubnet() == pApdu->getDomainConfiguration().getSubnet();
-				break;
-			case LT_AT_GROUP:
-				bMatch = pApdu->getAddressFormat() == LT_AF_GROUP &&
-						 pAc->getDestId() == pApdu->getGroup();
-				break;
-			case LT_AT_BROADCAST:
-				bMatch = pAc->getSubnet() == 0 ||
-						 pAc->getSubnet() == pApdu->getDomainConfiguration().getSubnet();
-				break;
-		}
+		case LT_AT_TURNAROUND_ONLY:
+			bMatch = pApdu->getAddressFormat() == LT_AF_TURNAROUND;
+			break;
+		case LT_AT_SUBNET_NODE:
+			bMatch = pTarget->destId == pApdu->getDomainConfiguration().getNode() &&
+					 pTarget->subnet == pApdu->getDomainConfiguration().getSubnet();
+			break;
+		case LT_AT_GROUP:
+			bMatch = pApdu->getAddressFormat() == LT_AF_GROUP &&
+					 pTarget->destId == pApdu->getGroup();
+			break;
+		case LT_AT_BROADCAST:
+			bMatch = pTarget->subnet == 0 ||
+					 pTarget->subnet == pApdu->getDomainConfiguration().getSubnet();
+			break;
 	}
 	if (bMatch)
 	{
 		// Domain indices can be compared since a node can only be in a given domain once.
-		bMatch = pAc->getDomainIndex() == pApdu->getDomainConfiguration().getIndex();
+		bMatch = pTarget->domainIndex == pApdu->getDomainConfiguration().getIndex();
 	}
 
 	return bMatch;
@@ -150,86 +131,65 @@ LtErrorType LtLayer6::incomingNetworkVariable(LtApduIn* pApdu, boolean &valid)
 
 	if (err == LT_NO_ERROR)
 	{
-		int index = -1;
+		int index;
 		boolean bGenFailure = false;
 
-        // Have to lock while searching.  Otherwise another thread could start rebuilding the
-        // selector table while we are in the process of searching it. Have to lock outside
-        // of the the "get", since indicies are not guaranteed over rehashing.
+        // Have to lock while using the dispatch plan.  Otherwise another thread could change
+        // the NV table and rebuild the plan while we are in the process of walking it.
         getStack()->getNetworkImage()->nvTable.lock();
-		while (bFindOthers)
+		LtNvDispatchPlan* pPlan = bFindOthers ? 
+			getStack()->getNetworkImage()->nvTable.getDispatchPlan(selector, bOutput) : NULL;
+		int count = pPlan != NULL ? pPlan->count : 0;
+		int mode;
+		if (pApdu->getResponse())
+		{
+			mode = NV_DISPATCH_RESPONSE;
+		}
+		else if (pApdu->isRequest())
+		{
+			mode = NV_DISPATCH_REQUEST;
+		}
+		else
+		{
+			mode = NV_DISPATCH_UPDATE;
+		}
+		for (index = 0; index < count; index++)
 		{ 
-            LtNetworkVariableConfiguration nvc;
-			if (getStack()->getNetworkImage()->nvTable.get(index, selector, bOutput, nvc) == LT_NO_ERROR)
+			LtNvDispatchTarget* pTarget = &pPlan->pTargets[index];
+
+			// Validate authentication
+			if (!pApdu->getResponse() && pTarget->authenticated && !pApdu->getAuthenticated()) 
 			{
-				// Validate authentication
-				if (!pApdu->getResponse() && nvc.getAuthenticated() && !pApdu->getAuthenticated()) 
-				{
-					bGenFailure = true;
-					err = LT_AUTHENTICATION_MISMATCH;
-				}
-				// Validate direction.  Updates for outputs are allowed if the
-				// update is a poll response.
-				else if (nvc.getOutput() && !valid && !pApdu->getResponse()) 
+				bGenFailure = true;
+				err = LT_AUTHENTICATION_MISMATCH;
+			}
+			// Validate direction.  Updates for outputs are allowed if the
+			// update is a poll response.
+			else if (pTarget->output && !valid && !pApdu->getResponse()) 
+			{
+				err = LT_NV_UPDATE_ON_OUTPUT_NV;
+			}
+			else 
+			{
+				boolean bAdd = false;
+				switch (pTarget->selection[mode])
 				{
-					err = LT_NV_UPDATE_ON_OUTPUT_NV;
+					case LT_SELECTION_UNCONDITIONAL:
+						bAdd = true;
+						break;
+					case LT_SELECTION_BYSOURCE:
+						bAdd = sourceAddressMatch(pTarget, pApdu);
+						break;
 				}
-				else 
+				if (bAdd)
 				{
-					boolean bAdd = false;
-					int selection;
-					if (pApdu->getResponse())
+					pApdu->addNvIndex(pTarget->primary, pTarget->incarnation);
+					if (pApdu->getServiceType() == LT_REQUEST)
 					{
-						selection = nvc.getNvResponseSelection();
+						// Only need first target for request
+						break;
 					}
-					else if (pApdu->isRequest())
-					{
-						selection = nvc.getNvRequestSelection();
-					}
-					else
-					{
-						selection = nvc.getNvUpdateSelection();
-					}
-					switch (selection)
-					{
-						case LT_SELECTION_UNCONDITIONAL:
-							bAdd = true;
-							break;
-						case LT_SELECTION_BYSOURCE:
-							bAdd = sourceAddressMatch(&nvc, pApdu);
-							break;
-					}
-					if (bAdd)
-					{
-                        int incarnation;
-                        if (nvc.isAlias())
-                        {
-                            LtNetworkVariableConfiguration primaryNvc;
-                            getStack()->getNetworkImage()->nvTable.get(nvc.getPrimary(), &primaryNvc);
-                            incarnation = primaryNvc.getIncarnationNumber();
-                        }
-                        else
-                        {
-                            incarnation = nvc.getIncarnationNumber();
-                        }
-						pApdu->addNvIndex(nvc.getPrimary(), incarnation);
-						if (pApdu->getServiceType() == LT_REQUEST)
-						{
-							// Only need first target for request
-							break;
-						}
-					}
-				}
-			} 
-			else 
-			{
-				if (pApdu->getNvIndex() == -1)
-				{
-					// No match. 
-					bGenFailure = true;		
-					err = LT_INVALID_PARAMETER;
 				}
-				break;
 			}
 			if (err != LT_NO_ERROR)
 			{
@@ -237,6 +197,12 @@ LtErrorType LtLayer6::incomingNetworkVariable(LtApduIn* pApdu, boolean &valid)
 				err = LT_NO_ERROR;
 			}
 		}
+		if (bFindOthers && index == count && pApdu->getNvIndex() == -1)
+		{
+			// No match. 
+			bGenFailure = true;		
+			err = LT_INVALID_PARAMETER;
+		}
         getStack()->getNetworkImage()->nvTable.unlock(); 
 		if (bGenFailure)
 		{
@@ -39,6 +39,11 @@
 int LtMipApp::s_maxL5MIPTxTransactions = 256;
 int LtMipApp::s_maxL5MIPRxTransactions = MAXIMUM_L5MIP_RECEIVE_TRANSACTIONS;
 
+int LtMipApp::s_maxL5MIPSicbTags = MAXIMUM_L5MIP_SICB_TAGS;
+// Incoming requests the host hasn't responded to within this time are
+// dropped, freeing their tag for new requests.
+int LtMipApp::s_l5MIPTagExpiryMs = 30000;
+
 //
 // Define 16 receive transactions and 32 transmit transactions.  These limits
 // are based on a 4 bit rcvtx field for incoming SICBs and a 4 bit tag
@@ -46,7 +51,8 @@ int LtMipApp::s_maxL5MIPRxTransactions = MAXIMUM_L5MIP_RECEIVE_TRANSACTIONS;
 //
 LtMipApp::LtMipApp(int appIndex, LtLogicalChannel* pChannel, const char *persistencePath, int nAddressTableCount) : 
     LtaBase("L5Mip", 110, 64*1024, pChannel,
-		s_maxL5MIPRxTransactions, s_maxL5MIPTxTransactions)
+		s_maxL5MIPRxTransactions, s_maxL5MIPTxTransactions),
+	m_tags(s_maxL5MIPSicbTags)
 {
 	LtProgramId pid ((byte*)"L5Mip", true);
 
@@ -61,8 +67,7 @@ LtMipApp::LtMipApp(int appIndex, LtLogicalChannel* pChannel, const char *persist
         setPersistencePath(path);
     }
 	setServiceLedImpact(false);
-	memset(&m_msgs, 0, sizeof(m_msgs));
-	m_instance = 0;
+	m_tickLastExpiry = tickGet();
 	m_currentNssMipMode = NSS_TRANSPARENT_MODE;
 	m_bInitialFlushState = true;
 	setMessageOutMaximum(32, 32);
@@ -92,6 +97,7 @@ void LtMipApp::run(void)
 		// but just to be safe we will periodically check for events too.
 		m_signal.wait(msToTicks(1000));
 		processApplicationEvents();
+		expireTags();
 	}
 }
 
@@ -711,51 +717,202 @@ void LtMipApp::sendServicePinMessage(void)
 	}
 }
 
-int LtMipApp::getTag(LtMsgIn* pMsgIn)
+//
+// Tags for incoming requests are kept on two lists threaded through m_msgs.
+// Free tags are on a singly linked list from m_nFree to m_nFreeLast; tags
+// freed by a response go on the front and quarantined ones on the back.
+// Tags awaiting a response from the host are on a doubly linked list in the
+// order they were handed out, so the oldest is always at m_nOldest.  The
+// host's send thread releases tags while the application thread allocates
+// them, hence m_sem.
+//
+LtMipTagTable::LtMipTagTable(int nTags)
 {
-	// Find an open tag.
-	unsigned int maxAge = 0;
-	int oldestTag = 0;
-    int tag = 0;
+	m_nTags = nTags;
+	if (m_nTags < 1 || m_nTags > MAXIMUM_L5MIP_SICB_TAGS)
+	{
+		m_nTags = MAXIMUM_L5MIP_SICB_TAGS;
+	}
+	memset(&m_msgs, 0, sizeof(m_msgs));
+	for (int i = 0; i < m_nTags; i++)
+	{
+		m_msgs[i].m_nNext = i + 1 < m_nTags ? i + 1 : L5MIP_NO_TAG;
+		m_msgs[i].m_nPrev = L5MIP_NO_TAG;
+	}
+	m_nFree = 0;
+	m_nFreeLast = m_nTags - 1;
+	m_nOldest = m_nNewest = L5MIP_NO_TAG;
+	m_sem = semMCreate(SEM_Q_PRIORITY | SEM_INVERSION_SAFE);
+	m_nEvictions = 0;
+	m_nExpirations = 0;
+	m_nLateResponses = 0;
+}
 
-	if (pMsgIn->getServiceType() == LT_REQUEST)
+LtMipTagTable::~LtMipTagTable()
+{
+	while (m_nOldest != L5MIP_NO_TAG)
+	{
+		int tag = m_nOldest;
+		delete m_msgs[tag].m_pMsgIn;
+		freeTag(tag, false);
+	}
+	semDelete(m_sem);
+}
+
+void LtMipTagTable::unlinkTag(int tag)
+{
+	LtMsgInLog& log = m_msgs[tag];
+	if (log.m_nPrev == L5MIP_NO_TAG)
+	{
+		m_nOldest = log.m_nNext;
+	}
+	else
+	{
+		m_msgs[log.m_nPrev].m_nNext = log.m_nNext;
+	}
+	if (log.m_nNext == L5MIP_NO_TAG)
+	{
+		m_nNewest = log.m_nPrev;
+	}
+	else
+	{
+		m_msgs[log.m_nNext].m_nPrev = log.m_nPrev;
+	}
+}
+
+void LtMipTagTable::freeTag(int tag, boolean bQuarantine)
+{
+	LtMsgInLog& log = m_msgs[tag];
+
+	unlinkTag(tag);
+	log.m_pMsgIn = NULL;
+	log.m_nPrev = L5MIP_NO_TAG;
+	if (m_nFree == L5MIP_NO_TAG)
+	{
+		log.m_nNext = L5MIP_NO_TAG;
+		m_nFree = m_nFreeLast = tag;
+	}
+	else if (bQuarantine)
+	{
+		log.m_nNext = L5MIP_NO_TAG;
+		m_msgs[m_nFreeLast].m_nNext = tag;
+		m_nFreeLast = tag;
+	}
+	else
+	{
+		log.m_nNext = m_nFree;
+		m_nFree = tag;
+	}
+}
+
+int LtMipTagTable::allocate(LtMsgIn* pMsgIn, ULONG now)
+{
+	int tag;
+
+	semTake(m_sem, WAIT_FOREVER);
+	if (m_nFree == L5MIP_NO_TAG)
+	{
+		// There was no room!  This can happen if the application doesn't respond
+		// to requests faster than they expire.  In this case we reuse the oldest one
+		// at once; there is no other free tag to hand out, so it can't be quarantined.
+		tag = m_nOldest;
+		delete m_msgs[tag].m_pMsgIn;
+		freeTag(tag, false);
+		m_nEvictions++;
+	}
+	tag = m_nFree;
+	m_nFree = m_msgs[tag].m_nNext;
+	if (m_nFree == L5MIP_NO_TAG)
 	{
-		for (tag = 0; tag < MAXIMUM_L5MIP_SICB_TAGS; tag++)
+		m_nFreeLast = L5MIP_NO_TAG;
+	}
+
+	LtMsgInLog& log = m_msgs[tag];
+	log.m_pMsgIn = pMsgIn;
+	log.m_tickStart = now;
+	log.m_nPrev = m_nNewest;
+	log.m_nNext = L5MIP_NO_TAG;
+	if (m_nNewest == L5MIP_NO_TAG)
+	{
+		m_nOldest = tag;
+	}
+	else
+	{
+		m_msgs[m_nNewest].m_nNext = tag;
+	}
+	m_nNewest = tag;
+	semGive(m_sem);
+	return tag;
+}
+
+LtMsgIn* LtMipTagTable::release(int tag)
+{
+	LtMsgIn* pMsgIn = NULL;
+	if (tag >= 0 && tag < m_nTags)
+	{
+		semTake(m_sem, WAIT_FOREVER);
+		pMsgIn = m_msgs[tag].m_pMsgIn;
+		if (pMsgIn != NULL)
 		{
-			// Unsigned math yields correct age even in case of instance wrap.
-			unsigned int age = m_instance - m_msgs[tag].m_instance;
-			if (m_msgs[tag].m_pMsgIn == NULL)
-			{
-				break;
-			}
-			else if (age > maxAge)
-			{
-				oldestTag = tag;
-				maxAge = age;
-			}
+			freeTag(tag, false);
 		}
-		if (tag == MAXIMUM_L5MIP_SICB_TAGS)
+		else
 		{
-			// There was no room!  This can happen if the application doesn't respond
-			// to requests.  It shouldn't be doing this but if it does we eventually
-			// run out of space.  In this case we just use the oldest one.  OK, granted
-			// in the pathological case of wrapping through the entire instance space
-			// we may not strictly get the oldest one.  But this would only happen if 
-			// failure to respond is extremely rare in which case any slot will do anyway.
-			tag = oldestTag;
-			delete m_msgs[tag].m_pMsgIn;
+			m_nLateResponses++;
 		}
-		m_msgs[tag].m_pMsgIn = pMsgIn;
-		m_msgs[tag].m_instance = m_instance++;
+		semGive(m_sem);
+	}
+	return pMsgIn;
+}
+
+//
+// Since the in-use list is in age order we only ever look at the expired
+// entries plus one.
+//
+void LtMipTagTable::expire(ULONG now, ULONG limit)
+{
+	semTake(m_sem, WAIT_FOREVER);
+	while (m_nOldest != L5MIP_NO_TAG &&
+		   now - m_msgs[m_nOldest].m_tickStart > limit)
+	{
+		int tag = m_nOldest;
+		delete m_msgs[tag].m_pMsgIn;
+		freeTag(tag, true);
+		m_nExpirations++;
+	}
+	semGive(m_sem);
+}
+
+int LtMipApp::getTag(LtMsgIn* pMsgIn)
+{
+    int tag = 0;
+
+	if (pMsgIn->getServiceType() == LT_REQUEST)
+	{
+		tag = m_tags.allocate(pMsgIn, tickGet());
 	}
 	return tag;
 }
 
 LtMsgIn* LtMipApp::getMsgIn(int tag)
 {
-	LtMsgIn* pMsgIn = m_msgs[tag].m_pMsgIn;
-	m_msgs[tag].m_pMsgIn = NULL;
-	return pMsgIn;
+	return m_tags.release(tag);
+}
+
+//
+// expireTags
+//
+// Called periodically from the application task.  Drops requests which the
+// host has held on to for longer than s_l5MIPTagExpiryMs.
+//
+void LtMipApp::expireTags()
+{
+	ULONG now = tickGet();
+	if (s_l5MIPTagExpiryMs > 0 && now - m_tickLastExpiry >= (ULONG)msToTicks(1000))
+	{
+		m_tickLastExpiry = now;
+		m_tags.expire(now, msToTicks(s_l5MIPTagExpiryMs));
+	}
 }
 
 //#define TEST_MIP_APP
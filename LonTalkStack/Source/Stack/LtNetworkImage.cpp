@@ -31,12 +31,19 @@
 #include "max_api.h"
 #endif
 
+#ifdef WIN32
+#define CHANGE_COUNT_BUMP(n)	InterlockedIncrement(&(n))
+#else
+#define CHANGE_COUNT_BUMP(n)	__sync_add_and_fetch(&(n), 1)
+#endif
+
 LtNetworkImage::LtNetworkImage(LtDeviceStack* pStack) : m_persistence(CURRENT_NETIMG_VER), aliasTable(nvTable)
 {
 	setStack(pStack);
     m_nState = LT_UNCONFIGURED;
 	m_bBlackout = false;
 	m_bHasBeenEcsChanged = false;
+	m_nChangeCount = 0;
 	m_persistence.registerPersistenceClient(this);
 #if PERSISTENCE_TYPE_IS(FTXL)
     m_persistence.setType(LonNvdSegNetworkImage);
@@ -58,6 +65,7 @@ LtNetworkImage::~LtNetworkImage()
 boolean LtNetworkImage::store(boolean bRecompute)
 {
 	m_persistence.setSuppressChecksumCalculation(!bRecompute);
+	CHANGE_COUNT_BUMP(m_nChangeCount);
 
 	// For now, only support implicit commit
 	return m_persistence.schedule();
@@ -247,6 +255,7 @@ LtPersistenceLossReason LtNetworkImage::deserialize(byte* pImage, int len, int n
 		    }
 	    }
     }
+	CHANGE_COUNT_BUMP(m_nChangeCount);
 	return reason;
 }
 
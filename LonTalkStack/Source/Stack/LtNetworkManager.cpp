@@ -29,6 +29,13 @@
 #include "LonLink.h"
 #include "VxLayer.h"
 
+#ifdef WIN32
+#define LANE_PENDING_INC(n)		InterlockedIncrement(&(n))
+#define LANE_PENDING_DEC(n)		InterlockedDecrement(&(n))
+#else
+#define LANE_PENDING_INC(n)		__sync_add_and_fetch(&(n), 1)
+#define LANE_PENDING_DEC(n)		__sync_sub_and_fetch(&(n), 1)
+#endif
 
 //
 // Private Member Functions
@@ -42,6 +49,13 @@ int VXLCDECL LtNetworkManager::start( int nm, ... )
 	return 0;
 }
 
+int VXLCDECL LtNetworkManager::startReadOnly( int nm, ... )
+{
+	LtNetworkManager* pNm = (LtNetworkManager*) nm;
+	pNm->runReadOnly();
+	return 0;
+}
+
 NmErrCode LtNetworkManager::toNmErr(LtErrorType err)
 {
 	switch (err)
@@ -139,23 +153,36 @@ int LtNetworkManager::convertAddress(byte data[], int offset)
     return LtMisc::makeint(data[offset + 1], data[offset + 2]);
 }
 
-LtErrorType LtNetworkManager::readMemory(byte data[], int& length, byte** ppResult) 
+//
+// readMemory
+//
+// Reads are formatted straight into "result", which is normally the data
+// area of the response APDU, so that polling tools don't cost a heap
+// allocation per read.  "maxLength" is the room available there.
+//
+LtErrorType LtNetworkManager::readMemory(byte data[], int& length, byte* result, int maxLength) 
 {
 	LtErrorType err = LT_NO_ERROR;
     int address = convertAddress(data, 0);
     length = data[3];
-    byte* result = null;
+
+	if (length > maxLength)
+	{
+		return LT_INVALID_PARAMETER;
+	}
 
     switch (data[0]) 
 	{
 		case LT_READ_ONLY_RELATIVE:
-			err = getStack()->getReadOnly()->toLonTalk(address, length, &result);
+			err = getStack()->getReadOnly()->toLonTalk(address, length, result);
 			break;
 		case LT_CONFIG_RELATIVE:
-			result = getStack()->getNetworkImage()->configData.toLonTalk(address, length);
+			// Out of range reads return zeros.
+			memset(result, 0, length);
+			getStack()->getNetworkImage()->configData.toLonTalk(result, address, length);
 			break;
 		case LT_STATS_RELATIVE:
-			err = getStack()->getNetworkStats()->toLonTalk(&result, address, length);
+			err = getStack()->getNetworkStats()->toLonTalk(result, address, length);
 			break;
 		case LT_ABSOLUTE:
 			// Following are supported:
@@ -167,7 +194,6 @@ LtErrorType LtNetworkManager::readMemory(byte data[], int& length, byte** ppResu
 			//     app mem and other mem).
 			if (address == 0 && length == 1) 
 			{
-				result = new byte[1];
 				result[0] = (byte) LT_SYSTEM_VERSION;
 			}
 			else if (appMemCheck(address, length)) 
@@ -187,7 +213,6 @@ LtErrorType LtNetworkManager::readMemory(byte data[], int& length, byte** ppResu
 			}
 			else
 			{
-				result = new byte[length];
 				memset(result, 0, length);
 			}
 #endif
@@ -198,7 +223,6 @@ LtErrorType LtNetworkManager::readMemory(byte data[], int& length, byte** ppResu
 			break;
 		}
     }
-	*ppResult = result;
 	return err;
 }
 
@@ -268,8 +292,8 @@ LtErrorType LtNetworkManager::processQueryId(LtApdu& apdu, LtApdu& response)
 			{
 				// Proper data format.  Check for memory match
 				int len;
-				byte* mem;
-				err = readMemory(apdu.getData() + 1, len, &mem);
+				byte mem[256];		// The read length is one byte
+				err = readMemory(apdu.getData() + 1, len, mem, sizeof(mem));
 				if (err == LT_NO_ERROR)
 				{
 					for (int i = 0; i < len; i++) 
@@ -280,7 +304,6 @@ LtErrorType LtNetworkManager::processQueryId(LtApdu& apdu, LtApdu& response)
 							break;
 						}
 					}
-					delete mem;
 				}
 			}
 		}
@@ -940,18 +963,16 @@ LtErrorType LtNetworkManager::processReadMemory(LtApdu& apdu, LtApdu& response)
     LtErrorType err = validate(apdu, 4, 19);
 	if (err == LT_NO_ERROR)
 	{
-		byte* data;
-	    err = readMemory(apdu.getData(), len, &data);
+	    err = readMemory(apdu.getData(), len, response.getData(), MAX_APDU_SIZE - 1);
 		if (err == LT_NO_ERROR)
 		{
-			response.setData(data, 0, len);
-			delete data;
+			response.setLength(len);
 		}
 	}
 	return err;
 }
 
-LtErrorType LtNetworkManager::processWriteMemory(LtApdu& apdu) 
+LtErrorType LtNetworkManager::processWriteMemory(LtApdu& apdu, boolean& store, boolean& storeRecompute) 
 {
     LtErrorType err = validate(apdu,5,237);
 	if (err == LT_NO_ERROR)
@@ -980,7 +1001,7 @@ LtErrorType LtNetworkManager::processWriteMemory(LtApdu& apdu)
 						getStack()->getReadOnly()->setPendingUpdate(TRUE);
 						// Cause persistent update of network image for updates to the program ID,
 						// which is stored in both the network image and the read-only data image.
-						getStack()->getNetworkImage()->store();
+						store = TRUE;
 					}
 					break;
 				case LT_CONFIG_RELATIVE:
@@ -988,10 +1009,9 @@ LtErrorType LtNetworkManager::processWriteMemory(LtApdu& apdu)
 					// Because some configuration changes affect the LRE (notably, router
 					// mode), we update the LRE on any write.
 					getStack()->routerModeChange();
-		            if (!getStack()->getNetworkImage()->store(recompute))
-		            {
-			            err = LT_EEPROM_WRITE_FAILURE;
-		            }
+					store = TRUE;
+					// Only config relative writes let the tool defer the checksum.
+					storeRecompute = recompute;
 					break;
 				case LT_STATS_RELATIVE:
 					err = getStack()->getNetworkStats()->fromLonTalk(apdu.getData() + 5, offset, length);
@@ -1047,12 +1067,10 @@ LtErrorType LtNetworkManager::processQueryStatus(LtApdu& apdu, LtApdu& response,
 	if (err == LT_NO_ERROR)
 	{
 		// Return first five stats
-		byte* pStats;
-		err = getStack()->getNetworkStats()->toLonTalk(&pStats, 0, 10);
+		err = getStack()->getNetworkStats()->toLonTalk(response.getData(), 0, 10);
 		if (err == LT_NO_ERROR)
 		{
-			response.setData(pStats, 0, 10);
-			delete pStats;
+			response.setLength(10);
 			response.setData(10, (byte) getStack()->getResetCause());
 			response.setData(11, (byte) getStack()->getModeAndState());
 			response.setData(12, (byte) LT_VERSION);
@@ -1226,20 +1244,35 @@ LtNetworkManager::LtNetworkManager()
 
     respondToQuery = false;
     processing = false;
+    processingRead = false;
+	m_nOrderedPending = 0;
 	for (int i = 0; i < CONFIG_ENTITIES_SIZE; i++)
 	{
 		m_configEntities[i] = NULL;
 	}
+	m_semProcess = semMCreate(SEM_Q_PRIORITY | SEM_INVERSION_SAFE);
 	m_queApdus = msgQCreate(10, sizeof(LtApdu*), MSG_Q_FIFO);
 	m_taskId = 	vxlTaskSpawn("NetworkMgr", 
                           LT_NETWORK_MGR_TASK_PRIORITY, 0, 
                           LT_NETWORK_MGR_TASK_STACK_SIZE, start,
 				 (int)this, 0,0,0,0, 0,0,0,0,0);
 	registerTask(m_taskId, m_queApdus, NULL);
+
+	// Read-only requests get a lane of their own so that queries issued
+	// during commissioning don't sit behind a backlog of writes.
+	m_queReadApdus = msgQCreate(10, sizeof(LtApdu*), MSG_Q_FIFO);
+	m_taskIdRead = vxlTaskSpawn("NetworkMgrRd", 
+                          LT_NETWORK_MGR_TASK_PRIORITY, 0, 
+                          LT_NETWORK_MGR_TASK_STACK_SIZE, startReadOnly,
+				 (int)this, 0,0,0,0, 0,0,0,0,0);
+	registerTask(m_taskIdRead, m_queReadApdus, NULL);
 }
 
 LtNetworkManager::~LtNetworkManager()
 {
+	// Both lanes use m_semProcess so they must be gone before it is.
+	waitForTasksToShutdown();
+	semDelete(m_semProcess);
 	m_vecDmAddrs.clear(true);
 }
 
@@ -1248,15 +1281,55 @@ void LtNetworkManager::shutdown()
 	waitForTasksToShutdown();
 }
 
+//
+// isReadOnlyCommand
+//
+// Returns true if the request doesn't change the network image.  Commands
+// that may be passed up to the application stay on the ordered lane.
+//
+boolean LtNetworkManager::isReadOnlyCommand(LtApduIn& apdu)
+{
+	return apdu.isRequest() &&
+		   isReadOnlyRequest(apdu.getCode(), apdu.getData(), apdu.getDataLength(), getStack()->isMip());
+}
+
 void LtNetworkManager::deliver(LtApduIn* pApdu)
 {
-    // Add apdu to the queue and schedule the network manager
-	msgQSend(m_queApdus, (char*) &pApdu, sizeof(pApdu), WAIT_FOREVER, MSG_PRI_NORMAL);
+    // Add apdu to the appropriate queue and schedule the network manager.
+	// A read-only command only takes the other lane when the ordered lane
+	// has nothing left to run.  Layer 4 acknowledges a write before it gets
+	// here, so a tool may follow it with a query at once, and the query
+	// must not overtake it and return stale data.
+	MSG_Q_ID que;
+	if (isReadOnlyCommand(*pApdu) && m_nOrderedPending == 0)
+	{
+		que = m_queReadApdus;
+	}
+	else
+	{
+		que = m_queApdus;
+		LANE_PENDING_INC(m_nOrderedPending);
+	}
+	msgQSend(que, (char*) &pApdu, sizeof(pApdu), WAIT_FOREVER, MSG_PRI_NORMAL);
 }
 
 boolean LtNetworkManager::isBusy() 
 {
-    return processing;
+    return processing || processingRead;
+}
+
+void LtNetworkManager::handle(LtApduIn* pApdu, boolean& bProcessing)
+{
+	bProcessing = true;
+	if (process(*pApdu) == LT_APP_MESSAGE)
+	{
+		getStack()->LtDeviceStack::receive(pApdu);
+	}
+	else
+	{
+		getStack()->release((LtMsgIn*)pApdu);
+	}
+	bProcessing = false;
 }
 
 void LtNetworkManager::run() 
@@ -1267,23 +1340,27 @@ void LtNetworkManager::run()
         while (msgQReceive(m_queApdus, (char*) &pApdu, sizeof(pApdu), WAIT_FOREVER) == sizeof(pApdu))
 		{
 			if (taskShutdown()) break;
-
-            // Process the apdu
-			processing = true;
-            if (process(*pApdu) == LT_APP_MESSAGE)
-			{
-		        getStack()->LtDeviceStack::receive(pApdu);
-			}
-			else
-			{
-				getStack()->release((LtMsgIn*)pApdu);
-			}
-			processing = false;
+			handle(pApdu, processing);
+			LANE_PENDING_DEC(m_nOrderedPending);
         }
     }
 	msgQDelete(m_queApdus);
 }
 
+void LtNetworkManager::runReadOnly() 
+{
+    while (!taskShutdown())
+	{
+        LtApduIn* pApdu;
+        while (msgQReceive(m_queReadApdus, (char*) &pApdu, sizeof(pApdu), WAIT_FOREVER) == sizeof(pApdu))
+		{
+			if (taskShutdown()) break;
+			handle(pApdu, processingRead);
+        }
+    }
+	msgQDelete(m_queReadApdus);
+}
+
 LtErrorType LtNetworkManager::processSetRouterMode(LtApdu& apdu)
 {
 	LtErrorType err = validateRouterCommand(apdu, 1);
@@ -1563,6 +1640,16 @@ LtErrorType LtNetworkManager::process(LtApduIn& apdu)
 
 	boolean bModifyingCommand = bModifyingEcsCommand || bModifyingLegacyCommand || bModifyingExpCommand;
     boolean store = bModifyingLegacyCommand;
+	boolean recompute = TRUE;
+
+	// The two lanes only exclude each other while a command executes, so
+	// a query waits for at most one write rather than for the whole write
+	// queue.  Proxies wait on a far node and don't touch our image.
+	boolean bLock = code != LT_PROXY;
+	if (bLock)
+	{
+		semTake(m_semProcess, WAIT_FOREVER);
+	}
 
 	// Check for NM lock out due to persistent data loss.  This is a lame
 	// attempt to sync up the node with the network manager after a reset
@@ -1705,9 +1792,9 @@ LtErrorType LtNetworkManager::process(LtApduIn& apdu)
 			err = processReadMemory(apdu, response);
 			break;
 		case LT_WRITE_MEMORY:
-            store = FALSE;  // Let processWriteMemory do the store, so it can 
+            store = FALSE;  // Let processWriteMemory decide on the store, so it can 
                             // control whether checksum is recalculated or not.
-			err = processWriteMemory(apdu);
+			err = processWriteMemory(apdu, store, recompute);
 			break;
 		case LT_MEMORY_REFRESH:
 			err = processMemoryRefresh(apdu);
@@ -1786,9 +1873,18 @@ LtErrorType LtNetworkManager::process(LtApduIn& apdu)
 		}
     }
 
+	if (bLock)
+	{
+		semGive(m_semProcess);
+	}
+
+	// Schedule the write of the image after releasing the lane lock.  Scheduling
+	// can enter an NVD transaction, which waits for the NVD mutex and touches
+	// the file system, and the other lane shouldn't wait for that.  The
+	// image itself was already updated under the lock.
 	if (store && err == LT_NO_ERROR) 
 	{
-		if (!getStack()->getNetworkImage()->store())
+		if (!getStack()->getNetworkImage()->store(recompute))
 		{
 			err = LT_EEPROM_WRITE_FAILURE;
 		}
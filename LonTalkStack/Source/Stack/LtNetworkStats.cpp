@@ -42,34 +42,56 @@
 //
 
 
-LtNetworkStats::LtNetworkStats(LtLink* d, LtLreServer* pLre) {
+LtNetworkStats::LtNetworkStats(LtLink* d, LtLreServer* pLre) : m_counters(LT_NUM_STATS) {
 	m_pLre = pLre;
     drv = d;
+    m_tickLinkCache = 0;
+    m_bLinkCacheValid = false;
+    m_semLinkCache = semMCreate(SEM_Q_PRIORITY | SEM_INVERSION_SAFE);
     reset();
 }
 
+LtNetworkStats::~LtNetworkStats() {
+    semDelete(m_semLinkCache);
+}
+
+// Counts are kept per thread, so this is a plain add.  The 0xffff cap is
+// applied when the LonTalk view is built.
 void LtNetworkStats::bump(int index) {
-    if (netStats[index] < 0xffff) {
-        netStats[index]++;
-    }
+    m_counters.bump(index);
 }
 
+// A single statistic reads just its own count, or the one value it needs
+// from the link cache, rather than building a whole snapshot.
 int LtNetworkStats::get(int index) {
-    return netStats[index];
+    ULONGLONG value;
+    int linkIndex = getLinkIndex(index);
+    if (linkIndex >= 0)
+    {
+        semTake(m_semLinkCache, WAIT_FOREVER);
+        refreshLinkCache();
+        value = m_linkCache.m_shadow[linkIndex];
+        semGive(m_semLinkCache);
+    }
+    else
+    {
+        value = index == LT_EEPROM_LOCK ? (ULONGLONG)m_nEepromLock : m_counters.get(index);
+    }
+    return (int)min(value, (ULONGLONG)0xffff);
 }
 
 boolean LtNetworkStats::getEepromLock() {
-    return (netStats[LT_EEPROM_LOCK] & 0xff00) != 0;
+    return (m_nEepromLock & 0xff00) != 0;
 }
 
 void LtNetworkStats::setEepromLock(boolean l) {
-    netStats[LT_EEPROM_LOCK] = l ? 0xffff : 0;
+    m_nEepromLock = l ? 0xffff : 0;
 }
 
 void LtNetworkStats::reset() {
-    for (int i=0; i<LT_NUM_STATS; i++) {
-        netStats[i] = 0;
-    }
+    m_counters.clear();
+    m_nEepromLock = 0;
+    m_bLinkCacheValid = false;
 	if (drv != null)
 	{
 		// If the stats are shadowed, clear only the shadowed part (leave real link stats alone)
@@ -89,37 +111,106 @@ void LtNetworkStats::reset() {
 LtErrorType LtNetworkStats::validate(int offset, int length) 
 {
 	LtErrorType err = LT_NO_ERROR;
-    if ((offset+length)/2 > LT_NUM_STATS) 
+    if (offset < 0 || length < 0 || offset+length > LT_NUM_STATS*2) 
 	{
         err = LT_INVALID_PARAMETER;
     }
 	return err;
 }
 
-#define CAPSTAT(stat) min(0xffff,stat)
-void LtNetworkStats::refresh()
+//
+// getLinkIndex
+//
+// Return the link statistic a statistic comes from, or -1 if we count it.
+//
+int LtNetworkStats::getLinkIndex(int index)
 {
-	// Refresh beginning portion of stats from driver.
-	LtLinkStats *pLS;
-	drv->getStatistics(pLS);
-	if ((pLS != NULL) && (pLS->m_shadowed))
+	switch (index)
 	{
-		LtLinkStatsShadow *pShadow = static_cast<LtLinkStatsShadow *>(pLS);
-		netStats[LT_TRANSMISSION_ERRORS] = CAPSTAT(pShadow->m_nTransmissionErrorsShadow);
-		netStats[LT_MISSED_MESSAGES] = CAPSTAT(pShadow->m_nMissedPacketsShadow);
-		netStats[LT_BACKLOG_OVERFLOW] = CAPSTAT(pShadow->m_nBacklogOverflowsShadow);
-		netStats[LT_COLLISIONS] = CAPSTAT(pShadow->m_nCollisionsShadow);
+	case LT_TRANSMISSION_ERRORS:	return LT_LINK_STAT_TRANSMISSION_ERRORS;
+	case LT_MISSED_MESSAGES:		return LT_LINK_STAT_MISSED_PACKETS;
+	case LT_BACKLOG_OVERFLOW:		return LT_LINK_STAT_BACKLOG_OVERFLOWS;
+	case LT_COLLISIONS:				return LT_LINK_STAT_COLLISIONS;
+	default:						return -1;
 	}
-	else
+}
+
+//
+// getFull
+//
+// Return one statistic at full width, taking those that come from the link
+// from "link".  These use the shadow counts if the link keeps them, so that
+// clearing ours leaves the driver's alone.
+//
+ULONGLONG LtNetworkStats::getFull(int index, const LtLinkStatsSnapshot& link)
+{
+	int linkIndex = getLinkIndex(index);
+
+	if (linkIndex >= 0)
 	{
-		LtLinkStats ls;
-		drv->getStatistics(ls);
-		netStats[LT_TRANSMISSION_ERRORS] = CAPSTAT(ls.m_nTransmissionErrors);
-		netStats[LT_MISSED_MESSAGES] = CAPSTAT(ls.m_nMissedPackets);
-		netStats[LT_BACKLOG_OVERFLOW] = CAPSTAT(ls.m_nBacklogOverflows);
-		netStats[LT_COLLISIONS] = CAPSTAT(ls.m_nCollisions);
+		return link.m_shadow[linkIndex];
 	}
+	return index == LT_EEPROM_LOCK ? (ULONGLONG)m_nEepromLock : m_counters.get(index);
+}
 
+//
+// refreshLinkCache
+//
+// Fetching the link's statistics may mean a round trip to the driver, so
+// pollers reading the statistics repeatedly get a copy up to
+// LT_LINK_STATS_TTL_MS old.  The caller holds m_semLinkCache.
+//
+void LtNetworkStats::refreshLinkCache()
+{
+	ULONG now = tickGet();
+	if (!m_bLinkCacheValid || now - m_tickLinkCache >= (ULONG)msToTicks(LT_LINK_STATS_TTL_MS))
+	{
+		if (drv != null)
+		{
+			drv->getStatisticsSnapshot(m_linkCache);
+		}
+		else
+		{
+			memset(&m_linkCache, 0, sizeof(m_linkCache));
+		}
+		m_tickLinkCache = now;
+		m_bLinkCacheValid = true;
+	}
+}
+
+void LtNetworkStats::getLinkSnapshot(LtLinkStatsSnapshot& link)
+{
+	semTake(m_semLinkCache, WAIT_FOREVER);
+	refreshLinkCache();
+	link = m_linkCache;
+	semGive(m_semLinkCache);
+}
+
+void LtNetworkStats::snapshot(ULONGLONG values[LT_NUM_STATS])
+{
+	snapshot(values, 0, LT_NUM_STATS);
+}
+
+//
+// snapshot
+//
+// Fill in values[first] to values[first + count - 1] only.  The link's
+// statistics are only fetched if one of them is in the range.
+//
+void LtNetworkStats::snapshot(ULONGLONG values[LT_NUM_STATS], int first, int count)
+{
+	LtLinkStatsSnapshot link;
+	boolean bLink = false;
+
+	for (int i = first; i < first + count; i++)
+	{
+		if (!bLink && getLinkIndex(i) >= 0)
+		{
+			getLinkSnapshot(link);
+			bLink = true;
+		}
+		values[i] = getFull(i, link);
+	}
 }
 
 LtErrorType LtNetworkStats::fromLonTalk(byte data[], int offset, int length) {
@@ -127,14 +218,32 @@ LtErrorType LtNetworkStats::fromLonTalk(byte data[], int offset, int length) {
     
 	if (err == LT_NO_ERROR)
 	{
+		ULONGLONG values[LT_NUM_STATS];
+		snapshot(values);
 		for (int i = offset; i < offset + length; i++) {
-			int value = netStats[i / 2];
+			int value = (int)min(values[i / 2], (ULONGLONG)0xffff);
 			if ((i&1)==1) {
 				value = (value & 0xff) | ((int) data[i] << 8);
 			} else {
 				value = (value & 0xff00) | (((int) data[i]) & 0xff);
 			}
-			netStats[i/2] = value & 0xffff;
+			values[i/2] = value & 0xffff;
+			// The statistics that come from the link can't be written; the
+			// next read takes them from the link again.
+			switch (i/2)
+			{
+			case LT_TRANSMISSION_ERRORS:
+			case LT_MISSED_MESSAGES:
+			case LT_BACKLOG_OVERFLOW:
+			case LT_COLLISIONS:
+				break;
+			case LT_EEPROM_LOCK:
+				m_nEepromLock = value & 0xffff;
+				break;
+			default:
+				m_counters.set(i/2, value & 0xffff);
+				break;
+			}
 		}  
 	}
 	return err;
@@ -145,8 +254,22 @@ LtErrorType LtNetworkStats::toLonTalk(byte** ppData, int offset, int length) {
 	if (err == LT_NO_ERROR)
 	{
 		byte* data = new byte[length];
+		err = toLonTalk(data, offset, length);
+		*ppData = data;
+	}
+    return err;
+}
 
-		refresh();
+LtErrorType LtNetworkStats::toLonTalk(byte* data, int offset, int length) {
+    LtErrorType err = validate(offset, length);
+	if (err == LT_NO_ERROR)
+	{
+		ULONGLONG values[LT_NUM_STATS];
+
+		if (length != 0)
+		{
+			snapshot(values, offset/2, (offset + length - 1)/2 - offset/2 + 1);
+		}
 
 		// Note that the L2 number represents the total packets routed by the
 		// engine not from us.  This includes packets routed on other channels!
@@ -157,10 +280,9 @@ LtErrorType LtNetworkStats::toLonTalk(byte** ppData, int offset, int length) {
 		// packet).  This is non-trivial and not worth the cycles.
 		int index = 0;
 		for (int i = offset; i < offset + length; i++) {
-			int value = netStats[i / 2];
+			int value = (int)min(values[i / 2], (ULONGLONG)0xffff);
 			data[index++] = (byte) (((i & 1) == 1) ? value : (value >> 8));
 		}  
-		*ppData = data;
 	}
     return err;
 }
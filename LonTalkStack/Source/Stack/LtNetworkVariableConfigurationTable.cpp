@@ -35,6 +35,9 @@ LtNetworkVariableConfigurationTable::LtNetworkVariableConfigurationTable()
 	m_nSelectorMapSize = 0;
 	m_nvs = null;
     m_lockedCount = 0;
+	m_plans = null;
+	m_nPlanMask = 0;
+	m_nPlanGeneration = 0;
 }
 
 LtNetworkVariableConfigurationTable::~LtNetworkVariableConfigurationTable()
@@ -45,6 +48,11 @@ LtNetworkVariableConfigurationTable::~LtNetworkVariableConfigurationTable()
     }
     delete m_nvs;
 	delete m_selectorMap;
+	for (int i = 0; m_plans != null && i <= m_nPlanMask; i++)
+	{
+		delete[] m_plans[i].pTargets;
+	}
+	delete[] m_plans;
 }
 
 LtErrorType LtNetworkVariableConfigurationTable::getNvDirSafe(int nvIndex, boolean &bOutput)
@@ -87,8 +95,23 @@ void LtNetworkVariableConfigurationTable::setCounts(int nvCount, int privateCoun
 	{
 		m_selectorMap = new int[m_nSelectorMapSize];
     	memset(m_selectorMap, 0xff, m_nSelectorMapSize*sizeof(m_selectorMap[0]));
+
+		// Dispatch plans are direct mapped by the selector hash
+		int nPlans = 8;
+		while (nPlans < m_nSelectorMapSize)
+		{
+			nPlans <<= 1;
+		}
+		m_plans = new LtNvDispatchPlan[nPlans];
+		memset(m_plans, 0, nPlans*sizeof(m_plans[0]));
+		for (int i = 0; i < nPlans; i++)
+		{
+			m_plans[i].key = -1;
+		}
+		m_nPlanMask = nPlans - 1;
 	}
 	m_bRehash = true;
+	m_nPlanGeneration++;
     numNvs = nvCount;
     numAliases = aliasCount;
     firstPrivate = numNvs + numAliases;
@@ -373,6 +396,8 @@ LtErrorType LtNetworkVariableConfigurationTable::set(int index, LtNetworkVariabl
 			m_bRehash = true;
 		}
 
+		m_nPlanGeneration++;
+
 		if (getPointer(index, &pNvc, nType) == LT_NO_ERROR)
 		{
 			if ((pNvc == NULL) && nvc.inUse())
@@ -431,6 +456,7 @@ int LtNetworkVariableConfigurationTable::getPrimaryIndex(int index)
 void LtNetworkVariableConfigurationTable::nvChange()
 {
 	m_bRehash = true;
+	m_nPlanGeneration++;
 }
 
 LtErrorType LtNetworkVariableConfigurationTable::get(int& index, int nSelector, boolean bOutput, LtNetworkVariableConfiguration &nvc) 
@@ -500,6 +526,107 @@ LtErrorType LtNetworkVariableConfigurationTable::get(int& index, int nSelector,
 	return err;
 }
 
+//
+// getDispatchPlan
+//
+// Get the targets of an incoming message on the selector, building the plan
+// with the selector search if the tables have changed since it was last used.
+//
+LtNvDispatchPlan* LtNetworkVariableConfigurationTable::getDispatchPlan(int nSelector, boolean bOutput)
+{
+	LtNvDispatchPlan* pPlan = NULL;
+
+    assert(isLocked());
+	if (mappingsAvailable())
+	{
+		int key = (nSelector&0x3fff) | (bOutput ? 0x4000 : 0);
+		int addrGeneration = getStack()->getNetworkImage()->addressTable.getChangeCount();
+
+		pPlan = &m_plans[getSelectorMapIndex(nSelector, bOutput) & m_nPlanMask];
+		if (pPlan->key != key || 
+			pPlan->nvGeneration != m_nPlanGeneration ||
+			pPlan->addrGeneration != addrGeneration)
+		{
+			buildDispatchPlan(pPlan, nSelector, bOutput);
+			pPlan->key = key;
+			pPlan->nvGeneration = m_nPlanGeneration;
+			pPlan->addrGeneration = addrGeneration;
+		}
+	}
+	return pPlan;
+}
+
+void LtNetworkVariableConfigurationTable::buildDispatchPlan(LtNvDispatchPlan* pPlan, int nSelector, boolean bOutput)
+{
+	int index = -1;
+	LtNetworkVariableConfiguration nvc;
+
+	pPlan->count = 0;
+	while (get(index, nSelector, bOutput, nvc) == LT_NO_ERROR)
+	{
+		if (pPlan->count == pPlan->capacity)
+		{
+			int capacity = pPlan->capacity ? pPlan->capacity*2 : 4;
+			LtNvDispatchTarget* pTargets = new LtNvDispatchTarget[capacity];
+			if (pPlan->count)
+			{
+				memcpy(pTargets, pPlan->pTargets, pPlan->count*sizeof(pTargets[0]));
+			}
+			delete[] pPlan->pTargets;
+			pPlan->pTargets = pTargets;
+			pPlan->capacity = capacity;
+		}
+
+		LtNvDispatchTarget* pTarget = &pPlan->pTargets[pPlan->count++];
+		pTarget->primary = nvc.getPrimary();
+        if (nvc.isAlias())
+        {
+            LtNetworkVariableConfiguration primaryNvc;
+            get(nvc.getPrimary(), &primaryNvc);
+            pTarget->incarnation = primaryNvc.getIncarnationNumber();
+        }
+        else
+        {
+            pTarget->incarnation = nvc.getIncarnationNumber();
+        }
+		pTarget->selection[NV_DISPATCH_UPDATE] = nvc.getNvUpdateSelection();
+		pTarget->selection[NV_DISPATCH_REQUEST] = nvc.getNvRequestSelection();
+		pTarget->selection[NV_DISPATCH_RESPONSE] = nvc.getNvResponseSelection();
+		pTarget->authenticated = nvc.getAuthenticated();
+		pTarget->output = nvc.getOutput();
+		resolveSourceAddress(nvc, pTarget);
+	}
+}
+
+void LtNetworkVariableConfigurationTable::resolveSourceAddress(LtNetworkVariableConfiguration& nvc, LtNvDispatchTarget* pTarget)
+{
+	int addressIndex = nvc.getAddressTableIndex();
+	LtAddressConfiguration ac;
+	LtAddressConfiguration* pAc = null;
+
+	if (addressIndex == -1)
+	{
+		// Private NVs have address stored inside it.
+		pAc = nvc.getAddress();				
+	}
+	if (pAc == null &&
+		getStack()->getAddressConfiguration(addressIndex, &ac) == LT_NO_ERROR)
+	{
+		pAc = &ac;
+	}
+	if (pAc != null)
+	{
+		pTarget->addressType = pAc->getAddressType();
+		pTarget->domainIndex = pAc->getDomainIndex();
+		pTarget->subnet = pAc->getSubnet();
+		pTarget->destId = pAc->getDestId();
+	}
+	else
+	{
+		pTarget->addressType = LT_AT_UNBOUND;
+	}
+}
+
 void LtNetworkVariableConfigurationTable::clearNv(int index, int count) 
 {
 	if (index >= numNvs) index += numAliases;
@@ -527,6 +654,7 @@ void LtNetworkVariableConfigurationTable::incrementIncarnation(int index)
     {
         m_nvs[index]->incrementIncarnation();
     }
+	m_nPlanGeneration++;
 }
 
 LtNetworkVariableConfiguration* LtNetworkVariableConfigurationTable::getNext(int nvIndex, LtVectorPos &pos)
@@ -716,6 +844,7 @@ LtErrorType LtNetworkVariableConfigurationTable::load(byte* data, int offset, in
             loadEntry(index, data, offset, nVersion);
 		}
     }
+	nvChange();
 	assert(err == LT_NO_ERROR);
 	return err;
 }
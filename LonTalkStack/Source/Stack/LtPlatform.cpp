@@ -354,6 +354,16 @@ boolean LtPlatform::getUniqueId(LtUniqueId* pUid)
     return true;
 }
 
+boolean LtPlatform::getNodeUniqueId(LtUniqueId* pUid)
+{
+    if (m_nodeUniqueId.isSet())
+    {
+        pUid->set(m_nodeUniqueId);
+        return true;
+    }
+    return getUniqueId(pUid);
+}
+
 void LtPlatform::setUniqueId(LtUniqueId &uid)
 {
 #if FEATURE_INCLUDED(IP852)
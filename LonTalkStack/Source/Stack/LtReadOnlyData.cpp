@@ -76,7 +76,7 @@ LtReadOnlyData::LtReadOnlyData(LtDeviceStack* pStack, int dc, int ac, int mt)
 {
 	memcpy(lonTalk, lonTalkInit, sizeof(lonTalk));
     m_pNetworkImage = pStack->getNetworkImage();
-    if (pStack->getPlatform()->getUniqueId(&uniqueId))
+    if (pStack->getPlatform()->getNodeUniqueId(&uniqueId))
 	{
 		uniqueId.getData(&lonTalk[LT_ROD_UNIQUEID_OFFSET]);
 	}
@@ -226,8 +226,15 @@ LtErrorType LtReadOnlyData::fromLonTalk(int offset, int length, byte* pData)
 
 LtErrorType LtReadOnlyData::toLonTalk(int offset, int length, byte** ppData) 
 {
-	LtErrorType err = LT_NO_ERROR;
     byte* data = new byte[length];
+	LtErrorType err = toLonTalk(offset, length, data);
+	*ppData = data;
+    return err;
+}
+
+LtErrorType LtReadOnlyData::toLonTalk(int offset, int length, byte* data) 
+{
+	LtErrorType err = LT_NO_ERROR;
     if (offset+length <= (int)sizeof(lonTalk)) 
 	{
         if (offset <= LT_ROD_STATE_OFFSET && LT_ROD_STATE_OFFSET < (offset+length))
@@ -255,7 +262,6 @@ LtErrorType LtReadOnlyData::toLonTalk(int offset, int length, byte** ppData)
 	{
 		err = LT_INVALID_PARAMETER;
     }
-	*ppData = data;
     return err;
 }
 
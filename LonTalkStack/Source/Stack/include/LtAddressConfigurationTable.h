@@ -36,12 +36,36 @@ typedef struct
 	int count;
 } AddressTableStoreHeader;
 
-class LtGroupAddresses : public LtTypedVector<LtAddressConfiguration>
+#define LT_GROUPS_PER_DOMAIN 256
+
+//
+// Input group membership for one domain, indexed by group number.  Each slot
+// holds the lowest numbered address table entry for that group which can
+// receive, or null.  Slots are written under the table lock and read without
+// it.
+//
+class LtGroupMap
 {
+public:
+	LtGroupMap() { memset((void*)m_pGroup, 0, sizeof(m_pGroup)); }
+	LtAddressConfiguration* volatile m_pGroup[LT_GROUPS_PER_DOMAIN];
 };
 
-class LtDomainGroups : public LtTypedVector<LtGroupAddresses>
+//
+// The group maps, indexed by domain.  When a new domain index appears a
+// larger set replaces this one.  The maps are shared with the new set, and
+// the old set is kept on the retired chain until the table is destroyed, so
+// a reader holding it never sees freed memory.
+//
+class LtGroupMapSet
 {
+public:
+	LtGroupMapSet(int nDomains, LtGroupMapSet* pRetired);
+	~LtGroupMapSet() { delete[] m_ppMap; }
+
+	int						 m_nDomains;
+	LtGroupMap* volatile*	 m_ppMap;
+	LtGroupMapSet*			 m_pRetired;
 };
 
 class LtAddressConfigurationTable : public LtConfigurationEntity, public VxcLock
@@ -49,19 +73,27 @@ class LtAddressConfigurationTable : public LtConfigurationEntity, public VxcLock
 
 private:
     LtAddressConfiguration** m_addr;
-	LtDomainGroups			 m_domainGroups;
-	boolean					 m_bRebuildMap;
+	LtGroupMapSet* volatile	 m_pGroupMaps;
 
     int                      m_lastMatchingIndex;
 	int                      m_count;
+	int                      m_nChangeCount;
 	LtDeviceStack*			 m_pStack;
     LtErrorType get(int index, LtAddressConfiguration** ppAc);
+
+	static boolean isGroupInput(LtAddressConfiguration* pAc);
+	LtGroupMap* getGroupMap(int domainIndex);
+	LtGroupMap* makeGroupMap(int domainIndex);
+	void addGroupMember(LtAddressConfiguration* pAc);
+	void removeGroupMember(LtAddressConfiguration* pAc);
 protected:
 
 public:
     LtAddressConfigurationTable();
     virtual ~LtAddressConfigurationTable();
 	int getCount() { return m_count; }
+	// Bumped on every change, for caches of resolved addresses
+	int getChangeCount() { return m_nChangeCount; }
 	void setCount(LtDeviceStack* pStack, int count);
 	LtErrorType get(int index, LtAddressConfiguration* pAc);
     LtErrorType set(int index, LtAddressConfiguration& ac);
@@ -74,8 +106,8 @@ public:
     static int getStoreSize(int numEntries);
     int getMaxStoreSize();
 
+	// Group lookups don't take the table lock
 	void getGroups(int domainIndex, LtGroups& gp);
-	void rebuildMap();
 	LtAddressConfiguration* get(int domainIndex, int group);
 
 	// LtConfigurationEntity methods
@@ -28,15 +28,24 @@
 #ifndef LTBITMAP_H
 #define LTBITMAP_H
 
+// Two level bitmap.  Each bit of the summary level marks a non-zero word of
+// the bit level, so the next set bit is found with a count trailing zeros
+// per level rather than a word by word scan.
 class LtBitMap {
 
 private:
 	int bitsLength;
-	int* bits;
+	unsigned int* bits;
+	int summaryLength;
+	unsigned int* summary;
     int curPos;
     int count;
+	int peakCount;
     boolean op(int op, int i);
 	boolean opSafe(int op, int i);
+	int findWord(int from);
+	int findNext(int pos);
+	int takeNext();
 	SEM_ID m_sem;
 
 protected:
@@ -49,6 +58,12 @@ public:
     void clear(int i);
     boolean get(int i);
     int getNext();
+	// Take up to nMax set bits, round robin like getNext, with one lock.
+	// Returns the number taken.
+	int getNextBatch(int* pVals, int nMax);
+	// Number of bits set now and the most that have been set at once
+	int getCount() { return count; }
+	int getPeakCount(boolean bClear = false);
 };
 
 class LtNvMap : public LtBitMap
@@ -72,6 +87,16 @@ public:
 		}
 		return val;
 	}
+	int getNextBatch(int* pIndices, boolean* pPolls, int nMax)
+	{
+		int n = LtBitMap::getNextBatch(pIndices, nMax);
+		for (int i = 0; i < n; i++)
+		{
+			pPolls[i] = pIndices[i]&1;
+			pIndices[i] /= 2;
+		}
+		return n;
+	}
 };
 
 #endif
@@ -51,6 +51,9 @@ private:
 #define DEFAULT_LS_ADDR_MAPPING_ANNOUNCEMENT_FREQUENCY (5*60*1000) // 5 minutes
 #define DEFAULT_LS_ADDR_MAPPING_ANNOUNCEMENT_THROTTLE (100) 
 
+// Most deferred NV updates taken from the pending bitmap at once
+#define NV_UPDATE_BATCH_SIZE 16
+
 
 class LtDeviceStack : 
 	public LtStack, 
@@ -122,6 +125,7 @@ private:
 
     int maxMsg[LT_PRIORITY_TYPES];
     int msgCount[LT_PRIORITY_TYPES];
+    int getFreeMsgCount(int type);
     LtErrorType handleNvUpdates(LtApduIn* apdu);
     LtErrorType processApdu(LtApduIn* apdu);
     LtErrorType dynamicNv(int cmd, byte* pData, int dataLen, byte* pResp, int &respLen);
@@ -214,11 +218,18 @@ public:
     void setApplicationEventThrottle(boolean value);
 	boolean getDirectCallbackMode() { return m_bDirectCallbackMode; }
     void setDirectCallbackMode(boolean value);
-    void processApplicationEvents();
+    void processApplicationEvents() { processApplicationEvents(0); }
+	// Process pending application events and at most nMaxApdus incoming
+	// APDUs (0 for no limit).  Returns true if APDUs are still queued.
+    boolean processApplicationEvents(int nMaxApdus);
     void release(LtMsgIn* msg);
     void release(LtRespIn* msg);
     void doNvUpdates(int type);
+	// Number of NV updates and polls deferred for lack of buffers, and the most
+	// there have been at once, for the LtMisc::getPriorityType() type.
+	void getDeferredNvStats(int type, int &depth, int &peak, boolean bClearPeak = false);
 	boolean propagate(int nvIndex);
+	int propagate(const int* pNvIndices, int nCount);
 	boolean poll(int nvIndex);
     boolean propagate(LtNetworkVariable* pNv, int arrayIndex = 0, LtMsgOverride* pOverride=null);
     boolean poll(LtNetworkVariable* pNv, int arrayIndex = 0, LtMsgOverride* pOverride=null);
@@ -54,7 +54,7 @@ public:
     LtErrorType receive(LtApduIn* pApdu, LtApduOut* pApduOut);
     void completionEvent(LtApduOut* pApdu, boolean success);
 	void send(LtApduOut* pApdu, boolean wait = true, boolean throttle = true);
-	boolean sourceAddressMatch(LtNetworkVariableConfiguration* pNvc, LtApduIn* pApdu);
+	boolean sourceAddressMatch(LtNvDispatchTarget* pTarget, LtApduIn* pApdu);
 	// These two routines are also in LtDeviceStack, but they are independent, not virtual
 	void setReceiveAllBroadcasts(boolean bValue) { m_bReceiveAllBroadcasts = bValue; } 
 	boolean getReceiveAllBroadcasts() { return m_bReceiveAllBroadcasts; }
@@ -87,7 +87,10 @@ typedef struct NmNsMipEevars
 } NmNsMipEevars;
 
 #define MAXIMUM_L5MIP_RECEIVE_TRANSACTIONS 16
+// The SICB tag field is 4 bits so this is a hard limit.  The number of tags
+// actually used is LtMipApp::s_maxL5MIPSicbTags.
 #define MAXIMUM_L5MIP_SICB_TAGS 16
+#define L5MIP_NO_TAG (-1)
 
 typedef	struct
 {
@@ -98,9 +101,56 @@ typedef	struct
 typedef struct
 {
 	LtMsgIn*		m_pMsgIn;
-	unsigned int	m_instance;
+	ULONG			m_tickStart;	// When the request was handed to the host
+	int				m_nPrev;		// In-use list (oldest first) or free list links
+	int				m_nNext;
 } LtMsgInLog;
 
+//
+// The tags of the incoming requests handed to the host.  The SICB tag has no
+// room for a generation count, so a tag whose request expired before the
+// host responded is quarantined: it goes to the back of the free list and is
+// only reused once every tag freed by a response has been.  A late response
+// for it finds no request and is counted, rather than matching a new request
+// given the same tag.  Eviction gets no quarantine: with every tag in use the
+// oldest request's tag goes straight to the new request, so a late response
+// for the evicted request is taken as the response to the new one.
+//
+class LtMipTagTable
+{
+public:
+	LtMipTagTable(int nTags);
+	~LtMipTagTable();
+
+	int getCount() { return m_nTags; }
+
+	// Give pMsgIn a tag, taking the oldest request's tag if all are in use
+	int allocate(LtMsgIn* pMsgIn, ULONG now);
+	// The request with this tag, which the host has responded to, or NULL
+	LtMsgIn* release(int tag);
+	// Drop the requests handed out longer than limit ticks ago
+	void expire(ULONG now, ULONG limit);
+
+	unsigned int getEvictions()		{ return m_nEvictions; }
+	unsigned int getExpirations()	{ return m_nExpirations; }
+	unsigned int getLateResponses()	{ return m_nLateResponses; }
+
+private:
+	LtMsgInLog	m_msgs[MAXIMUM_L5MIP_SICB_TAGS];
+	int			m_nTags;			// Number of tags in service
+	int			m_nFree;			// Head of the free list
+	int			m_nFreeLast;		// Tail of the free list
+	int			m_nOldest;			// Head of the in-use list
+	int			m_nNewest;			// Tail of the in-use list
+	SEM_ID		m_sem;
+	unsigned int m_nEvictions;
+	unsigned int m_nExpirations;
+	unsigned int m_nLateResponses;
+
+	void unlinkTag(int tag);
+	void freeTag(int tag, boolean bQuarantine);
+};
+
 class LtMipTag : public LtMsgTag
 {
 private:
@@ -128,8 +178,8 @@ private:
     int			m_tidEvents;
 	boolean		m_bInitialFlushState;
 	LtNsaData	m_nsa;
-	int			m_instance;
-	LtMsgInLog	m_msgs[MAXIMUM_L5MIP_SICB_TAGS];
+	LtMipTagTable m_tags;
+	ULONG		m_tickLastExpiry;
 	LtSicb		m_winksicb;
 
 	// NSI stub support
@@ -199,6 +249,9 @@ public:
 	// Support for tag to message mapping
 	int getTag(LtMsgIn* pMsgIn);
 	LtMsgIn* getMsgIn(int tag);
+	void expireTags();
+	void getTagCounts(unsigned int& nEvictions, unsigned int& nExpirations)
+		{ nEvictions = m_tags.getEvictions(); nExpirations = m_tags.getExpirations(); }
 
 	// We don't support NV callbacks because we only support layer 5 MIP mode.  Layer 6 MIP
 	// mode could be added if there ever is a reason for it.
@@ -211,6 +264,8 @@ public:
 
 	static int 	s_maxL5MIPTxTransactions;
 	static int 	s_maxL5MIPRxTransactions;
+	static int	s_maxL5MIPSicbTags;			// 1 to MAXIMUM_L5MIP_SICB_TAGS
+	static int	s_l5MIPTagExpiryMs;			// 0 means requests never expire
 };
 
 #endif
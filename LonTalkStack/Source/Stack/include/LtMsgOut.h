@@ -28,6 +28,8 @@
 // $Header: //depot/Software/IzoT/Dev/LonTalkStack/Source/Stack/include/LtMsgOut.h#1 $
 //
 
+#include <new>
+
 
 /**
  * This class defines the message object exchanged between layer 7 of the
@@ -95,6 +97,21 @@ public:
 	{
 		LtApduOut::setOverride(pOverride);
 	}
+
+	// One of these is allocated for every outgoing message, so freed ones
+	// are kept on small free lists, one per priority, for reuse rather than
+	// going back to the heap.  new (bPriority) LtMsgOut(...) takes one from
+	// the list for that priority and returns null if there is no memory.
+	static void* operator new(std::size_t size);
+	static void* operator new(std::size_t size, const std::nothrow_t&) throw();
+	static void* operator new(std::size_t size, boolean bPriority) throw();
+	static void operator delete(void* p, std::size_t size);
+	static void operator delete(void* p, const std::nothrow_t&) throw();
+	static void operator delete(void* p, boolean bPriority) throw();
+
+private:
+	static void* allocFromPool(std::size_t size, boolean bPriority);
+	static void freeToPool(void* p, std::size_t size);
 };
 
 #endif
@@ -67,6 +67,7 @@ private:
 	LtDeviceStack*	m_pStack;
 	boolean			m_bBlackout;
 	boolean			m_bHasBeenEcsChanged;
+	volatile LONG	m_nChangeCount;
 
 	LtPersistence	m_persistence;
 
@@ -104,6 +105,10 @@ public:
 	void setHasBeenEcsChanged(boolean bEcsChange) { m_bHasBeenEcsChanged = bEcsChange; }
 
 	void nvChange();
+
+	// Advances each time the image is stored or restored, so a cached copy
+	// of NV, alias or address configuration can tell whether it is current.
+	LONG getChangeCount() { return m_nChangeCount; }
 	LtPersistence* getPersistence() { return &m_persistence; }
 
 	virtual void serialize(byte* &pBuffer, int &len);
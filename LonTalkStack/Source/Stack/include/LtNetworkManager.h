@@ -60,25 +60,62 @@ class LtNetworkManager : public LtTaskOwner
 {
 	friend class LtDeviceStack;
 
+public:
+	// Lane selection for deliver().  Returns true if a request with this
+	// code and data may be served on the read-only lane.  Absolute memory
+	// reads stay on the ordered lane: they may be of application memory,
+	// which readMemory passes up to the application to serve in order with
+	// its writes.
+	static boolean isReadOnlyRequest(int code, const byte* pData, int nDataLength, boolean bMip)
+	{
+		switch (code)
+		{
+		case LT_QUERY_ID:
+		case LT_QUERY_DOMAIN:
+		case LT_QUERY_ADDRESS:
+		case LT_QUERY_STATUS:
+		case LT_QUERY_STATUS_FLEX_DOMAIN:
+		case LT_QUERY_ROUTING_TABLE:
+		case LT_QUERY_ROUTER_STATUS:
+			return true;
+		case LT_READ_MEMORY:
+			return nDataLength > 0 && pData[0] != LT_ABSOLUTE;
+		case LT_QUERY_NETWORK_VARIABLE:
+			// A MIP hands NV queries to the host.
+			return !bMip;
+		default:
+			return false;
+		}
+	}
+
 private:
 	int							m_taskId;
+	int							m_taskIdRead;
 	int							m_freq;
 	int							m_clockFactor;
 
     MSG_Q_ID					m_queApdus;
+    MSG_Q_ID					m_queReadApdus;		// Read-only requests, see isReadOnlyCommand()
+    SEM_ID						m_semProcess;		// Serializes command execution between the two lanes
 	LtTypedVector<LtDmAddress>  m_vecDmAddrs;
     LtDeviceStack*				m_pStack;
 	LtConfigurationEntity*		m_configEntities[CONFIG_ENTITIES_SIZE];
 
     boolean respondToQuery;
     boolean processing;
+    boolean processingRead;
+	volatile LONG m_nOrderedPending;	// Delivered to the ordered lane and not yet handled
+
+    boolean isReadOnlyCommand(LtApduIn& apdu);
+    void handle(LtApduIn* pApdu, boolean& bProcessing);
+    void runReadOnly();
 
     LtErrorType validate(LtApdu& apdu, int min, int max = -1);
     LtErrorType validateRouterCommand(LtApdu& apdu, int min, int max = -1);
     int determineNvIndex(LtApdu& apdu);
     int determineNvOffset(LtApdu& apdu);
     int convertAddress(byte data[], int offset);
-    LtErrorType readMemory(byte data[], int& len, byte** ppResult);
+    LtErrorType readMemory(byte data[], int& len, byte* pResult, int maxLen);
     LtErrorType processQueryRequest(boolean qualifies, int type, LtApdu& response);
     LtErrorType processQueryId(LtApdu& apdu, LtApdu& response);
     LtErrorType processRespondToQuery(LtApdu& apdu);
@@ -96,7 +133,7 @@ private:
     LtErrorType processNodeMode(LtApdu& apdu);
     LtErrorType processChecksumRecalc(LtApdu& apdu, boolean& store);
     LtErrorType processReadMemory(LtApdu& apdu, LtApdu& response);
-    LtErrorType processWriteMemory(LtApdu& apdu);
+    LtErrorType processWriteMemory(LtApdu& apdu, boolean& store, boolean& storeRecompute);
     LtErrorType processMemoryRefresh(LtApdu& apdu);
     LtErrorType processQueryStatus(LtApdu& apdu, LtApdu& response, boolean validate);
     LtErrorType processClear(LtApdu& apdu);
@@ -144,6 +181,7 @@ public:
 	void persistenceLost();
 
 	static int VXLCDECL start( int nm, ... );
+	static int VXLCDECL startReadOnly( int nm, ... );
 };
 
 
@@ -47,6 +47,9 @@
 #define LT_EEPROM_LOCK   12
 #define LT_NUM_STATS   13
 
+// Link statistics are fetched from the driver at most this often
+#define LT_LINK_STATS_TTL_MS	250
+
 class LtNetworkStats 
 {
 
@@ -55,21 +58,41 @@ private:
 
     LtLink* drv;
     
-    int netStats[LT_NUM_STATS];
+    // 64 bit counts, bumped per thread.  The statistics that come from the
+    // link are not counted here, and LT_EEPROM_LOCK is a flag, not a count.
+    LtStatCounters m_counters;
+    int m_nEepromLock;
+
+    // Cached copy of the link's statistics, see refreshLinkCache()
+    LtLinkStatsSnapshot m_linkCache;
+    ULONG m_tickLinkCache;
+    boolean m_bLinkCacheValid;
+    SEM_ID m_semLinkCache;
+
+    static int getLinkIndex(int index);
+    ULONGLONG getFull(int index, const LtLinkStatsSnapshot& link);
+    void refreshLinkCache();
+    void getLinkSnapshot(LtLinkStatsSnapshot& link);
+    void snapshot(ULONGLONG values[LT_NUM_STATS], int first, int count);
 
 protected:
 
 public:
     LtNetworkStats(LtLink* d, LtLreServer* pLre);
+    ~LtNetworkStats();
     void bump(int index);
     int get(int index);
+    // Fill in all LT_NUM_STATS statistics at full width, for monitoring.
+    // The LonTalk view returned by toLonTalk caps these at 0xffff.
+    void snapshot(ULONGLONG values[LT_NUM_STATS]);
     boolean getEepromLock();
     void setEepromLock(boolean l);
     void reset();
-	void refresh();
     LtErrorType validate(int offset, int length);
     LtErrorType fromLonTalk(byte data[], int offset, int length);
     LtErrorType toLonTalk(byte** ppData, int offset, int length);
+    // As above but into a caller supplied buffer of at least length bytes.
+    LtErrorType toLonTalk(byte* pData, int offset, int length);
  };
 
 #endif
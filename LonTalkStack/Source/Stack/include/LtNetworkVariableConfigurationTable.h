@@ -42,6 +42,40 @@ typedef struct
 
 class LtDeviceStack;
 
+// Selection modes held by an LtNvDispatchTarget
+#define NV_DISPATCH_UPDATE		0
+#define NV_DISPATCH_REQUEST		1
+#define NV_DISPATCH_RESPONSE	2
+
+// One target of an incoming NV message.  Everything layer 6 needs to
+// dispatch the message is resolved here, including the source address used
+// for source selection, so no configuration has to be copied per message.
+typedef struct
+{
+	int		primary;			// NV index to deliver to
+	int		incarnation;		// Incarnation number of the primary
+	int		selection[3];		// LT_SELECTION_* indexed by NV_DISPATCH_*
+	boolean	authenticated;
+	boolean	output;
+	int		addressType;		// LT_AT_UNBOUND if the address can't be resolved
+	int		domainIndex;
+	int		subnet;
+	int		destId;
+} LtNvDispatchTarget;
+
+// The targets for one selector and direction, in the order the selector
+// search finds them.  Rebuilt on first use after the NV, alias or address
+// tables change.
+typedef struct
+{
+	int					key;			// Selector and direction, -1 if unused
+	int					nvGeneration;
+	int					addrGeneration;
+	int					count;
+	int					capacity;
+	LtNvDispatchTarget*	pTargets;
+} LtNvDispatchPlan;
+
 class LtNetworkVariableConfigurationTable : public LtConfigurationEntity
 {
 
@@ -59,6 +93,9 @@ private:
 	int				m_nSelectorMapSize;
 	int				m_nCount;
     int             m_lockedCount;
+	LtNvDispatchPlan*	m_plans;
+	int				m_nPlanMask;
+	int				m_nPlanGeneration;
 
 	int mapIndex(int index, int nType);
     LtErrorType loadEntry(int index, byte* data, int& offset, int nVersion);
@@ -70,6 +107,8 @@ private:
 		// Same as get(int index, LtNetworkVariableConfiguration* pNvc, int nType), but
 		// does not return an error if nvc is not allocated - returns NULL instead
 	LtErrorType getPointer(int index, LtNetworkVariableConfiguration **ppNvc, int nType=NV_TABLE_DEFAULT);
+	void buildDispatchPlan(LtNvDispatchPlan* pPlan, int nSelector, boolean bOutput);
+	void resolveSourceAddress(LtNetworkVariableConfiguration& nvc, LtNvDispatchTarget* pTarget);
 
 protected:
 
@@ -119,6 +158,12 @@ public:
 	boolean mappingsAvailable() { return m_nSelectorMapSize != 0; }
 	void nvChange();
 
+	// Get the dispatch plan for incoming messages on a selector.  Table must be
+	// locked for as long as the plan is used.  Returns NULL if there are no NVs.
+	LtNvDispatchPlan* getDispatchPlan(int nSelector, boolean bOutput);
+	// Invalidate dispatch plans after an NV definition change
+	void planChange() { m_nPlanGeneration++; }
+
 	LtErrorType initialize(int fromIndex, int toIndex, int nType);
 	LtErrorType enumerate(int index, LtApdu &response, int nType);
 	LtErrorType update(int index, byte* pData, int len, int nType);
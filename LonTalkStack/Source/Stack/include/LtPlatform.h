@@ -146,6 +146,7 @@ public:
 	LtErrorType setIndex(int index);
 
     boolean getUniqueId(LtUniqueId* pUid);
+    boolean getNodeUniqueId(LtUniqueId* pUid) { return getUniqueId(pUid); }
 // EPANG TODO - simulate in iLON Linux for now
 #if defined(WIN32) || (defined(ILON_PLATFORM) && defined(linux))
 	static void setUniqueIdMap(LtUniqueId* pMap);
@@ -172,9 +173,15 @@ public:
     static void setUniqueId(LtUniqueId &uid);
     static void generateUniqueId(LtUniqueId* pUid);
 	static boolean getIsFirstRun() { return m_IsFirstRun; }
+
+    // Unique ID of this node: the process-wide one unless the node was given
+    // its own, as when one process hosts several stacks.
+    boolean getNodeUniqueId(LtUniqueId* pUid);
+    void setNodeUniqueId(LtUniqueId &uid) { m_nodeUniqueId.set(uid); }
 private:
     static LtUniqueId m_uniqueId;
 	static boolean m_IsFirstRun;
+    LtUniqueId m_nodeUniqueId;
 #endif
 };
 
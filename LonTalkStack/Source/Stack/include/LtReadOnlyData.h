@@ -90,6 +90,7 @@ public:
 	byte* getData() { return lonTalk; }
 	LtErrorType fromLonTalk(int offset, int length, byte* pData);
 	LtErrorType toLonTalk(int offset, int length, byte** ppData);
+	LtErrorType toLonTalk(int offset, int length, byte* pData);
 
     void setNetworkBuffers(const LtReadOnlyData &source);
     const boolean netBuffersMatch(const LtReadOnlyData &ro);
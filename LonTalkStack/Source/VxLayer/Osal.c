@@ -44,6 +44,8 @@ typedef struct TaskData
     int         taskIndex;
     OsalTaskId  taskId;
     OsalTaskEntryPointType pEntry;
+    int         priority;
+    int         stackSize;
 } TaskData;
 
     /* Statistics for various resources. */
@@ -303,6 +305,8 @@ OsalStatus OsalCreateTask(OsalTaskEntryPointType pEntry,
     {
         pTaskData->taskIndex = taskIndex;
         pTaskData->pEntry = pEntry;
+        pTaskData->priority = priority;
+        pTaskData->stackSize = stackSize;
 
         /* Use count is 2, because both the task and the caller have references to it. */
         pTaskData->useCount = 2; 
@@ -332,6 +336,49 @@ OsalStatus OsalCreateTask(OsalTaskEntryPointType pEntry,
     return sts;
 }
 
+// The task name is only used for affinity rules, which are not supported here.
+OsalStatus OsalCreateNamedTask(OsalTaskEntryPointType pEntry,
+                               int taskIndex, int stackSize, 
+                               int priority, const char *szName,
+                               OsalHandle *pHandle, 
+                               OsalTaskId *pTaskId)
+{
+    return OsalCreateTask(pEntry, taskIndex, stackSize, priority, pHandle, pTaskId);
+}
+
+OsalStatus OsalGetTaskSchedInfo(OsalHandle handle, OsalTaskSchedInfo *pInfo)
+{
+    TaskData *pTaskData = (TaskData *)handle;
+
+    if (pTaskData == NULL || pInfo == NULL)
+    {
+        return OSALSTS_TASK_ERROR;
+    }
+    memset(pInfo, 0, sizeof(*pInfo));
+    pInfo->priority = pTaskData->priority;
+    pInfo->policy = OSAL_SCHED_DEFAULT;
+    pInfo->schedValue = GetThreadPriority(pTaskData->handle);
+    pInfo->stackSize = pTaskData->stackSize;
+    return OSALSTS_SUCCESS;
+}
+
+// Priorities map onto two Windows thread priorities in OsalCreateTask, so 
+// only the default policy is supported.
+OsalStatus OsalSetTaskSchedPolicy(OsalSchedPolicy policy, int highest, int lowest)
+{
+    return policy == OSAL_SCHED_DEFAULT ? OSALSTS_SUCCESS : OSALSTS_TASK_ERROR;
+}
+
+OsalStatus OsalSetTaskMinStackSize(int stackSize)
+{
+    return OSALSTS_TASK_ERROR;
+}
+
+OsalStatus OsalSetTaskAffinity(const char *szName, unsigned long cpuMask)
+{
+    return OSALSTS_TASK_ERROR;
+}
+
 OsalStatus OsalCloseTaskHandle(OsalHandle handle)
 {
     TaskData *pTaskData = (TaskData *)handle;
@@ -28,6 +28,9 @@
  *
  */
  
+#if defined(linux) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE		// for cpu_set_t and pthread_setaffinity_np
+#endif
 #define __USE_UNIX98	// this actually has no effect because pthread.h includes <features.h> which undef's it!
 
 #include <stdlib.h>
@@ -39,7 +42,12 @@
 #include <sys/wait.h>
 #include <sys/stat.h>
 #include <sys/syscall.h>
+#include <sys/resource.h>
 #include <signal.h>
+#if defined(linux)
+#include <linux/futex.h>
+#endif
+#include <limits.h>
 #include <stdarg.h>
 #include <unistd.h>
 #include <assert.h>
@@ -72,6 +80,18 @@ extern int pthread_mutexattr_settype (pthread_mutexattr_t *__attr, int __kind)
 #define Sleep(msec) usleep(msec * 1000)
 #endif
 
+/* Binary semaphores and events use futexes where available, and a mutex 
+ * plus condition variable elsewhere.  See <OsalCv>.  Build with 
+ * -DOSAL_USE_FUTEX=0 to use the condition variable even where futexes exist.
+ */
+#ifndef OSAL_USE_FUTEX
+#if defined(linux) && defined(SYS_futex) && defined(FUTEX_WAIT_BITSET)
+#define OSAL_USE_FUTEX 1
+#else
+#define OSAL_USE_FUTEX 0
+#endif
+#endif
+
 #define SUBPROCESS_MARKER	"/var/run/root%d.lck"
 #define INSTANCE_MARKER		"/var/run/%s.lck"
 
@@ -87,6 +107,25 @@ static void OsalReleaseSubprocessMarker(int pid);
  *                            Internal definitions 
  *****************************************************************************/
 
+#define OSAL_TASK_NAME_MAX          48
+#define OSAL_MAX_AFFINITY_RULES     16
+
+/* Floor for task stack sizes.  Most stack sizes passed in were chosen for 
+ * VxWorks and are too small for glibc, so they are raised to at least this.  
+ * See <OsalSetTaskMinStackSize>.
+ */
+#define OSAL_DEFAULT_MIN_STACK_SIZE (128*1024)
+
+/*
+ *  Typedef: OsalAffinityRule
+ *  CPU affinity for tasks with a given name.  See <OsalSetTaskAffinity>.
+ */
+typedef struct OsalAffinityRule
+{
+    char          name[OSAL_TASK_NAME_MAX];  /* A trailing '*' matches any suffix */
+    unsigned long cpuMask;
+} OsalAffinityRule;
+
 /*
  *  Typedef: TaskData
  *  Task specific data.
@@ -107,20 +146,30 @@ typedef struct TaskData
     OsalTaskId  taskId;
     pthread_t   pthread;
     OsalTaskEntryPointType pEntry;
+    char        name[OSAL_TASK_NAME_MAX];
+    OsalTaskSchedInfo sched;    /* Requested, then effective once the task runs.  The
+                                   task updates it under taskSchedLock. */
 } TaskData;
 
 /*
  *  Typedef: OsalCv
  *  The internal structure used to represent a Binary Semaphore or Event.
  *
- *  Each OsalCV consists condition variable, the associated mutex and 
- *  state. 
+ *  With OSAL_USE_FUTEX each OsalCv is a state word, which is also the futex
+ *  tasks block on, and a count of blocked tasks so that a release can skip
+ *  the wake system call when nobody is waiting.  Otherwise each OsalCV 
+ *  consists condition variable, the associated mutex and state. 
  */
 typedef struct OsalCv
 {
+#if OSAL_USE_FUTEX
+    volatile int        state;      /* OSAL_SEM_CLEAR or OSAL_SEM_SET */
+    volatile int        waiters;    /* Tasks in (or about to enter) FUTEX_WAIT */
+#else
     pthread_mutex_t     mutex;
     pthread_cond_t      cv;
     OsalBinarySemState  state;
+#endif
 } OsalCv;
 
 /******************************************************************************
@@ -148,6 +197,18 @@ pthread_key_t taskDataKey;
 int bTaskDataKeyCreated = 0; /* FALSE */
 __int64 systemTimeOffset = 0;  // signed offset from actual system time in milleseconds
 
+/* Task scheduling configuration, guarded by taskSchedLock.  Loaded from the
+ * environment on first use; see <OsalLoadTaskSchedConfig>.
+ */
+static pthread_mutex_t taskSchedLock = PTHREAD_MUTEX_INITIALIZER;
+static int bTaskSchedConfigured = 0; /* FALSE */
+static OsalSchedPolicy taskSchedPolicy = OSAL_SCHED_DEFAULT;
+static int taskSchedHighest = 0;
+static int taskSchedLowest = 0;
+static int taskMinStackSize = OSAL_DEFAULT_MIN_STACK_SIZE;
+static OsalAffinityRule taskAffinity[OSAL_MAX_AFFINITY_RULES];
+static int taskAffinityCount = 0;
+
 /******************************************************************************
  *                            Forward References
  *****************************************************************************/
@@ -174,8 +235,10 @@ static void DecOsalStat(OsalResourceStats *pStat);
     /* Clear a resource statistic */
 static void ClearOsalStat(OsalResourceStats *pStat);
 
+#if !OSAL_USE_FUTEX
 /* Convert ticks to a timespec. */
 static void OsalGetTimeSpec(unsigned int ticks, struct timespec *pTimeSpec);
+#endif
 
 /* Utility routine to translate a trace level into a string. */
 static const char *GetOsalTraceLevel(OsalTraceLevel level);
@@ -815,6 +878,373 @@ OsalTickCount OsalGetTicksPerSecond(void)
 //
 // REMINDER - DcmpMt.cpp uses OSAL functions for signalling but PTHREAD directly for tasking.
 //
+/*
+ *  Function: OsalSetTaskSchedPolicyLocked
+ *  Set the scheduling policy; caller holds taskSchedLock.
+ */
+static OsalStatus OsalSetTaskSchedPolicyLocked(OsalSchedPolicy policy, int highest, int lowest)
+{
+    int minValue = 0;
+    int maxValue = 0;
+
+    if (policy == OSAL_SCHED_NICE)
+    {
+        minValue = -20;
+        maxValue = 19;
+    }
+    else if (policy == OSAL_SCHED_FIFO)
+    {
+        minValue = sched_get_priority_min(SCHED_FIFO);
+        maxValue = sched_get_priority_max(SCHED_FIFO);
+    }
+    else if (policy != OSAL_SCHED_DEFAULT)
+    {
+        return OSALSTS_TASK_ERROR;
+    }
+
+    if (policy != OSAL_SCHED_DEFAULT &&
+        (highest < minValue || highest > maxValue || lowest < minValue || lowest > maxValue))
+    {
+        if (osalTraceLevel >= OSALTRACE_ERROR)
+        {
+            printf("OsalSetTaskSchedPolicy policy %d range %d..%d outside %d..%d\n",
+                   policy, highest, lowest, minValue, maxValue);
+        }
+        return OSALSTS_TASK_ERROR;
+    }
+
+    taskSchedPolicy = policy;
+    taskSchedHighest = highest;
+    taskSchedLowest = lowest;
+    return OSALSTS_SUCCESS;
+}
+
+/*
+ *  Function: OsalSetTaskAffinityLocked
+ *  Add, replace or remove an affinity rule; caller holds taskSchedLock.
+ */
+static OsalStatus OsalSetTaskAffinityLocked(const char *szName, unsigned long cpuMask)
+{
+    int i;
+
+    if (szName == NULL || *szName == 0 || strlen(szName) >= OSAL_TASK_NAME_MAX)
+    {
+        return OSALSTS_TASK_ERROR;
+    }
+    for (i = 0; i < taskAffinityCount; i++)
+    {
+        if (strcmp(taskAffinity[i].name, szName) == 0)
+        {
+            break;
+        }
+    }
+    if (cpuMask == 0)
+    {
+        /* Remove the rule, if any. */
+        if (i < taskAffinityCount)
+        {
+            taskAffinity[i] = taskAffinity[--taskAffinityCount];
+        }
+        return OSALSTS_SUCCESS;
+    }
+    if (i == taskAffinityCount)
+    {
+        if (taskAffinityCount == OSAL_MAX_AFFINITY_RULES)
+        {
+            return OSALSTS_TASK_ERROR;
+        }
+        strcpy(taskAffinity[taskAffinityCount++].name, szName);
+    }
+    taskAffinity[i].cpuMask = cpuMask;
+    return OSALSTS_SUCCESS;
+}
+
+/*
+ *  Function: OsalLoadTaskSchedConfig
+ *  Load the task scheduling configuration from the environment.
+ *
+ *  Remarks:
+ *  Called once, with taskSchedLock held, before the first task is created or 
+ *  the configuration is first changed, so explicit calls to the OsalSetTask 
+ *  functions override the environment.  The variables are:
+ *
+ *  OSAL_TASK_SCHED - "nice:<highest>:<lowest>" or "fifo:<highest>:<lowest>".
+ *  See <OsalSetTaskSchedPolicy>.
+ *  OSAL_TASK_STACK_MIN - minimum stack size in bytes, 
+ *  OSAL_DEFAULT_MIN_STACK_SIZE if it is not set.  Raise it to give every 
+ *  task more stack than it asks for.
+ *  OSAL_TASK_AFFINITY - comma separated list of <name>=<cpuMask>, for 
+ *  example "LtIpMaster=0x2,LRE_*=0x1".
+ */
+static void OsalLoadTaskSchedConfig(void)
+{
+    const char *szSched = getenv("OSAL_TASK_SCHED");
+    const char *szStack = getenv("OSAL_TASK_STACK_MIN");
+    const char *szAffinity = getenv("OSAL_TASK_AFFINITY");
+
+    if (szSched != NULL)
+    {
+        char policyName[8];
+        int highest;
+        int lowest;
+        OsalStatus sts = OSALSTS_TASK_ERROR;
+
+        if (sscanf(szSched, "%7[a-z]:%d:%d", policyName, &highest, &lowest) == 3)
+        {
+            if (strcmp(policyName, "nice") == 0)
+            {
+                sts = OsalSetTaskSchedPolicyLocked(OSAL_SCHED_NICE, highest, lowest);
+            }
+            else if (strcmp(policyName, "fifo") == 0)
+            {
+                sts = OsalSetTaskSchedPolicyLocked(OSAL_SCHED_FIFO, highest, lowest);
+            }
+        }
+        if (sts != OSALSTS_SUCCESS && osalTraceLevel >= OSALTRACE_ERROR)
+        {
+            printf("OSAL_TASK_SCHED '%s' ignored\n", szSched);
+        }
+    }
+
+    if (szStack != NULL && atoi(szStack) > 0)
+    {
+        taskMinStackSize = atoi(szStack);
+    }
+
+    if (szAffinity != NULL)
+    {
+        char rules[OSAL_MAX_AFFINITY_RULES*(OSAL_TASK_NAME_MAX + 20)];
+        char *pSave = NULL;
+        char *pRule;
+
+        strncpy(rules, szAffinity, sizeof(rules));
+        rules[sizeof(rules) - 1] = 0;
+        for (pRule = strtok_r(rules, ",", &pSave); pRule != NULL; pRule = strtok_r(NULL, ",", &pSave))
+        {
+            char *pMask = strchr(pRule, '=');
+            if (pMask != NULL)
+            {
+                *pMask++ = 0;
+                OsalSetTaskAffinityLocked(pRule, strtoul(pMask, NULL, 0));
+            }
+        }
+    }
+}
+
+/* Lock the task scheduling configuration, loading it on first use. */
+static void OsalLockTaskSched(void)
+{
+    pthread_mutex_lock(&taskSchedLock);
+    if (!bTaskSchedConfigured)
+    {
+        bTaskSchedConfigured = 1; /* TRUE */
+        OsalLoadTaskSchedConfig();
+    }
+}
+
+/*
+ *  Function: OsalSetTaskSchedPolicy
+ *  Set how task priorities map onto the host scheduler.
+ *
+ *  Parameters:
+ *  policy - The <OsalSchedPolicy> to use.
+ *  highest - Nice value (OSAL_SCHED_NICE) or SCHED_FIFO priority 
+ *   (OSAL_SCHED_FIFO) given to task priority 0.
+ *  lowest - The same for task priority 255.  Priorities in between are 
+ *   scaled linearly.
+ *
+ *  Returns:
+ *  <OsalStatus>.
+ *
+ *  Remarks:
+ *  Applies to tasks created afterwards.  Negative nice values and SCHED_FIFO 
+ *  need CAP_SYS_NICE; without it the task runs with the default policy, 
+ *  which <OsalGetTaskSchedInfo> reports.
+ */
+OsalStatus OsalSetTaskSchedPolicy(OsalSchedPolicy policy, int highest, int lowest)
+{
+    OsalStatus sts;
+
+    OsalLockTaskSched();
+    sts = OsalSetTaskSchedPolicyLocked(policy, highest, lowest);
+    pthread_mutex_unlock(&taskSchedLock);
+    return sts;
+}
+
+/*
+ *  Function: OsalSetTaskMinStackSize
+ *  Set the smallest stack size given to a task.
+ *
+ *  Parameters:
+ *  stackSize - The minimum stack size in bytes.  Stack sizes passed to 
+ *   <OsalCreateTask> are raised to this, and then to PTHREAD_STACK_MIN.
+ *
+ *  Remarks:
+ *  The minimum starts out as 128 KB, unless OSAL_TASK_STACK_MIN sets it; see
+ *  <OsalLoadTaskSchedConfig>.  Tasks that ask for more get what they ask for.
+ *
+ *  Returns:
+ *  <OsalStatus>.
+ */
+OsalStatus OsalSetTaskMinStackSize(int stackSize)
+{
+    if (stackSize < 0)
+    {
+        return OSALSTS_TASK_ERROR;
+    }
+    OsalLockTaskSched();
+    taskMinStackSize = stackSize;
+    pthread_mutex_unlock(&taskSchedLock);
+    return OSALSTS_SUCCESS;
+}
+
+/*
+ *  Function: OsalSetTaskAffinity
+ *  Restrict tasks with a given name to a set of CPUs.
+ *
+ *  Parameters:
+ *  szName - The task name.  A trailing '*' matches any name with that prefix.
+ *  cpuMask - Bit n set allows CPU n.  0 removes the rule.
+ *
+ *  Returns:
+ *  <OsalStatus>.
+ *
+ *  Remarks:
+ *  Applies to tasks created afterwards with <OsalCreateNamedTask>.  The first 
+ *  matching rule wins.
+ */
+OsalStatus OsalSetTaskAffinity(const char *szName, unsigned long cpuMask)
+{
+    OsalStatus sts;
+
+    OsalLockTaskSched();
+    sts = OsalSetTaskAffinityLocked(szName, cpuMask);
+    pthread_mutex_unlock(&taskSchedLock);
+    return sts;
+}
+
+/*
+ *  Function: OsalResolveTaskSched
+ *  Fill in the requested scheduling settings for a new task.
+ */
+static void OsalResolveTaskSched(TaskData *pTaskData, int priority)
+{
+    OsalTaskSchedInfo *pSched = &pTaskData->sched;
+    int i;
+
+    if (priority < 0)
+    {
+        priority = 0;
+    }
+    else if (priority > 255)
+    {
+        priority = 255;
+    }
+
+    OsalLockTaskSched();
+    pSched->policy = taskSchedPolicy;
+    pSched->schedValue = taskSchedHighest + ((taskSchedLowest - taskSchedHighest)*priority)/255;
+    pSched->stackSize = taskMinStackSize;
+    pSched->cpuMask = 0;
+    for (i = 0; i < taskAffinityCount && pTaskData->name[0]; i++)
+    {
+        const char *szRule = taskAffinity[i].name;
+        size_t len = strlen(szRule);
+        if (szRule[len - 1] == '*' ? strncmp(pTaskData->name, szRule, len - 1) == 0
+                                   : strcmp(pTaskData->name, szRule) == 0)
+        {
+            pSched->cpuMask = taskAffinity[i].cpuMask;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&taskSchedLock);
+}
+
+/*
+ *  Function: OsalApplyTaskSched
+ *  Apply the scheduling settings to the calling task.
+ *
+ *  Remarks:
+ *  Runs on the new task itself, since on Linux the nice value is a per-thread 
+ *  attribute that can only be set by thread ID.  Settings that can't be 
+ *  applied are dropped from pTaskData->sched so that it shows what is in 
+ *  effect.  The settings are worked on in a copy and stored back under 
+ *  taskSchedLock, since <OsalGetTaskSchedInfo> can read them at any time.
+ */
+static void OsalApplyTaskSched(TaskData *pTaskData)
+{
+    OsalTaskSchedInfo sched = pTaskData->sched;
+    OsalTaskSchedInfo *pSched = &sched;
+    pid_t tid = (pid_t)syscall(SYS_gettid);
+    int err = 0;
+
+    if (pSched->policy == OSAL_SCHED_FIFO)
+    {
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = pSched->schedValue;
+        err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    }
+    else if (pSched->policy == OSAL_SCHED_NICE)
+    {
+        if (setpriority(PRIO_PROCESS, tid, pSched->schedValue) != 0)
+        {
+            err = errno;
+        }
+    }
+    if (err != 0)
+    {
+        if (osalTraceLevel >= OSALTRACE_WARNING)
+        {
+            printf("Task '%s' policy %d value %d not applied - err=%d\n",
+                   pTaskData->name, pSched->policy, pSched->schedValue, err);
+        }
+        pSched->policy = OSAL_SCHED_DEFAULT;
+    }
+    if (pSched->policy != OSAL_SCHED_FIFO)
+    {
+        errno = 0;
+        pSched->schedValue = getpriority(PRIO_PROCESS, tid);
+        if (errno != 0)
+        {
+            pSched->schedValue = 0;
+        }
+    }
+
+#if defined(linux)
+    if (pSched->cpuMask != 0)
+    {
+        cpu_set_t cpus;
+        int cpu;
+
+        CPU_ZERO(&cpus);
+        for (cpu = 0; cpu < (int)(8*sizeof(pSched->cpuMask)) && cpu < CPU_SETSIZE; cpu++)
+        {
+            if (pSched->cpuMask & (1UL << cpu))
+            {
+                CPU_SET(cpu, &cpus);
+            }
+        }
+        err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+        if (err != 0)
+        {
+            if (osalTraceLevel >= OSALTRACE_WARNING)
+            {
+                printf("Task '%s' affinity 0x%lx not applied - err=%d\n",
+                       pTaskData->name, pSched->cpuMask, err);
+            }
+            pSched->cpuMask = 0;
+        }
+    }
+#else
+    pSched->cpuMask = 0;
+#endif
+
+    pthread_mutex_lock(&taskSchedLock);
+    pTaskData->sched = sched;
+    pthread_mutex_unlock(&taskSchedLock);
+}
+
 /*
  *  Function: MyOsTaskStart
  *  uC/OS-II task entry point for OSAL tasks.
@@ -842,6 +1272,7 @@ void *MyOsTaskStart( void *parm )
     }
 
     pthread_setspecific(taskDataKey, pTaskData);
+    OsalApplyTaskSched(pTaskData);
 
     pTaskData->pEntry(pTaskData->taskIndex);
 
@@ -858,6 +1289,22 @@ void *MyOsTaskStart( void *parm )
 
 /*
  *  Function: OsalCreateTask
+ *  Create an unnamed OSAL task.
+ *
+ *  Remarks:
+ *  Same as <OsalCreateNamedTask> with no name, so no affinity rule applies.
+ */
+OsalStatus OsalCreateTask(OsalTaskEntryPointType pEntry, int taskIndex, int stackSize,
+                          int abstractPriority, 
+                          OsalHandle *pHandle, 
+                          OsalTaskId *pTaskId)
+{
+    return OsalCreateNamedTask(pEntry, taskIndex, stackSize, abstractPriority, NULL,
+                               pHandle, pTaskId);
+}
+
+/*
+ *  Function: OsalCreateNamedTask
  *  Create an OSAL task.
  *
  *  Parameters:
@@ -872,6 +1319,7 @@ void *MyOsTaskStart( void *parm )
  *   higher priorities.  The ranges are defined by 
  *   <OSAL_HIGH_ABSTRACT_PRIORITY_START>, <OSAL_MEDIUM_ABSTRACT_PRIORITY_START>
  *   and <OSAL_LOW_ABSTRACT_PRIORITY_START>.
+ *  szName - Task name used to look up CPU affinity, or NULL.
  *  pHandle - Pointer to an operating system dependent handle used to identify 
  *   the task at a later time.  Returned by the OSAL layer.
  *  pTaskId - Pointer to an operating system dependent task ID that can be used 
@@ -884,11 +1332,14 @@ void *MyOsTaskStart( void *parm )
  *
  *  Remarks:
  *  This function is used to create an OSAL task.  The entry point is passed in.
+ *  The stack size is applied, raised to the minimum set by 
+ *  <OsalSetTaskMinStackSize>, and the priority and affinity are applied by 
+ *  the task as it starts.  See <OsalSetTaskSchedPolicy>.
  */
-OsalStatus OsalCreateTask(OsalTaskEntryPointType pEntry, int taskIndex, int stackSize,
-                          int abstractPriority, 
-                          OsalHandle *pHandle, 
-                          OsalTaskId *pTaskId)
+OsalStatus OsalCreateNamedTask(OsalTaskEntryPointType pEntry, int taskIndex, int stackSize,
+                               int abstractPriority, const char *szName,
+                               OsalHandle *pHandle, 
+                               OsalTaskId *pTaskId)
 {
     OsalStatus  sts = OSALSTS_CREATE_TASK_FAILED;
     int err = 0;
@@ -912,12 +1363,37 @@ OsalStatus OsalCreateTask(OsalTaskEntryPointType pEntry, int taskIndex, int stac
             /* Can't think of anything better to put here. */
             pTaskData->taskId = (OsalTaskId)taskIndex + 1;            
             pTaskData->pEntry = pEntry;
+            pTaskData->name[0] = 0;
+            if (szName != NULL)
+            {
+                strncpy(pTaskData->name, szName, OSAL_TASK_NAME_MAX);
+                pTaskData->name[OSAL_TASK_NAME_MAX-1] = 0;
+            }
+            memset(&pTaskData->sched, 0, sizeof(pTaskData->sched));
+            pTaskData->sched.priority = abstractPriority;
+            OsalResolveTaskSched(pTaskData, abstractPriority);
 
             /* Use count is 2, because both the task and the caller have references to it. */
             pTaskData->useCount = 2; 
             err = pthread_attr_init(&attr);
             if (err == 0)
             {
+                if (stackSize > 0)
+                {
+                    size_t size = stackSize > pTaskData->sched.stackSize ? stackSize : pTaskData->sched.stackSize;
+                    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+
+                    if (size < PTHREAD_STACK_MIN)
+                    {
+                        size = PTHREAD_STACK_MIN;
+                    }
+                    size = (size + page - 1) & ~(page - 1);
+                    pTaskData->sched.stackSize = pthread_attr_setstacksize(&attr, size) == 0 ? (int)size : 0;
+                }
+                else
+                {
+                    pTaskData->sched.stackSize = 0;
+                }
                 err = pthread_create(&pTaskData->pthread, &attr, MyOsTaskStart, pTaskData);
                 pthread_attr_destroy(&attr);
             }
@@ -937,8 +1413,9 @@ OsalStatus OsalCreateTask(OsalTaskEntryPointType pEntry, int taskIndex, int stac
 
                 if (osalTraceLevel >= OSALTRACE_VERBOSE)
                 {
-                    printf("Create task TID = %d, priority = %d , stackSize=%u\n", 
-                           taskIndex, abstractPriority, (unsigned)stackSize);
+                    printf("Create task TID = %d, priority = %d , stackSize=%u (applied %u)\n", 
+                           taskIndex, abstractPriority, (unsigned)stackSize,
+                           (unsigned)pTaskData->sched.stackSize);
                 }
             }
             else
@@ -1008,6 +1485,35 @@ OsalStatus OsalCloseTaskHandle(OsalHandle handle)
     return OSALSTS_SUCCESS;        
 }
 
+/*
+ *  Function: OsalGetTaskSchedInfo
+ *  Get the scheduling settings of a task.
+ *
+ *  Parameters:
+ *  handle - The handle returned by <OsalCreateTask>. 
+ *  pInfo - Receives the settings.
+ *
+ *  Returns:
+ *  <OsalStatus>.
+ *
+ *  Remarks:
+ *  Until the task has started running this returns the requested settings; 
+ *  afterwards it returns the ones in effect.
+ */
+OsalStatus OsalGetTaskSchedInfo(OsalHandle handle, OsalTaskSchedInfo *pInfo)
+{
+    TaskData *pTaskData = (TaskData *)handle;
+
+    if (pTaskData == NULL || pInfo == NULL)
+    {
+        return OSALSTS_TASK_ERROR;
+    }
+    pthread_mutex_lock(&taskSchedLock);
+    *pInfo = pTaskData->sched;
+    pthread_mutex_unlock(&taskSchedLock);
+    return OSALSTS_SUCCESS;
+}
+
 /*
  *  Function: OsalSuspendTask
  *  Suspends a task.
@@ -1811,6 +2317,172 @@ void OsalClearStatistics(void)
  * This section contains internal supports utilities used in this OSAL port.
  */
 
+#if OSAL_USE_FUTEX
+/*
+ * The futex based OsalCv.  The state word is both the semaphore and the 
+ * futex, so an uncontended wait or signal is a single atomic operation with
+ * no system call.  Only when a task has to block (or a blocked task has to 
+ * be woken) does the kernel get involved.
+ */
+
+/* Trace a successful operation only when verbose; failures always. */
+#define OSAL_TRACE_CV(title, pCv, err, sts) \
+    if ((sts) != OSALSTS_SUCCESS || osalTraceLevel >= OSALTRACE_VERBOSE) \
+        OsalTrace(title, pCv, err, sts)
+
+static int OsalFutex(volatile int *pWord, int op, int val, const struct timespec *pTimeout)
+{
+    return (int)syscall(SYS_futex, pWord, op | FUTEX_PRIVATE_FLAG, val, pTimeout, NULL,
+                        FUTEX_BITSET_MATCH_ANY);
+}
+
+static OsalStatus OsalCreateCv(OsalHandle *pHandle, OsalBinarySemState initialState,
+                               const char *title, OsalStatus genericError,
+                               OsalResourceStats *pStat)
+{
+    OsalStatus sts = genericError;
+    OsalCv *pCv = (OsalCv *)malloc(sizeof(OsalCv));
+    if (pCv != NULL)
+    {
+        pCv->state = initialState;
+        pCv->waiters = 0;
+        sts = OSALSTS_SUCCESS;
+        IncOsalStat(pStat);
+    }
+    OsalTrace(title, pCv, 0, sts);
+
+    /* The OsalHandle is really a pointer to the OsalCv. */
+    *pHandle = (OsalHandle)pCv;
+    return (sts);
+}
+
+static OsalStatus OsalDeleteCv(OsalHandle *pHandle, const char *title,
+                               OsalStatus genericError, OsalResourceStats *pStat)
+{
+    /* The OsalHandle is really a pointer to the OsalCv. */
+    OsalCv *pCv = *((OsalCv **)pHandle);
+    if (pCv != NULL)
+    {
+        DecOsalStat(pStat);
+        *pHandle = NULL;
+        OsalTrace(title, pCv, 0, OSALSTS_SUCCESS);
+        free(pCv);
+    }
+    return OSALSTS_SUCCESS;
+}
+
+static OsalStatus OsalWaitForCv(OsalHandle handle, unsigned int ticks,
+                                const char *title, OsalStatus genericError)
+{
+    /* The OsalHandle is really a pointer to the OsalCv. */
+    OsalCv *pCv = (OsalCv *)handle;
+    OsalStatus sts = OSALSTS_SUCCESS;
+    int err = 0;
+
+    if (pCv == NULL)
+    {
+        // We're not going to suspend at all!  Avoid potential spin loops
+        OsalSleep(1000);
+        return genericError;
+    }
+
+    /* Fast path - take it if it's set. */
+    if (!__sync_bool_compare_and_swap(&pCv->state, OSAL_SEM_SET, OSAL_SEM_CLEAR))
+    {
+        struct timespec absTime;
+
+        if (ticks != OSAL_WAIT_FOREVER && ticks != 0)
+        {
+            /* FUTEX_WAIT_BITSET takes an absolute CLOCK_MONOTONIC time, so
+             * spurious wakeups don't extend the wait and wall clock changes
+             * don't affect it.
+             */
+            time_t msec = ticks*1000/OsalGetTicksPerSecond();
+            long nsec;
+
+            clock_gettime(CLOCK_MONOTONIC, &absTime);
+            nsec = absTime.tv_nsec + (long)((msec % 1000) * 1000 * 1000);
+            absTime.tv_sec += (long)(msec/1000) + nsec/(1000*1000*1000);
+            absTime.tv_nsec = nsec % (1000*1000*1000);
+        }
+
+        for (;;)
+        {
+            if (ticks == 0)
+            {
+                err = ETIMEDOUT;
+                break;
+            }
+
+            /* Announce ourselves before sleeping, so OsalSignalCv knows to 
+             * wake us.  The kernel only sleeps if the state is still clear.
+             */
+            __sync_fetch_and_add(&pCv->waiters, 1);
+            if (OsalFutex(&pCv->state, FUTEX_WAIT_BITSET, OSAL_SEM_CLEAR,
+                          ticks == OSAL_WAIT_FOREVER ? NULL : &absTime) != 0)
+            {
+                err = errno;
+            }
+            __sync_fetch_and_sub(&pCv->waiters, 1);
+
+            if (__sync_bool_compare_and_swap(&pCv->state, OSAL_SEM_SET, OSAL_SEM_CLEAR))
+            {
+                err = 0;
+                break;
+            }
+            if (err == ETIMEDOUT)
+            {
+                break;
+            }
+            if (err != 0 && err != EAGAIN && err != EINTR)
+            {
+                break;
+            }
+            err = 0;
+        }
+    }
+
+    if (err == ETIMEDOUT)
+    {
+        sts = OSALSTS_TIMEOUT;
+    }
+    else if (err != 0)
+    {
+        sts = genericError;
+    }
+    OSAL_TRACE_CV(title, pCv, err, sts);
+    return sts;
+}
+
+static OsalStatus OsalSignalCv(OsalHandle handle, const char *title,
+                               OsalStatus genericError)
+{
+    /* The OsalHandle is really a pointer to the OsalCv. */
+    OsalCv *pCv = (OsalCv *)handle;
+    OsalStatus sts = OSALSTS_SUCCESS;
+    int err = 0;
+
+    if (pCv == NULL)
+    {
+        return genericError;
+    }
+
+    pCv->state = OSAL_SEM_SET;
+    /* Order the store above against the read of waiters below.  Paired with
+     * the increment in OsalWaitForCv, either we see the waiter or the 
+     * waiter's FUTEX_WAIT sees the state set.
+     */
+    __sync_synchronize();
+    if (pCv->waiters != 0 && OsalFutex(&pCv->state, FUTEX_WAKE, 1, NULL) < 0)
+    {
+        err = errno;
+        sts = genericError;
+    }
+    OSAL_TRACE_CV(title, pCv, err, sts);
+    return sts;
+}
+
+#else
 /* 
  * Function: OsalCreateCv
  * Create a condition variable and associated components.
@@ -2053,6 +2725,7 @@ static OsalStatus OsalSignalCv(OsalHandle handle, const char *title,
     }
     return sts;
 }
+#endif // OSAL_USE_FUTEX
 
 int OsalIsRealTimeClockOk(void)
 {
@@ -2068,6 +2741,7 @@ int OsalIsRealTimeClockOk(void)
 	return t.tm_year >= 110;
 }
 
+#if !OSAL_USE_FUTEX
 /*
  *  Function: OsalGetTimeSpec
  *  Convert ticks to an absolute timespec.
@@ -2091,6 +2765,7 @@ static void OsalGetTimeSpec(unsigned int ticks, struct timespec *pTimeSpec)
 	pTimeSpec->tv_sec += nsec /(1000*1000*1000);
     pTimeSpec->tv_nsec = nsec % (1000*1000*1000);
 }
+#endif // !OSAL_USE_FUTEX
 
 /*
  *  Function: IncOsalStat
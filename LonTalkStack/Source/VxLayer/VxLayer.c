@@ -364,15 +364,40 @@ typedef struct _TASKBLOCK
 	FUNCPTR		entryPt;				// entry point function
 	int			args[10];				// parameters
     int         vxError;
+	int			nextFree;				// next free task id, while on the free list
+	int			nextName;				// next task id in the same name bucket
 
 } TASKBLOCK;
 
+#define TASKNAMEBUCKETS	256				// must be a power of 2
+
+//
+// Task blocks, indexed by task id
 //
-// Array of task blocks
+// Blocks are allocated the first time their id is handed out and are then
+// kept for reuse, so memory follows the peak number of tasks rather than
+// TASKMAXTASKS.  Released ids go on a free list and busy tasks are hashed
+// by name, so spawn and lookup don't scan the table.  All of this is
+// protected by LockTaskList.
 //
-TASKBLOCK	aTasks[TASKMAXTASKS];
+static TASKBLOCK	*apTasks[TASKMAXTASKS];
+static int gTaskHighWater = 0;			// highest task id ever handed out
+static int gTaskFreeList = 0;			// first free task id, 0 if none
+static int aTaskNameHash[TASKNAMEBUCKETS];	// first task id in each bucket, 0 if none
 static int gTaskCount = 0;
 
+//
+// TaskBlock
+//
+// Return the task block for a task id, or NULL if the id has never been
+// used.  Blocks are not freed, so callers that look without the lock
+// still see valid memory.
+//
+static TASKBLOCK *TaskBlock( int tid )
+{
+	return (tid >= 1 && tid < TASKMAXTASKS) ? apTasks[tid] : NULL;
+}
+
 //
 // vxlShutdown
 //
@@ -392,10 +417,10 @@ void vxlShutdown()
 	if (gTaskCount)
 	{
 		assert(0);
-		for (i=1; i<TASKMAXTASKS; i++)
+		for (i=1; i<=gTaskHighWater; i++)
 		{
-			if (aTasks[i].bBusy)
-				printf("Task %s did not exit\n", aTasks[i].name);
+			if (apTasks[i]->bBusy)
+				printf("Task %s did not exit\n", apTasks[i]->name);
 		}
 	}
 }
@@ -418,7 +443,7 @@ int gTaskLockCount = 0;
 
 TASKBLOCK*	vxlGetTaskBlock( int tid )
 {
-	return &aTasks[tid];
+	return TaskBlock(tid);
 }
 
 //
@@ -429,7 +454,8 @@ TASKBLOCK*	vxlGetTaskBlock( int tid )
 VXLAYER_API
 HANDLE	vxlGetThreadHandle( int tid )
 {
-	return aTasks[tid].hThread;
+	TASKBLOCK *pTask = TaskBlock(tid);
+	return pTask ? pTask->hThread : NULL;
 }
 
 #if PRODUCT_IS(ILON)
@@ -442,14 +468,14 @@ static int mainThreadErrorNo=0;
 
 int VxErrno(void)
 {
-    int tid = OsalGetTaskIndex();
-    if (tid == 0 || tid >= TASKMAXTASKS)
+    TASKBLOCK *pTask = TaskBlock(OsalGetTaskIndex());
+    if (pTask == NULL)
     {
         return mainThreadErrorNo;
     }
     else 
     {
-        return aTasks[tid].vxError;
+        return pTask->vxError;
     }
 }
 
@@ -459,14 +485,14 @@ void SetVxErrno( int err )
 	// set the error number for Linux host
 	errno = err;
 #endif
-    int tid = OsalGetTaskIndex();
-    if (tid == 0 || tid >= TASKMAXTASKS)
+    TASKBLOCK *pTask = TaskBlock(OsalGetTaskIndex());
+    if (pTask == NULL)
     {
         mainThreadErrorNo = err;
     }
     else 
     {
-        aTasks[tid].vxError = err;
+        pTask->vxError = err;
     }
 }
 #endif
@@ -484,8 +510,8 @@ void	LockTaskList( void)
 		OsalCreateCriticalSection( &csTaskLock );
 		vxlTrace("LockTaskList - create task lock 0x%08x\n", csTaskLock );
 		bTaskLockInit = TRUE;
-		// Probably not necessary, but just to make sure.
-		memset( &aTasks, 0, sizeof(aTasks) );
+		// Any task blocks left from before are idle on the free list, so
+		// they are kept rather than cleared.
 		gTaskCount = 0;
 	}
 	OsalEnterCriticalSection( csTaskLock );
@@ -515,6 +541,84 @@ void	Cleanup(void)
 	}
 }
 
+//
+// TaskNameBucket
+//
+// Hash a task name into the name index
+//
+static int TaskNameBucket( const char *name )
+{
+	unsigned int hash = 5381;
+	int i;
+
+	for (i = 0; i < TASKNAMEMAX && name[i]; i++)
+	{
+		hash = hash*33 + (unsigned char)name[i];
+	}
+	return (int)(hash & (TASKNAMEBUCKETS-1));
+}
+
+//
+// AllocTaskBlock
+//
+// Take a task id off the free list, or hand out a new one.  Returns the
+// id of a cleared, busy task block, or 0 if none is available.
+// Caller holds LockTaskList.
+//
+static int AllocTaskBlock(void)
+{
+	int tid = gTaskFreeList;
+
+	if (tid != 0)
+	{
+		gTaskFreeList = apTasks[tid]->nextFree;
+	}
+	else if (gTaskHighWater < TASKMAXTASKS-1)
+	{
+		// Never allocate task id zero, since that's special
+		// it means the current task
+		TASKBLOCK *pTask = (TASKBLOCK *)malloc(sizeof(TASKBLOCK));
+		if (pTask == NULL)
+		{
+			return 0;
+		}
+		memset( pTask, 0, sizeof(TASKBLOCK) );
+		tid = ++gTaskHighWater;
+		apTasks[tid] = pTask;
+	}
+	else
+	{
+		return 0;
+	}
+	memset( apTasks[tid], 0, sizeof(TASKBLOCK) );
+	apTasks[tid]->bBusy = TRUE;
+	return tid;
+}
+
+//
+// FreeTaskBlock
+//
+// Remove a busy task from the name index and put its id on the free list.
+// Caller holds LockTaskList.
+//
+static void FreeTaskBlock( int tid )
+{
+	TASKBLOCK *pTask = apTasks[tid];
+	int *pLink = &aTaskNameHash[TaskNameBucket(pTask->name)];
+
+	while (*pLink != 0 && *pLink != tid)
+	{
+		pLink = &apTasks[*pLink]->nextName;
+	}
+	if (*pLink == tid)
+	{
+		*pLink = pTask->nextName;
+	}
+	memset( pTask, 0, sizeof(TASKBLOCK) );
+	pTask->nextFree = gTaskFreeList;
+	gTaskFreeList = tid;
+}
+
 // Fixed crash in the case when task exit very quickly
 //
 // OsalTaskEntryPoint
@@ -525,36 +629,39 @@ void	Cleanup(void)
 //
 void OsalTaskEntryPoint( int idx )
 {
+	TASKBLOCK *pTask;
+
 	LockTaskList();
 	// Just a check to see if we have a valid
 	// task block. Task may have been deleted before
 	// we get here actually.
-	if ( !aTasks[idx].bBusy )
+	pTask = TaskBlock(idx);
+	if ( pTask == NULL || !pTask->bBusy )
 	{
 	    UnlockTaskList();
 		return;
 	}
 
-    aTasks[idx].vxError = 0;
+    pTask->vxError = 0;
 	UnlockTaskList();
 
 	// Not clear about the return from a task on VxWorks
-	aTasks[idx].entryPt(
-				aTasks[idx].args[0],
-				aTasks[idx].args[1],
-				aTasks[idx].args[2],
-				aTasks[idx].args[3],
-				aTasks[idx].args[4],
-				aTasks[idx].args[5],
-				aTasks[idx].args[6],
-				aTasks[idx].args[7],
-				aTasks[idx].args[8],
-				aTasks[idx].args[9] );
+	pTask->entryPt(
+				pTask->args[0],
+				pTask->args[1],
+				pTask->args[2],
+				pTask->args[3],
+				pTask->args[4],
+				pTask->args[5],
+				pTask->args[6],
+				pTask->args[7],
+				pTask->args[8],
+				pTask->args[9] );
 
 	// Release the task block
 	LockTaskList();
-    OsalCloseTaskHandle(aTasks[idx].hThread);
-	memset( &aTasks[idx], 0, sizeof(TASKBLOCK) );
+    OsalCloseTaskHandle(pTask->hThread);
+	FreeTaskBlock(idx);
 	gTaskCount--;
 	UnlockTaskList();
 	Cleanup();
@@ -578,10 +685,11 @@ int	taskSpawn(
 	int arg6, int arg7, int arg8, int arg9, int arg10 )	// parameters
 {
 	int			i;
-	BOOL		bFound = FALSE;
+	int			*pLink;
+	TASKBLOCK	*pTask;
 	STATUS		sts = OK;
     OsalTaskId taskId;
-    OsalHandle taskHandle;
+    OsalHandle taskHandle = NULL;
 
 #if !defined(__VXWORKS__)
     /* Initialize the vxlInitLock if not already done so that we can be
@@ -595,50 +703,52 @@ int	taskSpawn(
 	// Find an entry in the task list for us to use
 	LockTaskList();
 
-	// Never allocate task id zero, since that's special
-	// it means the current task
-	for ( i=1; i< TASKMAXTASKS; i++ )
-	{
-		if ( !aTasks[i].bBusy)
-		{
-			aTasks[i].bBusy = TRUE;
-			bFound = TRUE;
-			break;
-		}
-	}
+	i = AllocTaskBlock();
 	// Can't find a open entry to allocate a task.
-	if ( !bFound )
+	if ( i == 0 )
 	{
 	    UnlockTaskList();
 		SetVxErrno( 989 );	// what to set it to?
 		return ERROR;
 	}
 
-	// Save the name
-	strncpy(aTasks[i].name, name, TASKNAMEMAX);
-	aTasks[i].name[TASKNAMEMAX-1] = 0;
+	pTask = apTasks[i];
+
+	// Save the name, and index it.  The task goes on the end of its bucket,
+	// so that of several tasks with the same name, taskNameToId finds the
+	// one spawned first.
+	strncpy(pTask->name, name, TASKNAMEMAX);
+	pTask->name[TASKNAMEMAX-1] = 0;
+	pTask->nextName = 0;
+	pLink = &aTaskNameHash[TaskNameBucket(pTask->name)];
+	while (*pLink != 0)
+	{
+		pLink = &apTasks[*pLink]->nextName;
+	}
+	*pLink = i;
 
 	// Store away the parameters for the task
-	aTasks[i].args[0] = arg1;
-	aTasks[i].args[1] = arg2;
-	aTasks[i].args[2] = arg3;
-	aTasks[i].args[3] = arg4;
-	aTasks[i].args[4] = arg5;
-	aTasks[i].args[5] = arg6;
-	aTasks[i].args[6] = arg7;
-	aTasks[i].args[7] = arg8;
-	aTasks[i].args[8] = arg9;
-	aTasks[i].args[9] = arg10;
-	aTasks[i].dwStackSize = stacksize;
-	aTasks[i].entryPt	= entryPt;
-    OsalCreateTask(OsalTaskEntryPoint, i, stacksize, priority, &taskHandle, &taskId);
-    aTasks[i].hThread = taskHandle;
+	pTask->args[0] = arg1;
+	pTask->args[1] = arg2;
+	pTask->args[2] = arg3;
+	pTask->args[3] = arg4;
+	pTask->args[4] = arg5;
+	pTask->args[5] = arg6;
+	pTask->args[6] = arg7;
+	pTask->args[7] = arg8;
+	pTask->args[8] = arg9;
+	pTask->args[9] = arg10;
+	pTask->dwStackSize = stacksize;
+	pTask->entryPt	= entryPt;
+    OsalCreateNamedTask(OsalTaskEntryPoint, i, stacksize, priority, pTask->name,
+                        &taskHandle, &taskId);
+    pTask->hThread = taskHandle;
 	// Create and start a thread that is the task
 
-	if ( aTasks[i].hThread == NULL )
+	if ( pTask->hThread == NULL )
 	{
 		// Free the task block on an error
-		memset( &aTasks[i], 0, sizeof(TASKBLOCK) );
+		FreeTaskBlock(i);
 		sts = ERROR;
 	    UnlockTaskList();
         vxlReportLastError( "taskSpawn - CreateThread");
@@ -646,7 +756,7 @@ int	taskSpawn(
 	}
 	else
 	{
-        aTasks[i].dwThreadId = (void *)taskId;
+        pTask->dwThreadId = (void *)taskId;
 		sts = i; // on success return vxTask ID
 		gTaskCount++;
 	    UnlockTaskList();
@@ -673,14 +783,16 @@ int taskIdSelf(void)
 STATUS taskIdVerify( int tid )
 {
 	STATUS		sts = ERROR;
+	TASKBLOCK	*pTask;
 	// Do we really need to lock the task array for a look see?
 	// Nope, chance it.
-	if ( tid < 1 || tid >= TASKMAXTASKS )
+	pTask = TaskBlock(tid);
+	if ( pTask == NULL )
 	{	return sts;
 	}
 	// If the task is busy, then it's ok
 	// else error for task not active.
-	if ( aTasks[tid].bBusy )
+	if ( pTask->bBusy )
 	{	sts = OK;
 	}
 	return sts;
@@ -692,15 +804,17 @@ STATUS taskIdVerify( int tid )
 STATUS taskIsSuspended( int tid )
 {
 	STATUS		sts = ERROR;
+	TASKBLOCK	*pTask;
 	// Do we really need to lock the task array for a look see?
 	// Nope, chance it.
-	if ( tid < 1 || tid >= TASKMAXTASKS )
+	pTask = TaskBlock(tid);
+	if ( pTask == NULL )
 	{	return sts;
 	}
 	// If the task is suspended, then it's ok
 	// else error for task not suspended.
-	if ( aTasks[tid].bBusy && 
-		 aTasks[tid].bSuspended )
+	if ( pTask->bBusy && 
+		 pTask->bSuspended )
 	{	sts = OK;
 	}
 	return sts;
@@ -714,15 +828,17 @@ STATUS taskIsSuspended( int tid )
 STATUS taskIsReady( int tid )
 {
 	STATUS		sts = ERROR;
+	TASKBLOCK	*pTask;
 	// Do we really need to lock the task array for a look see?
 	// Nope, chance it.
-	if ( tid < 1 || tid >= TASKMAXTASKS )
+	pTask = TaskBlock(tid);
+	if ( pTask == NULL )
 	{	return sts;
 	}
 	// If the task is NOT suspended, then it's ok
 	// else error for task suspended.
-	if ( aTasks[tid].bBusy && 
-		 !aTasks[tid].bSuspended )
+	if ( pTask->bBusy && 
+		 !pTask->bSuspended )
 	{	sts = OK;
 	}
 	else
@@ -748,9 +864,11 @@ STATUS taskDelete( int tid )
 	return OK;
 #else
 	STATUS		sts = ERROR;
+	TASKBLOCK	*pTask;
 	// Do we really need to lock the task array for a look see?
 	// Nope, chance it.
-	if ( tid < 1 || tid >= TASKMAXTASKS )
+	pTask = TaskBlock(tid);
+	if ( pTask == NULL )
 	{	return sts;
 	}
 
@@ -766,18 +884,18 @@ STATUS taskDelete( int tid )
 	// We are ignoring the race of threads having the same id
 	// VxWorks doesn't protect against that either.
 	// Also we assume you can delete a suspended thread.
-	if ( aTasks[tid].bBusy )
+	if ( pTask->bBusy )
 	{	sts = OK;
-		if (! TerminateThread( aTasks[tid].hThread, 0 ) )
+		if (! TerminateThread( pTask->hThread, 0 ) )
 		{
 			vxlReportLastError("taskDelete - TerminateThread" );
 			sts = ERROR;
 			SetVxErrno( 995 );	// What to set it to?
 		}
 		// Free the task entry now (only after the thread is terminated)
-        CloseHandle( aTasks[tid].hThread );
-        aTasks[tid].hThread = NULL;
-		memset( &aTasks[tid], 0, sizeof(TASKBLOCK) );
+        CloseHandle( pTask->hThread );
+        pTask->hThread = NULL;
+		FreeTaskBlock(tid);
 		gTaskCount--;
 	}
 	UnlockTaskList();
@@ -804,11 +922,13 @@ STATUS taskDeleteForce( int tid )
 void taskExit()
 {
 	int		tid;
+	TASKBLOCK	*pTask;
 
 	tid = taskIdSelf();
 	// Do we really need to lock the task array for a look see?
 	// Nope, chance it.
-	if ( tid < 1 || tid >= TASKMAXTASKS )
+	pTask = TaskBlock(tid);
+	if ( pTask == NULL )
 	{	return;
 	}
 	// Now we need to lock the task list since we are going to blow
@@ -819,11 +939,11 @@ void taskExit()
 	// We are ignoring the race of threads having the same id
 	// VxWorks doesn't protect against that either.
 	// Also we assume you can delete a suspended thread.
-	if ( aTasks[tid].bBusy )
+	if ( pTask->bBusy )
 	{
-		//CloseHandle( aTasks[tid].hThread );
+		//CloseHandle( pTask->hThread );
 		// Free the task entry now.
-		memset( &aTasks[tid], 0, sizeof(TASKBLOCK) );
+		FreeTaskBlock(tid);
 		gTaskCount--;
 	}
 	UnlockTaskList();
@@ -848,19 +968,23 @@ void taskExit()
 STATUS taskSuspend( int tid )
 {
 	STATUS		sts = ERROR;
+	TASKBLOCK	*pTask;
 	DWORD		winSts;
 	// Do we really need to lock the task array for a look see?
 	// Nope, chance it.
-	if ( tid < 0 || tid >= TASKMAXTASKS )
+	if ( tid == 0 )
+	{	tid = taskIdSelf();
+	}
+	pTask = TaskBlock(tid);
+	if ( pTask == NULL )
 	{	return sts;
 	}
 
 	// Check for the Suspend Self case
-	if ( tid == 0 || tid == taskIdSelf() )
+	if ( tid == taskIdSelf() )
 	{
-		tid = taskIdSelf();
 		sts = OK;
-		winSts = SuspendThread( aTasks[tid].hThread );
+		winSts = SuspendThread( pTask->hThread );
 		if ( winSts == 0xFFFFFFFF )
 		{
 			vxlReportLastError( "taskSuspend - SuspendThread self" );
@@ -873,13 +997,13 @@ STATUS taskSuspend( int tid )
 	// else error for task not suspended.
 	// Protect against simultaneous access by another thread
 	LockTaskList();
-	if ( aTasks[tid].bBusy && 
-		 !aTasks[tid].bSuspended )
+	if ( pTask->bBusy && 
+		 !pTask->bSuspended )
 	{	sts = OK;
 		// note potential compatibility
 		// Timers don't run in a Suspended thread
 		// that someone else suspends.
-		winSts = SuspendThread( aTasks[tid].hThread );
+		winSts = SuspendThread( pTask->hThread );
 		if ( winSts == 0xFFFFFFFF )
 		{
 			vxlReportLastError( "taskSuspend - SuspendThread" );
@@ -887,7 +1011,7 @@ STATUS taskSuspend( int tid )
 			sts = ERROR;
 		}
 		else
-		{	aTasks[tid].bSuspended = TRUE;
+		{	pTask->bSuspended = TRUE;
 		}
 	}
 	else
@@ -907,17 +1031,19 @@ STATUS taskSuspend( int tid )
 STATUS taskResume( int tid )
 {
 	STATUS		sts = ERROR;
+	TASKBLOCK	*pTask;
 	DWORD		winSts;
 	// Do we really need to lock the task array for a look see?
 	// Nope, chance it.
-	if ( tid < 1 || tid >= TASKMAXTASKS )
+	pTask = TaskBlock(tid);
+	if ( pTask == NULL )
 	{	return sts;
 	}
 	// If the task is suspended, then it's ok
 	// else error for task not suspended.
-	if ( aTasks[tid].bSuspended )
+	if ( pTask->bSuspended )
 	{	sts = OK;
-	    winSts = ResumeThread( aTasks[tid].hThread );
+	    winSts = ResumeThread( pTask->hThread );
 	    if ( winSts == 0xFFFFFFFF )
 		{
 			vxlReportLastError("taskResume - ResumeThread");
@@ -973,11 +1099,11 @@ STATUS taskLock(void)
 	// Only suspend the threads the first time
 	if (gTaskLockCount == 1)
 	{
-		for (tid = 1; tid < TASKMAXTASKS; tid++)
+		for (tid = 1; tid <= gTaskHighWater; tid++)
 		{
-			if ((tid != tidSelf) && (aTasks[tid].bBusy))
+			if ((tid != tidSelf) && (apTasks[tid]->bBusy))
 			{
-				winSts = SuspendThread( aTasks[tid].hThread );
+				winSts = SuspendThread( apTasks[tid]->hThread );
 				if ( winSts == 0xFFFFFFFF )
 				{
 					vxlReportLastError("taskLock - SuspendThread");
@@ -1008,11 +1134,11 @@ STATUS taskUnlock(void)
 		gTaskLockCount--;
 		if (gTaskLockCount == 0)
 		{
-			for (tid = 1; tid < TASKMAXTASKS; tid++)
+			for (tid = 1; tid <= gTaskHighWater; tid++)
 			{
-				if ((tid != tidSelf) && (aTasks[tid].bBusy))
+				if ((tid != tidSelf) && (apTasks[tid]->bBusy))
 				{
-					winSts = ResumeThread( aTasks[tid].hThread );
+					winSts = ResumeThread( apTasks[tid]->hThread );
 					if ( winSts == 0xFFFFFFFF )
 					{
 						vxlReportLastError("taskUnlock - ResumeThread");
@@ -1031,19 +1157,23 @@ STATUS taskUnlock(void)
 // 
 // taskNameToId
 //
+// If several busy tasks have the name, return the one spawned first.
+//
 int taskNameToId(char *name)
 {
 	int result = ERROR;
 	int tid;
 
-	for (tid = 1; tid < TASKMAXTASKS; tid++)
+	LockTaskList();
+	for (tid = aTaskNameHash[TaskNameBucket(name)]; tid != 0; tid = apTasks[tid]->nextName)
 	{
-		if (aTasks[tid].bBusy && (strncmp(aTasks[tid].name, name, TASKNAMEMAX) == 0))
+		if (apTasks[tid]->bBusy && (strncmp(apTasks[tid]->name, name, TASKNAMEMAX) == 0))
 		{
 			result = tid;
 			break;
 		}
 	}
+	UnlockTaskList();
 
 	return(result);
 }
@@ -1053,20 +1183,34 @@ int taskNameToId(char *name)
 //
 void printfAllTasks(void)
 {
+	static const char *policyNames[] = { "default", "nice", "fifo" };
 	int tid = 1;
+	OsalTaskSchedInfo sched;
 
 	printf("\nPRINTING ALL CREATED TASKS\n"
-			 "[status] taskId, taskHandle, taskName\n"
-			 "=====================================\n");
-	for (tid = 1; tid < TASKMAXTASKS; ++tid)
+			 "[status] taskId, taskHandle, taskName, priority, policy/value, stackSize, cpuMask\n"
+			 "===============================================================================\n");
+	// Hold the list so task handles aren't closed while we read them
+	LockTaskList();
+	for (tid = 1; tid <= gTaskHighWater; ++tid)
 	{
-		if(aTasks[tid].bBusy) {
-			printf("[busy] %04d,  %p,  '%s'\n", tid, aTasks[tid].hThread, aTasks[tid].name);
+		TASKBLOCK *pTask = apTasks[tid];
+		if (!pTask->bBusy && !pTask->bSuspended)
+		{
+			continue;
 		}
-		else if(aTasks[tid].bSuspended) {
-				printf("[suspended] %04d,  %p,  '%s'\n", tid, aTasks[tid].hThread, aTasks[tid].name);
-			}
+		memset(&sched, 0, sizeof(sched));
+		if (pTask->hThread != NULL)
+		{
+			OsalGetTaskSchedInfo(pTask->hThread, &sched);
+		}
+		printf("[%s] %04d,  %p,  '%s',  %d,  %s/%d,  %d,  0x%lx\n",
+			   pTask->bBusy ? "busy" : "suspended",
+			   tid, pTask->hThread, pTask->name, sched.priority,
+			   policyNames[sched.policy <= OSAL_SCHED_FIFO ? sched.policy : 0],
+			   sched.schedValue, sched.stackSize, sched.cpuMask);
 	}
+	UnlockTaskList();
 	printf("\n");
 }
 
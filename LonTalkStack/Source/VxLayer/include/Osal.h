@@ -173,6 +173,33 @@ typedef struct timespec
 typedef unsigned int OsalTaskId;
 typedef unsigned int OsalThreadId;
 
+/*
+ *  Typedef: OsalSchedPolicy
+ *  How <OsalCreateTask> maps a task's priority onto the host scheduler.
+ *
+ *  Task priorities follow the VxWorks convention: 0 is the highest and 255
+ *  the lowest.  See <OsalSetTaskSchedPolicy>.
+ */
+typedef enum
+{
+    OSAL_SCHED_DEFAULT = 0,     /* Inherit the creator's policy; priority is ignored */
+    OSAL_SCHED_NICE    = 1,     /* SCHED_OTHER, priority scaled onto a nice range */
+    OSAL_SCHED_FIFO    = 2,     /* SCHED_FIFO, priority scaled onto the real-time range */
+} OsalSchedPolicy;
+
+/*
+ *  Typedef: OsalTaskSchedInfo
+ *  The scheduling settings actually in effect for a task.
+ */
+typedef struct
+{
+    int             priority;   /* Priority requested at creation */
+    OsalSchedPolicy policy;     /* Effective policy */
+    int             schedValue; /* Nice value or SCHED_FIFO priority, per policy */
+    int             stackSize;  /* Stack size applied, 0 for the OS default */
+    unsigned long   cpuMask;    /* CPUs the task may run on, 0 for all */
+} OsalTaskSchedInfo;
+
 #ifdef  __cplusplus
 extern "C"
 {
@@ -251,7 +278,17 @@ OsalStatus OsalCreateTask(OsalTaskEntryPointType pEntry, int taskIndex, int stac
                           int priority, 
                           OsalHandle *pHandle, 
                           OsalTaskId *pTaskId);
+OsalStatus OsalCreateNamedTask(OsalTaskEntryPointType pEntry, int taskIndex, int stackSize,
+                               int priority, const char *szName,
+                               OsalHandle *pHandle,
+                               OsalTaskId *pTaskId);
 OsalStatus OsalCloseTaskHandle(OsalHandle handle);
+OsalStatus OsalGetTaskSchedInfo(OsalHandle handle, OsalTaskSchedInfo *pInfo);
+
+// Task scheduling configuration.  Applies to tasks created afterwards.
+OsalStatus OsalSetTaskSchedPolicy(OsalSchedPolicy policy, int highest, int lowest);
+OsalStatus OsalSetTaskMinStackSize(int stackSize);
+OsalStatus OsalSetTaskAffinity(const char *szName, unsigned long cpuMask);
 OsalTaskId OsalGetTaskId(void);
 int OsalGetTaskIndex(void);
 int OsalGenerateTaskIndex(void);
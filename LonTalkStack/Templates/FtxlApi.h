@@ -93,6 +93,44 @@ FTXL_EXTERNAL_FN const LonApiError LonRegisterUniqueId(const LonUniqueId* const
  */
 FTXL_EXTERNAL_FN void LonEventPump(void);
 
+/*
+ * Function: LonEventPumpEx
+ * Process IzoT events, with a limit on the number of incoming messages.
+ *
+ * Parameters:
+ * maxEvents - the maximum number of incoming messages and network variable 
+ *   updates to process in this call, or 0 for no limit
+ *
+ * Returns:
+ * TRUE if incoming events remain to be processed.
+ *
+ * Remarks:
+ * This function works like <LonEventPump>, but returns after maxEvents 
+ * incoming messages so that a busy device cannot starve the rest of the 
+ * application's event loop.  Call it again while it returns TRUE.
+ */
+FTXL_EXTERNAL_FN const LonBool LonEventPumpEx(const unsigned maxEvents);
+
+/*
+ * Function: LonGetEventFd
+ * Gets a file descriptor that becomes readable when IzoT events are pending.
+ *
+ * Parameters:
+ * pFd - pointer to receive the file descriptor
+ *
+ * Returns:
+ * <LonApiError>.  LonApiNotAllowed if the platform does not support it 
+ * (currently Linux only).
+ *
+ * Remarks:
+ * The descriptor is an alternative to the <LonEventReady> callback for 
+ * applications that wait in poll, epoll or similar.  When it is readable, 
+ * call <LonEventPump> or <LonEventPumpEx>, which consume the wakeup.  The 
+ * descriptor is owned by the stack and is closed by <LonLidDestroyStack>.  
+ * The <LonEventReady> callback is still called.
+ */
+FTXL_EXTERNAL_FN const LonApiError LonGetEventFd(int* const pFd);
+
 /*
  *  Function: LonGetUniqueId
  *  Gets the register unique ID (Neuron ID).
@@ -299,6 +337,28 @@ FTXL_EXTERNAL_FN const LonApiError LonPollNv(const unsigned index);
  */
 FTXL_EXTERNAL_FN const LonApiError LonPropagateNv(const unsigned index);
 
+/*
+ *  Function: LonPropagateNvs
+ *  Propagates the values of a list of bound output network variables.
+ *
+ *  Parameters:
+ *  pIndices - the indices of the network variables
+ *  count - the number of indices
+ *  pPropagated - receives the number propagated, may be NULL
+ *
+ *  Returns:
+ *  <LonApiError>.
+ *
+ *  Remarks:
+ *  Equivalent to calling <LonPropagateNv> for each index in turn.  All the 
+ *  indices are checked before any are propagated.  If the stack runs out of 
+ *  buffers for a *sync* network variable, the rest are not propagated and 
+ *  *LonApiTxBufIsFull* is returned.
+ */
+FTXL_EXTERNAL_FN const LonApiError LonPropagateNvs(const unsigned* const pIndices, 
+                                                   const unsigned count,
+                                                   unsigned* const pPropagated);
+
 
 /*
  *  Function: LonSendServicePin
@@ -1867,6 +1927,18 @@ FTXL_EXTERNAL_FN unsigned LonGetAliasCount();
  */
 FTXL_EXTERNAL_FN unsigned LonGetAddressTableCount();
 
+/*
+ *  Function: LonGetConfigChangeCount
+ *  Gets the configuration change count
+ *  
+ *  Returns:     
+ *  A count which advances whenever the network image (NV, alias, address, 
+ *  domain and configuration data) is stored or restored.  A caller which 
+ *  caches configuration can compare it with the count it last saw to decide 
+ *  whether the cache is still current.
+ */
+FTXL_EXTERNAL_FN unsigned LonGetConfigChangeCount();
+
 /*
  *  Function: LonGetStaticNVCount
  *  Gets the size of the address table
@@ -1953,6 +2025,77 @@ FTXL_EXTERNAL_FN const LonApiError LonGetDidFromLocalAddress(LonByte* pDomId, un
  */
 FTXL_EXTERNAL_FN const LonApiError LonResetPersistence(PersistenceResetType resetType);
 
+/*
+ * ******************************************************************************
+ * SECTION: IzoT SDK Device Stack Handle API
+ * ******************************************************************************
+ *
+ * The handle API hosts several IzoT devices in one process.  
+ * <LonCtxCreateHandle> allocates a <LonStackHandle>, which is passed as the 
+ * first parameter of each LonCtx function below.  Each of these behaves like 
+ * the function of the same name without the "Ctx", but operates on the stack 
+ * owned by the handle.  The handle-less functions operate on a default stack.
+ *
+ * The event ready, NV update occurred and NV update completed events, and the 
+ * non-volatile data callbacks used to persist the stack, are delivered to the 
+ * <LonCtxCallbacks> given when the handle is created, together with its 
+ * pUserContext.  The non-volatile data callbacks also get the handle.  Where 
+ * one of these is not supplied, the global callback is used, and where that 
+ * is not registered either, the default handler keeps the data in the folder 
+ * given to <LonCtxSetNvdFsPath>.  All other events are delivered to the global 
+ * callbacks.
+ * <LonCtxFreeHandle> destroys the stack, if any, and frees the handle.
+ */
+FTXL_EXTERNAL_FN const LonApiError LonCtxCreateHandle(LonStackHandle* phStack, const LonCtxCallbacks* const pCallbacks);
+FTXL_EXTERNAL_FN const LonApiError LonCtxFreeHandle(LonStackHandle hStack);
+FTXL_EXTERNAL_FN const LonApiError LonCtxSetDeviceUri(LonStackHandle hStack, const char* pDeviceURI);
+FTXL_EXTERNAL_FN const LonApiError LonCtxRegisterUniqueId(LonStackHandle hStack, const LonUniqueId* const pId);
+FTXL_EXTERNAL_FN const LonApiError LonCtxSetNvdFsPath(LonStackHandle hStack, const char* pFsPath);
+
+FTXL_EXTERNAL_FN const LonApiError LonCtxLidCreateStack(LonStackHandle hStack, const LonStackInterfaceData* const pInterface, const LonControlData * const pControlData);
+FTXL_EXTERNAL_FN const LonApiError LonCtxLidRegisterStaticNv(LonStackHandle hStack, const LonNvDefinition* const pNvDef);
+FTXL_EXTERNAL_FN const LonApiError LonCtxLidRegisterMemoryWindow(LonStackHandle hStack, const unsigned int windowAddress, const unsigned int windowSize);
+FTXL_EXTERNAL_FN const LonApiError LonCtxLidStartStack(LonStackHandle hStack);
+FTXL_EXTERNAL_FN void LonCtxLidDestroyStack(LonStackHandle hStack);
+
+FTXL_EXTERNAL_FN void LonCtxEventPump(LonStackHandle hStack);
+FTXL_EXTERNAL_FN const LonBool LonCtxEventPumpEx(LonStackHandle hStack, const unsigned maxEvents);
+FTXL_EXTERNAL_FN const LonApiError LonCtxGetEventFd(LonStackHandle hStack, int* const pFd);
+FTXL_EXTERNAL_FN const LonApiError LonCtxSendServicePin(LonStackHandle hStack);
+FTXL_EXTERNAL_FN const LonApiError LonCtxPollNv(LonStackHandle hStack, const unsigned index);
+FTXL_EXTERNAL_FN const LonApiError LonCtxPropagateNv(LonStackHandle hStack, const unsigned index);
+FTXL_EXTERNAL_FN const LonApiError LonCtxPropagateNvs(LonStackHandle hStack, const unsigned* const pIndices,
+                                                      const unsigned count, unsigned* const pPropagated);
+FTXL_EXTERNAL_FN const unsigned LonCtxGetDeclaredNvSize(LonStackHandle hStack, const unsigned index);
+FTXL_EXTERNAL_FN volatile void* const LonCtxGetNvValue(LonStackHandle hStack, const unsigned index);
+FTXL_EXTERNAL_FN const LonApiError LonCtxSetNvValue(LonStackHandle hStack, const unsigned index, void* const pValue);
+FTXL_EXTERNAL_FN const LonApiError LonCtxQueryNvType(LonStackHandle hStack, const unsigned index, LonNvDefinition* const pNvDef);
+FTXL_EXTERNAL_FN const LonApiError LonCtxSendResponse(LonStackHandle hStack, const LonCorrelator correlator, const LonByte code, const LonByte* const pData, const unsigned length);
+FTXL_EXTERNAL_FN const LonApiError LonCtxReleaseCorrelator(LonStackHandle hStack, const LonCorrelator correlator);
+FTXL_EXTERNAL_FN const LonApiError LonCtxSendMsg(LonStackHandle hStack, const unsigned tag, const LonBool priority, const LonServiceType st, const LonBool authenticated, const LonSendAddress* const pDestAddr, const LonByte code, const LonByte* const pData, const unsigned length);
+
+FTXL_EXTERNAL_FN const LonApiError LonCtxQueryDomainConfig(LonStackHandle hStack, const unsigned index, LonDomain* const pDomain);
+FTXL_EXTERNAL_FN const LonApiError LonCtxQueryNvConfig(LonStackHandle hStack, const unsigned index, LonNvEcsConfig* const pNvConfig);
+FTXL_EXTERNAL_FN const LonApiError LonCtxQueryAliasConfig(LonStackHandle hStack, const unsigned index, LonAliasEcsConfig* const pAlias);
+FTXL_EXTERNAL_FN const LonApiError LonCtxNvIsBound(LonStackHandle hStack, const unsigned index, LonBool* const pIsBound);
+FTXL_EXTERNAL_FN const LonApiError LonCtxQueryAddressConfig(LonStackHandle hStack, const unsigned index, LonAddress* const pAddress);
+FTXL_EXTERNAL_FN const LonApiError LonCtxMtIsBound(LonStackHandle hStack, const unsigned tag, LonBool* const pIsBound);
+FTXL_EXTERNAL_FN const LonApiError LonCtxQueryConfigData(LonStackHandle hStack, LonConfigData* const pConfig);
+FTXL_EXTERNAL_FN const LonApiError LonCtxQueryStatus(LonStackHandle hStack, LonStatus* const pStatus);
+FTXL_EXTERNAL_FN const LonApiError LonCtxQueryTransceiverStatus(LonStackHandle hStack, LonTransceiverParameters* const pTransceiverParameters);
+FTXL_EXTERNAL_FN const LonApiError LonCtxQueryReadOnlyData(LonStackHandle hStack, LonReadOnlyData* const pReadOnlyData);
+FTXL_EXTERNAL_FN const LonApiError LonCtxSetNodeMode(LonStackHandle hStack, const LonNodeMode mode, const LonNodeState state);
+FTXL_EXTERNAL_FN const LonApiError LonCtxUpdateAddressConfig(LonStackHandle hStack, const unsigned index, const LonAddress* const pAddress);
+FTXL_EXTERNAL_FN const LonApiError LonCtxUpdateAliasConfig(LonStackHandle hStack, const unsigned index, const LonAliasEcsConfig* const pAlias);
+FTXL_EXTERNAL_FN const LonApiError LonCtxUpdateConfigData(LonStackHandle hStack, const LonConfigData* const pConfig);
+FTXL_EXTERNAL_FN const LonApiError LonCtxUpdateNvConfig(LonStackHandle hStack, const unsigned index, const LonNvEcsConfig* const pNvConfig);
+FTXL_EXTERNAL_FN const LonApiError LonCtxUpdateDomainConfig(LonStackHandle hStack, const unsigned index, const LonDomain* const pDomain);
+FTXL_EXTERNAL_FN const LonApiError LonCtxClearStatus(LonStackHandle hStack);
+FTXL_EXTERNAL_FN unsigned LonCtxGetConfigChangeCount(LonStackHandle hStack);
+
+FTXL_EXTERNAL_FN const LonApiError LonCtxNvdAppSegmentHasBeenUpdated(LonStackHandle hStack);
+FTXL_EXTERNAL_FN const LonApiError LonCtxNvdFlushData(LonStackHandle hStack);
+
 /*
  *  In IzoT, LonTalk Stack callback functions are registered
  *  with a callback handler of a suitable type, and must be
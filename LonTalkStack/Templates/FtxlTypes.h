@@ -3032,4 +3032,59 @@ typedef struct
     LonFilterMsgCompletedFunction       filterMsgCompleted;
 }   LonCallbackVectors;
 
+/*
+ *  Handle and callback types for the handle-based (LonCtx) API.  Each 
+ *  callback receives the pUserContext given to LonCtxCreateHandle.  A NULL 
+ *  callback falls back to the corresponding global callback.
+ */
+typedef struct LonStackContext* LonStackHandle;
+
+typedef void (*LonCtxEventReadyFunction)(void* pUserContext);
+typedef void (*LonCtxNvUpdateOccurredFunction)(void* pUserContext, const unsigned index, 
+                                               const LonReceiveAddress* const pSourceAddress);
+typedef void (*LonCtxNvUpdateCompletedFunction)(void* pUserContext, const unsigned index, 
+                                                const LonBool success);
+
+/*
+ *  The non-volatile data callbacks of a handle also receive the handle, so 
+ *  that one set of handlers can keep each stack's data apart.  The calls for 
+ *  one handle are made one sequence at a time; those for different handles 
+ *  may run concurrently.  Callbacks that are not supplied must be NULL.
+ */
+typedef const LonNvdHandle (*LonCtxNvdOpenForReadFunction)(void* pUserContext, LonStackHandle hStack, 
+                                                           const LonNvdSegmentType type);
+typedef const LonNvdHandle (*LonCtxNvdOpenForWriteFunction)(void* pUserContext, LonStackHandle hStack, 
+                                                            const LonNvdSegmentType type, const size_t size);
+typedef void (*LonCtxNvdCloseFunction)(void* pUserContext, LonStackHandle hStack, const LonNvdHandle handle);
+typedef void (*LonCtxNvdDeleteFunction)(void* pUserContext, LonStackHandle hStack, const LonNvdSegmentType type);
+typedef const LonApiError (*LonCtxNvdReadFunction)(void* pUserContext, LonStackHandle hStack, 
+                                                   const LonNvdHandle handle, const size_t offset,
+                                                   const size_t size, void * const pBuffer);
+typedef const LonApiError (*LonCtxNvdWriteFunction)(void* pUserContext, LonStackHandle hStack, 
+                                                    const LonNvdHandle handle, const size_t offset,
+                                                    const size_t size, const void * const pData);
+typedef const LonBool (*LonCtxNvdIsInTransactionFunction)(void* pUserContext, LonStackHandle hStack, 
+                                                          const LonNvdSegmentType type);
+typedef const LonApiError (*LonCtxNvdEnterTransactionFunction)(void* pUserContext, LonStackHandle hStack, 
+                                                               const LonNvdSegmentType type);
+typedef const LonApiError (*LonCtxNvdExitTransactionFunction)(void* pUserContext, LonStackHandle hStack, 
+                                                              const LonNvdSegmentType type);
+
+typedef struct
+{
+    void*                           pUserContext;
+    LonCtxEventReadyFunction        eventReady;
+    LonCtxNvUpdateOccurredFunction  nvUpdateOccurred;
+    LonCtxNvUpdateCompletedFunction nvUpdateCompleted;
+    LonCtxNvdOpenForReadFunction    nvdOpenForRead;
+    LonCtxNvdOpenForWriteFunction   nvdOpenForWrite;
+    LonCtxNvdCloseFunction          nvdClose;
+    LonCtxNvdDeleteFunction         nvdDelete;
+    LonCtxNvdReadFunction           nvdRead;
+    LonCtxNvdWriteFunction          nvdWrite;
+    LonCtxNvdIsInTransactionFunction    nvdIsInTransaction;
+    LonCtxNvdEnterTransactionFunction   nvdEnterTransaction;
+    LonCtxNvdExitTransactionFunction    nvdExitTransaction;
+}   LonCtxCallbacks;
+
 #endif /* _FTXL_TYPES_H */